@@ -87,7 +87,7 @@
 			interval: energyInterval
 			name: @"EnergyCheckpoint"];
 		[[AdMainLoopTimer mainLoopTimer] 
-			sendMessage: @selector(synchToStore)
+			sendMessage: @selector(scheduleSynchToStore)
 			toObject: dataWriter
 			interval: flushInterval
 			name: @"FlushEnergies"];	
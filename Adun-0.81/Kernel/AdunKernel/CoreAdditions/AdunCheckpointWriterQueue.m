@@ -0,0 +1,614 @@
+/*
+   Project: AdunCore
+
+   Copyright (C) 2008 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#include "AdunKernel/AdunCheckpointWriterQueue.h"
+#include "AdunKernel/AdunSystem.h"
+
+@implementation AdCheckpointSlot
+
+- (id) init
+{
+	if((self = [super init]))
+	{
+		numberOfSystems = 0;
+		capacity = 0;
+		masks = NULL;
+		coordinates = NULL;
+		velocities = NULL;
+		encodesOnCapture = NO;
+		systemNames = [NSMutableArray new];
+		mementos = [NSMutableArray new];
+		trajectoryData = nil;
+		energyRecord = [AdEnergyRecord new];
+		topologyData = nil;
+		[self clear];
+	}
+
+	return self;
+}
+
+- (void) _freeMatrices
+{
+	int i;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	for(i=0; i<capacity; i++)
+	{
+		if(coordinates[i] != NULL)
+			[memoryManager freeMatrix: coordinates[i]];
+
+		if(velocities[i] != NULL)
+			[memoryManager freeMatrix: velocities[i]];
+	}
+
+	free(masks);
+	free(coordinates);
+	free(velocities);
+	masks = NULL;
+	coordinates = velocities = NULL;
+	capacity = 0;
+}
+
+- (void) dealloc
+{
+	[self _freeMatrices];
+	[systemNames release];
+	[mementos release];
+	[trajectoryData release];
+	[energyRecord release];
+	[topologyData release];
+	[super dealloc];
+}
+
+/**
+Copies \e source into the matrix pointed to by \e copy reallocating it if
+it does not have the same dimensions.
+*/
+- (void) _copyMatrix: (AdMatrix*) source to: (AdMatrix**) copy
+{
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	if(*copy != NULL && 
+		((*copy)->no_rows != source->no_rows || (*copy)->no_columns != source->no_columns))
+	{
+		[memoryManager freeMatrix: *copy];
+		*copy = NULL;
+	}
+
+	if(*copy == NULL)
+		*copy = [memoryManager allocateMatrixWithRows: source->no_rows
+				withColumns: source->no_columns];
+
+	memcpy((*copy)->matrix[0], source->matrix[0], 
+		source->no_rows*source->no_columns*sizeof(double));
+}
+
+- (void) captureStateOfSystems: (NSArray*) systems
+{
+	int i;
+	AdSystem* system;
+
+	[trajectoryData release];
+	trajectoryData = nil;
+	[systemNames removeAllObjects];
+	[mementos removeAllObjects];
+	numberOfSystems = 0;
+	trajectoryCheckpoint = YES;
+
+	if(encodesOnCapture)
+	{
+		[self setTrajectoryData: AdCreateTrajectoryCheckpoint(systems)];
+		return;
+	}
+
+	//XML checkpoints are archives of the system mementos.
+	//The mementos are copies so they are archived when the checkpoint is written.
+	if(!AdTrajectoryFrameEncodingFromDefaults(&encoding, &precision))
+	{
+		for(i=0; i<(int)[systems count]; i++)
+		{
+			system = [systems objectAtIndex: i];
+			[systemNames addObject: [system systemName]];
+			[mementos addObject: [system captureState]];
+		}
+
+		return;
+	}
+
+	if((int)[systems count] > capacity)
+	{
+		[self _freeMatrices];
+		capacity = [systems count];
+		masks = (int*)malloc(capacity*sizeof(int));
+		coordinates = (AdMatrix**)calloc(capacity, sizeof(AdMatrix*));
+		velocities = (AdMatrix**)calloc(capacity, sizeof(AdMatrix*));
+	}
+
+	numberOfSystems = [systems count];
+	for(i=0; i<numberOfSystems; i++)
+	{
+		system = [systems objectAtIndex: i];
+		[systemNames addObject: [system systemName]];
+		masks[i] = [system captureMask];
+		if(masks[i] & AdSystemCoordinatesMemento)
+			[self _copyMatrix: [system coordinates] to: &coordinates[i]];
+		
+		if(masks[i] & AdSystemVelocitiesMemento)
+			[self _copyMatrix: [system velocities] to: &velocities[i]];
+	}
+}
+
+- (void) setTrajectoryData: (NSData*) data
+{
+	[trajectoryData release];
+	trajectoryData = [data retain];
+	trajectoryCheckpoint = YES;
+}
+
+- (NSData*) trajectoryData
+{
+	int i;
+	NSMutableData* data;
+	NSKeyedArchiver* archiver;
+
+	if(trajectoryData == nil && [mementos count] > 0)
+	{
+		data = [NSMutableData data];
+		archiver = [[NSKeyedArchiver alloc] 
+				initForWritingWithMutableData: data];
+		[archiver setOutputFormat: NSPropertyListXMLFormat_v1_0];
+		for(i=0; i<(int)[mementos count]; i++)
+			[archiver encodeObject: [mementos objectAtIndex: i]
+				forKey: [systemNames objectAtIndex: i]];
+		
+		[archiver finishEncoding];
+		[archiver release];
+		trajectoryData = [data retain];
+	}
+	else if(trajectoryData == nil && numberOfSystems > 0)
+		trajectoryData = [AdEncodeTrajectoryFrameFromMatrices(systemNames, masks,
+					coordinates, velocities, encoding, precision) retain];
+
+	return [[trajectoryData retain] autorelease];
+}
+
+- (void) setTopologyData: (NSDictionary*) topologies
+{
+	[topologyData release];
+	topologyData = [topologies retain];
+}
+
+- (NSArray*) writeToStorage: (id) storage stateData: (AdDataSet*) stateData
+{
+	NSData* trajectory;
+	NSMutableData* data;
+	NSMutableArray* checkpointed = [NSMutableArray array];
+	NSKeyedArchiver* archiver;
+	NSEnumerator* systemEnum;
+	id systemName, topology;
+
+	if(trajectoryCheckpoint)
+	{
+		trajectory = [self trajectoryData];
+		[storage addTrajectoryCheckpoint: trajectory];
+		NSDebugLLog(@"AdCheckpointWriterQueue",
+			@"Checkpointed %d bytes of trajectory data",
+			[trajectory length]);
+		[checkpointed addObject: [NSNumber numberWithInt: 1]];
+	}
+	else
+		[checkpointed addObject: [NSNumber numberWithInt: 0]];
+
+	if(energyCheckpoint && stateData != nil)
+	{
+		NSDebugLLog(@"AdCheckpointWriterQueue",
+			@"Checkpointing energies");
+		[energyRecord addEnergiesToDataSet: stateData];
+		[checkpointed addObject: [NSNumber numberWithInt: 1]];
+	}
+	else
+		[checkpointed addObject: [NSNumber numberWithInt: 0]];
+
+	if(topologyCheckpoint)
+	{
+		data = [NSMutableData new];
+		archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData: data];
+		[archiver setOutputFormat: NSPropertyListXMLFormat_v1_0];
+		systemEnum = [topologyData keyEnumerator];
+		while((systemName = [systemEnum nextObject]))
+		{
+			//We assume the data source has been synched
+			//to the current configuration
+			NSDebugLLog(@"AdCheckpointWriterQueue",
+				@"Checkpointing topology of %@", systemName);
+			topology = [topologyData objectForKey: systemName];
+			[archiver encodeObject: topology
+				forKey: systemName];
+		}
+		
+		[archiver finishEncoding];
+		[archiver release];
+		[storage addTopologyCheckpoint: data];
+		NSDebugLLog(@"AdCheckpointWriterQueue",
+			@"Checkpointed %d bytes of topology data", [data length]);
+		[data release];
+		[checkpointed addObject: [NSNumber numberWithInt: 1]];
+	}
+	else
+		[checkpointed addObject: [NSNumber numberWithInt: 0]];
+
+	return checkpointed;
+}
+
+- (void) clear
+{
+	trajectoryCheckpoint = NO;
+	energyCheckpoint = NO;
+	topologyCheckpoint = NO;
+	numberOfSystems = 0;
+	[systemNames removeAllObjects];
+	[mementos removeAllObjects];
+	[energyRecord clear];
+	[trajectoryData release];
+	[topologyData release];
+	trajectoryData = nil;
+	topologyData = nil;
+}
+
+@end
+
+@implementation AdCheckpointWriterQueue
+
++ (void) initialize
+{
+	[[NSUserDefaults standardUserDefaults] registerDefaults:
+		[NSDictionary dictionaryWithObjectsAndKeys: 
+			[NSNumber numberWithBool: YES], @"AsynchronousCheckpointing",
+			[NSNumber numberWithInt: 2], @"CheckpointQueueLength",
+			nil]];
+}
+
++ (BOOL) asynchronousCheckpointing
+{
+	return [[NSUserDefaults standardUserDefaults] 
+			boolForKey: @"AsynchronousCheckpointing"];
+}
+
+- (id) initWithTarget: (id) object 
+	writeSelector: (SEL) writeSel
+	synchronizeSelector: (SEL) synchronizeSel
+{
+	int number;
+
+	if(![AdCheckpointWriterQueue asynchronousCheckpointing])
+		return [self initWithTarget: object
+			writeSelector: writeSel
+			synchronizeSelector: synchronizeSel
+			numberOfSlots: 0];
+
+	number = [[NSUserDefaults standardUserDefaults] 
+			integerForKey: @"CheckpointQueueLength"];
+	if(number < 1)
+	{
+		NSWarnLog(@"Invalid checkpoint queue length %d - Using 2", number);
+		number = 2;
+	}
+
+	return [self initWithTarget: object
+		writeSelector: writeSel
+		synchronizeSelector: synchronizeSel
+		numberOfSlots: number];
+}
+
+- (id) initWithTarget: (id) object 
+	writeSelector: (SEL) writeSel
+	synchronizeSelector: (SEL) synchronizeSel
+	numberOfSlots: (int) number
+{
+	int i;
+	AdCheckpointSlot* slot;
+
+	if((self = [super init]))
+	{
+		if(number < 0)
+			[NSException raise: NSInvalidArgumentException
+				format: @"The number of slots cannot be negative (%d)", number];
+
+		target = object;
+		writeSelector = writeSel;
+		synchronizeSelector = synchronizeSel;
+		isSynchronous = (number == 0) ? YES : NO;
+		numberOfSlots = isSynchronous ? 1 : number;
+		firstSlot = usedSlots = submittedSlots = 0;
+		numberSubmitted = numberWritten = synchronizationPoint = 0;
+		hasCurrentSlot = NO;
+		synchronizationRequested = NO;
+		writerException = nil;
+		slots = [NSMutableArray new];
+		for(i=0; i<numberOfSlots; i++)
+		{
+			slot = [AdCheckpointSlot new];
+			slot->encodesOnCapture = isSynchronous;
+			[slots addObject: slot];
+			[slot release];
+		}
+
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&slotCondition, NULL);
+		pthread_cond_init(&workCondition, NULL);
+		if(isSynchronous)
+		{
+			isRunning = NO;
+			NSDebugLLog(@"AdCheckpointWriterQueue", @"Writing checkpoints synchronously");
+			return self;
+		}
+
+		isRunning = YES;
+		[NSThread detachNewThreadSelector: @selector(_runWriter:)
+			toTarget: self
+			withObject: nil];
+		NSDebugLLog(@"AdCheckpointWriterQueue", 
+			@"Started writer thread with %d slots", numberOfSlots);
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[self stop];
+	pthread_cond_destroy(&slotCondition);
+	pthread_cond_destroy(&workCondition);
+	pthread_mutex_destroy(&mutex);
+	[writerException release];
+	[slots release];
+	[super dealloc];
+}
+
+/**
+Raises the last exception caught on the writer thread if there is one.
+Must be called with the mutex locked - it is unlocked before raising.
+*/
+- (void) _raiseWriterException
+{
+	NSException* exception;
+
+	if(writerException == nil)
+		return;
+
+	exception = [writerException autorelease];
+	writerException = nil;
+	pthread_mutex_unlock(&mutex);
+	[exception raise];
+}
+
+- (AdCheckpointSlot*) currentSlot
+{
+	AdCheckpointSlot* slot;
+
+	pthread_mutex_lock(&mutex);
+	if(!hasCurrentSlot)
+	{
+		while(usedSlots == numberOfSlots)
+			pthread_cond_wait(&slotCondition, &mutex);
+
+		usedSlots++;
+		hasCurrentSlot = YES;
+		slot = [slots objectAtIndex: (firstSlot + usedSlots - 1) % numberOfSlots];
+		[slot clear];
+	}
+	else
+		slot = [slots objectAtIndex: (firstSlot + usedSlots - 1) % numberOfSlots];
+
+	pthread_mutex_unlock(&mutex);
+
+	return slot;
+}
+
+- (void) submitCurrentSlot
+{
+	AdCheckpointSlot* slot;
+
+	//The slot is written on this thread.
+	//It is cleared even if writing fails so the queue can be reused.
+	if(isSynchronous)
+	{
+		if(!hasCurrentSlot)
+			return;
+
+		slot = [slots objectAtIndex: 0];
+		hasCurrentSlot = NO;
+		usedSlots = 0;
+		NS_DURING
+		{
+			[target performSelector: writeSelector withObject: slot];
+		}
+		NS_HANDLER
+		{
+			[slot clear];
+			[localException raise];
+		}
+		NS_ENDHANDLER
+		[slot clear];
+		return;
+	}
+
+	pthread_mutex_lock(&mutex);
+	if(hasCurrentSlot)
+	{
+		hasCurrentSlot = NO;
+		submittedSlots++;
+		numberSubmitted++;
+		pthread_cond_signal(&workCondition);
+	}
+
+	[self _raiseWriterException];
+	pthread_mutex_unlock(&mutex);
+}
+
+- (void) discardCurrentSlot
+{
+	pthread_mutex_lock(&mutex);
+	if(hasCurrentSlot)
+	{
+		hasCurrentSlot = NO;
+		usedSlots--;
+		pthread_cond_broadcast(&slotCondition);
+	}
+	pthread_mutex_unlock(&mutex);
+}
+
+- (void) synchronize
+{
+	if(isSynchronous)
+	{
+		[target performSelector: synchronizeSelector];
+		return;
+	}
+
+	pthread_mutex_lock(&mutex);
+	synchronizationRequested = YES;
+	synchronizationPoint = numberSubmitted;
+	pthread_cond_signal(&workCondition);
+	pthread_mutex_unlock(&mutex);
+}
+
+- (void) waitUntilEmpty
+{
+	pthread_mutex_lock(&mutex);
+	while(submittedSlots > 0 || synchronizationRequested)
+		pthread_cond_wait(&slotCondition, &mutex);
+
+	[self _raiseWriterException];
+	pthread_mutex_unlock(&mutex);
+}
+
+- (void) stop
+{
+	[self discardCurrentSlot];
+	pthread_mutex_lock(&mutex);
+	if(!isRunning)
+	{
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+
+	while(submittedSlots > 0 || synchronizationRequested)
+		pthread_cond_wait(&slotCondition, &mutex);
+
+	isRunning = NO;
+	pthread_cond_signal(&workCondition);
+	//Wait for the writer to exit so it no longer references the target
+	while(target != nil)
+		pthread_cond_wait(&slotCondition, &mutex);
+
+	if(writerException != nil)
+	{
+		NSWarnLog(@"Exception while writing checkpoints - %@", writerException);
+		[writerException release];
+		writerException = nil;
+	}
+	pthread_mutex_unlock(&mutex);
+	NSDebugLLog(@"AdCheckpointWriterQueue", @"Stopped writer thread");
+}
+
+/**
+Performs the target's write selector on \e slot or, if \e slot is nil, its
+synchronize selector. Exceptions are stored to be raised on the simulation thread.
+*/
+- (void) _performWriteOfSlot: (AdCheckpointSlot*) slot
+{
+	NSAutoreleasePool* pool;
+
+	pool = [NSAutoreleasePool new];
+	NS_DURING
+	{
+		if(slot != nil)
+			[target performSelector: writeSelector withObject: slot];
+		else
+			[target performSelector: synchronizeSelector];
+	}
+	NS_HANDLER
+	{
+		NSWarnLog(@"Caught exception on checkpoint writer thread - %@", localException);
+		pthread_mutex_lock(&mutex);
+		if(writerException == nil)
+			writerException = [localException retain];
+		pthread_mutex_unlock(&mutex);
+	}
+	NS_ENDHANDLER
+	[pool release];
+}
+
+- (void) _runWriter: (id) object
+{
+	BOOL synchronizeNow;
+	unsigned int point;
+	NSAutoreleasePool* pool;
+	AdCheckpointSlot* slot;
+
+	pool = [NSAutoreleasePool new];
+	pthread_mutex_lock(&mutex);
+	while(YES)
+	{
+		synchronizeNow = synchronizationRequested && 
+				(numberWritten == synchronizationPoint);
+		if(submittedSlots == 0 && !synchronizeNow)
+		{
+			if(!isRunning)
+				break;
+			
+			pthread_cond_wait(&workCondition, &mutex);
+			continue;
+		}
+
+		point = synchronizationPoint;
+		if(synchronizeNow)
+			slot = nil;
+		else
+			slot = [slots objectAtIndex: firstSlot];
+
+		//Write without holding the lock so the simulation
+		//thread can fill the other slots.
+		pthread_mutex_unlock(&mutex);
+		[self _performWriteOfSlot: slot];
+		pthread_mutex_lock(&mutex);
+		
+		if(slot != nil)
+		{
+			firstSlot = (firstSlot + 1) % numberOfSlots;
+			usedSlots--;
+			submittedSlots--;
+			numberWritten++;
+		}
+		else if(point == synchronizationPoint)
+			synchronizationRequested = NO;
+
+		pthread_cond_broadcast(&slotCondition);
+	}
+
+	target = nil;
+	pthread_cond_broadcast(&slotCondition);
+	pthread_mutex_unlock(&mutex);
+	[pool release];
+}
+
+@end
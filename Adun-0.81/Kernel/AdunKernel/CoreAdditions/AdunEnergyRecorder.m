@@ -0,0 +1,433 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#include "AdunKernel/AdunEnergyRecorder.h"
+#include "AdunKernel/AdunMolecularMechanicsForceField.h"
+
+/**
+Where the energy of a force field term is read from.
+Core terms are read through \e value. Custom terms are sent \e energy
+through the cached implementation. If both are unset the value is 0.
+*/
+typedef struct
+{
+	const double* value;
+	id term;
+	IMP energy;
+}
+AdEnergySource;
+
+typedef double (*AdEnergyMethod)(id, SEL);
+
+@interface AdEnergyRecord (PrivateBuffers)
+- (double*) _valuesForNextSystem: (int) number;
+@end
+
+@implementation AdEnergyRecord
+
+- (id) init
+{
+	if((self = [super init]))
+	{
+		numberOfSystems = 0;
+		capacity = 0;
+		iterationValue = nil;
+		values = NULL;
+		valuesCapacity = NULL;
+		systemNames = [NSMutableArray new];
+		columnHeaders = [NSMutableArray new];
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	int i;
+
+	for(i=0; i<capacity; i++)
+		free(values[i]);
+
+	free(values);
+	free(valuesCapacity);
+	[iterationValue release];
+	[systemNames release];
+	[columnHeaders release];
+	[super dealloc];
+}
+
+- (void) clear
+{
+	numberOfSystems = 0;
+	[iterationValue release];
+	iterationValue = nil;
+	[systemNames removeAllObjects];
+	[columnHeaders removeAllObjects];
+}
+
+/**
+Returns a buffer for \e number values of the next system, increasing the
+capacity of the receiver if necessary.
+*/
+- (double*) _valuesForNextSystem: (int) number
+{
+	int i;
+
+	if(numberOfSystems == capacity)
+	{
+		capacity = capacity == 0 ? 1 : 2*capacity;
+		values = (double**)realloc(values, capacity*sizeof(double*));
+		valuesCapacity = (int*)realloc(valuesCapacity, capacity*sizeof(int));
+		for(i=numberOfSystems; i<capacity; i++)
+		{
+			values[i] = NULL;
+			valuesCapacity[i] = 0;
+		}
+	}
+
+	if(valuesCapacity[numberOfSystems] < number)
+	{
+		free(values[numberOfSystems]);
+		values[numberOfSystems] = (double*)malloc(number*sizeof(double));
+		valuesCapacity[numberOfSystems] = number;
+	}
+
+	return values[numberOfSystems];
+}
+
+/**
+Adds a column filled with 0 for each header in \e headers which \e matrix does not have.
+*/
+- (void) _addMissingColumns: (NSArray*) headers toMatrix: (AdMutableDataMatrix*) matrix
+{
+	int i, noRows;
+	NSEnumerator* termEnum;
+	NSArray* matrixHeaders;
+	NSMutableArray* column;
+	NSString* term;
+
+	if([headers count] <= [matrix numberOfColumns])
+		return;
+
+	matrixHeaders = [matrix columnHeaders];
+	column = [NSMutableArray new];
+	termEnum = [headers objectEnumerator];
+	while((term = [termEnum nextObject]))
+	{
+		if([matrixHeaders containsObject: term])
+			continue;
+
+		noRows = [matrix numberOfRows];
+		for(i=0; i<noRows; i++)
+			[column addObject: [NSNumber numberWithDouble: 0.0]];
+
+		[matrix extendMatrixWithColumn: column];
+		[matrix setHeaderOfColumn: [matrix numberOfColumns] - 1
+			to: term];
+		[column removeAllObjects];
+	}
+
+	[column release];
+}
+
+- (void) addEnergiesToDataSet: (AdDataSet*) dataSet
+{
+	int i, j, numberOfValues;
+	unsigned int columnIndex, numberOfColumns;
+	double* row = NULL;
+	double* systemValues;
+	NSArray* headers;
+	NSMutableDictionary* state;
+	AdMutableDataMatrix* matrix;
+
+	for(i=0; i<numberOfSystems; i++)
+	{
+		matrix = (AdMutableDataMatrix*)[dataSet dataMatrixWithName:
+				[systemNames objectAtIndex: i]];
+		if(matrix == nil)
+			continue;
+
+		/*
+		 * Terms may have been added to or removed from the force-field
+		 * since the last checkpoint.
+		 * 1. Extra terms get a new column with the previous steps set to 0.
+		 * 2. Removed terms are set to 0 until they appear again.
+		 */
+		headers = [columnHeaders objectAtIndex: i];
+		systemValues = values[i];
+		numberOfValues = [headers count];
+		[self _addMissingColumns: headers toMatrix: matrix];
+
+		//The first row determines the column types. Adding it as objects
+		//keeps the iteration column the same type as the iteration value.
+		if([[matrix columnDataTypes] count] != [matrix numberOfColumns])
+		{
+			state = [NSMutableDictionary new];
+			if(iterationValue != nil)
+				[state setObject: iterationValue forKey: [headers objectAtIndex: 0]];
+			for(j=1; j<numberOfValues; j++)
+				[state setObject: [NSNumber numberWithDouble: systemValues[j]]
+					forKey: [headers objectAtIndex: j]];
+
+			[matrix extendMatrixWithColumnValues: state];
+			[state release];
+			continue;
+		}
+
+		numberOfColumns = [matrix numberOfColumns];
+		row = (double*)realloc(row, numberOfColumns*sizeof(double));
+		for(columnIndex=0; columnIndex<numberOfColumns; columnIndex++)
+			row[columnIndex] = 0.0;
+
+		for(j=0; j<numberOfValues; j++)
+		{
+			columnIndex = [matrix indexOfColumnWithHeader: [headers objectAtIndex: j]];
+			if(columnIndex != NSNotFound)
+				row[columnIndex] = systemValues[j];
+		}
+
+		[matrix extendMatrixWithDoubleValues: row];
+	}
+
+	free(row);
+}
+
+@end
+
+@interface AdEnergyRecorder (PrivateSourceRegistration)
+- (void) _registerSourcesOfSystem: (int) index;
+- (void) _freeSources;
+@end
+
+@implementation AdEnergyRecorder (PrivateSourceRegistration)
+
+/**
+Creates the column headers of the system at \e index and finds where
+the energy of each of its force field terms can be read from.
+*/
+- (void) _registerSourcesOfSystem: (int) index
+{
+	int i;
+	NSArray* terms;
+	NSMutableArray* headers;
+	NSString* termName;
+	AdEnergySource* systemSources;
+	id system, forceField, term;
+
+	system = [systems objectAtIndex: index];
+	forceField = [forceFields objectAtIndex: index];
+
+	headers = [NSMutableArray arrayWithObjects:
+			iterationHeader,
+			@"PotentialEnergy",
+			nil];
+	isDynamic[index] = [system respondsToSelector: @selector(kineticEnergy)];
+	if(isDynamic[index])
+	{
+		[headers addObject: @"KineticEnergy"];
+		[headers addObject: @"Temperature"];
+	}
+	[headers addObject: @"TotalEnergy"];
+
+	terms = [forceField allTerms];
+	[headers addObjectsFromArray: terms];
+	[columnHeaders replaceObjectAtIndex: index
+		withObject: [[headers copy] autorelease]];
+
+	free(sources[index]);
+	numberOfSources[index] = [terms count];
+	systemSources = (AdEnergySource*)calloc(numberOfSources[index] + 1, sizeof(AdEnergySource));
+	sources[index] = systemSources;
+	for(i=0; i<numberOfSources[index]; i++)
+	{
+		termName = [terms objectAtIndex: i];
+		systemSources[i].value = [forceField pointerToEnergyOfCoreTerm: termName];
+		if(systemSources[i].value != NULL)
+			continue;
+
+		term = [forceField customTermWithName: termName];
+		if(term != nil)
+		{
+			systemSources[i].term = term;
+			systemSources[i].energy = [term methodForSelector: @selector(energy)];
+		}
+		else
+			NSWarnLog(@"Unable to find the energy of term %@ of %@ - It will be recorded as 0",
+				termName, [system systemName]);
+	}
+
+	termsVersions[index] = [forceField termsVersion];
+}
+
+- (void) _freeSources
+{
+	int i;
+
+	for(i=0; i<numberOfSystems; i++)
+		free(sources[i]);
+
+	free(sources);
+	free(numberOfSources);
+	free(termsVersions);
+	free(isDynamic);
+}
+
+@end
+
+@implementation AdEnergyRecorder
+
+- (id) init
+{
+	return [self initWithSystems: nil
+		forceFields: nil
+		iterationHeader: nil];
+}
+
+- (id) initWithSystems: (NSArray*) systemArray
+	forceFields: (AdForceFieldCollection*) aForceFieldCollection
+	iterationHeader: (NSString*) aString
+{
+	int i;
+	NSEnumerator* systemEnum;
+	NSArray* forceFieldArray;
+	id system, forceField;
+
+	if((self = [super init]))
+	{
+		if(aString == nil)
+			aString = @"Iteration";
+
+		iterationHeader = [aString retain];
+		systems = [NSMutableArray new];
+		forceFields = [NSMutableArray new];
+		columnHeaders = [NSMutableArray new];
+
+		systemEnum = [systemArray objectEnumerator];
+		while((system = [systemEnum nextObject]))
+		{
+			//FIXME: Supports only one force field per system
+			forceFieldArray = [aForceFieldCollection forceFieldsForSystem: system];
+			if([forceFieldArray count] == 0)
+			{
+				NSWarnLog(@"No force fields operating on system %@", [system systemName]);
+				NSWarnLog(@"Skipping");
+				continue;
+			}
+
+			forceField = [forceFieldArray objectAtIndex: 0];
+			if(![forceField isKindOfClass: [AdMolecularMechanicsForceField class]])
+			{
+				NSWarnLog(@"Cannot record the energies of force field %@ for system %@",
+					forceField, [system systemName]);
+				NSWarnLog(@"Skipping");
+				continue;
+			}
+
+			[systems addObject: system];
+			[forceFields addObject: forceField];
+			[columnHeaders addObject: [NSNull null]];
+		}
+
+		numberOfSystems = [systems count];
+		isDynamic = (BOOL*)malloc((numberOfSystems + 1)*sizeof(BOOL));
+		termsVersions = (unsigned int*)malloc((numberOfSystems + 1)*sizeof(unsigned int));
+		numberOfSources = (int*)malloc((numberOfSystems + 1)*sizeof(int));
+		sources = (void**)calloc(numberOfSystems + 1, sizeof(void*));
+		for(i=0; i<numberOfSystems; i++)
+			[self _registerSourcesOfSystem: i];
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[self _freeSources];
+	[iterationHeader release];
+	[systems release];
+	[forceFields release];
+	[columnHeaders release];
+	[super dealloc];
+}
+
+- (NSArray*) columnHeadersForSystem: (id) system
+{
+	unsigned int index;
+
+	index = [systems indexOfObjectIdenticalTo: system];
+	if(index == NSNotFound)
+		return nil;
+
+	return [[[columnHeaders objectAtIndex: index] retain] autorelease];
+}
+
+- (void) recordEnergiesForIteration: (NSNumber*) value inRecord: (AdEnergyRecord*) record
+{
+	int i, j, count;
+	double potentialEnergy, kineticEnergy;
+	double* buffer;
+	AdEnergySource* systemSources;
+	SEL energySelector = @selector(energy);
+	id system, forceField;
+
+	[record clear];
+	record->iterationValue = [value retain];
+	for(i=0; i<numberOfSystems; i++)
+	{
+		system = [systems objectAtIndex: i];
+		forceField = [forceFields objectAtIndex: i];
+		if([forceField termsVersion] != termsVersions[i])
+			[self _registerSourcesOfSystem: i];
+
+		systemSources = (AdEnergySource*)sources[i];
+		buffer = [record _valuesForNextSystem: [[columnHeaders objectAtIndex: i] count]];
+
+		count = 0;
+		buffer[count++] = [value doubleValue];
+		potentialEnergy = [forceField totalEnergy];
+		buffer[count++] = potentialEnergy;
+		if(isDynamic[i])
+		{
+			kineticEnergy = [system kineticEnergy];
+			buffer[count++] = kineticEnergy;
+			buffer[count++] = [system temperature];
+			potentialEnergy += kineticEnergy;
+		}
+		buffer[count++] = potentialEnergy;
+
+		for(j=0; j<numberOfSources[i]; j++)
+		{
+			if(systemSources[j].value != NULL)
+				buffer[count++] = *systemSources[j].value;
+			else if(systemSources[j].term != nil)
+				buffer[count++] = ((AdEnergyMethod)systemSources[j].energy)
+							(systemSources[j].term, energySelector);
+			else
+				buffer[count++] = 0.0;
+		}
+
+		[record->systemNames addObject: [system systemName]];
+		[record->columnHeaders addObject: [columnHeaders objectAtIndex: i]];
+		record->numberOfSystems++;
+	}
+}
+
+@end
@@ -1,5 +1,113 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
 #include "AdunKernel/AdunFileSystemSimulationStorage.h"
 
+//The number of checkpoints prefetched when checkpoints are read in order
+#define SEQUENTIAL_PREFETCH_WINDOW 64
+
+/**
+A read only mapping of a trajectory archive.
+The mapping is removed when the object is deallocated.
+*/
+@interface AdTrajectoryMapping: NSObject
+{
+	void* bytes;
+	unsigned long long length;
+}
+- (id) initWithBytes: (void*) mappedBytes length: (unsigned long long) mappedLength;
+- (unsigned char*) bytes;
+- (unsigned long long) length;
+@end
+
+/**
+An NSData object whose bytes lie in an AdTrajectoryMapping.
+Each instance retains its mapping so the mapping stays valid until
+all the checkpoints that refer to it have been released.
+*/
+@interface AdTrajectoryMapData: NSData
+{
+	AdTrajectoryMapping* mapping;
+	const void* start;
+	unsigned int size;
+}
+- (id) initWithMapping: (AdTrajectoryMapping*) aMapping
+	offset: (unsigned long long) offset
+	length: (unsigned int) length;
+@end
+
+@implementation AdTrajectoryMapping
+
+- (id) initWithBytes: (void*) mappedBytes length: (unsigned long long) mappedLength
+{
+	if((self = [super init]))
+	{
+		bytes = mappedBytes;
+		length = mappedLength;
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	munmap(bytes, length);
+	[super dealloc];
+}
+
+- (unsigned char*) bytes
+{
+	return bytes;
+}
+
+- (unsigned long long) length
+{
+	return length;
+}
+
+@end
+
+@implementation AdTrajectoryMapData
+
+- (id) initWithMapping: (AdTrajectoryMapping*) aMapping
+	offset: (unsigned long long) offset
+	length: (unsigned int) length
+{
+	if((self = [super init]))
+	{
+		mapping = [aMapping retain];
+		start = [aMapping bytes] + offset;
+		size = length;
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[mapping release];
+	[super dealloc];
+}
+
+- (const void*) bytes
+{
+	return start;
+}
+
+- (unsigned int) length
+{
+	return size;
+}
+
+- (id) copyWithZone: (NSZone*) zone
+{
+	return [self retain];
+}
+
+@end
+
 /**
 This category contains methods for updating a pre 0.74 simulation data
 directory to enable caching of its trajectory data. Caching provides
@@ -32,7 +140,7 @@ frame. The second is the offset in the trajectory archive where it begins.
 	informationMatrix = [[AdMutableDataMatrix alloc]
 				initWithNumberOfColumns: 2
 				columnHeaders: [NSArray arrayWithObjects: @"Size", @"Offset", nil]
-				columnDataTypes: [NSArray arrayWithObjects: @"int", @"int", nil]];
+				columnDataTypes: [NSArray arrayWithObjects: @"int", @"double", nil]];
 	
 	if(![fileManager fileExistsAtPath: trajectoryPath])
 		return nil;
@@ -181,19 +289,139 @@ BOOL AdCheckStorage(NSString* storagePath, NSError** error)
 + (void) initialize
 {
 	[[NSUserDefaults standardUserDefaults] registerDefaults:
-		[NSDictionary dictionaryWithObject: [NSNumber numberWithInt: 100]
-			forKey: @"CacheLimit"]];
+		[NSDictionary dictionaryWithObjectsAndKeys: 
+			[NSNumber numberWithInt: 100], @"CacheLimit",
+			@"Float64", @"TrajectoryFrameEncoding",
+			[NSNumber numberWithDouble: 1000.0], @"TrajectoryCompressionPrecision",
+			nil]];
+}
+
+/**
+Advises the kernel that the bytes from \e start to \e end of the trajectory map
+will be needed.
+*/
+- (void) _adviseTrajectoryBytesFrom: (unsigned long long) start to: (unsigned long long) end
+{
+#ifdef MADV_WILLNEED
+	unsigned long long pageSize;
+
+	pageSize = sysconf(_SC_PAGESIZE);
+	start -= start % pageSize;
+	if(end > trajectoryMapLength)
+		end = trajectoryMapLength;
+
+	if(end > start)
+		madvise(trajectoryMap + start, end - start, MADV_WILLNEED);
+#endif	
+}
+
+/**
+Copies the offset and size of each checkpoint from trajectoryInfo
+to frameIndex.
+*/
+- (void) _buildFrameIndex
+{
+	int i, offsetColumn, sizeColumn;
+	NSArray* headers;
+
+	free(frameIndex);
+	frameIndex = NULL;
+	numberTrajectoryCheckpoints = [trajectoryInfo numberOfRows];
+	if(numberTrajectoryCheckpoints == 0)
+		return;
+
+	headers = [trajectoryInfo columnHeaders];
+	offsetColumn = [headers indexOfObject: @"Offset"];
+	sizeColumn = [headers indexOfObject: @"Size"];
+	frameIndex = malloc(2*numberTrajectoryCheckpoints*sizeof(unsigned long long));
+	for(i=0; i<numberTrajectoryCheckpoints; i++)
+	{
+		frameIndex[2*i] = [[trajectoryInfo elementAtRow: i
+					column: offsetColumn] unsignedLongLongValue];
+		frameIndex[2*i + 1] = [[trajectoryInfo elementAtRow: i
+					column: sizeColumn] unsignedLongLongValue];
+	}
+}
+
+/**
+Maps the trajectory archive. If the archive is already mapped and has grown
+a new mapping is created and the old one released. The old mapping is removed
+once no checkpoint returned from it remains.
+On failure trajectoryMap is NULL and checkpoints are read using trajectoryHandle.
+*/
+- (void) _mapTrajectory
+{
+	int descriptor;
+	void* map;
+	struct stat fileStatus;
+
+	descriptor = open([trajectoryPath fileSystemRepresentation], O_RDONLY);
+	if(descriptor == -1)
+	{
+		NSWarnLog(@"Unable to open %@ for mapping - %s", trajectoryPath, strerror(errno));
+		return;
+	}
+
+	if(fstat(descriptor, &fileStatus) == -1 || (unsigned long long)fileStatus.st_size == trajectoryMapLength 
+		|| fileStatus.st_size == 0)
+	{
+		close(descriptor);
+		return;
+	}
+
+	map = mmap(NULL, fileStatus.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if(map == MAP_FAILED)
+	{
+		NSWarnLog(@"Unable to map %@ - %s. Checkpoints will be read from the file", 
+			trajectoryPath, strerror(errno));
+		return;
+	}
+
+	//Checkpoints returned previously retain the old mapping
+	[trajectoryMapping release];
+	trajectoryMapping = [[AdTrajectoryMapping alloc]
+				initWithBytes: map
+				length: fileStatus.st_size];
+	trajectoryMap = map;
+	trajectoryMapLength = fileStatus.st_size;
+	prefetchLimit = 0;
 }
 
 - (NSData*) _loadTrajectoryFrame: (int) frameNumber
 {
 	unsigned int index;
-	unsigned long frameSize, frameStart;
+	unsigned long long frameSize, frameStart;
 	NSNumber* number;
 	NSData* data;
 
-	if(frameNumber > numberTrajectoryCheckpoints)
-		return nil;
+	if(frameNumber < 0 || frameNumber >= numberTrajectoryCheckpoints)
+		[NSException raise: NSRangeException
+			format: @"Trajectory checkpoint %d does not exist (%d available)",
+			frameNumber, numberTrajectoryCheckpoints];
+
+	frameStart = frameIndex[2*frameNumber];
+	frameSize = frameIndex[2*frameNumber + 1];
+	if(trajectoryMap != NULL && (frameStart + frameSize) <= trajectoryMapLength)
+	{
+		//If the checkpoints are being read in order prefetch the next ones
+		if(frameNumber == lastLoadedFrame + 1 && frameNumber >= prefetchLimit)
+		{
+			index = frameNumber + SEQUENTIAL_PREFETCH_WINDOW;
+			if(index > (unsigned int)numberTrajectoryCheckpoints)
+				index = numberTrajectoryCheckpoints;
+
+			[self _adviseTrajectoryBytesFrom: frameStart
+				to: frameIndex[2*(index - 1)] + frameIndex[2*(index - 1) + 1]];
+			prefetchLimit = frameNumber + SEQUENTIAL_PREFETCH_WINDOW/2;
+		}	
+
+		lastLoadedFrame = frameNumber;
+		return [[[AdTrajectoryMapData alloc]
+				initWithMapping: trajectoryMapping
+				offset: frameStart
+				length: frameSize] autorelease];
+	}
 
 	//Check if the frame is in cache
 	number = [[NSNumber alloc] initWithInt: frameNumber];
@@ -205,10 +433,6 @@ BOOL AdCheckStorage(NSString* storagePath, NSError** error)
 	else
 	{
 		//Load frame
-		frameStart = [[trajectoryInfo elementAtRow: frameNumber
-				       ofColumnWithHeader: @"Offset"] longValue];
-		frameSize = [[trajectoryInfo elementAtRow: frameNumber
-				      ofColumnWithHeader: @"Size"] longValue];
 		[trajectoryHandle seekToFileOffset: frameStart];
 		data = [trajectoryHandle readDataOfLength:frameSize];
 		[trajectoryCache insertObject: data atIndex: 0];
@@ -223,13 +447,38 @@ BOOL AdCheckStorage(NSString* storagePath, NSError** error)
 	}
 	
 	[number release];
+	lastLoadedFrame = frameNumber;
 	return data;
 }
 
+/**
+Returns a copy of \e matrix whose Offset column has the double data type.
+*/
+- (AdMutableDataMatrix*) _trajectoryInfoWithDoubleOffsets: (AdDataMatrix*) matrix
+{
+	unsigned int i;
+	AdMutableDataMatrix* result;
+
+	result = [[AdMutableDataMatrix alloc]
+			initWithNumberOfColumns: 2
+			columnHeaders: [NSArray arrayWithObjects: @"Size", @"Offset", nil]
+			columnDataTypes: [NSArray arrayWithObjects: @"int", @"double", nil]];
+	for(i=0; i<[matrix numberOfRows]; i++)
+		[result extendMatrixWithRow: 
+			[NSArray arrayWithObjects: 
+				[matrix elementAtRow: i ofColumnWithHeader: @"Size"],
+				[matrix elementAtRow: i ofColumnWithHeader: @"Offset"],
+				nil]];
+
+	return [result autorelease];
+}
+
 - (void) _loadTrajectoryInfo
 {
 	//Check if the trajectory information archive exists -
 	//if it doesnt we create it.
+	//Only data written by very old versions lacks the archive, so 
+	//createTrajectoryInformationMatrix only handles XML checkpoints.
 	
 	if(![fileManager fileExistsAtPath: trajectoryInfoPath])
 		trajectoryInfo = [self createTrajectoryInformationMatrix];
@@ -242,7 +491,13 @@ BOOL AdCheckStorage(NSString* storagePath, NSError** error)
 	if(![trajectoryInfo isKindOfClass: [AdMutableDataMatrix class]])
 		trajectoryInfo = [[trajectoryInfo mutableCopy] autorelease];
 	
+	//Earlier versions stored the offsets in an int column which truncates
+	//offsets beyond 2GB. Doubles represent offsets up to 2^53 exactly.
+	if([[trajectoryInfo dataTypeForColumnWithHeader: @"Offset"] isEqual: @"int"])
+		trajectoryInfo = [self _trajectoryInfoWithDoubleOffsets: trajectoryInfo];
+	
 	[trajectoryInfo retain];
+	[self _buildFrameIndex];
 	numberTrajectoryCheckpoints = [trajectoryInfo numberOfRows];
 }
 
@@ -415,6 +670,12 @@ BOOL AdCheckStorage(NSString* storagePath, NSError** error)
 
 		trajectoryCache = [NSMutableArray new];
 		cacheFrames = [NSMutableArray new];
+		trajectoryMap = NULL;
+		trajectoryMapLength = 0;
+		trajectoryMapping = nil;
+		frameIndex = NULL;
+		lastLoadedFrame = -1;
+		prefetchLimit = 0;
 		trajectoryHandle = nil;
 		energyHandle = nil;
 	
@@ -439,7 +700,7 @@ BOOL AdCheckStorage(NSString* storagePath, NSError** error)
 				trajectoryInfo = [[AdMutableDataMatrix alloc]
 							initWithNumberOfColumns: 2
 							columnHeaders: [NSArray arrayWithObjects: @"Size", @"Offset", nil]
-							columnDataTypes: [NSArray arrayWithObjects: @"int", @"int", nil]];
+							columnDataTypes: [NSArray arrayWithObjects: @"int", @"double", nil]];
 				[NSKeyedArchiver archiveRootObject: trajectoryInfo 
 					toFile: trajectoryInfoPath];			
 			}
@@ -458,6 +719,7 @@ BOOL AdCheckStorage(NSString* storagePath, NSError** error)
 				trajectoryHandle = [NSFileHandle fileHandleForReadingAtPath: trajectoryPath];
 				[trajectoryHandle retain];
 				[self _loadTrajectoryInfo];
+				[self _mapTrajectory];
 				[self _countTopologyCheckpoints];
 			}	
 		}	
@@ -489,6 +751,8 @@ BOOL AdCheckStorage(NSString* storagePath, NSError** error)
 	[trajectoryCache release];
 	[cacheFrames release];
 	[trajectoryInfo release];
+	[trajectoryMapping release];
+	free(frameIndex);
 	[dataError release];
 	[super dealloc];
 }
@@ -563,6 +827,32 @@ BOOL AdCheckStorage(NSString* storagePath, NSError** error)
 	return [self _loadTrajectoryFrame: number];
 }
 
+- (void) prefetchTrajectoryCheckpointsInRange: (NSRange) aRange stride: (unsigned int) stride
+{
+	unsigned int i, last;
+
+	if(NSMaxRange(aRange) > (unsigned int)numberTrajectoryCheckpoints)
+		[NSException raise: NSRangeException
+			format: @"Range %@ exceeds the number of trajectory checkpoints (%d)",
+			NSStringFromRange(aRange), numberTrajectoryCheckpoints];
+
+	if(trajectoryMap == NULL || aRange.length == 0)
+		return;
+
+	if(stride <= 1)
+	{
+		last = NSMaxRange(aRange) - 1;
+		[self _adviseTrajectoryBytesFrom: frameIndex[2*aRange.location]
+			to: frameIndex[2*last] + frameIndex[2*last + 1]];
+	}
+	else
+	{
+		for(i=aRange.location; i<NSMaxRange(aRange); i += stride)
+			[self _adviseTrajectoryBytesFrom: frameIndex[2*i]
+				to: frameIndex[2*i] + frameIndex[2*i + 1]];
+	}
+}
+
 - (NSData*) topologyCheckpoint: (int) number
 {
 	NSString* path;
@@ -674,15 +964,25 @@ Returns the storage mode.
 
 - (void) addTrajectoryCheckpoint: (NSData*) data
 {
+	unsigned long long offset;
 	NSArray *row;
 
 	if(storageMode == AdSimulationStorageReadMode)
 		[NSException raise: NSInternalInconsistencyException
 			format: @"Cannot write to a data store in AdSimulationStorageReadMode"];
 	
+	//Binary checkpoints are aligned so they can be accessed in place when mapped.
+	offset = [trajectoryHandle offsetInFile];
+	if(AdIsBinaryTrajectoryFrame([data bytes], [data length]) && (offset % 8) != 0)
+	{
+		[trajectoryHandle writeData: 
+			[NSMutableData dataWithLength: 8 - (offset % 8)]];
+		offset = [trajectoryHandle offsetInFile];
+	}	
+
 	row = [[NSArray alloc] initWithObjects: 
-			[NSNumber numberWithInt: [data length]],
-			[NSNumber numberWithInt: [trajectoryHandle offsetInFile]],
+			[NSNumber numberWithUnsignedInt: [data length]],
+			[NSNumber numberWithUnsignedLongLong: offset],
 			nil];
 	[trajectoryHandle writeData: data];
 	[trajectoryInfo extendMatrixWithRow: row];
@@ -696,7 +996,8 @@ Returns the storage mode.
 
 - (void) removeTrajectoryCheckpoints: (int) number;
 {
-	int i, start, size, truncateSize;
+	int start;
+	unsigned long long offset;
 
 	if(storageMode == AdSimulationStorageReadMode)
 		[NSException raise: NSInternalInconsistencyException
@@ -709,17 +1010,20 @@ Returns the storage mode.
 			number,
 			numberTrajectoryCheckpoints];
 
+	if(number == 0)
+		return;
+
+	//Checkpoints may be separated by padding so truncate 
+	//at the start of the first one removed.
 	start = numberTrajectoryCheckpoints - number;
-	for(truncateSize = 0, i=start; i<numberTrajectoryCheckpoints; i++)
-		truncateSize += [[trajectoryInfo elementAtRow: start ofColumnWithHeader: @"Size"] intValue];
+	offset = [[trajectoryInfo elementAtRow: start ofColumnWithHeader: @"Offset"] unsignedLongLongValue];
 
 	NSDebugLLog(@"AdFileSystemSimulationStorage",
 		@"Removing %d checkpoints from %d", number, numberTrajectoryCheckpoints);
 	[trajectoryHandle synchronizeFile];
-	size = [trajectoryHandle offsetInFile];
 	NSDebugLLog(@"AdFileSystemSimulationStorage",
-		@"Corresponds to %d bytes from trajectory of size %d", truncateSize, size);
-	[trajectoryHandle truncateFileAtOffset: (size - truncateSize)];
+		@"Truncating trajectory of size %llu at %llu", [trajectoryHandle offsetInFile], offset);
+	[trajectoryHandle truncateFileAtOffset: offset];
 	[trajectoryInfo removeRowsInRange:
 		NSMakeRange([trajectoryInfo numberOfRows] - number, number)];
 	[trajectoryHandle synchronizeFile];
@@ -850,7 +1154,8 @@ Raises an exception if the mode is AdSimulationStorageReadMode
 	[trajectoryInfo release];
 	trajectoryInfo = [NSKeyedUnarchiver unarchiveObjectWithFile: trajectoryInfoPath];
 	[trajectoryInfo retain];
-	numberTrajectoryCheckpoints = [trajectoryInfo numberOfRows];		
+	[self _buildFrameIndex];
+	[self _mapTrajectory];
 }
 
 @end
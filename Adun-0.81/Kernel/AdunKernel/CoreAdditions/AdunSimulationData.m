@@ -290,24 +290,14 @@ Creation
 - (id) mementoForSystem: (id) system inTrajectoryCheckpoint: (unsigned int) number
 {
 	NSData* archive;
-	NSKeyedUnarchiver* unarchiver;
-	NSString* name;
-	id memento;
 
 	if(number >= [self numberTrajectoryCheckpoints])
 		[NSException raise: NSInvalidArgumentException
 			format: @"Requested checkpoint (%d) is greater than the number of available checkpoints (%d)",
 				number, [self numberTrajectoryCheckpoints]];
 
-	name = [system systemName];
 	archive = [dataStorage trajectoryCheckpoint: number];
-	unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData: archive];
-	memento = [unarchiver decodeObjectForKey: name];
-	[[memento retain] autorelease];
-	[unarchiver finishDecoding];
-	[unarchiver release];
-
-	return memento;
+	return AdSystemMementoFromTrajectoryCheckpoint(archive, [system systemName]);
 }
 
 - (NSString*) description
@@ -495,6 +485,11 @@ Deprecated
 @end
 
 
+@interface AdSimulationDataWriter (PrivateCheckpointWriting)
+- (void) _writeCheckpointSlot: (AdCheckpointSlot*) slot;
+- (void) _synchToStore;
+@end
+
 @implementation AdSimulationDataWriter
 
 - (void) _createStateMatrices
@@ -594,9 +589,6 @@ Deprecated
 					inputReferences: nil
 					dataGenerator: [NSBundle mainBundle]];
 			topologyData = [NSMutableDictionary new];
-			energyData = [NSMutableDictionary new];
-			//This is allocated on each trajectory checkpoint request
-			trajectoryData = nil;
 			dataStorage = [aDataStore retain];	
 			headers = [NSArray arrayWithObjects: 
 					@"Energy",
@@ -619,9 +611,7 @@ Deprecated
 		
 			dataStorage = [aDataStore retain];
 			topologyData = [NSMutableDictionary new];
-			energyData = [NSMutableDictionary new];
 			forceFieldCollection = nil;
-			trajectoryData = nil;
 			
 			//Create a read-mode storage and an AdSimulationData instance
 			//to read the stored data we require.
@@ -674,6 +664,12 @@ Deprecated
 			[NSException raise: NSInternalInconsistencyException
 				format: @"You can only write data to a store in AdSimulationStorageWriteMode or AdSimulationStorageAppendMode"];
 		
+		//The energy recorder is created when the first energy checkpoint is requested
+		energyRecorder = nil;
+		writerQueue = [[AdCheckpointWriterQueue alloc]
+				initWithTarget: self
+				writeSelector: @selector(_writeCheckpointSlot:)
+				synchronizeSelector: @selector(_synchToStore)];
 	}
 
 	return self;
@@ -681,12 +677,15 @@ Deprecated
 
 - (void) dealloc
 {
-	[self synchToStore];
+	//Any frame still being filled is discarded
+	//as it would be in the synchronous case.
+	[writerQueue stop];
+	[writerQueue release];
+	[self _synchToStore];
 	[iterationValue release];
 	[iterationHeader release];
 	[topologyData release];
-	[energyData release];
-	[trajectoryData release];
+	[energyRecorder release];
 	[stateData release];
 	[dataStorage release];
 	[frames release];
@@ -730,8 +729,11 @@ Deprecated
 
 - (void) setForceFields: (AdForceFieldCollection*) aForceFieldCollection
 {
+	[writerQueue waitUntilEmpty];
 	[forceFieldCollection release];
 	forceFieldCollection = [aForceFieldCollection retain];
+	[energyRecorder release];
+	energyRecorder = nil;
 	if(systemCollection != nil)
 		[self _createStateMatrices];
 }
@@ -777,81 +779,21 @@ Deprecated
 	return frameOpen;
 }
 
-- (void) _addEnergyCheckpoint
+/**
+Writes the data collected for a frame to the store.
+Performed on the writer thread when checkpoints are written in the background.
+*/
+- (void) _writeCheckpointSlot: (AdCheckpointSlot*) slot
 {
-	NSEnumerator* dataEnum;
-	NSString* systemName;
-	id state, stateMatrix;
-	//For column addition
-	int i, noRows;
-	NSEnumerator* termEnum;
-	NSArray* headers;
-	NSMutableArray* newTerms, *column;
-	NSString* term;
-
-	dataEnum = [energyData keyEnumerator];
-	while((systemName = [dataEnum nextObject]))
-	{
-		stateMatrix = [stateData dataMatrixWithName: 
-				systemName];
-		state = [energyData objectForKey: systemName];	
-		
-		/*
-		 * We need to check that the number of energy terms returned
-		 * for the system is the same as the number of terms in the matrix.
-		 * They could differ if extra terms were added or removed to the force-field
-		 * operating on the system since the last checkpoint.
-		 *
-		 * Two cases:
-		 * 1. In the case of an extra term we must add an extra column to the matrix and
-		 * fill the previous steps where the term didn't exist with 0's.
-		 * 2. In the case where a term is removed we simply put a zero for its value
-		 * until it appears again.
-		 */
-		
-		if([[state allKeys] count] > [stateMatrix numberOfColumns])
-		{
-			//Find the new keys
-			termEnum = [state keyEnumerator];
-			headers = [stateMatrix columnHeaders];
-			newTerms = [NSMutableArray array];
-			while(term = [termEnum nextObject])
-			{
-				if(![headers containsObject: term])
-					[newTerms addObject: term];
-			}
-			
-			column = [NSMutableArray new];
-			termEnum = [newTerms objectEnumerator];
-			while(term = [termEnum nextObject])
-			{
-				//Create a column for this term
-			
-				noRows = [stateMatrix numberOfRows];
-				for(i=0; i<noRows; i++)
-					[column addObject: [NSNumber numberWithDouble: 0.0]];
-					
-				[stateMatrix extendMatrixWithColumn: column];
-				[stateMatrix setHeaderOfColumn: [stateMatrix numberOfColumns] - 1 
-					to: term];
-				
-				[column removeAllObjects];
-			}
-			
-			[column release];
-		}
-		
-		[stateMatrix extendMatrixWithColumnValues: state];
-	 }		
+	//The energies are only recorded if there are force fields
+	[frames extendMatrixWithRow: 
+		[slot writeToStorage: dataStorage
+			stateData: (forceFieldCollection == nil) ? nil : stateData]];
 }
 
 - (void) closeFrame
 {
-	NSMutableData* data;
-	NSMutableArray* checkpointed = [NSMutableArray new];
-	NSKeyedArchiver* archiver;
-	NSEnumerator* systemEnum;
-	id systemName, topology;
+	AdCheckpointSlot* slot;
 
 	if(!frameOpen)
 		return;
@@ -862,74 +804,25 @@ Deprecated
 	
 	NSDebugLLog(@"AdSimulationDataWriter",
 		@"Closing frame %d", lastFrame);
-	if(trajectoryCheckpoint)
-	{
-		[dataStorage addTrajectoryCheckpoint: trajectoryData];
-		NSDebugLLog(@"AdSimulationDataWriter",
-			@"Checkpointed %d bytes of trajectory data",
-			[trajectoryData length]);
-		[checkpointed addObject: [NSNumber numberWithInt: 1]];
-		NSDebugLLog(@"AdSimulationDataWriter",
-			    @"Done ");
-	}
-	else
-		[checkpointed addObject: [NSNumber numberWithInt: 0]];
 
-	if(energyCheckpoint)
-	{
-		
-		if(forceFieldCollection == nil)
-			[checkpointed addObject: [NSNumber numberWithBool: NO]];
-		else
-		{
-			NSDebugLLog(@"AdSimulationDataWriter",
-				    @"Checkpointing energies");
-			[self _addEnergyCheckpoint];
-			[checkpointed addObject: [NSNumber numberWithInt: 1]];
-			[energyData removeAllObjects];
-			NSDebugLLog(@"AdSimulationDataWriter",
-				    @"Done ");
-		}
-	}
-	else
-		[checkpointed addObject: [NSNumber numberWithInt: 0]];
-
-	if(topologyCheckpoint)
-	{
-		data = [NSMutableData new];
-		archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData: data];
-		[archiver setOutputFormat: NSPropertyListXMLFormat_v1_0];
-		systemEnum = [topologyData keyEnumerator];
-		while((systemName = [systemEnum nextObject]))
-		{
-			//We assume the data source has been synched
-			//to the current configuration
-			NSDebugLLog(@"AdSimulationDataWriter",
-				@"Checkpointing topology of %@", systemName);
-			topology = [topologyData objectForKey: systemName];
-			[archiver encodeObject: topology
-				forKey: systemName];
-		}
-		
-		[archiver finishEncoding];
-		[archiver release];
-		[dataStorage addTopologyCheckpoint: data];
-		NSDebugLLog(@"AdSimulationDataWriter",
-			@"Checkpointed %d bytes of topology data", [data length]);
-		[data release];
-		[checkpointed addObject: [NSNumber numberWithInt: 1]];
-		[topologyData removeAllObjects];
-	}
-	else
-		[checkpointed addObject: [NSNumber numberWithInt: 0]];
+	//The collected topologies are handed to the slot.
+	//Any trajectory data and energies were placed there by 
+	//addTrajectoryCheckpoint and addEnergyCheckpoint.
+	slot = [writerQueue currentSlot];
+	
+	slot->trajectoryCheckpoint = trajectoryCheckpoint;
+	slot->energyCheckpoint = energyCheckpoint;
+	slot->topologyCheckpoint = topologyCheckpoint;
+	[slot setTopologyData: topologyData];
+	[topologyData release];
+	topologyData = [NSMutableDictionary new];
 
-	[frames extendMatrixWithRow: checkpointed];
+	[writerQueue submitCurrentSlot];
 
 	NSDebugLLog(@"AdSimulationDataWriter",
 		    @"Cleaning up");
 
 	//Set for next frame
-	[checkpointed release];
 	energyCheckpoint = NO;
 	trajectoryCheckpoint = NO;
 	topologyCheckpoint = NO;
@@ -953,6 +846,7 @@ The first frame should indicate a checkpoint for everything
 	if(lastFrame == -1)
 		return lastFrame;
 
+	[writerQueue waitUntilEmpty];
 	numberOfRows = [frames numberOfRows];
 	for(i=numberOfRows-1; i>=0; i--)
 		if([[frames elementAtRow: i ofColumnWithHeader: column] boolValue])
@@ -1007,41 +901,18 @@ The first frame should indicate a checkpoint for everything
 
 - (void) addTrajectoryCheckpoint
 {
-	NSKeyedArchiver* archiver;
-	NSEnumerator* systemEnum;
-	id system, state;
-	
 	trajectoryCheckpoint = YES;
 
-	//Release previous trajectory checkpoint
-	[trajectoryData release];
-	
-	//Checkpoint current trajectory
-	
-	trajectoryData = [NSMutableData new];
-	archiver = [[NSKeyedArchiver alloc] 
-			initForWritingWithMutableData: trajectoryData];
-	[archiver setOutputFormat: NSPropertyListXMLFormat_v1_0];
-	systemEnum = [[systemCollection fullSystems] objectEnumerator];
-	while((system = [systemEnum nextObject]))
-	{
-		state = [system captureState];
-		[archiver encodeObject: state 
-			forKey: [system systemName]];
-	}	
-
-	[archiver finishEncoding];
-	[archiver release];
+	//Checkpoint current trajectory replacing any previous checkpoint.
+	//When writing in the background only the state is copied here.
+	[[writerQueue currentSlot] 
+		captureStateOfSystems: [systemCollection fullSystems]];
 }
 
 - (void) addEnergyCheckpoint
 {
-	double potentialEnergy, totalEnergy, kineticEnergy;
-	NSEnumerator* systemEnum;
-	NSMutableArray* stateTerms = [NSMutableArray new];
-	AdMolecularMechanicsForceField* systemForceField;
-	id system, state;
-	
+	AdCheckpointSlot* slot;
+
 	energyCheckpoint = YES;
 	
 	//Check that a forceFieldCollection is available before continuing
@@ -1051,66 +922,18 @@ The first frame should indicate a checkpoint for everything
 		return;
 	}	
 
-	//Remove last energy checkpoint
-	[energyData removeAllObjects];
-		
-	//Checkpoint new energies
-	//Go through each system and add the relevant data to a dictionary of (TermName:TermValue pairs). 
-	//Each dictionary is then added to energyData dictionary.
-	//When the frame is close the arrays are added to the state matrix for each system (in closeFrame:)
-	state = [NSMutableArray new];
-	systemEnum = [[systemCollection allSystems] objectEnumerator];
-	while((system = [systemEnum nextObject]))
-	{
-		//FIXME: Only one force field per system supported
-		systemForceField = [[forceFieldCollection forceFieldsForSystem: system]
-					objectAtIndex: 0];
-		[state addObject: iterationValue];
-		[stateTerms addObject: iterationHeader];
-		
-		potentialEnergy = [systemForceField totalEnergy];
-		[state addObject:
-			[NSNumber numberWithDouble: potentialEnergy]];
-		[stateTerms addObject: @"PotentialEnergy"];	
-
-		totalEnergy = potentialEnergy;
-		if([system respondsToSelector: @selector(kineticEnergy)])
-		{
-			kineticEnergy =  [system kineticEnergy];
-			totalEnergy += kineticEnergy;
-			[state addObject:
-				[NSNumber numberWithDouble: kineticEnergy]];
-			[stateTerms addObject: @"KineticEnergy"];
-				
-			[state addObject:
-				[NSNumber numberWithDouble: [system temperature]]];
-			[stateTerms addObject: @"Temperature"];		
-		}
-				
-		[state addObject:
-			[NSNumber numberWithDouble: totalEnergy]];
-		[stateTerms addObject: @"TotalEnergy"];	
-			
-		[state addObjectsFromArray: 
-			[systemForceField allEnergies]];
-		[stateTerms addObjectsFromArray: [systemForceField allTerms]];	
-			
-		NSDebugLLog(@"AdSimulationDataWriter", 
-			@"State %@. State Terms %@", state, stateTerms);	
-			
-		//Add the array containing the checkpointed energies
-		//to the energyData dictionary
-		[energyData setObject: 
-				[NSDictionary dictionaryWithObjects: state 
-					forKeys: stateTerms]
-			forKey: [system systemName]];
-			
-		[state removeAllObjects];
-		[stateTerms removeAllObjects];	
-	 }	
-	 
-	[stateTerms release];
-	[state release];		
+	if(energyRecorder == nil)
+		energyRecorder = [[AdEnergyRecorder alloc]
+					initWithSystems: [systemCollection allSystems]
+					forceFields: forceFieldCollection
+					iterationHeader: iterationHeader];
+
+	//The energies are recorded in the slot for the current frame replacing
+	//any previous energy checkpoint. They are added to the state matrix
+	//of each system when the slot is written.
+	slot = [writerQueue currentSlot];
+	[energyRecorder recordEnergiesForIteration: iterationValue
+		inRecord: slot->energyRecord];
 }
 
 - (void) rollBackToFrame: (unsigned int) value
@@ -1123,6 +946,10 @@ The first frame should indicate a checkpoint for everything
 	NSIndexSet* indexSet;
 	AdMutableDataMatrix* matrix;
 
+	//Wait for the closed frames to be written.
+	//Data collected for the open frame is discarded below.
+	[writerQueue discardCurrentSlot];
+	[writerQueue waitUntilEmpty];
 	if(value > [frames numberOfRows])
 		[NSException raise: NSRangeException
 			format: @"(%@) %d is out of range %d",
@@ -1190,17 +1017,25 @@ The first frame should indicate a checkpoint for everything
 		trajectoryCheckpoint = NO;
 		topologyCheckpoint = NO;
 		[topologyData removeAllObjects];
-		[energyData removeAllObjects];
-		[trajectoryData release];
-		trajectoryData = nil;
 		frameOpen = NO;
 	}
 
 	lastFrame = value;
-	[self synchToStore];
+	[self _synchToStore];
 }
 
 - (void) synchToStore
+{
+	[writerQueue synchronize];
+	[writerQueue waitUntilEmpty];
+}
+
+- (void) scheduleSynchToStore
+{
+	[writerQueue synchronize];
+}
+
+- (void) _synchToStore
 {
 	NSKeyedArchiver* archiver;
 	NSMutableData* data;
@@ -1232,6 +1067,7 @@ The first frame should indicate a checkpoint for everything
 
 - (id) dataStorage
 {
+	[writerQueue waitUntilEmpty];
 	return [[dataStorage retain] autorelease];
 }
 
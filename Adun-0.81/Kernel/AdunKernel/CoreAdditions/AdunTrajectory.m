@@ -181,6 +181,12 @@
 		systemCollection = nil;
 		frames = nil;
 		numberEnergyCheckpoints = 0;
+		viewCapacity = 0;
+		viewElements = NULL;
+		coordinateView.no_rows = 0;
+		coordinateView.no_columns = 3;
+		coordinateView.matrix = NULL;
+		viewBuffer = NULL;
 		if(path != nil)
 		{
 			storage = [[AdFileSystemSimulationStorage alloc]
@@ -199,6 +205,9 @@
 
 - (void) dealloc
 {	
+	free(viewElements);
+	free(coordinateView.matrix);
+	[[AdMemoryManager appMemoryManager] freeMatrix: viewBuffer];
 	[frames release];
 	[dataStorage release];
 	[stateData release];
@@ -251,6 +260,7 @@
 
 - (id) dataStorage
 {
+	[writerQueue waitUntilEmpty];
 	return [[dataStorage retain] autorelease];
 }
 
@@ -331,24 +341,14 @@
 - (id) mementoForSystem: (id) system inTrajectoryCheckpoint: (unsigned int) number
 {
 	NSData* archive;
-	NSKeyedUnarchiver* unarchiver;
-	NSString* name;
-	id memento;
 	
 	if(number >= [self numberTrajectoryCheckpoints])
 		[NSException raise: NSInvalidArgumentException
 			    format: @"Requested checkpoint (%d) is greater than the number of available checkpoints (%d)",
 		 number, [self numberTrajectoryCheckpoints]];
 	
-	name = [system systemName];
 	archive = [dataStorage trajectoryCheckpoint: number];
-	unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData: archive];
-	memento = [unarchiver decodeObjectForKey: name];
-	[[memento retain] autorelease];
-	[unarchiver finishDecoding];
-	[unarchiver release];
-	
-	return memento;
+	return AdSystemMementoFromTrajectoryCheckpoint(archive, [system systemName]);
 }
 
 - (AdDataMatrix*) coordinatesForSystem: (id) system inTrajectoryCheckpoint: (unsigned int) number
@@ -362,11 +362,173 @@
 
 - (void) coordinatesForSystem: (id) system inTrajectoryCheckpoint: (unsigned int) number usingBuffer: (AdMatrix*) buffer
 {
+	int i;
 	id memento;
+	AdMatrix* view;
 
-	memento = [self mementoForSystem: system inTrajectoryCheckpoint: number];
-	[system returnToState: memento];
-	AdCopyAdMatrixToAdMatrix([system coordinates], buffer);
+	view = [self coordinateViewForSystem: system inTrajectoryCheckpoint: number];
+	if(view != NULL)
+	{
+		for(i=0; i<view->no_rows; i++)
+			memcpy(buffer->matrix[i], view->matrix[i], 3*sizeof(double));
+	}
+	else
+	{
+		memento = [self mementoForSystem: system inTrajectoryCheckpoint: number];
+		[system returnToState: memento];
+		AdCopyAdMatrixToAdMatrix([system coordinates], buffer);
+	}	
+}
+
+/*
+ * Coordinate views
+ */
+
+/**
+Makes sure viewBuffer has \e numberOfRows rows
+*/
+- (void) _resizeViewBuffer: (int) numberOfRows
+{
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	if(viewBuffer != NULL && viewBuffer->no_rows == numberOfRows)
+		return;
+
+	[memoryManager freeMatrix: viewBuffer];
+	viewBuffer = [memoryManager allocateMatrixWithRows: numberOfRows withColumns: 3];
+}
+
+/**
+Decodes the coordinates block at \e bytes into viewBuffer.
+*/
+- (BOOL) _decodeCoordinatesBlock: (const unsigned char*) bytes length: (size_t) length
+{
+	int numberOfRows;
+
+	if(AdTrajectoryFrameBlockInfo(bytes, length, &numberOfRows) == 0)
+		return NO;
+
+	[self _resizeViewBuffer: numberOfRows];
+	return AdDecodeTrajectoryFrameBlock(bytes, length, viewBuffer) != 0;
+}
+
+/**
+Decodes the coordinates of the system called \e name from a keyed archive checkpoint into viewBuffer.
+Returns NO if they are not present.
+*/
+- (BOOL) _decodeCoordinatesOfSystem: (NSString*) name fromArchivedCheckpoint: (NSData*) checkpoint
+{
+	id memento;
+	AdDataMatrix* matrix;
+	
+	memento = AdSystemMementoFromTrajectoryCheckpoint(checkpoint, name);
+	matrix = [memento dataMatrixWithName: @"Coordinates"];
+	if(matrix == nil)
+		return NO;
+
+	[self _resizeViewBuffer: [matrix numberOfRows]];
+	[matrix cRepresentationUsingBuffer: viewBuffer];
+	return YES;
+}
+
+- (AdMatrix*) coordinateViewForSystem: (id) system inTrajectoryCheckpoint: (unsigned int) number
+{
+	return [self coordinateViewForSystem: system elements: nil inTrajectoryCheckpoint: number];
+}
+
+- (AdMatrix*) coordinateViewForSystem: (id) system elements: (NSIndexSet*) indexes inTrajectoryCheckpoint: (unsigned int) number
+{
+	int i, numberOfElements, result;
+	int converted;
+	unsigned int mask;
+	unsigned int* buffer;
+	size_t offset;
+	NSString* name;
+	NSData* checkpoint;
+	const unsigned char* bytes;
+
+	if(number >= [self numberTrajectoryCheckpoints])
+		[NSException raise: NSInvalidArgumentException
+			    format: @"Requested checkpoint (%d) is greater than the number of available checkpoints (%d)",
+		 number, [self numberTrajectoryCheckpoints]];
+
+	numberOfElements = (indexes == nil) ? [system numberOfElements] : [indexes count];
+	if(indexes != nil && [indexes count] != 0 && [indexes lastIndex] >= [system numberOfElements])
+		[NSException raise: NSRangeException
+			format: @"Index %d exceeds the number of elements in %@ (%d)",
+			[indexes lastIndex], [system systemName], [system numberOfElements]];
+
+	if(numberOfElements > viewCapacity)
+	{
+		viewCapacity = numberOfElements;
+		coordinateView.matrix = realloc(coordinateView.matrix, viewCapacity*sizeof(double*));
+		viewElements = realloc(viewElements, viewCapacity*sizeof(int));
+	}
+
+	if(indexes != nil)
+	{
+		buffer = (unsigned int*)malloc(numberOfElements*sizeof(unsigned int));
+		[indexes getIndexes: buffer 
+			maxCount: numberOfElements 
+			inIndexRange: NULL];
+		for(i=0; i<numberOfElements; i++)
+			viewElements[i] = buffer[i];
+
+		free(buffer);
+	}	
+
+	name = [system systemName];
+	checkpoint = [dataStorage trajectoryCheckpoint: number];
+	converted = AdTrajectoryFrameNeedsConversion([checkpoint bytes], [checkpoint length]);
+	checkpoint = AdCurrentTrajectoryFrame(checkpoint);
+	bytes = [checkpoint bytes];
+	if(AdIsBinaryTrajectoryFrame(bytes, [checkpoint length]))
+	{
+		result = AdFindTrajectoryFrameSystem(bytes, [checkpoint length],
+				[name UTF8String], 
+				[name lengthOfBytesUsingEncoding: NSUTF8StringEncoding],
+				&mask, &offset);
+		if(result == -1)
+			[NSException raise: NSInternalInconsistencyException
+				format: @"Trajectory checkpoint %d is corrupt, was written by a newer version or on a machine with a different byte order", 
+				number];
+		
+		if(result == 0 || !(mask & AdSystemCoordinatesMemento))
+			return NULL;
+
+		//Try to view the coordinates in place.
+		//A converted frame is autoreleased so its coordinates are always copied.
+		if(!converted && AdTrajectoryFrameBlockView(bytes + offset, [checkpoint length] - offset,
+			(indexes == nil) ? NULL : viewElements, numberOfElements, 
+			&coordinateView))
+		{
+			return &coordinateView;
+		}	
+
+		if(![self _decodeCoordinatesBlock: bytes + offset length: [checkpoint length] - offset])
+			[NSException raise: NSInternalInconsistencyException
+				format: @"Trajectory checkpoint %d contains an invalid coordinates block", number];
+	}
+	else if(![self _decodeCoordinatesOfSystem: name fromArchivedCheckpoint: checkpoint])
+		return NULL;
+
+	if(viewBuffer->no_rows != (int)[system numberOfElements])
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Trajectory checkpoint %d contains %d elements for %@ - expected %d", 
+			number, viewBuffer->no_rows, name, [system numberOfElements]];
+
+	for(i=0; i<numberOfElements; i++)
+		coordinateView.matrix[i] = viewBuffer->matrix[(indexes == nil) ? i : viewElements[i]];
+	
+	coordinateView.no_rows = numberOfElements;
+	coordinateView.no_columns = 3;
+
+	return &coordinateView;
+}
+
+- (void) prefetchTrajectoryCheckpointsInRange: (NSRange) aRange stride: (unsigned int) stride
+{
+	[dataStorage prefetchTrajectoryCheckpointsInRange: aRange stride: stride];
 }
 
 - (NSString*) description
@@ -546,6 +708,11 @@ does not properly handle them being called twice.
 - (void) setForceFields: (AdForceFieldCollection*) aForceFieldCollection;
 @end
 
+@interface AdMutableTrajectory (PrivateCheckpointWriting)
+- (void) _writeCheckpointSlot: (AdCheckpointSlot*) slot;
+- (void) _synchToStore;
+@end
+
 
 @implementation AdMutableTrajectory
 
@@ -630,9 +797,6 @@ does not properly handle them being called twice.
 				     inputReferences: nil
 				     dataGenerator: [NSBundle mainBundle]];
 			topologyData = [NSMutableDictionary new];
-			energyData = [NSMutableDictionary new];
-			//This is allocated on each trajectory checkpoint request
-			trajectoryData = nil;
 			dataStorage = [dataStorage retain];	
 			headers = [NSArray arrayWithObjects: 
 				   @"Energy",
@@ -655,9 +819,7 @@ does not properly handle them being called twice.
 			
 			dataStorage = [dataStorage retain];
 			topologyData = [NSMutableDictionary new];
-			energyData = [NSMutableDictionary new];
 			forceFieldCollection = nil;
-			trajectoryData = nil;
 			
 			storedSystemCollection = [trajectoryReader systemCollection];
 			stateData = [trajectoryReader energies];
@@ -699,6 +861,13 @@ does not properly handle them being called twice.
 		else
 			[NSException raise: NSInternalInconsistencyException
 				    format: @"You can only write data to a store in AdSimulationStorageWriteMode or AdSimulationStorageAppendMode"];
+		
+		//The energy recorder is created when the first energy checkpoint is requested
+		energyRecorder = nil;
+		writerQueue = [[AdCheckpointWriterQueue alloc]
+				initWithTarget: self
+				writeSelector: @selector(_writeCheckpointSlot:)
+				synchronizeSelector: @selector(_synchToStore)];
 	}
 	
 	return self;
@@ -706,13 +875,16 @@ does not properly handle them being called twice.
 
 - (void) dealloc
 {
-	[self synchToStore];
+	//Any frame still being filled is discarded
+	//as it would be in the synchronous case.
+	[writerQueue stop];
+	[writerQueue release];
+	[self _synchToStore];
 	[trajectoryReader release];
 	[iterationValue release];
 	[iterationHeader release];
 	[topologyData release];
-	[energyData release];
-	[trajectoryData release];
+	[energyRecorder release];
 	[stateData release];
 	[dataStorage release];
 	[frames release];
@@ -819,81 +991,21 @@ does not properly handle them being called twice.
 	return frameOpen;
 }
 
-- (void) _addEnergyCheckpoint
+/**
+ Writes the data collected for a frame to the store.
+ Performed on the writer thread when checkpoints are written in the background.
+ */
+- (void) _writeCheckpointSlot: (AdCheckpointSlot*) slot
 {
-	NSEnumerator* dataEnum;
-	NSString* systemName;
-	id state, stateMatrix;
-	//For column addition
-	int i, noRows;
-	NSEnumerator* termEnum;
-	NSArray* headers;
-	NSMutableArray* newTerms, *column;
-	NSString* term;
-	
-	dataEnum = [energyData keyEnumerator];
-	while((systemName = [dataEnum nextObject]))
-	{
-		stateMatrix = [stateData dataMatrixWithName: 
-			       systemName];
-		state = [energyData objectForKey: systemName];	
-		
-		/*
-		 * We need to check that the number of energy terms returned
-		 * for the system is the same as the number of terms in the matrix.
-		 * They could differ if extra terms were added or removed to the force-field
-		 * operating on the system since the last checkpoint.
-		 *
-		 * Two cases:
-		 * 1. In the case of an extra term we must add an extra column to the matrix and
-		 * fill the previous steps where the term didn't exist with 0's.
-		 * 2. In the case where a term is removed we simply put a zero for its value
-		 * until it appears again.
-		 */
-		
-		if([[state allKeys] count] > [stateMatrix numberOfColumns])
-		{
-			//Find the new keys
-			termEnum = [state keyEnumerator];
-			headers = [stateMatrix columnHeaders];
-			newTerms = [NSMutableArray array];
-			while(term = [termEnum nextObject])
-			{
-				if(![headers containsObject: term])
-					[newTerms addObject: term];
-			}
-			
-			column = [NSMutableArray new];
-			termEnum = [newTerms objectEnumerator];
-			while(term = [termEnum nextObject])
-			{
-				//Create a column for this term
-				
-				noRows = [stateMatrix numberOfRows];
-				for(i=0; i<noRows; i++)
-					[column addObject: [NSNumber numberWithDouble: 0.0]];
-				
-				[stateMatrix extendMatrixWithColumn: column];
-				[stateMatrix setHeaderOfColumn: [stateMatrix numberOfColumns] - 1 
-							    to: term];
-				
-				[column removeAllObjects];
-			}
-			
-			[column release];
-		}
-		
-		[stateMatrix extendMatrixWithColumnValues: state];
-	}		
+	//The energies are only recorded if there are force fields
+	[frames extendMatrixWithRow: 
+		[slot writeToStorage: dataStorage
+			stateData: (forceFieldCollection == nil) ? nil : stateData]];
 }
 
 - (void) closeFrame
 {
-	NSMutableData* data;
-	NSMutableArray* checkpointed = [NSMutableArray new];
-	NSKeyedArchiver* archiver;
-	NSEnumerator* systemEnum;
-	id systemName, topology;
+	AdCheckpointSlot* slot;
 	
 	if(!frameOpen)
 		return;
@@ -904,64 +1016,22 @@ does not properly handle them being called twice.
 	
 	NSDebugLLog(@"AdMutableTrajectory",
 		    @"Closing frame %d", lastFrame);
-	if(trajectoryCheckpoint)
-	{
-		[dataStorage addTrajectoryCheckpoint: trajectoryData];
-		NSDebugLLog(@"AdMutableTrajectory",
-			    @"Checkpointed %d bytes of trajectory data",
-			    [trajectoryData length]);
-		[checkpointed addObject: [NSNumber numberWithInt: 1]];
-	}
-	else
-		[checkpointed addObject: [NSNumber numberWithInt: 0]];
 	
-	if(energyCheckpoint)
-	{
-		if(forceFieldCollection == nil)
-			[checkpointed addObject: [NSNumber numberWithBool: NO]];
-		else
-		{
-			[self _addEnergyCheckpoint];
-			[checkpointed addObject: [NSNumber numberWithInt: 1]];
-			[energyData removeAllObjects];
-		}
-	}
-	else
-		[checkpointed addObject: [NSNumber numberWithInt: 0]];
+	//The collected topologies are handed to the slot.
+	//Any trajectory data and energies were placed there by 
+	//addTrajectoryCheckpoint and addEnergyCheckpoint.
+	slot = [writerQueue currentSlot];
 	
-	if(topologyCheckpoint)
-	{
-		data = [NSMutableData new];
-		archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData: data];
-		[archiver setOutputFormat: NSPropertyListXMLFormat_v1_0];
-		systemEnum = [topologyData keyEnumerator];
-		while((systemName = [systemEnum nextObject]))
-		{
-			//We assume the data source has been synched
-			//to the current configuration
-			NSDebugLLog(@"AdMutableTrajectory",
-				    @"Checkpointing topology of %@", systemName);
-			topology = [topologyData objectForKey: systemName];
-			[archiver encodeObject: topology
-					forKey: systemName];
-		}
-		
-		[archiver finishEncoding];
-		[archiver release];
-		[dataStorage addTopologyCheckpoint: data];
-		NSDebugLLog(@"AdMutableTrajectory",
-			    @"Checkpointed %d bytes of topology data", [data length]);
-		[data release];
-		[checkpointed addObject: [NSNumber numberWithInt: 1]];
-		[topologyData removeAllObjects];
-	}
-	else
-		[checkpointed addObject: [NSNumber numberWithInt: 0]];
+	slot->trajectoryCheckpoint = trajectoryCheckpoint;
+	slot->energyCheckpoint = energyCheckpoint;
+	slot->topologyCheckpoint = topologyCheckpoint;
+	[slot setTopologyData: topologyData];
+	[topologyData release];
+	topologyData = [NSMutableDictionary new];
 	
-	[frames extendMatrixWithRow: checkpointed];
+	[writerQueue submitCurrentSlot];
 	
 	//Set for next frame
-	[checkpointed release];
 	energyCheckpoint = NO;
 	trajectoryCheckpoint = NO;
 	topologyCheckpoint = NO;
@@ -982,6 +1052,7 @@ does not properly handle them being called twice.
 	if(lastFrame == -1)
 		return lastFrame;
 	
+	[writerQueue waitUntilEmpty];	
 	numberOfRows = [frames numberOfRows];
 	for(i=numberOfRows-1; i>=0; i--)
 		if([[frames elementAtRow: i ofColumnWithHeader: column] boolValue])
@@ -1039,43 +1110,20 @@ does not properly handle them being called twice.
 
 - (void) addTrajectoryCheckpoint
 {
-	NSKeyedArchiver* archiver;
-	NSEnumerator* systemEnum;
-	id system, state;
-	
 	trajectoryCheckpoint = YES;
 	
-	//Release previous trajectory checkpoint
-	[trajectoryData release];
-	
-	//Checkpoint current trajectory
-	
-	trajectoryData = [NSMutableData new];
-	archiver = [[NSKeyedArchiver alloc] 
-		    initForWritingWithMutableData: trajectoryData];
-	[archiver setOutputFormat: NSPropertyListXMLFormat_v1_0];
-	systemEnum = [[systemCollection fullSystems] objectEnumerator];
-	while((system = [systemEnum nextObject]))
-	{
-		state = [system captureState];
-		[archiver encodeObject: state 
-				forKey: [system systemName]];
-	}	
-	
-	[archiver finishEncoding];
-	[archiver release];
+	//Checkpoint current trajectory replacing any previous checkpoint.
+	//When writing in the background only the state is copied here.
+	[[writerQueue currentSlot] 
+		captureStateOfSystems: [systemCollection fullSystems]];
 	
 	needsUpdate = YES;
 }
 
 - (void) addEnergyCheckpoint
 {
-	double potentialEnergy, totalEnergy, kineticEnergy;
-	NSEnumerator* systemEnum;
-	NSMutableArray* stateTerms = [NSMutableArray new];
-	AdMolecularMechanicsForceField* systemForceField;
-	id system, state;
-	
+	AdCheckpointSlot* slot;
+
 	energyCheckpoint = YES;
 	
 	//Check that a forceFieldCollection is available before continuing
@@ -1084,68 +1132,20 @@ does not properly handle them being called twice.
 		NSWarnLog(@"No force fields are provided - No energy data will be checkpointed");
 		return;
 	}	
-	
-	//Remove last energy checkpoint
-	[energyData removeAllObjects];
-	
-	//Checkpoint new energies
-	//Go through each system and add the relevant data to a dictionary of (TermName:TermValue pairs). 
-	//Each dictionary is then added to energyData dictionary.
-	//When the frame is close the arrays are added to the state matrix for each system (in closeFrame:)
-	state = [NSMutableArray new];
-	systemEnum = [[systemCollection allSystems] objectEnumerator];
-	while((system = [systemEnum nextObject]))
-	{
-		//FIXME: Only one force field per system supported
-		systemForceField = [[forceFieldCollection forceFieldsForSystem: system]
-				    objectAtIndex: 0];
-		[state addObject: iterationValue];
-		[stateTerms addObject: iterationHeader];
-		
-		potentialEnergy = [systemForceField totalEnergy];
-		[state addObject:
-		 [NSNumber numberWithDouble: potentialEnergy]];
-		[stateTerms addObject: @"PotentialEnergy"];	
-		
-		totalEnergy = potentialEnergy;
-		if([system respondsToSelector: @selector(kineticEnergy)])
-		{
-			kineticEnergy =  [system kineticEnergy];
-			totalEnergy += kineticEnergy;
-			[state addObject:
-			 [NSNumber numberWithDouble: kineticEnergy]];
-			[stateTerms addObject: @"KineticEnergy"];
-			
-			[state addObject:
-			 [NSNumber numberWithDouble: [system temperature]]];
-			[stateTerms addObject: @"Temperature"];		
-		}
-		
-		[state addObject:
-		 [NSNumber numberWithDouble: totalEnergy]];
-		[stateTerms addObject: @"TotalEnergy"];	
-		
-		[state addObjectsFromArray: 
-		 [systemForceField allEnergies]];
-		[stateTerms addObjectsFromArray: [systemForceField allTerms]];	
-		
-		NSDebugLLog(@"AdMutableTrajectory", 
-			    @"State %@. State Terms %@", state, stateTerms);	
-		
-		//Add the array containing the checkpointed energies
-		//to the energyData dictionary
-		[energyData setObject: 
-		 [NSDictionary dictionaryWithObjects: state 
-					     forKeys: stateTerms]
-			       forKey: [system systemName]];
-		
-		[state removeAllObjects];
-		[stateTerms removeAllObjects];	
-	}	
-	
-	[stateTerms release];
-	[state release];
-	needsUpdate = YES;		
+
+	if(energyRecorder == nil)
+		energyRecorder = [[AdEnergyRecorder alloc]
+					initWithSystems: [systemCollection allSystems]
+					forceFields: forceFieldCollection
+					iterationHeader: iterationHeader];
+
+	//The energies are recorded in the slot for the current frame replacing
+	//any previous energy checkpoint. They are added to the state matrix
+	//of each system when the slot is written.
+	slot = [writerQueue currentSlot];
+	[energyRecorder recordEnergiesForIteration: iterationValue
+		inRecord: slot->energyRecord];
+	needsUpdate = YES;
 }
 
 - (void) rollBackToFrame: (unsigned int) value
@@ -1158,6 +1158,10 @@ does not properly handle them being called twice.
 	NSIndexSet* indexSet;
 	AdMutableDataMatrix* matrix;
 	
+	//Wait for the closed frames to be written.
+	//Data collected for the open frame is discarded below.
+	[writerQueue discardCurrentSlot];
+	[writerQueue waitUntilEmpty];
 	if(value > [frames numberOfRows])
 		[NSException raise: NSRangeException
 			    format: @"(%@) %d is out of range %d",
@@ -1225,17 +1229,25 @@ does not properly handle them being called twice.
 		trajectoryCheckpoint = NO;
 		topologyCheckpoint = NO;
 		[topologyData removeAllObjects];
-		[energyData removeAllObjects];
-		[trajectoryData release];
-		trajectoryData = nil;
 		frameOpen = NO;
 	}
 	
 	lastFrame = value;
-	[self synchToStore];
+	[self _synchToStore];
 }
 
 - (void) synchToStore
+{
+	[writerQueue synchronize];
+	[writerQueue waitUntilEmpty];
+}
+
+- (void) scheduleSynchToStore
+{
+	[writerQueue synchronize];
+}
+
+- (void) _synchToStore
 {
 	NSKeyedArchiver* archiver;
 	NSMutableData* data;
@@ -1345,8 +1357,11 @@ does not properly handle them being called twice.
 
 - (void) setForceFields: (AdForceFieldCollection*) aForceFieldCollection
 {
+	[writerQueue waitUntilEmpty];
 	[forceFieldCollection release];
 	forceFieldCollection = [aForceFieldCollection retain];
+	[energyRecorder release];
+	energyRecorder = nil;
 	if(systemCollection != nil)
 		[self _createStateMatrices];
 }
@@ -1,4 +1,7 @@
 #include "AdunKernel/AdFrameworkFunctions.h"
+#include "AdunKernel/AdunSystemMemento.h"
+#include "AdunKernel/AdunDataSet.h"
+#include "AdunKernel/AdunMemoryManager.h"
 
 NSError* AdErrorWithUnderlyingError(NSString* domain, int code, NSString* localizedDescription,
 		       NSString* detailedDescription,
@@ -439,3 +442,291 @@ double AdCalculateVDWRadii(double paramOne, double paramTwo, NSString* type)
 
 
 
+
+/*
+ * Trajectory frames
+ */
+
+NSMutableData* AdEncodeTrajectoryFrameFromMatrices(NSArray* systemNames, int* masks,
+	AdMatrix** coordinates, AdMatrix** velocities,
+	AdFrameEncoding encoding, double precision)
+{
+	int i, mask, numberOfSystems;
+	size_t maximumSize, nameLength;
+	unsigned char *bytes, *buffer;
+	NSString* name;
+	NSMutableData* frame;
+
+	numberOfSystems = [systemNames count];
+	maximumSize = AD_TRAJECTORY_FRAME_HEADER_SIZE;
+	for(i=0; i<numberOfSystems; i++)
+	{
+		name = [systemNames objectAtIndex: i];
+		nameLength = [name lengthOfBytesUsingEncoding: NSUTF8StringEncoding];
+		maximumSize += AdTrajectoryFrameSystemHeaderSize(nameLength);
+		if(masks[i] & AdSystemCoordinatesMemento)
+			maximumSize += AdTrajectoryFrameBlockMaximumSize(coordinates[i]->no_rows);
+		if(masks[i] & AdSystemVelocitiesMemento)
+			maximumSize += AdTrajectoryFrameBlockMaximumSize(velocities[i]->no_rows);
+	}
+
+	frame = [NSMutableData dataWithLength: maximumSize];
+	bytes = buffer = [frame mutableBytes];
+	buffer += AdWriteTrajectoryFrameHeader(buffer, numberOfSystems);
+
+	for(i=0; i<numberOfSystems; i++)
+	{
+		name = [systemNames objectAtIndex: i];
+		mask = masks[i] & (AdSystemCoordinatesMemento | AdSystemVelocitiesMemento);
+		nameLength = [name lengthOfBytesUsingEncoding: NSUTF8StringEncoding];
+		buffer += AdWriteTrajectoryFrameSystemHeader(buffer, 
+				[name UTF8String], nameLength, mask);
+		if((mask & AdSystemCoordinatesMemento))
+			buffer += AdEncodeTrajectoryFrameBlock(coordinates[i], 
+					encoding, precision, buffer);
+
+		//Velocities are not smooth enough to compress well
+		//so they are stored as floats in compressed frames.
+		if((mask & AdSystemVelocitiesMemento))
+			buffer += AdEncodeTrajectoryFrameBlock(velocities[i], 
+					(encoding == AdFrameCompressedEncoding) ? AdFrameFloat32Encoding : encoding,
+					precision, buffer);
+	}
+
+	[frame setLength: buffer - bytes];
+
+	return frame;
+}
+
+NSMutableData* AdEncodeTrajectoryFrame(NSArray* systems, AdFrameEncoding encoding, double precision)
+{
+	int i, numberOfSystems;
+	int* masks;
+	AdMatrix **coordinates, **velocities;
+	NSMutableArray* names;
+	NSMutableData* frame;
+	AdSystem* system;
+
+	numberOfSystems = [systems count];
+	masks = (int*)malloc(numberOfSystems*sizeof(int));
+	coordinates = (AdMatrix**)malloc(numberOfSystems*sizeof(AdMatrix*));
+	velocities = (AdMatrix**)malloc(numberOfSystems*sizeof(AdMatrix*));
+	names = [NSMutableArray array];
+	for(i=0; i<numberOfSystems; i++)
+	{
+		system = [systems objectAtIndex: i];
+		[names addObject: [system systemName]];
+		masks[i] = [system captureMask];
+		coordinates[i] = [system coordinates];
+		velocities[i] = [system velocities];
+	}
+
+	frame = AdEncodeTrajectoryFrameFromMatrices(names, masks, 
+			coordinates, velocities, encoding, precision);
+	free(masks);
+	free(coordinates);
+	free(velocities);
+
+	return frame;
+}
+
+NSMutableData* AdEncodeTrajectoryFrameFromMementos(NSArray* mementos, 
+	AdFrameEncoding encoding, double precision)
+{
+	int i, numberOfMementos;
+	int* masks;
+	AdMatrix **coordinates, **velocities;
+	NSMutableArray* names;
+	NSMutableData* frame;
+	AdSystemMemento* memento;
+
+	numberOfMementos = [mementos count];
+	masks = (int*)malloc((numberOfMementos + 1)*sizeof(int));
+	coordinates = (AdMatrix**)malloc((numberOfMementos + 1)*sizeof(AdMatrix*));
+	velocities = (AdMatrix**)malloc((numberOfMementos + 1)*sizeof(AdMatrix*));
+	names = [NSMutableArray array];
+	for(i=0; i<numberOfMementos; i++)
+	{
+		memento = [mementos objectAtIndex: i];
+		[names addObject: [memento systemName]];
+		masks[i] = [memento captureMask];
+		coordinates[i] = [memento coordinates];
+		velocities[i] = [memento velocities];
+	}
+
+	frame = AdEncodeTrajectoryFrameFromMatrices(names, masks, 
+			coordinates, velocities, encoding, precision);
+	free(masks);
+	free(coordinates);
+	free(velocities);
+
+	return frame;
+}
+
+BOOL AdTrajectoryFrameEncodingFromDefaults(AdFrameEncoding* encoding, double* precision)
+{
+	NSString* encodingName;
+	NSUserDefaults* defaults;
+
+	defaults = [NSUserDefaults standardUserDefaults];
+	encodingName = [defaults stringForKey: @"TrajectoryFrameEncoding"];
+	*precision = 0;
+	if([encodingName isEqual: @"XML"])
+		return NO;
+	
+	if([encodingName isEqual: @"Compressed"])
+	{
+		*encoding = AdFrameCompressedEncoding;
+		*precision = [defaults doubleForKey: @"TrajectoryCompressionPrecision"];
+		if(*precision <= 0)
+		{
+			NSWarnLog(@"Invalid trajectory compression precision %lf - Using 1000", *precision);
+			*precision = 1000;
+		}
+	}
+	else if([encodingName isEqual: @"Float32"])
+		*encoding = AdFrameFloat32Encoding;
+	else
+	{
+		if(encodingName != nil && ![encodingName isEqual: @"Float64"])
+			NSWarnLog(@"Unknown trajectory frame encoding %@ - Using Float64", encodingName);
+		
+		*encoding = AdFrameFloat64Encoding;
+	}
+
+	return YES;
+}
+
+NSMutableData* AdCreateTrajectoryCheckpoint(NSArray* systems)
+{
+	double precision;
+	AdFrameEncoding encoding;
+	NSMutableData* checkpoint;
+	NSKeyedArchiver* archiver;
+	NSEnumerator* systemEnum;
+	id system;
+
+	if(AdTrajectoryFrameEncodingFromDefaults(&encoding, &precision))
+		return AdEncodeTrajectoryFrame(systems, encoding, precision);
+
+	checkpoint = [NSMutableData data];
+	archiver = [[NSKeyedArchiver alloc] 
+		    initForWritingWithMutableData: checkpoint];
+	[archiver setOutputFormat: NSPropertyListXMLFormat_v1_0];
+	systemEnum = [systems objectEnumerator];
+	while((system = [systemEnum nextObject]))
+		[archiver encodeObject: [system captureState] 
+				forKey: [system systemName]];
+	
+	[archiver finishEncoding];
+	[archiver release];
+
+	return checkpoint;
+}
+
+NSData* AdCurrentTrajectoryFrame(NSData* checkpoint)
+{
+	size_t size;
+	NSMutableData* frame;
+
+	if(!AdTrajectoryFrameNeedsConversion([checkpoint bytes], [checkpoint length]))
+		return checkpoint;
+
+	size = AdConvertTrajectoryFrame([checkpoint bytes], [checkpoint length], NULL);
+	if(size == 0)
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Trajectory frame is corrupt or was written by a newer version"];
+
+	frame = [NSMutableData dataWithLength: size];
+	AdConvertTrajectoryFrame([checkpoint bytes], [checkpoint length], [frame mutableBytes]);
+
+	return frame;
+}
+
+/**
+Decodes the block at \e buffer into \e matrix which must have the same number of rows as the block.
+*/
+static void AdDecodeFrameBlockIntoMatrix(const unsigned char** buffer, 
+	const unsigned char* end, 
+	AdMatrix* matrix,
+	NSString* name)
+{
+	int numberOfRows;
+	size_t blockSize;
+
+	if(AdTrajectoryFrameBlockInfo(*buffer, end - *buffer, &numberOfRows) == 0)
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Trajectory frame contains an invalid %@ block", name];
+
+	if(numberOfRows != matrix->no_rows)
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Trajectory frame %@ block has %d rows - expected %d", 
+			name, numberOfRows, matrix->no_rows];
+
+	blockSize = AdDecodeTrajectoryFrameBlock(*buffer, end - *buffer, matrix);
+	if(blockSize == 0)
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Trajectory frame contains an invalid %@ block", name];
+
+	*buffer += blockSize;
+}
+
+id AdSystemMementoFromTrajectoryCheckpoint(NSData* checkpoint, NSString* systemName)
+{
+	int result, numberOfRows;
+	unsigned int mask;
+	size_t offset;
+	const unsigned char *buffer, *end;
+	NSKeyedUnarchiver* unarchiver;
+	AdSystemMemento* memento;
+	id archivedMemento;
+
+	checkpoint = AdCurrentTrajectoryFrame(checkpoint);
+	buffer = [checkpoint bytes];
+	end = buffer + [checkpoint length];
+	if(!AdIsBinaryTrajectoryFrame(buffer, [checkpoint length]))
+	{
+		//A checkpoint written by an earlier version
+		unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData: checkpoint];
+		archivedMemento = [unarchiver decodeObjectForKey: systemName];
+		[[archivedMemento retain] autorelease];
+		[unarchiver finishDecoding];
+		[unarchiver release];
+		return archivedMemento;
+	}
+
+	result = AdFindTrajectoryFrameSystem(buffer, [checkpoint length],
+			[systemName UTF8String], 
+			[systemName lengthOfBytesUsingEncoding: NSUTF8StringEncoding],
+			&mask, &offset);
+	if(result == -1)
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Trajectory frame is corrupt, was written by a newer version or on a machine with a different byte order"];
+	else if(result == 0)
+		return nil;
+
+	buffer += offset;
+	numberOfRows = 0;
+	if(mask != 0 && AdTrajectoryFrameBlockInfo(buffer, end - buffer, &numberOfRows) == 0)
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Trajectory frame contains an invalid block for %@", systemName];
+	
+	//Decode straight into the memento matrices
+	memento = [[AdSystemMemento alloc]
+			initWithSystemName: systemName
+			captureMask: mask
+			coordinates: NULL
+			velocities: NULL
+			numberOfElements: numberOfRows];
+	[memento autorelease];
+	
+	if((mask & AdSystemCoordinatesMemento))
+		AdDecodeFrameBlockIntoMatrix(&buffer, end, 
+			[memento mutableCoordinates], @"Coordinates");
+
+	if((mask & AdSystemVelocitiesMemento))
+		AdDecodeFrameBlockIntoMatrix(&buffer, end, 
+			[memento mutableVelocities], @"Velocities");
+
+	return memento;
+}
@@ -21,25 +21,8 @@
  */
 #include "AdunKernel/AdunSmoothedGBTerm.h"
 
-/************** OPTIMISATION ***************************/
- 
-//NB. These three variables are defined here for optmisation reasons.
-//They are used only by AdPrivateVEF().
-//This is half smoothing length in the terminology of Im et at.
-static double w; 
-static double smoothingConstantA;
-static double smoothingConstantB;
-
-/**
- This is the same as AdVolumeExclusionFunction2() reimplemented here so
- it can be inlined as it is called very frequently
- */
-inline double AdPrivateVEF(Vector3D* r, AdMatrix* coordinates, 
-			   int* neighbourIndexes, int numberNeighbours, double* radii,
-			   IntArrayStruct* contributingAtoms);	
-			   
-			   
-/*****************  END OPT ******************************/			   
+//The number of consecutive atoms processed by a part of a loop at a time
+#define AD_GBSW_CHUNK 16
 
 /*
  *
@@ -57,7 +40,8 @@ Calculate the position derivatives of all atoms that could have a gradient at \e
  */
 inline void AdGBSWCalculatePositionDerivatives(AdMatrix* coordinates, double* pbRadii,  Vector3D* integrationPoint,  
 				double exclusionValue, Vector3D* vectorArray, 
-				IntArrayStruct* calculatedGradients, bool* interactingAtoms);
+				IntArrayStruct* calculatedGradients, bool* interactingAtoms,
+				IntArrayStruct* interactions);
 
 inline void AdGBSWUpdateGradient(Vector3D* vector, double angularWeight, 
 				double radialWeight, double f3, double* gradient);	
@@ -65,12 +49,141 @@ inline void AdGBSWUpdateCrossGradients(IntArrayStruct* calculatedGradients, Vect
 					double angularWeight, double radialWeight, 
 					double f3, AdMatrix* gradientArray);
 
+/*
+ * A per atom method run on the shared thread team (see AdSmoothedGBTerm::_runAtomLoop:).
+ * The atoms are divided into chunks of AD_GBSW_CHUNK atoms and part i processes
+ * chunks i, i + numberOfParts, ... using buffers i, so each atom is always processed
+ * with the same buffers.
+ */
+typedef struct
+{
+	id term;
+	SEL selector;
+	void (*method)(id, SEL, int, AdGBSWThreadBuffers*);
+	AdGBSWThreadBuffers* buffers;
+	int numberOfElements;
+	int numberOfChunks;
+	int numberOfParts;
+}
+AdGBSWAtomLoop;
+
+static void AdGBSWAtomLoopPart(void* argument, int part)
+{
+	int chunk, index, lastIndex;
+	AdGBSWAtomLoop* loop = (AdGBSWAtomLoop*)argument;
+	AdGBSWThreadBuffers* buffers = loop->buffers + part;
+
+	for(chunk = part; chunk < loop->numberOfChunks; chunk += loop->numberOfParts)
+	{
+		index = chunk*AD_GBSW_CHUNK;
+		lastIndex = index + AD_GBSW_CHUNK;
+		if(lastIndex > loop->numberOfElements)
+			lastIndex = loop->numberOfElements;
+
+		for(; index < lastIndex; index++)
+			loop->method(loop->term, loop->selector, index, buffers);
+	}
+}
+
 /*
  *
  * Categories
  *
  */
 
+@implementation AdSmoothedGBTerm (AtomLoopMethods)
+
+- (void) _initThreadBuffers
+{
+	int i;
+	AdGBSWThreadBuffers* buffers;
+
+	threadBuffers = [memoryManager allocateArrayOfSize: numberOfThreads*sizeof(AdGBSWThreadBuffers)];
+	for(i=0; i<numberOfThreads; i++)
+	{
+		buffers = threadBuffers + i;
+		buffers->vectorArray = calloc(numberOfAtoms, sizeof(Vector3D));
+		buffers->crossGradients = [memoryManager allocateMatrixWithRows: numberOfAtoms withColumns: 3];
+		AdSetDoubleMatrixWithValue(buffers->crossGradients, 0.0);
+		if(i == 0)
+		{
+			buffers->forces = forces;
+		}
+		else
+		{
+			buffers->forces = [memoryManager allocateMatrixWithRows: numberOfAtoms withColumns: 3];
+			AdSetDoubleMatrixWithValue(buffers->forces, 0.0);
+		}
+		
+		buffers->calculatedGradients.array = malloc(numberOfAtoms*sizeof(int));
+		buffers->calculatedGradients.length = 0;
+		buffers->interactions.array = malloc(numberOfAtoms*sizeof(int));
+		buffers->interactions.length = 0;
+		buffers->interactingAtoms = calloc(numberOfAtoms, sizeof(bool));
+		buffers->gridPoints.array = NULL;
+		buffers->gridPoints.length = 0;
+		buffers->gridPointsCapacity = 0;
+		buffers->volumeBlock = AdAllocateVolumeBlock(numberAngularPoints);
+		buffers->blockPoints = malloc(numberAngularPoints*sizeof(int));
+		buffers->shellVolumes = malloc(numberAngularPoints*sizeof(double));
+	}
+}
+
+- (void) _cleanUpThreadBuffers
+{
+	int i;
+	AdGBSWThreadBuffers* buffers;
+
+	if(threadBuffers == NULL)
+		return;
+
+	for(i=0; i<numberOfThreads; i++)
+	{
+		buffers = threadBuffers + i;
+		free(buffers->vectorArray);
+		free(buffers->calculatedGradients.array);
+		free(buffers->interactions.array);
+		free(buffers->interactingAtoms);
+		free(buffers->gridPoints.array);
+		free(buffers->blockPoints);
+		free(buffers->shellVolumes);
+		AdFreeVolumeBlock(buffers->volumeBlock);
+		[memoryManager freeMatrix: buffers->crossGradients];
+		if(i != 0)
+			[memoryManager freeMatrix: buffers->forces];
+	}
+
+	[memoryManager freeArray: threadBuffers];
+	threadBuffers = NULL;
+}
+
+//If there are only a few chunks per part the loop is not divided.
+- (int) _runLoop: (SEL) selector numberOfElements: (int) number
+{
+	AdGBSWAtomLoop loop;
+
+	loop.term = self;
+	loop.selector = selector;
+	loop.method = (void (*)(id, SEL, int, AdGBSWThreadBuffers*))[self methodForSelector: selector];
+	loop.buffers = threadBuffers;
+	loop.numberOfElements = number;
+	loop.numberOfChunks = (number + AD_GBSW_CHUNK - 1)/AD_GBSW_CHUNK;
+	loop.numberOfParts = 1;
+	if(numberOfThreads > 1 && loop.numberOfChunks >= 2*numberOfThreads)
+		loop.numberOfParts = numberOfThreads;
+
+	AdRunThreadTeam(AdSharedThreadTeam(), AdGBSWAtomLoopPart, &loop, loop.numberOfParts);
+
+	return loop.numberOfParts;
+}
+
+- (int) _runAtomLoop: (SEL) selector
+{
+	return [self _runLoop: selector numberOfElements: numberOfAtoms];
+}
+
+@end
+
 /**
 Category containing methods for calculating the born radius, the self-electrostatic solvation energy,
 (and the necessary coloumb field approximation terms) for each atom.
@@ -220,12 +333,6 @@ Category containing methods for calculating the born radius, the self-electrosta
 	//Initialise the smoothing value that will be used with the GB volume functions
 	AdInitialiseGBSmoothingVariables(smoothingLength);
 	
-	//Static copies of the variables set by the above function.
-	//This is an optimisation - These variables are for use with AdPrivateVEF().
-	w = smoothingLength;
-	smoothingConstantA = 3/(4*smoothingLength);
-	smoothingConstantB = 1/(4*pow(smoothingLength, 3));
-	
 	//Initialise the constants used by the GB force and energy functions
 	AdSetGeneralizedBornVariables(tau, PI4EP_R);
 	
@@ -234,8 +341,7 @@ Category containing methods for calculating the born radius, the self-electrosta
 	selfEnergy = [memoryManager allocateMatrixWithRows: [system numberOfElements] withColumns: 3];
 	charges = [[[system elementProperties] columnWithHeader: @"PartialCharge"] cDoubleRepresentation];
 	selfGradients = [memoryManager allocateMatrixWithRows: numberOfAtoms withColumns: 3];
-	crossGradients = [memoryManager allocateMatrixWithRows: numberOfAtoms withColumns: 3];
-	vectorArray = malloc(numberOfAtoms*sizeof(Vector3D));
+	[self _initThreadBuffers];
 	
 	//Get the PBBornRadii
 	pbRadii = [memoryManager allocateArrayOfSize: numberOfAtoms*sizeof(double)];
@@ -260,32 +366,46 @@ Category containing methods for calculating the born radius, the self-electrosta
 - (void) _cleanUpBornRadiiVariables
 {
 	free(charges);
-	free(vectorArray);
+	[self _cleanUpThreadBuffers];
 	[memoryManager freeMatrix: selfGradients];
-	[memoryManager freeMatrix: crossGradients];
 	[memoryManager freeMatrix: selfEnergy];
 	[memoryManager freeArray: pbRadii];
 	[memoryManager freeArray: bornRadii];
 	[memoryManager freeArray: atomSasas];
 }
 
-- (void) _calculateBornRadiusAndCFATermsForAtom: (int) atomIndex
+/*
+ * Only writes the born radius and self energy of the atom so it can be run 
+ * by _runAtomLoop:. The volume function at the points of each radial shell 
+ * that are partially overlapped is calculated together using the volume block in buffers.
+ */
+- (void) _calculateBornRadiusAndCFATermsForAtom: (int) atomIndex buffers: (AdGBSWThreadBuffers*) buffers
 {
-	int i;
+	int i, numberBlockPoints;
 	int radialStart, radialPoint, angularPoint;
 	int gridPointIndex;	//!< The index of the grid point to be used to define the atoms used in the integration.
-	double radialWeight, angularWeight;
+	int* blockPoints;
+	double radialWeight;
 	double holder,valueOne, valueTwo; //< For holding precalculated values
 	double firstSum, secondSum; //!< The values of the integrals
 	double charge, preFactor, maxLowerBound;
-	double volumeFunctionValue, radialDistance;
-	double* position;
+	double radialDistance;
+	double* position, *shellVolumes;
+	double* radialDistances, *radialWeights, *angularWeights;
+	double* pointsX, *pointsY, *pointsZ;
 	AdMatrix* coordinates;
-	Vector3D integrationPoint, absPoint, *pointsArray;
+	AdVolumeBlock* block;
+	Vector3D *absPoint;
 	
 	//Get reference to atom position
 	coordinates = [system coordinates];
 	position = coordinates->matrix[atomIndex];
+	radialDistances = quadratureGrid->radialDistances;
+	radialWeights = quadratureGrid->radialWeights;
+	angularWeights = quadratureGrid->angularWeights;
+	block = buffers->volumeBlock;
+	blockPoints = buffers->blockPoints;
+	shellVolumes = buffers->shellVolumes;
 		
 	firstSum = secondSum = 0;
 	
@@ -295,9 +415,9 @@ Category containing methods for calculating the born radius, the self-electrosta
 	
 	//Find the first radial point after maxLowerBound
 	radialStart = 0;
-	for(i=0; i<radialInfo->no_rows;i++)
+	for(i=0; i<numberRadialPoints;i++)
 	{
-		if(radialInfo->matrix[i][0] > maxLowerBound)
+		if(radialDistances[i] > maxLowerBound)
 		{
 			radialStart = i;
 			break;
@@ -311,8 +431,8 @@ Category containing methods for calculating the born radius, the self-electrosta
 	{
 		holder = 4*M_PI;
 		
-		radialDistance = radialInfo->matrix[radialPoint][0];
-		radialWeight = radialInfo->matrix[radialPoint][1];
+		radialDistance = radialDistances[radialPoint];
+		radialWeight = radialWeights[radialPoint];
 		
 		valueOne = radialDistance*radialDistance;
 		valueTwo = valueOne*valueOne*radialDistance;
@@ -326,50 +446,57 @@ Category containing methods for calculating the born radius, the self-electrosta
 	//Now do the points outside max lower bound
 	for(radialPoint = radialStart; radialPoint < numberRadialPoints; radialPoint++)
 	{ 
-		radialDistance = radialInfo->matrix[radialPoint][0];
-		radialWeight = radialInfo->matrix[radialPoint][1];
-		pointsArray = integrationPoints[radialPoint];
-		
+		radialDistance = radialDistances[radialPoint];
+		radialWeight = radialWeights[radialPoint];
+		//The integration points of this shell relative to the atom 
+		//we are calculating the Born radius for
+		pointsX = quadratureGrid->pointsX + radialPoint*numberAngularPoints;
+		pointsY = quadratureGrid->pointsY + radialPoint*numberAngularPoints;
+		pointsZ = quadratureGrid->pointsZ + radialPoint*numberAngularPoints;
+		numberBlockPoints = 0;
+		
+		//First find the volume function at the points where it is 0 or 1.
+		//The remaining points are added to the block.
 		for(angularPoint = 0; angularPoint < numberAngularPoints; angularPoint++)
 		{
-			//Get the vector giving the integration point relative to the atom
-			//we are calculating the Born radius for
-			integrationPoint = pointsArray[angularPoint];
-			
-			//Get the weights for the radial and angular point we are using
-			angularWeight = angularInfo->matrix[angularPoint][3];
-
 			//Get the absolute position of this point (relative to the origin)
-			absPoint.vector[0] = position[0] + integrationPoint.vector[0];
-			absPoint.vector[1] = position[1] + integrationPoint.vector[1];
-			absPoint.vector[2] = position[2] + integrationPoint.vector[2];
+			absPoint = block->points + numberBlockPoints;
+			absPoint->vector[0] = position[0] + pointsX[angularPoint];
+			absPoint->vector[1] = position[1] + pointsY[angularPoint];
+			absPoint->vector[2] = position[2] + pointsZ[angularPoint];
 			
 			//Find the nearest grid point to this point
-			gridPointIndex = getIndex(soluteGrid, gridSelector, &absPoint);
+			gridPointIndex = getIndex(soluteGrid, gridSelector, absPoint);
 		
-			//Get the value of the volume function
 			//If no atoms overlap the point the volume function is 0.
-			//In this case nothing is added to holder so we can continue
 			//If any atom completely overlaps the point the volume function is 1.
-			if(gridPointIndex != -1)
+			if(gridPointIndex == -1)
 			{
-				if(overlapBuffer[gridPointIndex] == 1)
-				{	
-					volumeFunctionValue = 1;
-				}
-				else
-				{
-					volumeFunctionValue = AdVolumeFunction(&absPoint, 
-									       coordinates, 
-									       neighbourTable[gridPointIndex],
-									       numberNeighbours.array[gridPointIndex],
-									       pbRadii);
-				}
-			
-				holder += angularWeight*volumeFunctionValue;
+				shellVolumes[angularPoint] = 0;
+			}
+			else if(overlapBuffer[gridPointIndex] == 1)
+			{	
+				shellVolumes[angularPoint] = 1;
+			}
+			else
+			{
+				block->neighbourIndexes[numberBlockPoints] = neighbourTable + neighbourOffsets[gridPointIndex];
+				block->numberNeighbours[numberBlockPoints] = numberNeighbours.array[gridPointIndex];
+				blockPoints[numberBlockPoints] = angularPoint;
+				numberBlockPoints++;
 			}
 		}
 		
+		block->numberPoints = numberBlockPoints;
+		AdVolumeExclusionFunctionBlock(block, coordinates, pbRadii);
+		for(i=0; i<numberBlockPoints; i++)
+			shellVolumes[blockPoints[i]] = 1 - block->values[i];
+		
+		//Sum in angular order so the result doesn't depend on which points were in the block
+		holder = 0;
+		for(angularPoint = 0; angularPoint < numberAngularPoints; angularPoint++)
+			holder += angularWeights[angularPoint]*shellVolumes[angularPoint];
+		
 		//This is the separation distance to the power of 2 and 5 respectively 
 		valueOne = radialDistance*radialDistance;
 		valueTwo = valueOne*valueOne*radialDistance;
@@ -401,12 +528,11 @@ Category containing methods for calculating the born radius, the self-electrosta
 {
 	int i;
 
+	[self _runAtomLoop: @selector(_calculateBornRadiusAndCFATermsForAtom:buffers:)];
+	
 	totalSelfESTPotential = 0;
 	for(i=0; i<numberOfAtoms; i++)
-	{
-		[self _calculateBornRadiusAndCFATermsForAtom: i];
 		totalSelfESTPotential += selfEnergy->matrix[i][0];
-	}
 }
 
 @end
@@ -418,19 +544,21 @@ derivative
 */		
 @implementation AdSmoothedGBTerm (BornNonPolarMethods)
 
-- (double) _calculateSASAForAtom: (int) atomIndex
+/*
+ * Sets the sasa of the atom in atomSasas so it can be run by _runAtomLoop:.
+ * buffers is not used.
+ */
+- (void) _calculateSASAForAtom: (int) atomIndex buffers: (AdGBSWThreadBuffers*) buffers
 {
-	int i;
 	int radialPoint, angularPoint, gridPointIndex;
 	double radialWeight, angularWeight;
 	double volumeExclusionValue, atomSASA, radius;
-	double* position, *weightsBuffer, *pointsBuffer;
+	double* position;
+	double weightsBuffer[3], pointsBuffer[3];
 	AdMatrix* coordinates;
 	Vector3D integrationPoint, absPoint, gradient;
 	
 	//Generate the first set of radial points
-	weightsBuffer = malloc(3*sizeof(double));
-	pointsBuffer =  malloc(3*sizeof(double));
 	
 	//5 points up to 1 angstrom
 	AdGenerateGaussLegendrePoints(pbRadii[atomIndex] - 0.1, 
@@ -450,12 +578,13 @@ derivative
 		{
 			//Get the vector giving the integration point relative to the atom
 			//we are calculating the Born radius for
-			for(i=0; i<3; i++)
-				integrationPoint.vector[i] = angularInfo->matrix[angularPoint][i]*radius;
+			integrationPoint.vector[0] = quadratureGrid->angularX[angularPoint]*radius;
+			integrationPoint.vector[1] = quadratureGrid->angularY[angularPoint]*radius;
+			integrationPoint.vector[2] = quadratureGrid->angularZ[angularPoint]*radius;
 			integrationPoint.length = radius;
 			
 			//Get the weight
-			angularWeight = angularInfo->matrix[angularPoint][3];
+			angularWeight = quadratureGrid->angularWeights[angularPoint];
 			
 			//Get the gradient of the atomic volume exclusion function at the integration point 
 			//i.e. The gradient at the point just due to this atom.
@@ -488,7 +617,7 @@ derivative
 					
 					volumeExclusionValue = AdVolumeExclusionFunction(&absPoint, 
 									coordinates, 
-									neighbourTable[gridPointIndex],
+									neighbourTable + neighbourOffsets[gridPointIndex],
 									numberNeighbours.array[gridPointIndex],
 									pbRadii);
 									
@@ -509,25 +638,22 @@ derivative
 		}
 	}	
 
-	free(pointsBuffer);
-	free(weightsBuffer);
-
-	return atomSASA;
+	atomSasas[atomIndex] = atomSASA;
 }
 
 - (void) _calculateSASA
 {
 	int i;
 	
+	//The smoothing variables are shared by all threads so they
+	//must only be changed outside the loop.
 	AdInitialiseGBSmoothingVariables(0.1);
+	[self _runAtomLoop: @selector(_calculateSASAForAtom:buffers:)];
+	AdInitialiseGBSmoothingVariables(smoothingLength);
 	
 	for(totalSasa=0, i=0; i<numberOfAtoms; i++)
-	{
-		atomSasas[i] = [self _calculateSASAForAtom: i];
 		totalSasa += atomSasas[i];
-	}
 		
-	AdInitialiseGBSmoothingVariables(smoothingLength);
 	totalNonpolarPotential = totalSasa*tensionCoefficient;	
 }
 
@@ -564,7 +690,7 @@ the derivative will be zero (there are only 38 points at each radial distance.)
 This is more likely to occur the further \e atomTwo is from \e atomOne.
 */
 		
-- (void) _calculateDerivativesWithRespectToAtom:(int) mainAtom 
+- (void) _calculateDerivativesWithRespectToAtom:(int) mainAtom buffers: (AdGBSWThreadBuffers*) buffers
 {
 	BOOL retval;
 	int i, radialPoint, angularPoint, radialStart;
@@ -572,12 +698,13 @@ This is more likely to occur the further \e atomTwo is from \e atomOne.
 	int* neighbourIndexes;
 	double f1, f2, f3;	//!< Precomputed factors
 	double radialWeight, angularWeight, distance, squaredDistance, exclusionValue;
-	double maxLowerBound;
-	double *mainAtomPosition, *selfGradient;
-	AdMatrix* coordinates;
-	Vector3D absPoint, integrationPoint, selfVector;
-	Vector3D *pointArray;
-	IntArrayStruct calculatedGradients;
+	double maxLowerBound, selfCoefficient, value;
+	double *mainAtomPosition, *selfGradient, *crossGradient;
+	double *radialDistances, *pointsX, *pointsY, *pointsZ;
+	double** threadForces;
+	AdMatrix* coordinates, *crossGradients;
+	Vector3D absPoint, selfVector;
+	IntArrayStruct* calculatedGradients, *interactions;
 	bool* interactingAtoms;
 	
 	//This return NO if the atom charge is 0 - see above.
@@ -600,24 +727,28 @@ This is more likely to occur the further \e atomTwo is from \e atomOne.
 	
 	//Find the first radial point after maxLowerBound
 	//FIXME: Precompute
+	radialDistances = quadratureGrid->radialDistances;
 	radialStart = 0;
-	for(i=0; i<radialInfo->no_rows;i++)
+	for(i=0; i<numberRadialPoints;i++)
 	{
-		if(radialInfo->matrix[i][0] > maxLowerBound)
+		if(radialDistances[i] > maxLowerBound)
 		{
 			radialStart = i;
 			break;
 		}
 	}
 			
-	//Array for holding indexes of atoms who have a gradient
-	//FIMXE: Preallocate
-	calculatedGradients.array = malloc(numberOfAtoms*sizeof(int));
-	calculatedGradients.length = 0;
-	interactingAtoms = calloc(numberOfAtoms, sizeof(bool));
-	
-	//AdSetDoubleMatrixWithValue(crossGradients, 0.0);
-	memset(crossGradients->matrix[0], 0.0, numberOfAtoms*3*sizeof(double));
+	//The buffers of the part of the loop processing the atom.
+	//calculatedGradients holds the indexes of atoms who have a gradient at a point.
+	//interactions holds the indexes of atoms who have a cross gradient.
+	//The cross gradients of these atoms are cleared at the end so the matrix is 
+	//always clear at the start.
+	calculatedGradients = &buffers->calculatedGradients;
+	calculatedGradients->length = 0;
+	interactions = &buffers->interactions;
+	interactingAtoms = buffers->interactingAtoms;
+	crossGradients = buffers->crossGradients;
+	threadForces = buffers->forces->matrix;
 	
 	/*
 	 * Iterate over all the integration points around the atom whose
@@ -629,9 +760,11 @@ This is more likely to occur the further \e atomTwo is from \e atomOne.
 	 
 	for(radialPoint = radialStart; radialPoint < radialEnd; radialPoint++)
 	{
-		distance = radialInfo->matrix[radialPoint][0];
-		radialWeight = radialInfo->matrix[radialPoint][1];
-		pointArray = integrationPoints[radialPoint];
+		distance = radialDistances[radialPoint];
+		radialWeight = quadratureGrid->radialWeights[radialPoint];
+		pointsX = quadratureGrid->pointsX + radialPoint*numberAngularPoints;
+		pointsY = quadratureGrid->pointsY + radialPoint*numberAngularPoints;
+		pointsZ = quadratureGrid->pointsZ + radialPoint*numberAngularPoints;
 	
 		//The messy factor you have to multiply for each radial shell.
 		squaredDistance = distance*distance;
@@ -639,14 +772,11 @@ This is more likely to occur the further \e atomTwo is from \e atomOne.
 		
 		for(angularPoint = 0; angularPoint < numberAngularPoints; angularPoint++)
 		{
-			//Get the vector giving the integration point relative to the atom
-			//whose Born radius we are peforming the derivative of.
-			integrationPoint = pointArray[angularPoint];
-			
-			//Get the absolute position of this point (relative to the origin)
-			absPoint.vector[0] = mainAtomPosition[0] + integrationPoint.vector[0];
-			absPoint.vector[1] = mainAtomPosition[1] + integrationPoint.vector[1];
-			absPoint.vector[2] = mainAtomPosition[2] + integrationPoint.vector[2];
+			//Get the absolute position of this point (relative to the origin).
+			//The points are relative to the atom whose Born radius we are peforming the derivative of.
+			absPoint.vector[0] = mainAtomPosition[0] + pointsX[angularPoint];
+			absPoint.vector[1] = mainAtomPosition[1] + pointsY[angularPoint];
+			absPoint.vector[2] = mainAtomPosition[2] + pointsZ[angularPoint];
 			
 			//Find the nearest grid point to this point
 			gridPointIndex = getIndex(soluteGrid, gridSelector, &absPoint);
@@ -678,7 +808,7 @@ This is more likely to occur the further \e atomTwo is from \e atomOne.
 			if(overlapBuffer[gridPointIndex] == 1)
 				continue;
 			
-			neighbourIndexes = neighbourTable[gridPointIndex];
+			neighbourIndexes = neighbourTable + neighbourOffsets[gridPointIndex];
 			
 			//The position derivative of an atom at a point involves the total 
 			//exclusion value at that point.
@@ -687,17 +817,17 @@ This is more likely to occur the further \e atomTwo is from \e atomOne.
 			//Usally this means the point has no neighbours but not always.
 			//i.e. it could be just outside the boundary of some neighbours
 			//The indexes of the points who contributed are place in calculatedGradients
-			exclusionValue = AdPrivateVEF(&absPoint, 
+			exclusionValue = AdVolumeExclusionFunction2(&absPoint, 
 						      coordinates, 
 						      neighbourIndexes, 
 						      numberOfNeighbours, 
 						      pbRadii,
-						      &calculatedGradients);
+						      calculatedGradients);
 			
 			if(exclusionValue == 0 || exclusionValue >= 1)	
 				continue;
 			
-			angularWeight = angularInfo->matrix[angularPoint][3];
+			angularWeight = quadratureGrid->angularWeights[angularPoint];
 			
 			//Cross derivatives
 			//FIXME: Possibly calculating a number of terms twice.
@@ -707,24 +837,24 @@ This is more likely to occur the further \e atomTwo is from \e atomOne.
 			//a derivative at the point (the points neighbours) AND also 
 			//interact with mainAtom but ARE NOT the mainAtom!
 			AdGBSWCalculatePositionDerivatives(coordinates, pbRadii, &absPoint, 
-							   exclusionValue, vectorArray, 
-							   &calculatedGradients, interactingAtoms);
+							   exclusionValue, buffers->vectorArray, 
+							   calculatedGradients, interactingAtoms, interactions);
 			
 			//Update all the gradient vectors - This also clear all the vectors in vectorAray
-			AdGBSWUpdateCrossGradients(&calculatedGradients, vectorArray, 
+			AdGBSWUpdateCrossGradients(calculatedGradients, buffers->vectorArray, 
 						   angularWeight, radialWeight, f3, crossGradients);				
 			
 			
 			//The self derivative at the point
 			AdVolumeFunctionAtomDerivative(mainAtom, &absPoint, coordinates, 
-						       &calculatedGradients, exclusionValue, 
+						       calculatedGradients, exclusionValue, 
 						       pbRadii, &selfVector);	
 			
 			//Also clears selfVector
 			AdGBSWUpdateGradient(&selfVector, angularWeight, radialWeight, 
 					     f3, selfGradient);
 			
-			calculatedGradients.length = 0;				
+			calculatedGradients->length = 0;				
 		}
 	}
 	
@@ -734,36 +864,37 @@ This is more likely to occur the further \e atomTwo is from \e atomOne.
 	selfGradient[2] *= f1;
 	
 	//Finally multiply all the entries in the gradient matrix
-	//who the derivative was performed w.r.t by the first factor
-
-	double selfCoefficient, value;
-	
-	interactingAtoms[mainAtom] = 0;
-	
-	for(selfCoefficient = 0, i=0; i<numberOfAtoms; i++)
+	//who the derivative was performed w.r.t by the first factor.
+	//Only the atoms in interactions can have a non-zero entry.
+	//Their entries and flags are cleared for the next atom.
+	for(selfCoefficient = 0, i=0; i<interactions->length; i++)
 	{
-		if(interactingAtoms[i])
+		index = interactions->array[i];
+		interactingAtoms[index] = false;
+		crossGradient = crossGradients->matrix[index];
+		if(index != mainAtom)
 		{
 			//Get the born radius derivative - dG/dRa*dRa/drb
 			//FIXME: This could be precalcualted but there are storage problems.
-			AdGBEBornRadiusCoefficient(mainAtom , i, coordinates->matrix, bornRadii, charges, &value);
+			AdGBEBornRadiusCoefficient(mainAtom , index, coordinates->matrix, bornRadii, charges, &value);
 			selfCoefficient += value;
 			value *= f1;
-			forces->matrix[i][0] -= value*crossGradients->matrix[i][0];
-			forces->matrix[i][1] -= value*crossGradients->matrix[i][1];
-			forces->matrix[i][2] -= value*crossGradients->matrix[i][2];
+			threadForces[index][0] -= value*crossGradient[0];
+			threadForces[index][1] -= value*crossGradient[1];
+			threadForces[index][2] -= value*crossGradient[2];
 		}
+		
+		crossGradient[0] = crossGradient[1] = crossGradient[2] = 0;
 	}
+	
+	interactions->length = 0;
 
 	//Same for self gradient
 	//Force is negative of gradient.
 	//For each (+,-) pair this force acts to increase the B.R.
-	forces->matrix[mainAtom][0] -= selfGradient[0]*selfCoefficient;
-	forces->matrix[mainAtom][1] -= selfGradient[1]*selfCoefficient;
-	forces->matrix[mainAtom][2] -= selfGradient[2]*selfCoefficient;
-		
-	free(calculatedGradients.array);
-	free(interactingAtoms);
+	threadForces[mainAtom][0] -= selfGradient[0]*selfCoefficient;
+	threadForces[mainAtom][1] -= selfGradient[1]*selfCoefficient;
+	threadForces[mainAtom][2] -= selfGradient[2]*selfCoefficient;
 }
 
 @end
@@ -791,7 +922,8 @@ Atoms is an array of atoms whose derivative is to be calculaed at \e integration
 */
 inline void AdGBSWCalculatePositionDerivatives(AdMatrix* coordinates, double* pbRadii, 
 		Vector3D* integrationPoint, double exclusionValue, 
-		Vector3D* vectorArray, IntArrayStruct* calculatedGradients, bool* interactingAtoms)
+		Vector3D* vectorArray, IntArrayStruct* calculatedGradients, bool* interactingAtoms,
+		IntArrayStruct* interactions)
 {
 	int i, atomIndex, numberNeighbours;
 		
@@ -815,7 +947,11 @@ inline void AdGBSWCalculatePositionDerivatives(AdMatrix* coordinates, double* pb
 		//The deriviate is put into vectorArray[i].
 		AdVolumeFunctionPositionDerivative(atomIndex, integrationPoint, coordinates, 
 						exclusionValue, pbRadii, (vectorArray + atomIndex));
-		interactingAtoms[atomIndex] = true;				
+		if(!interactingAtoms[atomIndex])
+		{
+			interactingAtoms[atomIndex] = true;
+			interactions->array[interactions->length++] = atomIndex;
+		}
 	}
 }
 
@@ -878,89 +1014,3 @@ inline void AdGBSWUpdateCrossGradients(IntArrayStruct* calculatedGradients, Vect
 	}
 }
 
-/**
-This is the same as AdVolumeExclusionFunction2() reimplemented here so
-it can be inlined as it is called very frequently
-*/
-inline double AdPrivateVEF(Vector3D* r, AdMatrix* coordinates, 
-				int* neighbourIndexes, int numberNeighbours, double* radii,
-				 IntArrayStruct* contributingAtoms)
-{
-	int i, j, index, count;
-	double smoothingBoundary, checkVal;
-	double** matrix;
-	Vector3D separation;	
-	//Variables for manually inlined AdAtomicVolumeExclusionFunctionNew()
-	double lower, upper, difference;
-	double volumeExclusionValue, length, radius;
-	double* atomPosition, *pointPosition;
-	
-	if(numberNeighbours == 0)
-		return 1.0;
-	
-	matrix = coordinates->matrix;
-	pointPosition = r->vector;
-
-	for(count = 0, volumeExclusionValue = 1, i=0; i<numberNeighbours; i++)
-	{
-		index = neighbourIndexes[i];
-		
-		/******* Manual Inline ************/
-		
-		atomPosition = matrix[index];
-		radius = radii[index];
-		
-		separation.vector[0] = pointPosition[0] - atomPosition[0];
-		separation.vector[1] = pointPosition[1] - atomPosition[1];
-		separation.vector[2] = pointPosition[2] - atomPosition[2];
-				
-		upper = radius + w;
-		if((AdCartesianDistanceVectorCheck(&separation, upper)) == 0)
-		{
-			volumeExclusionValue *= 1;
-		}
-		else
-		{	
-			lower = radius - w;
-			if((AdCartesianDistanceVectorCheck(&separation, 0.5*lower)) == 1)
-			{
-				volumeExclusionValue = 0;
-				i = numberNeighbours;
-				count = 0;
-			}
-			else
-			{
-				Ad3DVectorLengthSquared(&separation);
-				length = separation.length;
-				if(length > upper*upper)
-				{
-					volumeExclusionValue *= 1;
-				}
-				else if(length < lower*lower)
-				{
-					volumeExclusionValue = 0;
-					i = numberNeighbours;
-					count = 0;
-				}
-				else
-				{	
-					length = sqrt(length);
-					separation.length = length;
-					difference = length - radius;
-					volumeExclusionValue *= (0.5 + difference*(smoothingConstantA - 
-										 smoothingConstantB*difference*difference));
-					contributingAtoms->array[count] = index;
-					count++;					 
-				}
-			}
-		}
-		
-		/***********************/
-	}
-	
-	contributingAtoms->length  = count;
-	
-	return volumeExclusionValue;
-}
-
-
@@ -22,7 +22,11 @@
 #include "AdunKernel/AdunSmoothedGBTerm.h"
 #include "AdunKernel/AdunCuboidBox.h"
 
-#define DEFAULT_NEIGHBOUR_BUFFER_SIZE 10
+//The number of free entries after the neighbours of each grid point.
+//These allow atoms to be added to a point when the table is updated.
+#define AD_GBSW_ROW_SLACK 4
+//If more than this fraction of the atoms have to be moved the table is recreated.
+#define AD_GBSW_REBUILD_FRACTION 0.125
 
 /**
 Fills the \e lower and \e higher arrays with the max and minimum indexes within \e range of those
@@ -108,120 +112,145 @@ inline BOOL AdCheckGridPoint(double* atomPostion, double* gridPoint, double grid
 	return retval;	
 }
 
+//The integration grids in use keyed by their configuration. 
+//They are shared by all terms and kept until the program exits.
+static NSMutableDictionary* quadratureGrids = nil;
+static NSLock* quadratureLock = nil;
+
 /**
-Adds \e atomIndex to the list of neighbours of gridIndex, increasing the stored number of neighbours and 
-handling any necessary memeory reallocations.
+Methods for setting up the integrations points and weights
 */
-inline void AdAddNeighbour(unsigned int atomIndex, unsigned int gridIndex, int** neighbourTable, IntArrayStruct* numberNeighbours);
+@implementation AdSmoothedGBTerm (IntegrationMethods)
 
-inline void AdAddNeighbour(unsigned int atomIndex, unsigned int gridIndex, int** neighbourTable, IntArrayStruct* numberNeighbours)
++ (void) _initQuadratureGrids
 {
-	int length;
-	int* indexes;
+	if(quadratureGrids == nil)
+	{
+		quadratureGrids = [NSMutableDictionary new];
+		quadratureLock = [NSLock new];
+	}
+}
+
+/**
+Returns the grid stored in the file \e name in the GBSWData resource directory
+or NULL if there is no such file or it does not contain the grid for the receivers
+number of points and integration start point.
+The file name only records the start point to two decimal places so the radial 
+shells below 1 angstrom are checked against the start point before the grid is used.
+*/
+- (AdQuadratureGrid*) _readQuadratureGrid: (NSString*) name
+{
+	int i;
+	double distances[5], weights[5];
+	NSString* path;
+	FILE* file;
+	AdQuadratureGrid* grid;
 
-	indexes = neighbourTable[gridIndex];
-	length = numberNeighbours->array[gridIndex];
+	path = [[[[NSBundle bundleForClass: [AdSmoothedGBTerm class]] resourcePath]
+			stringByAppendingPathComponent: @"GBSWData"]
+			stringByAppendingPathComponent: name];
+	file = fopen([path fileSystemRepresentation], "rb");
+	if(file == NULL)
+	{
+		NSDebugLLog(@"AdSmoothedGBTerm", @"No integration grid cache at %@", path);
+		return NULL;
+	}
+
+	grid = AdReadQuadratureGrid(file);
+	fclose(file);
+	if(grid == NULL)
+	{
+		NSWarnLog(@"Integration grid cache %@ is invalid or was created on a different architecture", path);
+		return NULL;
+	}
 	
-	//Check is reallocation needed.
-	if(length >= DEFAULT_NEIGHBOUR_BUFFER_SIZE)
+	if(grid->numberRadialPoints != numberRadialPoints || grid->numberAngularPoints != numberAngularPoints)
 	{
-		indexes = realloc(indexes, (length + 1)*sizeof(int));
-		//indexes = NSZoneRealloc(lookupZone, indexes, (length + 1)*sizeof(int));
-		neighbourTable[gridIndex] = indexes;
+		NSWarnLog(@"Integration grid cache %@ has the wrong number of points", path);
+		AdFreeQuadratureGrid(grid);
+		return NULL;
 	}
-		
-	indexes[length] = atomIndex;
-	length++;
-	numberNeighbours->array[gridIndex] = length;
+
+	AdGenerateGaussLegendrePoints(integrationStartPoint, 1, 5, distances, weights);
+	for(i=0; i<5; i++)
+		if(fabs(grid->radialDistances[i] - distances[i]) > 1E-8)
+		{
+			NSDebugLLog(@"AdSmoothedGBTerm", 
+				@"Integration grid cache %@ is not for start point %lf", path, integrationStartPoint);
+			AdFreeQuadratureGrid(grid);
+			return NULL;
+		}
+
+	return grid;
 }
 
 /**
-Methods for setting up the integrations points and weights
+Generates the radial and angular points and weights and the integration points.
+See AdCreateSmoothedGBQuadratureGrid().
 */
-@implementation AdSmoothedGBTerm (IntegrationMethods)
+- (AdQuadratureGrid*) _generateQuadratureGrid
+{
+	AdQuadratureGrid* grid;
+	
+	grid = AdCreateSmoothedGBQuadratureGrid(numberRadialPoints, numberAngularPoints, integrationStartPoint);
+	if(grid == NULL)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Unsupported integration grid - %d radial points, %d angular points", 
+			numberRadialPoints, numberAngularPoints];
+
+	return grid;
+}
 
 /**
-Creates the integrationPoint matrix of vectors and the
-radial and angular weight matrices.
+Sets quadratureGrid to the grid for the receivers integration start point and number 
+of radial and angular points.
+The grid is created the first time a configuration is used. It is read from
+the GBSWData resource directory if a cache of it is present there, otherwise it is generated.
+Caches are created with AdQuadratureGridGenerator (Base/Tools).
 */
 - (void) _initIntegrationVariables
 {
-	int i, j;
-	double radialDistance;
-	double* weightsBuffer, *pointsBuffer;
-	Vector3D* vector;
-	
-	//Create matrices
-	//One coordinate plus wieght
-	radialInfo = [memoryManager allocateMatrixWithRows: numberRadialPoints withColumns: 2];
-	//3 coordinates plus weight
-	angularInfo = [memoryManager allocateMatrixWithRows: numberAngularPoints withColumns: 4];
-
-	//Create a matrix of Vector3D structs to hold the position vectors of each integration point.
-	integrationPoints = AdAllocate3DVectorMatrix(numberRadialPoints, numberAngularPoints);     
-	    
-	//Generate the angular points - the number of angular points can only be certain values.
-	//The angular points are all unit vectors
-	
-	AdGenerateLebedevGrid(angularInfo); 
-	//Scale the weights so they add up to 4PI.
-	//This is the integral over the sphere of sin(theta)dtheta dphi which is the 
-	//angular part of the CFA integral. FIXME: Check validity of this
-	for(i=0; i < angularInfo->no_rows; i++)
-		angularInfo->matrix[i][3] *= 4*M_PI;
-	
-	//Generate the first set of radial points
-	weightsBuffer = malloc(5*sizeof(double));
-	pointsBuffer =  malloc(5*sizeof(double));
-	
-	//5 points up to 1 angstrom
-	AdGenerateGaussLegendrePoints(integrationStartPoint, 1, 5, pointsBuffer, weightsBuffer);
-	for(i=0; i<5; i++)
-	{	
-		radialInfo->matrix[i][0] = pointsBuffer[i];
-		radialInfo->matrix[i][1] = weightsBuffer[i];
-	}
+	NSString* key, *name;
+	NSValue* value;
+	AdQuadratureGrid* grid;
 	
-	weightsBuffer = realloc(weightsBuffer, 19*sizeof(double));
-	pointsBuffer = realloc(pointsBuffer, 19*sizeof(double));
-
-	//19 points to 20 angstroms
-	AdGenerateGaussLegendrePoints(1, 20, 19, pointsBuffer, weightsBuffer);
-	for(i=5; i<numberRadialPoints; i++)
-	{	
-		radialInfo->matrix[i][0] = pointsBuffer[i-5];
-		radialInfo->matrix[i][1] = weightsBuffer[i-5];
-	}
-	free(pointsBuffer);
-	free(weightsBuffer);
-		
-	double scaledDistance;		
-					
-	//Calculate the integration points
-	for(i=0; i<numberRadialPoints; i++)
+	//The key records the exact start point so nearby start points get their own grid
+	key = [NSString stringWithFormat: @"%d-%d-%a", 
+			numberRadialPoints, numberAngularPoints, integrationStartPoint];
+	
+	[quadratureLock lock];
+	NS_DURING
 	{
-		radialDistance = radialInfo->matrix[i][0];
-		//The radial weight of each point is the same
-		for(j=0; j<numberAngularPoints; j++)
+		value = [quadratureGrids objectForKey: key];
+		if(value == nil)
 		{
-			scaledDistance = radialDistance;
-					
-			vector = &integrationPoints[i][j];
-			//Place the angular point information into the vector struct
-			vector->vector[0] = scaledDistance*angularInfo->matrix[j][0];
-			vector->vector[1] = scaledDistance*angularInfo->matrix[j][1];
-			vector->vector[2] = scaledDistance*angularInfo->matrix[j][2];
-			
-			vector->length = scaledDistance;
+			name = [NSString stringWithFormat: @"Quadrature-%d-%d-%.2lf.bin", 
+					numberRadialPoints, numberAngularPoints, integrationStartPoint];
+			grid = [self _readQuadratureGrid: name];
+			if(grid == NULL)
+				grid = [self _generateQuadratureGrid];
+				
+			[quadratureGrids setObject: [NSValue valueWithPointer: grid] 
+				forKey: key];
 		}
-	}	
+		else
+			grid = [value pointerValue];
+	}
+	NS_HANDLER
+	{
+		[quadratureLock unlock];
+		[localException raise];
+	}
+	NS_ENDHANDLER
+	[quadratureLock unlock];
+	
+	quadratureGrid = grid;
 }
 
 - (void) _cleanUpIntegrationVariables
 {
-	[memoryManager freeMatrix: radialInfo];
-	[memoryManager freeMatrix: angularInfo];
-	AdFree3DVectorMatrix(integrationPoints);
+	//The grid is shared - just drop the reference.
+	quadratureGrid = NULL;
 }
 
 @end 
@@ -234,175 +263,342 @@ Methods for creating and updating the lookup table
 
 - (void) _freeNeighbourTable
 {
-	int i, numberGridPoints;
+	free(neighbourTable);
+	neighbourTable = NULL;
+	tableCapacity = 0;
+}
+
+- (int) _findGridPointsNearPosition: (double*) position 
+	ofAtom: (int) atomIndex 
+	buffers: (AdGBSWThreadBuffers*) buffers
+{
+	BOOL overlap;
+	int xIndex, yIndex, zIndex, closestPoint;
+	int range, capacity, count, gridIndex;
+	int indexes[3], lower[3], higher[3];
+	int* points;
+	double gridCut;
+	double** gMatrix;
+	Vector3D vector;
+
+	vector.vector[0] = position[0];
+	vector.vector[1] = position[1];
+	vector.vector[2] = position[2];
+	
+	//Check if the grid point exists.
+	closestPoint = [soluteGrid indexOfGridPointNearestToPoint: &vector 
+				indexes: indexes];
+	if(closestPoint == -1)
+		return -1;
+	
+	gMatrix = [soluteGrid grid]->matrix;
+	gridCut = gridCutMatrix->matrix[atomIndex][0];
+	
+	///The atom should always be a neighbour of its nearest grid point. 
+	if(!AdCheckGridPoint(position, gMatrix[closestPoint], gridCut, 0, meshSize, &overlap))
+		return -1;
+		
+	//This point could be a neighbour of grid points a maximum of gridCut + meshSize/2 away  
+	//in each direction.
+	//We need to check each of these.
+	range = ceil((gridCut + sqrt(3)*meshSize)/meshSize);
+	capacity = (2*range + 1)*(2*range + 1)*(2*range + 1);
+	if(capacity > buffers->gridPointsCapacity)
+	{
+		buffers->gridPoints.array = realloc(buffers->gridPoints.array, capacity*sizeof(int));
+		buffers->gridPointsCapacity = capacity;
+	}
+	
+	points = buffers->gridPoints.array;
+	points[0] = closestPoint;
+	count = 1;
+	
+	AdGetIndexCheckBounds(indexes, gridTicks, range, lower, higher);		
+	for(xIndex = lower[0]; xIndex < higher[0]; xIndex++)
+	{
+		for(yIndex = lower[1]; yIndex < higher[1]; yIndex++)
+		{
+			for(zIndex = lower[2]; zIndex < higher[2]; zIndex++)
+			{
+				gridIndex = gridTicks[2]*gridTicks[1]*xIndex + gridTicks[2]*yIndex + zIndex;
+				
+				//Skip the main point
+				if(gridIndex == closestPoint)
+					continue;
+				
+				if(AdCheckGridPoint(position, gMatrix[gridIndex], gridCut, 0, meshSize, &overlap))
+				{
+					points[count] = gridIndex;
+					count++;
+				}
+			}
+		}
+	}
 	
-	if(neighbourTable == NULL)
+	buffers->gridPoints.length = count;
+	
+	return count;
+}
+
+/*
+ * First pass of the table creation. Records the atoms table position and 
+ * counts it as a neighbour of each grid point it is near.
+ * Many threads can count the same point so the counts are updated atomically.
+ */
+- (void) _countGridNeighboursOfAtom: (int) atomIndex buffers: (AdGBSWThreadBuffers*) buffers
+{
+	int i, number;
+	double* position, *tablePosition;
+	
+	position = [system coordinates]->matrix[atomIndex];
+	tablePosition = tablePositions->matrix[atomIndex];
+	for(i=0; i<3; i++)
+		tablePosition[i] = position[i];
+	
+	number = [self _findGridPointsNearPosition: tablePosition
+			ofAtom: atomIndex
+			buffers: buffers];
+	if(number == -1)
+	{
+		__sync_bool_compare_and_swap(&tableBuildFailed, 0, 1);
 		return;
+	}
 	
-	numberGridPoints = [soluteGrid numberOfPoints];
+	for(i=0; i<number; i++)
+		__sync_fetch_and_add(numberNeighbours.array + buffers->gridPoints.array[i], 1);
+}
 
-	//Release last lookup table
-	for(i=0; i<numberGridPoints; i++)
+/*
+ * Second pass of the table creation. Adds the atom to each grid point it is near.
+ * The number of neighbours of each point is used to claim the next free entry.
+ */
+- (void) _addGridNeighboursOfAtom: (int) atomIndex buffers: (AdGBSWThreadBuffers*) buffers
+{
+	int i, number, gridIndex, entry;
+	
+	number = [self _findGridPointsNearPosition: tablePositions->matrix[atomIndex]
+			ofAtom: atomIndex
+			buffers: buffers];
+	for(i=0; i<number; i++)
 	{
-		if(neighbourTable[i] != NULL)	
-		{	
-			//NSZoneFree(lookupZone, neighbourTable[i]);
-			free(neighbourTable[i]);
-		}
+		gridIndex = buffers->gridPoints.array[i];
+		entry = __sync_fetch_and_add(numberNeighbours.array + gridIndex, 1);
+		neighbourTable[neighbourOffsets[gridIndex] + entry] = atomIndex;
 	}
+}
+
+/*
+ * Final pass of the table creation. The atoms are added to a point in the order the threads
+ * reach them so they are sorted to make the table independent of the number of threads.
+ */
+- (void) _finishGridPoint: (int) gridIndex buffers: (AdGBSWThreadBuffers*) buffers
+{
+	int i, j, atomIndex, length;
+	int* neighbours;
 	
-	//NSZoneFree(lookupZone, neighbourTable);
-	free(neighbourTable);
+	neighbours = neighbourTable + neighbourOffsets[gridIndex];
+	length = numberNeighbours.array[gridIndex];
+	for(i=1; i<length; i++)
+	{
+		atomIndex = neighbours[i];
+		for(j = i; j > 0 && neighbours[j - 1] > atomIndex; j--)
+			neighbours[j] = neighbours[j - 1];
+		
+		neighbours[j] = atomIndex;
+	}
+	
+	[self _setOverlapOfGridPoint: gridIndex];
+}
+
+/*
+ * An atom overlaps a point if it is within its overlap cut of the point.
+ * Since the atom may be up to cutBuffer away from its table position the overlap cut is
+ * reduced by cutBuffer.
+ */
+- (void) _setOverlapOfGridPoint: (int) gridIndex
+{
+	BOOL overlap;
+	int i, atomIndex, length;
+	int* neighbours;
+	double overlapCut;
+	double* pointPosition;
+	
+	neighbours = neighbourTable + neighbourOffsets[gridIndex];
+	length = numberNeighbours.array[gridIndex];
+	pointPosition = [soluteGrid grid]->matrix[gridIndex];
+	overlapBuffer[gridIndex] = 0;
+	for(i=0; i<length; i++)
+	{
+		atomIndex = neighbours[i];
+		overlapCut = pbRadii[atomIndex] - smoothingLength - cutBuffer;
+		AdCheckGridPoint(tablePositions->matrix[atomIndex], pointPosition, 
+			gridCutMatrix->matrix[atomIndex][0], overlapCut, meshSize, &overlap);
+		if(overlap)
+		{
+			overlapBuffer[gridIndex] = 1;
+			break;
+		}
+	}
 }
 
 /**
-Creates lookup table ...
+Creates lookup table. The neighbours of each point are counted, space for them is
+allocated in the table and then they are added. Each of these passes is performed by the thread team.
 */
 - (BOOL) _createLookupTable
 {
-	BOOL overlap, retval;
-	int counter = 0;
-	int i, xIndex, yIndex, zIndex, closestPoint;
-	int range, length;
-	int gridIndex, atomIndex, numberGridPoints;
-	int *array, ticksPerAxis[3]; 
-	int indexes[3], lower[3], higher[3];
-	double gridCut, gridCutSquared, overlapCut;
-	double* atomPosition, *pointPosition;
-	double **cMatrix, **gMatrix;
-	NSArray* divisions;
-	Vector3D vector;
-	
-	//Free last table
-	NSDebugLLog(@"AdSmoothedGBTerm" ,@"Freeing lookup table");
-	[self _freeNeighbourTable];
-	NSDebugLLog(@"AdSmoothedGBTerm" ,@"Done");
+	int i, numberGridPoints;
 	
-	//Create new table
 	numberGridPoints = [soluteGrid numberOfPoints];
-	//neighbourTable = NSZoneMalloc(lookupZone, numberGridPoints*sizeof(int*));
-	neighbourTable =  malloc(numberGridPoints*sizeof(int*));
+	memset(numberNeighbours.array, 0, numberGridPoints*sizeof(int));
+	tableBuildFailed = 0;
+	[self _runAtomLoop: @selector(_countGridNeighboursOfAtom:buffers:)];
+	if(tableBuildFailed)
+	{
+		//Leave an empty table
+		NSDebugLLog(@"AdSmoothedGBTerm", @"An atom is not covered by the lookup grid");
+		memset(numberNeighbours.array, 0, numberGridPoints*sizeof(int));
+		memset(neighbourOffsets, 0, (numberGridPoints + 1)*sizeof(int));
+		memset(overlapBuffer, 0, numberGridPoints*sizeof(uint_fast8_t));
+		return NO;
+	}
+	
+	//The counts are reset as they are used to place the neighbours.
+	neighbourOffsets[0] = 0;
 	for(i=0; i<numberGridPoints; i++)
 	{
-		neighbourTable[i] = calloc(10, sizeof(int));
-		//neighbourTable[i] = NSZoneCalloc(lookupZone, 10, sizeof(int));
+		neighbourOffsets[i+1] = neighbourOffsets[i] + numberNeighbours.array[i] + AD_GBSW_ROW_SLACK;
 		numberNeighbours.array[i] = 0;
 	}
-		
-	//Set up some vars	
-	cMatrix = [system coordinates]->matrix;
-	gMatrix = [soluteGrid grid]->matrix;
-	memset(overlapBuffer, 0, numberGridPoints*sizeof(uint_fast8_t));
 	
-	//Get ticks per axis
-	divisions = [soluteGrid divisions];
-	for(i=0; i<3; i++)
-		ticksPerAxis[i] = [[divisions objectAtIndex: i] intValue];
+	//The table is only reallocated if it grows.
+	if(neighbourOffsets[numberGridPoints] > tableCapacity)
+	{
+		free(neighbourTable);
+		tableCapacity = neighbourOffsets[numberGridPoints];
+		neighbourTable = malloc(tableCapacity*sizeof(int));
+	}
 	
-	retval = YES;
-	for(i=0; i<numberOfAtoms; i++)
+	[self _runAtomLoop: @selector(_addGridNeighboursOfAtom:buffers:)];
+	[self _runLoop: @selector(_finishGridPoint:buffers:) numberOfElements: numberGridPoints];
+	
+	NSDebugLLog(@"AdSmoothedGBTerm", @"Lookup table has %d entries for %d points", 
+		neighbourOffsets[numberGridPoints], numberGridPoints);
+	
+	return YES;
+}
+
+/**
+An atom is removed from the points it is near at its table position and added to the 
+points near its current position. The overlap of each changed point is then recalculated.
+If a point has no space for a new neighbour the table is recreated.
+*/
+- (BOOL) _updateLookupTableIncrementally
+{
+	BOOL retval = YES;
+	int i, j, k, number, length, movedAtoms, atomIndex, gridIndex;
+	int* moved, *neighbours, *points;
+	double separation, squaredBuffer;
+	double** coordinates;
+	double* tablePosition;
+	AdGBSWThreadBuffers* buffers;
+	
+	if(cutBuffer <= 0 || neighbourTable == NULL || tableBuildFailed)
+		return NO;
+	
+	//Find the atoms which are more than cutBuffer from their table positions
+	coordinates = [system coordinates]->matrix;
+	squaredBuffer = cutBuffer*cutBuffer;
+	moved = malloc(numberOfAtoms*sizeof(int));
+	for(movedAtoms = 0, i=0; i<numberOfAtoms; i++)
 	{
-		atomPosition = cMatrix[i];
-		
-		//Temp
-		vector.vector[0] = atomPosition[0];
-		vector.vector[1] = atomPosition[1];
-		vector.vector[2] = atomPosition[2];
+		tablePosition = tablePositions->matrix[i];
+		for(separation = 0, j=0; j<3; j++)
+			separation += (coordinates[i][j] - tablePosition[j])*(coordinates[i][j] - tablePosition[j]);
 		
-		//Check if the grid point exists.
-		gridIndex = [soluteGrid indexOfGridPointNearestToPoint: &vector 
-				indexes: indexes];
-		if(gridIndex == -1)
+		if(separation > squaredBuffer)
 		{
-			retval = NO;
-			break;
+			moved[movedAtoms] = i;
+			movedAtoms++;
 		}
-			
-		gridCut = gridCutMatrix->matrix[i][0];
-		overlapCut = pbRadii[i] - smoothingLength;
-		pointPosition = gMatrix[gridIndex];
+	}
+	
+	NSDebugLLog(@"AdSmoothedGBTerm", @"%d atoms moved in lookup table", movedAtoms);
+	if(movedAtoms > AD_GBSW_REBUILD_FRACTION*numberOfAtoms)
+	{
+		free(moved);
+		return NO;
+	}
+	
+	buffers = threadBuffers;
+	for(i=0; i<movedAtoms && retval; i++)
+	{
+		atomIndex = moved[i];
+		tablePosition = tablePositions->matrix[atomIndex];
 		
-		///The atom should always be a neighbour of its nearest grid point. 
-		if(AdCheckGridPoint(atomPosition, pointPosition, gridCut, overlapCut, meshSize, &overlap))
-		{
-			AdAddNeighbour(i, gridIndex, neighbourTable, &numberNeighbours);
-			if(overlap)
-			{
-				overlapBuffer[gridIndex] = 1;
-				counter++;
-			}
-		}
-		else
+		//Remove from the points near the table position
+		number = [self _findGridPointsNearPosition: tablePosition
+				ofAtom: atomIndex
+				buffers: buffers];
+		points = buffers->gridPoints.array;
+		for(j=0; j<number; j++)
 		{
-			NSWarnLog(@"Error - Atom %d is not a neighbour of its nearest grid point", i);
-			retval = NO;
-			break;
+			gridIndex = points[j];
+			neighbours = neighbourTable + neighbourOffsets[gridIndex];
+			length = numberNeighbours.array[gridIndex];
+			for(k=0; k<length && neighbours[k] != atomIndex; k++);
+			if(k == length)
+				continue;
+				
+			for(; k<length - 1; k++)
+				neighbours[k] = neighbours[k+1];
+			
+			numberNeighbours.array[gridIndex] = length - 1;
+			[self _setOverlapOfGridPoint: gridIndex];
 		}
 		
-		//This point could be a neighbour of grid points a maximum of gridCut + meshSize/2 away  
-		//in each direction.
-		//We need to check each of these.
-		range = ceil((gridCut + sqrt(3)*meshSize)/meshSize);
+		//Add to the points near the current position keeping the neighbours sorted
+		for(j=0; j<3; j++)
+			tablePosition[j] = coordinates[atomIndex][j];
 		
-		AdGetIndexCheckBounds(indexes, ticksPerAxis, range, lower, higher);		
-		
-		//Check these grid points
-		closestPoint = gridIndex;
-		for(xIndex = lower[0]; xIndex < higher[0]; xIndex++)
+		number = [self _findGridPointsNearPosition: tablePosition
+				ofAtom: atomIndex
+				buffers: buffers];
+		points = buffers->gridPoints.array;
+		if(number == -1)
+			retval = NO;
+			
+		for(j=0; j<number; j++)
 		{
-			for(yIndex = lower[1]; yIndex < higher[1]; yIndex++)
+			gridIndex = points[j];
+			neighbours = neighbourTable + neighbourOffsets[gridIndex];
+			length = numberNeighbours.array[gridIndex];
+			if(neighbourOffsets[gridIndex] + length == neighbourOffsets[gridIndex + 1])
 			{
-				for(zIndex = lower[2]; zIndex < higher[2]; zIndex++)
-				{
-					gridIndex = ticksPerAxis[2]*ticksPerAxis[1]*xIndex + ticksPerAxis[2]*yIndex + zIndex;
-					pointPosition = gMatrix[gridIndex];
-					
-					//Skip the main point
-					if(gridIndex == closestPoint)
-						continue;
-					
-					if(AdCheckGridPoint(atomPosition, pointPosition, gridCut, overlapCut, meshSize, &overlap))
-					{
-						//FIXME - Double checking
-						AdAddNeighbour(i, gridIndex, neighbourTable, &numberNeighbours);
-						if(overlap)
-						{
-							overlapBuffer[gridIndex] = 1;
-							counter++;
-						}
-					}
-				}
+				retval = NO;
+				break;
 			}
+			
+			for(k = length; k > 0 && neighbours[k - 1] > atomIndex; k--)
+				neighbours[k] = neighbours[k - 1];
+			
+			neighbours[k] = atomIndex;
+			numberNeighbours.array[gridIndex] = length + 1;
+			[self _setOverlapOfGridPoint: gridIndex];
 		}
 	}
 	
-	//trim the neighbour table and find grid points with no neighbours.
-	for(i=0; i<numberGridPoints; i++)
-	{
-		//realloc
-		array = neighbourTable[i];
-		length = numberNeighbours.array[i];
-		if(length == 0)
-		{
-			//NSZoneFree(lookupZone, array);
-			free(array);
-			neighbourTable[i] = NULL;
-		}
-		else
-		{
-			//neighbourTable[i] = NSZoneRealloc(lookupZone, array, length*sizeof(int));
-			neighbourTable[i] = realloc(array, length*sizeof(int));		
-		}
-	}
+	free(moved);
 	
 	return retval;
 }
 
 - (void) _createGrid
 {
+	int i;
 	double xDim, yDim, zDim;
 	NSNumber *number;
-	NSArray* spacing, *extremes, *axisExtremes;
+	NSArray* spacing, *extremes, *axisExtremes, *divisions;
 	NSArray *centre;
 
 	if(soluteGrid != nil)
@@ -431,6 +627,9 @@ Creates lookup table ...
 			yDimension: yDim 
 			zDimension: zDim];
 	soluteGrid = [[AdGrid alloc] initWithSpacing: spacing cavity: cavity];
+	divisions = [soluteGrid divisions];
+	for(i=0; i<3; i++)
+		gridTicks[i] = [[divisions objectAtIndex: i] intValue];
 	
 	//Create function pointer to indexOfGridPointNearestToPoint:
 	gridSelector = @selector(indexOfGridPointNearestToPoint:);	
@@ -450,6 +649,9 @@ Creates lookup table ...
 	//Array holding the number of atoms associated with each grid point
 	numberNeighbours.array = [memoryManager allocateArrayOfSize: sizeof(int)*[soluteGrid numberOfPoints]];
 	numberNeighbours.length = [soluteGrid numberOfPoints];
+	//Array holding the position of the neighbours of each point in the table
+	neighbourOffsets = [memoryManager allocateArrayOfSize: sizeof(int)*([soluteGrid numberOfPoints] + 1)];
+	tablePositions = [memoryManager allocateMatrixWithRows: numberOfAtoms withColumns: 3];
 	
 	//Array holding gridCut for each atom.
 	gridCutMatrix = [memoryManager allocateMatrixWithRows: numberOfAtoms withColumns:2];
@@ -468,7 +670,8 @@ Creates lookup table ...
 	overlapBuffer = calloc([soluteGrid numberOfPoints], sizeof(uint_fast8_t));
 		
 	//Create the lookup table.
-	neighbourTable = NULL;	
+	neighbourTable = NULL;
+	tableCapacity = 0;
 	[self _createLookupTable];
 	
 	//Set the search cutoff distance.
@@ -479,9 +682,9 @@ Creates lookup table ...
 	
 	//Find the first radial point after the cutoff
 	radialEnd = 0;
-	for(i=0; i<radialInfo->no_rows;i++)
+	for(i=0; i<numberRadialPoints;i++)
 	{
-		if(radialInfo->matrix[i][0] > cutoff)
+		if(quadratureGrid->radialDistances[i] > cutoff)
 		{
 			radialEnd = i;
 			break;
@@ -497,7 +700,9 @@ Creates lookup table ...
 	//NSZoneFree(lookupZone, overlapBuffer);
 	free(overlapBuffer);
 	[memoryManager freeMatrix: gridCutMatrix];
+	[memoryManager freeMatrix: tablePositions];
 	[memoryManager freeArray: numberNeighbours.array]; 
+	[memoryManager freeArray: neighbourOffsets];
 	
 	soluteGrid = nil;
 	cavity = nil;
@@ -507,6 +712,9 @@ Creates lookup table ...
 {
 	BOOL value;
 	
+	if([self _updateLookupTableIncrementally])
+		return;
+	
 	value = [self _createLookupTable];
 	//Check if all atoms were allocated to grid points
 	//FIXME: Possible change way to detecting need for grid change.
@@ -274,6 +274,11 @@
 	return couplingFactor;
 }
 	
+- (unsigned int) simulatorHooks
+{
+	return AdSimulatorDidPerformSecondVelocityUpdateHook;
+}
+
 - (void) simulatorWillPerformFirstVelocityUpdateForSystem: (AdSystem*) aSystem
 {
 	//Does nothing here
@@ -0,0 +1,612 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#include "AdunKernel/AdunBondConstraints.h"
+
+//Elements lighter than this are treated as hydrogens
+#define AD_HYDROGEN_MASS_LIMIT 1.5
+//Elements with masses in this range are treated as oxygens
+#define AD_OXYGEN_MASS_MIN 15.0
+#define AD_OXYGEN_MASS_MAX 17.0
+//Waters whose geometry differs from the settle geometry by more than this are shaken
+#define AD_WATER_GEOMETRY_TOLERANCE 1E-6
+
+/*
+ * The constraint information for a system.
+ */
+typedef struct
+{
+	AdConstraintSet* constraintSet;
+	double* reciprocalMasses;
+	AdMatrix* reference;	//The positions before the position update
+}
+AdSystemConstraints;
+
+@implementation AdBondConstraints
+
+/*
+ * Constraint creation
+ */
+
+/*
+ * Finds the waters in the bond topology. An oxygen is part of a water if it
+ * has two bonds, both to hydrogens, and neither hydrogen is bonded to anything else except
+ * the other hydrogen. The oxygen and hydrogens of each water are placed in waters,
+ * the two oxygen-hydrogen bonds of each water in waterBonds and the bonds are marked in bondUsed.
+ * The hydrogen-hydrogen distance of each water is placed in hydrogenDistances.
+ * Waters whose hydrogen-hydrogen distance cannot be determined are ignored.
+ * Returns the number of waters.
+ */
+- (int) _findWatersInBonds: (int*) bonds
+		lengths: (double*) lengths
+		numberOfBonds: (int) numberOfBonds
+		masses: (double*) masses
+		system: (AdSystem*) system
+		waters: (int*) waters
+		waterBonds: (int*) oxygenBonds
+		hydrogenDistances: (double*) hydrogenDistances
+		bondUsed: (BOOL*) bondUsed
+{
+	int i, j, k, oxygen, partner, numberOfElements, numberOfWaters;
+	int hydrogens[2], waterBonds[3];
+	int* bondCounts, *elementBonds;
+	double* angles;
+	AdDataMatrix* groups, *parameters;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	numberOfElements = [system numberOfElements];
+	bondCounts = [memoryManager allocateArrayOfSize: numberOfElements*sizeof(int)];
+	elementBonds = [memoryManager allocateArrayOfSize: 3*numberOfElements*sizeof(int)];
+	angles = [memoryManager allocateArrayOfSize: numberOfElements*sizeof(double)];
+	for(i=0; i<numberOfElements; i++)
+	{
+		bondCounts[i] = 0;
+		angles[i] = -1;
+	}
+
+	//Record up to three bonds for each element
+	for(i=0; i<numberOfBonds; i++)
+		for(j=0; j<2; j++)
+		{
+			k = bonds[2*i + j];
+			if(bondCounts[k] < 3)
+				elementBonds[3*k + bondCounts[k]] = i;
+
+			bondCounts[k]++;
+		}
+
+	//The water angles
+	if([[system availableInteractions] containsObject: @"HarmonicAngle"])
+	{
+		groups = [system groupsForInteraction: @"HarmonicAngle"];
+		parameters = [system parametersForInteraction: @"HarmonicAngle"];
+		for(i=0; i<(int)[groups numberOfRows]; i++)
+		{
+			k = [[groups elementAtRow: i column: 1] intValue];
+			if(masses[k] > AD_OXYGEN_MASS_MIN && masses[k] < AD_OXYGEN_MASS_MAX)
+				angles[k] = [[parameters elementAtRow: i
+						ofColumnWithHeader: @"Angle"] doubleValue];
+		}
+	}
+
+	for(numberOfWaters = 0, oxygen = 0; oxygen < numberOfElements; oxygen++)
+	{
+		if(bondCounts[oxygen] != 2
+			|| masses[oxygen] < AD_OXYGEN_MASS_MIN
+			|| masses[oxygen] > AD_OXYGEN_MASS_MAX)
+			continue;
+
+		for(j=0; j<2; j++)
+		{
+			waterBonds[j] = elementBonds[3*oxygen + j];
+			hydrogens[j] = (bonds[2*waterBonds[j]] == oxygen) ?
+				bonds[2*waterBonds[j] + 1] : bonds[2*waterBonds[j]];
+		}
+
+		if(masses[hydrogens[0]] > AD_HYDROGEN_MASS_LIMIT
+			|| masses[hydrogens[1]] > AD_HYDROGEN_MASS_LIMIT)
+			continue;
+
+		//Check for a hydrogen-hydrogen bond.
+		//Any other bond of the hydrogens means this is not a water.
+		waterBonds[2] = -1;
+		for(j=0; j<2; j++)
+		{
+			if(bondCounts[hydrogens[j]] == 1)
+				continue;
+
+			if(bondCounts[hydrogens[j]] > 2)
+				break;
+
+			k = elementBonds[3*hydrogens[j]];
+			if(k == waterBonds[j])
+				k = elementBonds[3*hydrogens[j] + 1];
+
+			partner = (bonds[2*k] == hydrogens[j]) ? bonds[2*k + 1] : bonds[2*k];
+			if(partner != hydrogens[1 - j])
+				break;
+
+			waterBonds[2] = k;
+		}
+
+		if(j != 2)
+			continue;
+
+		if(waterBonds[2] != -1)
+			hydrogenDistances[numberOfWaters] = lengths[waterBonds[2]];
+		else if(angles[oxygen] >= 0)
+			hydrogenDistances[numberOfWaters] = 2*lengths[waterBonds[0]]*sin(angles[oxygen]/2);
+		else
+			continue;
+
+		waters[3*numberOfWaters] = oxygen;
+		waters[3*numberOfWaters + 1] = hydrogens[0];
+		waters[3*numberOfWaters + 2] = hydrogens[1];
+		oxygenBonds[2*numberOfWaters] = waterBonds[0];
+		oxygenBonds[2*numberOfWaters + 1] = waterBonds[1];
+		for(j=0; j<3; j++)
+			if(waterBonds[j] != -1)
+				bondUsed[waterBonds[j]] = YES;
+
+		numberOfWaters++;
+	}
+
+	[memoryManager freeArray: bondCounts];
+	[memoryManager freeArray: elementBonds];
+	[memoryManager freeArray: angles];
+
+	return numberOfWaters;
+}
+
+/*
+ * Creates the constraints for system from its HarmonicBond interaction.
+ */
+- (AdSystemConstraints*) _constraintsForSystem: (AdSystem*) system
+{
+	int i, j, k, numberOfElements, numberOfBonds, numberOfWaters;
+	int numberOfConstraints, numberOfSettledWaters;
+	int oxygen, hydrogenOne, hydrogenTwo;
+	int* bonds, *waters, *waterBonds, *constrained;
+	double oxygenHydrogenDistance, hydrogenHydrogenDistance, oxygenMass, hydrogenMass;
+	double* masses, *lengths, *hydrogenDistances, *constrainedLengths;
+	BOOL* bondUsed;
+	NSArray* elementMasses;
+	AdDataMatrix* groups, *parameters;
+	AdSystemConstraints* constraints;
+	AdConstraintSet* constraintSet;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	numberOfElements = [system numberOfElements];
+	elementMasses = [system elementMasses];
+	masses = [memoryManager allocateArrayOfSize: numberOfElements*sizeof(double)];
+	for(i=0; i<numberOfElements; i++)
+		masses[i] = [[elementMasses objectAtIndex: i] doubleValue];
+
+	numberOfBonds = 0;
+	groups = parameters = nil;
+	if([[system availableInteractions] containsObject: @"HarmonicBond"])
+	{
+		groups = [system groupsForInteraction: @"HarmonicBond"];
+		parameters = [system parametersForInteraction: @"HarmonicBond"];
+		numberOfBonds = [groups numberOfRows];
+	}
+
+	bonds = [memoryManager allocateArrayOfSize: (2*numberOfBonds + 1)*sizeof(int)];
+	lengths = [memoryManager allocateArrayOfSize: (numberOfBonds + 1)*sizeof(double)];
+	bondUsed = [memoryManager allocateArrayOfSize: (numberOfBonds + 1)*sizeof(BOOL)];
+	for(i=0; i<numberOfBonds; i++)
+	{
+		bonds[2*i] = [[groups elementAtRow: i column: 0] intValue];
+		bonds[2*i + 1] = [[groups elementAtRow: i column: 1] intValue];
+		lengths[i] = [[parameters elementAtRow: i ofColumnWithHeader: @"Separation"] doubleValue];
+		bondUsed[i] = NO;
+	}
+
+	waters = [memoryManager allocateArrayOfSize: (numberOfElements + 1)*sizeof(int)];
+	waterBonds = [memoryManager allocateArrayOfSize: (numberOfElements + 1)*sizeof(int)];
+	hydrogenDistances = [memoryManager allocateArrayOfSize: (numberOfElements/3 + 1)*sizeof(double)];
+	numberOfWaters = 0;
+	if(constrainWater)
+		numberOfWaters = [self _findWatersInBonds: bonds
+					lengths: lengths
+					numberOfBonds: numberOfBonds
+					masses: masses
+					system: system
+					waters: waters
+					waterBonds: waterBonds
+					hydrogenDistances: hydrogenDistances
+					bondUsed: bondUsed];
+
+	/*
+	 * Waters with the same geometry as the first are settled.
+	 * The others are made rigid with three SHAKE constraints.
+	 */
+	constrained = [memoryManager allocateArrayOfSize: 2*(numberOfBonds + numberOfWaters + 1)*sizeof(int)];
+	constrainedLengths = [memoryManager allocateArrayOfSize: (numberOfBonds + numberOfWaters + 1)*sizeof(double)];
+	numberOfConstraints = 0;
+	numberOfSettledWaters = 0;
+	oxygenHydrogenDistance = hydrogenHydrogenDistance = oxygenMass = hydrogenMass = 0;
+	for(i=0; i<numberOfWaters; i++)
+	{
+		oxygen = waters[3*i];
+		hydrogenOne = waters[3*i + 1];
+		hydrogenTwo = waters[3*i + 2];
+		if(numberOfSettledWaters == 0)
+		{
+			oxygenHydrogenDistance = lengths[waterBonds[2*i]];
+			hydrogenHydrogenDistance = hydrogenDistances[i];
+			oxygenMass = masses[oxygen];
+			hydrogenMass = masses[hydrogenOne];
+		}
+
+		//The settled waters are moved to the start of waters
+		if(fabs(lengths[waterBonds[2*i]] - oxygenHydrogenDistance) < AD_WATER_GEOMETRY_TOLERANCE
+			&& fabs(lengths[waterBonds[2*i + 1]] - oxygenHydrogenDistance) < AD_WATER_GEOMETRY_TOLERANCE
+			&& fabs(hydrogenDistances[i] - hydrogenHydrogenDistance) < AD_WATER_GEOMETRY_TOLERANCE
+			&& masses[oxygen] == oxygenMass
+			&& masses[hydrogenOne] == hydrogenMass
+			&& masses[hydrogenTwo] == hydrogenMass)
+		{
+			waters[3*numberOfSettledWaters] = oxygen;
+			waters[3*numberOfSettledWaters + 1] = hydrogenOne;
+			waters[3*numberOfSettledWaters + 2] = hydrogenTwo;
+			numberOfSettledWaters++;
+			continue;
+		}
+
+		for(j=0; j<2; j++)
+		{
+			k = waterBonds[2*i + j];
+			constrained[2*numberOfConstraints] = bonds[2*k];
+			constrained[2*numberOfConstraints + 1] = bonds[2*k + 1];
+			constrainedLengths[numberOfConstraints] = lengths[k];
+			numberOfConstraints++;
+		}
+
+		constrained[2*numberOfConstraints] = hydrogenOne;
+		constrained[2*numberOfConstraints + 1] = hydrogenTwo;
+		constrainedLengths[numberOfConstraints] = hydrogenDistances[i];
+		numberOfConstraints++;
+	}
+
+	//The remaining bonds involving hydrogens
+	if(constrainHydrogenBonds)
+		for(i=0; i<numberOfBonds; i++)
+		{
+			if(bondUsed[i])
+				continue;
+
+			if(masses[bonds[2*i]] < AD_HYDROGEN_MASS_LIMIT
+				|| masses[bonds[2*i + 1]] < AD_HYDROGEN_MASS_LIMIT)
+			{
+				constrained[2*numberOfConstraints] = bonds[2*i];
+				constrained[2*numberOfConstraints + 1] = bonds[2*i + 1];
+				constrainedLengths[numberOfConstraints] = lengths[i];
+				numberOfConstraints++;
+			}
+		}
+
+	constraintSet = AdAllocateConstraintSet(numberOfConstraints, numberOfSettledWaters);
+	for(i=0; i<numberOfConstraints; i++)
+	{
+		constraintSet->elements[2*i] = constrained[2*i];
+		constraintSet->elements[2*i + 1] = constrained[2*i + 1];
+		constraintSet->lengths[i] = constrainedLengths[i];
+		constraintSet->lengthsSquared[i] = constrainedLengths[i]*constrainedLengths[i];
+	}
+
+	for(i=0; i<3*numberOfSettledWaters; i++)
+		constraintSet->waters[i] = waters[i];
+
+	if(numberOfSettledWaters > 0)
+		AdSetSettleParameters(constraintSet,
+			oxygenMass,
+			hydrogenMass,
+			oxygenHydrogenDistance,
+			hydrogenHydrogenDistance);
+
+	constraints = [memoryManager allocateArrayOfSize: sizeof(AdSystemConstraints)];
+	constraints->constraintSet = constraintSet;
+	constraints->reciprocalMasses = masses;
+	for(i=0; i<numberOfElements; i++)
+		masses[i] = 1/masses[i];
+
+	constraints->reference = [memoryManager allocateMatrixWithRows: numberOfElements
+					withColumns: 3];
+
+	[memoryManager freeArray: bonds];
+	[memoryManager freeArray: lengths];
+	[memoryManager freeArray: bondUsed];
+	[memoryManager freeArray: waters];
+	[memoryManager freeArray: waterBonds];
+	[memoryManager freeArray: hydrogenDistances];
+	[memoryManager freeArray: constrained];
+	[memoryManager freeArray: constrainedLengths];
+
+	NSDebugLLog(@"AdBondConstraints", @"System %@ - %d bond constraints. %d rigid waters (SETTLE)",
+		[system systemName], numberOfConstraints, numberOfSettledWaters);
+
+	return constraints;
+}
+
+- (void) _clearConstraints
+{
+	NSEnumerator* constraintsEnum;
+	AdSystemConstraints* constraints;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+	id value;
+
+	constraintsEnum = [systemConstraints objectEnumerator];
+	while((value = [constraintsEnum nextObject]))
+	{
+		constraints = [value pointerValue];
+		AdFreeConstraintSet(constraints->constraintSet);
+		[memoryManager freeArray: constraints->reciprocalMasses];
+		[memoryManager freeMatrix: constraints->reference];
+		[memoryManager freeArray: constraints];
+	}
+
+	[systemConstraints removeAllObjects];
+}
+
+- (void) _raiseConstraintExceptionForSystem: (AdSystem*) system
+{
+	NSError* error;
+
+	error = AdCreateError(AdunKernelErrorDomain,
+			AdKernelConstraintError,
+			@"Bond constraints could not be satisfied",
+			[NSString stringWithFormat:
+				@"SHAKE/RATTLE failed to converge in %d iterations for system %@.\n"
+				@"This indicates an exploding simulation.", maxIterations, [system systemName]],
+			@"Try minimising the system or reducing the time step");
+	[[NSException exceptionWithName: NSInternalInconsistencyException
+		reason: @"Bond constraints could not be satisfied"
+		userInfo: [NSDictionary dictionaryWithObject: error
+				forKey: @"AdKnownExceptionError"]]
+		raise];
+}
+
+/*
+ * Initialisation
+ */
+
+- (id) init
+{
+	return [self initWithTolerance: 1E-6 maxIterations: 500];
+}
+
+- (id) initWithTolerance: (double) aDouble maxIterations: (int) anInt
+{
+	if((self = [super init]))
+	{
+		[self setTolerance: aDouble];
+		maxIterations = anInt;
+		constrainWater = YES;
+		constrainHydrogenBonds = YES;
+		timeStep = 1;
+		systemConstraints = [NSMutableDictionary new];
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[self _clearConstraints];
+	[systemConstraints release];
+	[super dealloc];
+}
+
+- (NSString*) description
+{
+	return [NSString stringWithFormat:
+		@"%@. Tolerance %-8.2E. Max iterations %d. Hydrogen bonds %@. Rigid water %@",
+		NSStringFromClass([self class]), tolerance, maxIterations,
+		constrainHydrogenBonds ? @"YES" : @"NO",
+		constrainWater ? @"YES" : @"NO"];
+}
+
+/*
+ * AdSimulatorComponent
+ */
+
+- (void) simulator: (AdSimulator*) aSimulator
+		willBeginProductionWithSystems: (AdSystemCollection*) aSystemCollection
+		forceFields: (AdForceFieldCollection*) aForceFieldCollection
+{
+	NSEnumerator* systemEnum;
+	AdSystemConstraints* constraints;
+	AdSystem* system;
+
+	timeStep = [aSimulator timeStep];
+	[self _clearConstraints];
+	systemEnum = [[aSystemCollection fullSystems] objectEnumerator];
+	while((system = [systemEnum nextObject]))
+	{
+		constraints = [self _constraintsForSystem: system];
+		[systemConstraints setObject: [NSValue valueWithPointer: constraints]
+			forKey: [NSValue valueWithPointer: system]];
+		[system setNumberOfConstraints:
+			constraints->constraintSet->numberOfConstraints
+			+ 3*constraints->constraintSet->numberOfWaters];
+	}
+}
+
+- (unsigned int) simulatorHooks
+{
+	return AdSimulatorWillPerformPositionUpdateHook | AdSimulatorDidPerformPositionUpdateHook
+		| AdSimulatorDidPerformSecondVelocityUpdateHook;
+}
+
+- (void) simulatorWillPerformFirstVelocityUpdateForSystem: (AdSystem*) aSystem
+{
+	//Does nothing here
+}
+
+- (void) simulatorWillPerformPositionUpdateForSystem: (AdSystem*) aSystem
+{
+	AdSystemConstraints* constraints;
+
+	constraints = [[systemConstraints objectForKey: [NSValue valueWithPointer: aSystem]]
+			pointerValue];
+	if(constraints != NULL)
+		AdCopyAdMatrixToAdMatrix([aSystem coordinates], constraints->reference);
+}
+
+- (void) simulatorDidPerformPositionUpdateForSystem: (AdSystem*) aSystem
+{
+	int iterations;
+	AdSystemConstraints* constraints;
+	AdMatrix* coordinates, *velocities;
+
+	constraints = [[systemConstraints objectForKey: [NSValue valueWithPointer: aSystem]]
+			pointerValue];
+	if(constraints == NULL)
+		return;
+
+	coordinates = [aSystem coordinates];
+	velocities = [aSystem velocities];
+	[aSystem object: self willBeginWritingToMatrix: coordinates];
+	[aSystem object: self willBeginWritingToMatrix: velocities];
+
+	iterations = AdShakePositions(constraints->constraintSet,
+			constraints->reference->matrix,
+			coordinates->matrix,
+			velocities->matrix,
+			constraints->reciprocalMasses,
+			1/timeStep,
+			tolerance,
+			maxIterations);
+	AdSettlePositions(constraints->constraintSet,
+		constraints->reference->matrix,
+		coordinates->matrix,
+		velocities->matrix,
+		1/timeStep);
+
+	[aSystem object: self didFinishWritingToMatrix: velocities];
+	[aSystem object: self didFinishWritingToMatrix: coordinates];
+
+	if(iterations == -1)
+		[self _raiseConstraintExceptionForSystem: aSystem];
+}
+
+- (void) simulatorWillPerformSecondVelocityUpdateForSystem: (AdSystem*) aSystem
+{
+	//Does nothing here
+}
+
+- (void) simulatorDidPerformSecondVelocityUpdateForSystem: (AdSystem*) aSystem
+{
+	int iterations;
+	AdSystemConstraints* constraints;
+	AdMatrix* velocities;
+
+	constraints = [[systemConstraints objectForKey: [NSValue valueWithPointer: aSystem]]
+			pointerValue];
+	if(constraints == NULL)
+		return;
+
+	velocities = [aSystem velocities];
+	[aSystem object: self willBeginWritingToMatrix: velocities];
+	iterations = AdRattleVelocities(constraints->constraintSet,
+			[aSystem coordinates]->matrix,
+			velocities->matrix,
+			constraints->reciprocalMasses,
+			tolerance,
+			maxIterations);
+	AdSettleVelocities(constraints->constraintSet,
+		[aSystem coordinates]->matrix,
+		velocities->matrix);
+	[aSystem object: self didFinishWritingToMatrix: velocities];
+
+	if(iterations == -1)
+		[self _raiseConstraintExceptionForSystem: aSystem];
+}
+
+- (void) simulatorDidFinishProduction: (AdSimulator*) aSimulator
+{
+	//Does nothing here - The constraints remain valid for the
+	//current configurations so the number of constraints of each system isn't reset.
+}
+
+/*
+ * Accessors
+ */
+
+- (double) tolerance
+{
+	return tolerance;
+}
+
+- (void) setTolerance: (double) aDouble
+{
+	if(aDouble <= 0)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Constraint tolerance must be greater than 0"];
+
+	tolerance = aDouble;
+}
+
+- (int) maxIterations
+{
+	return maxIterations;
+}
+
+- (void) setMaxIterations: (int) anInt
+{
+	maxIterations = anInt;
+}
+
+- (BOOL) constrainWater
+{
+	return constrainWater;
+}
+
+- (void) setConstrainWater: (BOOL) value
+{
+	constrainWater = value;
+}
+
+- (BOOL) constrainHydrogenBonds
+{
+	return constrainHydrogenBonds;
+}
+
+- (void) setConstrainHydrogenBonds: (BOOL) value
+{
+	constrainHydrogenBonds = value;
+}
+
+- (unsigned int) numberOfConstraintsForSystem: (AdSystem*) aSystem
+{
+	AdSystemConstraints* constraints;
+
+	constraints = [[systemConstraints objectForKey: [NSValue valueWithPointer: aSystem]]
+			pointerValue];
+	if(constraints == NULL)
+		return 0;
+
+	return constraints->constraintSet->numberOfConstraints
+		+ 3*constraints->constraintSet->numberOfWaters;
+}
+
+@end
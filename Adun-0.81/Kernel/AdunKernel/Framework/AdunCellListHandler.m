@@ -22,6 +22,204 @@
    Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 */
 #include "AdunKernel/AdunCellListHandler.h"
+#include "AdunKernel/AdunCuboidBox.h"
+#include "AdunKernel/AdIndexSetConversions.h"
+
+//The number of consecutive elements processed by a build thread at a time
+#define AD_CELL_LIST_CHUNK 256
+
+/*
+ * The data shared by the parts of a list build.
+ * Each part takes chunks of AD_CELL_LIST_CHUNK elements in turn and writes
+ * the partners of their elements to its own buffer. The buffer and position of the
+ * partners of each chunk are recorded so the list can be assembled in element order.
+ */
+typedef struct
+{
+	int numberOfElements;
+	int numberOfChunks;
+	volatile int nextChunk;
+	bool periodic;
+	double cutoff_sq;
+	double cellCut;
+	AdMatrix* coordinates;
+	AdMatrix* cellCenters;
+	IntArrayStruct* cellNeighbours;
+	int* cellNumber;
+	int* cellStart;
+	int* cellContents;
+	double* cellPositions;
+	int* rangeOffsets;
+	int* ranges;
+	int* partnerCounts;
+	int* chunkBuffer;
+	int* chunkOffset;
+	IntArrayStruct* buffers;
+	int* capacities;
+	AdPeriodicBox* periodicBox;
+}
+AdCellListBuild;
+
+//Maps a cell index along an axis of a periodic cell space back into the space
+static inline int AdPeriodicCellIndex(int index, int numberOfCells)
+{
+	index %= numberOfCells;
+	if(index < 0)
+		index += numberOfCells;
+
+	return index;
+}
+
+/*
+ * Returns true if index is in one of the half open intervals [ranges[2i], ranges[2i+1]).
+ * The intervals are sorted and disjoint.
+ */
+static inline bool AdIndexInRanges(int index, int* ranges, int numberOfRanges)
+{
+	int low, high, middle;
+
+	low = 0;
+	high = numberOfRanges - 1;
+	while(low <= high)
+	{
+		middle = (low + high) >> 1;
+		if(index < ranges[2*middle])
+			high = middle - 1;
+		else if(index >= ranges[2*middle + 1])
+			low = middle + 1;
+		else
+			return true;
+	}
+
+	return false;
+}
+
+static inline void AdCellListBufferAppend(IntArrayStruct* buffer, int* capacity, int value)
+{
+	if(buffer->length == *capacity)
+	{
+		*capacity = (*capacity == 0) ? 4096 : 2*(*capacity);
+		buffer->array = realloc(buffer->array, *capacity*sizeof(int));
+	}
+
+	buffer->array[buffer->length] = value;
+	buffer->length++;
+}
+
+/*
+ * Finds the partners of atomIndex, see _buildList for details,
+ * appending them to buffer. Returns the number found.
+ */
+static int AdCellListFindPartners(AdCellListBuild* build, int atomIndex, IntArrayStruct* buffer, int* capacity)
+{
+	int i, j, k, cell, start, end, partner, count, numberOfRanges;
+	int* ranges;
+	double* position;
+	Vector3D separation;
+	IntArrayStruct* neighbourCells;
+
+	numberOfRanges = build->rangeOffsets[atomIndex + 1] - build->rangeOffsets[atomIndex];
+	if(numberOfRanges == 0)
+		return 0;
+
+	ranges = build->ranges + 2*build->rangeOffsets[atomIndex];
+	position = build->coordinates->matrix[atomIndex];
+	count = 0;
+
+	//The atoms in the current cell
+	cell = build->cellNumber[atomIndex];
+	for(i=build->cellStart[cell]; i<build->cellStart[cell+1]; i++)
+	{
+		partner = build->cellContents[i];
+		if(partner <= atomIndex)
+			continue;
+
+		if(build->periodic)
+		{
+			for(k=0; k<3; k++)
+				separation.vector[k] = position[k] - build->cellPositions[3*i + k];
+
+			AdMinimumImage(separation.vector, build->periodicBox);
+			Ad3DVectorLengthSquared(&separation);
+			if(separation.length >= build->cutoff_sq)
+				continue;
+		}
+
+		if(AdIndexInRanges(partner, ranges, numberOfRanges))
+		{
+			AdCellListBufferAppend(buffer, capacity, partner);
+			count++;
+		}
+	}
+
+	//The atoms in the neighbouring cells.
+	//The cell contents are in increasing index order so a cell whose last
+	//element is less than atomIndex can be skipped.
+	neighbourCells = &build->cellNeighbours[build->cellNumber[atomIndex]];
+	for(i=0; i<neighbourCells->length; i++)
+	{
+		cell = neighbourCells->array[i];
+		start = build->cellStart[cell];
+		end = build->cellStart[cell+1];
+		if(start == end || build->cellContents[end - 1] <= atomIndex)
+			continue;
+
+		for(j=0; j<3; j++)
+			separation.vector[j] = build->cellCenters->matrix[cell][j] - position[j];
+
+		if(build->periodic)
+			AdMinimumImage(separation.vector, build->periodicBox);
+
+		Ad3DVectorLength(&separation);
+		if(separation.length >= build->cellCut) 
+			continue;
+		
+		for(j=start; j < end; j++)
+		{
+			partner = build->cellContents[j];
+			if(partner <= atomIndex)
+				continue;
+
+			for(k=0; k<3; k++)
+				separation.vector[k] = position[k] - build->cellPositions[3*j + k];
+
+			if(build->periodic)
+				AdMinimumImage(separation.vector, build->periodicBox);
+
+			Ad3DVectorLengthSquared(&separation);
+			if(separation.length < build->cutoff_sq && 
+				AdIndexInRanges(partner, ranges, numberOfRanges))
+			{
+				AdCellListBufferAppend(buffer, capacity, partner);
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
+//Performs part \e index of a list build (see AdRunThreadTeam()).
+static void AdCellListBuildPart(void* argument, int index)
+{
+	int chunk, atomIndex, lastAtom;
+	AdCellListBuild* build = (AdCellListBuild*)argument;
+	IntArrayStruct* buffer = &build->buffers[index];
+	int* capacity = &build->capacities[index];
+
+	while((chunk = __sync_fetch_and_add(&build->nextChunk, 1)) < build->numberOfChunks)
+	{
+		build->chunkBuffer[chunk] = index;
+		build->chunkOffset[chunk] = buffer->length;
+		atomIndex = chunk*AD_CELL_LIST_CHUNK;
+		lastAtom = atomIndex + AD_CELL_LIST_CHUNK;
+		if(lastAtom > build->numberOfElements)
+			lastAtom = build->numberOfElements;
+
+		for(; atomIndex < lastAtom; atomIndex++)
+			build->partnerCounts[atomIndex] = AdCellListFindPartners(build, atomIndex, buffer, capacity);
+	}
+}
 
 /*
 Category containing methods for creating and
@@ -44,74 +242,62 @@ Cell Assignment
 
 - (void) _initialisationForCoordinates
 {
+	int numberOfChunks;
+
 	atomCells = [memoryManager allocateIntMatrixWithRows: coordinates->no_rows 
 			withColumns: 3];
 	cellNumber = [memoryManager allocateArrayOfSize: 
 			coordinates->no_rows*sizeof(int)];
-}
-
-//allocates the required interaction arrays
-
-- (void) _initialisationForInteractions
-{
-	int i;
-
-	updateCheckInteractions = [memoryManager allocateArrayOfSize:
-					[interactions count]*sizeof(IntArrayStruct)];
-	for(i = 0; i<(int)[interactions count]; i++)
-		updateCheckInteractions[i].array = NULL;
+	cellContents = [memoryManager allocateArrayOfSize: 
+			coordinates->no_rows*sizeof(int)];
+	cellPositions = [memoryManager allocateArrayOfSize: 
+			3*coordinates->no_rows*sizeof(double)];
+	partnerCounts = [memoryManager allocateArrayOfSize: 
+			coordinates->no_rows*sizeof(int)];
+	numberOfChunks = coordinates->no_rows/AD_CELL_LIST_CHUNK + 1;
+	chunkBuffer = [memoryManager allocateArrayOfSize: numberOfChunks*sizeof(int)];
+	chunkOffset = [memoryManager allocateArrayOfSize: numberOfChunks*sizeof(int)];
 }
 
 //frees the coordinate related matrices
 
 - (void) _clearCoordinateMatrices
 {
-	[memoryManager freeIntMatrix: atomCells];
+	if(atomCells != NULL)
+		[memoryManager freeIntMatrix: atomCells];
+
 	[memoryManager freeArray: cellNumber];
+	[memoryManager freeArray: cellContents];
+	[memoryManager freeArray: cellPositions];
+	[memoryManager freeArray: partnerCounts];
+	[memoryManager freeArray: chunkBuffer];
+	[memoryManager freeArray: chunkOffset];
+	atomCells = NULL;
+	cellNumber = NULL;
+	cellContents = NULL;
+	cellPositions = NULL;
+	partnerCounts = NULL;
+	chunkBuffer = NULL;
+	chunkOffset = NULL;
 }	
 
-/**
-Creates a matrix which holds the contents of each cell.
-Initially space to hold (numberAtoms/numberCells) atoms 
-is allocated for each cell.
-Note: Should just realloc the array associated with each cell
-to the base size and set its contents to 0.
-*/
-- (void) _initContentsArrays
-{
-	int i;
-
-	if(cellContentsMatrix == NULL)
-	{	
-		NSDebugLLog(@"AdCellListHandler", 
-			@"Allocating cellContentsMatrix (%@)", 
-			NSStringFromClass([self class]));
-		cellContentsMatrix = [memoryManager allocateArrayOfSize:
-					numberOfCells*sizeof(IntArrayStruct)];
-	}	
-	else
-	{
-		for(i=0; i< numberOfCells; i++)
-			free(cellContentsMatrix[i].array);
-	}		
-				
-	baseSize = (int)ceil(((double)coordinates->no_rows)/(double)numberOfCells);
-	for(i=0; i<numberOfCells; i++)
-	{	
-		cellContentsMatrix[i].array = (int*)malloc(baseSize*sizeof(int));
-		cellContentsMatrix[i].length = 0;
-	}
-}
-
 /*
- * For each atom assign it an x,y,z z cell index which tells you the cell its in.
- * For more information on the process see _updateCellIndexes:
+ * Assigns each atom to a cell and sorts the atoms by cell.
+ * For more information on the process see below.
+ *
+ * The cell contents are stored contiguously - the atoms in cell i are
+ * cellContents[cellStart[i]] to cellContents[cellStart[i+1] - 1].
+ * They are created by a counting sort. Once the cell of each atom is known the number of atoms in each cell is counted.
+ * The start of each cell is then given by the cumulative sum of the counts and finally
+ * each atom is placed in its cell. Since the atoms are placed in index order the contents
+ * of each cell are in increasing index order.
+ * If no atom has changed cell since the last call the contents are not recreated.
+ * No memory is allocated.
+ * Returns NO if the cell space is not periodic and an atom is outside it.
  */
-- (BOOL) _assignCellIndexes 
+- (BOOL) _sortElementsIntoCells
 {
-	BOOL assignmentSuccess = YES;
-	int i, j;
-	IntArrayStruct* cellContentsArray;
+	int i, j, number, numberOfMoves;
 
 	//this exception is generic since we dont want it to be caught with the one below
 
@@ -119,67 +305,7 @@ to the base size and set its contents to 0.
 		[NSException raise: NSGenericException 
 			format: @"No atom coordinates set. Cannot build interaction list"];
 
-	/*
-	 * Recreate the cell contents matrix.
-	 * This step is probably inefficent. 
-	 * Must be a better way to update the cell contents
-	 */
-	[self _initContentsArrays];
-
-	NSDebugLLog(@"AdCellListHandler", @"Assigning atoms to cells");
-
-	//find the cell coordinates and cell number for each atom
-	//add that atom to atomsInCell array
-
-	for(i=0; i<coordinates->no_rows; i++)
-	{
-		for(j=0; j<3; j++)
-			atomCells->matrix[i][j] = (int)floor((coordinates->matrix[i][j] - minSpaceBoundry.vector[j])/cellSize);
-		
-		cellNumber[i] = (cellsPerAxis[2]*cellsPerAxis[1])*atomCells->matrix[i][0];
-		cellNumber[i] += cellsPerAxis[2]*atomCells->matrix[i][1]; 
-		cellNumber[i] += atomCells->matrix[i][2];
-
-		cellContentsArray = &cellContentsMatrix[cellNumber[i]];
-		if(cellNumber[i] > numberOfCells || cellNumber[i] < 0)
-		{
-			assignmentSuccess = NO;
-			break;
-		}	
-
-		if(cellContentsArray->length >= baseSize)
-			cellContentsArray->array = realloc(cellContentsArray->array, (cellContentsArray->length + 1)*sizeof(int));
-		
-		cellContentsArray->array[cellContentsArray->length] = i;
-		cellContentsArray->length++; 
-	}
-
-	//Trim the cell contents arrays where necessary
-	//We have to do this regardless of whether the entire assignment 
-	//process succeded or not
-	for(i=0; i<numberOfCells; i++)
-		cellContentsMatrix[i].array = realloc(cellContentsMatrix[i].array, cellContentsMatrix[i].length*sizeof(int));
-
-	NSDebugLLog(@"AdCellListHandler", @"Complete");
-
-	return assignmentSuccess;
-}	
-
-- (BOOL) _updateCellIndexes 
-{
-	BOOL updateSuccess = YES;
-	int i,j,k;
-	int number;
-	int *new;
-	IntArrayStruct* cellContentsArray;
-
-	//this exception is generic since we dont want it to be caught with the one below
-
-	if(coordinates == NULL)
-		[NSException raise: NSGenericException 
-			format: @"No atom coordinates set. Cannot build interaction list"];
-
-	for(i=0; i<coordinates->no_rows; i++)
+	for(numberOfMoves = 0, i=0; i<coordinates->no_rows; i++)
 	{
 		/*
 		  Calculate what cell this atom is now in. 
@@ -199,18 +325,20 @@ to the base size and set its contents to 0.
 		  each direction has index 0 following the C convention for arrays).
 
 		  We must do the same thing if the index < 0
+
+		  If the space is periodic atoms that left it are mapped back
+		  into it instead.
 		*/
 
 		for(j=0; j<3; j++)
 		{
-			atomCells->matrix[i][j] = (int)floor((coordinates->matrix[i][j] - minSpaceBoundry.vector[j])/cellSize);
-			if(atomCells->matrix[i][j] >= cellsPerAxis[j] || atomCells->matrix[i][j] < 0)
-				updateSuccess = NO;
+			atomCells->matrix[i][j] = (int)floor((coordinates->matrix[i][j] - minSpaceBoundry.vector[j])/cellLengths[j]);
+			if(periodic)
+				atomCells->matrix[i][j] = AdPeriodicCellIndex(atomCells->matrix[i][j], cellsPerAxis[j]);
+			else if(atomCells->matrix[i][j] >= cellsPerAxis[j] || atomCells->matrix[i][j] < 0)
+				return NO;
 		}
 
-		if(!updateSuccess)
-			break;
-
 		/*
 		  Calculate the index of the cell this atom is in.
 		  The cells are assigned indexes (single numbers) by counting first
@@ -226,53 +354,34 @@ to the base size and set its contents to 0.
 
 		if(number != cellNumber[i])
 		{
-			//remove from old array 
-			//\note - make these functions
-			cellContentsArray = &cellContentsMatrix[cellNumber[i]];
-			new = malloc((cellContentsArray->length - 1)*sizeof(int));
-			
-			for(k = 0, j=0; k< cellContentsArray->length; k++)
-				if(cellContentsArray->array[k] != i)
-				{
-					new[j] = cellContentsArray->array[k];
-					j++;
-				}	
-
-			cellContentsArray->length = cellContentsArray->length -1;
-			free(cellContentsArray->array);
-			cellContentsArray->array = new;
-			
-			if(j != cellContentsArray->length)
-				NSWarnLog(@"Warning %d %d", j, cellContentsArray->length);
-
-			//add to new array
-			
-			cellContentsArray = &cellContentsMatrix[number];
-			new = malloc((cellContentsArray->length + 1)*sizeof(int));
-			for(k = 0, j=0 ; k < cellContentsArray->length; k++)
-			{
-				if(cellContentsArray->array[k] > i && j == k)
-				{
-					new[j] = i;
-					j++;
-				}
-
-				new[j] = cellContentsArray->array[k];
-				j++;
-			}		
-
-			if(j == k)
-				new[j] = i;
-			
-			cellContentsArray->length++;
-			free(cellContentsArray->array);
-			cellContentsArray->array = new;
-
 			cellNumber[i] = number;
+			numberOfMoves++;
 		}
 	}
 
-	return updateSuccess;
+	NSDebugLLog(@"AdCellListHandler", @"%d atoms changed cell", numberOfMoves);
+	if(numberOfMoves == 0)
+		return YES;
+
+	for(i=0; i<=numberOfCells; i++)
+		cellStart[i] = 0;
+
+	for(i=0; i<coordinates->no_rows; i++)
+		cellStart[cellNumber[i] + 1]++;
+
+	for(i=0; i<numberOfCells; i++)
+	{
+		cellStart[i+1] += cellStart[i];
+		cellCursor[i] = cellStart[i];
+	}	
+
+	for(i=0; i<coordinates->no_rows; i++)
+	{
+		cellContents[cellCursor[cellNumber[i]]] = i;
+		cellCursor[cellNumber[i]]++;
+	}
+
+	return YES;
 }	
 
 /**********************
@@ -281,36 +390,218 @@ Create List Elements
 
 **********************/
 
-- (void) _clearListDependants
+//Frees the pair list. A new one is allocated by createList.
+
+- (void) _clearPairList
 {
-	int i;
+	AdFreePairList(pairList);
+	pairList = NULL;
+}
+
+//Frees the allowed ranges created by _loadAllowedRanges
+- (void) _clearAllowedRanges
+{
+	[memoryManager freeArray: rangeOffsets];
+	[memoryManager freeArray: allowedRanges];
+	rangeOffsets = NULL;
+	allowedRanges = NULL;
+}
+
+/*
+ * Creates the intervals used by _loadAllowedRanges (see below) directly from the
+ * lower bound and exclusions of each element of an AdNonbondedPairArray.
+ * The intervals of an element are the gaps between its exclusions.
+ */
+- (void) _loadAllowedRangesFromPairArray
+{
+	int i, j, start, count, numberOfRanges, numberOfInteractionSets, numberOfPairElements;
+	int* excluded;
+
+	[self _clearAllowedRanges];
+	numberOfInteractionSets = [interactions count];
+	numberOfPairElements = [(AdNonbondedPairArray*)interactions numberOfElements];
+	rangeOffsets = [memoryManager allocateArrayOfSize: (numberOfInteractionSets + 1)*sizeof(int)];
 	
-	if(updateCheckInteractions != NULL)
-		for(i=0; i< (int)[interactions count]; i++)
-			free(updateCheckInteractions[i].array);
-}	
+	//Count the ranges - At most one more than the number of exclusions.
+	rangeOffsets[0] = 0;
+	for(i=0; i<numberOfInteractionSets; i++)
+	{
+		[(AdNonbondedPairArray*)interactions exclusionsForElement: i count: &count];
+		rangeOffsets[i+1] = rangeOffsets[i] + count + 1;
+	}
+
+	allowedRanges = [memoryManager allocateArrayOfSize: 
+				(2*rangeOffsets[numberOfInteractionSets] + 1)*sizeof(int)];
+	numberOfRanges = 0;
+	for(i=0; i<numberOfInteractionSets; i++)
+	{
+		start = [(AdNonbondedPairArray*)interactions lowerBoundForElement: i];
+		excluded = [(AdNonbondedPairArray*)interactions exclusionsForElement: i count: &count];
+		rangeOffsets[i] = numberOfRanges;
+		for(j=0; j<=count; j++)
+		{
+			//The final gap extends to the last element
+			if(j < count && excluded[j] > start)
+			{
+				allowedRanges[2*numberOfRanges] = start;
+				allowedRanges[2*numberOfRanges + 1] = excluded[j];
+				numberOfRanges++;
+			}
+			else if(j == count && numberOfPairElements > start)
+			{
+				allowedRanges[2*numberOfRanges] = start;
+				allowedRanges[2*numberOfRanges + 1] = numberOfPairElements;
+				numberOfRanges++;
+			}
+
+			if(j < count)
+				start = excluded[j] + 1;
+		}
+	}
+	rangeOffsets[numberOfInteractionSets] = numberOfRanges;
+
+	NSDebugLLog(@"AdCellListHandler", @"%d allowed ranges for %d elements (from exclusions)", 
+		numberOfRanges, numberOfInteractionSets);
+}
 
-- (BOOL) _checkInteractionBetweenAtomOne: (int) atomOne atomTwo: (int) atomTwo
+/*
+ * Converts the allowed pairs to a compact sorted form which is used when building the list.
+ * The index set of each element is stored as a sorted array of half open index intervals.
+ * The intervals of element i are allowedRanges[2*rangeOffsets[i]] to allowedRanges[2*rangeOffsets[i+1] - 1].
+ * Since the allowed pairs of an element are usually all higher elements less a few bonded ones
+ * each element only has a few intervals and checking if a pair is allowed
+ * is a short binary search. 
+ */
+- (void) _loadAllowedRanges
 {
-	int l;
-	ListElement* el_p;
-	Vector3D seperation;
+	int i, j, length, numberOfRanges, numberOfInteractionSets;
+	NSRange* rangeArray;
+	NSEnumerator* interactionEnum;
+	NSIndexSet* interaction;
 
-	for(l = 0; l < 3; l++)
-		seperation.vector[l] = coordinates->matrix[atomOne][l] - coordinates->matrix[atomTwo][l];
+	if([interactions isKindOfClass: [AdNonbondedPairArray class]])
+	{
+		[self _loadAllowedRangesFromPairArray];
+		return;
+	}
 
-	Ad3DVectorLengthSquared(&seperation);
+	[self _clearAllowedRanges];
+	numberOfInteractionSets = [interactions count];
+	rangeOffsets = [memoryManager allocateArrayOfSize: (numberOfInteractionSets + 1)*sizeof(int)];
+	
+	//Count the ranges
+	rangeOffsets[0] = 0;
+	interactionEnum = [interactions objectEnumerator];
+	for(i=0; (interaction = [interactionEnum nextObject]); i++)
+	{
+		rangeArray = [interaction indexSetToRangeArrayOfLength: &length];
+		free(rangeArray);
+		rangeOffsets[i+1] = rangeOffsets[i] + length;
+	}
 
-	if(seperation.length < cutoff_sq)
+	numberOfRanges = rangeOffsets[numberOfInteractionSets];
+	allowedRanges = [memoryManager allocateArrayOfSize: (2*numberOfRanges + 1)*sizeof(int)];
+	interactionEnum = [interactions objectEnumerator];
+	for(i=0; (interaction = [interactionEnum nextObject]); i++)
 	{
-		el_p = 	getElement(nonbondedList, @selector(getNewListElement));
-		el_p->bond[0] = atomOne;
-		el_p->bond[1] = atomTwo;
-		el_p->length = 0;
-		return YES;
+		rangeArray = [interaction indexSetToRangeArrayOfLength: &length];
+		for(j=0; j<length; j++)
+		{
+			allowedRanges[2*(rangeOffsets[i] + j)] = rangeArray[j].location;
+			allowedRanges[2*(rangeOffsets[i] + j) + 1] = NSMaxRange(rangeArray[j]);
+		}
+		free(rangeArray);
 	}
-		
-	return NO;
+
+	NSDebugLLog(@"AdCellListHandler", @"%d allowed ranges for %d elements", 
+		numberOfRanges, numberOfInteractionSets);
+}
+
+/*
+ * Fills pairList with all the allowed pairs that are separated by less than the cutoff.
+ * The pairs of each atom are added in index order so the resulting list is contiguous. 
+ *
+ * For each atom the possible partners are all other atoms in its cell plus all atoms in 
+ * neighbouring cells (as long as part of the neighbouring cell is within the cutoff).
+ * A part of a neighbouring cell is within the cutoff distance of the atom in question 
+ * if the distance from the atom to the center of the neighbouring cell is less 
+ * than cutoff + diagonal. 
+ * Atoms in the same cell are always within the cutoff since the cell diagonal is less than it.
+ * This does not hold for periodic spaces, where the cells may be slightly larger, so there the
+ * distance is checked. In periodic spaces all separations use the minimum image convention.
+ *
+ * The atoms are processed in chunks by numberOfThreads parts run on the shared thread team
+ * (see AdCellListBuildPart()). If there are only a few chunks per part the list is built in one part.
+ * The partners found by each part are kept in buffers which are reused by subsequent builds.
+ * The coordinates are first copied in cell order so the coordinates of the atoms in each 
+ * cell are contiguous in memory.
+ */
+- (void) _buildList
+{
+	int i, j, chunk, atomIndex, lastAtom, numberOfPairs, numberOfParts;
+	int* partners;
+	double* position;
+	AdCellListBuild build;
+
+	for(position = cellPositions, i=0; i<coordinates->no_rows; i++)
+		for(j=0; j<3; j++, position++)
+			*position = coordinates->matrix[cellContents[i]][j];
+
+	build.numberOfElements = [interactions count];
+	build.numberOfChunks = (build.numberOfElements + AD_CELL_LIST_CHUNK - 1)/AD_CELL_LIST_CHUNK;
+	build.nextChunk = 0;
+	build.periodic = periodic;
+	build.cutoff_sq = cutoff_sq;
+	build.cellCut = cutoff + diagonal;
+	build.coordinates = coordinates;
+	build.cellCenters = cellCenterMatrix;
+	build.cellNeighbours = cellNeighbourMatrix;
+	build.cellNumber = cellNumber;
+	build.cellStart = cellStart;
+	build.cellContents = cellContents;
+	build.cellPositions = cellPositions;
+	build.rangeOffsets = rangeOffsets;
+	build.ranges = allowedRanges;
+	build.partnerCounts = partnerCounts;
+	build.chunkBuffer = chunkBuffer;
+	build.chunkOffset = chunkOffset;
+	build.buffers = threadBuffers;
+	build.capacities = bufferCapacities;
+	build.periodicBox = &periodicBox;
+
+	numberOfParts = 1;
+	if(numberOfThreads > 1 && build.numberOfChunks >= 4*numberOfThreads)
+		numberOfParts = numberOfThreads;
+
+	for(i=0; i<numberOfParts; i++)
+		threadBuffers[i].length = 0;
+
+	AdRunThreadTeam(AdSharedThreadTeam(), AdCellListBuildPart, &build, numberOfParts);
+
+	//Assemble the list in element order
+	for(numberOfPairs=0, i=0; i<numberOfParts; i++)
+		numberOfPairs += threadBuffers[i].length;
+
+	AdPairListClear(pairList);
+	AdPairListReserve(pairList, numberOfPairs);
+	AdPairListSetPeriodicBox(pairList, periodic ? &periodicBox : NULL);
+	for(chunk=0; chunk<build.numberOfChunks; chunk++)
+	{
+		partners = threadBuffers[chunkBuffer[chunk]].array + chunkOffset[chunk];
+		atomIndex = chunk*AD_CELL_LIST_CHUNK;
+		lastAtom = atomIndex + AD_CELL_LIST_CHUNK;
+		if(lastAtom > build.numberOfElements)
+			lastAtom = build.numberOfElements;
+
+		for(; atomIndex < lastAtom; atomIndex++)
+			if(partnerCounts[atomIndex] != 0)
+			{
+				AdPairListAppendElement(pairList, atomIndex, partners, partnerCounts[atomIndex]);
+				partners += partnerCounts[atomIndex];
+			}
+	}
+
+	AdPairListFinalise(pairList);
 }
 
 //Called when the systems contents change. We re-aquire coordinates
@@ -327,16 +618,12 @@ Create List Elements
 	//Deallocated all current cell and coordinate related ivars.
 	[self clearCellMatrices];
 	[self _clearCoordinateMatrices];
-	[self _clearListDependants];
 	[interactions release];
 	interactions = nil;
+	[self _clearAllowedRanges];
 	
-	if(updateCheckInteractions != NULL)
-		free(updateCheckInteractions);
-
 	//Dealloc the list
-	[nonbondedList release];
-	nonbondedList = nil;
+	[self _clearPairList];
 
 	//Update state ivars.
 	listCreated = NO;
@@ -372,11 +659,14 @@ Public Methods
 	{
 		[self update];
 		[description appendFormat: @"System: %@. Cutoff: %5.2lf. Number interactions: %d\n",
-			[system systemName], cutoff, [nonbondedList listCount]];
+			[system systemName], cutoff, pairList->numberOfPairs];
 		[description appendFormat: @"\tSpace dimensions: (%10.5lf, %10.5lf, %10.5lf)\n",	
 			cellSpaceDimensions.vector[0], cellSpaceDimensions.vector[1], cellSpaceDimensions.vector[2]];
 		[description appendFormat: @"\tCells per axis: (%d, %d, %d)\n",
 			cellsPerAxis[0], cellsPerAxis[1], cellsPerAxis[2]];		
+		[description appendFormat: @"\tBuild threads: %d\n", numberOfThreads];
+		if(periodic)
+			[description appendString: @"\tPeriodic boundaries\n"];
 	}
 	else
 		[description appendString: @"No system set\n"];
@@ -386,18 +676,6 @@ Public Methods
 
 - (void) createList
 {
-	int i,j;
-	int atomIndex, cell, holder;
-	int check, nocheck;
-	int* inter;
-	uint_fast8_t *bin; 
-	int (*interact)(id, SEL, int*, int, NSRangePointer);
-	ListElement* el_p;
-	IntArrayStruct *checkInteractions, *cellContentsBuffer;
-	IntArrayStruct interactionBuffer, neighbourCells, nocheckBuffer;
-	NSEnumerator* interactionsEnum;
-	NSMutableIndexSet *interaction;
-
 	//If a list already exists do nothing. listCreated is only set
 	//to NO if a new system of array of allowed pairs is set.
 	if(listCreated)
@@ -416,179 +694,51 @@ Public Methods
 	if(!cellsInitialised)
 		[self initialiseCells];
 
-	NSDebugLLog(@"AdCellListHandler", @"Building Interaction List (%@).", NSStringFromClass([self class]));
+	if(rangeOffsets == NULL)
+		[self _loadAllowedRanges];
 
-	//create a new list and deref getNewListElement
-	nonbondedList = [AdLinkedList new];
-	getElement = (ListElement* (*)(id, SEL))[nonbondedList methodForSelector:@selector(getNewListElement)];
+	NSDebugLLog(@"AdCellListHandler", @"Building Interaction List (%@).", NSStringFromClass([self class]));
 
 	//The coordinates of the elements may not be accomadated by the current
 	//cell space. We have to catch this eventuality and act accordingly.
-	if(![self _assignCellIndexes])
+	if(![self _sortElementsIntoCells])
 	{
 		NSDebugLLog(@"AdCellListHandler", @"The coordinates space has changed. Recalculating the cell space");
 		[self clearCellMatrices];
 		[self initialiseCells];
-		[self _assignCellIndexes];
+		[self _sortElementsIntoCells];
 	}
-	
-	interactionBuffer.array = (int*)malloc(coordinates->no_rows*sizeof(int));
-	nocheckBuffer.array = (int*)malloc(coordinates->no_rows*sizeof(int));
-	inter = interactionBuffer.array;
-	bin = (uint_fast8_t*)calloc(coordinates->no_rows,sizeof(uint_fast8_t));
-
-	atomIndex = 0;
-	interactionsEnum = [interactions objectEnumerator];
 
+	//Start with space for 100 pairs per element. The list grows as necessary.
+	if(pairList == NULL)
+		pairList = AdAllocatePairList(coordinates->no_rows, 100*coordinates->no_rows);
+	
 	NSDebugLLog(@"AdCellListHandler",
 		@"There are %d interactions for system %@", [interactions count], [system systemName]);
-	while((interaction = [interactionsEnum nextObject]))
-	{
-		if(([interaction count] == 0))
-		{
-			atomIndex++;
-			continue;
-		}	
-		
-		//load this atoms interactions into a buffer
-
-		interact = (int (*)(id, SEL, int*, int, NSRangePointer))[interaction methodForSelector: 
-					@selector(getIndexes:maxCount:inIndexRange:)];
-		interactionBuffer.length = interact(interaction, 
-							@selector(getIndexes:maxCount:inIndexRange:), 
-							interactionBuffer.array, 
-							coordinates->no_rows,
-							NULL);
-		
-		for(i=0; i<interactionBuffer.length; i++)
-			bin[interactionBuffer.array[i]] = 1;
-		
-		//get the atoms in the current cell
-
-		cellContentsBuffer = &cellContentsMatrix[cellNumber[atomIndex]];
-		for(nocheck=0, i = 0; i<cellContentsBuffer->length; i++)
-		{
-			holder = cellContentsBuffer->array[i];
-			if(bin[holder])
-			{
-				nocheckBuffer.array[nocheck] = holder;
-				nocheck++;
-			}
-		}
-
-		//load the neighbourcell contents into a buffer
-		
-		neighbourCells = cellNeighbourMatrix[cellNumber[atomIndex]];
-		for(check=0, i=0; i<neighbourCells.length; i++)
-		{
-			cell = neighbourCells.array[i];
-			cellContentsBuffer = &cellContentsMatrix[neighbourCells.array[i]];
-			if(cellContentsBuffer->length != 0)
-				for(j=0; j < cellContentsBuffer->length; j++)
-				{
-					holder = cellContentsBuffer->array[j];
-					if(bin[holder])
-					{
-						inter[check] = holder;
-						check++;
-					}
-				}
-		}
-
-		checkInteractions = &updateCheckInteractions[atomIndex];
-		checkInteractions->array = malloc((check+nocheck)*sizeof(int));
-		checkInteractions->length = 0;
-
-		for(j=0; j<check; j++)
-			if([self _checkInteractionBetweenAtomOne: atomIndex atomTwo: inter[j]])
-			{
-				checkInteractions->array[checkInteractions->length] = inter[j];
-				checkInteractions->length++;
-			}					
-
-		for(i=0;i<nocheck; i++)
-		{	
-			el_p = 	getElement(nonbondedList, @selector(getNewListElement));
-			el_p->bond[0] = atomIndex;
-			el_p->bond[1] = nocheckBuffer.array[i];
-			el_p->length = 0;
-			checkInteractions->array[checkInteractions->length] = nocheckBuffer.array[i];
-			checkInteractions->length++;
-		}
-		
-		checkInteractions->array = realloc(checkInteractions->array, checkInteractions->length*sizeof(int));
-		memset(bin, 0, coordinates->no_rows*sizeof(uint_fast8_t));
-		atomIndex++;
-	}
-
+	[self _buildList];
+	
 	NSDebugLLog(@"AdCellListHandler",
 		@"System %@ - %d nonbonded interactions.\n",
-		[system systemName], [nonbondedList listCount]);
-	free(interactionBuffer.array);
-	free(nocheckBuffer.array);
-	free(bin);
+		[system systemName], pairList->numberOfPairs);
 	listCreated = YES;
 }	
 
 /*******************************
 
-Update and related functions
+Update
 
 ********************************/
 
-- (void) _updateListRemovingTo: (IntArrayStruct*) removedInteractions
-{
-	int atomOne, atomTwo;
-	ListElement* holder, *list_p;
-
-	list_p = [nonbondedList listStart]->next;
-	while(list_p->next != NULL)
-	{	
-		if(list_p->length > cutoff)
-		{
-			holder = list_p;
-			list_p = list_p->next;
-
-			atomOne = holder->bond[0];
-			atomTwo = holder->bond[1];
-			
-			if(removedInteractions[atomOne].length >= updateCheckInteractions[atomOne].length)
-				removedInteractions[atomOne].array = realloc(removedInteractions[atomOne].array, 
-						(removedInteractions[atomOne].length + 1)*sizeof(int));
-							
-			removedInteractions[atomOne].array[removedInteractions[atomOne].length] = atomTwo;	
-			removedInteractions[atomOne].length++;
-
-			[nonbondedList freeListElement: holder];
-		}	
-		else
-			list_p = list_p->next;
-	}	
-	
-	NSDebugLLog(@"AdCellListHandler", @"Removal complete. Now %d pairs", [nonbondedList listCount]);
-}
-
 /*
 The update algorithm
-1) Update all the cells contents
-2) Remove all interactions beyond the cutoff from the list
-3) Add any interactions that are now within the cutoff to the list
+1) Update all the cells contents (see _sortElementsIntoCells)
+2) Rebuild the pair list from the new cell contents.
+Since the list is contiguous rebuilding it is cheaper than removing
+and inserting individual pairs. 
 */
 
 - (void) update
 {
-	int i, j, k, cell, numberOfInteractionSets;;
-	int atomTwo;
-	double holder;
-	IntArrayStruct currentInteractions, neighbourCells, *checkInteractions, newInteractions;
-	IntArrayStruct *cellContentsBuffer, *removedInteractions, *removed;
-	uint_fast8_t *cellBin;
-	NSMutableIndexSet* interaction;
-	Vector3D separation;
-	BOOL (*interact)(id, SEL, int);	
-	id (*fetch)(id, SEL, int);
-	SEL selector, selector2;
-
 	//Update does nothing if the createList hasnt
 	//been called with the current system and pairs.
 
@@ -599,213 +749,31 @@ The update algorithm
 	NSDebugLLog(@"AdCellListHandler", 
 		@"Updating Lists for system %@ - Currently %d pairs", 
 		[system systemName],
-		[nonbondedList listCount]);
+		pairList->numberOfPairs);
 	
 	/*
          * Step 1. Update cell contents
          */
 
-	if(![self _updateCellIndexes])
+	if(![self _sortElementsIntoCells])
 	{
 		NSDebugLLog(@"AdCellListHandler",
 			 @"The coordinates space has changed. Recalculating the cell space");
 		[self clearCellMatrices];
 		[self initialiseCells];
-		[self _assignCellIndexes];
+		[self _sortElementsIntoCells];
 	}
 
-
 	/*
-         * Setup for next steps.
-	 * This is done after step 1 since there is a chance an
-	 * exception due to an exploding simulation will be raised there.
-	 * We dont want to leak the memory we are about to allocate.
+	 * Step 2. Rebuild the list
 	 */
 
-	//FIXME: We can preallocate alot of these arrays and simply clear them
-	//after each update.
-	numberOfInteractionSets = [interactions count];
-	cellBin = [memoryManager allocateArrayOfSize: sizeof(uint_fast8_t)*coordinates->no_rows];
-	currentInteractions.array = [memoryManager allocateArrayOfSize: coordinates->no_rows*sizeof(int)];
-	removedInteractions = [memoryManager allocateArrayOfSize: 
-				numberOfInteractionSets*sizeof(IntArrayStruct)];
-	
-	for(i=0; i<numberOfInteractionSets; i++)
-	{
-		removedInteractions[i].array = malloc(updateCheckInteractions[i].length*sizeof(int));
-		removedInteractions[i].length = 0;
-	}
-	
-	selector = @selector(containsIndex:);
-	selector2 = @selector(objectAtIndex:);
-
-	//we cache this method call since will be using it alot
-	fetch = (id (*)(id, SEL, int))[interactions 
-			methodForSelector: @selector(objectAtIndex:)];
-	
-	/*
-     	 * Step 2. Remove interactions greater than cutoff from list
- 	 */
-	
-	[self _updateListRemovingTo: removedInteractions];
-	
-	/*
-	   Step 3. Add new interactions.
-	   This is the most complicated step since -
-	   A) We dont want to check the same interactions that were
-	      checked in step 2 i.e. those that are still in the list
-	      and those we removed.
-	   B) We dont want to check more atoms than we have to.
-
-	   We check interactions atom by atom starting with the first.
-	  
-	   Holder is the farthest distance an atom can be from the
-	   center of a cell while still include part of that cell within
-	   its cutoff radius.
-	*/
-
-	holder = cutoff + diagonal;
-	for(k=0; k< numberOfInteractionSets; k++)
-	{	
-		interaction = fetch(interactions, selector2, k);
-		if([interaction count] == 0)
-		{
-			removed = &removedInteractions[k];
-			free(removed->array);
-			continue;
-		}	
-
-		currentInteractions.length = 0;
-		interact = (BOOL (*)(id, SEL, int))[interaction methodForSelector: selector];
-		
-		/*
-		  Load the possible interactions into a buffer called currentInteractions.
-		  This is all other atoms in this atoms cell plus all atoms in neigbouring 
-		  cells (aslong as part of the neighbouring cell is within the cutoff). 
-
-		  A part of a neighbouring cell is within the cutoff distance of the
-		  atom in question if the distance from the atom to the center of the
-		  neighbouring cell is less than the distance defined by the variable holder.
-		*/
-
-		//get the atoms in the current cell
-		cellContentsBuffer = &cellContentsMatrix[cellNumber[k]];
-		for(i = 0; i<cellContentsBuffer->length; i++)
-			if(cellContentsBuffer->array[i] > k)
-			{
-				currentInteractions.array[currentInteractions.length] = cellContentsBuffer->array[i];
-				currentInteractions.length++;
-			}
-
-		//load the neighbourcell contents 
-		neighbourCells = cellNeighbourMatrix[cellNumber[k]];
-		for(i=0; i<neighbourCells.length; i++)
-		{
-			cell = neighbourCells.array[i];
-			cellContentsBuffer = &cellContentsMatrix[cell];
-			if(cellContentsBuffer->length != 0 && 
-				cellContentsBuffer->array[cellContentsBuffer->length-1] > k)
-			{
-				for(j=0; j<3; j++)
-					separation.vector[j] = cellCenterMatrix->matrix[cell][j] -
-								 coordinates->matrix[k][j];
-				
-				Ad3DVectorLength(&separation);
-				//If the separation is less than holder than some of this
-				//cells atoms could be within the cutoff
-
-				if(separation.length < holder) 
-					for(j=0; j < cellContentsBuffer->length; j++)
-						if(cellContentsBuffer->array[j] > k)
-						{
-							currentInteractions.array[currentInteractions.length] = 
-									cellContentsBuffer->array[j];
-							currentInteractions.length++;
-						}
-			}
-		}
+	[self _buildList];
 
-		/*
-		  As mentioned above we dont want to check any interactions that were 
-		  in the list when we began updating since these were delt with in step 2.
-		  updateCheckInteractions is an array with one entry for each atom
-		  except for the last (the kth entry is for atom k etc).
-		  Each entry is another array that contains the indexes of all the atoms that 
-		  the atom was interacting with in the last list i.e. the ones we dont want to check. 
-
-		  In order to avoid these use a "bin" (called here cellBin). This is an array
-		  with one element for every atom. The element is set to 1 if the interaction
-		  was in the last list and is zero otherwise.
-		*/
-
-		//Set the relevant bin elements to 1
-		checkInteractions = &updateCheckInteractions[k];
-		for(i=0; i<checkInteractions->length; i++)
-			cellBin[checkInteractions->array[i]] = 1;
-
-		/*
-		  Now we go through all the possible interactions we added to the buffer above
-		  (currentInteractions) and check if they are within the cutoff.
-		  We skip those whose element has been set to one in the bin (cellBin) and 
-		  any who arent in this atoms interaction list.
-		*/
-
-		newInteractions.length = 0;
-		newInteractions.array = malloc(coordinates->no_rows*sizeof(int));
-		for(i=0; i< currentInteractions.length; i++)
-		{
-			atomTwo = currentInteractions.array[i];
-			if(cellBin[atomTwo] != 1)
-				if(interact(interaction, selector, atomTwo) == YES)
-					if([self _checkInteractionBetweenAtomOne: k atomTwo: atomTwo])
-					{
-						newInteractions.array[newInteractions.length] = atomTwo;
-						newInteractions.length++;
-					}
-		}
-
-		/*
- 		  Finally we want to create a new updateCheckInteraction entry for this
-		  atom. Therefore we need to set to 0 the bin elements of 
-		  all the atoms that we removed in step 2. 
-
-		  removedInteractions is an array with one entry for each atom.
-		  Each entry is an array containing the indexes of the atoms we removed
-		  in step 2. 	
-		  
-		  After this the only elements in the bin set to one are those
-		  that remained in the list after step 2. These combined with the ones
- 		  we added above (in newInteractions) are what we want.
-		*/
-
-		removed = &removedInteractions[k];
-		for(i=0; i<removed->length; i++)
-			cellBin[removed->array[i]] = 0;
-
-		//add the interactions still in the list to newInteractions
-
-		for(i=0; i<checkInteractions->length; i++)	
-			if(cellBin[checkInteractions->array[i]] == 1)
-			{
-				newInteractions.array[newInteractions.length] = checkInteractions->array[i];
-				newInteractions.length++;
-			}				
-
-		newInteractions.array = realloc(newInteractions.array, newInteractions.length*sizeof(int));
-		free(checkInteractions->array);
-		free(removed->array);
-		checkInteractions->array = newInteractions.array;
-		checkInteractions->length = newInteractions.length;
-		memset(cellBin, 0, sizeof(uint_fast8_t)*coordinates->no_rows);
-	}
 	NSDebugLLog(@"AdCellListHandler", 
 		@"(%@) Update complete. Now %d pairs", 
 		[system systemName],
-		[nonbondedList listCount]);
-
-	[memoryManager freeArray: cellBin];
-	[memoryManager freeArray: currentInteractions.array];
-	[memoryManager freeArray: removedInteractions];
+		pairList->numberOfPairs);
 
 	[delegate handlerDidUpdateList: self];
 }
@@ -842,8 +810,12 @@ Object Creation and Maintenance Methods
 	if((self = [super init]))
 	{
 		memoryManager = [AdMemoryManager appMemoryManager];
-		updateCheckInteractions = NULL;
-		nonbondedList = nil;
+		pairList = NULL;
+		rangeOffsets = NULL;
+		allowedRanges = NULL;
+		threadBuffers = NULL;
+		bufferCapacities = NULL;
+		periodic = NO;
 		listCreated = NO; 
 		cellsInitialised = NO; //Indicates if we've created the cell space
 		[self setSystem: aSystem];
@@ -860,6 +832,7 @@ Object Creation and Maintenance Methods
 			cutoff = valueOne;
 
 		[self _initialiseDependants];
+		[self setNumberOfThreads: AdDefaultNumberOfThreads()];
 	}
 
 	return self;
@@ -867,14 +840,20 @@ Object Creation and Maintenance Methods
 
 - (void) dealloc
 {
-	[self _clearListDependants];
-	free(updateCheckInteractions);
+	int i;
+
+	[self _clearPairList];
 	[self _clearCoordinateMatrices];
+	[self _clearAllowedRanges];
+	for(i=0; i<numberOfThreads; i++)
+		free(threadBuffers[i].array);
+
+	[memoryManager freeArray: threadBuffers];
+	[memoryManager freeArray: bufferCapacities];
 
 	if(cellsInitialised)
 		[self clearCellMatrices];
 
-	[nonbondedList release];
 	[system release];
 	[interactions release];
 	[super dealloc];
@@ -897,11 +876,9 @@ Accessors
 		//Deallocate all current cell and coordinate related ivars.
 		[self clearCellMatrices];
 		[self _clearCoordinateMatrices];
-		[self _clearListDependants];
 
 		//Dealloc the list
-		[nonbondedList release];
-		nonbondedList = nil;
+		[self _clearPairList];
 		[system release];
 
 		//Update state ivars.
@@ -942,15 +919,12 @@ Accessors
 	{
 		//Release previous interactions and deallocated the list
 		[interactions release];
-		[self _clearListDependants];
-		if(updateCheckInteractions != NULL)
-			free(updateCheckInteractions);
-		[nonbondedList release];
+		[self _clearPairList];
+		[self _clearAllowedRanges];
 		invalidatedList = YES;
 	}	
 
 	interactions = [anArray retain];	
-	[self _initialisationForInteractions];
 	listCreated = NO;
 
 	if(invalidatedList)
@@ -977,7 +951,7 @@ Accessors
 	{
 		[self clearCellMatrices];
 		[self initialiseCells];
-		[self _assignCellIndexes];
+		[self _sortElementsIntoCells];
 	}
 }
 
@@ -986,17 +960,48 @@ Accessors
 	return cutoff;
 }
 
-- (NSValue*) pairList
+- (AdPairList*) pairList
+{
+	return pairList;
+}
+
+- (void) setNumberOfThreads: (int) number
 {
-	if(nonbondedList == nil)
-		return [NSValue valueWithPointer: NULL];
+	int i;
+
+	if(number < 1)
+		number = 1;
+
+	//The buffers are reused by each build so they are only
+	//reallocated when the number of threads changes.
+	for(i=0; i<numberOfThreads; i++)
+		free(threadBuffers[i].array);
+
+	[memoryManager freeArray: threadBuffers];
+	[memoryManager freeArray: bufferCapacities];
 
-	return [NSValue valueWithPointer: [nonbondedList listStart]];
+	numberOfThreads = number;
+	threadBuffers = [memoryManager allocateArrayOfSize: numberOfThreads*sizeof(IntArrayStruct)];
+	bufferCapacities = [memoryManager allocateArrayOfSize: numberOfThreads*sizeof(int)];
+	for(i=0; i<numberOfThreads; i++)
+	{
+		threadBuffers[i].array = NULL;
+		threadBuffers[i].length = 0;
+		bufferCapacities[i] = 0;
+	}
+}
+
+- (int) numberOfThreads
+{
+	return numberOfThreads;
 }
 
 - (int) numberOfListElements
 {
-	return [nonbondedList listCount];
+	if(pairList == NULL)
+		return 0;
+
+	return pairList->numberOfPairs;
 }
 
 /*
@@ -1027,11 +1032,71 @@ cellsPerAxis
 cellCenterMatrix
 cellIndexMatrix
 cellNeighbourMatrix
-cellContentsMatrix
+cellStart
+cellCursor
 */
 
 @implementation AdCellListHandler (CellMaintainence)
 
+/*
+Checks if the system is periodic and if so retrieves its box.
+The box must be at least twice the cutoff along each axis otherwise
+more than one image of an element could be within the cutoff.
+*/
+
+- (void) _loadPeriodicBox
+{
+	int i;
+	id box = nil;
+
+	if([system respondsToSelector: @selector(periodicBox)])
+		box = [system periodicBox];
+
+	periodic = (box != nil);
+	if(!periodic)
+		return;
+
+	[box getPeriodicBox: &periodicBox];
+	for(i=0; i<3; i++)
+		if(periodicBox.lengths[i] < 2*cutoff)
+			[NSException raise: NSInvalidArgumentException
+				format: @"Periodic box length along axis %d (%lf) is less than twice the cutoff (%lf)",
+				i, periodicBox.lengths[i], cutoff];
+
+	NSDebugLLog(@"AdCellListHandler", @"System %@ is periodic. Box dimensions %lf %lf %lf",
+		[system systemName], periodicBox.lengths[0], periodicBox.lengths[1], periodicBox.lengths[2]);
+}
+
+/*
+For periodic systems the cell space is the periodic box.
+The number of cells along each axis is the largest that gives cells 
+at least cellSize long. Since the box is fixed no padding or size check is necessary.
+*/
+
+- (void) _locatePeriodicCellSpace
+{
+	int i;
+
+	cellsPerAxis = [memoryManager allocateArrayOfSize: 3*sizeof(int)];
+	for(i=0; i<3; i++)
+	{
+		minSpaceBoundry.vector[i] = periodicBox.origin[i];
+		cellSpaceDimensions.vector[i] = periodicBox.lengths[i];
+		maxSpaceBoundry.vector[i] = periodicBox.origin[i] + periodicBox.lengths[i];
+		cellsPerAxis[i] = (int)floor(periodicBox.lengths[i]/cellSize);
+		cellLengths[i] = periodicBox.lengths[i]/cellsPerAxis[i];
+	}
+
+	diagonal = 0.5*sqrt(cellLengths[0]*cellLengths[0] 
+			+ cellLengths[1]*cellLengths[1] 
+			+ cellLengths[2]*cellLengths[2]);
+
+	NSDebugLLog(@"AdCellListHandler", @"Periodic cell space. Cells per axis: %d %d %d", 
+			cellsPerAxis[0], 
+			cellsPerAxis[1],
+			cellsPerAxis[2]);
+}
+
 /*
 Locates the boundaries of the rectangular box that encloses all the atoms. 
 We then extend them so we can fit an integer number of cells in each 
@@ -1052,6 +1117,12 @@ this number we raise an exception.
 	NSError* error;
 	NSException* exception;
 
+	if(periodic)
+	{
+		[self _locatePeriodicCellSpace];
+		return;
+	}
+
 	coordinateArray = [memoryManager allocateArrayOfSize: coordinates->no_rows*sizeof(double)];
 
 	NSDebugLLog(@"AdCellListHandler", @"Finding the space extremes");
@@ -1146,6 +1217,7 @@ this number we raise an exception.
 
 	for(i=0; i<3; i++)
 	{
+		cellLengths[i] = cellSize;
 		cellSpaceDimensions.vector[i] = cellsPerAxis[i]*cellSize;
 		if(cellSpaceDimensions.vector[i] > maxSpaceSize)
 		{
@@ -1173,6 +1245,51 @@ this number we raise an exception.
 			cellSpaceDimensions.vector[2]);
 }
 
+/*
+Adds the cells within two cells of currentCell along each axis to its neighbour list
+wrapping the indexes around the faces of the periodic space.
+When there are few cells per axis different offsets can wrap to the same cell so
+duplicates are skipped.
+*/
+
+- (void) _addPeriodicNeighboursOfCell: (int) currentCell
+{
+	int i, j, k, l, number;
+	int xIndex, yIndex, zIndex;
+	IntArrayStruct* cellNeighbours;
+
+	cellNeighbours = &cellNeighbourMatrix[currentCell];
+	xIndex = (int)cellIndexMatrix->matrix[currentCell][0];
+	yIndex = (int)cellIndexMatrix->matrix[currentCell][1];
+	zIndex = (int)cellIndexMatrix->matrix[currentCell][2];
+	for(i = xIndex - 2; i <= xIndex + 2; i++)
+		for(j = yIndex - 2; j <= yIndex + 2; j++)
+			for(k = zIndex - 2; k <= zIndex + 2; k++)
+			{
+				number = (cellsPerAxis[2]*cellsPerAxis[1])*AdPeriodicCellIndex(i, cellsPerAxis[0]) 
+					+ cellsPerAxis[2]*AdPeriodicCellIndex(j, cellsPerAxis[1]) 
+					+ AdPeriodicCellIndex(k, cellsPerAxis[2]);
+				if(number == currentCell)
+					continue;
+
+				for(l=0; l<cellNeighbours->length; l++)
+					if(cellNeighbours->array[l] == number)
+						break;
+
+				if(l < cellNeighbours->length)
+					continue;
+
+				//At most 124 neighbours
+				if(cellNeighbours->length >= 80)
+					cellNeighbours->array = realloc(cellNeighbours->array,
+							(cellNeighbours->length + 1)*sizeof(int));
+				cellNeighbours->array[cellNeighbours->length] = number;
+				cellNeighbours->length++;
+			}
+
+	cellNeighbours->array = realloc(cellNeighbours->array, (cellNeighbours->length)*sizeof(int));
+}
+
 //we first need to divide the space into a series of cells
 //with defined centers and corresponding indexes (0,0,0) (0,0,1) etc.
 
@@ -1191,9 +1308,9 @@ this number we raise an exception.
 	cellIndexMatrix = [memoryManager allocateMatrixWithRows: numberOfCells withColumns: 3];
 
 	//find center of cell (0,0,0) (the origin cell)
-	originCellCenter.vector[0] = minSpaceBoundry.vector[0] + cellSize/2;
-	originCellCenter.vector[1] = minSpaceBoundry.vector[1] + cellSize/2;
-	originCellCenter.vector[2] = minSpaceBoundry.vector[2] + cellSize/2;
+	originCellCenter.vector[0] = minSpaceBoundry.vector[0] + cellLengths[0]/2;
+	originCellCenter.vector[1] = minSpaceBoundry.vector[1] + cellLengths[1]/2;
+	originCellCenter.vector[2] = minSpaceBoundry.vector[2] + cellLengths[2]/2;
 	
 	NSDebugLLog(@"AdCellListHandler", @"The origin cell center is %lf, %lf, %lf", 
 			originCellCenter.vector[0], originCellCenter.vector[1], originCellCenter.vector[2]);
@@ -1212,7 +1329,7 @@ this number we raise an exception.
 	//use the cellIndexMatrix to assign coordinates to the cell centers
 	for(i=0; i<numberOfCells; i++)
 		for(j=0; j<3; j++)
-			cellCenterMatrix->matrix[i][j] = originCellCenter.vector[j] + cellIndexMatrix->matrix[i][j]*cellSize;
+			cellCenterMatrix->matrix[i][j] = originCellCenter.vector[j] + cellIndexMatrix->matrix[i][j]*cellLengths[j];
 
 	//create the cell neighbour array
 	cellNeighbourMatrix = [memoryManager allocateArrayOfSize: numberOfCells*sizeof(IntArrayStruct)];
@@ -1222,6 +1339,12 @@ this number we raise an exception.
 		cellNeighbours->array = [memoryManager allocateArrayOfSize: 80*sizeof(int)];
 		cellNeighbours->length = 0;
 
+		if(periodic)
+		{
+			[self _addPeriodicNeighboursOfCell: currentCell];
+			continue;
+		}
+
 		xIndex = (int)cellIndexMatrix->matrix[currentCell][0];
 		yIndex = (int)cellIndexMatrix->matrix[currentCell][1];
 		zIndex = (int)cellIndexMatrix->matrix[currentCell][2];
@@ -1250,20 +1373,19 @@ this number we raise an exception.
 		cellNeighbours->array = realloc(cellNeighbours->array, (cellNeighbours->length)*sizeof(int));
 	}	
 
-	//Initialise CellContents array
-	cellContentsMatrix = [memoryManager allocateArrayOfSize: numberOfCells*sizeof(IntArrayStruct)];
-	baseSize = (int)ceil(((double)coordinates->no_rows)/(double)numberOfCells);
-
-	for(i=0; i<numberOfCells; i++)
-	{	
-		cellContentsMatrix[i].array = (int*)malloc(baseSize*sizeof(int));
-		cellContentsMatrix[i].length = 0;
-	}
+	//The arrays used to sort the elements into the cells.
+	//Setting the cell of each element to -1 ensures the cell contents are 
+	//created by the first sort.
+	cellStart = [memoryManager allocateArrayOfSize: (numberOfCells + 1)*sizeof(int)];
+	cellCursor = [memoryManager allocateArrayOfSize: numberOfCells*sizeof(int)];
+	for(i=0; i<coordinates->no_rows; i++)
+		cellNumber[i] = -1;
 }
 
 - (void) initialiseCells
 {
 	NSDebugLLog(@"AdCellListHandler", @"Initialising cell space");
+	[self _loadPeriodicBox];
 	NSDebugLLog(@"AdCellListHandler", @"Locating space boundaries");
 	[self _locateCellSpaceBoundries];
 	NSDebugLLog(@"AdCellListHandler", @"Creating cell Matrices");
@@ -1288,16 +1410,17 @@ centers and the cell indexes.
 	for(i=0; i<numberOfCells;i++)
 	{
 		[memoryManager freeArray: cellNeighbourMatrix[i].array];
-		[memoryManager freeArray: cellContentsMatrix[i].array];
 	}
 	[memoryManager freeArray: cellNeighbourMatrix];
-	[memoryManager freeArray: cellContentsMatrix];
+	[memoryManager freeArray: cellStart];
+	[memoryManager freeArray: cellCursor];
 	[memoryManager freeArray: cellsPerAxis];
 	
 	cellCenterMatrix = NULL;
 	cellIndexMatrix = NULL;
 	cellNeighbourMatrix = NULL;
-	cellContentsMatrix = NULL;
+	cellStart = NULL;
+	cellCursor = NULL;
 	cellsPerAxis = NULL;
 	
 	cellsInitialised = NO;
@@ -23,6 +23,52 @@
 */
 #include "AdunKernel/AdunCharmmForceField.h"
 
+//The number of bonded interactions in each part of -_evaluateBondedForces.
+#define AD_BONDED_PART_INTERACTIONS 2048
+//Bonds, angles, torsions, improper torsions and Urey-Bradley.
+#define AD_BONDED_TERMS 5
+
+typedef double (*AdBondedKernel)(AdBondedTable*, int, int, double**, double**);
+
+/*
+ * The data shared by the parts of -_evaluateBondedForces.
+ * Part i evaluates the i-th contiguous range of each table, adds the forces
+ * to threadForces[i], or to forceMatrix for the first part, and stores the
+ * energies in row i of energies.
+ */
+typedef struct
+{
+	int numberOfParts;
+	AdBondedTable* tables[AD_BONDED_TERMS];
+	AdBondedKernel kernels[AD_BONDED_TERMS];
+	double** coordinates;
+	AdMatrix* forceMatrix;
+	AdMatrix** threadForces;
+	double (*energies)[AD_BONDED_TERMS];
+}
+AdBondedEvaluation;
+
+static void AdBondedForcePart(void* argument, int part)
+{
+	int i, start, end, number;
+	double** forces;
+	AdBondedEvaluation* evaluation = (AdBondedEvaluation*)argument;
+
+	forces = (part == 0) ? evaluation->forceMatrix->matrix : evaluation->threadForces[part]->matrix;
+	for(i=0; i<AD_BONDED_TERMS; i++)
+	{
+		evaluation->energies[part][i] = 0;
+		if(evaluation->tables[i] == NULL)
+			continue;
+
+		number = evaluation->tables[i]->numberInteractions;
+		start = (part*number)/evaluation->numberOfParts;
+		end = ((part + 1)*number)/evaluation->numberOfParts;
+		evaluation->energies[part][i] = evaluation->kernels[i](evaluation->tables[i], start, end,
+						evaluation->coordinates, forces);
+	}
+}
+
 /**
 This category overrides some of the private internals declared in
 AdMolecularMechanicsForceField.
@@ -52,6 +98,29 @@ Initialises the linked list used for the 1-4 interactions.
 Frees the list created with the above method.
 */
 - (void) _freeList;
+/**
+Creates the bonded interaction tables from the interaction matrices
+and the force matrices of the threads.
+*/
+- (void) _createBondedTables;
+/**
+Frees the tables and matrices created by _createBondedTables.
+*/
+- (void) _freeBondedTables;
+/**
+Allocates a force matrix for each part of _evaluateBondedForces.
+The first part uses forceMatrix.
+*/
+- (void) _initThreadForces;
+/**
+Frees the matrices allocated by _initThreadForces.
+*/
+- (void) _cleanUpThreadForces;
+/**
+Evaluates the forces and energies of the active bonded terms that have a table
+on the shared thread team and adds the forces to forceMatrix.
+*/
+- (void) _evaluateBondedForces;
 @end
 
 @implementation AdCharmmForceField
@@ -113,6 +182,9 @@ Frees the list created with the above method.
 		bnd_pot = ang_pot = tor_pot = itor_pot = vdw_pot = est_pot = ub_pot = i14vdw_pot = i14est_pot = total_energy = 0;
 		bonds = angles = torsions = improperTorsions = ub =  forceMatrix = accelerationMatrix = NULL;
 		reciprocalMasses = NULL;
+		bondTable = angleTable = torsionTable = improperTable = ureyBradleyTable = NULL;
+		threadForces = NULL;
+		numberOfThreads = AdDefaultNumberOfThreads();
 		
 		//Default relative permittivity to use for 1-4 interactions
 		//If a nonbonded term is set its permittivity will be used instead.
@@ -164,6 +236,8 @@ Public Methods
 		est_pot = [nonbondedTerm electrostaticEnergy];
 	}
 
+	//The bonded kernels always calculate forces so the energy only
+	//functions are used here.
 	if(harmonicBond)
 		for(j=0; j < bonds->no_rows; j++)
 			AdEnzymixBondEnergy(bonds->matrix[j], coordinates, &bnd_pot);
@@ -206,6 +280,14 @@ Public Methods
 		customTermsEnum = [customTerms keyEnumerator];
 		while((term = [customTermsEnum nextObject]))
 		{	
+			//Deactivated custom terms are not evaluated
+			if([[state valueForKey: @"InactiveTerms"] containsObject: term])
+			{
+				[customPotentials setValue: [NSNumber numberWithDouble: 0]
+					forKey: term];
+				continue;
+			}
+
 			[[customTerms objectForKey: term]  evaluateEnergy];
 			potential = [[customTerms objectForKey: term] energy];	
 			total_energy += potential;
@@ -383,24 +465,12 @@ Public Methods
 		est_pot = [nonbondedTerm electrostaticEnergy];
 	}
 
-	if(harmonicBond)
-		for(j=0; j < bonds->no_rows; j++)
-			AdEnzymixBondForce(bonds->matrix[j], coordinates, forces, &bnd_pot);
+	[self _evaluateBondedForces];
 
-	if(harmonicAngle)
-		for(j=0; j < angles->no_rows; j++)
-			AdEnzymixAngleForce(angles->matrix[j], coordinates, forces, &ang_pot);
-
-	if(fourierTorsion)
+	//Torsions with periods the kernel does not support
+	if(fourierTorsion && torsionTable == NULL)
 		for(j=0; j < torsions->no_rows; j++)
 			AdFourierTorsionForce(torsions->matrix[j], coordinates, forces, &tor_pot);
-	
-	if(improperTorsion)
-		for(j=0; j < improperTorsions->no_rows; j++)
-			AdHarmonicImproperTorsionForce(improperTorsions->matrix[j], 
-				coordinates,
-				forces,
-				&itor_pot);
 
 	if(interaction14)
 	{
@@ -413,10 +483,6 @@ Public Methods
 		}
 	} 
 
-	if(ureyBradley)
-		for(j=0; j < ub->no_rows; j++)
-			AdEnzymixBondForce(ub->matrix[j], coordinates, forces, &ub_pot);
-
 	total_energy = 0;
 	if([customTerms count] != 0)
 	{
@@ -424,6 +490,14 @@ Public Methods
 		customTermsEnum = [customTerms keyEnumerator];
 		while((term = [customTermsEnum nextObject]))
 		{	
+			//Deactivated custom terms are not evaluated
+			if([[state valueForKey: @"InactiveTerms"] containsObject: term])
+			{
+				[customPotentials setValue: [NSNumber numberWithDouble: 0]
+					forKey: term];
+				continue;
+			}
+
 			[[customTerms objectForKey: term]  evaluateForces];
 			potential = [[customTerms objectForKey: term] energy];	
 			total_energy += potential;
@@ -448,9 +522,26 @@ Public Methods
 - (void) dealloc
 {
    [self _freeList];
+   [self _freeBondedTables];
    [super dealloc];
 }
 
+- (int) numberOfThreads
+{
+	return numberOfThreads;
+}
+
+- (void) setNumberOfThreads: (int) number
+{
+	if(number < 1)
+		number = 1;
+
+	[self _cleanUpThreadForces];
+	numberOfThreads = number;
+	if(forceMatrix != NULL)
+		[self _initThreadForces];
+}
+
 - (void) deactivateTerm: (NSString*) termName
 {
 	[super deactivateTerm:  termName ];
@@ -551,6 +642,7 @@ Accessors
 {
 	[ super _systemCleanUp ];
 	[ self _freeList];
+	[ self _freeBondedTables];
 }
 
 - (void) _initialisationForSystem
@@ -593,6 +685,8 @@ Accessors
 	}
 	else
 		ureyBradley = NO;
+
+	[self _createBondedTables];
 }
 
 - (void) _handleSystemContentsChange: (NSNotification*) aNotification
@@ -605,6 +699,8 @@ Accessors
 	[super _handleSystemContentsChange: aNotification ];
 	[memoryManager freeArray: ub];
 	[self _freeList];
+	AdFreeBondedTable(ureyBradleyTable);
+	ureyBradleyTable = NULL;
 	
 	interaction14 = ureyBradley = NO;
 	ub_pot = i14vdw_pot = i14est_pot = 0;
@@ -687,4 +783,139 @@ Accessors
 	}
 }	
 
+- (void) _createBondedTables
+{
+	[self _freeBondedTables];
+
+	if(bonds != NULL)
+		bondTable = AdCreateBondedTable(bonds, 2, 2);
+
+	if(angles != NULL)
+		angleTable = AdCreateBondedTable(angles, 3, 2);
+
+	if(improperTorsions != NULL)
+		improperTable = AdCreateBondedTable(improperTorsions, 4, 2);
+
+	if(ub != NULL)
+		ureyBradleyTable = AdCreateBondedTable(ub, 2, 2);
+
+	if(torsions != NULL)
+	{
+		torsionTable = AdCreateFourierTorsionTable(torsions);
+		if(torsionTable == NULL)
+			NSWarnLog(@"Torsion periods must be integers between 1 and %d to use the torsion kernel",
+				AD_MAX_TORSION_PERIOD);
+	}
+
+	[self _initThreadForces];
+}
+
+- (void) _freeBondedTables
+{
+	AdFreeBondedTable(bondTable);
+	AdFreeBondedTable(angleTable);
+	AdFreeBondedTable(torsionTable);
+	AdFreeBondedTable(improperTable);
+	AdFreeBondedTable(ureyBradleyTable);
+	bondTable = angleTable = torsionTable = improperTable = ureyBradleyTable = NULL;
+	[self _cleanUpThreadForces];
+}
+
+- (void) _initThreadForces
+{
+	int i;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	threadForces = [memoryManager allocateArrayOfSize: numberOfThreads*sizeof(AdMatrix*)];
+	threadForces[0] = NULL;
+	for(i=1; i<numberOfThreads; i++)
+		threadForces[i] = [memoryManager allocateMatrixWithRows: no_of_atoms
+					withColumns: 3];
+}
+
+- (void) _cleanUpThreadForces
+{
+	int i;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	if(threadForces == NULL)
+		return;
+
+	for(i=1; i<numberOfThreads; i++)
+		[memoryManager freeMatrix: threadForces[i]];
+
+	[memoryManager freeArray: threadForces];
+	threadForces = NULL;
+}
+
+/*
+ * The matrices of the parts after the first are zero on entry and are cleared
+ * again after their forces have been added to forceMatrix. The forces and energies
+ * are summed in part order.
+ */
+- (void) _evaluateBondedForces
+{
+	int i, j, k, numberInteractions;
+	double **forces, **buffer;
+	double* potentials[AD_BONDED_TERMS];
+	AdBondedEvaluation evaluation;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	evaluation.tables[0] = harmonicBond ? bondTable : NULL;
+	evaluation.tables[1] = harmonicAngle ? angleTable : NULL;
+	evaluation.tables[2] = fourierTorsion ? torsionTable : NULL;
+	evaluation.tables[3] = improperTorsion ? improperTable : NULL;
+	evaluation.tables[4] = ureyBradley ? ureyBradleyTable : NULL;
+	evaluation.kernels[0] = AdEnzymixBondKernel;
+	evaluation.kernels[1] = AdEnzymixAngleKernel;
+	evaluation.kernels[2] = AdFourierTorsionKernel;
+	evaluation.kernels[3] = AdHarmonicImproperTorsionKernel;
+	evaluation.kernels[4] = AdEnzymixBondKernel;
+	potentials[0] = &bnd_pot;
+	potentials[1] = &ang_pot;
+	potentials[2] = &tor_pot;
+	potentials[3] = &itor_pot;
+	potentials[4] = &ub_pot;
+
+	numberInteractions = 0;
+	for(i=0; i<AD_BONDED_TERMS; i++)
+		if(evaluation.tables[i] != NULL)
+			numberInteractions += evaluation.tables[i]->numberInteractions;
+
+	if(numberInteractions == 0)
+		return;
+
+	evaluation.numberOfParts = numberInteractions/AD_BONDED_PART_INTERACTIONS;
+	if(evaluation.numberOfParts > numberOfThreads)
+		evaluation.numberOfParts = numberOfThreads;
+	if(evaluation.numberOfParts < 1)
+		evaluation.numberOfParts = 1;
+
+	evaluation.coordinates = [system coordinates]->matrix;
+	evaluation.forceMatrix = forceMatrix;
+	evaluation.threadForces = threadForces;
+	evaluation.energies = [memoryManager allocateArrayOfSize: 
+				evaluation.numberOfParts*AD_BONDED_TERMS*sizeof(double)];
+
+	AdRunThreadTeam(AdSharedThreadTeam(), AdBondedForcePart, &evaluation, evaluation.numberOfParts);
+
+	forces = forceMatrix->matrix;
+	for(i=1; i<evaluation.numberOfParts; i++)
+	{
+		buffer = threadForces[i]->matrix;
+		for(j=0; j<no_of_atoms; j++)
+			for(k=0; k<3; k++)
+			{
+				forces[j][k] += buffer[j][k];
+				buffer[j][k] = 0;
+			}
+	}
+
+	for(i=0; i<evaluation.numberOfParts; i++)
+		for(j=0; j<AD_BONDED_TERMS; j++)
+			*potentials[j] += evaluation.energies[i][j];
+
+	[memoryManager freeArray: evaluation.energies];
+}
+
 @end
@@ -180,14 +180,17 @@
 /*
  * Creates the nonbonded pair list for the atoms in the sphere
  * using the pair list from the data source.
+ * Atoms in different molecules always interact so only the pairs within each 
+ * molecule that are not in the data source list have to be excluded.
  */
 - (void) _createNonbondedPairs
 {
-	int i, j;
-	int currentNumberOfAtoms, currentAtom, index, offsetIndex;
+	int i, j, k, atomIndex;
+	int currentNumberOfAtoms, numberOfTemplatePairs, numberOfExclusions;
+	int* templatePairs, *exclusions;
 	id dataSourceNonbonded;
-	NSMutableIndexSet* indexes, *sourceIndexes, *currentInteractions;
-	NSRange indexRange;
+	NSIndexSet* sourceIndexes;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
 	
 	NSDebugLLog(@"AdContainerDataSource", 
 		@"Retrieving Nonbonded interactions from data source");
@@ -195,47 +198,48 @@
 	if(nonbondedPairs != nil)
 		[nonbondedPairs release];
 
-	//First create the inter molecule nonbonded list.
-	//We create entries for the last molecule so we 
-	//can easily add an intra-molecule interactions in the next step.
-
-	currentNumberOfAtoms = [elementConfiguration numberOfRows];
-	nonbondedPairs = [NSMutableArray new];
 	//FIXME: indexSetArrayForInteraction currently returns the nonbonded
 	//list however the exact interface is unstable.
 	dataSourceNonbonded = [dataSource indexSetArrayForCategory:@"Nonbonded"];
-	for(i=0; i<currentNumberOfMolecules; i++)
-		for(j=0; j<atomsPerMolecule; j++)
-		{
-			indexRange.location = (i+1)*atomsPerMolecule;
-			indexRange.length = currentNumberOfAtoms - indexRange.location;
-			indexes = [NSMutableIndexSet indexSetWithIndexesInRange: indexRange];
-			[nonbondedPairs addObject: indexes];
-		}
+	currentNumberOfAtoms = [elementConfiguration numberOfRows];
 
-	//add the intra molecule nonbonded interactions
-	for(currentAtom = 0,i=0; i<currentNumberOfMolecules; i++)
+	//Find the excluded intra molecule pairs of one molecule
+	templatePairs = [memoryManager allocateArrayOfSize: 
+				(atomsPerMolecule*atomsPerMolecule + 1)*sizeof(int)];
+	for(numberOfTemplatePairs = 0, j=0; j<atomsPerMolecule - 1; j++)
 	{
-		for(j=0; j<atomsPerMolecule - 1; j++)
-		{
-			currentInteractions = [nonbondedPairs objectAtIndex: currentAtom];
-			sourceIndexes = [dataSourceNonbonded objectAtIndex: j];
-			index = [sourceIndexes firstIndex];
-			while(index != NSNotFound)
+		sourceIndexes = (j < (int)[dataSourceNonbonded count]) ? 
+					[dataSourceNonbonded objectAtIndex: j] : nil;
+		for(k=j+1; k<atomsPerMolecule; k++)
+			if(![sourceIndexes containsIndex: k])
 			{
-				offsetIndex = index + i*atomsPerMolecule;
-				[currentInteractions addIndex: offsetIndex];
-				index = [sourceIndexes indexGreaterThanIndex: index];
+				templatePairs[2*numberOfTemplatePairs] = j;
+				templatePairs[2*numberOfTemplatePairs + 1] = k;
+				numberOfTemplatePairs++;
 			}
+	}
 
-			currentAtom++;
+	//Replicate them for every molecule
+	exclusions = [memoryManager allocateArrayOfSize: 
+			(2*numberOfTemplatePairs*currentNumberOfMolecules + 1)*sizeof(int)];
+	for(numberOfExclusions = 0, i=0; i<currentNumberOfMolecules; i++)
+	{
+		atomIndex = i*atomsPerMolecule;
+		for(j=0; j<numberOfTemplatePairs; j++)
+		{
+			exclusions[2*numberOfExclusions] = atomIndex + templatePairs[2*j];
+			exclusions[2*numberOfExclusions + 1] = atomIndex + templatePairs[2*j + 1];
+			numberOfExclusions++;
 		}
-		//skip the last atom in each molecule
-		currentAtom++;
 	}
 
-	//remove the last atom entry since its not needed
-	[nonbondedPairs removeLastObject];
+	nonbondedPairs = [[AdNonbondedPairArray alloc]
+				initWithNumberOfElements: currentNumberOfAtoms
+				exclusions: exclusions
+				count: numberOfExclusions];
+
+	[memoryManager freeArray: templatePairs];
+	[memoryManager freeArray: exclusions];
 
 	NSDebugLLog(@"AdContainerDataSource", @"Complete");
 }
@@ -598,17 +602,8 @@ groupProperties matrices
 		}		
 	}
 	
-	//Temporary
-	int total;
-	NSEnumerator* pairsEnum;
-	id set;
-	
-	total = 0;
-	pairsEnum = [nonbondedPairs objectEnumerator];
-	while((set = [pairsEnum nextObject]))
-		total += [set count];
-	
-	[description appendFormat: @"\nThere are %d nonbonded pairs\n", total];
+	[description appendFormat: @"\nThere are %llu nonbonded pairs\n", 
+		[nonbondedPairs numberOfPairs]];
 
 	return description;
 }
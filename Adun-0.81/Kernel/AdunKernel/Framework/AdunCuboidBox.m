@@ -68,6 +68,7 @@
 		yDim = dim2;
 		zDim = dim3;	
 		cuboidExtremes = nil;
+		periodic = NO;
 		
 		if(array == nil)
 		{
@@ -103,6 +104,8 @@
 	[description appendFormat: @"%@. X-Dimension: %8.3lf. Y-Dimension %lf Z-Dimension %lf Centre: (%8.3lf, %8.3lf %8.3lf)\n",
 	 NSStringFromClass([self class]), xDim, yDim, zDim,
 	 cuboidCentre.vector[0], cuboidCentre.vector[1], cuboidCentre.vector[2]];
+	if(periodic)
+		[description appendString: @"Periodic boundaries\n"];
 	
 	return description;	
 }
@@ -152,6 +155,26 @@
 	return [[centre retain] autorelease];
 }
 
+- (void) setPeriodic: (BOOL) value
+{
+	periodic = value;
+}
+
+- (BOOL) isPeriodic
+{
+	return periodic;
+}
+
+- (void) getPeriodicBox: (AdPeriodicBox*) box
+{
+	double lengths[3];
+
+	lengths[0] = xDim;
+	lengths[1] = yDim;
+	lengths[2] = zDim;
+	AdInitialisePeriodicBox(box, cuboidCentre.vector, lengths);
+}
+
 - (void) setCavityCentre: (NSArray*) array
 {
 	Vector3D newCentre;
@@ -205,6 +228,8 @@
 		xDim = [decoder decodeDoubleForKey: @"XDimension"];
 		yDim = [decoder decodeDoubleForKey: @"YDimension"];
 		zDim = [decoder decodeDoubleForKey: @"ZDimension"];
+		//Archives created before periodic boxes were supported don't contain this key
+		periodic = [decoder decodeBoolForKey: @"Periodic"];
 
 		[centre retain];
 		
@@ -228,6 +253,7 @@
 		[encoder encodeDouble: yDim forKey: @"YDimension"];
 		[encoder encodeDouble: zDim forKey: @"ZDimension"];
 		[encoder encodeObject: centre forKey: @"Centre"];
+		[encoder encodeBool: periodic forKey: @"Periodic"];
 	}
 	else
 		[NSException raise: NSInvalidArgumentException
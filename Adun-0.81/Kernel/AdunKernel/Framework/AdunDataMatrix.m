@@ -201,21 +201,53 @@ static NSArray* integerEncodings;
 @end
 
 /*
-Category containing method for converting added elements
-to the correct types for each column
+ * Column storage functions
+ */
+
+static AdDataColumnType AdColumnTypeForDataType(NSString* dataType)
+{
+	if([dataType isEqual: @"double"])
+		return AdDoubleColumn;
+	else if([dataType isEqual: @"int"])
+		return AdIntColumn;
+	else if([dataType isEqual: @"string"])
+		return AdStringColumn;
+	
+	return AdUntypedColumn;
+}
+
+//Double columns store doubles, int and string columns store ints.
+static size_t AdColumnElementSize(AdDataColumnType type)
+{
+	return (type == AdDoubleColumn) ? sizeof(double) : sizeof(int);
+}
+
+static void AdFreeDataColumn(AdDataColumn* column)
+{
+	free(column->values);
+	[column->strings release];
+	[column->stringIndexes release];
+	column->values = NULL;
+	column->strings = nil;
+	column->stringIndexes = nil;
+	column->type = AdUntypedColumn;
+}
+
+/*
+Category containing methods for managing the column storage and
+for converting added elements to the correct types for each column
 */
-@interface AdDataMatrix (PrivateElementConversions)
+@interface AdDataMatrix (PrivateColumnStorage)
 /**
 Returns the allowed class \e object is descended from
 or nil if there is none.
 */
 - (Class) allowedSuperClassForObject: (id) object;
 /**
-Converts object to the correct representation for column. If 
-no dataType has been set for columnIndex an exception is raised.
-If the conversion if not possible raise an exception.
+Returns the data type for objects of the class of \e object.
+Raises an NSInvalidArgumentException if objects of this class cannot be stored.
 */
-- (id) representationOfObject: (id) object forColumn: (unsigned int) columnIndex;
+- (NSString*) dataTypeForObject: (id) object;
 /**
 Sets the data type for each column to be the type defined by
 the class of the corresponding element in array. 
@@ -226,25 +258,74 @@ of columns an NSInvalidArgumentException is raised.
 In the case of an exception being raised no data types are set.
 */
 - (void) setDataTypesToTypesInArray: (NSArray*) array;
+/**
+Ensures the column storage has space for \e number columns.
+The storage for new columns is untyped.
+*/
+- (void) _ensureColumnCapacity: (unsigned int) number;
+/**
+Ensures each typed column has space for \e number rows.
+*/
+- (void) _ensureRowCapacity: (unsigned int) number;
+/**
+Creates the storage for column \e columnIndex for elements of \e dataType
+discarding any existing values. Does not modify columnDataTypes.
+*/
+- (void) _setDataType: (NSString*) dataType ofColumn: (unsigned int) columnIndex;
+/**
+Returns the index of \e string in the string table of \e column adding it if necessary.
+*/
+- (int) _indexOfString: (NSString*) string inColumn: (AdDataColumn*) column;
+/**
+Converts \e object to the representation for column \e columnIndex and stores it in row \e rowIndex.
+The row must be within the row capacity. If the conversion is not possible an NSInvalidArgumentException is raised.
+*/
+- (void) _setValue: (id) object atRow: (unsigned int) rowIndex column: (unsigned int) columnIndex;
+/**
+Returns an object representing the element at (\e rowIndex, \e columnIndex). No bounds checking is performed.
+*/
+- (id) _objectAtRow: (unsigned int) rowIndex column: (unsigned int) columnIndex;
+/**
+Returns YES if \e object would be equal to the object returned by _objectAtRow:column:().
+*/
+- (BOOL) _object: (id) object isEqualToElementAtRow: (unsigned int) rowIndex column: (unsigned int) columnIndex;
+/**
+Rebuilds the map of headers to column indexes. Must be called whenever the headers change.
+*/
+- (void) _updateHeaderIndexes;
+/**
+Initialises the receiver with the rows of \e dataMatrix whose indexes are in \e rowIndexes
+and the columns whose indexes are in \e columnIndexes. If either is NULL all the rows or columns are used.
+The values are copied directly from the column storage of \e dataMatrix.
+*/
+- (id) _initWithDataMatrix: (AdDataMatrix*) dataMatrix
+	rowIndexes: (unsigned int*) rowIndexes
+	numberOfRows: (unsigned int) rows
+	columnIndexes: (unsigned int*) columnIndexes
+	numberOfColumns: (unsigned int) number
+	columnHeaders: (NSArray*) anArray
+	name: (NSString*) aString;
+/**
+Initialises the receiver with \e number double columns each with \e rows elements
+set to 0.
+*/
+- (id) _initWithNumberOfDoubleColumns: (unsigned int) number
+	numberOfRows: (unsigned int) rows
+	columnHeaders: (NSArray*) anArray
+	name: (NSString*) aString;
+/**
+Appends the rows of \e dataMatrix to the receiver copying the values
+directly from its column storage. The columns of \e dataMatrix must
+have the same data types as those of the receiver.
+*/
+- (void) _appendRowsOfMatrix: (AdDataMatrix*) dataMatrix;
+/**
+Keeps only the rows whose indexes are in \e rowIndexes which must be in ascending order.
+*/
+- (void) _keepRows: (unsigned int*) rowIndexes count: (unsigned int) number;
 @end
 
-@implementation AdDataMatrix (PrivateElementConversions)
-
-/* 
-All NSNumber subclasses and NSString respond
-to stringValue, intValue and doubleValue */
-- (id) convertObject: (id) object toClassForDataType: (NSString*) type
-{
-	if([type isEqual: @"string"])
-		return [object stringValue];
-	else if([type isEqual: @"int"])
-		return [NSNumber numberWithInt: [object intValue]];
-	else if([type isEqual: @"double"])	
-		return [NSNumber numberWithDouble: [object doubleValue]];
-	
-	NSWarnLog(@"Cant convert to class for data type %@", type);
-	return nil;
-}
+@implementation AdDataMatrix (PrivateColumnStorage)
 
 - (Class) allowedSuperClassForObject: (id) object
 {
@@ -284,33 +365,41 @@ to stringValue, intValue and doubleValue */
 	return nil;
 }
 
-- (id) representationOfObject: (id) object forColumn: (unsigned int) columnIndex
+- (NSString*) dataTypeForObject: (id) object
 {
-	NSString *dataType;
-
-	dataType = [columnDataTypes objectAtIndex: columnIndex];
+	NSString* dataType;
+	Class class;
 
-	//check if the class of value is of the correct type 
-	//(or a descendant of that type). If not we convert it.
-	if(![object isKindOfClass: [dataTypeToClassMap objectForKey: dataType]]) 
+	//First check if the elements class is a subclass of any
+	//of the allowed objects.
+	//Otherwise check if the class is in classToDataTypeMap
+	//Note: On OSX the first condition is always true for 
+	//NSNumber/NSString based objects.
+	if((class = [self allowedSuperClassForObject: object]) != nil)
+	{
+		dataType = [classToDataTypeMap objectForKey:
+				NSStringFromClass(class)];
+	}
+	else
 	{
-		object = [self convertObject: object toClassForDataType: dataType];
-		if(object == nil)
+		dataType = [classToDataTypeMap objectForKey:
+				NSStringFromClass([object class])];
+		if(dataType == nil)
 			[NSException raise: NSInvalidArgumentException
-				format: @"Cannot convert object of class %@", [object class]];
-	}			
+				format: @"AdDataMatrix - Cannot insert objects of class %@",
+				[object class]];
+	}
 
-	return object;	
+	return dataType;
 }
 
 //Note - This can only be called once
 - (void) setDataTypesToTypesInArray: (NSArray*) array
 {
+	unsigned int i;
 	NSMutableArray* typeArray = [NSMutableArray new];
 	NSEnumerator* arrayEnum;
-	NSString *dataType;
 	id element;
-	Class class;
 
 	if([array count] != numberOfColumns)
 		[NSException raise: NSInvalidArgumentException
@@ -318,32 +407,427 @@ to stringValue, intValue and doubleValue */
 	
 	arrayEnum = [array objectEnumerator];
 	while((element = [arrayEnum nextObject]))
+		[typeArray addObject: [self dataTypeForObject: element]];
+
+	[columnDataTypes addObjectsFromArray: typeArray];
+	[typeArray release];
+
+	[self _ensureColumnCapacity: numberOfColumns];
+	for(i=0; i<numberOfColumns; i++)
+		[self _setDataType: [columnDataTypes objectAtIndex: i]
+			ofColumn: i];
+}
+
+- (void) _ensureColumnCapacity: (unsigned int) number
+{
+	unsigned int capacity;
+
+	if(number <= columnCapacity)
+		return;
+
+	capacity = 2*columnCapacity;
+	if(capacity < number)
+		capacity = number;
+
+	columns = (AdDataColumn*)realloc(columns, capacity*sizeof(AdDataColumn));
+	memset(columns + columnCapacity, 0, (capacity - columnCapacity)*sizeof(AdDataColumn));
+	columnCapacity = capacity;
+}
+
+- (void) _ensureRowCapacity: (unsigned int) number
+{
+	unsigned int i, capacity;
+	AdDataColumn* column;
+
+	if(number <= rowCapacity)
+		return;
+
+	//Matrices are usually created with all their rows so the first
+	//allocation is exact. After that grow geometrically for appends.
+	capacity = 2*rowCapacity;
+	if(capacity < number)
+		capacity = number;
+
+	for(i=0; i<columnCapacity; i++)
+	{
+		column = columns + i;
+		if(column->type != AdUntypedColumn)
+			column->values = realloc(column->values, 
+						capacity*AdColumnElementSize(column->type));
+	}
+
+	rowCapacity = capacity;
+}
+
+- (void) _setDataType: (NSString*) dataType ofColumn: (unsigned int) columnIndex
+{
+	AdDataColumn* column;
+	
+	column = columns + columnIndex;
+	AdFreeDataColumn(column);
+	column->type = AdColumnTypeForDataType(dataType);
+	if(column->type == AdUntypedColumn)
+		[NSException raise: NSInvalidArgumentException
+			format: @"%@ is an invalid column data type", dataType];
+
+	if(rowCapacity > 0)
+		column->values = calloc(rowCapacity, AdColumnElementSize(column->type));
+
+	if(column->type == AdStringColumn)
+	{
+		column->strings = [NSMutableArray new];
+		column->stringIndexes = [NSMutableDictionary new];
+	}
+}
+
+- (int) _indexOfString: (NSString*) string inColumn: (AdDataColumn*) column
+{
+	int index;
+	NSNumber* number;
+
+	if((number = [column->stringIndexes objectForKey: string]) != nil)
+		return [number intValue];
+
+	//Copy in case string is mutable
+	string = [[string copy] autorelease];
+	index = [column->strings count];
+	[column->strings addObject: string];
+	[column->stringIndexes setObject: [NSNumber numberWithInt: index]
+		forKey: string];
+
+	return index;
+}
+
+- (void) _setValue: (id) object atRow: (unsigned int) rowIndex column: (unsigned int) columnIndex
+{
+	AdDataColumn* column;
+	
+	column = columns + columnIndex;
+	switch(column->type)
+	{
+		case AdDoubleColumn:
+			if(![object respondsToSelector: @selector(doubleValue)])
+				[NSException raise: NSInvalidArgumentException
+					format: @"Cannot convert object of class %@ to double", [object class]];
+			
+			((double*)column->values)[rowIndex] = [object doubleValue];
+			break;
+		case AdIntColumn:
+			if(![object respondsToSelector: @selector(intValue)])
+				[NSException raise: NSInvalidArgumentException
+					format: @"Cannot convert object of class %@ to int", [object class]];
+			
+			((int*)column->values)[rowIndex] = [object intValue];
+			break;
+		case AdStringColumn:
+			if(![object isKindOfClass: [NSString class]])
+			{
+				if(![object respondsToSelector: @selector(stringValue)])
+					[NSException raise: NSInvalidArgumentException
+						format: @"Cannot convert object of class %@ to string", [object class]];
+				
+				object = [object stringValue];
+			}
+
+			((int*)column->values)[rowIndex] = [self _indexOfString: object
+								inColumn: column];
+			break;
+		default:
+			[NSException raise: NSInternalInconsistencyException
+				format: @"No data type has been set for column %d", columnIndex];
+	}
+}
+
+- (id) _objectAtRow: (unsigned int) rowIndex column: (unsigned int) columnIndex
+{
+	AdDataColumn* column;
+	
+	column = columns + columnIndex;
+	switch(column->type)
+	{
+		case AdDoubleColumn:
+			return [NSNumber numberWithDouble: ((double*)column->values)[rowIndex]];
+		case AdIntColumn:
+			return [NSNumber numberWithInt: ((int*)column->values)[rowIndex]];
+		case AdStringColumn:
+			return [column->strings objectAtIndex: ((int*)column->values)[rowIndex]];
+		default:
+			[NSException raise: NSInternalInconsistencyException
+				format: @"No data type has been set for column %d", columnIndex];
+	}
+
+	return nil;
+}
+
+- (BOOL) _object: (id) object isEqualToElementAtRow: (unsigned int) rowIndex column: (unsigned int) columnIndex
+{
+	AdDataColumn* column;
+	
+	column = columns + columnIndex;
+	switch(column->type)
 	{
-		//First check if the elements class is a subclass of any
-		//of the allowed objects.
-		//Otherwise check if the class is in classToDataTypeMap
-		//Note: On OSX the first condition is always true for 
-		//NSNumber/NSString based objects.
-		if((class = [self allowedSuperClassForObject: element]) != nil)
+		case AdDoubleColumn:
+			return [object isKindOfClass: [NSNumber class]] &&
+				([object doubleValue] == ((double*)column->values)[rowIndex]);
+		case AdIntColumn:
+			return [object isKindOfClass: [NSNumber class]] &&
+				([object doubleValue] == (double)((int*)column->values)[rowIndex]);
+		case AdStringColumn:
+			return [object isKindOfClass: [NSString class]] &&
+				[object isEqualToString: 
+					[column->strings objectAtIndex: ((int*)column->values)[rowIndex]]];
+		default:
+			break;
+	}
+
+	return NO;
+}
+
+- (void) _updateHeaderIndexes
+{
+	int i;
+
+	if(headerIndexes == nil)
+		headerIndexes = [NSMutableDictionary new];
+	else
+		[headerIndexes removeAllObjects];
+	
+	//Go backwards so the first column with a header is the one recorded
+	for(i=(int)[columnHeaders count] - 1; i>=0; i--)
+		[headerIndexes setObject: [NSNumber numberWithInt: i]
+			forKey: [columnHeaders objectAtIndex: i]];
+}
+
+- (id) _initWithDataMatrix: (AdDataMatrix*) dataMatrix
+	rowIndexes: (unsigned int*) rowIndexes
+	numberOfRows: (unsigned int) rows
+	columnIndexes: (unsigned int*) columnIndexes
+	numberOfColumns: (unsigned int) number
+	columnHeaders: (NSArray*) anArray
+	name: (NSString*) aString
+{
+	unsigned int i, j, sourceIndex;
+	size_t size;
+	AdDataColumn *column, *source;
+
+	if((self = [self initWithRows: nil columnHeaders: nil name: aString]))
+	{
+		if(anArray != nil && [anArray count] != number)
+		{
+			[self release];
+			[NSException raise: NSInvalidArgumentException
+				format: @"Number of headers %d does not match number of columns %d",
+				[anArray count], number];
+		}
+
+		numberOfColumns = number;
+		[self _ensureColumnCapacity: numberOfColumns];
+		[self _ensureRowCapacity: rows];
+		
+		//As with initWithRows: the data types are only
+		//set if there is at least one row.
+		for(j=0; (j<numberOfColumns) && (rows > 0); j++)
 		{
-			dataType = [classToDataTypeMap objectForKey:
-					NSStringFromClass(class)];
+			sourceIndex = (columnIndexes == NULL) ? j : columnIndexes[j];
+			source = dataMatrix->columns + sourceIndex;
+			[columnDataTypes addObject: 
+				[dataMatrix->columnDataTypes objectAtIndex: sourceIndex]];
+			[self _setDataType: [columnDataTypes objectAtIndex: j]
+				ofColumn: j];
+			
+			column = columns + j;
+			size = AdColumnElementSize(column->type);
+			if(rowIndexes == NULL)
+				memcpy(column->values, source->values, rows*size);
+			else if(column->type == AdDoubleColumn)
+			{
+				for(i=0; i<rows; i++)
+					((double*)column->values)[i] = ((double*)source->values)[rowIndexes[i]];
+			}
+			else
+			{
+				for(i=0; i<rows; i++)
+					((int*)column->values)[i] = ((int*)source->values)[rowIndexes[i]];
+			}
+			
+			//The string table is shared by value. 
+			//It may contain strings not in the selected rows.
+			if(column->type == AdStringColumn)
+			{
+				[column->strings release];
+				[column->stringIndexes release];
+				column->strings = [source->strings mutableCopy];
+				column->stringIndexes = [source->stringIndexes mutableCopy];
+			}
 		}
+		
+		numberOfRows = rows;
+		if(anArray != nil)
+			[columnHeaders addObjectsFromArray: anArray];
 		else
+			for(j=0; j<numberOfColumns; j++)
+				[columnHeaders addObject: 
+					[NSString stringWithFormat: @"Column %d", j]];
+		
+		[self _updateHeaderIndexes];
+	}
+
+	return self;
+}
+
+- (id) _initWithNumberOfDoubleColumns: (unsigned int) number
+	numberOfRows: (unsigned int) rows
+	columnHeaders: (NSArray*) anArray
+	name: (NSString*) aString
+{
+	unsigned int j;
+
+	if(number == 0 || rows == 0)
+		return [self initWithRows: nil
+			columnHeaders: anArray
+			name: aString];
+
+	if((self = [self initWithRows: nil columnHeaders: nil name: aString]))
+	{
+		if(anArray != nil && [anArray count] != number)
 		{
-			dataType = [classToDataTypeMap objectForKey:
-					NSStringFromClass([element class])];
-			if(dataType == nil)
-				[NSException raise: NSInvalidArgumentException
-					format: @"AdDataMatrix - Cannot insert objects of class %@",
-					[element class]];
+			[self release];
+			[NSException raise: NSInvalidArgumentException
+				format: @"Number of headers %d does not match number of columns %d",
+				[anArray count], number];
+		}
+
+		numberOfColumns = number;
+		numberOfRows = rows;
+		[self _ensureColumnCapacity: numberOfColumns];
+		[self _ensureRowCapacity: numberOfRows];
+		for(j=0; j<numberOfColumns; j++)
+		{
+			[columnDataTypes addObject: @"double"];
+			[self _setDataType: @"double" ofColumn: j];
 		}
+		
+		if(anArray != nil)
+			[columnHeaders addObjectsFromArray: anArray];
+		else
+			for(j=0; j<numberOfColumns; j++)
+				[columnHeaders addObject: 
+					[NSString stringWithFormat: @"Column %d", j]];
 
-		[typeArray addObject: dataType];		
+		[self _updateHeaderIndexes];
 	}
 
-	[columnDataTypes addObjectsFromArray: typeArray];
-	[typeArray release];
+	return self;
+}
+
+- (void) _appendRowsOfMatrix: (AdDataMatrix*) dataMatrix
+{
+	unsigned int i, j, rows, numberOfStrings;
+	int *map, *indexes, *sourceIndexes;
+	size_t size;
+	AdDataColumn *column, *source;
+
+	rows = dataMatrix->numberOfRows;
+	[self _ensureRowCapacity: numberOfRows + rows];
+	for(j=0; j<numberOfColumns; j++)
+	{
+		column = columns + j;
+		source = dataMatrix->columns + j;
+		if(column->type == AdStringColumn)
+		{
+			//Map the source string indexes to the receivers
+			numberOfStrings = [source->strings count];
+			map = (int*)malloc((numberOfStrings + 1)*sizeof(int));
+			for(i=0; i<numberOfStrings; i++)
+				map[i] = [self _indexOfString: [source->strings objectAtIndex: i]
+						inColumn: column];
+
+			indexes = (int*)column->values + numberOfRows;
+			sourceIndexes = (int*)source->values;
+			for(i=0; i<rows; i++)
+				indexes[i] = map[sourceIndexes[i]];
+			
+			free(map);
+		}
+		else
+		{
+			size = AdColumnElementSize(column->type);
+			memcpy((char*)column->values + numberOfRows*size, source->values, rows*size);
+		}
+	}
+
+	numberOfRows += rows;
+}
+
+- (void) _keepRows: (unsigned int*) rowIndexes count: (unsigned int) number
+{
+	unsigned int i, j;
+	AdDataColumn* column;
+
+	//Since the indexes are ascending rowIndexes[i] >= i
+	//so the columns can be compacted in place.
+	for(j=0; j<numberOfColumns; j++)
+	{
+		column = columns + j;
+		if(column->type == AdDoubleColumn)
+		{
+			for(i=0; i<number; i++)
+				((double*)column->values)[i] = ((double*)column->values)[rowIndexes[i]];
+		}
+		else if(column->type != AdUntypedColumn)
+		{
+			for(i=0; i<number; i++)
+				((int*)column->values)[i] = ((int*)column->values)[rowIndexes[i]];
+		}
+	}
+
+	numberOfRows = number;
+}
+
+@end
+
+/*
+Enumerates the rows of an AdDataMatrix creating each row as it is requested.
+*/
+@interface AdDataMatrixRowEnumerator: NSEnumerator
+{
+	unsigned int nextRow;
+	AdDataMatrix* dataMatrix;
+}
+- (id) initWithDataMatrix: (AdDataMatrix*) aMatrix;
+@end
+
+@implementation AdDataMatrixRowEnumerator
+
+- (id) initWithDataMatrix: (AdDataMatrix*) aMatrix
+{
+	if((self = [super init]))
+	{
+		nextRow = 0;
+		dataMatrix = [aMatrix retain];
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[dataMatrix release];
+	[super dealloc];
+}
+
+- (id) nextObject
+{
+	NSMutableArray* row;
+
+	if(nextRow >= [dataMatrix numberOfRows])
+		return nil;
+
+	row = [NSMutableArray arrayWithCapacity: [dataMatrix numberOfColumns]];
+	[dataMatrix addRow: nextRow toArray: row];
+	nextRow++;
+
+	return row;
 }
 
 @end
@@ -512,21 +996,19 @@ The AdDataMatrix class implementation
 	columnHeaders: (NSArray*) anArray
 	name: (NSString*) aString
 {
-	int i, j;
-	NSMutableArray* array;
-
-	array = [NSMutableArray new];
-	for(i=0; i<(int)aVector->size; i++)
-		for(j=0; j<1; j++)
-			[array addObject: 
-				[NSArray arrayWithObject:
-					[NSNumber numberWithDouble: gsl_vector_get(aVector, i)]]];
-
-	[self initWithRows: array
-		columnHeaders: anArray
-		name: aString];
+	int i;
+	double* values;
 
-	[array release];
+	self = [self _initWithNumberOfDoubleColumns: 1
+			numberOfRows: aVector->size
+			columnHeaders: anArray
+			name: aString];
+	if(self != nil && numberOfRows > 0)
+	{
+		values = (double*)columns[0].values;
+		for(i=0; i<(int)aVector->size; i++)
+			values[i] = gsl_vector_get(aVector, i);
+	}
 
 	return self;
 }
@@ -536,25 +1018,21 @@ The AdDataMatrix class implementation
 	name: (NSString*) aString
 {
 	int i, j;
-	NSMutableArray* array, *row;
+	double* values;
 
-	array = [NSMutableArray new];
-	for(i=0; i<(int)aMatrix->size1; i++)
+	self = [self _initWithNumberOfDoubleColumns: aMatrix->size2
+			numberOfRows: aMatrix->size1
+			columnHeaders: anArray
+			name: aString];
+	if(self != nil && numberOfRows > 0)
 	{
-		row = [NSMutableArray array];
 		for(j=0; j<(int)aMatrix->size2; j++)
 		{
-			[row addObject: [NSNumber 
-				numberWithDouble: gsl_matrix_get(aMatrix, i, j)]];
+			values = (double*)columns[j].values;
+			for(i=0; i<(int)aMatrix->size1; i++)
+				values[i] = gsl_matrix_get(aMatrix, i, j);
 		}
-		[array addObject: row];
-	}	
-
-	[self initWithRows: array
-		columnHeaders: anArray
-		name: aString];
-
-	[array release];
+	}
 
 	return self;
 }
@@ -564,25 +1042,21 @@ The AdDataMatrix class implementation
 	name: (NSString*) aString
 {
 	int i, j;
-	NSMutableArray* array, *row;
+	double* values;
 
-	array = [NSMutableArray new];
-	for(i=0; i<aMatrix->no_rows; i++)
+	self = [self _initWithNumberOfDoubleColumns: aMatrix->no_columns
+			numberOfRows: aMatrix->no_rows
+			columnHeaders: anArray
+			name: aString];
+	if(self != nil && numberOfRows > 0)
 	{
-		row = [NSMutableArray array];
 		for(j=0; j<aMatrix->no_columns; j++)
 		{
-			[row addObject: [NSNumber 
-				numberWithDouble: aMatrix->matrix[i][j]]];
+			values = (double*)columns[j].values;
+			for(i=0; i<aMatrix->no_rows; i++)
+				values[i] = aMatrix->matrix[i][j];
 		}
-		[array addObject: row];
-	}	
-
-	[self initWithRows: array
-		columnHeaders: anArray
-		name: aString];
-
-	[array release];
+	}
 
 	return self;
 }
@@ -591,28 +1065,24 @@ The AdDataMatrix class implementation
 	columnHeaders: (NSArray*) anArray
 	name: (NSString*) aString
 {	
-	NSMutableArray* rows;
-	NSEnumerator *rowEnum;
-	id row;
+	if(dataMatrix == nil)
+		return [self initWithRows: nil
+				columnHeaders: anArray
+				name: aString];
 
-	rows = [NSMutableArray new];
-	rowEnum = [dataMatrix rowEnumerator];
-	while((row = [rowEnum nextObject]))
-		[rows addObject: row];
-	
-	if(anArray == nil && dataMatrix != nil)
+	if(anArray == nil)
 		anArray = [dataMatrix columnHeaders];
 	
-	if(aString == nil && dataMatrix != nil)
+	if(aString == nil)
 		aString = [dataMatrix name];
 
-	[self initWithRows: rows
-		columnHeaders: anArray
-		name: aString];
-	
-	[rows release];
-	
-	return self;
+	return [self _initWithDataMatrix: dataMatrix
+			rowIndexes: NULL
+			numberOfRows: [dataMatrix numberOfRows]
+			columnIndexes: NULL
+			numberOfColumns: [dataMatrix numberOfColumns]
+			columnHeaders: anArray
+			name: aString];
 }
 
 - (id) initWithRows: (NSArray*) rows
@@ -622,20 +1092,20 @@ The AdDataMatrix class implementation
 	int i;
 	NSEnumerator *rowEnum;
 	NSArray *row, *firstRow;
-	NSMutableArray* convertedRow;
-	id element;
 
 	if((self = [super init]))
 	{
 		numberOfColumns = 0;
 		numberOfRows = 0;
-		matrix = [NSMutableArray new];
+		rowCapacity = 0;
+		columnCapacity = 0;
+		columns = NULL;
 		columnHeaders = [NSMutableArray new];
 		columnDataTypes = [NSMutableArray new];
+		headerIndexes = [NSMutableDictionary new];
 		
 		if(rows != nil && ([rows count] > 0))
 		{
-			numberOfRows = [rows count];
 			firstRow = [rows objectAtIndex: 0];
 			if(![firstRow isKindOfClass: [NSArray class]])
 			{
@@ -648,24 +1118,21 @@ The AdDataMatrix class implementation
 
 			//Set the column data types.
 			[self setDataTypesToTypesInArray: firstRow];
+			[self _ensureRowCapacity: [rows count]];
 
-			//Go through all the rows and converting the
-			//elements and adding them to the matrix
+			//Go through all the rows converting the
+			//elements and adding them to the columns
 			rowEnum = [rows objectEnumerator];
 			while((row = [rowEnum nextObject]))
 			{	
 				//Check all rows have the same number of elements
 				if([row count] == numberOfColumns)
 				{
-					convertedRow = [NSMutableArray array];
-					for(i=0; i<(int)[row count]; i++)
-					{
-						element = [self representationOfObject:
-									[row objectAtIndex: i]
-								forColumn: i];
-						[convertedRow addObject: element];
-					}	
-					[matrix addObject: convertedRow];
+					for(i=0; i<(int)numberOfColumns; i++)
+						[self _setValue: [row objectAtIndex: i]
+							atRow: numberOfRows
+							column: i];
+					numberOfRows++;		
 				}	
 				else
 				{
@@ -706,6 +1173,10 @@ The AdDataMatrix class implementation
 				[columnHeaders addObject: 
 					[NSString stringWithFormat: @"Column %d", i]];
 		}			
+
+		//Columns which have no data yet are untyped
+		[self _ensureColumnCapacity: numberOfColumns];
+		[self _updateHeaderIndexes];
 	}
 
 	return self;
@@ -741,7 +1212,13 @@ The AdDataMatrix class implementation
 
 - (void) dealloc
 {
-	[matrix release];
+	unsigned int i;
+
+	for(i=0; i<columnCapacity; i++)
+		AdFreeDataColumn(columns + i);
+	
+	free(columns);
+	[headerIndexes release];
 	[columnDataTypes release];
 	[columnHeaders release];
 	[name release];
@@ -842,15 +1319,23 @@ The AdDataMatrix class implementation
 - (id) elementAtRow: (unsigned int) rowIndex
 	 column: (unsigned int) columnIndex;
 {
-	return [[matrix objectAtIndex: rowIndex] objectAtIndex: columnIndex];
+	if(rowIndex >= numberOfRows)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Row %d does not exist", rowIndex];
+
+	if(columnIndex >= numberOfColumns)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Column %d does not exist", columnIndex];
+
+	return [self _objectAtRow: rowIndex column: columnIndex];
 }
 
 - (id) elementAtRow: (unsigned int) row 
 	ofColumnWithHeader: (NSString*) columnHeader 
 {
-	int columnIndex;
+	unsigned int columnIndex;
 
-	if((columnIndex = [columnHeaders indexOfObject: columnHeader]) == NSNotFound)
+	if((columnIndex = [self indexOfColumnWithHeader: columnHeader]) == NSNotFound)
 		[NSException raise: NSInvalidArgumentException
 			format: @"Column header %@ does not exist", columnHeader];
 	
@@ -861,12 +1346,12 @@ The AdDataMatrix class implementation
 - (NSArray*) matrixRows
 {
 	NSWarnLog(@"This method is deprecated - use row: or rowEnumerator instead");
-	return matrix;
+	return [[self rowEnumerator] allObjects];
 }
 
 - (NSArray*) column: (unsigned int) columnIndex
 {
-	NSMutableArray* columnCopy = [NSMutableArray array];
+	NSMutableArray* columnCopy = [NSMutableArray arrayWithCapacity: numberOfRows];
 
 	[self addColumn: columnIndex toArray: columnCopy];
 	return [[columnCopy copy] autorelease];
@@ -874,9 +1359,9 @@ The AdDataMatrix class implementation
 
 - (NSArray*) columnWithHeader: (NSString*) columnHeader
 {
-	int columnIndex;
+	unsigned int columnIndex;
 
-	if((columnIndex = [columnHeaders indexOfObject: columnHeader]) == NSNotFound)
+	if((columnIndex = [self indexOfColumnWithHeader: columnHeader]) == NSNotFound)
 		[NSException raise: NSInvalidArgumentException
 			format: @"Column header %@ does not exist", columnHeader];
 	
@@ -885,46 +1370,56 @@ The AdDataMatrix class implementation
 
 - (NSArray*) row: (unsigned int) rowIndex
 {
-	if(rowIndex >= numberOfRows)
-		[NSException raise: NSInvalidArgumentException
-			format: @" Row %d does not exist", rowIndex];
+	NSMutableArray* rowCopy = [NSMutableArray arrayWithCapacity: numberOfColumns];
 
-	return [NSArray arrayWithArray:
-		[matrix objectAtIndex: rowIndex]]; 
+	[self addRow: rowIndex toArray: rowCopy];
+	return [[rowCopy copy] autorelease];
 }
 
 - (void) addRow: (unsigned int) rowIndex toArray: (NSMutableArray*) anArray
 {
+	unsigned int i;
+
 	if(rowIndex >= numberOfRows)
 		[NSException raise: NSInvalidArgumentException
 			format: @" Row %d does not exist", rowIndex];
 	
-	[anArray addObjectsFromArray: 
-		[matrix objectAtIndex: rowIndex]];
+	for(i=0; i<numberOfColumns; i++)
+		[anArray addObject: 
+			[self _objectAtRow: rowIndex column: i]];
 }
 
 - (void) addColumn: (unsigned int) columnIndex toArray: (NSMutableArray*) anArray
 {
-	int i;
-	id object;
+	unsigned int i;
+	int* indexes;
+	NSArray* strings;
 
 	if(columnIndex >= numberOfColumns)
 		[NSException raise: NSInvalidArgumentException
 			format: @" Column %d does not exist", columnIndex];
 
-	for(i = 0; i<(int)numberOfRows; i++)
+	if(columns[columnIndex].type == AdStringColumn)
 	{
-		object = [[matrix objectAtIndex: i] objectAtIndex: columnIndex]; 
-		[anArray addObject: object];
-	}	
+		indexes = (int*)columns[columnIndex].values;
+		strings = columns[columnIndex].strings;
+		for(i=0; i<numberOfRows; i++)
+			[anArray addObject: [strings objectAtIndex: indexes[i]]];
+	}
+	else
+	{
+		for(i=0; i<numberOfRows; i++)
+			[anArray addObject: 
+				[self _objectAtRow: i column: columnIndex]];
+	}
 }
 
 - (void) addColumnWithHeader: (NSString*) columnHeader
 		toArray: (NSMutableArray*) anArray
 {
-	int columnIndex;
+	unsigned int columnIndex;
 
-	if((columnIndex = [columnHeaders indexOfObject: columnHeader]) == NSNotFound)
+	if((columnIndex = [self indexOfColumnWithHeader: columnHeader]) == NSNotFound)
 		[NSException raise: NSInvalidArgumentException
 			format: @"Column header %@ does not exist", columnHeader];
 	
@@ -933,7 +1428,8 @@ The AdDataMatrix class implementation
 
 - (NSEnumerator*) rowEnumerator
 {
-	return [matrix objectEnumerator];
+	return [[[AdDataMatrixRowEnumerator alloc] 
+			initWithDataMatrix: self] autorelease];
 }
 
 /*
@@ -942,41 +1438,95 @@ The AdDataMatrix class implementation
 
 - (AdMatrix*) cRepresentation
 {
-	int i,j;
 	AdMatrix* cMatrix;
 	
 	cMatrix = [[AdMemoryManager appMemoryManager]
 			allocateMatrixWithRows: numberOfRows
 			withColumns: numberOfColumns];
-
-	for(i=0;i<(int)numberOfRows; i++)
-		for(j=0; j<(int)numberOfColumns; j++)
-			cMatrix->matrix[i][j] = [[self elementAtRow: i
-						column: j] doubleValue];
+	[self cRepresentationUsingBuffer: cMatrix];
 
 	return cMatrix;					
 }
 
 - (void) cRepresentationUsingBuffer: (AdMatrix*) aMatrix
 {
-	int i,j;
+	unsigned int i, j, numberOfStrings;
+	int *intValues;
+	double *doubleValues, *stringValues;
+	double **cMatrix;
+	AdDataColumn* column;
 	
 	if(aMatrix->no_rows != (int)numberOfRows)
 		[NSException raise: NSInvalidArgumentException
 			format: @"Provided buffer has incorrect number of rows - required %d, provided %d",
-			aMatrix->no_rows,
-			numberOfRows];
+			numberOfRows,
+			aMatrix->no_rows];
 	
 	if(aMatrix->no_columns != (int)numberOfColumns)
 		[NSException raise: NSInvalidArgumentException
 			format: @"Provided buffer has incorrect number of columns - required %d, provided %d",
-			aMatrix->no_columns,
-			numberOfColumns];
+			numberOfColumns,
+			aMatrix->no_columns];
 
-	for(i=0;i<(int)numberOfRows; i++)
-		for(j=0; j<(int)numberOfColumns; j++)
-			aMatrix->matrix[i][j] = [[self elementAtRow: i
-						column: j] doubleValue];
+	cMatrix = aMatrix->matrix;
+	for(j=0; j<numberOfColumns; j++)
+	{
+		column = columns + j;
+		switch(column->type)
+		{
+			case AdDoubleColumn:
+				doubleValues = (double*)column->values;
+				for(i=0; i<numberOfRows; i++)
+					cMatrix[i][j] = doubleValues[i];
+				break;
+			case AdIntColumn:
+				intValues = (int*)column->values;
+				for(i=0; i<numberOfRows; i++)
+					cMatrix[i][j] = (double)intValues[i];
+				break;
+			case AdStringColumn:
+				//Convert each distinct string once
+				numberOfStrings = [column->strings count];
+				stringValues = (double*)malloc((numberOfStrings + 1)*sizeof(double));
+				for(i=0; i<numberOfStrings; i++)
+					stringValues[i] = [[column->strings objectAtIndex: i] doubleValue];
+				
+				intValues = (int*)column->values;
+				for(i=0; i<numberOfRows; i++)
+					cMatrix[i][j] = stringValues[intValues[i]];
+				
+				free(stringValues);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+- (const double*) doubleValuesOfColumn: (unsigned int) columnIndex
+{
+	if(columnIndex >= numberOfColumns)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Column %d does not exist", columnIndex];
+
+	if(columns[columnIndex].type != AdDoubleColumn)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Column %d does not hold doubles", columnIndex];
+
+	return (const double*)columns[columnIndex].values;
+}
+
+- (const int*) intValuesOfColumn: (unsigned int) columnIndex
+{
+	if(columnIndex >= numberOfColumns)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Column %d does not exist", columnIndex];
+
+	if(columns[columnIndex].type != AdIntColumn)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Column %d does not hold ints", columnIndex];
+
+	return (const int*)columns[columnIndex].values;
 }
 
 /*
@@ -1005,7 +1555,12 @@ The AdDataMatrix class implementation
 
 - (unsigned int) indexOfColumnWithHeader: (NSString*) header
 {
-	return [columnHeaders indexOfObject: header];
+	NSNumber* index;
+
+	if(header == nil || (index = [headerIndexes objectForKey: header]) == nil)
+		return NSNotFound;
+
+	return [index unsignedIntValue];
 }
 
 - (NSArray*) columnDataTypes
@@ -1024,9 +1579,9 @@ The AdDataMatrix class implementation
 
 - (NSString*) dataTypeForColumnWithHeader: (NSString*) columnHeader
 {
-	int columnIndex;
+	unsigned int columnIndex;
 
-	if((columnIndex = [columnHeaders indexOfObject: columnHeader]) == NSNotFound)
+	if((columnIndex = [self indexOfColumnWithHeader: columnHeader]) == NSNotFound)
 		[NSException raise: NSInvalidArgumentException
 			format: @"Column header %@ does not exist", columnHeader];
 
@@ -1047,7 +1602,7 @@ The AdDataMatrix class implementation
 	unsigned int i;
 
 	for(i=0; i<numberOfRows; i++)
-		NSLog(@"%@\n", [[matrix objectAtIndex: i] componentsJoinedByString: @" "]);
+		NSLog(@"%@\n", [[self row: i] componentsJoinedByString: @" "]);
 }		
 
 - (BOOL) writeMatrixToFile: (NSString*) filename
@@ -1066,7 +1621,7 @@ The AdDataMatrix class implementation
 
 	for(i=0;i<(int)numberOfRows; i++)
 		GSPrintf(file_p, @"%@\n", 
-			[[matrix objectAtIndex: i] 
+			[[self row: i] 
 			componentsJoinedByString: @" "]);
 
 	fclose(file_p);
@@ -1083,17 +1638,17 @@ Returns an NSIndexSet containing the indexes of rows containing \e element
 */
 - (NSIndexSet*) indexesOfRowsContainingElement: (id) element
 {	
-	int i;
-	NSArray* row;
+	unsigned int i, j;
 	NSIndexSet* setCopy;
 	NSMutableIndexSet* indexSet = [NSMutableIndexSet new];
 	
-	for(i=0; i<(int)numberOfRows; i++)
-	{
-		row = [matrix objectAtIndex: i];
-		if([row containsObject: element])
-			[indexSet addIndex: i];
-	}		
+	for(i=0; i<numberOfRows; i++)
+		for(j=0; j<numberOfColumns; j++)
+			if([self _object: element isEqualToElementAtRow: i column: j])
+			{
+				[indexSet addIndex: i];
+				break;
+			}
 
 	setCopy = [[indexSet copy] autorelease];	
 	[indexSet release];
@@ -1108,18 +1663,22 @@ row and objects at a given index in each array satisfy the isEqual: test.
 */
 - (NSIndexSet*) indexesOfRowsMatchingArray: (NSArray*) anArray
 {
-	int i;
-	NSArray* row;
+	unsigned int i, j;
 	NSIndexSet* setCopy;
 	NSMutableIndexSet* indexSet = [NSMutableIndexSet new];
 	
 	//Only search if anArray is the correct size
 	if([anArray count] == numberOfColumns)
 	{
-		for(i=0; i<(int)numberOfRows; i++)
+		for(i=0; i<numberOfRows; i++)
 		{
-			row = [matrix objectAtIndex: i];
-			if([row isEqualToArray: anArray])
+			for(j=0; j<numberOfColumns; j++)
+				if(![self _object: [anArray objectAtIndex: j] 
+					isEqualToElementAtRow: i 
+					column: j])
+					break;
+
+			if(j == numberOfColumns)
 				[indexSet addIndex: i];
 		}
 	}	
@@ -1143,41 +1702,40 @@ an NSRangeException is raised.
 */
 - (AdDataMatrix*) submatrixFromRowSelection: (NSIndexSet*) indexSet
 {
-	int index, i;
+	unsigned int index, count;
 	unsigned int* buffer;
-	NSMutableArray* rows = [NSMutableArray new];
 	AdDataMatrix* submatrix;
 
 	//Check for range problems
 	index = [indexSet lastIndex];
+	count = 0;
+	buffer = NULL;
 
 	if(index != NSNotFound)
 	{
-		if(index >= (int)numberOfRows)
+		if(index >= numberOfRows)
 			[NSException raise: NSRangeException
 				format: @"Index %d is out of row range (%d)", 
 				index,
 				numberOfRows - 1];
 		
-		//Dont use subarrayFromElementSelection: since that
-		//will return an array containing the actual NSMutableArrays
-		//used by the object.
-		buffer = (unsigned int*)malloc([indexSet count]*sizeof(unsigned int));
+		count = [indexSet count];
+		buffer = (unsigned int*)malloc(count*sizeof(unsigned int));
 		[indexSet getIndexes: buffer 
-			    maxCount: [indexSet count]
+			    maxCount: count
 			inIndexRange: NULL];
-		for(i=0; i<(int)[indexSet count]; i++)
-			[rows addObject: 
-				[self row: buffer[i]]];
-		
-		free(buffer); 
 	}	
 
 	submatrix = [[AdDataMatrix alloc] 
-			initWithRows: rows
+			_initWithDataMatrix: self
+			rowIndexes: buffer
+			numberOfRows: count
+			columnIndexes: NULL
+			numberOfColumns: numberOfColumns
 			columnHeaders: [self columnHeaders]
 			name: [self name]];
-	[rows release];
+	
+	free(buffer);
 	return [submatrix autorelease];
 }
 
@@ -1191,40 +1749,44 @@ an NSRangeException is raised.
 */
 - (AdDataMatrix*) submatrixFromColumnSelection: (NSIndexSet*) indexSet
 {
-	int index;
-	id row;
+	unsigned int index, count, rows;
+	unsigned int* buffer;
 	NSArray* array;
-	NSMutableArray* rows = [NSMutableArray new];
-	NSEnumerator* rowEnumerator;
 	AdDataMatrix* submatrix;
 
 	//Check for range problems
 	index = [indexSet lastIndex];
+	count = rows = 0;
+	buffer = NULL;
 
 	if(index != NSNotFound)
 	{
-		if(index >= (int)numberOfColumns)
+		if(index >= numberOfColumns)
 			[NSException raise: NSRangeException
 				format: @"Index %d is out of column range (%d)", 
 				index,
 				numberOfColumns - 1];
 
-		rowEnumerator = [self rowEnumerator];
-		while((row = [rowEnumerator nextObject]))
-		{
-			array = [row subarrayFromElementSelection: indexSet];
-			[rows addObject: array];
-		}
+		count = [indexSet count];
+		rows = numberOfRows;
+		buffer = (unsigned int*)malloc(count*sizeof(unsigned int));
+		[indexSet getIndexes: buffer 
+			    maxCount: count
+			inIndexRange: NULL];
 	}	
 
 	array = [[self columnHeaders] 
 			subarrayFromElementSelection: indexSet];
 	submatrix = [[AdDataMatrix alloc] 
-			initWithRows: rows
+			_initWithDataMatrix: self
+			rowIndexes: NULL
+			numberOfRows: rows
+			columnIndexes: buffer
+			numberOfColumns: count
 			columnHeaders: array
 			name: [self name]];
 	
-	[rows release];
+	free(buffer);
 	return [submatrix autorelease];
 }
 
@@ -1260,34 +1822,33 @@ is raised.
 //decoder for pre 0.7 version objects
 - (id) _initWithCoderPre0_7: (NSCoder*) decoder
 {
-	int i,j;
-	int matrixElements;
-	int count;
+	unsigned int i,j;
 	unsigned int length; 
-	double *matrixStore;
-	NSMutableArray* matrixRow;
-	NSNumber *element;
+	double *matrixStore, *values;
 
 	NSLog(@"Decoding pre0.7 data matrix");
 
 	if([decoder allowsKeyedCoding])
 	{
-		matrix = [NSMutableArray new];
 		numberOfRows = [decoder decodeIntForKey: @"Rows"];
 		numberOfColumns = [decoder decodeIntForKey: @"Columns"];
 		matrixStore = (double*)[decoder decodeBytesForKey: @"Matrix"
 					returnedLength: &length];
-		matrixElements = length/sizeof(double);
-		for(i=0, count=0; i<(int)numberOfRows; i++)
+		if(length < numberOfRows*numberOfColumns*sizeof(double))
+			[NSException raise: NSInternalInconsistencyException
+				format: @"Archived matrix contains %d bytes - expected %d",
+				length, numberOfRows*numberOfColumns*sizeof(double)];
+
+		//All columns in pre 0.7 versions are doubles.
+		//The archived values are stored row by row.
+		[self _ensureColumnCapacity: numberOfColumns];
+		[self _ensureRowCapacity: numberOfRows];
+		for(j=0; j<numberOfColumns; j++)
 		{
-			matrixRow = [NSMutableArray arrayWithCapacity: 1];
-			for(j=0; j<(int)numberOfColumns; j++)
-			{
-				element = [NSNumber numberWithDouble: matrixStore[count]];
-				[matrixRow addObject: element];
-				count++;
-			}
-			[matrix addObject: matrixRow];
+			[self _setDataType: @"double" ofColumn: j];
+			values = (double*)columns[j].values;
+			for(i=0; i<numberOfRows; i++)
+				values[i] = matrixStore[i*numberOfColumns + j];
 		}
 
 		columnHeaders = [decoder decodeObjectForKey: @"ColumnHeaders"];
@@ -1313,16 +1874,17 @@ is raised.
 	if(columnHeaders == nil)
 	{
 		columnHeaders = [NSMutableArray new];
-		for(i=0; i< (int)numberOfColumns; i++)
+		for(i=0; i< numberOfColumns; i++)
 			[columnHeaders addObject: 
 				[NSString stringWithFormat: @"Column %d", i]];
 	}			
 
 	//all columns in pre 0.7 versions are doubles when unarchived.
 	columnDataTypes = [NSMutableArray new];
-	for(i=0; i< (int)numberOfColumns; i++)
+	for(i=0; i< numberOfColumns; i++)
 		[columnDataTypes addObject: @"double"];
 	
+	[self _updateHeaderIndexes];
 	NSLog(@"Decoding pre0.7 data matrix");
 
 	return self;
@@ -1330,120 +1892,111 @@ is raised.
 
 //Decoding - We Encode and decode strings as Unicode
 
-- (NSArray*) _decodeNumericColumnOfType: (NSString*) dataType
-	numberOfElements: (int) numberOfElements
+- (void) _decodeNumericColumn: (unsigned int) columnIndex
 	fromData: (NSData*) data
-	start: (int) start
-	end: (int*) end
+	start: (unsigned int) start
+	end: (unsigned int*) end
 	byteSwapFlag: (int) byteSwapFlag
 {
-	int i, step, intNumber;
-	double doubleNumber;
-	NSRange range;
-	void *buffer;
-	NSMutableArray* column = [NSMutableArray array];
-
-	step = intNumber = 0;
-	doubleNumber = 0.0;
-	if([dataType isEqual: @"int"])
-		step = sizeof(int);
-	else if([dataType isEqual: @"double"])
-		step = sizeof(double);
-	else	
-		[NSException raise: NSInvalidArgumentException
-			format: @"Encountered unknown numeric data type %@ when coding.", 
-			dataType];
+	unsigned int i;
+	int *intValues;
+	double *doubleValues;
+	NSSwappedDouble *swappedDoubles;
+	AdDataColumn* column;
+
+	column = columns + columnIndex;
+	*end = start + numberOfRows*AdColumnElementSize(column->type);
+	if(*end > [data length])
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Archived numeric data too short for column %d", columnIndex];
+
+	//Copy the column straight into its storage and swap in place if necessary.
+	[data getBytes: column->values range: NSMakeRange(start, *end - start)];
+	if(byteSwapFlag == AdNoSwap)
+		return;
 
-	*end = start + numberOfElements*step;
-	buffer = malloc(step);
-	for(i=start; i< *end; i=i+step)
+	if(column->type == AdIntColumn)
 	{
-		range = NSMakeRange(i, step);
-		[data getBytes: buffer range: range];
-		
-		if([dataType isEqual: @"int"])
+		intValues = (int*)column->values;
+		for(i=0; i<numberOfRows; i++)
 		{
-			if(byteSwapFlag  == AdNoSwap)
-				intNumber = *(int*)buffer;
-			else if(byteSwapFlag == AdSwapBytesToBig)
-				intNumber = NSSwapLittleIntToHost(*(int*)buffer);
+			if(byteSwapFlag == AdSwapBytesToBig)
+				intValues[i] = NSSwapLittleIntToHost(intValues[i]);
 			else if(byteSwapFlag == AdSwapBytesToLittle)
-				intNumber = NSSwapBigIntToHost(*(int*)buffer);
-
-			[column addObject:
-				[NSNumber numberWithInt: intNumber]];
-		}		
-		else if([dataType isEqual: @"double"])
+				intValues[i] = NSSwapBigIntToHost(intValues[i]);
+		}
+	}
+	else if(column->type == AdDoubleColumn)
+	{
+		doubleValues = (double*)column->values;
+		swappedDoubles = (NSSwappedDouble*)column->values;
+		for(i=0; i<numberOfRows; i++)
 		{
-			if(byteSwapFlag == AdNoSwap)
-				doubleNumber = *(double*)buffer;
-			else if(byteSwapFlag == AdSwapBytesToBig)
-			{
-				doubleNumber = NSSwapLittleDoubleToHost(*(NSSwappedDouble*)buffer);
-			}
+			if(byteSwapFlag == AdSwapBytesToBig)
+				doubleValues[i] = NSSwapLittleDoubleToHost(swappedDoubles[i]);
 			else if(byteSwapFlag == AdSwapBytesToLittle)
-				doubleNumber = NSSwapBigDoubleToHost(*(NSSwappedDouble*)buffer);
-
-			[column addObject: 
-				[NSNumber numberWithDouble: doubleNumber]];
-		}	
+				doubleValues[i] = NSSwapBigDoubleToHost(swappedDoubles[i]);
+		}
 	}
-
-	free(buffer);
-	return column;
 }
 
-- (NSArray*) _decodeStringColumnWithNumberOfElements: (int) numberOfElements
+- (void) _decodeStringColumn: (unsigned int) columnIndex
 	fromData: (NSData*) data
-	start: (int) start
-	end: (int*) end
+	start: (unsigned int) start
+	end: (unsigned int*) end
 	byteSwapFlag: (int) byteSwapFlag
 {
-	int i, step, length;
-	NSRange range;
+	unsigned int i, length;
 	int* lengthBuffer;
-	id element;
-	NSData* elementData;
-	NSMutableArray* column = [NSMutableArray array];
+	int* indexes;
+	const char* bytes;
+	NSString* element;
+	AdDataColumn* column;
+
+	column = columns + columnIndex;
+	indexes = (int*)column->values;
+	bytes = (const char*)[data bytes];
 
 	//first extract the string lengths
+	*end = start + numberOfRows*sizeof(int);
+	if(*end > [data length])
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Archived string data too short for column %d", columnIndex];
 
-	step = sizeof(int);
-	*end = start + numberOfElements*step;
-	lengthBuffer = malloc(numberOfElements*step);
-	for(i=0; i< numberOfElements; i++)
-	{
-		range = NSMakeRange(start + i*step, step);
-		[data getBytes: (lengthBuffer + i) range: range];
-	}
+	lengthBuffer = malloc(numberOfRows*sizeof(int) + 1);
+	[data getBytes: lengthBuffer range: NSMakeRange(start, *end - start)];
 
 	//now extract the strings
-	for(i=0; i< numberOfElements; i++)
+	for(i=0; i< numberOfRows; i++)
 	{
 		length = 0;
 		if(byteSwapFlag == AdNoSwap)
 			length = lengthBuffer[i];
-		if(byteSwapFlag == AdSwapBytesToBig)
+		else if(byteSwapFlag == AdSwapBytesToBig)
 			length = NSSwapLittleIntToHost(lengthBuffer[i]);
 		else if(byteSwapFlag == AdSwapBytesToLittle)
 			length = NSSwapBigIntToHost(lengthBuffer[i]);
 
 		start = *end;
 		*end += length;
-		range = NSMakeRange(start, length);
+		if(*end > [data length])
+		{
+			free(lengthBuffer);
+			[NSException raise: NSInternalInconsistencyException
+				format: @"Archived string data too short for column %d", columnIndex];
+		}
 		
 		//We dont have to swap chars since they
 		//are only one byte long.
-		elementData = [data subdataWithRange: range];
 		element = [[NSString alloc]
-				initWithData: elementData
+				initWithBytes: bytes + start
+				length: length
 				encoding: NSUTF8StringEncoding];
-		[element autorelease];
-		[column addObject: element];
+		indexes[i] = [self _indexOfString: element inColumn: column];
+		[element release];
 	}
 
 	free(lengthBuffer);
-	return column;
 }
 
 //recreates the matrix from the archived data 
@@ -1451,45 +2004,45 @@ is raised.
 	stringData: (NSData*) stringData
 	byteSwapFlag: (int) byteSwapFlag
 {	
-	int numericStart, numericEnd, i;
-	int stringStart, stringEnd;
-	NSEnumerator* columnDataTypesEnum;
+	unsigned int numericStart, numericEnd, i;
+	unsigned int stringStart, stringEnd;
 	NSString *columnDataType;
-	NSArray* column;
 	
-	//create the matrix
-	matrix = [NSMutableArray new];
-	for(i=0; i<(int)numberOfRows; i++)
-		[matrix addObject: [NSMutableArray array]];
+	//create the column storage
+	[self _ensureColumnCapacity: numberOfColumns];
+	[self _ensureRowCapacity: numberOfRows];
 
 	numericStart = stringStart = 0;
-	columnDataTypesEnum = [columnDataTypes objectEnumerator];
-	while((columnDataType = [columnDataTypesEnum nextObject]))
+	for(i=0; i<[columnDataTypes count]; i++)
 	{
+		columnDataType = [columnDataTypes objectAtIndex: i];
+		if(AdColumnTypeForDataType(columnDataType) == AdUntypedColumn)
+			[NSException raise: NSInvalidArgumentException
+				format: @"Encountered unknown data type %@ when decoding.", 
+				columnDataType];
+
+		[self _setDataType: columnDataType ofColumn: i];
 		if([columnDataType isEqual: @"string"])
 		{
-			column = [self _decodeStringColumnWithNumberOfElements: numberOfRows
-					fromData: stringData
-					start: stringStart
-					end: &stringEnd
-					byteSwapFlag: byteSwapFlag];
+			[self _decodeStringColumn: i
+				fromData: stringData
+				start: stringStart
+				end: &stringEnd
+				byteSwapFlag: byteSwapFlag];
 			stringStart = stringEnd;
 		}
 		else
 		{
-			column = [self _decodeNumericColumnOfType: columnDataType
-					numberOfElements: numberOfRows
-					fromData: numericData
-					start: numericStart
-					end: &numericEnd
-					byteSwapFlag: byteSwapFlag];
+			[self _decodeNumericColumn: i
+				fromData: numericData
+				start: numericStart
+				end: &numericEnd
+				byteSwapFlag: byteSwapFlag];
 			numericStart = numericEnd;
 		}
-
-		for(i=0; i<(int)numberOfRows; i++)
-			[[matrix objectAtIndex: i]
-				addObject: [column objectAtIndex: i]];
 	}
+
+	[self _updateHeaderIndexes];
 }
 
 /*
@@ -1621,107 +2174,71 @@ is raised.
 
 //Encoding
 
-- (void) _addNumericColumn: (NSArray*) column
-	ofType: (NSString*) dataType
-	toData: (NSMutableData*) data
-{
-	int intValue;
-	double doubleValue;
-	NSEnumerator *columnEnum;
-	id element;
-
-	if([dataType isEqual: @"double"])
-	{
-		columnEnum = [column objectEnumerator];
-		while((element = [columnEnum nextObject]))
-		{
-			doubleValue = [element doubleValue];
-			[data appendBytes: (const void*)&doubleValue
-				   length: sizeof(double)];	
-		}
-		
-	}	
-	else if([dataType isEqual: @"int"])
-	{
-		columnEnum = [column objectEnumerator];
-		while((element = [columnEnum nextObject]))
-		{
-			intValue = [element intValue];
-			[data appendBytes: (const void*)&intValue
-				   length: sizeof(int)];	
-		}		
-	}	
-	else
-		[NSException raise: NSInvalidArgumentException
-			format: @"Encountered unknown numeric data type %@ when coding.", 
-			dataType];
-}
-
 - (NSData*) _encodeNumericColumnsAsData
 {
-	int i;
+	unsigned int i;
 	NSMutableData* data;
-	NSArray* column;
+	AdDataColumn* column;
 	
 	data = [NSMutableData dataWithLength:0];
-	//Only encode if theres something to encode
-	if([columnDataTypes count] != 0)
-		for(i=0; i<(int)numberOfColumns; i++)
-		{
-			column = [self column: i];
-			if(![[columnDataTypes objectAtIndex: i] isEqual: @"string"])
-				[self _addNumericColumn: column 
-					ofType: [columnDataTypes objectAtIndex: i]
-					toData: data];
-		}
+	for(i=0; i<numberOfColumns; i++)
+	{
+		column = columns + i;
+		if(column->type == AdDoubleColumn || column->type == AdIntColumn)
+			[data appendBytes: column->values
+				   length: numberOfRows*AdColumnElementSize(column->type)];
+	}
 	
 	return data;
 }
 
 - (NSData*) _encodeStringColumnsAsData
 {
-	int i, j;
-	id element;
+	unsigned int i, j, numberOfStrings;
+	int *lengthBuffer, *stringLengths, *indexes;
 	NSMutableData* data;
-	int* lengthBuffer;
-	NSArray* column;
+	NSMutableArray* stringData;
+	AdDataColumn* column;
 
-	lengthBuffer = malloc(numberOfRows*sizeof(int));
+	lengthBuffer = malloc(numberOfRows*sizeof(int) + 1);
 	data = [NSMutableData dataWithLength:0];
-	//Only encode if theres something to encode
-	if([columnDataTypes count] != 0)
+	stringData = [NSMutableArray new];
+	for(i=0; i<numberOfColumns; i++)
 	{
-		for(i=0; i<(int)numberOfColumns; i++)
+		column = columns + i;
+		if(column->type != AdStringColumn)
+			continue;
+
+		//Convert each distinct string once
+		numberOfStrings = [column->strings count];
+		stringLengths = malloc(numberOfStrings*sizeof(int) + 1);
+		[stringData removeAllObjects];
+		for(j=0; j<numberOfStrings; j++)
 		{
-			column = [self column: i];
-			if([[columnDataTypes objectAtIndex: i] isEqual: @"string"])
-			{
-				//Go through once and add an array with the lengths of all
-				//the strings
-				for(j=0; j<(int)[column count]; j++)
-				{
-					element = [column objectAtIndex: j];
-					lengthBuffer[j] = [element lengthOfBytesUsingEncoding: 
-								NSUTF8StringEncoding];
-					//lengthBuffer[j] += 1;			
-				}		
-				[data appendBytes: lengthBuffer 
-					length: numberOfRows*sizeof(int)];
-				
-				//Now add the strings
-				for(j=0; j<(int)[column count]; j++)
-				{
-					element = [column objectAtIndex: j];
-					[data appendData: 
-						[element dataUsingEncoding: NSUTF8StringEncoding]];
-				}		
-			}
-		}
-	}	
+			[stringData addObject:
+				[[column->strings objectAtIndex: j] 
+					dataUsingEncoding: NSUTF8StringEncoding]];
+			stringLengths[j] = [[stringData objectAtIndex: j] length];
+		}	
+
+		//Add an array with the lengths of all the strings
+		indexes = (int*)column->values;
+		for(j=0; j<numberOfRows; j++)
+			lengthBuffer[j] = stringLengths[indexes[j]];
+		
+		[data appendBytes: lengthBuffer 
+			length: numberOfRows*sizeof(int)];
+		
+		//Now add the strings
+		for(j=0; j<numberOfRows; j++)
+			[data appendData: [stringData objectAtIndex: indexes[j]]];
+
+		free(stringLengths);
+	}
 	
+	[stringData release];
 	free(lengthBuffer);
 	return data;
-
 }
 
 - (void) encodeWithCoder: (NSCoder*) encoder
@@ -1921,6 +2438,13 @@ Mutable subclass of AdDataMatrix
 				[columnDataTypes addObjectsFromArray: dataTypes];
 			}
 		}	
+
+		[self _ensureColumnCapacity: numberOfColumns];
+		for(i=0; i<(int)[columnDataTypes count]; i++)
+			[self _setDataType: [columnDataTypes objectAtIndex: i]
+				ofColumn: i];
+
+		[self _updateHeaderIndexes];
 	}
 
 	return self;
@@ -1971,20 +2495,18 @@ Mutable subclass of AdDataMatrix
 		[NSException raise: NSInvalidArgumentException
 			format: @"Row %d does not exist", rowIndex];
 	
-	value = [self representationOfObject:  value
-			forColumn: columnIndex];
-
-	[[matrix objectAtIndex: rowIndex] replaceObjectAtIndex: columnIndex
-		withObject: value];
+	[self _setValue: value 
+		atRow: rowIndex
+		column: columnIndex];
 }
 
 - (void) setElementAtRow: (unsigned int) row 
 	ofColumnWithHeader: (NSString*) columnHeader 
 	withValue: (id) value;
 {
-	int columnIndex;
+	unsigned int columnIndex;
 
-	if((columnIndex = [columnHeaders indexOfObject: columnHeader]) == NSNotFound)
+	if((columnIndex = [self indexOfColumnWithHeader: columnHeader]) == NSNotFound)
 		[NSException raise: NSInvalidArgumentException
 			format: @"Column header %@ does not exist", columnHeader];
 	
@@ -1996,8 +2518,6 @@ Mutable subclass of AdDataMatrix
 - (void) extendMatrixWithRow: (NSArray*) anArray
 {
 	int i;
-	NSMutableArray* row;
-	id element;
 
 	//If numberOfColumns is 0 we initialise the matrix to
 	//have the same number of columns as the first row added.
@@ -2008,32 +2528,25 @@ Mutable subclass of AdDataMatrix
 		for(i=0; i<(int)numberOfColumns; i++)
 			[columnHeaders addObject: 
 				[NSString stringWithFormat: @"Column %d", i]];
+
+		[self _ensureColumnCapacity: numberOfColumns];
+		[self _updateHeaderIndexes];
 	}
 
 	if([anArray count] == numberOfColumns)
 	{	
 		//If this is the first row we must set the data types 
 		//(unless the data types were set on initialisation for a AdMutableDataMatrix)
-		//Otherwise we convert anArrays elements to the correct classes.
+		//Otherwise anArrays elements are converted to the column types.
 		if((numberOfRows == 0) && ([columnDataTypes count] == 0))
-		{
 			[self setDataTypesToTypesInArray: anArray];
-			row = [[NSMutableArray alloc] initWithArray: anArray];
-		}
-		else
-		{
-			row = [NSMutableArray new];
-			for(i=0; i<(int)[anArray count]; i++)
-			{
-				element = [self representationOfObject:
-							[anArray objectAtIndex: i]
-						forColumn: i];
-				[row addObject: element];
-			}	
-		}	
 	
-		[matrix addObject: row];
-		[row release];
+		[self _ensureRowCapacity: numberOfRows + 1];
+		for(i=0; i<(int)numberOfColumns; i++)
+			[self _setValue: [anArray objectAtIndex: i]
+				atRow: numberOfRows
+				column: i];
+		
 		numberOfRows++;
 	}
 	else 
@@ -2044,13 +2557,58 @@ Mutable subclass of AdDataMatrix
 	}
 }	
 
+- (void) extendMatrixWithRows: (NSArray*) rows
+{
+	NSEnumerator* rowEnum;
+	id row;
+
+	if([rows count] == 0)
+		return;
+
+	//Reserve the space for all the rows at once
+	[self _ensureRowCapacity: numberOfRows + [rows count]];
+	rowEnum = [rows objectEnumerator];
+	while((row = [rowEnum nextObject]))
+		[self extendMatrixWithRow: row];
+}
+
+- (void) extendMatrixWithDoubleValues: (const double*) values
+{
+	unsigned int i;
+	AdDataColumn* column;
+
+	if([columnDataTypes count] != numberOfColumns)
+	{
+		[columnDataTypes removeAllObjects];
+		[self _ensureColumnCapacity: numberOfColumns];
+		for(i=0; i<numberOfColumns; i++)
+		{
+			[columnDataTypes addObject: @"double"];
+			[self _setDataType: @"double" ofColumn: i];
+		}
+	}
+
+	[self _ensureRowCapacity: numberOfRows + 1];
+	for(i=0; i<numberOfColumns; i++)
+	{
+		column = columns + i;
+		if(column->type == AdDoubleColumn)
+			((double*)column->values)[numberOfRows] = values[i];
+		else if(column->type == AdIntColumn)
+			((int*)column->values)[numberOfRows] = (int)values[i];
+		else
+			((int*)column->values)[numberOfRows] = 
+				[self _indexOfString: [[NSNumber numberWithDouble: values[i]] stringValue]
+					inColumn: column];
+	}
+
+	numberOfRows++;
+}
+
 - (void) extendMatrixWithColumn: (NSArray*) anArray
 {
 	int i;
-	NSString* initialObjectClass, *dataType;
-	NSMutableArray* convertedArray;
-	id element;
-	Class class;
+	NSString *dataType;
 
 	//if there are any previous columns check that this one is
 	//the right length
@@ -2069,62 +2627,46 @@ Mutable subclass of AdDataMatrix
 			format: @"You cannot add an extra column where there are no rows and the column data types are set"];
 	}
 
-	convertedArray = [NSMutableArray array];
+	[self _ensureColumnCapacity: numberOfColumns + 1];
 	if([anArray count] != 0)
 	{
 		//If there are elements in the array the first one sets the data type
-		initialObjectClass = NSStringFromClass([[anArray objectAtIndex: 0] class]);
-		
-		if((class = [self allowedSuperClassForObject: [anArray objectAtIndex: 0]]) != nil)
+		dataType = [self dataTypeForObject: [anArray objectAtIndex: 0]];
+	
+		//If there are no rows we have to create
+		//one for each element we are going to add.
+		if(numberOfRows == 0)
+			[self _ensureRowCapacity: [anArray count]];
+
+		//Convert the array to the correct type before modifying
+		//anything else so the receiver is unchanged if an element
+		//cannot be converted.
+		[self _setDataType: dataType ofColumn: numberOfColumns];
+		NS_DURING
 		{
-			dataType = [classToDataTypeMap objectForKey:
-				    NSStringFromClass(class)];
+			for(i=0; i<(int)[anArray count]; i++)
+				[self _setValue: [anArray objectAtIndex: i]
+					atRow: i
+					column: numberOfColumns];
 		}
-		else
+		NS_HANDLER
 		{
-			dataType = [classToDataTypeMap objectForKey: initialObjectClass];
-			if(dataType == nil)
-				[NSException raise: NSInvalidArgumentException
-					    format: @"AdDataMatrix - Cannot insert objects of class %@",
-				 initialObjectClass];
-		}	
+			AdFreeDataColumn(columns + numberOfColumns);
+			[localException raise];
+		}
+		NS_ENDHANDLER
 	
 		[columnDataTypes addObject: dataType];
-	
-		//Convert the rest of the array to the correct type.
-		//We could add each element using extendMatrixWithRow:
-		//however we want to check if all the objects in anArray are
-		//convertible first.
-	
-		[convertedArray addObject: [anArray objectAtIndex: 0]];
-		for(i=1; i<(int)[anArray count]; i++)
-		{
-			//Use numberOfColumns since we added an object to columnDataTypes
-			//but haven't incremented numberOfColumns yet (done at end)
-			element = [self representationOfObject: [anArray objectAtIndex: i]
-						     forColumn: numberOfColumns];
-			[convertedArray addObject: element];		
-		}
+		if(numberOfRows == 0)
+			numberOfRows = [anArray count];
 	}
-		
-	//If there are no rows we have to create
-	//one for each element we are going to add.
-	if(numberOfRows == 0)
-		for(i=0; i<(int)[convertedArray count]; i++)
-		{		
-			[matrix addObject: [NSMutableArray array]];
-			numberOfRows++;
-		}
-
-	for(i=0; i<(int)numberOfRows; i++)
-		[[matrix objectAtIndex: i] addObject: 
-			[convertedArray objectAtIndex: i]];
 
 	//Add new column header
 	[columnHeaders addObject: 
 		[NSString stringWithFormat: @"Column %d", numberOfColumns]];
 
 	numberOfColumns++; 
+	[self _updateHeaderIndexes];
 }
 
 - (void) extendMatrixWithColumnValues: (NSDictionary*) values
@@ -2132,8 +2674,42 @@ Mutable subclass of AdDataMatrix
 	unsigned int i, index;
 	NSMutableArray *row;
 	NSEnumerator* keyEnum;
+	AdDataColumn* column;
 	id key;
 
+	//If the column types are known write the values directly
+	//into a new row of zeros.
+	if(numberOfColumns != 0 && [columnDataTypes count] == numberOfColumns)
+	{
+		[self _ensureRowCapacity: numberOfRows + 1];
+		for(i=0; i<numberOfColumns; i++)
+		{
+			column = columns + i;
+			if(column->type == AdDoubleColumn)
+				((double*)column->values)[numberOfRows] = 0;
+			else if(column->type == AdIntColumn)
+				((int*)column->values)[numberOfRows] = 0;
+			else
+				((int*)column->values)[numberOfRows] = 
+					[self _indexOfString: @"0" inColumn: column];
+		}
+
+		keyEnum = [values keyEnumerator];	
+		while((key = [keyEnum nextObject]))
+		{		  	
+			index = [self indexOfColumnWithHeader: key];
+			if(index != NSNotFound)
+				[self _setValue: [values objectForKey: key]
+					atRow: numberOfRows
+					column: index];
+			else
+				NSWarnLog(@"No column header matches key %@. Ignoring", key);
+		}
+
+		numberOfRows++;
+		return;
+	}
+
 	//Create a row of zeros
 	row = [NSMutableArray new];
 	for(i=0; i<numberOfColumns; i++)
@@ -2142,7 +2718,7 @@ Mutable subclass of AdDataMatrix
 	//For each key in the dictionary find the index of the corresponding column.
 	//Then replace the object at that index in row with the value of the key
 	keyEnum = [values keyEnumerator];	
-	while(key = [keyEnum nextObject])
+	while((key = [keyEnum nextObject]))
 	{		  	
 		index = [self indexOfColumnWithHeader: key];
 		if(index != NSNotFound)
@@ -2164,6 +2740,19 @@ Mutable subclass of AdDataMatrix
 	NSEnumerator* rowEnum;
 	id row;
 
+	//If the columns match copy the values directly
+	if([extendingMatrix numberOfRows] == 0)
+		return;
+
+	if(numberOfColumns != 0 
+		&& [extendingMatrix numberOfColumns] == numberOfColumns
+		&& [columnDataTypes count] == numberOfColumns
+		&& [columnDataTypes isEqual: [extendingMatrix columnDataTypes]])
+	{
+		[self _appendRowsOfMatrix: extendingMatrix];
+		return;
+	}
+
 	rowEnum = [extendingMatrix rowEnumerator];
 	while((row = [rowEnum nextObject]))
 		[self extendMatrixWithRow: row];
@@ -2175,6 +2764,7 @@ Mutable subclass of AdDataMatrix
 
 - (void) removeRowsWithIndexes: (NSIndexSet*) indexSet
 {
+	unsigned int i, count;
 	unsigned int* buffer;
 
 	if([indexSet lastIndex] == NSNotFound)
@@ -2186,28 +2776,40 @@ Mutable subclass of AdDataMatrix
 			[indexSet lastIndex],
 			numberOfRows];
 
-	//maybe one day this will be implemented - only in Cocoa for now
-	//[matrix removeObjectsWithIndexes: indexSet];
+	//Find the rows to keep
+	buffer = (unsigned int*)malloc(numberOfRows*sizeof(unsigned int));
+	for(count=0, i=0; i<numberOfRows; i++)
+		if(![indexSet containsIndex: i])
+			buffer[count++] = i;
 
-	buffer = (unsigned int*)malloc([indexSet count]*sizeof(unsigned int));
-	[indexSet getIndexes: buffer 
-			maxCount: [indexSet count]
-			inIndexRange: NULL];
-	[matrix	removeObjectsFromIndices: buffer numIndices: [indexSet count]];
+	[self _keepRows: buffer count: count];
 	free(buffer); 
-
-	numberOfRows = [matrix count];
 }
 
 - (void) removeRowsInRange: (NSRange) aRange
 {
+	unsigned int i;
+	size_t size;
+	AdDataColumn* column;
+
 	if(NSMaxRange(aRange) > numberOfRows)
 		[NSException raise: NSRangeException
 			format: @"Range exceeds the number of rows in the receiver (%d, %d)",
 			NSMaxRange(aRange), numberOfRows];
 
-	[matrix removeObjectsInRange: aRange];
-	numberOfRows = [matrix count];
+	for(i=0; i<numberOfColumns; i++)
+	{
+		column = columns + i;
+		if(column->type == AdUntypedColumn)
+			continue;
+		
+		size = AdColumnElementSize(column->type);
+		memmove((char*)column->values + aRange.location*size,
+			(char*)column->values + NSMaxRange(aRange)*size,
+			(numberOfRows - NSMaxRange(aRange))*size);
+	}
+
+	numberOfRows -= aRange.length;
 }
 
 - (void) removeRow: (unsigned int) rowIndex
@@ -2217,8 +2819,8 @@ Mutable subclass of AdDataMatrix
 			format: @"Index %d is out of row range %d",
 			rowIndex,
 			numberOfRows];
-	[matrix removeObjectAtIndex: rowIndex];
-	numberOfRows = [matrix count];
+
+	[self removeRowsInRange: NSMakeRange(rowIndex, 1)];
 }
 
 - (void) setColumnHeaders: (NSArray*) anArray
@@ -2235,6 +2837,7 @@ Mutable subclass of AdDataMatrix
 		holder = columnHeaders;
 		columnHeaders = [anArray mutableCopy];
 		[holder release];
+		[self _updateHeaderIndexes];
 	}	
 }
 
@@ -2246,6 +2849,7 @@ Mutable subclass of AdDataMatrix
 			
 	[columnHeaders replaceObjectAtIndex: columnIndex
 		withObject: string];
+	[self _updateHeaderIndexes];
 }
 
 - (void) setName: (NSString*) aString
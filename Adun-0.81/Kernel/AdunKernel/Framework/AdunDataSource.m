@@ -397,7 +397,12 @@ raised.
 	if(nonbondedPairs != nil)
 		[nonbondedPairs release];
 
-	nonbondedPairs = [array copy];
+	//Store the pairs as exclusions
+	nonbondedPairs = nil;
+	if(array != nil)
+		nonbondedPairs = [[AdNonbondedPairArray alloc]
+					initWithIndexSetArray: array
+					numberOfElements: [elementConfiguration numberOfRows]];
 }
 
 //Preliminary
@@ -434,17 +439,8 @@ raised.
 		}		
 	}
 
-	//Temporary
-	int total;
-	NSEnumerator* pairsEnum;
-	id set;
-	
-	total = 0;
-	pairsEnum = [nonbondedPairs objectEnumerator];
-	while((set = [pairsEnum nextObject]))
-		total += [set count];
-
-	[description appendFormat: @"\nThere are %d nonbonded pairs\n", total];
+	[description appendFormat: @"\nThere are %llu nonbonded pairs\n", 
+		[nonbondedPairs numberOfPairs]];
 
 	return description;
 }
@@ -501,18 +497,21 @@ related methods.
 
 @implementation AdDataSource (AdDataSourceCodingExtensions)
 
-- (NSMutableArray*) _decodeIndexArrayForKey: (NSString*) key 
+/*
+ * Decodes an array of index sets encoded with _encodeIndexArray:forKey:usingCoder:.
+ * The sets are decoded directly into an AdNonbondedPairArray.
+ */
+- (NSArray*) _decodeIndexArrayForKey: (NSString*) key 
 	usingCoder: (NSCoder*) decoder
 	encodedByteOrder: (unsigned int) encodedByteOrder
 {
-	int i, j, count;
+	int i, count;
 	int totalRanges, totalSets;
 	int byteSwapFlag;
 	unsigned int length;
 	int* rangesPerSet, *value;
 	NSRange* totalRangeArray;
-	NSRange* rangeArray, *range;
-	NSIndexSet* set;
+	NSRange *range;
 	id array;
 
 	if(key != nil)
@@ -589,27 +588,21 @@ related methods.
 		}	
 	}
 
-	array = [NSMutableArray array];
 	for(count = 0, i=0; i<totalSets; i++)
-	{
-		rangeArray = (NSRange*)malloc(rangesPerSet[i]*sizeof(NSRange));
-		for(j=0; j<rangesPerSet[i]; j++)
-		{	
-			rangeArray[j] = totalRangeArray[count];
-			count++;
-		}
-		set = [NSIndexSet indexSetFromRangeArray: rangeArray 
-				ofLength: rangesPerSet[i]];
-		[array addObject: set];
-		free(rangeArray);
-	}
+		count += rangesPerSet[i];
 
 	if(totalRanges != count)
 		[NSException raise: NSInternalInconsistencyException
 			format: [NSString stringWithFormat: 
 			@"Did not decode the same number of ranges encoded. %d %d", count, totalRanges]];
 
-	return array;
+	array = [[AdNonbondedPairArray alloc] 
+			initWithRanges: totalRangeArray
+			rangesPerSet: rangesPerSet
+			numberOfSets: totalSets
+			numberOfElements: [elementConfiguration numberOfRows]];
+
+	return [array autorelease];
 }
 
 - (id) initWithCoder: (NSCoder*) decoder
@@ -904,7 +897,12 @@ are required. The new entries are added to the end of the corresponding matrices
 	if(nonbondedPairs != nil)
 		[nonbondedPairs release];
 
-	nonbondedPairs = [array copy];
+	//Store the pairs as exclusions
+	nonbondedPairs = nil;
+	if(array != nil)
+		nonbondedPairs = [[AdNonbondedPairArray alloc]
+					initWithIndexSetArray: array
+					numberOfElements: [elementConfiguration numberOfRows]];
 }
 
 - (void) setGroupProperties: (AdDataMatrix*) dataMatrix
@@ -1114,6 +1112,9 @@ updated to use such index arrays more generaly.
 	NSIndexSet *indexSet;
 	NSMutableIndexSet *newSet;
 	NSEnumerator* indexEnum;
+
+	if([indexArray isKindOfClass: [AdNonbondedPairArray class]])
+		return [(AdNonbondedPairArray*)indexArray pairArrayByRemovingElement: elementIndex];
 	
 	newArray = [NSMutableArray new];
 	indexEnum = [indexArray objectEnumerator];
@@ -1168,7 +1169,7 @@ For example there is a group (11, 12) indicating an interaction between elements
 */
 - (void) removeElement: (unsigned int) elementIndex
 {
-	NSArray* newPairs;
+	AdNonbondedPairArray* newPairs;
 	NSEnumerator* interactionEnum;
 	id interaction;
 	NSAutoreleasePool* pool = [NSAutoreleasePool new];
@@ -1202,7 +1203,7 @@ For example there is a group (11, 12) indicating an interaction between elements
 	[self _removeElementFromGroup: elementIndex];
 
 	//Update the nonbonded interactions - This will also change
-	newPairs = [self _reindexElementsFrom: elementIndex
+	newPairs = (AdNonbondedPairArray*)[self _reindexElementsFrom: elementIndex
 			inIndexArray: nonbondedPairs];
 	[nonbondedPairs release];
 	nonbondedPairs = [newPairs retain];
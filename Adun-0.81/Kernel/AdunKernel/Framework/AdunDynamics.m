@@ -137,6 +137,7 @@
 
 		[self calculateCentreOfMass];
 
+		numberOfConstraints = 0;
 		degreesOfFreedom = 3*numberOfElements;
 		if(value)
 			[self removeTranslationalDOF];
@@ -215,7 +216,7 @@
 	[velocitiesLock unlock];
 	
 	//Update constants and DOF
-	degreesOfFreedom = 3*numberOfElements - 3;;
+	degreesOfFreedom = 3*numberOfElements - 3 - numberOfConstraints;
 	kineticEnergyToTemperature =  (2*KB_1)/(degreesOfFreedom);
 
 	//Recalculate kinetic energy
@@ -303,6 +304,29 @@
 	return degreesOfFreedom;
 }
 
+- (void) setNumberOfConstraints: (unsigned int) number
+{
+	if(degreesOfFreedom + numberOfConstraints - (int)number < 1)
+		[NSException raise: NSInvalidArgumentException
+			format: @"%d constraints leave no degrees of freedom (%d elements)",
+			number, numberOfElements];
+
+	[velocitiesLock lock];
+	degreesOfFreedom += numberOfConstraints - (int)number;
+	numberOfConstraints = number;
+	kineticEnergyToTemperature =  (2*KB_1)/(degreesOfFreedom);
+	temperature = kineticEnergyToTemperature*kineticEnergy;
+	[velocitiesLock unlock];
+	
+	NSDebugLLog(@"AdDynamics", @"%d constraints. Degrees of freedom %d. New temperature %lf", 
+		numberOfConstraints, degreesOfFreedom, temperature);
+}
+
+- (unsigned int) numberOfConstraints
+{
+	return numberOfConstraints;
+}
+
 - (NSArray*) elementTypes
 {
 	return [[elementTypes retain]
@@ -476,6 +500,7 @@ immediatly unlock it and return YES.
 		seed = [decoder decodeIntForKey: @"Seed"];
 		targetTemperature = [decoder decodeDoubleForKey: @"TargetTemperature"];
 		degreesOfFreedom = [decoder decodeIntForKey: @"DegreesOfFreedom"];
+		numberOfConstraints = [decoder decodeIntForKey: @"NumberOfConstraints"];
 		dataSource = [decoder decodeObjectForKey: @"DataSource"];
 		kineticEnergyToTemperature =  (2*KB_1)/(degreesOfFreedom);
 
@@ -515,6 +540,7 @@ immediatly unlock it and return YES.
 		[encoder encodeInt: seed forKey: @"Seed"];
 		[encoder encodeDouble: targetTemperature forKey: @"TargetTemperature"];
 		[encoder encodeInt: degreesOfFreedom forKey: @"DegreesOfFreedom"];
+		[encoder encodeInt: numberOfConstraints forKey: @"NumberOfConstraints"];
 		[encoder encodeConditionalObject: dataSource forKey: @"DataSource"];
 
 		matrix = [AdDataMatrix matrixFromADMatrix: coordinates];
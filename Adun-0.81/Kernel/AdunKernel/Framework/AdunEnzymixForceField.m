@@ -150,6 +150,14 @@ Public Methods
 		customTermsEnum = [customTerms keyEnumerator];
 		while((term = [customTermsEnum nextObject]))
 		{	
+			//Deactivated custom terms are not evaluated
+			if([[state valueForKey: @"InactiveTerms"] containsObject: term])
+			{
+				[customPotentials setValue: [NSNumber numberWithDouble: 0]
+					forKey: term];
+				continue;
+			}
+
 			[[customTerms objectForKey: term]  evaluateEnergy];
 			potential = [[customTerms objectForKey: term] energy];	
 			total_energy += potential;
@@ -333,6 +341,14 @@ Public Methods
 		customTermsEnum = [customTerms keyEnumerator];
 		while((term = [customTermsEnum nextObject]))
 		{	
+			//Deactivated custom terms are not evaluated
+			if([[state valueForKey: @"InactiveTerms"] containsObject: term])
+			{
+				[customPotentials setValue: [NSNumber numberWithDouble: 0]
+					forKey: term];
+				continue;
+			}
+
 			[[customTerms objectForKey: term]  evaluateForces];
 			potential = [[customTerms objectForKey: term] energy];	
 			total_energy += potential;
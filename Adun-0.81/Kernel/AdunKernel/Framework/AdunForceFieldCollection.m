@@ -52,6 +52,9 @@
 	[systems release];
 	systems = [forceFields valueForKey: @"system"];
 	[systems retain];
+	[[NSNotificationCenter defaultCenter]
+		postNotificationName: AdForceFieldCollectionDidChangeNotification
+		object: self];
 }
 
 - (void) removeForceField: (AdForceField*) aForceField
@@ -66,6 +69,9 @@
 	[systems release];
 	systems = [forceFields valueForKey: @"system"];
 	[systems retain];
+	[[NSNotificationCenter defaultCenter]
+		postNotificationName: AdForceFieldCollectionDidChangeNotification
+		object: self];
 }
 
 - (NSArray*) forceFields
@@ -79,6 +85,9 @@
 	forceFields = [anArray mutableCopy];
 	[activeForceFields removeAllObjects];
 	[activeForceFields addObjectsFromArray: forceFields];
+	[[NSNotificationCenter defaultCenter]
+		postNotificationName: AdForceFieldCollectionDidChangeNotification
+		object: self];
 }
 
 - (void) evaluateForces
@@ -176,6 +185,9 @@ Returns the force fields in anArray operating on aSystem
 	{
 		[inactiveForceFields removeObject: aForceField];
 		[activeForceFields addObject: aForceField];
+		[[NSNotificationCenter defaultCenter]
+			postNotificationName: AdForceFieldCollectionDidChangeNotification
+			object: self];
 	}	
 }
 
@@ -189,6 +201,9 @@ Returns the force fields in anArray operating on aSystem
 	{
 		[activeForceFields removeObject: aForceField];
 		[inactiveForceFields addObject: aForceField];
+		[[NSNotificationCenter defaultCenter]
+			postNotificationName: AdForceFieldCollectionDidChangeNotification
+			object: self];
 	}	
 }
 
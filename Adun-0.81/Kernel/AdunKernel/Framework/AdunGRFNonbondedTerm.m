@@ -60,33 +60,36 @@ static NSArray* knownTypes;
  */
 - (void) _precomputeParameters
 {
-	int atomOne, atomTwo;
-	ListElement* list_p;
-
-	list_p = interactionList->next;
+	int j, atomOne, atomTwo;
+	int* offsets, *neighbours;
+	double *paramOne, *paramTwo, *chargeProducts;
+
+	offsets = pairList->offsets;
+	neighbours = pairList->neighbours;
+	paramOne = pairList->paramOne;
+	paramTwo = pairList->paramTwo;
+	chargeProducts = pairList->chargeProducts;
 	if([lennardJonesType isEqual: @"A"])
 	{	
-		while(list_p->next != NULL)
-		{
-			atomOne = list_p->bond[0];
-			atomTwo = list_p->bond[1];
-			list_p->params[0] = parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0];
-			list_p->params[1] = parameters->matrix[atomOne][1]*parameters->matrix[atomTwo][1];
-			list_p->params[2] = partialCharges[atomOne]*partialCharges[atomTwo];
-			list_p = list_p->next;
-		}
+		for(atomOne=0; atomOne < pairList->numberOfElements; atomOne++)
+			for(j=offsets[atomOne]; j<offsets[atomOne+1]; j++)
+			{
+				atomTwo = neighbours[j];
+				paramOne[j] = parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0];
+				paramTwo[j] = parameters->matrix[atomOne][1]*parameters->matrix[atomTwo][1];
+				chargeProducts[j] = partialCharges[atomOne]*partialCharges[atomTwo];
+			}
 	}
 	else
 	{
-		while(list_p->next != NULL)
-		{
-			atomOne = list_p->bond[0];
-			atomTwo = list_p->bond[1];
-			list_p->params[0] = sqrt(parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0]);
-			list_p->params[1] = (parameters->matrix[atomOne][1] + parameters->matrix[atomTwo][1]);
-			list_p->params[2] = partialCharges[atomOne]*partialCharges[atomTwo];
-			list_p = list_p->next;
-		}
+		for(atomOne=0; atomOne < pairList->numberOfElements; atomOne++)
+			for(j=offsets[atomOne]; j<offsets[atomOne+1]; j++)
+			{
+				atomTwo = neighbours[j];
+				paramOne[j] = sqrt(parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0]);
+				paramTwo[j] = (parameters->matrix[atomOne][1] + parameters->matrix[atomTwo][1]);
+				chargeProducts[j] = partialCharges[atomOne]*partialCharges[atomTwo];
+			}
 	}
 }
 
@@ -238,7 +241,7 @@ static NSArray* knownTypes;
 		pairs = nil;
 		lennardJonesType = nil;
 		system = nil;
-		interactionList = NULL;
+		pairList = NULL;
 		partialCharges = NULL;
 		forces = parameters = NULL;
 		usingExternalForceMatrix = NO;
@@ -386,12 +389,11 @@ static NSArray* knownTypes;
 
 - (void) evaluateForces;
 {
-	ListElement* list_p;
 	AdMatrix* coordinates;
 
 	coordinates = [system coordinates];
 
-	if(interactionList == NULL)
+	if(pairList == NULL)
 	{
 		if(system != nil && pairs != nil)
 		{
@@ -402,44 +404,33 @@ static NSArray* knownTypes;
 			return;
 	}
 
-	//May be quicker to get the number of nonbonded interactions and then use a for loop here
-	
 	vdwPotential = 0;
 	estPotential = 0;
 
-	list_p = interactionList->next;
 
 	if([lennardJonesType isEqual: @"A"])
 	{
-		while(list_p->next != NULL)
-		{	
-			AdGRFCoulombAndLennardJonesAForce(list_p, 
-				coordinates->matrix, 
-				forces->matrix, 
-				electrostaticConstant, 
-				cutoff,
-				b0,
-				b1,
-				&vdwPotential, 
-				&estPotential);
-			list_p = list_p->next;
-		}
+		AdGRFCoulombAndLennardJonesAPairListForce(pairList, 
+			coordinates->matrix, 
+			forces->matrix, 
+			electrostaticConstant, 
+			cutoff,
+			b0,
+			b1,
+			&vdwPotential, 
+			&estPotential);
 	}
 	else
 	{
-		while(list_p->next != NULL)
-		{
-			AdGRFCoulombAndLennardJonesBForce(list_p, 
-				coordinates->matrix, 
-				forces->matrix, 
-				electrostaticConstant, 
-				cutoff,
-				b0,
-				b1,
-				&vdwPotential, 
-				&estPotential);
-			list_p = list_p->next;
-		}
+		AdGRFCoulombAndLennardJonesBPairListForce(pairList, 
+			coordinates->matrix, 
+			forces->matrix, 
+			electrostaticConstant, 
+			cutoff,
+			b0,
+			b1,
+			&vdwPotential, 
+			&estPotential);
 	}
 }
 
@@ -455,12 +446,11 @@ static NSArray* knownTypes;
 
 - (void) evaluateEnergy;
 {
-	ListElement* list_p;
 	AdMatrix* coordinates;
 
 	coordinates = [system coordinates];
 
-	if(interactionList == NULL)
+	if(pairList == NULL)
 	{
 		/*
 		 * If system and pairs are not nil the list was invalidated by receipt of
@@ -481,35 +471,25 @@ static NSArray* knownTypes;
 
 	if([lennardJonesType isEqual: @"A"])
 	{
-		list_p = interactionList->next;
-		while(list_p->next != NULL)
-		{
-			AdGRFCoulombAndLennardJonesAEnergy(list_p, 
-				coordinates->matrix,
-				electrostaticConstant, 
-				cutoff,
-				b0,
-				b1,
-				&vdwPotential, 
-				&estPotential);
-			list_p = list_p->next;
-		}
+		AdGRFCoulombAndLennardJonesAPairListEnergy(pairList, 
+			coordinates->matrix,
+			electrostaticConstant, 
+			cutoff,
+			b0,
+			b1,
+			&vdwPotential, 
+			&estPotential);
 	}
 	else
 	{
-		list_p = interactionList->next;
-		while(list_p->next != NULL)
-		{
-			AdGRFCoulombAndLennardJonesBEnergy(list_p, 
-				coordinates->matrix,
-				electrostaticConstant, 
-				cutoff,
-				b0,
-				b1,
-				&vdwPotential, 
-				&estPotential);
-			list_p = list_p->next;
-		}
+		AdGRFCoulombAndLennardJonesBPairListEnergy(pairList, 
+			coordinates->matrix,
+			electrostaticConstant, 
+			cutoff,
+			b0,
+			b1,
+			&vdwPotential, 
+			&estPotential);
 	}
 }
 
@@ -524,7 +504,7 @@ static NSArray* knownTypes;
 
 - (void) handlerDidInvalidateList: (AdListHandler*) handler
 {
-	interactionList = NULL;
+	pairList = NULL;
 }
 
 - (void) handlerDidHandleContentChange: (AdListHandler*) handler
@@ -578,7 +558,7 @@ static NSArray* knownTypes;
 	
 	NSDebugLLog(@"AdGRFNonbondedTerm", @"Recreating list");
 	[listHandler createList];
-	interactionList = [[listHandler pairList] pointerValue];
+	pairList = [listHandler pairList];
 	NSDebugLLog(@"AdGRFNonbondedTerm", @"Precomputing parameters");
 	[self _precomputeParameters];
 	NSDebugLLog(@"AdGRFNonbondedTerm", @"Update complete");
@@ -788,7 +768,7 @@ Return YES if the term can calculate forces.
 	pairs = [nonbondedPairs retain];
 	[listHandler setAllowedPairs: pairs];
 	[listHandler createList];
-	interactionList = [[listHandler pairList] pointerValue];
+	pairList = [listHandler pairList];
 	[self _precomputeParameters];
 }
 
@@ -839,9 +819,9 @@ Return YES if the term can calculate forces.
  Returns a pointer to the beginning of the list of nonbonded interaction pairs the receiver uses.
  See interface definition for more.
  */
-- (ListElement*) interactionList
+- (AdPairList*) pairList
 {
-	return interactionList;
+	return pairList;
 }
 
 - (id) copyWithZone:(NSZone *)aZone
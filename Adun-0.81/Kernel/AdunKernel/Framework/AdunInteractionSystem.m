@@ -160,20 +160,28 @@ i.e. that can be defined by some external means (nonbonded lists etc.)
 	systemTwoRange = NSMakeRange(systemOneElements, systemTwoElements);
 }
 
+/*
+ * Each element of system one interacts with every element of system two.
+ * The pairs are stored as an AdNonbondedPairArray where the lower bound of 
+ * each element is the first element of system two.
+ */
 - (void) _createNonbondedPairs
 {
 	int i;
-	NSMutableIndexSet* indexes;
-	NSRange indexRange;
+	int* lowerBounds;
 
-	nonbondedPairs = [NSMutableArray new];
+	lowerBounds = [[AdMemoryManager appMemoryManager]
+			allocateArrayOfSize: (systemOneElements + 1)*sizeof(int)];
 	for(i=0; i<systemOneElements; i++)
-	{
-		indexRange.location = systemOneElements;
-		indexRange.length = numberOfElements - indexRange.location;
-		indexes = [NSMutableIndexSet indexSetWithIndexesInRange: indexRange];
-		[nonbondedPairs addObject: indexes];
-	}
+		lowerBounds[i] = systemOneElements;
+
+	nonbondedPairs = [[AdNonbondedPairArray alloc]
+				initWithNumberOfElements: numberOfElements
+				numberOfSets: systemOneElements
+				lowerBounds: lowerBounds
+				exclusionOffsets: NULL
+				exclusions: NULL];
+	[[AdMemoryManager appMemoryManager] freeArray: lowerBounds];
 }
 
 /**
@@ -334,17 +342,8 @@ Object Creation
 		}		
 	}
 	
-	//Temporary
-	int total;
-	NSEnumerator* pairsEnum;
-	id set;
-	
-	total = 0;
-	pairsEnum = [nonbondedPairs objectEnumerator];
-	while((set = [pairsEnum nextObject]))
-		total += [set count];
-	
-	[description appendFormat: @"\nThere are %d nonbonded pairs\n", total];
+	[description appendFormat: @"\nThere are %llu nonbonded pairs\n", 
+		[nonbondedPairs numberOfPairs]];
 	
 	return description;
 }
@@ -441,6 +440,16 @@ Object Creation
 	return systems;
 }
 
+- (id) periodicBox
+{
+	id box;
+
+	if((box = [systemOne periodicBox]) != nil)
+		return box;
+
+	return [systemTwo periodicBox];
+}
+
 - (unsigned int) numberOfElements
 {
 	return numberOfElements;
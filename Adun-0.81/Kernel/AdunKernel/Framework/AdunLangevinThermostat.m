@@ -256,6 +256,11 @@ You can find more at http://cmm.info.nih.gov/intro_simulation/node24.html for ex
 			removeMessageWithName: @"langevinResetDOFMessage"];
 }
 
+- (unsigned int) simulatorHooks
+{
+	return AdSimulatorFirstVelocityUpdateHook | AdSimulatorDidPerformSecondVelocityUpdateHook;
+}
+
 - (void) simulatorWillPerformFirstVelocityUpdateForSystem: (AdSystem*) aSystem
 {
 	int i, j;
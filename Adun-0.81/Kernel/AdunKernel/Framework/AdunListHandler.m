@@ -66,11 +66,11 @@
 	return nil;	
 }
 
-- (NSValue*) pairList
+- (AdPairList*) pairList
 {
 	NSWarnLog(@"Abstract method. You should only initialise a concrete subclass of %@",
 		NSStringFromClass([self class]));
-	return nil;	
+	return NULL;	
 }
 
 - (int) numberOfListElements
@@ -205,6 +205,7 @@ BOOL forceFieldDebug = NO;
 	[availableTerms release];
 	[customTerms release];
 	[customTermNames release];
+	[energyTermNames release];
 	[nonbondedTerm release];
 	[vdwInteractionType release];
 	[memoryManager freeMatrix: bonds];
@@ -287,6 +288,7 @@ BOOL forceFieldDebug = NO;
 		[customTerms setObject: object forKey: name];
 		[customTermNames addObject: name];
 		[availableTerms addObject: name];
+		termsVersion++;
 		[[state valueForKey: @"CustomTerms"] 
 			setObject: [NSNumber numberWithInt: 0]
 			forKey: name];
@@ -320,6 +322,7 @@ BOOL forceFieldDebug = NO;
 	
 	[customTerms removeAllObjects];
 	[customTermNames removeAllObjects];
+	termsVersion++;
 	
 	keyEnum = [aDict keyEnumerator];
 	while((termName = [keyEnum nextObject]))
@@ -349,6 +352,7 @@ BOOL forceFieldDebug = NO;
 	[[state valueForKey: @"CustomTerms"]
 		removeObjectForKey: name];
 	[availableTerms removeObject: name];	
+	termsVersion++;
 }
 
 //Activating/Deactivating Terms
@@ -357,7 +361,7 @@ BOOL forceFieldDebug = NO;
 {
 	NSMutableArray* terms;
 
-	terms = [self availableTerms];
+	terms = [[availableTerms mutableCopy] autorelease];
 	[terms removeObjectsInArray: [self deactivatedTerms]]; 
 
 	return terms;
@@ -570,6 +574,63 @@ Accessors
 	return [[array copy] autorelease];
 }
 
+- (unsigned int) termsVersion
+{
+	unsigned int i, count;
+	BOOL changed = NO;
+	NSString* termName;
+
+	//Whether a custom term can evaluate its energy may change after it was added.
+	//Check the custom terms in allTerms are the ones present when this was last called.
+	if(energyTermNames == nil)
+		energyTermNames = [NSMutableArray new];
+
+	for(count = 0, i=0; i<[customTermNames count]; i++)
+	{
+		termName = [customTermNames objectAtIndex: i];
+		if([[customTerms objectForKey: termName] canEvaluateEnergy])
+		{
+			if(count >= [energyTermNames count] 
+				|| ![[energyTermNames objectAtIndex: count] isEqual: termName])
+			{
+				changed = YES;
+				break;
+			}
+			count++;
+		}
+	}
+
+	if(changed || count != [energyTermNames count])
+	{
+		[energyTermNames removeAllObjects];
+		for(i=0; i<[customTermNames count]; i++)
+		{
+			termName = [customTermNames objectAtIndex: i];
+			if([[customTerms objectForKey: termName] canEvaluateEnergy])
+				[energyTermNames addObject: termName];
+		}
+		termsVersion++;
+	}
+
+	return termsVersion;
+}
+
+- (const double*) pointerToEnergyOfCoreTerm: (NSString*) termName
+{
+	NSValue* value;
+
+	value = [[state valueForKey: @"TermPotentials"] objectForKey: termName];
+	if(value == nil)
+		return NULL;
+
+	return (const double*)[value pointerValue];
+}
+
+- (id) customTermWithName: (NSString*) termName
+{
+	return [customTerms objectForKey: termName];
+}
+
 - (NSArray*) coreTerms
 {
 	return [[coreTerms retain] autorelease];
@@ -0,0 +1,554 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#include "AdunKernel/AdunMultipleTimeStepSimulator.h"
+
+@implementation AdMultipleTimeStepSimulator
+
+/*
+ * Level handling
+ */
+
+- (void) _freeLevelAccelerations
+{
+	int i, j;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	if(levelAccelerations != NULL)
+	{
+		for(i=0; i<numberOfSystems; i++)
+		{
+			for(j=0; j<numberOfLevels; j++)
+				[memoryManager freeMatrix: levelAccelerations[i][j]];
+
+			free(levelAccelerations[i]);
+		}
+
+		free(levelAccelerations);
+		levelAccelerations = NULL;
+	}
+
+	free(levelSteps);
+	free(levelHalfTimeSteps);
+	levelSteps = NULL;
+	levelHalfTimeSteps = NULL;
+}
+
+/**
+Returns the level \e termName is evaluated in. \e coreTerms
+is nil if the force field the term belongs to does not have core terms.
+*/
+- (int) _levelForTerm: (NSString*) termName coreTerms: (NSArray*) coreTerms
+{
+	int i;
+
+	for(i=0; i<(int)[levels count]; i++)
+		if([[[levels objectAtIndex: i] objectForKey: @"Terms"] containsObject: termName])
+			return i + 1;
+
+	//Unassigned custom terms are evaluated in the outermost level
+	if(coreTerms != nil && ![coreTerms containsObject: termName])
+		return numberOfLevels - 1;
+
+	return 0;
+}
+
+/**
+Divides the active terms of each force field into levels and allocates
+the level acceleration matrices. Called when production begins since
+the systems and force fields may have changed since the last production loop.
+*/
+- (void) _prepareLevels
+{
+	int i, j, level, numberOfElements;
+	NSMutableArray* isolated, *outer;
+	NSEnumerator* forceFieldEnum, *termEnum;
+	NSArray* coreTerms;
+	NSString* term;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+	id forceField;
+
+	[self _freeLevelAccelerations];
+	[self buildIntegrationPlan];
+	[levelForceFields removeAllObjects];
+	[isolatedTerms removeAllObjects];
+	[outerTerms removeAllObjects];
+
+	numberOfLevels = [levels count] + 1;
+	levelSteps = (int*)malloc(numberOfLevels*sizeof(int));
+	levelHalfTimeSteps = (double*)malloc(numberOfLevels*sizeof(double));
+	levelSteps[0] = 1;
+	levelHalfTimeSteps[0] = halfTimeStep;
+	for(i=1; i<numberOfLevels; i++)
+	{
+		levelSteps[i] = levelSteps[i-1]*[[[levels objectAtIndex: i-1] objectForKey: @"Steps"] intValue];
+		levelHalfTimeSteps[i] = halfTimeStep*levelSteps[i];
+		NSDebugLLog(@"AdMultipleTimeStepSimulator",
+			@"Level %d - Time step %lf", i, 2*levelHalfTimeSteps[i]);
+	}
+
+	/*
+	 * For each force field and level we create two arrays.
+	 * The first contains the terms to deactivate to evaluate only that level.
+	 * The second contains the terms to deactivate to evaluate all the levels up to it.
+	 */
+	forceFieldEnum = [[forceFieldCollection forceFields] objectEnumerator];
+	while((forceField = [forceFieldEnum nextObject]))
+	{
+		coreTerms = nil;
+		if([forceField respondsToSelector: @selector(coreTerms)])
+			coreTerms = [forceField coreTerms];
+
+		isolated = [NSMutableArray array];
+		outer = [NSMutableArray array];
+		for(i=0; i<numberOfLevels; i++)
+		{
+			[isolated addObject: [NSMutableArray array]];
+			[outer addObject: [NSMutableArray array]];
+		}
+
+		termEnum = [[forceField activatedTerms] objectEnumerator];
+		while((term = [termEnum nextObject]))
+		{
+			level = [self _levelForTerm: term coreTerms: coreTerms];
+			for(i=0; i<numberOfLevels; i++)
+			{
+				if(i != level)
+					[[isolated objectAtIndex: i] addObject: term];
+
+				if(i < level)
+					[[outer objectAtIndex: i] addObject: term];
+			}
+		}
+
+		NSDebugLLog(@"AdMultipleTimeStepSimulator",
+			@"Force field %@. Terms deactivated for each level %@",
+			forceField, isolated);
+
+		[levelForceFields addObject: forceField];
+		[isolatedTerms addObject: isolated];
+		[outerTerms addObject: outer];
+	}
+
+	numberOfSystems = numberOfPlannedSystems;
+	levelAccelerations = (AdMatrix***)malloc(numberOfSystems*sizeof(AdMatrix**));
+	for(i=0; i<numberOfSystems; i++)
+	{
+		numberOfElements = [systemPlans[i].system numberOfElements];
+		levelAccelerations[i] = (AdMatrix**)malloc(numberOfLevels*sizeof(AdMatrix*));
+		for(j=0; j<numberOfLevels; j++)
+			levelAccelerations[i][j] = [memoryManager allocateMatrixWithRows: numberOfElements
+							withColumns: 3];
+	}
+}
+
+/**
+Sums the accelerations acting on the system at \e index due to the currently
+evaluated terms into \e matrix.
+*/
+- (void) _gatherAccelerationsOfSystemAtIndex: (int) index intoMatrix: (AdMatrix*) matrix
+{
+	register int j, k;
+	AdSystemIntegrationPlan* plan;
+
+	for(j=0; j < matrix->no_rows; j++)
+		for(k=0; k<3; k++)
+			matrix->matrix[j][k] = 0;
+
+	plan = systemPlans + index;
+	for(j=0; j<plan->numberOfSources; j++)
+		plan->accelerations[j] = [plan->forceFields[j] accelerations]->matrix[plan->offsets[j]];
+
+	AdUpdateVelocities(matrix->matrix[0],
+		plan->accelerations,
+		plan->numberOfSources,
+		matrix->no_rows,
+		1.0);
+}
+
+/**
+Evaluates the forces deactivating, for each force field, the terms in
+the array at index \e level of the corresponding entry in \e termArrays.
+The accelerations are placed in the level acceleration matrices of \e level.
+The deactivated terms are always reactivated.
+Returns NO, without gathering the accelerations, if the force evaluation
+invalidated the integration plan e.g. because elements were removed from a system.
+*/
+- (BOOL) _evaluateLevel: (int) level deactivating: (NSArray*) termArrays
+{
+	int i;
+
+	for(i=0; i<(int)[levelForceFields count]; i++)
+		[[levelForceFields objectAtIndex: i]
+			deactivateTermsWithNames: [[termArrays objectAtIndex: i] objectAtIndex: level]];
+
+	NS_DURING
+	{
+		[forceFieldCollection evaluateForces];
+	}
+	NS_HANDLER
+	{
+		for(i=0; i<(int)[levelForceFields count]; i++)
+			[[levelForceFields objectAtIndex: i]
+				activateTermsWithNames: [[termArrays objectAtIndex: i] objectAtIndex: level]];
+		[localException raise];
+	}
+	NS_ENDHANDLER
+
+	for(i=0; i<(int)[levelForceFields count]; i++)
+		[[levelForceFields objectAtIndex: i]
+			activateTermsWithNames: [[termArrays objectAtIndex: i] objectAtIndex: level]];
+
+	//The plan and level matrices refer to the old system contents
+	if(!planIsValid)
+		return NO;
+
+	for(i=0; i<numberOfSystems; i++)
+		[self _gatherAccelerationsOfSystemAtIndex: i
+			intoMatrix: levelAccelerations[i][level]];
+
+	return YES;
+}
+
+/**
+Evaluates the accelerations due to levels 0 to \e level.
+Each level below \e level is evaluated on its own. The last level is
+evaluated together with the levels below it and their accelerations subtracted.
+This means that when \e level is the outermost level all terms are evaluated
+in the last force calculation so the energies of the force fields are complete.
+If a force evaluation invalidates the integration plan the levels are prepared
+again and all levels are evaluated, as the accelerations of every level are then stale.
+*/
+- (void) _evaluateLevelsUpTo: (int) level
+{
+	register int j, k;
+	int i, l, numberOfAtoms;
+	BOOL evaluated;
+	AdMatrix* accelerations, *lowerAccelerations;
+
+	do
+	{
+		evaluated = YES;
+		for(l=0; l<level && evaluated; l++)
+			evaluated = [self _evaluateLevel: l deactivating: isolatedTerms];
+
+		if(evaluated)
+			evaluated = [self _evaluateLevel: level deactivating: outerTerms];
+
+		if(!evaluated)
+		{
+			[self _prepareLevels];
+			level = numberOfLevels - 1;
+		}
+	}
+	while(!evaluated);
+
+	for(i=0; i<numberOfSystems; i++)
+	{
+		accelerations = levelAccelerations[i][level];
+		numberOfAtoms = accelerations->no_rows;
+		for(l=0; l<level; l++)
+		{
+			lowerAccelerations = levelAccelerations[i][l];
+			for(j=0; j < numberOfAtoms; j++)
+				for(k=0; k<3; k++)
+					accelerations->matrix[j][k] -= lowerAccelerations->matrix[j][k];
+		}
+	}
+}
+
+/**
+Updates the velocities of the system at \e index in the integration plan using
+the accelerations of levels 0 to \e level.
+*/
+- (void) _updateVelocitiesOfSystemAtIndex: (int) index upToLevel: (int) level
+{
+	int l;
+	double* accelerations;
+	AdMatrix* velocities;
+	id system;
+
+	system = systemPlans[index].system;
+	velocities = [system velocities];
+
+	[system object: self willBeginWritingToMatrix: velocities];
+	for(l=0; l<=level; l++)
+	{
+		accelerations = levelAccelerations[index][l]->matrix[0];
+		AdUpdateVelocities(velocities->matrix[0],
+			&accelerations,
+			1,
+			velocities->no_rows,
+			levelHalfTimeSteps[l]);
+	}
+	[system object: self didFinishWritingToMatrix: velocities];
+}
+
+/*
+ * Init and Dealloc
+ */
+
+- (id) initWithSystems: (AdSystemCollection*) aSystemCollection
+	forceFields: (AdForceFieldCollection*) aForceFieldCollection
+	components: (NSArray*) anArray
+	numberOfSteps: (unsigned int) intOne
+	timeStep: (double) aDouble
+	checkFPErrorInterval: (unsigned int) intTwo
+{
+	return [self initWithSystems: aSystemCollection
+		forceFields: aForceFieldCollection
+		components: anArray
+		numberOfSteps: intOne
+		timeStep: aDouble
+		checkFPErrorInterval: intTwo
+		levels: nil];
+}
+
+- (id) initWithSystems: (AdSystemCollection*) aSystemCollection
+	forceFields: (AdForceFieldCollection*) aForceFieldCollection
+	components: (NSArray*) anArray
+	numberOfSteps: (unsigned int) intOne
+	timeStep: (double) aDouble
+	checkFPErrorInterval: (unsigned int) intTwo
+	levels: (NSArray*) levelArray
+{
+	if((self = [super initWithSystems: aSystemCollection
+			forceFields: aForceFieldCollection
+			components: anArray
+			numberOfSteps: intOne
+			timeStep: aDouble
+			checkFPErrorInterval: intTwo]))
+	{
+		levelSteps = NULL;
+		levelHalfTimeSteps = NULL;
+		levelAccelerations = NULL;
+		levelForceFields = [NSMutableArray new];
+		isolatedTerms = [NSMutableArray new];
+		outerTerms = [NSMutableArray new];
+		[self setLevels: levelArray];
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[self _freeLevelAccelerations];
+	[levels release];
+	[levelForceFields release];
+	[isolatedTerms release];
+	[outerTerms release];
+	[super dealloc];
+}
+
+- (NSString*) description
+{
+	NSMutableString* description;
+	NSEnumerator* levelEnum;
+	id level;
+
+	description = [NSMutableString stringWithString: [super description]];
+	[description appendString: @"Outer levels:\n"];
+	levelEnum = [levels objectEnumerator];
+	while((level = [levelEnum nextObject]))
+		[description appendFormat: @"\tSteps: %d. Terms: %@\n",
+			[[level objectForKey: @"Steps"] intValue],
+			[[level objectForKey: @"Terms"] componentsJoinedByString: @", "]];
+
+	return description;
+}
+
+/*
+ * Integration
+ */
+
+- (void) _simulateFrom: (int) start to: (int) end
+{
+	int i, step, startLevel, endLevel;
+	AdMatrix* coordinates, *velocities;
+	NSEnumerator *componentEnum;
+	id system, component;
+
+	pool = [[NSAutoreleasePool alloc] init];
+
+	//Notify all components that production is about to start
+	componentEnum = [components objectEnumerator];
+	while((component = [componentEnum nextObject]))
+		[component simulator: self
+			willBeginProductionWithSystems: systemCollection
+			forceFields: forceFieldCollection];
+
+	//Set timers
+	[timer sendMessage: @selector(emptyPool)
+		toObject: self
+		interval: 100
+		name: @"Autorelease"];
+	[timer sendMessage: @selector(checkFloatingPointErrors)
+		toObject: self
+		interval: checkFPErrorInterval
+		name: @"FloatingPointErrors"];
+
+	//Divide the terms and calculate the initial accelerations of each level
+	[self _prepareLevels];
+	[self _evaluateLevelsUpTo: numberOfLevels - 1];
+
+	for(currentStep=start; currentStep < end; currentStep++)
+	{
+		NSDebugLLog(@"SimulationLoop",
+			@"\nBeginning numerical integration - step %d",
+			currentStep);
+
+		//The topology changed - redivide the terms and recalculate the level accelerations
+		if(!planIsValid)
+		{
+			[self _prepareLevels];
+			[self _evaluateLevelsUpTo: numberOfLevels - 1];
+		}
+
+		//Since the level periods are multiples of each other
+		//the levels starting and finishing at a step are always 0 to some level.
+		step = currentStep - start;
+		for(startLevel = 0; startLevel < numberOfLevels - 1; startLevel++)
+			if(step % levelSteps[startLevel + 1] != 0)
+				break;
+
+		for(endLevel = 0; endLevel < numberOfLevels - 1; endLevel++)
+			if((step + 1) % levelSteps[endLevel + 1] != 0)
+				break;
+
+		for(i=0; i<numberOfSystems; i++)
+		{
+			system = systemPlans[i].system;
+			coordinates = [system coordinates];
+			velocities = [system velocities];
+
+			/*** First Step ***/
+
+			[self notifyComponentsOfHook: AdSimulatorFirstVelocityUpdateHook
+				forSystem: system];
+			[self _updateVelocitiesOfSystemAtIndex: i upToLevel: startLevel];
+
+			/*** Second Step ***/
+
+			[self notifyComponentsOfHook: AdSimulatorWillPerformPositionUpdateHook
+				forSystem: system];
+			[system object: self willBeginWritingToMatrix: coordinates];
+			AdUpdatePositions(coordinates->matrix[0],
+				velocities->matrix[0],
+				coordinates->no_rows,
+				timeStep);
+
+			//Molecules leaving a periodic box reenter on the other side
+			[system wrapCoordinatesIntoPeriodicBox];
+			[system object: self didFinishWritingToMatrix: coordinates];
+
+			[self notifyComponentsOfHook: AdSimulatorDidPerformPositionUpdateHook
+				forSystem: system];
+		}
+
+		[self _evaluateLevelsUpTo: endLevel];
+
+		for(i=0; i<numberOfSystems; i++)
+		{
+			system = systemPlans[i].system;
+
+			/*** Final Step ***/
+
+			[self notifyComponentsOfHook: AdSimulatorWillPerformSecondVelocityUpdateHook
+				forSystem: system];
+			[self _updateVelocitiesOfSystemAtIndex: i upToLevel: endLevel];
+			[self notifyComponentsOfHook: AdSimulatorDidPerformSecondVelocityUpdateHook
+				forSystem: system];
+		}
+
+		[timer increment];
+
+		NSDebugLLog(@"SimulationLoop",
+			@"Finished numerical integration - step %d",
+			currentStep);
+
+		if(endSimulation)
+			break;
+	}
+
+	//Notify all components that production finished
+	componentEnum = [components objectEnumerator];
+	while((component = [componentEnum nextObject]))
+		[component simulatorDidFinishProduction: self];
+
+	[timer removeMessageWithName: @"Autorelease"];
+	[timer removeMessageWithName: @"FloatingPointErrors"];
+	[pool release];
+}
+
+/*
+ * Accessors
+ */
+
+- (NSArray*) levels
+{
+	return [[levels retain] autorelease];
+}
+
+- (void) setLevels: (NSArray*) levelArray
+{
+	NSEnumerator* levelEnum;
+	id level;
+
+	if(levelArray == nil)
+	{
+		levelArray = [NSArray arrayWithObject:
+				[NSDictionary dictionaryWithObjectsAndKeys:
+					[NSArray arrayWithObject: @"Nonbonded"], @"Terms",
+					[NSNumber numberWithInt: 2], @"Steps", nil]];
+	}
+
+	levelEnum = [levelArray objectEnumerator];
+	while((level = [levelEnum nextObject]))
+	{
+		if(![[level objectForKey: @"Terms"] isKindOfClass: [NSArray class]])
+			[NSException raise: NSInvalidArgumentException
+				format: @"Each level must contain an array of term names"];
+
+		if([[level objectForKey: @"Steps"] intValue] < 1)
+			[NSException raise: NSInvalidArgumentException
+				format: @"The number of steps of a level must be greater than 0 (%@)",
+				[level objectForKey: @"Steps"]];
+	}
+
+	[levels release];
+	levels = [levelArray copy];
+}
+
+- (double) outerTimeStep
+{
+	NSEnumerator* levelEnum;
+	id level;
+	double outerTimeStep = timeStep;
+
+	levelEnum = [levels objectEnumerator];
+	while((level = [levelEnum nextObject]))
+		outerTimeStep *= [[level objectForKey: @"Steps"] intValue];
+
+	return outerTimeStep;
+}
+
+@end
@@ -1,210 +1,320 @@
 #include "AdunKernel/AdunMultithreadedNonbondedTerm.h"
-#include <unistd.h>
-#ifdef __APPLE__
-#include <sys/sysctl.h>
-#endif
+#include <sys/time.h>
+#include "Base/AdThreadTeam.h"
+
+//The alignment used for the per thread force matrices.
+//Reduction blocks contain a multiple of AD_REDUCTION_BLOCK_ROWS rows 
+//so that threads do not write to the same cache lines of the result.
+#define AD_CACHE_LINE_SIZE 64
+#define AD_REDUCTION_BLOCK_ROWS 8
 #include "AdunKernel/AdunPureNonbondedTerm.h"
 #include "AdunKernel/AdunShiftedNonbondedTerm.h"
 #include "AdunKernel/AdunGRFNonbondedTerm.h"
+#include "AdunKernel/AdunPMENonbondedTerm.h"
+#include "AdunKernel/AdunNonbondedPairArray.h"
 
-static id workerThreadManager;
+//Returns the wall clock time in seconds
+static double AdWallTime(void)
+{
+	struct timeval time;
 
-/**
-Object which manages a set of worker threads - one for each available
- processor after the first.
- \todo Generalise so it can be used to thread any operation
- Just replace evaluateForces with performSelector:
- however have to handle when you want to thread a number of different operations.
+	gettimeofday(&time, NULL);
+	return time.tv_sec + 1E-6*time.tv_usec;
+}
+
+/*
+ * Allocates a force matrix whose data is aligned on a cache line boundary.
+ * Free with AdFreeAlignedForceMatrix().
  */
-@interface AdNonbondedWorkerThreadManager: NSObject
+static AdMatrix* AdAllocateAlignedForceMatrix(int rows)
 {
-	BOOL isFinished;
-	int numberOfProcessors;
-	int finishedThreads;
-	NSMutableArray* workerThreads;
-	NSLock* lock;
+	int i;
+	double* array;
+	AdMatrix* matrix;
+
+	if(posix_memalign((void**)&array, AD_CACHE_LINE_SIZE, (rows*3 + 1)*sizeof(double)) != 0)
+		[NSException raise: NSMallocException
+			format: @"Unable to allocate aligned force matrix with %d rows", rows];
+
+	matrix = malloc(sizeof(AdMatrix));
+	matrix->no_rows = rows;
+	matrix->no_columns = 3;
+	matrix->matrix = malloc((rows > 0 ? rows : 1)*sizeof(double*));
+	matrix->matrix[0] = array;
+	for(i=0; i<rows; i++)
+		matrix->matrix[i] = array + 3*i;
+
+	return matrix;
 }
-/**
-Returns the applications singleton AdNonbondedWorkerThreadManager instance.
-*/
-+ (id) nonbondedWorkerThreadManager;
-/**
-Returns the number of processors detected.
-The number of worker threads is one minus this number.
-*/
-- (int) numberOfProcessors;
-/**
-Distributes each of the AdNonbondedTerm objects in \e terms
-to a worker thread each of which calls evaluteForces: on the 
-provided object. The number of objects in \e terms must
-be equal to the number of threads available.
-The method returns immediately - use isFinished() to
-determine when the threads have finished there calculations.
-*/
-- (void) evaluateForcesForTerms: (NSArray*) terms;
-/**
-Distributes each of the AdNonbondedTerm objects in \e terms
-to a worker thread each of which calls evaluteEnergies: on the 
-provided object. The number of objects in \e terms must
-be equal to the number of threads available.
-The method returns immediately - use isFinished() to
-determine when the threads have finished there calculations.
-*/
-- (void) evaluateEnergiesForTerms: (NSArray*) terms;
-/**
-Updates the nonbonded lists of each of the threaded terms.
-*/
-- (void) updateTerms: (NSArray*) terms;
-/**
-After calling either evaluateForcesForTerms:() or evaluateEnergiesForTerms()
-this method can be used to check when the threads have finish the calculation.
-*/
-- (BOOL) isFinished;
-/**
-Used be the worker threads to notify the manager when they have finished.
-Must not be called by other objects.
-*/
-- (void) threadFinished;
-@end
 
-/**
-Class representing a worker thread managed by an AdNonbondedWorkerThreadManager.
-Objects of this class should only be created by the applications
-AdNonbondedWorkerThreadManager instance.
-*/
-@interface AdWorkerThread: NSObject
+static void AdFreeAlignedForceMatrix(AdMatrix* matrix)
 {
-	BOOL runWorker;
-	BOOL invoke;
-	BOOL threadReady;
-	NSInvocation* invocation;
-	NSPort* receivePort;
-	NSPort* sendPort;
-	id theObject;
-	id manager;
+	if(matrix == NULL)
+		return;
+
+	free(matrix->matrix[0]);
+	free(matrix->matrix);
+	free(matrix);
 }
-/**
-Same as initWithThreadManager except returns an autoreleased object
+
+/*
+ * Adds rows [start, end) of each of the \e number matrices in \e sources
+ * to the same rows of \e destination. 
  */
-+ (id) threadWithManager: (AdNonbondedWorkerThreadManager*) object;
-/**
-Designated initialiser. Only use this method to initialise this object.
-*/
-- (id) initWithThreadManager: (AdNonbondedWorkerThreadManager*) object;
-/**
-Should be called using detachNewThread:target:selector:.
-When launched using this method the reciever creates an
-NSConnetion using the supplied ports and sets itself
-as the root proxy. It then enters a run loop and waits
-for communication.
-*/
-- (void) runWorker: (NSArray*) ports;
-/**
-Ends a thread started with runWorker. 
-Can be called on the proxy or main thread instance.
-*/
-- (void) endWorker;
-/**
-Sets the AdNonbondedTerm object that will be
-operated on in the thread.
-*/
-- (void) setObject: (AdNonbondedTerm*) object;
-/**
-Sets the invocation that will be sent in the thread
-*/
-- (void) setInvocation: (NSInvocation*) invocation;
-/**
-Invokes the current invocation
-*/
-- (void) invoke;
+static void AdReduceForceRows(AdMatrix* destination, AdMatrix** sources, int number, int start, int end)
+{
+	int i, j, k;
+	double *result, *source;
+
+	if(end <= start)
+		return;
+
+	//Rows are contiguous so each block can be treated as a flat array.
+	result = destination->matrix[start];
+	for(k=0; k<number; k++)
+	{
+		source = sources[k]->matrix[start];
+		for(i=0, j=3*(end - start); i<j; i++)
+			result[i] += source[i];
+	}
+}
+
 /**
-Returns YES if the worker thread has been spawned and is waiting.
+The operations AdMultithreadedNonbondedTerm performs on the shared thread team.
 */
-- (BOOL) threadReady;
-@end
+typedef enum
+{
+	AdNonbondedEvaluateForcesTask,
+	AdNonbondedEvaluateEnergyTask,
+	AdNonbondedUpdateListTask,
+	AdNonbondedSetPairsTask,
+	AdNonbondedReduceForcesTask
+}
+AdNonbondedTaskType;
+
+/*
+ * A task run on the shared thread team. Part i operates on term i of \e terms,
+ * or reduces the rows from reductionBoundaries[i] to reductionBoundaries[i+1].
+ * Part 0 is performed by the calling thread so the main term is always
+ * evaluated in the thread the receiver was called from.
+ */
+typedef struct
+{
+	AdNonbondedTaskType type;
+	NSArray* terms;
+	NSArray* arguments;		//The argument of each part (nil if the task has none)
+	double* times;			//If not NULL the time taken by each part is stored here
+	int numberOfSources;
+	int* reductionBoundaries;
+	AdMatrix* reductionResult;
+	AdMatrix** reductionSources;
+}
+AdNonbondedTask;
+
+static void AdNonbondedTaskPart(void* argument, int part)
+{
+	double time;
+	NSAutoreleasePool* pool;
+	AdNonbondedTask* task = (AdNonbondedTask*)argument;
+	id term;
+
+#ifdef GNUSTEP
+	//The workers of the team are not NSThreads.
+	//Does nothing if the thread is already registered.
+	GSRegisterCurrentThread();
+#endif
+	pool = [NSAutoreleasePool new];
+	time = AdWallTime();
+	term = (task->terms != nil) ? [task->terms objectAtIndex: part] : nil;
+	switch(task->type)
+	{
+		case AdNonbondedEvaluateForcesTask:
+			[term clearForces];
+			[term evaluateForces];
+			break;
+		case AdNonbondedEvaluateEnergyTask:
+			[term evaluateEnergy];
+			break;
+		case AdNonbondedUpdateListTask:
+			[term updateList: NO];
+			break;
+		case AdNonbondedSetPairsTask:
+			[term setNonbondedPairs: [task->arguments objectAtIndex: part]];
+			break;
+		case AdNonbondedReduceForcesTask:
+			AdReduceForceRows(task->reductionResult, task->reductionSources, task->numberOfSources,
+				task->reductionBoundaries[part], task->reductionBoundaries[part + 1]);
+			break;
+	}
+
+	if(task->times != NULL)
+		task->times[part] = AdWallTime() - time;
+
+	[pool release];
+}
 
 @implementation AdMultithreadedNonbondedTerm
 
-- (NSArray*) _dividePairs: (id) pairs
+/*
+ * Load balancing
+ */
+
+/*
+ * Returns an estimate of the cost of the pairs of each element.
+ * This is the number of pairs of the element in the lists of the terms plus one.
+ * If the terms do not provide pair lists the number of allowed pairs of the element is used.
+ * The returned array must be freed using the AdMemoryManager.
+ */
+- (int*) _elementCostsForPairs: (NSArray*) pairs
 {
-	BOOL forward;
-	int i, j, start, index;
+	int i, k, numberOfSets, end;
+	int* costs;
+	AdPairList* list;
+	id term;
+
+	numberOfSets = [pairs count];
+	costs = [[AdMemoryManager appMemoryManager] 
+			allocateArrayOfSize: numberOfSets*sizeof(int)];
+	for(i=0; i<numberOfSets; i++)
+		costs[i] = 1;
+	
+	for(k=0; k < (int)[allTerms count]; k++)
+	{
+		term = [allTerms objectAtIndex: k];
+		list = [term respondsToSelector: @selector(pairList)] ? [term pairList] : NULL;
+		if(list == NULL)
+		{
+			for(i=0; i<numberOfSets; i++)
+				costs[i] = [[pairs objectAtIndex: i] count] + 1;
+			
+			return costs;
+		}
+
+		end = (list->numberOfElements < numberOfSets) ? list->numberOfElements : numberOfSets;
+		for(i=0; i<end; i++)
+			costs[i] += list->offsets[i+1] - list->offsets[i];
+	}
+
+	return costs;
+}
+
+/*
+ * Divides pairs into numberOfProcessors arrays. Each thread is assigned a 
+ * contiguous block of elements such that the sum of the costs in each block is 
+ * approximately the same. Each array contains an index set for every element - 
+ * the sets of elements not assigned to the thread are empty.
+ */
+- (NSArray*) _dividePairs: (NSArray*) pairs elementCosts: (int*) costs
+{
+	int i, k, numberOfSets;
+	double total, cumulative;
 	NSMutableArray* arrays = [NSMutableArray array], *array;
+	NSIndexSet* emptySet = [NSIndexSet indexSet];
 
-	for(i=0; i < numberOfProcessors; i++)
-		[arrays addObject: [NSMutableArray array]];
+	numberOfSets = [pairs count];
+	for(total=0, i=0; i<numberOfSets; i++)
+		total += costs[i];
 	
-	for(start=0, i=0; i < (int)[pairs count]; i++)
+	//Find the block boundaries
+	partitionBoundaries[0] = 0;
+	for(cumulative = 0, k=1, i=0; i<numberOfSets && k < numberOfProcessors; i++)
 	{
-		index = start;
-		array = [arrays objectAtIndex: index];
-		[array addObject: [pairs objectAtIndex: i]];
-		//Add from first to last
-		for(j=1; j < numberOfProcessors; j++)
+		cumulative += costs[i];
+		if(cumulative >= k*total/numberOfProcessors)
 		{
-			if(j == (int)[pairs count])
-				break;
-				
-			//Add empty sets to others
-			index++;
-			index = index%numberOfProcessors;
-			//NSDebugLLog(@"Index %d", index);
-			//NSDebugLLog(@"J is %d", j);
-			array = [arrays objectAtIndex: index];
-			[array addObject: [NSIndexSet indexSet]];
-		}	
-		
-		start++;
-		start = start%numberOfProcessors;
-		
-		/*if(forward)
+			partitionBoundaries[k] = i + 1;
+			k++;
+		}
+	}	
+	for(; k <= numberOfProcessors; k++)
+		partitionBoundaries[k] = numberOfSets;
+
+	for(k=0; k < numberOfProcessors; k++)
+	{
+		//Pair arrays can create the partition without copying the exclusions
+		if([pairs isKindOfClass: [AdNonbondedPairArray class]])
 		{
-			[array1 addObject: [pairs objectAtIndex: i]];
-			[array2 addObject: [NSIndexSet indexSet]];
-			i++;
-			if(i<(int)[pairs count])
-			{
-				[array1 addObject: [NSIndexSet indexSet]];
-				[array2 addObject: [pairs objectAtIndex: i]];
-			}
-			forward = NO;
+			[arrays addObject: 
+				[(AdNonbondedPairArray*)pairs pairArrayForElementsInRange: 
+					NSMakeRange(partitionBoundaries[k], 
+						partitionBoundaries[k+1] - partitionBoundaries[k])]];
+			NSDebugLLog(@"Threading", @"Multi Term - Thread %d assigned elements %d to %d", 
+				k, partitionBoundaries[k], partitionBoundaries[k+1] - 1);
+			continue;
 		}
-		else
+
+		array = [NSMutableArray arrayWithCapacity: numberOfSets];
+		for(i=0; i<numberOfSets; i++)
 		{
-			[array1 addObject: [NSIndexSet indexSet]];
-			[array2 addObject: [pairs objectAtIndex: i]];
-			i++;
-			if(i<(int)[pairs count])
-			{
-				[array1 addObject: [pairs objectAtIndex: i]];
-				[array2 addObject: [NSIndexSet indexSet]];
-			}
-			forward = YES;
-		}*/
+			if(i >= partitionBoundaries[k] && i < partitionBoundaries[k+1])
+				[array addObject: [pairs objectAtIndex: i]];
+			else
+				[array addObject: emptySet];
+		}
+		[arrays addObject: array];
+		NSDebugLLog(@"Threading", @"Multi Term - Thread %d assigned elements %d to %d", 
+			k, partitionBoundaries[k], partitionBoundaries[k+1] - 1);
 	}
 
 	return arrays;
 }
 
+/*
+ * Returns the ratio of the largest number of pairs assigned
+ * to a thread to the mean number.
+ */
+- (double) _loadImbalance
+{
+	int k, pairs, largest, total;
+	AdPairList* list;
+	id term;
+
+	for(largest = 0, total = 0, k=0; k < numberOfProcessors; k++)
+	{
+		term = [allTerms objectAtIndex: k];
+		if(![term respondsToSelector: @selector(pairList)])
+			return 1.0;
+
+		list = [term pairList];
+		pairs = (list == NULL) ? 0 : list->numberOfPairs;
+		total += pairs;
+		if(pairs > largest)
+			largest = pairs;
+	}
+
+	if(total == 0)
+		return 1.0;
+
+	return (double)largest*numberOfProcessors/(double)total;
+}
+
 - (id) initWithDictionary: (NSDictionary*) dict
 {
-	return [self initWithTerm: [dict objectForKey: @"term"]];
+	return [self initWithTerm: [dict objectForKey: @"term"]
+		numberOfThreads: [[dict objectForKey: @"numberOfThreads"] intValue]];
 }
 
 - (id) initWithTerm: (AdNonbondedTerm*) nonbondedTerm	
+{
+	return [self initWithTerm: nonbondedTerm numberOfThreads: 0];
+}
+
+- (id) initWithTerm: (AdNonbondedTerm*) nonbondedTerm numberOfThreads: (int) number
 {
 	int i;
+	int* costs;
 	id threadedTerm;
 
-	NSDebugLLog(@"Threading", @"Multi Term - Initialising. Creating worker thread manager");
-	threadManager = [AdNonbondedWorkerThreadManager nonbondedWorkerThreadManager];
-	
-	//Check how many processors there are
+	//Check how many threads to use
 	//If there is only one then just return the nonbondedTerm
-	numberOfProcessors = [threadManager numberOfProcessors];
+	if(number <= 0)
+		number = AdDefaultNumberOfThreads();
+
+	numberOfProcessors = number;
 	if(numberOfProcessors == 1)
 	{
-		NSWarnLog(@"Only one processor available - abandoning multi-threading");
+		NSWarnLog(@"Only one thread requested - abandoning multi-threading");
+		[self release];
 		return [nonbondedTerm retain];
 	}
 
@@ -213,25 +323,52 @@ Returns YES if the worker thread has been spawned and is waiting.
 	if(nonbondedTerm == nil)
 	{
 		NSWarnLog(@"(AdMulithreadedNonbondedTerm) Nobonded term cannot be nil");
+		[self release];
 		return nil;
 	}
 
+	//The reciprocal space part of a PME term covers the whole system
+	//so it cannot be divided between threads.
+	if([nonbondedTerm isKindOfClass: [AdPMENonbondedTerm class]])
+	{
+		NSWarnLog(@"PME nonbonded terms cannot be multi-threaded - abandoning multi-threading");
+		[self release];
+		return [nonbondedTerm retain];
+	}
+
 	if((self = [super init]))
 	{
-		if(nonbondedTerm == nil)
-			return self;
-	
+		NSDebugLLog(@"Threading", @"Multi Term - Initialising. Using %d threads", 
+			numberOfProcessors);
 		mainTerm = [nonbondedTerm retain];
 		threadedTerms = [NSMutableArray new];
 		allTerms = [NSMutableArray new];
 		[allTerms addObject: mainTerm];
+		loadImbalanceTolerance = 1.05;
+		partitionBoundaries = [[AdMemoryManager appMemoryManager]
+					allocateArrayOfSize: (numberOfProcessors + 1)*sizeof(int)];
+		threadTimes = [[AdMemoryManager appMemoryManager]
+					allocateArrayOfSize: numberOfProcessors*sizeof(double)];
+		reductionBoundaries = [[AdMemoryManager appMemoryManager]
+					allocateArrayOfSize: (numberOfProcessors + 1)*sizeof(int)];
+		for(i=0; i<numberOfProcessors; i++)
+			threadTimes[i] = 0;
+		
+		//The threaded terms write to cache aligned force matrices owned by the receiver.
+		//The main term uses its own matrix.
+		threadForces = [[AdMemoryManager appMemoryManager]
+					allocateArrayOfSize: numberOfProcessors*sizeof(AdMatrix*)];
+		threadForces[0] = [mainTerm forces];
 		
 		NSDebugLLog(@"Threading", @"Multi Term - Original nonbonded term:\n %@", [mainTerm description]);
 		
-		//Divide the nonbonded pairs	
+		//Divide the nonbonded pairs using the main terms list to estimate the load.
 		NSDebugLLog(@"Threading", @"Multi Term - Dividing original term into %d instances", numberOfProcessors);
-		dividedPairs = [self _dividePairs: [mainTerm nonbondedPairs]];
+		allPairs = [[mainTerm nonbondedPairs] retain];
+		costs = [self _elementCostsForPairs: allPairs];
+		dividedPairs = [self _dividePairs: allPairs elementCosts: costs];
 		[dividedPairs retain];
+		[[AdMemoryManager appMemoryManager] freeArray: costs];
 		
 		//Create thread objects
 		[mainTerm setNonbondedPairs: [dividedPairs objectAtIndex: 0]];
@@ -239,21 +376,41 @@ Returns YES if the worker thread has been spawned and is waiting.
 		NSDebugLLog(@"Threading", @"\tMain Term (Runs in main thread):\n %@", [mainTerm description]);
 		for(i=1; i < numberOfProcessors; i++)
 		{
-			NSDebugLLog(@"Threading", @"Multi Term - Creating copy for processor %d", i);
+			NSDebugLLog(@"Threading", @"Multi Term - Creating copy for thread %d", i);
 			threadedTerm =  [[nonbondedTerm copy] autorelease];
 			[threadedTerms addObject: threadedTerm];
 			[allTerms addObject: threadedTerm]; 
 			[threadedTerm setNonbondedPairs: [dividedPairs objectAtIndex: i]];
 			[threadedTerm setAutoUpdateList: NO];
+			threadForces[i] = AdAllocateAlignedForceMatrix([[threadedTerm system] numberOfElements]);
+			[threadedTerm setExternalForceMatrix: threadForces[i]];
 			NSDebugLLog(@"Threading", @"\tThread %d:\n %@",i, [threadedTerm description]);
 		}
 		
-		NSDebugLLog(@"Threading", @"Multi Term - Setting update interval %d", [mainTerm updateInterval]);
-		[[AdMainLoopTimer mainLoopTimer]
-			sendMessage: @selector(updateTerms) 
-			toObject: self 
-			interval: [mainTerm updateInterval] 
-			name: @"AdMultiThreadedTermUpdateMessage"];
+		contentsChanged = NO;
+		[[NSNotificationCenter defaultCenter]
+			addObserver: self
+			selector: @selector(_handleSystemContentsChange:)
+			name: @"AdSystemContentsDidChangeNotification"
+			object: [mainTerm system]];
+
+		//If the term rebuilds its list based on the element displacements the
+		//displacements are checked before each evaluation instead of using the timer.
+		updateOnDisplacement = [mainTerm respondsToSelector: @selector(updatesListOnDisplacement)]
+					&& [mainTerm updatesListOnDisplacement];
+		if(updateOnDisplacement)
+		{
+			NSDebugLLog(@"Threading", @"Multi Term - Updating lists on displacement");
+		}
+		else
+		{
+			NSDebugLLog(@"Threading", @"Multi Term - Setting update interval %d", [mainTerm updateInterval]);
+			[[AdMainLoopTimer mainLoopTimer]
+				sendMessage: @selector(updateTerms) 
+				toObject: self 
+				interval: [mainTerm updateInterval] 
+				name: @"AdMultiThreadedTermUpdateMessage"];
+		}		
 
 	}
 
@@ -262,431 +419,253 @@ Returns YES if the worker thread has been spawned and is waiting.
 
 - (void) dealloc
 {
+	int i;
+
+	[[NSNotificationCenter defaultCenter] removeObserver: self];
 	if(mainTerm != nil)
 		[[AdMainLoopTimer mainLoopTimer]
 			removeMessageWithName: @"AdMultiThreadedTermUpdateMessage"];
 			
+	[[AdMemoryManager appMemoryManager] freeArray: partitionBoundaries];
+	[[AdMemoryManager appMemoryManager] freeArray: threadTimes];
+	[[AdMemoryManager appMemoryManager] freeArray: reductionBoundaries];
+	[allPairs release];
 	[dividedPairs release];
 	[mainTerm release];
 	[threadedTerms release];
 	[allTerms release];
-	[super dealloc];
-}
-
-- (void) evaluateEnergy
-{
-	NSDebugLLog(@"Threading", @"Multi Term - Calling evaluateEnergies on %@", threadManager);
-	[threadManager evaluateEnergiesForTerms: threadedTerms];
-	NSDebugLLog(@"Threading", @"Multi Term - Calling evaluateEnergies on main thread instance");
-	[mainTerm evaluateEnergy];
-	NSDebugLLog(@"Threading", @"Multi Term - Main thread finished. Waiting for others ...");
-	while(![threadManager isFinished])
+	if(threadForces != NULL)
 	{
-		//wait;
+		for(i=1; i<numberOfProcessors; i++)
+			AdFreeAlignedForceMatrix(threadForces[i]);
+		[[AdMemoryManager appMemoryManager] freeArray: threadForces];
 	}
-	
-	NSDebugLLog(@"Threading", @"Multi Term - Done");	
+	[super dealloc];
 }
 
-- (void) evaluateForces
+/*
+ * The force matrices of the threaded terms are recreated with the new number of elements.
+ * Each term resets its pairs to all the nonbonded pairs of the system when it
+ * receives the notification, possibly after the receiver, so the pairs are
+ * redivided by updateTerms before the next evaluation.
+ */
+- (void) _handleSystemContentsChange: (NSNotification*) aNotification
 {
-	int i, j, k, finishedThreads = 0;
-	AdMatrix* forces1;
-	id threadedObj;
-
-	[allTerms makeObjectsPerformSelector: @selector(clearForces)];
-	NSDebugLLog(@"Threading", @"Multi Term - Calling evaluateForces on %@", threadManager);
-	[threadManager evaluateForcesForTerms: threadedTerms];
-	NSDebugLLog(@"Threading", @"Multi Term - Calling evaluateForces on main thread instance");
-	[mainTerm evaluateForces];
-	
-	NSDebugLLog(@"Threading", @"Multi Term - Main thread finished. Waiting for others ...");
-	while(![threadManager isFinished])
-	{
-		//wait;
-	}
-	NSDebugLLog(@"Threading", @"Multi Term - Threads finished - collating forces");
-	
-	//Possibly all threads can write to shared memory
-	//Probably wont have that great an impact however.
-	for(k=0; k < numberOfProcessors; k++)
-	{
-		forces1 = [[allTerms objectAtIndex: k] forces];
-		for(i=0; i<forces->no_rows; i++)
-			for(j=0; j<3; j++)
-				forces->matrix[i][j] += forces1->matrix[i][j];	
-	}
-	
-	NSDebugLLog(@"Threading", @"Multi Term - Done");
-}
+	int i, numberOfElements;
 
-- (void) updateTerms
-{
-	int i, j, k, finishedThreads = 0;
-	AdMatrix* forces1;
-	id threadedObj;
-	
-	NSDebugLLog(@"Threading", @"Multi Term - Calling updateTerms on %@", threadManager);
-	[threadManager updateTerms: threadedTerms];
-	NSDebugLLog(@"Threading", @"Multi Term - Calling updateList: on main thread instance");
-	[mainTerm updateList: NO];
-	
-	NSDebugLLog(@"Threading", @"Multi Term - Main thread finished. Waiting for others ...");
-	while(![threadManager isFinished])
+	numberOfElements = [[mainTerm system] numberOfElements];
+	NSDebugLLog(@"Threading", @"Multi Term - Recreating thread force matrices for %d elements", 
+		numberOfElements);
+	for(i=1; i < numberOfProcessors; i++)
 	{
-		//wait;
+		AdFreeAlignedForceMatrix(threadForces[i]);
+		threadForces[i] = AdAllocateAlignedForceMatrix(numberOfElements);
+		[[allTerms objectAtIndex: i] setExternalForceMatrix: threadForces[i]];
 	}
-		
-	NSDebugLLog(@"Threading", @"Multi Term - Done");	
-}
 
-- (void) setExternalForceMatrix: (AdMatrix*) matrix
-{
-	forces = matrix;
+	contentsChanged = YES;
 }
 
-- (double) electrostaticEnergy;
-{
-	int i;
-	double energy = 0;
-	
-	for(i=0; i < numberOfProcessors; i++)
-		energy += [[allTerms objectAtIndex: i] electrostaticEnergy];
-		
-	return energy;
-}	
-
-- (double) lennardJonesEnergy;
+/*
+ * Performs a task on each of the terms using the shared thread team.
+ * The main term is operated on by the calling thread.
+ */
+- (void) _performTask: (AdNonbondedTaskType) type arguments: (NSArray*) arguments times: (double*) times
 {
-	int i;
-	double energy = 0;
-	
-	for(i=0; i < numberOfProcessors; i++)
-		energy += [[allTerms objectAtIndex: i] lennardJonesEnergy];
-	
-	return energy;
-}
+	AdNonbondedTask task;
 
-- (id) system
-{
-	return [mainTerm system];
+	task.type = type;
+	task.terms = allTerms;
+	task.arguments = arguments;
+	task.times = times;
+	task.numberOfSources = 0;
+	task.reductionBoundaries = NULL;
+	task.reductionResult = NULL;
+	task.reductionSources = NULL;
+	AdRunThreadTeam(AdSharedThreadTeam(), AdNonbondedTaskPart, &task, numberOfProcessors);
 }
 
-- (NSString*) lennardJonesType
+/*
+ * Adds the thread force matrices to forces. The rows are divided into 
+ * one block for each thread.
+ */
+- (void) _reduceForces
 {
-	return [mainTerm lennardJonesType];
-}
+	int i, rows, blockSize;
+	AdNonbondedTask task;
 
-@end
+	rows = forces->no_rows;
+	blockSize = rows/numberOfProcessors + 1;
+	blockSize = AD_REDUCTION_BLOCK_ROWS*((blockSize + AD_REDUCTION_BLOCK_ROWS - 1)/AD_REDUCTION_BLOCK_ROWS);
+	for(i=0; i<numberOfProcessors; i++)
+		reductionBoundaries[i] = (i*blockSize < rows) ? i*blockSize : rows;
+	reductionBoundaries[numberOfProcessors] = rows;	
 
-/**
-Implementation of AdNonbondedTermWorkerThread
-*/
-@implementation AdNonbondedWorkerThreadManager
-
-+ (void) initialize
-{
-	workerThreadManager = nil;
-}
-
-+ (id) nonbondedWorkerThreadManager
-{
-	if(workerThreadManager == nil)
-		workerThreadManager =  [AdNonbondedWorkerThreadManager new];
-		
-	return [[workerThreadManager retain] autorelease];	
+	task.type = AdNonbondedReduceForcesTask;
+	task.terms = nil;
+	task.arguments = nil;
+	task.times = NULL;
+	task.numberOfSources = numberOfProcessors;
+	task.reductionBoundaries = reductionBoundaries;
+	task.reductionResult = forces;
+	task.reductionSources = threadForces;
+	AdRunThreadTeam(AdSharedThreadTeam(), AdNonbondedTaskPart, &task, numberOfProcessors);
 }
 
-- (id) init
+- (void) evaluateEnergy
 {
-	int i;
-	AdWorkerThread* workerThread;
-	NSPort *sendPort, *receivePort;
-	NSMutableArray* ports = [NSMutableArray array];
-	id proxy;
-
-	NSDebugLLog(@"Threading", @"Thread Manager - Initialising. " 
-		"Will create and manage one worker thread for each processor beyond the first");
+	if(contentsChanged || (updateOnDisplacement && [mainTerm listNeedsUpdate]))
+		[self updateTerms];
 
-	if(self = [super init])
-	{
-		lock = [NSLock new];
-		workerThreads = [NSMutableArray new];
-		[self numberOfProcessors];
-		for(i=1; i<numberOfProcessors; i++)
-		{
-			[ports removeAllObjects];	
-			workerThread = [AdWorkerThread threadWithManager: self];
-		
-			NSDebugLLog(@"Threading", @"Thread Manager - Preparing to detach worker thread %d of %d.", i, numberOfProcessors -1);
-			//Detach the thread 		
-			[NSThread detachNewThreadSelector: @selector(runWorker:)
-				toTarget: workerThread
-				withObject: ports];
-			
-			[workerThreads addObject: workerThread];
-		}
-	}
-
-	NSDebugLLog(@"Threading", @"Thread Manager - Waiting for worker threads to register with me");
-	i = 0;
-	while(i < (numberOfProcessors - 1))
-	{
-		while(![[workerThreads objectAtIndex: i] threadReady]);
-		NSDebugLLog(@"Threading",  @"Thread %d ready", i);
-		i++;	
-	}
-	
-	NSDebugLLog(@"Threading", @"Thread Manager - All worker threads registered -  %@", workerThreads);
-	
-	return self;
+	NSDebugLLog(@"Threading", @"Multi Term - Evaluating energies");
+	[self _performTask: AdNonbondedEvaluateEnergyTask arguments: nil times: threadTimes];
+	NSDebugLLog(@"Threading", @"Multi Term - Done");	
 }
 
-- (void) dealloc
+- (void) evaluateForces
 {
-	[lock release];
-	[workerThreads release];
-	[super dealloc];
-}
+	if(contentsChanged || (updateOnDisplacement && [mainTerm listNeedsUpdate]))
+		[self updateTerms];
 
-- (int) numberOfProcessors
-{
-	//FIXME: Should also check which are available etc.
-#ifdef __APPLE__ 
-	//On apple this is the way is has to be done
-	//They don't have _SC_NPROCESSORS_CONF since its not posix standard.
-	//mib stands for Management Information Base.
-	size_t length = sizeof(numberOfProcessors); 
-	int mib[2]; 
-	
-	mib[0] = CTL_HW; 
-	mib[1] = HW_NCPU; 
-	
-	if (sysctl(mib, 2, &numberOfProcessors, &length, 0, 0) < 0)
-		numberOfProcessors = 1;
+	NSDebugLLog(@"Threading", @"Multi Term - Evaluating forces");
+	[self _performTask: AdNonbondedEvaluateForcesTask arguments: nil times: threadTimes];
+	NSDebugLLog(@"Threading", @"Multi Term - Threads finished - collating forces");
 	
-	if(length != sizeof(numberOfProcessors))
-		numberOfProcessors = 1; 
-#else
-	numberOfProcessors = sysconf(_SC_NPROCESSORS_CONF);  
-#endif	 
-	NSDebugLLog(@"Threading", @"Thread Manager - There are %d processors", numberOfProcessors);
+	//Each thread sums the forces on a block of elements.
+	//The main terms force matrix may have been reallocated so it is reacquired.
+	threadForces[0] = [mainTerm forces];
+	[self _reduceForces];
 	
-	return numberOfProcessors;
+	NSDebugLLog(@"Threading", @"Multi Term - Done");
 }
 
-- (void) evaluateForcesForTerms: (NSArray*) terms
+/*
+ * If the system contents changed or the pairs are unevenly distributed between the
+ * threads they are redivided based on the current list sizes and each term recreates its list.
+ * Otherwise each term updates its list as normal.
+ */
+- (void) updateTerms
 {
-	unsigned int i;
-	NSMethodSignature* signature;
-	NSInvocation* invocation;
-	
-	NSDebugLLog(@"Threading", @"Thread Manager - Requesting that workers perform force calculation");
-
-	signature = [[terms objectAtIndex: 0] methodSignatureForSelector: @selector(evaluateForces)];
-	invocation = [NSInvocation invocationWithMethodSignature: signature];
-	[invocation setSelector: @selector(evaluateForces)];
+	int i;
+	int* costs;
+	double imbalance;
+	NSArray* counts;
 
-	finishedThreads = 0;
-	isFinished = NO;
-	for(i=0; i<[terms count]; i++)
+	if(contentsChanged)
 	{
-		[[workerThreads objectAtIndex: i] setObject: [terms objectAtIndex: i]];
-		[[workerThreads objectAtIndex: i] setInvocation: invocation];
+		NSDebugLLog(@"Threading", @"Multi Term - System contents changed. Redividing pairs");
+		[allPairs release];
+		allPairs = [[[mainTerm system] indexSetArrayForCategory: @"Nonbonded"] retain];
 	}
-	
-	[workerThreads makeObjectsPerformSelector: @selector(invoke)];	
-}
 
-- (void) evaluateEnergiesForTerms: (NSArray*) terms
-{
-	unsigned int i;
-	NSMethodSignature* signature;
-	NSInvocation* invocation;
-	
-	signature = [[terms objectAtIndex: 0] methodSignatureForSelector: @selector(evaluateEnergy)];
-	invocation = [NSInvocation invocationWithMethodSignature: signature];
-	[invocation setSelector: @selector(evaluateEnergy)];
-	
-	NSDebugLLog(@"Threading", @"Thread Manager - Requesting that workers perform energy calculation");
-	finishedThreads = 0;
-	isFinished = NO;
-	for(i=0; i<[terms count]; i++)
+	imbalance = [self _loadImbalance];
+	if(contentsChanged || imbalance > loadImbalanceTolerance)
 	{
-		[[workerThreads objectAtIndex: i] setObject: [terms objectAtIndex: i]];
-		[[workerThreads objectAtIndex: i] setInvocation: invocation];
+		NSDebugLLog(@"Threading", @"Multi Term - Load imbalance %lf. Redividing pairs", imbalance);
+		costs = [self _elementCostsForPairs: allPairs];
+		[dividedPairs release];
+		dividedPairs = [self _dividePairs: allPairs elementCosts: costs];
+		[dividedPairs retain];
+		[[AdMemoryManager appMemoryManager] freeArray: costs];
+		[self _performTask: AdNonbondedSetPairsTask arguments: dividedPairs times: NULL];
+		contentsChanged = NO;
+	}
+	else
+	{
+		NSDebugLLog(@"Threading", @"Multi Term - Updating lists");
+		[self _performTask: AdNonbondedUpdateListTask arguments: nil times: NULL];
 	}
 	
-	[workerThreads makeObjectsPerformSelector: @selector(invoke)];	
+	counts = [self pairCounts];
+	for(i=0; i < numberOfProcessors; i++)
+		NSDebugLLog(@"Threading", @"Multi Term - Thread %d - %@ pairs. Last evaluation %lf secs", 
+			i, [counts objectAtIndex: i], threadTimes[i]);
+	
+	NSDebugLLog(@"Threading", @"Multi Term - Done");	
 }
 
-- (void) updateTerms: (NSArray*) terms
+- (NSArray*) pairCounts
 {
-	BOOL reset = NO;
-	unsigned int i;
-	NSMethodSignature* signature;
-	NSInvocation* invocation;
-	
-	signature = [[terms objectAtIndex: 0] methodSignatureForSelector: @selector(updateList:)];
-	invocation = [NSInvocation invocationWithMethodSignature: signature];
-	[invocation setSelector: @selector(updateList:)];
-	[invocation setArgument: &reset atIndex: 2];
-	
-	NSDebugLLog(@"Threading", @"Thread Manager - Requesting that workers perform energy calculation");
-	finishedThreads = 0;
-	isFinished = NO;
-	for(i=0; i<[terms count]; i++)
+	int k;
+	AdPairList* list;
+	NSMutableArray* array = [NSMutableArray array];
+	id term;
+
+	for(k=0; k < numberOfProcessors; k++)
 	{
-		[[workerThreads objectAtIndex: i] setObject: [terms objectAtIndex: i]];
-		[[workerThreads objectAtIndex: i] setInvocation: invocation];
+		term = [allTerms objectAtIndex: k];
+		list = [term respondsToSelector: @selector(pairList)] ? [term pairList] : NULL;
+		[array addObject: [NSNumber numberWithInt: (list == NULL) ? 0 : list->numberOfPairs]];
 	}
-	
-	[workerThreads makeObjectsPerformSelector: @selector(invoke)];	
-}
 
-- (BOOL) isFinished
-{
-	return isFinished;
+	return array;
 }
 
-- (void) threadFinished
+- (NSArray*) threadTimings
 {
-	[lock lock];
-	finishedThreads++;
-	NSDebugLLog(@"Threading", @"Thread Manager - Worker thread finished - total %d of %d", finishedThreads, [workerThreads count]);
-	if(finishedThreads == numberOfProcessors - 1)
-		isFinished = YES;
-	[lock unlock];
-}
-
-@end
+	int k;
+	NSMutableArray* array = [NSMutableArray array];
 
-/**
-Implementation of AdNonbondedTermWorkerThread class
-*/
-@implementation AdWorkerThread
+	for(k=0; k < numberOfProcessors; k++)
+		[array addObject: [NSNumber numberWithDouble: threadTimes[k]]];
 
-+ (id) threadWithManager: (AdNonbondedWorkerThreadManager*) object
-{
-	return [[[self alloc] initWithThreadManager: object] autorelease];
+	return array;
 }
 
-- (id) initWithThreadManager: (AdNonbondedWorkerThreadManager*) object
+- (void) setLoadImbalanceTolerance: (double) value
 {
-	if(self = [super init])
-	{
-		invoke = NO;
-		threadReady = NO;
-	
-		//Only retain a weak reference to the manager
-		if(object == nil)
-		{
-			[self release];
-			self = nil;
-		}
-		else
-			manager = object;
-			
-		sendPort = [[NSPort port] retain];
-		receivePort = [[NSPort port] retain];	
-	}
-	
-	return self;
-}
+	if(value < 1.0)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Load imbalance tolerance must be at least 1"];
 
-- (void) dealloc
-{
-	[sendPort release];
-	[receivePort release];
-	[invocation release];
-	[theObject release];
-	[super dealloc];
+	loadImbalanceTolerance = value;
 }
 
-- (void) runWorker: (NSArray*) ports
+- (double) loadImbalanceTolerance
 {
-	NSAutoreleasePool* pool;
-	
-	pool = [NSAutoreleasePool new];
-	runWorker = YES;
-	
-	NSDebugLLog(@"AdNonbondedTermWorkerThread", 
-		     @"Worker Thread - Starting to run. Using ports %@", ports);
-
-	threadReady = YES;
-	[sendPort setDelegate: self];
-	NSDebugLLog(@"AdNonbondedTermWorkerThread", @"Worker Thread - Receiving messages on %@", sendPort);
-	[[NSRunLoop currentRunLoop] addPort: sendPort forMode: NSDefaultRunLoopMode];
-	
-	NSDebugLLog(@"AdNonbondedTermWorkerThread", 
-		    @"Worker Thread - Entering run loop %@", [NSRunLoop currentRunLoop]);			
-									     	
-	while(runWorker)
-	{
-		[[NSRunLoop currentRunLoop] 
-			runMode: NSDefaultRunLoopMode 
-			beforeDate: [NSDate dateWithTimeIntervalSinceNow: 5]];
-	}
-	
-	NSDebugLLog(@"AdNonbondedTermWorkerThread", @"Worker Thread - Exiting thread");
-	[pool release];
+	return loadImbalanceTolerance;
 }
 
-- (void)handlePortMessage:(NSPortMessage *)portMessage
+- (int) numberOfThreads
 {
-	NSDebugLLog(@"AdNonbondedTermWorkerThread", 
-		    @"Worker Thread - Invoking %@", invocation);	
-	[invocation invokeWithTarget: theObject];
-	invoke=NO;
-	NSDebugLLog(@"AdNonbondedTermWorkerThread", @"Worker thread - Finised.");
-	[manager threadFinished];
+	return numberOfProcessors;
 }
 
-- (void) endWorker
+- (void) setExternalForceMatrix: (AdMatrix*) matrix
 {
-	runWorker = NO;
-	threadReady = NO;
+	forces = matrix;
 }
 
-- (void) setObject: (AdNonbondedTerm*) object
+- (double) electrostaticEnergy;
 {
-	[theObject release];
-	theObject = [object retain];
-}
+	int i;
+	double energy = 0;
+	
+	for(i=0; i < numberOfProcessors; i++)
+		energy += [[allTerms objectAtIndex: i] electrostaticEnergy];
+		
+	return energy;
+}	
 
-- (void) setManager: (AdNonbondedWorkerThreadManager*) object
+- (double) lennardJonesEnergy;
 {
-	manager = object;
+	int i;
+	double energy = 0;
+	
+	for(i=0; i < numberOfProcessors; i++)
+		energy += [[allTerms objectAtIndex: i] lennardJonesEnergy];
+	
+	return energy;
 }
 
-/**
- Sets the invocation that will be sent in the thread
- */
- - (void) setInvocation: (NSInvocation*) anObject
- {
-	[invocation release];
-	invocation = [anObject retain];
-}
- 
-/**
- Invokes the current invocation
- */
-- (void) invoke
+- (id) system
 {
-	NSPortMessage* message;
-		
-	message = [[NSPortMessage alloc] 
-			initWithSendPort: sendPort 
-			receivePort: receivePort 
-			components: [NSArray arrayWithObject: [NSData data]]];
-		
-	NSDebugLLog(@"AdNonbondedTermWorkerThread", @"Sending message %@ - receive port %@", message, receivePort);			
-	[message sendBeforeDate: [NSDate dateWithTimeIntervalSinceNow: 1]];
-	[message release];		
+	return [mainTerm system];
 }
 
-- (BOOL) threadReady
+- (NSString*) lennardJonesType
 {
-	return threadReady;
+	return [mainTerm lennardJonesType];
 }
+
 @end
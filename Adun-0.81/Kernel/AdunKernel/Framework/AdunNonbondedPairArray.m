@@ -0,0 +1,466 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#include "AdunKernel/AdunNonbondedPairArray.h"
+#include "AdunKernel/AdunMemoryManager.h"
+
+static int AdCompareInts(const void* one, const void* two)
+{
+	return *(const int*)one - *(const int*)two;
+}
+
+@implementation AdNonbondedPairArray
+
+- (id) initWithNumberOfElements: (int) number
+	numberOfSets: (int) sets
+	lowerBounds: (int*) bounds
+	exclusionOffsets: (int*) offsets
+	exclusions: (int*) excluded
+{
+	int i, j, count, lastExcluded;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	if(number < 0)
+		number = 0;
+
+	if(sets < 0 || sets > number)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Number of sets (%d) must be between 0 and the number of elements (%d)",
+			sets, number];
+
+	if((self = [super init]))
+	{
+		numberOfElements = number;
+		numberOfSets = sets;
+		lowerBounds = [memoryManager allocateArrayOfSize: (numberOfSets + 1)*sizeof(int)];
+		exclusionOffsets = [memoryManager allocateArrayOfSize: (numberOfSets + 1)*sizeof(int)];
+		for(i=0; i<numberOfSets; i++)
+		{
+			lowerBounds[i] = (bounds == NULL) ? i + 1 : bounds[i];
+			if(lowerBounds[i] > numberOfElements)
+				lowerBounds[i] = numberOfElements;
+		}
+
+		//Count the exclusions inside the range of each element.
+		count = 0;
+		exclusionOffsets[0] = 0;
+		for(i=0; i<numberOfSets; i++)
+		{
+			if(offsets != NULL)
+			{
+				lastExcluded = -1;
+				for(j=offsets[i]; j<offsets[i+1]; j++)
+					if(excluded[j] >= lowerBounds[i] && excluded[j] < numberOfElements
+						&& excluded[j] != lastExcluded)
+					{
+						lastExcluded = excluded[j];
+						count++;
+					}
+			}
+
+			exclusionOffsets[i+1] = count;
+		}
+
+		exclusions = [memoryManager allocateArrayOfSize: (count + 1)*sizeof(int)];
+		if(offsets != NULL)
+			for(count = 0, i=0; i<numberOfSets; i++)
+			{
+				lastExcluded = -1;
+				for(j=offsets[i]; j<offsets[i+1]; j++)
+					if(excluded[j] >= lowerBounds[i] && excluded[j] < numberOfElements
+						&& excluded[j] != lastExcluded)
+					{
+						lastExcluded = excluded[j];
+						exclusions[count] = excluded[j];
+						count++;
+					}
+			}
+
+		NSDebugLLog(@"AdNonbondedPairArray", @"%d elements, %d sets and %d exclusions",
+			numberOfElements, numberOfSets, exclusionOffsets[numberOfSets]);
+	}
+
+	return self;
+}
+
+- (id) initWithNumberOfElements: (int) number
+	exclusions: (int*) pairs
+	count: (int) count
+{
+	int i, sets, first, second;
+	int* offsets, *excluded, *position;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	sets = (number > 0) ? number - 1 : 0;
+	offsets = [memoryManager allocateArrayOfSize: (sets + 2)*sizeof(int)];
+	position = [memoryManager allocateArrayOfSize: (sets + 1)*sizeof(int)];
+	excluded = [memoryManager allocateArrayOfSize: (count + 1)*sizeof(int)];
+
+	/*
+	 * Sort the pairs by their lowest element with a counting sort
+	 * then sort the exclusions of each element.
+	 * Pairs of an element with itself are ignored.
+	 */
+	for(i=0; i<=sets + 1; i++)
+		offsets[i] = 0;
+
+	for(i=0; i<count; i++)
+	{
+		first = (pairs[2*i] < pairs[2*i+1]) ? pairs[2*i] : pairs[2*i+1];
+		second = (pairs[2*i] < pairs[2*i+1]) ? pairs[2*i+1] : pairs[2*i];
+		if(first == second || first < 0 || second >= number)
+			continue;
+
+		offsets[first + 1]++;
+	}
+
+	for(i=0; i<sets; i++)
+	{
+		offsets[i+1] += offsets[i];
+		position[i] = offsets[i];
+	}
+
+	for(i=0; i<count; i++)
+	{
+		first = (pairs[2*i] < pairs[2*i+1]) ? pairs[2*i] : pairs[2*i+1];
+		second = (pairs[2*i] < pairs[2*i+1]) ? pairs[2*i+1] : pairs[2*i];
+		if(first == second || first < 0 || second >= number)
+			continue;
+
+		excluded[position[first]] = second;
+		position[first]++;
+	}
+
+	for(i=0; i<sets; i++)
+		qsort(excluded + offsets[i], offsets[i+1] - offsets[i], sizeof(int), AdCompareInts);
+
+	self = [self initWithNumberOfElements: number
+			numberOfSets: sets
+			lowerBounds: NULL
+			exclusionOffsets: offsets
+			exclusions: excluded];
+
+	[memoryManager freeArray: offsets];
+	[memoryManager freeArray: position];
+	[memoryManager freeArray: excluded];
+
+	return self;
+}
+
+- (id) initWithRanges: (NSRange*) ranges
+	rangesPerSet: (int*) counts
+	numberOfSets: (int) sets
+	numberOfElements: (int) number
+{
+	int i, j, k, start, total, numberOfExclusions;
+	int* bounds, *offsets, *excluded;
+	unsigned int end;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	for(total = 0, i=0; i<sets; i++)
+		total += counts[i];
+
+	for(i=0; i<total; i++)
+		if((int)NSMaxRange(ranges[i]) > number)
+			number = NSMaxRange(ranges[i]);
+
+	if(sets > number)
+		number = sets;
+
+	/*
+	 * The lower bound of each set is the start of its first range
+	 * and the exclusions are the gaps between the ranges and
+	 * after the last range.
+	 */
+	bounds = [memoryManager allocateArrayOfSize: (sets + 1)*sizeof(int)];
+	offsets = [memoryManager allocateArrayOfSize: (sets + 1)*sizeof(int)];
+	offsets[0] = 0;
+	for(numberOfExclusions = 0, k = 0, i=0; i<sets; k += counts[i], i++)
+	{
+		bounds[i] = (counts[i] == 0) ? number : (int)ranges[k].location;
+		for(j=1; j<counts[i]; j++)
+			numberOfExclusions += ranges[k+j].location - NSMaxRange(ranges[k+j-1]);
+
+		if(counts[i] != 0)
+			numberOfExclusions += number - NSMaxRange(ranges[k + counts[i] - 1]);
+
+		offsets[i+1] = numberOfExclusions;
+	}
+
+	excluded = [memoryManager allocateArrayOfSize: (numberOfExclusions + 1)*sizeof(int)];
+	for(numberOfExclusions = 0, k = 0, i=0; i<sets; k += counts[i], i++)
+	{
+		if(counts[i] == 0)
+			continue;
+
+		for(j=0; j<counts[i]; j++)
+		{
+			end = (j == counts[i] - 1) ? (unsigned int)number : ranges[k+j+1].location;
+			for(start = NSMaxRange(ranges[k+j]); start < (int)end; start++)
+			{
+				excluded[numberOfExclusions] = start;
+				numberOfExclusions++;
+			}
+		}
+	}
+
+	self = [self initWithNumberOfElements: number
+			numberOfSets: sets
+			lowerBounds: bounds
+			exclusionOffsets: offsets
+			exclusions: excluded];
+
+	[memoryManager freeArray: bounds];
+	[memoryManager freeArray: offsets];
+	[memoryManager freeArray: excluded];
+
+	return self;
+}
+
+- (id) initWithIndexSetArray: (NSArray*) anArray numberOfElements: (int) number
+{
+	int i, j, sets, length, total;
+	int* counts;
+	NSRange* ranges, *setRanges;
+	NSIndexSet* indexSet;
+	NSEnumerator* setEnum;
+	AdNonbondedPairArray* pairArray;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	if([anArray isKindOfClass: [AdNonbondedPairArray class]])
+	{
+		pairArray = (AdNonbondedPairArray*)anArray;
+		return [self initWithNumberOfElements:
+				((number > pairArray->numberOfElements) ? number : pairArray->numberOfElements)
+			numberOfSets: pairArray->numberOfSets
+			lowerBounds: pairArray->lowerBounds
+			exclusionOffsets: pairArray->exclusionOffsets
+			exclusions: pairArray->exclusions];
+	}
+
+	sets = [anArray count];
+	counts = [memoryManager allocateArrayOfSize: (sets + 1)*sizeof(int)];
+	for(total = 0, i=0; i<sets; i++)
+	{
+		counts[i] = [[anArray objectAtIndex: i] numberOfRanges];
+		total += counts[i];
+	}
+
+	ranges = [memoryManager allocateArrayOfSize: (total + 1)*sizeof(NSRange)];
+	setEnum = [anArray objectEnumerator];
+	for(total = 0, i = 0; (indexSet = [setEnum nextObject]); i++)
+	{
+		setRanges = [indexSet indexSetToRangeArrayOfLength: &length];
+		for(j=0; j<length; j++, total++)
+			ranges[total] = setRanges[j];
+
+		free(setRanges);
+	}
+
+	self = [self initWithRanges: ranges
+			rangesPerSet: counts
+			numberOfSets: sets
+			numberOfElements: number];
+
+	[memoryManager freeArray: counts];
+	[memoryManager freeArray: ranges];
+
+	return self;
+}
+
+- (id) init
+{
+	return [self initWithNumberOfElements: 0
+		numberOfSets: 0
+		lowerBounds: NULL
+		exclusionOffsets: NULL
+		exclusions: NULL];
+}
+
+- (void) dealloc
+{
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	[memoryManager freeArray: lowerBounds];
+	[memoryManager freeArray: exclusionOffsets];
+	[memoryManager freeArray: exclusions];
+	[super dealloc];
+}
+
+- (unsigned int) count
+{
+	return numberOfSets;
+}
+
+- (id) objectAtIndex: (unsigned int) index
+{
+	int i;
+	NSMutableIndexSet* indexSet;
+
+	if(index >= (unsigned int)numberOfSets)
+		[NSException raise: NSRangeException
+			format: @"Index %d is out of range (%d)", index, numberOfSets];
+
+	if(lowerBounds[index] >= numberOfElements)
+		return [NSIndexSet indexSet];
+
+	indexSet = [NSMutableIndexSet indexSetWithIndexesInRange:
+			NSMakeRange(lowerBounds[index], numberOfElements - lowerBounds[index])];
+	for(i=exclusionOffsets[index]; i<exclusionOffsets[index+1]; i++)
+		[indexSet removeIndex: exclusions[i]];
+
+	return indexSet;
+}
+
+- (id) copyWithZone: (NSZone*) zone
+{
+	return [self retain];
+}
+
+//Archive as a normal array so archives can be read by
+//versions without this class.
+- (Class) classForCoder
+{
+	return [NSArray class];
+}
+
+@end
+
+@implementation AdNonbondedPairArray (CompactAccess)
+
+- (int) numberOfElements
+{
+	return numberOfElements;
+}
+
+- (unsigned long long) numberOfPairs
+{
+	int i;
+	unsigned long long total;
+
+	for(total = 0, i=0; i<numberOfSets; i++)
+		total += numberOfElements - lowerBounds[i];
+
+	return total - exclusionOffsets[numberOfSets];
+}
+
+- (unsigned int) numberOfExclusions
+{
+	return exclusionOffsets[numberOfSets];
+}
+
+- (int) lowerBoundForElement: (int) index
+{
+	if(index < 0 || index >= numberOfSets)
+		return numberOfElements;
+
+	return lowerBounds[index];
+}
+
+- (int*) exclusionsForElement: (int) index count: (int*) count
+{
+	if(index < 0 || index >= numberOfSets)
+	{
+		*count = 0;
+		return exclusions;
+	}
+
+	*count = exclusionOffsets[index+1] - exclusionOffsets[index];
+	return exclusions + exclusionOffsets[index];
+}
+
+- (AdNonbondedPairArray*) pairArrayForElementsInRange: (NSRange) range
+{
+	int i;
+	int* bounds;
+	AdNonbondedPairArray* pairArray;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	//Exclusions outside the bounds are dropped so only the
+	//bounds of the elements outside the range have to be changed.
+	bounds = [memoryManager allocateArrayOfSize: (numberOfSets + 1)*sizeof(int)];
+	for(i=0; i<numberOfSets; i++)
+		bounds[i] = NSLocationInRange(i, range) ? lowerBounds[i] : numberOfElements;
+
+	pairArray = [[AdNonbondedPairArray alloc]
+			initWithNumberOfElements: numberOfElements
+			numberOfSets: numberOfSets
+			lowerBounds: bounds
+			exclusionOffsets: exclusionOffsets
+			exclusions: exclusions];
+	[memoryManager freeArray: bounds];
+
+	return [pairArray autorelease];
+}
+
+- (AdNonbondedPairArray*) pairArrayByRemovingElement: (unsigned int) index
+{
+	int i, j, set, count, element;
+	int* bounds, *offsets, *excluded;
+	AdNonbondedPairArray* pairArray;
+	AdMemoryManager* memoryManager = [AdMemoryManager appMemoryManager];
+
+	if(index > (unsigned int)numberOfSets)
+		[NSException raise: NSRangeException
+			format: @"Index %d is out of range (%d)", index, numberOfSets];
+
+	bounds = [memoryManager allocateArrayOfSize: (numberOfSets + 1)*sizeof(int)];
+	offsets = [memoryManager allocateArrayOfSize: (numberOfSets + 1)*sizeof(int)];
+	excluded = [memoryManager allocateArrayOfSize:
+			(exclusionOffsets[numberOfSets] + 1)*sizeof(int)];
+
+	//The set of the removed element, or the last set, is skipped.
+	//All indexes higher than the removed element are decreased by one.
+	offsets[0] = 0;
+	for(count = 0, set = 0, i=0; i<numberOfSets; i++)
+	{
+		if(i == (int)index || (index == (unsigned int)numberOfSets && i == numberOfSets - 1))
+			continue;
+
+		bounds[set] = (lowerBounds[i] > (int)index) ? lowerBounds[i] - 1 : lowerBounds[i];
+		for(j=exclusionOffsets[i]; j<exclusionOffsets[i+1]; j++)
+		{
+			element = exclusions[j];
+			if(element == (int)index)
+				continue;
+
+			excluded[count] = (element > (int)index) ? element - 1 : element;
+			count++;
+		}
+
+		set++;
+		offsets[set] = count;
+	}
+
+	pairArray = [[AdNonbondedPairArray alloc]
+			initWithNumberOfElements: (numberOfElements > 0) ? numberOfElements - 1 : 0
+			numberOfSets: set
+			lowerBounds: bounds
+			exclusionOffsets: offsets
+			exclusions: excluded];
+	[memoryManager freeArray: bounds];
+	[memoryManager freeArray: offsets];
+	[memoryManager freeArray: excluded];
+
+	return [pairArray autorelease];
+}
+
+@end
@@ -0,0 +1,978 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#include "AdunKernel/AdunPMENonbondedTerm.h"
+
+@implementation AdPMENonbondedTerm
+
+- (BOOL) _checkMatrix: (AdDataMatrix*) matrix containsParametersForType: (NSString*) type
+{
+	NSArray* headers;
+
+	headers = [matrix columnHeaders];
+	if([type isEqual: @"A"])	
+	{
+		if(![headers containsObject: @"VDW A"])
+			return NO;
+		else if(![headers containsObject: @"VDW B"])
+			return NO;
+		
+	}
+	else if([type isEqual: @"B"])	
+	{
+		if(![headers containsObject: @"VDW WellDepth"])
+			return NO;
+		else if(![headers containsObject: @"VDW Separation"])
+			return NO;
+	}
+
+	if(![headers containsObject: @"PartialCharge"])
+		return NO;
+
+	return YES;	
+}
+
+/*
+ * To speed up the calculation in the type A case we
+ * can precompute the product A*A and B*B for the LJ interactions
+ */
+- (void) _precomputeParameters
+{
+	int j, atomOne, atomTwo;
+	int* offsets, *neighbours;
+	double *paramOne, *paramTwo, *chargeProducts;
+
+	offsets = pairList->offsets;
+	neighbours = pairList->neighbours;
+	paramOne = pairList->paramOne;
+	paramTwo = pairList->paramTwo;
+	chargeProducts = pairList->chargeProducts;
+	if([lennardJonesType isEqual: @"A"])
+	{	
+		for(atomOne=0; atomOne < pairList->numberOfElements; atomOne++)
+			for(j=offsets[atomOne]; j<offsets[atomOne+1]; j++)
+			{
+				atomTwo = neighbours[j];
+				paramOne[j] = parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0];
+				paramTwo[j] = parameters->matrix[atomOne][1]*parameters->matrix[atomTwo][1];
+				chargeProducts[j] = partialCharges[atomOne]*partialCharges[atomTwo];
+			}
+	}
+	else
+	{
+		for(atomOne=0; atomOne < pairList->numberOfElements; atomOne++)
+			for(j=offsets[atomOne]; j<offsets[atomOne+1]; j++)
+			{
+				atomTwo = neighbours[j];
+				paramOne[j] = sqrt(parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0]);
+				paramTwo[j] = (parameters->matrix[atomOne][1] + parameters->matrix[atomTwo][1]);
+				chargeProducts[j] = partialCharges[atomOne]*partialCharges[atomTwo];
+			}
+	}
+}
+
+/*
+ * Retrieve the necessary parameters from the element properties.
+ */
+- (void) _initialiseParameters
+{
+	int numberOfElements, i;
+	NSArray* parametersOne, *parametersTwo;
+
+	numberOfElements = [system numberOfElements];
+	parameters = [memoryManager
+			allocateMatrixWithRows: numberOfElements
+			withColumns: 2];
+
+	if([lennardJonesType isEqual: @"A"])
+	{
+		//We have  LJ parameters A and B
+	
+		parametersOne = [elementProperties columnWithHeader: @"VDW A"];
+		parametersTwo = [elementProperties columnWithHeader: @"VDW B"];
+	}
+	else
+	{
+		//We have LJ parameters WellDepth and Separation
+		parametersOne = [elementProperties columnWithHeader: @"VDW WellDepth"];
+		parametersTwo = [elementProperties columnWithHeader: @"VDW Separation"];
+	}
+
+	for(i=0; i<numberOfElements; i++)
+	{
+		parameters->matrix[i][0] = [[parametersOne objectAtIndex: i]
+						doubleValue];
+		parameters->matrix[i][1] = [[parametersTwo objectAtIndex: i]
+						doubleValue];
+	}
+
+	parametersOne = [elementProperties columnWithHeader: @"PartialCharge"];
+	partialCharges = [memoryManager
+				allocateArrayOfSize: numberOfElements*sizeof(double)];
+	for(i=0; i<numberOfElements; i++)
+		partialCharges[i] = [[parametersOne objectAtIndex: i] doubleValue];
+}
+
+- (void) _determineLJType
+{
+	NSArray* availableInteractions;
+
+	[lennardJonesType release];
+	availableInteractions = [system availableInteractions];
+	if([availableInteractions containsObject: @"TypeOneVDWInteraction"])
+		lennardJonesType =  [@"A" retain];
+	else if([availableInteractions containsObject: @"TypeTwoVDWInteraction"])
+		lennardJonesType =  [@"B" retain];
+	else
+	{
+		NSWarnLog(@"Unable to determine Lennard Jones type");
+		NSWarnLog(@"Interactions %@", availableInteractions);
+		lennardJonesType =  [@"A" retain];
+	}	
+}
+
+/*
+ * Creates the grid used for the reciprocal space sum.
+ * The number of points along each axis is chosen so the FFTs are efficient.
+ */
+- (void) _initialiseGrid
+{
+	int i, size[3];
+	id box;
+
+	AdFreePMEGrid(pmeGrid);
+	pmeGrid = NULL;
+
+	box = [system periodicBox];
+	if(box == nil)
+		[NSException raise: NSInvalidArgumentException
+			format: @"System %@ is not periodic - PME requires periodic boundary conditions",
+			[system systemName]];
+
+	[box getPeriodicBox: &periodicBox];
+	for(i=0; i<3; i++)
+	{
+		size[i] = AdPMEGridSize((int)ceil(periodicBox.lengths[i]/gridSpacing));
+		if(size[i] < splineOrder)
+			size[i] = AdPMEGridSize(splineOrder);
+	}
+
+	ewaldCoefficient = AdEwaldCoefficient(cutoff, ewaldTolerance);
+	pmeGrid = AdAllocatePMEGrid([system numberOfElements], 
+			&periodicBox, 
+			size, 
+			splineOrder, 
+			ewaldCoefficient);
+	
+	if(exclusionList != NULL)
+		AdPairListSetPeriodicBox(exclusionList, &periodicBox);
+
+	NSDebugLLog(@"AdPMENonbondedTerm", @"Grid size %d %d %d. Ewald coefficient %lf",
+		size[0], size[1], size[2], ewaldCoefficient);
+}
+
+/*
+ * Creates the list of pairs that are not nonbonded pairs e.g. bonded pairs.
+ * Their interaction is included in the reciprocal sum and must be removed.
+ * Since the allowed pairs for each element only contain higher indexes the number
+ * of excluded partners is known. They are usually close in index to the element
+ * so the search stops once they have all been found.
+ */
+- (void) _createExclusionList
+{
+	int i, j, numberOfElements, missing, count;
+	int lowerBound, numberOfExclusions;
+	int* excluded, *elementExclusions;
+	BOOL isPairArray;
+	NSIndexSet* indexSet;
+
+	AdFreePairList(exclusionList);
+	isPairArray = [pairs isKindOfClass: [AdNonbondedPairArray class]];
+	numberOfElements = [system numberOfElements];
+	exclusionList = AdAllocatePairList(numberOfElements, numberOfElements);
+	excluded = [memoryManager allocateArrayOfSize: numberOfElements*sizeof(int)];
+	for(i=0; i<numberOfElements; i++)
+	{
+		//With an AdNonbondedPairArray the excluded elements are the elements
+		//below the lower bound followed by the exclusions.
+		if(isPairArray)
+		{
+			lowerBound = (i < (int)[pairs count]) ? 
+				[(AdNonbondedPairArray*)pairs lowerBoundForElement: i] : numberOfElements;
+			lowerBound = MIN(lowerBound, numberOfElements);
+			for(count = 0, j = i + 1; j < lowerBound; j++, count++)
+				excluded[count] = j;
+
+			elementExclusions = [(AdNonbondedPairArray*)pairs 
+						exclusionsForElement: i
+						count: &numberOfExclusions];
+			for(j=0; j<numberOfExclusions && elementExclusions[j] < numberOfElements; j++, count++)
+				excluded[count] = elementExclusions[j];
+
+			AdPairListAppendElement(exclusionList, i, excluded, count);
+			continue;
+		}
+
+		indexSet = (i < (int)[pairs count]) ? [pairs objectAtIndex: i] : nil;
+		missing = numberOfElements - 1 - i - (int)[indexSet count];
+		for(count = 0, j = i + 1; count < missing && j < numberOfElements; j++)
+			if(![indexSet containsIndex: j])
+			{
+				excluded[count] = j;
+				count++;
+			}
+
+		AdPairListAppendElement(exclusionList, i, excluded, count);
+	}
+
+	AdPairListFinalise(exclusionList);
+	AdPairListSetPeriodicBox(exclusionList, &periodicBox);
+	for(i=0; i<numberOfElements; i++)
+		for(j=exclusionList->offsets[i]; j<exclusionList->offsets[i+1]; j++)
+			exclusionList->chargeProducts[j] = partialCharges[i]*
+				partialCharges[exclusionList->neighbours[j]];
+
+	[memoryManager freeArray: excluded];
+
+	NSDebugLLog(@"AdPMENonbondedTerm", @"%d excluded pairs", exclusionList->numberOfPairs);
+}
+
+/*
+ * The reciprocal space energy plus the self energy and exclusion corrections.
+ * If forceMatrix is not NULL the forces are added to it.
+ */
+- (double) _longRangeEnergy: (AdMatrix*) coordinates forces: (double**) forceMatrix
+{
+	double energy;
+
+	reciprocalPotential = AdPMEReciprocalSpace(pmeGrid, 
+				coordinates->matrix, 
+				partialCharges, 
+				forceMatrix, 
+				electrostaticConstant);
+	energy = reciprocalPotential;
+	energy += AdEwaldSelfEnergy(partialCharges, 
+			pmeGrid->numberOfElements, 
+			&periodicBox, 
+			ewaldCoefficient, 
+			electrostaticConstant);
+	energy += AdEwaldExclusionCorrection(exclusionList, 
+			coordinates->matrix, 
+			forceMatrix, 
+			ewaldCoefficient, 
+			electrostaticConstant);
+
+	return energy;
+}
+
+/*
+ * Initialisation
+ */
+
+- (id) init
+{
+	return [self initWithSystem: nil];
+}
+
+- (id) initWithSystem: (id) aSystem
+{
+	return [self initWithSystem: aSystem
+		cutoff: 9.0
+		updateInterval: 20
+		permittivity: 1.0
+		gridSpacing: 1.0
+		splineOrder: 4
+		nonbondedPairs: nil
+		externalForceMatrix: NULL];
+}
+
+- (id) initWithSystem: (id) aSystem 
+	cutoff: (double) aDouble
+	updateInterval: (unsigned int) anInt
+	permittivity: (double) epsilon
+	gridSpacing: (double) spacing
+	splineOrder: (int) order
+	nonbondedPairs: (NSArray*) nonbondedPairs
+	externalForceMatrix: (AdMatrix*) matrix
+{
+	return [self initWithSystem: aSystem
+		cutoff: aDouble
+		updateInterval: anInt
+		permittivity: epsilon
+		gridSpacing: spacing
+		splineOrder: order
+		nonbondedPairs: nonbondedPairs
+		externalForceMatrix: matrix
+		listHandlerClass: [AdCellListHandler class]];
+}
+
+- (id) initWithSystem: (id) aSystem 
+	cutoff: (double) aDouble
+	updateInterval: (unsigned int) anInt
+	permittivity: (double) epsilon
+	gridSpacing: (double) spacing
+	splineOrder: (int) order
+	nonbondedPairs: (NSArray*) nonbondedPairs
+	externalForceMatrix: (AdMatrix*) matrix
+	listHandlerClass: (Class) aClass
+{
+	AdMatrix* coordinates;
+
+	if((self = [super init]))
+	{
+		if(spacing <= 0)
+			[NSException raise: NSInvalidArgumentException
+				format: @"Grid spacing must be greater than 0"];
+
+		if(order < 3)
+			[NSException raise: NSInvalidArgumentException
+				format: @"Spline order must be at least 3"];
+
+		elementProperties = nil;
+		pairs = nil;
+		lennardJonesType = nil;
+		system = nil;
+		pairList = NULL;
+		exclusionList = NULL;
+		pmeGrid = NULL;
+		partialCharges = NULL;
+		forces = parameters = NULL;
+		usingExternalForceMatrix = NO;
+		memoryManager = [AdMemoryManager appMemoryManager];
+		cutoff = aDouble;
+		buffer = 1.0;
+		updateInterval = anInt;
+		permittivity = epsilon;
+		electrostaticConstant = PI4EP_R/permittivity;
+		gridSpacing = spacing;
+		splineOrder = order;
+		ewaldTolerance = 1E-5;
+		
+		if(aClass ==  nil)
+			aClass = [AdCellListHandler class];
+
+		if(![aClass isSubclassOfClass: [AdListHandler class]])	
+			[NSException raise: NSInvalidArgumentException
+				format: @"Supplied list handler class, %@, is not a subclass of AdListHandler",
+				NSStringFromClass(aClass)];
+
+		listHandlerClass = aClass;
+
+		if(aSystem !=  nil)
+		{
+			system = [aSystem retain];
+			[self _determineLJType];
+			
+			//Retrieve element coordinates
+			coordinates = [system coordinates];
+			if(coordinates == NULL)
+			{
+				[self release];
+				[NSException raise: NSInvalidArgumentException 
+					format: @"Coordinates cannot be NULL"];
+			}		
+
+			//Check the element properties contain the required parameters
+			elementProperties = [system elementProperties];
+			[elementProperties retain];
+			if(![self _checkMatrix: elementProperties containsParametersForType: lennardJonesType])
+			{
+				[self release];
+				NSWarnLog(@"Requried properties not present in - %@", [elementProperties columnHeaders]);
+				[NSException raise: NSInvalidArgumentException
+					format: @"Properites matrix does not contain correct parameters for LJ type %@"
+					,lennardJonesType];
+			}
+
+			[self _initialiseParameters];
+			[self _initialiseGrid];
+
+			//Create handler
+			listHandler = [[aClass alloc] 
+					initWithSystem: system
+					allowedPairs: nil
+					cutoff: cutoff + buffer];
+			[listHandler setDelegate: self];
+
+			messageId = [[NSProcessInfo processInfo] globallyUniqueString];
+			[messageId retain];
+			[[AdMainLoopTimer mainLoopTimer] 
+				sendMessage: @selector(update)
+				toObject: listHandler
+				interval: updateInterval
+				name: messageId];
+
+			if(nonbondedPairs == nil)
+				nonbondedPairs = [system indexSetArrayForCategory:@"Nonbonded"];
+
+			[self setNonbondedPairs: nonbondedPairs];
+
+			if(matrix == NULL)
+			{
+				usingExternalForceMatrix = NO;
+				forces = [memoryManager allocateMatrixWithRows: coordinates->no_rows
+						withColumns: 3];
+			}
+			else
+			{
+				if(matrix->no_rows != coordinates->no_rows)
+				{
+					[self release];
+					[NSException raise: NSInvalidArgumentException
+						format: @"Force matrix has incorrect number of rows"];
+				}		
+
+				if(matrix->no_columns != 3)
+				{
+					[self release];
+					[NSException raise: NSInvalidArgumentException
+						format: @"Force matrix has incorrect number of columns"];
+				}		
+				forces = matrix;
+				usingExternalForceMatrix = YES;
+			}			
+		}	
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[[NSNotificationCenter defaultCenter]
+		removeObserver: self];
+
+	[pairs release];
+	[listHandler release];
+	[elementProperties release];
+	[lennardJonesType release];
+	[memoryManager freeArray: partialCharges];
+	[memoryManager freeMatrix: parameters];
+	AdFreePairList(exclusionList);
+	AdFreePMEGrid(pmeGrid);
+	if(!usingExternalForceMatrix)
+		[memoryManager freeMatrix: forces];
+	[system release];
+	if(messageId != nil)
+	{
+		[[AdMainLoopTimer mainLoopTimer]
+			removeMessageWithName: messageId];
+		[messageId release];
+	}	
+	[super dealloc];
+}
+
+- (NSString*) description
+{
+	NSMutableString* description = [NSMutableString string];
+	
+	[description appendFormat: 
+		     @"%@. System: %@\n\tCutoff: %5.2lf. Permittivity: %5.2lf. Update interval: %d\n",
+		NSStringFromClass([self class]), [system systemName], cutoff, 
+		permittivity, updateInterval];
+	[description appendFormat: 
+		     @"\tGrid spacing: %5.2lf. Spline order: %d. Ewald tolerance: %5.2E. Ewald coefficient: %8.5lf\n",
+		gridSpacing, splineOrder, ewaldTolerance, ewaldCoefficient];
+	if(pmeGrid != NULL)
+		[description appendFormat: @"\tGrid size: (%d, %d, %d)\n",
+			pmeGrid->gridSize[0], pmeGrid->gridSize[1], pmeGrid->gridSize[2]];
+	[description appendFormat: @"\t%@", [listHandler description]];
+	
+	return description;
+}
+
+/*
+ * Force & Potential Calculation
+ */
+
+- (void) evaluateForces;
+{
+	AdMatrix* coordinates;
+
+	coordinates = [system coordinates];
+
+	if(pairList == NULL)
+	{
+		if(system != nil && pairs != nil)
+		{
+			[self setNonbondedPairs: 
+				[system indexSetArrayForCategory:@"Nonbonded"]];
+		}		
+		else 
+			return;
+	}
+
+	vdwPotential = 0;
+	estPotential = 0;
+
+	if([lennardJonesType isEqual: @"A"])
+	{
+		AdEwaldCoulombAndLennardJonesAPairListForce(pairList, 
+			coordinates->matrix, 
+			forces->matrix, 
+			electrostaticConstant, 
+			cutoff,
+			ewaldCoefficient,
+			&vdwPotential, 
+			&estPotential);
+	}
+	else
+	{
+		AdEwaldCoulombAndLennardJonesBPairListForce(pairList, 
+			coordinates->matrix, 
+			forces->matrix, 
+			electrostaticConstant, 
+			cutoff,
+			ewaldCoefficient,
+			&vdwPotential, 
+			&estPotential);
+	}
+
+	estPotential += [self _longRangeEnergy: coordinates forces: forces->matrix];
+}
+
+- (void) evaluateLennardJonesForces
+{
+	NSWarnLog(@"Method (%@) not implemented", NSStringFromSelector(_cmd));
+}
+
+- (void) evaluateElectrostaticForces
+{
+	NSWarnLog(@"Method (%@) not implemented", NSStringFromSelector(_cmd));
+}
+
+- (void) evaluateEnergy;
+{
+	AdMatrix* coordinates;
+
+	coordinates = [system coordinates];
+
+	if(pairList == NULL)
+	{
+		/*
+		 * If system and pairs are not nil the list was invalidated by receipt of
+		 * an AdSystemContentsDidChangeNotification. In this case we rebuild it
+		 * using a newly acquired pair array
+		 */
+		if(system != nil && pairs != nil)
+		{
+			[self setNonbondedPairs: 
+				[system indexSetArrayForCategory:@"Nonbonded"]];
+		}		
+		else 
+			return;
+	}
+
+	vdwPotential = 0;
+	estPotential = 0;
+
+	if([lennardJonesType isEqual: @"A"])
+	{
+		AdEwaldCoulombAndLennardJonesAPairListEnergy(pairList, 
+			coordinates->matrix,
+			electrostaticConstant, 
+			cutoff,
+			ewaldCoefficient,
+			&vdwPotential, 
+			&estPotential);
+	}
+	else
+	{
+		AdEwaldCoulombAndLennardJonesBPairListEnergy(pairList, 
+			coordinates->matrix,
+			electrostaticConstant, 
+			cutoff,
+			ewaldCoefficient,
+			&vdwPotential, 
+			&estPotential);
+	}
+
+	estPotential += [self _longRangeEnergy: coordinates forces: NULL];
+}
+
+/*
+ * List Handler Delegate Methods
+ */
+ 
+- (void) handlerDidUpdateList: (AdListHandler*) handler
+{
+	[self _precomputeParameters];
+}
+
+- (void) handlerDidInvalidateList: (AdListHandler*) handler
+{
+	pairList = NULL;
+}
+
+- (void) handlerDidHandleContentChange: (AdListHandler*) handler
+{
+	int numberOfElements;
+
+	NSDebugLLog(@"AdPMENonbondedTerm",
+		@"Received handlerDidHandleContentChange message");
+
+	//Free affected instance variables
+	[elementProperties release];
+	[memoryManager freeArray: partialCharges];
+	[memoryManager freeMatrix: parameters];
+	
+	//Reaquire necessary information
+	numberOfElements = [system numberOfElements];	
+	elementProperties = [[system elementProperties] retain];
+	[self _initialiseParameters];		
+	[self _initialiseGrid];
+	
+	if(!usingExternalForceMatrix)
+	{
+		[memoryManager freeMatrix: forces];
+		forces = [memoryManager allocateMatrixWithRows: numberOfElements
+				withColumns: 3];
+	}
+
+	/*
+	 * Reset allowed pairs
+	 * We have to use the allowed pairs supplied by
+	 * indexSetArrayForCategory since we dont know
+	 * if any user supplied pair list is still valid.
+	 */
+	[pairs release];
+	pairs = [system indexSetArrayForCategory: @"Nonbonded"];
+	[pairs retain];
+	[listHandler setAllowedPairs: pairs];
+	[self _createExclusionList];
+	
+	//Recreate list
+	[listHandler createList];
+	pairList = [listHandler pairList];
+	[self _precomputeParameters];
+	NSDebugLLog(@"AdPMENonbondedTerm", @"Update complete");
+}
+
+/*
+ * Accessors
+ */
+
+- (double) electrostaticEnergy
+{
+	return estPotential;
+}
+
+- (double) lennardJonesEnergy
+{
+	return vdwPotential;
+}
+
+- (double) energy
+{
+	return estPotential + vdwPotential;
+}
+
+- (double) reciprocalSpaceEnergy
+{
+	return reciprocalPotential;
+}
+
+- (NSString*) lennardJonesType
+{
+	return [[lennardJonesType retain]
+		 autorelease];
+}
+
+- (double) cutoff
+{
+	return cutoff;
+}
+
+- (void) setCutoff: (double) aDouble
+{
+	cutoff = aDouble;
+	if(system != nil)
+		[self _initialiseGrid];
+
+	if(listHandler != nil)
+		[listHandler setCutoff: cutoff + buffer];
+}
+
+- (unsigned int) updateInterval
+{
+	return updateInterval;
+}
+
+- (void) setUpdateInterval: (unsigned int) anInt
+{
+	updateInterval = anInt;
+	if(listHandler != nil)
+		[[AdMainLoopTimer mainLoopTimer]
+			resetIntervalForMessageWithName: messageId
+			to: anInt];
+}
+
+- (void) updateList: (BOOL) reset
+{
+	[listHandler update];
+	if(reset)
+		[[AdMainLoopTimer mainLoopTimer]
+			resetCounterForMessageWithName: messageId];
+}
+
+- (double) permittivity
+{
+	return permittivity;
+}
+
+- (void) setPermittivity: (double) value
+{
+	permittivity = value;
+	electrostaticConstant = PI4EP_R/permittivity;
+}
+
+- (double) gridSpacing
+{
+	return gridSpacing;
+}
+
+- (void) setGridSpacing: (double) value
+{
+	if(value <= 0)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Grid spacing must be greater than 0"];
+
+	gridSpacing = value;
+	if(system != nil)
+		[self _initialiseGrid];
+}
+
+- (int) splineOrder
+{
+	return splineOrder;
+}
+
+- (void) setSplineOrder: (int) value
+{
+	if(value < 3)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Spline order must be at least 3"];
+
+	splineOrder = value;
+	if(system != nil)
+		[self _initialiseGrid];
+}
+
+- (double) ewaldTolerance
+{
+	return ewaldTolerance;
+}
+
+- (void) setEwaldTolerance: (double) value
+{
+	if(value <= 0 || value >= 1)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Ewald tolerance must be between 0 and 1"];
+
+	ewaldTolerance = value;
+	if(system != nil)
+		[self _initialiseGrid];
+}
+
+- (double) ewaldCoefficient
+{
+	return ewaldCoefficient;
+}
+
+- (NSArray*) gridSize
+{
+	if(pmeGrid == NULL)
+		return nil;
+
+	return [NSArray arrayWithObjects:
+		[NSNumber numberWithInt: pmeGrid->gridSize[0]],
+		[NSNumber numberWithInt: pmeGrid->gridSize[1]],
+		[NSNumber numberWithInt: pmeGrid->gridSize[2]], nil];
+}
+
+- (void) setExternalForceMatrix: (AdMatrix*) matrix
+{
+	int numberOfElements;
+
+	numberOfElements = [system numberOfElements];
+
+	//Check matrix has correct dimensions
+	if(matrix == NULL)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Matrix cannot be NULL"];
+	else if(matrix->no_rows != numberOfElements)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Matrix has incorrect number of rows (%d - required %d)",
+			matrix->no_rows, numberOfElements];
+	else if(matrix->no_columns != 3)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Matrix has incorrect number of columns"];
+
+	if(!usingExternalForceMatrix)
+	{
+		[memoryManager freeMatrix: forces];
+		usingExternalForceMatrix = YES;
+	}
+
+	forces = matrix;
+}
+
+- (AdMatrix*) forces
+{
+	return forces;
+}
+
+- (void) clearForces
+{
+	int i,j;
+
+	for(i=0; i<forces->no_rows; i++)
+		for(j=0; j<3; j++)
+			forces->matrix[i][j] = 0;
+}
+
+- (BOOL) usesExternalForceMatrix
+{
+	return usingExternalForceMatrix;
+}
+
+- (void) setSystem: (id) anObject
+{
+	int numberOfElements;
+
+	//Clear all system related variables
+	if(system != nil)
+	{
+		[elementProperties release];
+		[memoryManager freeArray: partialCharges];
+		[memoryManager freeMatrix: parameters];
+		AdFreePairList(exclusionList);
+		exclusionList = NULL;
+		AdFreePMEGrid(pmeGrid);
+		pmeGrid = NULL;
+		
+		if(!usingExternalForceMatrix)
+			[memoryManager freeMatrix: forces];
+		
+		[system release];
+	}
+
+	system = [anObject retain];
+	if(system != nil)
+	{
+		[self _determineLJType];
+
+		numberOfElements = [system numberOfElements];
+		elementProperties = [[system elementProperties] retain];
+		usingExternalForceMatrix = NO;
+		forces = [memoryManager allocateMatrixWithRows: numberOfElements
+				withColumns: 3];
+				
+		//Require parameters and partial charges
+		[self _initialiseParameters];		
+		[self _initialiseGrid];
+
+		//Update handler
+		if(listHandler == nil)
+		{
+			listHandler = [[listHandlerClass alloc] 
+					initWithSystem: system
+					allowedPairs: nil
+					cutoff: cutoff + buffer];
+			[listHandler setDelegate: self];
+			messageId = [[NSProcessInfo processInfo]
+					globallyUniqueString];
+			[messageId retain];
+			[[AdMainLoopTimer mainLoopTimer] 
+				sendMessage: @selector(update)
+				toObject: listHandler
+				interval: updateInterval
+				name: messageId];
+		}
+		
+		[listHandler setSystem: system];
+		[self setNonbondedPairs: 
+			[system indexSetArrayForCategory: @"Nonbonded"]];
+	}		
+}
+
+- (id) system
+{
+	return [[system retain] autorelease];
+}
+
+- (BOOL) canEvaluateEnergy
+{
+	return YES;
+}
+
+- (BOOL) canEvaluateForces
+{
+	return YES;
+}
+
+- (void) setNonbondedPairs: (NSArray*) nonbondedPairs
+{
+	//Cant specify pairs if there is no system
+	if(system == nil)
+		return;
+
+	if(pairs != nil)
+		[pairs release];
+
+	pairs = [nonbondedPairs retain];
+	[self _createExclusionList];
+	[listHandler setAllowedPairs: pairs];
+	[listHandler createList];
+	pairList = [listHandler pairList];
+	[self _precomputeParameters];
+}
+
+- (NSArray*) nonbondedPairs
+{
+	return [[pairs retain] autorelease];
+}
+
+- (AdPairList*) pairList
+{
+	return pairList;
+}
+
+- (id) copyWithZone:(NSZone *)aZone
+{
+	id copy;
+
+	copy = [[[self class] alloc]
+		initWithSystem: system
+			cutoff: cutoff
+		updateInterval: updateInterval
+		  permittivity: permittivity
+		   gridSpacing: gridSpacing
+		   splineOrder: splineOrder
+		nonbondedPairs: nil
+	   externalForceMatrix: NULL
+	      listHandlerClass: listHandlerClass];
+	[copy setEwaldTolerance: ewaldTolerance];
+
+	return copy;
+}
+
+@end
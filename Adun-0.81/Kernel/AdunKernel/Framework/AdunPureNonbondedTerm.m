@@ -60,33 +60,36 @@ static NSArray* knownTypes;
  */
 - (void) _precomputeParameters
 {
-	int atomOne, atomTwo;
-	ListElement* list_p;
-
-	list_p = interactionList->next;
+	int j, atomOne, atomTwo;
+	int* offsets, *neighbours;
+	double *paramOne, *paramTwo, *chargeProducts;
+
+	offsets = pairList->offsets;
+	neighbours = pairList->neighbours;
+	paramOne = pairList->paramOne;
+	paramTwo = pairList->paramTwo;
+	chargeProducts = pairList->chargeProducts;
 	if([lennardJonesType isEqual: @"A"])
 	{	
-		while(list_p->next != NULL)
-		{
-			atomOne = list_p->bond[0];
-			atomTwo = list_p->bond[1];
-			list_p->params[0] = parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0];
-			list_p->params[1] = parameters->matrix[atomOne][1]*parameters->matrix[atomTwo][1];
-			list_p->params[2] = partialCharges[atomOne]*partialCharges[atomTwo];
-			list_p = list_p->next;
-		}
+		for(atomOne=0; atomOne < pairList->numberOfElements; atomOne++)
+			for(j=offsets[atomOne]; j<offsets[atomOne+1]; j++)
+			{
+				atomTwo = neighbours[j];
+				paramOne[j] = parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0];
+				paramTwo[j] = parameters->matrix[atomOne][1]*parameters->matrix[atomTwo][1];
+				chargeProducts[j] = partialCharges[atomOne]*partialCharges[atomTwo];
+			}
 	}
 	else
 	{
-		while(list_p->next != NULL)
-		{
-			atomOne = list_p->bond[0];
-			atomTwo = list_p->bond[1];
-			list_p->params[0] = sqrt(parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0]);
-			list_p->params[1] = (parameters->matrix[atomOne][1] + parameters->matrix[atomTwo][1]);
-			list_p->params[2] = partialCharges[atomOne]*partialCharges[atomTwo];
-			list_p = list_p->next;
-		}
+		for(atomOne=0; atomOne < pairList->numberOfElements; atomOne++)
+			for(j=offsets[atomOne]; j<offsets[atomOne+1]; j++)
+			{
+				atomTwo = neighbours[j];
+				paramOne[j] = sqrt(parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0]);
+				paramTwo[j] = (parameters->matrix[atomOne][1] + parameters->matrix[atomTwo][1]);
+				chargeProducts[j] = partialCharges[atomOne]*partialCharges[atomTwo];
+			}
 	}
 }
 
@@ -169,6 +172,83 @@ static NSArray* knownTypes;
 	[knownTypes retain];
 }
 
+/*
+ * Registers or removes the timer message which updates the list
+ * every updateInterval steps. It is only used when the list is updated
+ * automatically and not based on the element displacements.
+ */
+- (void) _scheduleListUpdates
+{
+	BOOL useTimer;
+
+	useTimer = autoUpdateList && !updateOnDisplacement && (listHandler != nil);
+	if(useTimer && (messageId == nil))
+	{
+		messageId = [[NSProcessInfo processInfo] globallyUniqueString];
+		[messageId retain];
+		[[AdMainLoopTimer mainLoopTimer] 
+			sendMessage: @selector(update)
+			toObject: listHandler
+			interval: updateInterval
+			name: messageId];
+	}
+	else if(!useTimer && (messageId != nil))
+	{
+		[[AdMainLoopTimer mainLoopTimer]
+			removeMessageWithName: messageId];
+		[messageId release];
+		messageId = nil;
+	}
+}
+
+/*
+ * Records the coordinates the current list was built from.
+ */
+- (void) _recordListBuild
+{
+	int i;
+	AdMatrix* coordinates;
+	id box;
+
+	coordinates = [system coordinates];
+	if(referenceCoordinates != NULL && referenceCoordinates->no_rows != coordinates->no_rows)
+	{
+		[memoryManager freeMatrix: referenceCoordinates];
+		referenceCoordinates = NULL;
+	}	
+
+	if(referenceCoordinates == NULL)
+		referenceCoordinates = [memoryManager allocateMatrixWithRows: coordinates->no_rows
+					withColumns: 3];
+
+	for(i=0; i<coordinates->no_rows; i++)
+	{
+		referenceCoordinates->matrix[i][0] = coordinates->matrix[i][0];
+		referenceCoordinates->matrix[i][1] = coordinates->matrix[i][1];
+		referenceCoordinates->matrix[i][2] = coordinates->matrix[i][2];
+	}
+
+	//Coordinates are wrapped into the box so displacements must use the minimum image
+	box = [system periodicBox];
+	periodic = (box != nil);
+	if(periodic)
+		[box getPeriodicBox: &periodicBox];
+
+	numberOfBuilds++;
+	NSDebugLLog(@"AdPureNonbondedTerm", 
+		@"List built (%u builds in %u checks). Maximum displacement %lf",
+		numberOfBuilds, numberOfChecks, maximumDisplacement);
+}
+
+/*
+ * Invalidates the reference coordinates so the next check triggers an update.
+ */
+- (void) _invalidateReference
+{
+	[memoryManager freeMatrix: referenceCoordinates];
+	referenceCoordinates = NULL;
+}
+
 - (id) init
 {
 	return [self initWithSystem: nil];
@@ -216,7 +296,7 @@ static NSArray* knownTypes;
 		pairs = nil;
 		lennardJonesType = nil;
 		system = nil;
-		interactionList = NULL;
+		pairList = NULL;
 		partialCharges = NULL;
 		forces = parameters = NULL;
 		usingExternalForceMatrix = NO;
@@ -225,6 +305,13 @@ static NSArray* knownTypes;
 		cutoff = aDouble;
 		buffer = 1.5;
 		updateInterval = anInt;
+		autoUpdateList = YES;
+		updateOnDisplacement = YES;
+		periodic = NO;
+		referenceCoordinates = NULL;
+		numberOfChecks = numberOfBuilds = 0;
+		maximumDisplacement = 0;
+		messageId = nil;
 		
 		if(aClass ==  nil)
 			aClass = [AdCellListHandler class];
@@ -270,14 +357,7 @@ static NSArray* knownTypes;
 					allowedPairs: nil
 					cutoff: cutoff + buffer];
 			[listHandler setDelegate: self];
-
-			messageId = [[NSProcessInfo processInfo] globallyUniqueString];
-			[messageId retain];
-			[[AdMainLoopTimer mainLoopTimer] 
-				sendMessage: @selector(update)
-				toObject: listHandler
-				interval: updateInterval
-				name: messageId];
+			[self _scheduleListUpdates];
 
 			if(nonbondedPairs == nil)
 				nonbondedPairs = [system indexSetArrayForCategory:@"Nonbonded"];
@@ -326,6 +406,7 @@ static NSArray* knownTypes;
 	[lennardJonesType release];
 	[memoryManager freeArray: partialCharges];
 	[memoryManager freeMatrix: parameters];
+	[memoryManager freeMatrix: referenceCoordinates];
 	if(!usingExternalForceMatrix)
 		[memoryManager freeMatrix: forces];
 	[system release];
@@ -345,6 +426,13 @@ static NSArray* knownTypes;
 	[description appendFormat: 
 		@"%@. System: %@\n\tCutoff: %5.2lf. Relative permittivity: %5.2lf. Update interval: %d\n",
 		NSStringFromClass([self class]), [system systemName], cutoff, permittivity, updateInterval];
+	if(updateOnDisplacement)
+		[description appendFormat: 
+			@"\tSkin: %5.2lf. List rebuilt on displacement. %u builds in %u checks\n",
+			buffer, numberOfBuilds, numberOfChecks];
+	else
+		[description appendFormat: @"\tSkin: %5.2lf. List rebuilt every %d steps\n",
+			buffer, updateInterval];
 	[description appendFormat: @"\t%@", [listHandler description]];
 	
 	return description;
@@ -356,13 +444,12 @@ static NSArray* knownTypes;
 
 - (void) evaluateForces;
 {
-	ListElement* list_p;
 	double electrostaticConstant;
 	AdMatrix* coordinates;
 
 	coordinates = [system coordinates];
 
-	if(interactionList == NULL)
+	if(pairList == NULL)
 	{
 		if(system != nil && pairs != nil)
 		{
@@ -373,40 +460,32 @@ static NSArray* knownTypes;
 			return;
 	}
 
-	//May be quicker to get the number of nonbonded interactions and then use a for loop here
-	
+	if(autoUpdateList && updateOnDisplacement && [self listNeedsUpdate])
+		[listHandler update];
+
 	vdwPotential = 0;
 	estPotential = 0;
 
-	list_p = interactionList->next;
 	electrostaticConstant = PI4EP_R/permittivity;
 	if([lennardJonesType isEqual: @"A"])
 	{
-		while(list_p->next != NULL)
-		{
-			AdCoulombAndLennardJonesAForce(list_p, 
-				coordinates->matrix, 
-				forces->matrix, 
-				electrostaticConstant, 
-				cutoff,
-				&vdwPotential, 
-				&estPotential);
-			list_p = list_p->next;
-		}
+		AdCoulombAndLennardJonesAPairListForce(pairList, 
+			coordinates->matrix, 
+			forces->matrix, 
+			electrostaticConstant, 
+			cutoff,
+			&vdwPotential, 
+			&estPotential);
 	}
 	else
 	{
-		while(list_p->next != NULL)
-		{
-			AdCoulombAndLennardJonesBForce(list_p, 
-				coordinates->matrix, 
-				forces->matrix, 
-				electrostaticConstant, 
-				cutoff,
-				&vdwPotential, 
-				&estPotential);
-			list_p = list_p->next;
-		}
+		AdCoulombAndLennardJonesBPairListForce(pairList, 
+			coordinates->matrix, 
+			forces->matrix, 
+			electrostaticConstant, 
+			cutoff,
+			&vdwPotential, 
+			&estPotential);
 	}
 
 }	
@@ -423,13 +502,12 @@ static NSArray* knownTypes;
 
 - (void) evaluateEnergy;
 {
-	ListElement* list_p;
 	double electrostaticConstant;
 	AdMatrix* coordinates;
 
 	coordinates = [system coordinates];
 
-	if(interactionList == NULL)
+	if(pairList == NULL)
 	{
 		/*
 		 * If system and pairs are not nil the list was invalidated by receipt of
@@ -445,38 +523,29 @@ static NSArray* knownTypes;
 			return;
 	}
 
+	if(autoUpdateList && updateOnDisplacement && [self listNeedsUpdate])
+		[listHandler update];
+
 	vdwPotential = 0;
 	estPotential = 0;
 	electrostaticConstant = PI4EP_R/permittivity;
 	if([lennardJonesType isEqual: @"A"])
 	{
-		list_p = interactionList->next;
-		while(list_p->next != NULL)
-		{
-			AdCoulombAndLennardJonesAEnergy(list_p, 
-				coordinates->matrix,
-				electrostaticConstant, 
-				cutoff,
-				&vdwPotential, 
-				&estPotential);
-
-			list_p = list_p->next;
-		}
+		AdCoulombAndLennardJonesAPairListEnergy(pairList, 
+			coordinates->matrix,
+			electrostaticConstant, 
+			cutoff,
+			&vdwPotential, 
+			&estPotential);
 	}
 	else
 	{
-		list_p = interactionList->next;
-		while(list_p->next != NULL)
-		{
-			AdCoulombAndLennardJonesBEnergy(list_p, 
-				coordinates->matrix,
-				electrostaticConstant, 
-				cutoff,
-				&vdwPotential, 
-				&estPotential);
-
-			list_p = list_p->next;
-		}
+		AdCoulombAndLennardJonesBPairListEnergy(pairList, 
+			coordinates->matrix,
+			electrostaticConstant, 
+			cutoff,
+			&vdwPotential, 
+			&estPotential);
 	}
 }
 
@@ -487,11 +556,12 @@ static NSArray* knownTypes;
 - (void) handlerDidUpdateList: (AdListHandler*) handler
 {
 	[self _precomputeParameters];
+	[self _recordListBuild];
 }
 
 - (void) handlerDidInvalidateList: (AdListHandler*) handler
 {
-	interactionList = NULL;
+	pairList = NULL;
 }
 
 - (void) handlerDidHandleContentChange: (AdListHandler*) handler
@@ -547,9 +617,10 @@ static NSArray* knownTypes;
 	
 	NSDebugLLog(@"AdPureNonbondedTerm", @"Recreating list");
 	[listHandler createList];
-	interactionList = [[listHandler pairList] pointerValue];
+	pairList = [listHandler pairList];
 	NSDebugLLog(@"AdPureNonbondedTerm", @"Precomputing parameters");
 	[self _precomputeParameters];
+	[self _recordListBuild];
 	NSDebugLLog(@"AdPureNonbondedTerm", @"Update complete");
 }
 
@@ -598,6 +669,8 @@ static NSArray* knownTypes;
 	cutoff = aDouble;
 	if(listHandler != nil)
 		[listHandler setCutoff: cutoff + buffer];
+
+	[self _invalidateReference];
 }
 
 - (unsigned int) updateInterval
@@ -608,7 +681,7 @@ static NSArray* knownTypes;
 - (void) setUpdateInterval: (unsigned int) anInt
 {
 	updateInterval = anInt;
-	if(listHandler != nil)
+	if(messageId != nil)
 		[[AdMainLoopTimer mainLoopTimer]
 			resetIntervalForMessageWithName: messageId
 			to: anInt];
@@ -616,32 +689,105 @@ static NSArray* knownTypes;
 
 - (void) setAutoUpdateList: (BOOL) value
 {
-	if((value == YES) && (messageId == nil))
-	{
-		NSLog(@"Turning list auto-update ON");
-		messageId = [[NSProcessInfo processInfo]
-			     globallyUniqueString];
-		[messageId retain];
-		[[AdMainLoopTimer mainLoopTimer] 
-			sendMessage: @selector(update)
-			toObject: listHandler
-			interval: updateInterval
-			name: messageId];
-	}
-	else if((value == NO) && (messageId != nil))
+	if(value != autoUpdateList)
+		NSLog(@"Turning list auto-update %@", value ? @"ON" : @"OFF");
+
+	autoUpdateList = value;
+	[self _scheduleListUpdates];
+}
+
+- (void) setUpdatesListOnDisplacement: (BOOL) value
+{
+	updateOnDisplacement = value;
+	[self _scheduleListUpdates];
+}
+
+- (BOOL) updatesListOnDisplacement
+{
+	return updateOnDisplacement;
+}
+
+- (double) skin
+{
+	return buffer;
+}
+
+- (void) setSkin: (double) value
+{
+	if(value < 0)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Skin cannot be negative (%lf)", value];
+
+	buffer = value;
+	if(listHandler != nil)
+		[listHandler setCutoff: cutoff + buffer];
+
+	[self _invalidateReference];
+}
+
+- (BOOL) listNeedsUpdate
+{
+	int i;
+	double displacement, maximum;
+	double separation[3];
+	double *current, *reference;
+	AdMatrix* coordinates;
+
+	if(referenceCoordinates == NULL)
+		return YES;
+
+	coordinates = [system coordinates];
+	if(coordinates->no_rows != referenceCoordinates->no_rows)
+		return YES;
+
+	numberOfChecks++;
+	maximum = 0;
+	for(i=0; i<coordinates->no_rows; i++)
 	{
-		NSLog(@"Turning list auto-update OFF");
-		[[AdMainLoopTimer mainLoopTimer]
-			removeMessageWithName: messageId];
-		[messageId release];
-		messageId = nil;
+		current = coordinates->matrix[i];
+		reference = referenceCoordinates->matrix[i];
+		separation[0] = current[0] - reference[0];
+		separation[1] = current[1] - reference[1];
+		separation[2] = current[2] - reference[2];
+		if(periodic)
+			AdMinimumImage(separation, &periodicBox);
+
+		displacement = separation[0]*separation[0] 
+			+ separation[1]*separation[1] 
+			+ separation[2]*separation[2];
+		if(displacement > maximum)
+			maximum = displacement;
 	}
+
+	maximumDisplacement = sqrt(maximum);
+	
+	//Two elements moving towards each other by half the skin each
+	//can just close a pair that was on the edge of the list.
+	return (2*maximumDisplacement > buffer) ? YES : NO;
+}
+
+- (NSDictionary*) listStatistics
+{
+	double checksPerBuild;
+
+	checksPerBuild = (numberOfBuilds > 0) ? (double)numberOfChecks/numberOfBuilds : 0;
+	return [NSDictionary dictionaryWithObjectsAndKeys:
+		[NSNumber numberWithUnsignedInt: numberOfChecks], @"Checks",
+		[NSNumber numberWithUnsignedInt: numberOfBuilds], @"Builds",
+		[NSNumber numberWithDouble: checksPerBuild], @"ChecksPerBuild",
+		[NSNumber numberWithDouble: maximumDisplacement], @"MaximumDisplacement",
+		[NSNumber numberWithDouble: buffer], @"Skin", nil];
+}
+
+- (void) resetListStatistics
+{
+	numberOfChecks = numberOfBuilds = 0;
 }
 
 - (void) updateList: (BOOL) reset
 {
 	[listHandler update];
-	if(reset)
+	if(reset && messageId != nil)
 		[[AdMainLoopTimer mainLoopTimer]
 			resetCounterForMessageWithName: messageId];
 }
@@ -709,6 +855,7 @@ Sets the system the term should be calculated on.
 		[elementProperties release];
 		[memoryManager freeArray: partialCharges];
 		[memoryManager freeMatrix: parameters];
+		[self _invalidateReference];
 		
 		if(!usingExternalForceMatrix)
 			[memoryManager freeMatrix: forces];
@@ -737,14 +884,7 @@ Sets the system the term should be calculated on.
 					allowedPairs: nil
 					cutoff: cutoff + buffer];
 			[listHandler setDelegate: self];
-			messageId = [[NSProcessInfo processInfo]
-					globallyUniqueString];
-			[messageId retain];
-			[[AdMainLoopTimer mainLoopTimer] 
-				sendMessage: @selector(update)
-				toObject: listHandler
-				interval: updateInterval
-				name: messageId];
+			[self _scheduleListUpdates];
 		}
 		
 		[listHandler setSystem: system];
@@ -790,8 +930,9 @@ Return YES if the term can calculate forces.
 	[listHandler setAllowedPairs: pairs];
 	[listHandler createList];
 			
-	interactionList = [[listHandler pairList] pointerValue];
+	pairList = [listHandler pairList];
 	[self _precomputeParameters];
+	[self _recordListBuild];
 }
 
 - (NSArray*) nonbondedPairs
@@ -803,14 +944,16 @@ Return YES if the term can calculate forces.
  Returns a pointer to the beginning of the list of nonbonded interaction pairs the receiver uses.
  See interface definition for more.
  */
-- (ListElement*) interactionList
+- (AdPairList*) pairList
 {
-	return interactionList;
+	return pairList;
 }
 
 - (id) copyWithZone: (NSZone*) aZone
 {
-	return [[[self class] alloc]
+	id copy;
+
+	copy = [[[self class] alloc]
 		initWithSystem: system
 			cutoff: cutoff
 		updateInterval: updateInterval
@@ -818,6 +961,10 @@ Return YES if the term can calculate forces.
 		nonbondedPairs: nil
 	   externalForceMatrix: NULL
 	      listHandlerClass: listHandlerClass];
+	[copy setSkin: buffer];
+	[copy setUpdatesListOnDisplacement: updateOnDisplacement];
+
+	return copy;
 }
 
 @end
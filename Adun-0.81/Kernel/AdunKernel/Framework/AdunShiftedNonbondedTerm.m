@@ -60,33 +60,36 @@ static NSArray* knownTypes;
  */
 - (void) _precomputeParameters
 {
-	int atomOne, atomTwo;
-	ListElement* list_p;
-
-	list_p = interactionList->next;
+	int j, atomOne, atomTwo;
+	int* offsets, *neighbours;
+	double *paramOne, *paramTwo, *chargeProducts;
+
+	offsets = pairList->offsets;
+	neighbours = pairList->neighbours;
+	paramOne = pairList->paramOne;
+	paramTwo = pairList->paramTwo;
+	chargeProducts = pairList->chargeProducts;
 	if([lennardJonesType isEqual: @"A"])
 	{	
-		while(list_p->next != NULL)
-		{
-			atomOne = list_p->bond[0];
-			atomTwo = list_p->bond[1];
-			list_p->params[0] = parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0];
-			list_p->params[1] = parameters->matrix[atomOne][1]*parameters->matrix[atomTwo][1];
-			list_p->params[2] = partialCharges[atomOne]*partialCharges[atomTwo];
-			list_p = list_p->next;
-		}
+		for(atomOne=0; atomOne < pairList->numberOfElements; atomOne++)
+			for(j=offsets[atomOne]; j<offsets[atomOne+1]; j++)
+			{
+				atomTwo = neighbours[j];
+				paramOne[j] = parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0];
+				paramTwo[j] = parameters->matrix[atomOne][1]*parameters->matrix[atomTwo][1];
+				chargeProducts[j] = partialCharges[atomOne]*partialCharges[atomTwo];
+			}
 	}
 	else
 	{
-		while(list_p->next != NULL)
-		{
-			atomOne = list_p->bond[0];
-			atomTwo = list_p->bond[1];
-			list_p->params[0] = sqrt(parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0]);
-			list_p->params[1] = (parameters->matrix[atomOne][1] + parameters->matrix[atomTwo][1]);
-			list_p->params[2] = partialCharges[atomOne]*partialCharges[atomTwo];
-			list_p = list_p->next;
-		}
+		for(atomOne=0; atomOne < pairList->numberOfElements; atomOne++)
+			for(j=offsets[atomOne]; j<offsets[atomOne+1]; j++)
+			{
+				atomTwo = neighbours[j];
+				paramOne[j] = sqrt(parameters->matrix[atomOne][0]*parameters->matrix[atomTwo][0]);
+				paramTwo[j] = (parameters->matrix[atomOne][1] + parameters->matrix[atomTwo][1]);
+				chargeProducts[j] = partialCharges[atomOne]*partialCharges[atomTwo];
+			}
 	}
 }
 
@@ -219,7 +222,7 @@ Initialises the term to operate on \e system
 		pairs = nil;
 		lennardJonesType = nil;
 		system = nil;
-		interactionList = NULL;
+		pairList = NULL;
 		partialCharges = NULL;
 		forces = parameters = NULL;
 		usingExternalForceMatrix = NO;
@@ -362,13 +365,12 @@ Initialises the term to operate on \e system
 
 - (void) evaluateForces;
 {
-	ListElement* list_p;
 	double electrostaticConstant;
 	AdMatrix* coordinates;
 
 	coordinates = [system coordinates];
 
-	if(interactionList == NULL)
+	if(pairList == NULL)
 	{
 		if(system != nil && pairs != nil)
 		{
@@ -379,42 +381,31 @@ Initialises the term to operate on \e system
 			return;
 	}
 
-	//May be quicker to get the number of nonbonded interactions and then use a for loop here
-	
 	vdwPotential = 0;
 	estPotential = 0;
 
-	list_p = interactionList->next;
 	electrostaticConstant = PI4EP_R/permittivity;
 	if([lennardJonesType isEqual: @"A"])
 	{
-		while(list_p->next != NULL)
-		{
-			AdShiftedCoulombAndLennardJonesAForce(list_p, 
-				coordinates->matrix, 
-				forces->matrix, 
-				electrostaticConstant,
-				cutoff,
-				reciprocalCutoff2,
-				&vdwPotential, 
-				&estPotential);
-			list_p = list_p->next;
-		}
+		AdShiftedCoulombAndLennardJonesAPairListForce(pairList, 
+			coordinates->matrix, 
+			forces->matrix, 
+			electrostaticConstant,
+			cutoff,
+			reciprocalCutoff2,
+			&vdwPotential, 
+			&estPotential);
 	}
 	else
 	{
-		while(list_p->next != NULL)
-		{
-			AdShiftedCoulombAndLennardJonesBForce(list_p, 
-				coordinates->matrix, 
-				forces->matrix, 
-				electrostaticConstant,
-				cutoff,
-				reciprocalCutoff2,
-				&vdwPotential, 
-				&estPotential);
-			list_p = list_p->next;
-		}	
+		AdShiftedCoulombAndLennardJonesBPairListForce(pairList, 
+			coordinates->matrix, 
+			forces->matrix, 
+			electrostaticConstant,
+			cutoff,
+			reciprocalCutoff2,
+			&vdwPotential, 
+			&estPotential);	
 	}
 }
 
@@ -430,13 +421,12 @@ Initialises the term to operate on \e system
 
 - (void) evaluateEnergy;
 {
-	ListElement* list_p;
 	double electrostaticConstant;
 	AdMatrix* coordinates;
 
 	coordinates = [system coordinates];
 
-	if(interactionList == NULL)
+	if(pairList == NULL)
 	{
 		/*
 		 * If system and pairs are not nil the list was invalidated by receipt of
@@ -457,33 +447,23 @@ Initialises the term to operate on \e system
 	electrostaticConstant = PI4EP_R/permittivity;
 	if([lennardJonesType isEqual: @"A"])
 	{
-		list_p = interactionList->next;
-		while(list_p->next != NULL)
-		{
-			AdShiftedCoulombAndLennardJonesAEnergy(list_p, 
-				coordinates->matrix, 
-				electrostaticConstant,
-				cutoff,
-				reciprocalCutoff2,
-				&vdwPotential, 
-				&estPotential);
-			list_p = list_p->next;
-		}
+		AdShiftedCoulombAndLennardJonesAPairListEnergy(pairList, 
+			coordinates->matrix, 
+			electrostaticConstant,
+			cutoff,
+			reciprocalCutoff2,
+			&vdwPotential, 
+			&estPotential);
 	}
 	else
 	{
-		list_p = interactionList->next;
-		while(list_p->next != NULL)
-		{
-			AdShiftedCoulombAndLennardJonesBEnergy(list_p, 
-				coordinates->matrix, 
-				electrostaticConstant,
-				cutoff,
-				reciprocalCutoff2,
-				&vdwPotential, 
-				&estPotential);
-			list_p = list_p->next;
-		}
+		AdShiftedCoulombAndLennardJonesBPairListEnergy(pairList, 
+			coordinates->matrix, 
+			electrostaticConstant,
+			cutoff,
+			reciprocalCutoff2,
+			&vdwPotential, 
+			&estPotential);
 	}
 }
 
@@ -498,7 +478,7 @@ Initialises the term to operate on \e system
 
 - (void) handlerDidInvalidateList: (AdListHandler*) handler
 {
-	interactionList = NULL;
+	pairList = NULL;
 }
 
 - (void) handlerDidHandleContentChange: (AdListHandler*) handler
@@ -552,7 +532,7 @@ Initialises the term to operate on \e system
 	
 	NSDebugLLog(@"AdShiftedNonbondedTerm", @"Recreating list");
 	[listHandler createList];
-	interactionList = [[listHandler pairList] pointerValue];
+	pairList = [listHandler pairList];
 	NSDebugLLog(@"AdShiftedNonbondedTerm", @"Precomputing parameters");
 	[self _precomputeParameters];
 	NSDebugLLog(@"AdShiftedNonbondedTerm", @"Update complete");
@@ -773,7 +753,7 @@ Return YES if the term can calculate forces.
 	[listHandler setAllowedPairs: pairs];
 	[listHandler createList];
 
-	interactionList = [[listHandler pairList] pointerValue];
+	pairList = [listHandler pairList];
 	[self _precomputeParameters];
 }
 
@@ -786,9 +766,9 @@ Return YES if the term can calculate forces.
  Returns a pointer to the beginning of the list of nonbonded interaction pairs the receiver uses.
  See interface definition for more.
  */
-- (ListElement*) interactionList
+- (AdPairList*) pairList
 {
-	return interactionList;
+	return pairList;
 }
 
 - (id) copyWithZone:(NSZone *)aZone
@@ -22,6 +22,8 @@
    Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 */
 #include "AdunKernel/AdunSimpleListHandler.h"
+#include "AdunKernel/AdunCuboidBox.h"
+#include "AdunKernel/AdunNonbondedPairArray.h"
 
 @implementation AdSimpleListHandler
 
@@ -38,7 +40,7 @@ Initialisation
 {
 	if((self = [super init]))
 	{
-		in_p = NULL;
+		pairList = NULL;
 		listCreated = NO;
 		[self setCutoff: valueOne];
 		[self setSystem: aSystem];
@@ -50,31 +52,8 @@ Initialisation
 
 - (void) _freeLists
 {
-	ListElement* list_p, *holder;
-	
-	//if in_p is initalised a list exists
-
-	if(in_p != NULL)
-	{
-		list_p = in_p;
-		while(list_p->next != NULL)	
-		{		
-			holder = list_p->next;
-			free(list_p);
-			list_p= holder;
-		}
-		free(list_p);	
-		in_p = NULL;
-		list_p = out_p;
-		while(list_p->next != NULL)	
-		{		
-			holder = list_p->next;
-			free(list_p);
-			list_p= holder;
-		}
-		free(list_p);
-		out_p = NULL;
-	}
+	AdFreePairList(pairList);
+	pairList = NULL;
 }	
 
 - (void) dealloc
@@ -108,156 +87,163 @@ Main methods
 
 *****************/
 
-- (void) createList
+//Returns YES if the separation of elements i and j is less than the cutoff.
+static inline BOOL AdPairInsideCutoff(double** matrix, int i, int j, double cutoff_sq, AdPeriodicBox* periodicBox)
+{
+	int k;
+	Vector3D seperation_s;
+
+	for(k=0; k<3; k++)
+		seperation_s.vector[k] = matrix[i][k] - matrix[j][k];
+
+	if(periodicBox != NULL)
+		AdMinimumImage(seperation_s.vector, periodicBox);
+
+	Ad3DVectorLengthSquared(&seperation_s);
+	return (seperation_s.length < cutoff_sq) ? YES : NO;
+}
+
+//As _buildList but reads the allowed partners of each element directly from the
+//lower bound and exclusions of an AdNonbondedPairArray instead of creating its index sets.
+//The partners of an element are all elements from its lower bound up which are not excluded.
+- (void) _buildListFromPairArray: (AdPeriodicBox*) periodicBox
 {
 	int i, j, k;
-	int incount, outcount;
-	int retVal, noAtoms;
+	int numberPartners, noAtoms, numberOfPairElements, count;
+	int* partners, *excluded;
+	double cutoff_sq;
+	AdNonbondedPairArray* pairArray = (AdNonbondedPairArray*)interactions;
+
+	partners = malloc(coordinates->no_rows*sizeof(int));
+	noAtoms = [pairArray count];
+	numberOfPairElements = MIN([pairArray numberOfElements], coordinates->no_rows);
+	cutoff_sq = cutoff*cutoff;
+
+	AdPairListClear(pairList);
+	AdPairListSetPeriodicBox(pairList, periodicBox);
+	for(i=0; i < noAtoms; i++)
+	{
+		excluded = [pairArray exclusionsForElement: i count: &count];
+		numberPartners = 0;
+		for(k=0, j=[pairArray lowerBoundForElement: i]; j < numberOfPairElements; j++)
+		{
+			//The exclusions are sorted so they are passed in step with j
+			while(k < count && excluded[k] < j)
+				k++;
+
+			if(k < count && excluded[k] == j)
+				continue;
+
+			if(AdPairInsideCutoff(coordinates->matrix, i, j, cutoff_sq, periodicBox))
+			{
+				partners[numberPartners] = j;
+				numberPartners++;
+			}
+		}
+
+		AdPairListAppendElement(pairList, i, partners, numberPartners);
+	}
+
+	AdPairListFinalise(pairList);
+	numberOfInteractions = pairList->numberOfPairs;
+	free(partners);
+}
+
+//Checks every allowed pair and adds those inside the cutoff to pairList.
+//If the system is periodic the minimum image separation is used.
+- (void) _buildList
+{
+	int i, k;
+	int numberPartners, retVal, noAtoms;
+	int* partners;
 	unsigned int* indexBuffer;
+	double cutoff_sq;
 	NSIndexSet* indexSet;
 	NSRange indexRange;
-	ListElement *list_p;
-	Vector3D seperation_s;
-	
-	if(listCreated)
-		return;
+	AdPeriodicBox periodicBox;
+	id box = nil;
 
-	//Check if we have a system and interactions
-	if(system ==  nil || interactions == nil)
-		return;
+	if([system respondsToSelector: @selector(periodicBox)])
+		box = [system periodicBox];
 
-	//Check if system and allowed pairs are compatible
-	if((int)[interactions count] >= coordinates->no_rows)
-		[NSException raise: NSInternalInconsistencyException
-			format: @"Allowed pairs array implies more elements then are present in system."];
+	if(box != nil)
+		[box getPeriodicBox: &periodicBox];
 
-	//create two empty lists
-	
-	in_p =  (ListElement*)malloc(sizeof(ListElement));
-	out_p = (ListElement*)malloc(sizeof(ListElement));
-	endin_p = AdLinkedListCreate(in_p);
-	endout_p = AdLinkedListCreate(out_p);
+	if([interactions isKindOfClass: [AdNonbondedPairArray class]])
+	{
+		[self _buildListFromPairArray: (box != nil) ? &periodicBox : NULL];
+		return;
+	}
+
+	partners = malloc(coordinates->no_rows*sizeof(int));
 	indexBuffer = malloc(100*sizeof(int));
 	noAtoms = [interactions count];	
+	cutoff_sq = cutoff*cutoff;
 
-	incount = outcount = 0;
+	AdPairListClear(pairList);
+	AdPairListSetPeriodicBox(pairList, (box != nil) ? &periodicBox : NULL);
 	for(i=0; i < noAtoms; i++)
 	{	
 		indexSet = [interactions objectAtIndex: i];
-		if([indexSet firstIndex] != NSNotFound)
-		{
-			indexRange.location = [indexSet firstIndex];
-			indexRange.length = [indexSet lastIndex] - indexRange.location + 1;
-			do
-			{	
-				retVal = [indexSet getIndexes: indexBuffer maxCount: 100 inIndexRange: &indexRange];
-				for(k=0; k<retVal; k++)
+		if([indexSet firstIndex] == NSNotFound)
+			continue;
+
+		numberPartners = 0;
+		indexRange.location = [indexSet firstIndex];
+		indexRange.length = [indexSet lastIndex] - indexRange.location + 1;
+		do
+		{	
+			retVal = [indexSet getIndexes: indexBuffer maxCount: 100 inIndexRange: &indexRange];
+			for(k=0; k<retVal; k++)
+			{
+				if(AdPairInsideCutoff(coordinates->matrix, i, indexBuffer[k], cutoff_sq,
+					(box != nil) ? &periodicBox : NULL))
 				{
-					//calculate distance	
-					for(j=0; j<3; j++)
-						seperation_s.vector[j] = coordinates->matrix[i][j] -
-									 coordinates->matrix[indexBuffer[k]][j];
-
-					//calculate the length of the seperation vector
-					Ad3DVectorLength(&seperation_s);
-					
-					if(seperation_s.length < cutoff)
-					{
-						//add to inside list;
-						list_p = (ListElement*)malloc(sizeof(ListElement));
-						list_p->bond[0] = i;
-						list_p->bond[1] = indexBuffer[k];
-						list_p->length = seperation_s.length;
-						AdSafeLinkedListAdd(list_p, endin_p, 0);
-						incount++;
-					}
-					else
-					{
-						//add to outside list
-						list_p = (ListElement*)malloc(sizeof(ListElement));
-						list_p->bond[0] = i;
-						list_p->bond[1] = indexBuffer[k];
-						AdSafeLinkedListAdd(list_p, endout_p, 0);
-						outcount++;			
-					}
+					partners[numberPartners] = indexBuffer[k];
+					numberPartners++;
 				}
 			}
-			while(retVal == 100); 
 		}
-	}	
+		while(retVal == 100); 
 		
-	free(indexBuffer);
-	numberOfInteractions = AdLinkedListCount(in_p) - 1;
-	listCreated = YES;
+		AdPairListAppendElement(pairList, i, partners, numberPartners);
+	}	
 	
-	GSPrintf(stderr, @"Number of nonbonded interactions inside cuttoff = %d.\n", incount);
-	GSPrintf(stderr, @"Number of nonbonded interactions outside cuttoff = %d.\n", outcount);
+	AdPairListFinalise(pairList);
+	numberOfInteractions = pairList->numberOfPairs;
+	free(indexBuffer);
+	free(partners);
 }
 
-- (void) update
+- (void) createList
 {
-	int j;
-	ListElement *holder, *list_p;
-	Vector3D seperation_s;
-	
-	if(!listCreated)
+	if(listCreated)
 		return;
-	
-	list_p = out_p->next;
-	while(list_p->next != NULL)
-	{
-		//calculate seperation of current bond
-		
-		for(j=0; j<3; j++)
-			seperation_s.vector[j] = coordinates->matrix[list_p->bond[0]][j] - coordinates->matrix[list_p->bond[1]][j];
-
-		//calculate the length of the seperation vector
 
-		Ad3DVectorLength(&seperation_s);
+	//Check if we have a system and interactions
+	if(system ==  nil || interactions == nil)
+		return;
 
-		if(seperation_s.length < cutoff)
-		{
-			//hold the address of the next element
-			
-			holder = list_p;
-			list_p = list_p->next;
-			
-			//remove the current element from the list
-			
-			AdUnsafeLinkedListRemove(holder);
-			holder->length = seperation_s.length;
-			AdUnsafeLinkedListAdd(holder, endin_p, 0);
-		}
-		else
-			list_p = list_p->next;
-	}
+	//Check if system and allowed pairs are compatible
+	if((int)[interactions count] >= coordinates->no_rows)
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Allowed pairs array implies more elements then are present in system."];
 
-	//check through the inside list for any interactions that are now outside the cutoff
-	//move to the first real element of inside
+	if(pairList == NULL)
+		pairList = AdAllocatePairList(coordinates->no_rows, 100*coordinates->no_rows);
 
-	list_p = in_p->next;
+	[self _buildList];
+	listCreated = YES;
 	
-	while(list_p->length > 0 && list_p->next != NULL )
-	{
-		if(list_p->length > cutoff)
-		{
-			//hold the address of the next element
-			
-			holder = list_p;
-			list_p = list_p->next;
-			
-			//remove the current element from the list
-			
-			AdUnsafeLinkedListRemove(holder);
-			AdUnsafeLinkedListAdd(holder, endout_p, 0);
-		}
-		else
-		{
-			list_p = list_p->next;
-		}
-	}
+	GSPrintf(stderr, @"Number of nonbonded interactions inside cuttoff = %d.\n", numberOfInteractions);
+}
 
-	numberOfInteractions = AdLinkedListCount(in_p) - 1;
+- (void) update
+{
+	if(!listCreated)
+		return;
+	
+	[self _buildList];
 
 	NSLog(@"Updated list - There are %d interactions", numberOfInteractions);
 
@@ -293,7 +279,7 @@ Accessors
 	BOOL invalidatedList = NO;
 
 	//Free lists if they exist
-	if(in_p != NULL)
+	if(pairList != NULL)
 	{
 		[self _freeLists];
 		invalidatedList = YES;
@@ -334,7 +320,7 @@ Accessors
 	BOOL invalidatedList = NO;
 
 	//Free lists if they exist
-	if(in_p != NULL)
+	if(pairList != NULL)
 	{
 		[self _freeLists];
 		invalidatedList = YES;
@@ -366,9 +352,9 @@ Accessors
 	return cutoff;
 }
 
-- (NSValue*) pairList
+- (AdPairList*) pairList
 {
-	return [NSValue valueWithPointer: in_p];
+	return pairList;
 }
 
 - (int) numberOfListElements
@@ -21,8 +21,197 @@
 */
 #include "AdunKernel/AdunSimulator.h"
 
+static SEL hookSelectors[5];
+
+/**
+Sends the message for the stage with index \e hook to the components acting at it.
+*/
+static inline void AdSendHook(int count, id* receivers, IMP* methods, int hook, id system)
+{
+	int i;
+
+	for(i=0; i<count; i++)
+		methods[i](receivers[i], hookSelectors[hook], system);
+}
+
+/**
+Places the acceleration arrays acting on the system of \e plan in plan->accelerations.
+The force fields may reallocate their matrices so this is done every step.
+*/
+static inline void AdLoadAccelerations(AdSystemIntegrationPlan* plan)
+{
+	int i;
+
+	for(i=0; i<plan->numberOfSources; i++)
+		plan->accelerations[i] = [plan->forceFields[i] accelerations]->matrix[plan->offsets[i]];
+}
+
 @implementation AdSimulator
 
++ (void) initialize
+{
+	hookSelectors[0] = @selector(simulatorWillPerformFirstVelocityUpdateForSystem:);
+	hookSelectors[1] = @selector(simulatorWillPerformPositionUpdateForSystem:);
+	hookSelectors[2] = @selector(simulatorDidPerformPositionUpdateForSystem:);
+	hookSelectors[3] = @selector(simulatorWillPerformSecondVelocityUpdateForSystem:);
+	hookSelectors[4] = @selector(simulatorDidPerformSecondVelocityUpdateForSystem:);
+}
+
+/*
+ * Integration plan
+ */
+
+- (void) _freeIntegrationPlan
+{
+	int i;
+
+	for(i=0; i<numberOfPlannedSystems; i++)
+	{
+		free(systemPlans[i].forceFields);
+		free(systemPlans[i].offsets);
+		free(systemPlans[i].accelerations);
+	}
+	free(systemPlans);
+	systemPlans = NULL;
+	numberOfPlannedSystems = 0;
+
+	for(i=0; i<5; i++)
+	{
+		free(hookComponents[i]);
+		free(hookMethods[i]);
+		hookComponents[i] = NULL;
+		hookMethods[i] = NULL;
+		hookCounts[i] = 0;
+	}
+
+	planIsValid = NO;
+}
+
+- (void) _invalidateIntegrationPlan: (NSNotification*) aNotification
+{
+	planIsValid = NO;
+}
+
+/**
+Adds the active force fields of \e aSystem to \e forceFieldArray and \e offset to
+\e offsetArray for each one.
+*/
+- (void) _addForceFieldsOfSystem: (id) aSystem
+		offset: (int) offset
+		toArray: (NSMutableArray*) forceFieldArray
+		offsets: (NSMutableArray*) offsetArray
+{
+	NSEnumerator* forceFieldEnum;
+	id forceField;
+
+	forceFieldEnum = [[forceFieldCollection forceFieldsForSystem: aSystem
+				activityFlag: AdActiveForceFields]
+				objectEnumerator];
+	while((forceField = [forceFieldEnum nextObject]))
+	{
+		[forceFieldArray addObject: forceField];
+		[offsetArray addObject: [NSNumber numberWithInt: offset]];
+	}
+}
+
+- (void) buildIntegrationPlan
+{
+	int i, j, hook, numberOfSources;
+	unsigned int hooks;
+	NSMutableArray* forceFieldArray, *offsetArray;
+	NSEnumerator* interactionSystemEnum, *componentEnum;
+	AdSystemIntegrationPlan* plan;
+	id system, interactionSystem, component;
+
+	[self _freeIntegrationPlan];
+
+	numberOfPlannedSystems = [systems count];
+	systemPlans = (AdSystemIntegrationPlan*)malloc(numberOfPlannedSystems*sizeof(AdSystemIntegrationPlan));
+	forceFieldArray = [NSMutableArray array];
+	offsetArray = [NSMutableArray array];
+	for(i=0; i<numberOfPlannedSystems; i++)
+	{
+		system = [systems objectAtIndex: i];
+		[forceFieldArray removeAllObjects];
+		[offsetArray removeAllObjects];
+
+		//Intra-System Forces
+		[self _addForceFieldsOfSystem: system
+			offset: 0
+			toArray: forceFieldArray
+			offsets: offsetArray];
+
+		//Inter-System Forces - Taking care of offsets
+		interactionSystemEnum = [[systemCollection interactionSystemsInvolvingSystem: system]
+						objectEnumerator];
+		while((interactionSystem = [interactionSystemEnum nextObject]))
+			[self _addForceFieldsOfSystem: interactionSystem
+				offset: [interactionSystem rangeForSystem: system].location
+				toArray: forceFieldArray
+				offsets: offsetArray];
+
+		numberOfSources = [forceFieldArray count];
+		plan = systemPlans + i;
+		plan->system = system;
+		plan->numberOfSources = numberOfSources;
+		plan->forceFields = (id*)malloc((numberOfSources + 1)*sizeof(id));
+		plan->offsets = (int*)malloc((numberOfSources + 1)*sizeof(int));
+		plan->accelerations = (double**)malloc((numberOfSources + 1)*sizeof(double*));
+		for(j=0; j<numberOfSources; j++)
+		{
+			plan->forceFields[j] = [forceFieldArray objectAtIndex: j];
+			plan->offsets[j] = [[offsetArray objectAtIndex: j] intValue];
+		}
+
+		NSDebugLLog(@"AdSimulator", @"System %@ - %d acceleration sources",
+			[system systemName], numberOfSources);
+	}
+
+	//Components which don't specify their stages act at all of them
+	for(hook=0; hook<5; hook++)
+	{
+		hookComponents[hook] = (id*)malloc(([components count] + 1)*sizeof(id));
+		hookMethods[hook] = (IMP*)malloc(([components count] + 1)*sizeof(IMP));
+		hookCounts[hook] = 0;
+	}
+
+	componentEnum = [components objectEnumerator];
+	while((component = [componentEnum nextObject]))
+	{
+		hooks = AdSimulatorAllHooks;
+		if([component respondsToSelector: @selector(simulatorHooks)])
+			hooks = [component simulatorHooks];
+
+		for(hook=0; hook<5; hook++)
+		{
+			if(hooks & (1 << hook))
+			{
+				hookComponents[hook][hookCounts[hook]] = component;
+				hookMethods[hook][hookCounts[hook]] = [component methodForSelector: hookSelectors[hook]];
+				hookCounts[hook]++;
+			}
+		}
+	}
+
+	planIsValid = YES;
+}
+
+- (void) notifyComponentsOfHook: (AdSimulatorHook) hook forSystem: (AdSystem*) aSystem
+{
+	int index;
+
+	for(index = 0; index < 5; index++)
+		if(hook == (1 << index))
+			break;
+
+	if(index < 5)
+		AdSendHook(hookCounts[index],
+			hookComponents[index],
+			hookMethods[index],
+			index,
+			aSystem);
+}
+
 - (void) emptyPool
 {
 	[pool release];
@@ -117,11 +306,28 @@
 				[NSException raise: NSInvalidArgumentException
 					format: @"All components must conform to AdSimulatorComponent"];
 		
-		components = [anArray copy];
+		components = [anArray mutableCopy];
 		timer = [AdMainLoopTimer mainLoopTimer];	
 	
 		[self setForceFields: aForceFieldCollection];
 		[self setSystems: aSystemCollection];
+
+		//Any change to the topology of the simulated systems invalidates the integration plan
+		[[NSNotificationCenter defaultCenter]
+			addObserver: self
+			selector: @selector(_invalidateIntegrationPlan:)
+			name: AdSystemContentsDidChangeNotification
+			object: nil];
+		[[NSNotificationCenter defaultCenter]
+			addObserver: self
+			selector: @selector(_invalidateIntegrationPlan:)
+			name: AdSystemStatusDidChangeNotification
+			object: nil];
+		[[NSNotificationCenter defaultCenter]
+			addObserver: self
+			selector: @selector(_invalidateIntegrationPlan:)
+			name: AdForceFieldCollectionDidChangeNotification
+			object: nil];
 	}	
 	
 	return self;
@@ -129,6 +335,8 @@
 
 - (void) dealloc
 {	
+	[[NSNotificationCenter defaultCenter] removeObserver: self];
+	[self _freeIntegrationPlan];
 	[systems release];
 	[systemCollection release];
 	[forceFieldCollection release];
@@ -162,12 +370,11 @@
 
 - (void) _simulateFrom: (int) start to: (int) end
 {
-	register int j, k;
-	int numberOfAtoms, offset;
-	AdMatrix* coordinates, *accelerations, *velocities;
-	NSString* name;
-	NSEnumerator *systemEnum, *interactionSystemEnum, *forceFieldEnum, *componentEnum;
-	id system, interactionSystem, forceField, component;
+	int i;
+	AdMatrix* coordinates, *velocities;
+	AdSystemIntegrationPlan* plan;
+	NSEnumerator *componentEnum;
+	id system, component;
 	
 	pool = [[NSAutoreleasePool alloc] init];
 	
@@ -188,133 +395,95 @@
 		interval: checkFPErrorInterval
 		name: @"FloatingPointErrors"];
 
+	//The components may have changed the systems so the plan is built after notifying them
+	[self buildIntegrationPlan];
+
 	for(currentStep=start; currentStep < end; currentStep++)
 	{
 		NSDebugLLog(@"SimulationLoop",
 			@"\nBeginning numerical integration - step %d", 
 			currentStep);
 
-		systemEnum = [systems objectEnumerator];
-		while((system = [systemEnum nextObject]))
+		if(!planIsValid)
+			[self buildIntegrationPlan];
+
+		for(i=0; i<numberOfPlannedSystems; i++)
 		{
-			name = [system systemName];
+			plan = systemPlans + i;
+			system = plan->system;
 			coordinates = [system coordinates];
 			velocities = [system velocities];
 
 			/*** First Step ***/
 
-			[components makeObjectsPerformSelector: 
-				@selector(simulatorWillPerformFirstVelocityUpdateForSystem:)
-				withObject: system];
-
-			numberOfAtoms = coordinates->no_rows;
+			AdSendHook(hookCounts[0], hookComponents[0], hookMethods[0], 0, system);
+			AdLoadAccelerations(plan);
 
-			//Intra-System Forces
-			forceFieldEnum = [[forceFieldCollection forceFieldsForSystem: system
-						activityFlag: AdActiveForceFields]
-						objectEnumerator];
+			/*** Second Step ***/
 
+			//If no component acts between the velocity and position updates
+			//they are performed in one pass.
 			[system object: self willBeginWritingToMatrix: velocities]; 
-			while((forceField = [forceFieldEnum nextObject]))
+			if(hookCounts[1] == 0)
 			{
-				accelerations = [forceField accelerations];
-				for(j=0; j < numberOfAtoms; j++)
-					for(k=0; k<3; k++)
-						velocities->matrix[j][k] +=  accelerations->matrix[j][k]*halfTimeStep;
+				[system object: self willBeginWritingToMatrix: coordinates]; 
+				AdUpdateVelocitiesAndPositions(velocities->matrix[0],
+					coordinates->matrix[0],
+					plan->accelerations,
+					plan->numberOfSources,
+					coordinates->no_rows,
+					halfTimeStep,
+					timeStep);
+				[system object: self didFinishWritingToMatrix: velocities]; 
 			}
-
-			//Inter-System Forces - Taking care of offsets
-			//FIXME: Precompute for each system
-			interactionSystemEnum = [[systemCollection interactionSystemsInvolvingSystem: system]
-							objectEnumerator];
-			while((interactionSystem = [interactionSystemEnum nextObject]))
+			else
 			{
-				forceFieldEnum = [[forceFieldCollection forceFieldsForSystem: interactionSystem
-							activityFlag: AdActiveForceFields]
-							objectEnumerator];
-				//Get the offset into the acceleration matrix of 
-				//the interactionSystem for this system		
-				offset = [interactionSystem rangeForSystem: system].location;		
-				while((forceField = [forceFieldEnum nextObject]))
-				{
-					accelerations = [forceField accelerations];
-					for(j=0; j < numberOfAtoms; j++)
-						for(k=0; k<3; k++)
-							velocities->matrix[j][k] +=  accelerations->matrix[j+offset][k]*halfTimeStep;
-				}			
+				AdUpdateVelocities(velocities->matrix[0],
+					plan->accelerations,
+					plan->numberOfSources,
+					velocities->no_rows,
+					halfTimeStep);
+				[system object: self didFinishWritingToMatrix: velocities]; 
+				
+				AdSendHook(hookCounts[1], hookComponents[1], hookMethods[1], 1, system);
+				[system object: self willBeginWritingToMatrix: coordinates]; 
+				AdUpdatePositions(coordinates->matrix[0],
+					velocities->matrix[0],
+					coordinates->no_rows,
+					timeStep);
 			}
-			[system object: self didFinishWritingToMatrix: velocities]; 
-
-			/*** Second Step ***/
-					
-			[components makeObjectsPerformSelector: 
-				@selector(simulatorWillPerformPositionUpdateForSystem:)
-				withObject: system];
-			[system object: self willBeginWritingToMatrix: coordinates]; 
-			for(k=0; k < numberOfAtoms; k++)
-				for(j=0; j< 3; j++)	
-					coordinates->matrix[k][j] += velocities->matrix[k][j]*timeStep;
 
+			//Molecules leaving a periodic box reenter on the other side
+			[system wrapCoordinatesIntoPeriodicBox];
 			[system object: self didFinishWritingToMatrix: coordinates]; 
 			
-			[components makeObjectsPerformSelector: 
-				@selector(simulatorDidPerformPositionUpdateForSystem:)
-				withObject: system];
+			AdSendHook(hookCounts[2], hookComponents[2], hookMethods[2], 2, system);
 		}
 
 		[forceFieldCollection evaluateForces];
+
+		//Force evaluation can change the systems e.g. if elements are removed
+		if(!planIsValid)
+			[self buildIntegrationPlan];
 		
-		systemEnum = [systems objectEnumerator];
-		while((system = [systemEnum nextObject]))
+		for(i=0; i<numberOfPlannedSystems; i++)
 		{
-			name = [system systemName];
+			plan = systemPlans + i;
+			system = plan->system;
 			velocities = [system velocities];
-			numberOfAtoms = [system numberOfElements];
 
 			/*** Final Step ***/
 	
-			[components makeObjectsPerformSelector: 
-				@selector(simulatorWillPerformSecondVelocityUpdateForSystem:)
-				withObject: system];
-				
-			//Intra-System Forces
-			forceFieldEnum = [[forceFieldCollection forceFieldsForSystem: system]
-						objectEnumerator];
-			
+			AdSendHook(hookCounts[3], hookComponents[3], hookMethods[3], 3, system);
+			AdLoadAccelerations(plan);
 			[system object: self willBeginWritingToMatrix: velocities]; 
-			while((forceField = [forceFieldEnum nextObject]))
-			{
-				accelerations = [forceField accelerations];
-				for(j=0; j < numberOfAtoms; j++)
-					for(k=0; k<3; k++)
-						velocities->matrix[j][k] +=  accelerations->matrix[j][k]*halfTimeStep;
-			}
-
-			//Inter-System Forces
-			//FIXME: Precompute for each system
-			interactionSystemEnum = [[systemCollection interactionSystemsInvolvingSystem: system]
-							objectEnumerator];
-			while((interactionSystem = [interactionSystemEnum nextObject]))
-			{
-				forceField = [[forceFieldCollection forceFieldsForSystem: interactionSystem
-						activityFlag: AdActiveForceFields]
-						objectEnumerator];
-				while((forceField = [forceFieldEnum nextObject]))
-				{
-					accelerations = [forceField accelerations];
-					offset = [interactionSystem rangeForSystem: system].location;		
-					for(j=0; j < numberOfAtoms; j++)
-						for(k=0; k<3; k++)
-							velocities->matrix[j][k] +=  accelerations->matrix[j+offset][k]*halfTimeStep;
-				}			
-
-			}
-
+			AdUpdateVelocities(velocities->matrix[0],
+				plan->accelerations,
+				plan->numberOfSources,
+				velocities->no_rows,
+				halfTimeStep);
 			[system object: self didFinishWritingToMatrix: velocities]; 
-			
-			[components makeObjectsPerformSelector: 
-				@selector(simulatorDidPerformSecondVelocityUpdateForSystem:)
-				withObject: system];
+			AdSendHook(hookCounts[4], hookComponents[4], hookMethods[4], 4, system);
 		}
 		
 		[timer increment];
@@ -468,6 +637,7 @@
         systemCollection = [aCollection retain];
 	systems = [systemCollection fullSystems];
 	[systems retain];		
+	planIsValid = NO;
 }
 
 - (AdForceFieldCollection*) forceFields
@@ -479,6 +649,7 @@
 {
 	[forceFieldCollection release];
 	forceFieldCollection = [object retain];
+	planIsValid = NO;
 }
 
 - (void) addComponent: (id) anObject
@@ -488,11 +659,13 @@
 			format: @"Only object conforming to AdSystemComponent can be added as components"];
 
 	[components addObject: anObject];
+	planIsValid = NO;
 }
 
 - (void) removeComponent: (id) anObject
 {
 	[components removeObject: anObject];
+	planIsValid = NO;
 }
 
 - (NSArray*) allComponents
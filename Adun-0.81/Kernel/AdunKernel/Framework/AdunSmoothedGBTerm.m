@@ -20,8 +20,8 @@
  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
  */
 #include "AdunKernel/AdunSmoothedGBTerm.h"
-//Necessary to include definition of interactionList.
-//There should be a superclass for the nonbonded terms using the AdLinkedList and AdCellHandler.
+//Necessary to include definition of pairList.
+//There should be a superclass for the nonbonded terms using the AdPairList and AdCellHandler.
 #include "AdunKernel/AdunPureNonbondedTerm.h"
 
 static NSDictionary* coefficients;
@@ -41,6 +41,7 @@ static NSDictionary* coefficients;
 	generalizedBornRadiiDict = [NSDictionary dictionaryWithContentsOfFile:
 		[path stringByAppendingPathComponent: @"PBBornRadii.plist"]];
 	[generalizedBornRadiiDict retain];	
+	[self _initQuadratureGrids];
 }
 
 - (void) _precomputeConstants
@@ -74,7 +75,7 @@ static NSDictionary* coefficients;
 		//Initialise some ivars
 		integrationStartPoint = 0.5;	//Following Im et al.
 		meshSize = 1.0;			//Better for identifying complete overlaps
-		cutBuffer = 0.0;
+		cutBuffer = 0.2;		//Atoms can move this far before the lookup table changes
 		totalPairESTPotential = totalPairESTPotential = totalNonpolarPotential = 0;
 		memoryManager = [AdMemoryManager appMemoryManager];
 		
@@ -88,6 +89,8 @@ static NSDictionary* coefficients;
 		
 		//Forces
 		forces = [memoryManager allocateMatrixWithRows: numberOfAtoms withColumns: 3];
+		numberOfThreads = AdDefaultNumberOfThreads();
+		threadBuffers = NULL;
 		
 		//Hard coded number of points to make their generation initialy easier.
 		numberRadialPoints = 24;
@@ -199,6 +202,21 @@ static NSDictionary* coefficients;
 	return totalPairESTPotential;
 }
 
+- (int) numberOfThreads
+{
+	return numberOfThreads;
+}
+
+- (void) setNumberOfThreads: (int) number
+{
+	if(number < 1)
+		number = 1;
+
+	[self _cleanUpThreadBuffers];
+	numberOfThreads = number;
+	[self _initThreadBuffers];
+}
+
 - (AdDataMatrix*) selfEnergyData
 {
 	int i;
@@ -294,49 +312,50 @@ static NSDictionary* coefficients;
 
 - (void) evaluateForces
 {
-	int i,j;
+	int i, j, k, numberOfParts;
 	int atomOne, atomTwo;
 	double factor, charge, bornRadius, magnitude;
 	double valueOne, valueTwo, separation;
-	double** coordinates, *array;
-	ListElement* list_p, *interactionList=NULL;
+	double** coordinates, *array, *threadForces;
+	AdPairList* pairList=NULL;
 	
 	AdSetDoubleMatrixWithValue(forces, 0.0);
 	AdSetDoubleMatrixWithValue(selfGradients, 0.0);
 	coordinates = [system coordinates]->matrix;
 	
 	//FIMXE: Check if the term responds to this on set.
-	interactionList = [nonbondedTerm interactionList];
+	pairList = [nonbondedTerm pairList];
 		
 	totalPairESTPotential = 0;
-	if(interactionList != NULL)
+	if(pairList != NULL)
+		AdGBEPairListSeparationDerivative(pairList, coordinates, forces->matrix, 
+					  bornRadii, cutoff, &totalPairESTPotential);
+	
+	//Derivatives of the pairwise temrs w.r.t. the atoms born radius and its
+	//position. d(delta G_{ab})/dRa * dRa/drb where b can be equal to a.
+	//The first part of the loop adds its forces directly to the forces matrix.
+	//The forces of the others are added here and their matrices cleared for the next evaluation.
+	numberOfParts = [self _runAtomLoop: @selector(_calculateDerivativesWithRespectToAtom:buffers:)];
+	for(k=1; k<numberOfParts; k++)
 	{
-		list_p = interactionList->next;
-		while(list_p->next != NULL)
+		threadForces = threadBuffers[k].forces->matrix[0];
+		array = forces->matrix[0];
+		for(i=0; i<3*numberOfAtoms; i++)
 		{
-			if(list_p->length < cutoff)
-			{
-				AdGBESeparationDerivative(list_p, coordinates, forces->matrix, 
-							  bornRadii, &totalPairESTPotential);
-			}
-			
-			list_p = list_p->next;
+			array[i] += threadForces[i];
+			threadForces[i] = 0;
 		}
 	}
-	
+		
 	//Now add the self terms for each atom.
 	//The first term is the derivative of the atoms self-energy
 	//The second term is the sum of self-force for each interaction
 	//the atom was involved in.
 	//This is the sum of the coefficents of the self-force mulitplied by the self-gradient.
-		
+
 	factor =  0.5*tau*PI4EP_R;
 	for(i=0; i<numberOfAtoms; i++)
 	{
-		//Derivatives of the pairwise temrs w.r.t. the atoms born radius and its
-		//position. d(delta G_{ab})/dRa * dRa/drb where b can be equal to a
-		[self _calculateDerivativesWithRespectToAtom: i];
-				
 		//Derivative of the self energy
 		array = selfGradients->matrix[i];
 		charge = charges[i];
@@ -359,15 +378,15 @@ static NSDictionary* coefficients;
 - (void) evaluateEnergy
 {
 	double** coordinates;
-	ListElement* list_p, *interactionList=NULL;
+	AdPairList* pairList=NULL;
 
 	totalPairESTPotential = 0;
 
 	//The self-energy is calculated every time the born radii are updated.
 	
 	//FIXME: Move
-	if([nonbondedTerm respondsToSelector: @selector(interactionList)])
-		interactionList = [nonbondedTerm interactionList];
+	if([nonbondedTerm respondsToSelector: @selector(pairList)])
+		pairList = [nonbondedTerm pairList];
 	else
 	{
 		NSWarnLog(@"GB - Nonbonded term does not provide a nonbonded interaction list.");
@@ -378,21 +397,13 @@ static NSDictionary* coefficients;
 	//We iterate over the same nonbonded list as used by the solute nonbonded term.	
 	
 	coordinates = [system coordinates]->matrix;
-	if(interactionList != NULL)
+	if(pairList != NULL)
 	{
-		list_p = interactionList->next;
-		while(list_p->next != NULL)
-		{
-			if(list_p->length < cutoff)
-			{
-				AdGeneralizedBornEnergy(list_p, 
-							coordinates, 
-							bornRadii, 
-							&totalPairESTPotential);	
-			}
-				
-			list_p = list_p->next;
-		}
+		AdGeneralizedBornPairListEnergy(pairList, 
+					coordinates, 
+					bornRadii, 
+					cutoff,
+					&totalPairESTPotential);	
 	}
 	
 	NSDebugLLog(@"AdSmoothedGBTerm",
@@ -20,7 +20,9 @@
    Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 */
 #include "AdunKernel/AdunSystem.h"
+#include "AdunKernel/AdunSystemMemento.h"
 #include "AdunKernel/AdDataSources.h"
+#include "AdunKernel/AdunCuboidBox.h"
 
 @implementation AdSystem
 
@@ -166,6 +168,38 @@
 	return [dynamics centreOfMass];
 }
 
+- (id) periodicBox
+{
+	id cavity;
+
+	if(![dataSource respondsToSelector: @selector(cavity)])
+		return nil;
+
+	cavity = [dataSource cavity];
+	if([cavity isKindOfClass: [AdCuboidBox class]] && [cavity isPeriodic])
+		return cavity;
+
+	return nil;
+}
+
+- (void) wrapCoordinatesIntoPeriodicBox
+{
+	int groupSize;
+	id box;
+	AdPeriodicBox periodicBox;
+
+	if((box = [self periodicBox]) == nil)
+		return;
+
+	if([dataSource respondsToSelector: @selector(atomsPerMolecule)])
+		groupSize = [dataSource atomsPerMolecule];
+	else
+		groupSize = [self numberOfElements];
+
+	[box getPeriodicBox: &periodicBox];
+	AdWrapCoordinates([dynamics coordinates], groupSize, &periodicBox);
+}
+
 - (AdMatrix*) coordinates
 {
 	return [dynamics coordinates];
@@ -237,6 +271,24 @@
 	AdMatrix* matrixStruct;
 	AdDataMatrix* matrix;
 
+	//Mementos created by this version contain the raw matrices
+	//which can be copied directly.
+	if([stateMemento isKindOfClass: [AdSystemMemento class]])
+	{
+		captureMask = [stateMemento captureMask];
+		if(captureMask != 0 && [stateMemento numberOfElements] != (int)[self numberOfElements])
+			[NSException raise: NSInternalInconsistencyException
+				format: @"Memento provided is not of correct dimension"];
+
+		if((captureMask & AdSystemCoordinatesMemento))
+			[self setCoordinates: [stateMemento coordinates]];
+
+		if((captureMask & AdSystemVelocitiesMemento))
+			[self setVelocities: [stateMemento velocities]];
+
+		return;
+	}
+
 	//check if this memento is valid for this object.
 	
 	if(![[stateMemento name] isEqual: @"AdSystemMemento"])
@@ -278,35 +330,7 @@
 
 - (id) captureState;
 {
-	AdDataSet* mementoData;
-	AdDataMatrix* matrix;
-
-	mementoData = [[AdDataSet alloc] 
-			initWithName: @"AdSystemMemento"];
-	[mementoData setValue: [NSNumber numberWithInt: mementoMask]
-		forMetadataKey: @"MementoMask"];
-	
-	if((mementoMask & AdSystemCoordinatesMemento))
-	{
-		matrix = [[AdDataMatrix alloc]
-				initWithADMatrix: [dynamics coordinates] 
-				columnHeaders: nil
-				name: @"Coordinates"];
-		[matrix autorelease];
-		[mementoData addDataMatrix: matrix];
-	}
-	
-	if((mementoMask & AdSystemVelocitiesMemento))
-	{
-		matrix = [[AdDataMatrix alloc]
-				initWithADMatrix: [dynamics velocities]
-				columnHeaders: nil
-				name: @"Velocities"];
-		[matrix autorelease];
-		[mementoData addDataMatrix: matrix];
-	}
-
-	return [mementoData autorelease];
+	return [AdSystemMemento mementoWithSystem: self];
 }
 
 - (BOOL) validateMemento: (id) aMemento
@@ -394,6 +418,16 @@
 	return [dynamics degreesOfFreedom];
 }
 
+- (void) setNumberOfConstraints: (unsigned int) number
+{
+	[dynamics setNumberOfConstraints: number];
+}
+
+- (unsigned int) numberOfConstraints
+{
+	return [dynamics numberOfConstraints];
+}
+
 - (unsigned int) numberOfElements
 {
 	return [dataSource numberOfElements];
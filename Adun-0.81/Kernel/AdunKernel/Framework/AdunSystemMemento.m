@@ -0,0 +1,364 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#include "AdunKernel/AdunSystemMemento.h"
+#include "AdunKernel/AdunSystem.h"
+
+/**
+Copies \e source into \e destination which must have the same dimensions.
+Matrices allocated by AdMemoryManager are contiguous and are copied in one go.
+*/
+static void AdCopyMatrixContents(AdMatrix* source, AdMatrix* destination)
+{
+	int i, rows, columns;
+
+	rows = source->no_rows;
+	columns = source->no_columns;
+	if(rows == 0)
+		return;
+
+	if((source->matrix[rows - 1] == source->matrix[0] + (rows - 1)*columns) &&
+		(destination->matrix[rows - 1] == destination->matrix[0] + (rows - 1)*columns))
+	{
+		memcpy(destination->matrix[0], source->matrix[0], rows*columns*sizeof(double));
+	}
+	else
+	{
+		for(i=0; i<rows; i++)
+			memcpy(destination->matrix[i], source->matrix[i], columns*sizeof(double));
+	}
+}
+
+/*
+A matrix shared by copies of a memento.
+shareCount is the number of mementos using the buffer. It is only changed through
+AdShareBuffer() and AdUnshareBuffer() which update it atomically, so whether a buffer
+is shared does not depend on other retains of the object e.g. by autorelease pools.
+*/
+@interface AdMementoBuffer: NSObject
+{
+	@public
+	volatile int shareCount;
+	AdMatrix* matrix;
+}
+- (id) initWithNumberOfRows: (int) rows;
+- (id) initWithMatrix: (AdMatrix*) aMatrix;
+@end
+
+@implementation AdMementoBuffer
+
+- (id) initWithNumberOfRows: (int) rows
+{
+	if((self = [super init]))
+	{
+		shareCount = 1;
+		matrix = [[AdMemoryManager appMemoryManager]
+				allocateMatrixWithRows: rows
+				withColumns: 3];
+	}
+
+	return self;
+}
+
+- (id) initWithMatrix: (AdMatrix*) aMatrix
+{
+	if((self = [super init]))
+	{
+		shareCount = 1;
+		matrix = [[AdMemoryManager appMemoryManager]
+				allocateMatrixWithRows: aMatrix->no_rows
+				withColumns: aMatrix->no_columns];
+		AdCopyMatrixContents(aMatrix, matrix);
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[[AdMemoryManager appMemoryManager] freeMatrix: matrix];
+	[super dealloc];
+}
+
+@end
+
+//Returns buffer after adding a memento to the ones sharing it.
+static inline id AdShareBuffer(AdMementoBuffer* buffer)
+{
+	if(buffer == nil)
+		return nil;
+
+	__sync_fetch_and_add(&buffer->shareCount, 1);
+	return [buffer retain];
+}
+
+//Removes a memento from the ones sharing buffer.
+static inline void AdUnshareBuffer(AdMementoBuffer* buffer)
+{
+	if(buffer == nil)
+		return;
+
+	__sync_fetch_and_sub(&buffer->shareCount, 1);
+	[buffer release];
+}
+
+//Returns a buffer only used by the caller with the contents of buffer.
+//If buffer is shared the caller's share is replaced by a new copy.
+static id AdUnsharedBuffer(AdMementoBuffer* buffer)
+{
+	AdMementoBuffer* copy;
+
+	if(__sync_fetch_and_add(&buffer->shareCount, 0) == 1)
+		return buffer;
+
+	copy = [[AdMementoBuffer alloc] initWithMatrix: buffer->matrix];
+	AdUnshareBuffer(buffer);
+
+	return copy;
+}
+
+@implementation AdSystemMemento
+
++ (id) mementoWithSystem: (id) system
+{
+	return [[[AdSystemMemento alloc]
+			initWithSystem: system] autorelease];
+}
+
+- (id) initWithSystem: (id) system
+{
+	return [self initWithSystemName: [system systemName]
+		captureMask: [system captureMask]
+		coordinates: [system coordinates]
+		velocities: [system velocities]
+		numberOfElements: [system numberOfElements]];
+}
+
+- (id) initWithSystemName: (NSString*) aString
+	captureMask: (int) mask
+	coordinates: (AdMatrix*) coordinates
+	velocities: (AdMatrix*) velocities
+	numberOfElements: (int) numberOfElements
+{
+	if((self = [super init]))
+	{
+		captureMask = mask & (AdSystemCoordinatesMemento | AdSystemVelocitiesMemento);
+		systemName = [aString copy];
+
+		if((captureMask & AdSystemCoordinatesMemento))
+		{
+			if(coordinates != NULL)
+				coordinatesBuffer = [[AdMementoBuffer alloc]
+							initWithMatrix: coordinates];
+			else
+				coordinatesBuffer = [[AdMementoBuffer alloc]
+							initWithNumberOfRows: numberOfElements];
+		}
+
+		if((captureMask & AdSystemVelocitiesMemento))
+		{
+			if(velocities != NULL)
+				velocitiesBuffer = [[AdMementoBuffer alloc]
+							initWithMatrix: velocities];
+			else
+				velocitiesBuffer = [[AdMementoBuffer alloc]
+							initWithNumberOfRows: numberOfElements];
+		}
+	}
+
+	return self;
+}
+
+- (id) init
+{
+	return [self initWithSystemName: nil
+		captureMask: 0
+		coordinates: NULL
+		velocities: NULL
+		numberOfElements: 0];
+}
+
+- (void) dealloc
+{
+	[systemName release];
+	AdUnshareBuffer(coordinatesBuffer);
+	AdUnshareBuffer(velocitiesBuffer);
+	[super dealloc];
+}
+
+- (id) copyWithZone: (NSZone*) zone
+{
+	AdSystemMemento* copy;
+
+	//The copy shares the buffers until one of them is modified
+	copy = [[AdSystemMemento allocWithZone: zone]
+			initWithSystemName: systemName
+			captureMask: 0
+			coordinates: NULL
+			velocities: NULL
+			numberOfElements: 0];
+	copy->captureMask = captureMask;
+	copy->coordinatesBuffer = AdShareBuffer(coordinatesBuffer);
+	copy->velocitiesBuffer = AdShareBuffer(velocitiesBuffer);
+
+	return copy;
+}
+
+- (NSString*) description
+{
+	return [NSString stringWithFormat: @"AdSystemMemento for %@. Elements %d. Mask %d",
+		systemName, [self numberOfElements], captureMask];
+}
+
+/*
+ * Accessors
+ */
+
+- (NSString*) systemName
+{
+	return [[systemName retain] autorelease];
+}
+
+- (int) captureMask
+{
+	return captureMask;
+}
+
+- (int) numberOfElements
+{
+	if(coordinatesBuffer != nil)
+		return ((AdMementoBuffer*)coordinatesBuffer)->matrix->no_rows;
+	else if(velocitiesBuffer != nil)
+		return ((AdMementoBuffer*)velocitiesBuffer)->matrix->no_rows;
+
+	return 0;
+}
+
+- (AdMatrix*) coordinates
+{
+	if(coordinatesBuffer == nil)
+		return NULL;
+
+	return ((AdMementoBuffer*)coordinatesBuffer)->matrix;
+}
+
+- (AdMatrix*) velocities
+{
+	if(velocitiesBuffer == nil)
+		return NULL;
+
+	return ((AdMementoBuffer*)velocitiesBuffer)->matrix;
+}
+
+- (AdMatrix*) mutableCoordinates
+{
+	if(coordinatesBuffer == nil)
+		return NULL;
+
+	coordinatesBuffer = AdUnsharedBuffer(coordinatesBuffer);
+	return [self coordinates];
+}
+
+- (AdMatrix*) mutableVelocities
+{
+	if(velocitiesBuffer == nil)
+		return NULL;
+
+	velocitiesBuffer = AdUnsharedBuffer(velocitiesBuffer);
+	return [self velocities];
+}
+
+/*
+ * AdDataSet compatibility
+ */
+
+- (NSString*) name
+{
+	return @"AdSystemMemento";
+}
+
+- (id) valueForMetadataKey: (NSString*) key
+{
+	if([key isEqual: @"MementoMask"])
+		return [NSNumber numberWithInt: captureMask];
+
+	return nil;
+}
+
+- (AdDataMatrix*) dataMatrixWithName: (NSString*) aString
+{
+	AdMatrix* matrix = NULL;
+
+	if([aString isEqual: @"Coordinates"])
+		matrix = [self coordinates];
+	else if([aString isEqual: @"Velocities"])
+		matrix = [self velocities];
+
+	if(matrix == NULL)
+		return nil;
+
+	return [[[AdDataMatrix alloc]
+			initWithADMatrix: matrix
+			columnHeaders: nil
+			name: aString] autorelease];
+}
+
+- (AdDataSet*) dataSet
+{
+	AdDataSet* mementoData;
+
+	mementoData = [[AdDataSet alloc]
+			initWithName: @"AdSystemMemento"];
+	[mementoData setValue: [NSNumber numberWithInt: captureMask]
+		forMetadataKey: @"MementoMask"];
+
+	if((captureMask & AdSystemCoordinatesMemento))
+		[mementoData addDataMatrix:
+			[self dataMatrixWithName: @"Coordinates"]];
+
+	if((captureMask & AdSystemVelocitiesMemento))
+		[mementoData addDataMatrix:
+			[self dataMatrixWithName: @"Velocities"]];
+
+	return [mementoData autorelease];
+}
+
+/*
+ * Archiving - Mementos are archived as the equivalent AdDataSet
+ * so the archives can be read by earlier versions.
+ */
+
+- (Class) classForCoder
+{
+	return [AdDataSet class];
+}
+
+- (id) replacementObjectForCoder: (NSCoder*) encoder
+{
+	return [self dataSet];
+}
+
+- (id) replacementObjectForKeyedArchiver: (NSKeyedArchiver*) archiver
+{
+	return [self dataSet];
+}
+
+@end
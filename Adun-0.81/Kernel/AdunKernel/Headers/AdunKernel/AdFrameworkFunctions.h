@@ -5,6 +5,7 @@
 #include <Foundation/Foundation.h>
 #include "AdunKernel/AdunSystem.h"
 #include <Base/AdVector.h>
+#include <Base/AdTrajectoryFrame.h>
 #include "AdunKernel/AdunDefinitions.h"
 #include "AdunKernel/AdunDataMatrix.h"
 
@@ -146,6 +147,60 @@ Raises an NSInvalidArgumentException if type is not A or B
 */
 inline double AdCalculateVDWRadii(double paramOne, double paramTwo, NSString* type);
 
+/**
+Encodes the state of each AdSystem in \e systems as a binary trajectory frame (see \ref trajectoryFrame).
+What is stored for each system is determined by its capture mask.
+\e precision is the number of values per Angstrom used by AdFrameCompressedEncoding.
+AdFrameCompressedEncoding is only applied to coordinates. Velocities are stored as float32 in compressed frames 
+so they keep about seven significant digits.
+*/
+NSMutableData* AdEncodeTrajectoryFrame(NSArray* systems, AdFrameEncoding encoding, double precision);
+/**
+As AdEncodeTrajectoryFrame() but the data of system \e i is given by entry \e i of
+\e systemNames, \e masks, \e coordinates and \e velocities. 
+The matrices need only be valid if the corresponding bit of the mask is set.
+Can be used to encode copies of the state of a set of systems on another thread.
+*/
+NSMutableData* AdEncodeTrajectoryFrameFromMatrices(NSArray* systemNames, int* masks,
+	AdMatrix** coordinates, AdMatrix** velocities,
+	AdFrameEncoding encoding, double precision);
+/**
+As AdEncodeTrajectoryFrame() but the data of each system is given by the AdSystemMemento objects in \e mementos.
+The mementos can be encoded on any thread.
+*/
+NSMutableData* AdEncodeTrajectoryFrameFromMementos(NSArray* mementos, 
+	AdFrameEncoding encoding, double precision);
+/**
+Reads the trajectory frame encoding and precision from the \e TrajectoryFrameEncoding and
+\e TrajectoryCompressionPrecision defaults. Returns NO if the encoding is \e XML.
+See AdCreateTrajectoryCheckpoint().
+*/
+BOOL AdTrajectoryFrameEncodingFromDefaults(AdFrameEncoding* encoding, double* precision);
+/**
+Creates a trajectory checkpoint containing the state of each AdSystem in \e systems.
+The format is given by the \e TrajectoryFrameEncoding default which can be \e Float64 (the default),
+\e Float32, \e Compressed or \e XML. The last creates a keyed archive of the system mementos, the format used by
+earlier versions. The precision of the compressed format is given by the \e TrajectoryCompressionPrecision default.
+Note that \e Compressed frames store velocities as float32 and so lose precision even when the
+compression precision is high.
+*/
+NSMutableData* AdCreateTrajectoryCheckpoint(NSArray* systems);
+/**
+Returns \e checkpoint or, if it is a binary frame written by an earlier version or on a machine with the
+opposite byte order, an autoreleased copy converted to the current layout (see AdConvertTrajectoryFrame()). Raises an NSInternalInconsistencyException
+if \e checkpoint needs to be converted but is corrupt.
+*/
+NSData* AdCurrentTrajectoryFrame(NSData* checkpoint);
+/**
+Returns the memento of the system called \e systemName from \e checkpoint.
+\e checkpoint can be a binary frame or a keyed archive. For binary frames the memento is an
+AdSystemMemento whose matrices are decoded directly from the frame. For keyed archives it is an AdDataSet. Returns nil if \e checkpoint
+does not contain the system. Frames written by earlier versions are converted with AdCurrentTrajectoryFrame().
+Raises an NSInternalInconsistencyException if \e checkpoint is
+a binary frame which is corrupt or was written on a machine with a different byte order.
+*/
+id AdSystemMementoFromTrajectoryCheckpoint(NSData* checkpoint, NSString* systemName);
+
 /** \@}**/
 
 #endif		
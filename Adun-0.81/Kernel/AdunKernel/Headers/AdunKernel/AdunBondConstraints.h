@@ -0,0 +1,124 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#ifndef _ADBONDCONSTRAINTS_
+#define _ADBONDCONSTRAINTS_
+
+#include <Foundation/Foundation.h>
+#include "Base/AdMatrix.h"
+#include "Base/AdConstraints.h"
+#include "AdunKernel/AdunDefinitions.h"
+#include "AdunKernel/AdFrameworkFunctions.h"
+#include "AdunKernel/AdunMemoryManager.h"
+#include "AdunKernel/AdunSimulator.h"
+#include "AdunKernel/AdunSystem.h"
+#include "AdunKernel/AdunSystemCollection.h"
+
+/**
+\ingroup Inter
+AdBondConstraints is a simulator component which fixes the lengths of bonds involving hydrogen atoms
+and keeps water molecules rigid. This removes the fastest vibrations from the system
+allowing a time step of 2fs to be used.
+
+The constraints are defined from the \e HarmonicBond interaction of each system.
+A bond is constrained if one of its elements is a hydrogen (mass less than 1.5).
+The constrained length is the equilibrium separation of the bond.
+Waters i.e. an oxygen bonded to two hydrogens which have no other bonds, are made rigid using
+the analytic SETTLE algorithm. The hydrogen-hydrogen distance is taken from the hydrogen-hydrogen bond,
+if present, or the \e HarmonicAngle interaction. All waters in a system must have the same geometry -
+waters which differ from the first one found are made rigid using SHAKE instead.
+Other constraints are satisfied using SHAKE for the positions and RATTLE for the velocities.
+
+The reference positions are recorded on receipt of simulatorWillPerformPositionUpdateForSystem:().
+The positions are constrained on receipt of simulatorDidPerformPositionUpdateForSystem:() and
+the velocities are corrected on receipt of simulatorDidPerformSecondVelocityUpdateForSystem:().
+Since components are called in the order they were added AdBondConstraints instances should be added
+to a simulator before any thermostat.
+
+On receipt of simulator:willBeginProductionWithSystems:forceFields:() the number of constraints
+of each system is set using AdSystem::setNumberOfConstraints: so the temperature is calculated
+with the correct degrees of freedom.
+If the constraints cannot be satisfied at some step an NSInternalInconsistencyException is raised.
+This usually indicates an exploding simulation.
+*/
+@interface AdBondConstraints: NSObject <AdSimulatorComponent>
+{
+	@private
+	BOOL constrainWater;
+	BOOL constrainHydrogenBonds;
+	int maxIterations;
+	double tolerance;
+	double timeStep;
+	NSMutableDictionary* systemConstraints;	//!< Contains the constraints of each system
+}
+/**
+As initWithTolerance:maxIterations: with a tolerance of 1E-6 and
+500 iterations.
+*/
+- (id) init;
+/**
+Designated initialiser.
+\param aDouble The maximum relative deviation of each constrained bond length from its value.
+\param anInt The maximum number of SHAKE and RATTLE iterations.
+*/
+- (id) initWithTolerance: (double) aDouble maxIterations: (int) anInt;
+/**
+Returns the tolerance.
+*/
+- (double) tolerance;
+/**
+Sets the tolerance. The value must be greater than 0 otherwise an NSInvalidArgumentException is raised.
+*/
+- (void) setTolerance: (double) aDouble;
+/**
+Returns the maximum number of iterations.
+*/
+- (int) maxIterations;
+/**
+Sets the maximum number of iterations.
+*/
+- (void) setMaxIterations: (int) anInt;
+/**
+Returns YES if waters are kept rigid.
+*/
+- (BOOL) constrainWater;
+/**
+If \e value is YES waters are kept rigid. Defaults to YES.
+Changes take effect the next time production begins.
+*/
+- (void) setConstrainWater: (BOOL) value;
+/**
+Returns YES if bonds involving hydrogens are constrained.
+*/
+- (BOOL) constrainHydrogenBonds;
+/**
+If \e value is YES bonds involving hydrogens are constrained. Defaults to YES.
+Changes take effect the next time production begins.
+*/
+- (void) setConstrainHydrogenBonds: (BOOL) value;
+/**
+Returns the number of constraints applied to \e aSystem. This is only
+valid after production has begun.
+*/
+- (unsigned int) numberOfConstraintsForSystem: (AdSystem*) aSystem;
+@end
+
+#endif
@@ -31,12 +31,15 @@
 #include <time.h>
 #include "Base/AdVector.h"
 #include "Base/AdSorter.h"
-#include "Base/AdLinkedList.h"
+#include "Base/AdPairList.h"
+#include "Base/AdPeriodicBox.h"
+#include "Base/AdThreadTeam.h"
 #include "AdunKernel/AdunDefinitions.h"
 #include "AdunKernel/AdunMemoryManager.h"
 #include "AdunKernel/AdunListHandler.h"
 #include "AdunKernel/AdunSystem.h"
 #include "AdunKernel/AdunInteractionSystem.h"
+#include "AdunKernel/AdunNonbondedPairArray.h"
 
 /**
 \ingroup Inter
@@ -45,7 +48,8 @@ and updating its list.
 
 AdCellListHandler instances partition the space occupied by the elements
 into cells. Each cell is a cube of side \f$ \frac {r_{cutoff}}{2} \f$. The elements contained in each
-cell are recalculated every time update() is called. 
+cell are recalculated every time update() is called and the pair list
+is then rebuilt from the new cell contents.
 
 By partioning the space in this way AdCellListHandler instances do not have
 to check the entire space when updating - only elements in cells whose centers are
@@ -54,6 +58,29 @@ less than
 r_{cutoff}(1 + \frac{1}{2\sqrt{2}} )
 \f$
 away from each element need to be checked.
+
+If the system is periodic (see AdSystem::periodicBox and AdInteractionSystem::periodicBox) the cell space
+is the periodic box itself. The number of cells along each axis is chosen so each cell
+is at least \f$ \frac {r_{cutoff}}{2} \f$ long, the neighbours of cells on the faces of the box
+include the cells on the opposite faces, and all distances are calculated using the minimum image convention.
+The box must be at least twice the cutoff along every axis.
+
+\b Construction
+
+The elements are sorted into the cells using a counting sort which places the contents of all the cells
+in a single array. If no element has changed cell since the last update the cell contents are reused.
+The allowed pairs of each element are converted to a sorted array of index intervals when the list is first
+created so checking if a pair is allowed does not require messaging the NSIndexSets.
+
+The coordinates are also copied in cell order before each build so the coordinates of the elements in each cell are
+contiguous in memory.
+
+The search is divided into numberOfThreads() parts which are run on the shared thread team
+(see AdRunThreadTeam()), each part processing blocks of consecutive elements in turn. The partners found by each
+part are stored in buffers which are reused by later updates and are then copied into the list in element order,
+so the list is the same regardless of the number of threads. If there are only a few blocks per part,
+or another list is using the team, e.g. when the lists of an AdMultithreadedNonbondedTerm are updated,
+the list is built by the calling thread alone.
 \todo Refactor - Calculate maximum space size internally if its not provided.
 **/
 @interface AdCellListHandler: AdListHandler
@@ -61,11 +88,23 @@ away from each element need to be checked.
 	@private
 	BOOL cellsInitialised;
 	BOOL listCreated;
+	BOOL periodic;		//YES if the system has periodic boundaries
 	int numberOfCells;
-	int baseSize;		//The initial size of each array in cellContentsMatrix
+	int numberOfThreads;	//The number of threads used to build the list
 	int* cellsPerAxis;
 	int* cellNumber;	//An array containing the number of the cell each atom is in
+	int* cellStart;		//The index in cellContents of the first atom in each cell
+	int* cellCursor;	//Used when sorting the atoms into cellContents
+	int* cellContents;	//The atoms sorted by cell
+	double* cellPositions;	//The coordinates of the atoms in cellContents order
+	int* rangeOffsets;	//The index of the first allowed range of each atom
+	int* allowedRanges;	//The allowed pairs of each atom as half open index intervals
+	int* partnerCounts;	//The number of partners of each atom found by the last build
+	int* chunkBuffer;	//The thread buffer holding the partners of each block of atoms
+	int* chunkOffset;	//The position in its buffer of the partners of each block
+	int* bufferCapacities;
 	double cellSize;
+	double cellLengths[3];	//The length of the cells along each axis
 	double cutoff;
 	double maxSpaceSize;
 	double cutoff_sq;
@@ -81,10 +120,9 @@ away from each element need to be checked.
 	Vector3D maxSpaceBoundry;	//The (+,+,+) extremity of the cell space
 	Vector3D cellSpaceDimensions;	//The dimension of the cell space
 	IntArrayStruct* cellNeighbourMatrix;	
-	IntArrayStruct* cellContentsMatrix;	
-	IntArrayStruct* updateCheckInteractions; //The interactions that are to be checked in each update step
-	AdLinkedList* nonbondedList;
-	ListElement* (*getElement)(id, SEL);
+	IntArrayStruct* threadBuffers;	//The partners found by each build thread
+	AdPeriodicBox periodicBox;	//The periodic box if periodic is YES
+	AdPairList* pairList;
 	NSArray* interactions;
 	AdMemoryManager* memoryManager;
 	id delegate;
@@ -111,6 +149,16 @@ maximumSpaceSize set to 1000.
 - (id) initWithSystem: (id) aSystem	
 	allowedPairs: (NSArray*) anArray 
 	cutoff: (double) valueOne;
+/**
+Returns the number of threads used to build the list.
+Defaults to AdDefaultNumberOfThreads().
+*/
+- (int) numberOfThreads;
+/**
+Sets the number of threads used to build the list to \e number.
+If \e number is less than 1 one thread is used.
+*/
+- (void) setNumberOfThreads: (int) number;
 @end
 
 
@@ -23,6 +23,8 @@
 #define ADCHARMM_FORCE_FIELD
 
 #include "AdunKernel/AdunMolecularMechanicsForceField.h"
+#include "Base/AdBondedKernels.h"
+#include "Base/AdThreadTeam.h"
 /** 
 AdMolecularMechanicsForceField subclass representing the Charmm force field -
 
@@ -50,6 +52,15 @@ AdCharmmForceField objects use an appropriate AdNonbondedTerm subclass instance
 and energies due to the nonbonded terms i.e. the combined Lennard-Jones and ColoumbElectrostatic interactions,
 which must be supplied separately.
 
+The bonded forces are calculated by the kernels in BondedKernels using a table of each interaction type
+(see AdBondedTable) created when the system is set. The interactions are divided into at most
+numberOfThreads() parts which are evaluated on the shared thread team (see ThreadTeam).
+Each part adds its forces to its own matrix. Small systems are divided into fewer parts.
+
+evaluateEnergies() does not use the kernels. The kernels always calculate forces, while the scalar
+energy functions (e.g. AdFourierTorsionEnergy()) only calculate the energy, which is cheaper when the forces
+are not needed. The two agree to within rounding (see Base/Tests/AdBondedKernelTest.c).
+
 \ingroup Inter
 **/
 
@@ -65,8 +76,21 @@ which must be supplied separately.
 	double relativePermittivity;
 	AdMatrix *ub;
 	ListElement *list_14, *list_p;
+	int numberOfThreads;			//!< The maximum number of parts the bonded forces are divided into
+	AdBondedTable *bondTable, *angleTable, *torsionTable, *improperTable, *ureyBradleyTable;
+	AdMatrix** threadForces;		//!< Force matrices of parts 1 to numberOfThreads - 1
 }
 /**
+Returns the maximum number of parts the bonded force calculation is divided into.
+Defaults to AdDefaultNumberOfThreads().
+*/
+- (int) numberOfThreads;
+/**
+Sets the maximum number of parts the bonded force calculation is divided into to \e number.
+If \e number is less than 1 the calculation is not divided.
+*/
+- (void) setNumberOfThreads: (int) number;
+/**
 \todo Not implemented
 */
 - (void) evaluateEnergiesUsingInteractionsInvolvingElements: (NSIndexSet*) elementIndexes;
@@ -0,0 +1,190 @@
+/*
+ Project: AdunCore
+ 
+ Copyright (C) 2008 Michael Johnston & Jordi Villa-Freixa
+ 
+ Author: Michael Johnston
+ 
+ This application is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public
+ License as published by the Free Software Foundation; either
+ version 2 of the License, or (at your option) any later version.
+ 
+ This application is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ 
+ You should have received a copy of the GNU General Public
+ License along with this library; if not, write to the Free
+ Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#ifndef _ADUNCHECKPOINTWRITERQUEUE_
+#define _ADUNCHECKPOINTWRITERQUEUE_
+#include <pthread.h>
+#include <Foundation/Foundation.h>
+#include "AdunKernel/AdunDefinitions.h"
+#include "AdunKernel/AdFrameworkFunctions.h"
+#include "AdunKernel/AdunMemoryManager.h"
+#include "AdunKernel/AdunEnergyRecorder.h"
+
+/**
+\ingroup coreClasses
+AdCheckpointSlot holds the data collected for one frame by an AdSimulationDataWriter or
+AdMutableTrajectory until it is written to their store. 
+Slots are owned and reused by an AdCheckpointWriterQueue.
+
+The instance variables are public so the writers can fill and read them directly.
+*/
+@interface AdCheckpointSlot: NSObject
+{
+	@public
+	BOOL trajectoryCheckpoint;
+	BOOL energyCheckpoint;
+	BOOL topologyCheckpoint;
+	BOOL encodesOnCapture;		//!< If YES the state is encoded when captured instead of copied
+	int numberOfSystems;
+	int capacity;			//!< The number of systems the arrays below have space for
+	int* masks;
+	AdMatrix** coordinates;		//!< Copies of the coordinates of each system
+	AdMatrix** velocities;		//!< Copies of the velocities of each system
+	AdFrameEncoding encoding;
+	double precision;
+	NSMutableArray* systemNames;
+	NSMutableArray* mementos;	//!< The mementos of each system for XML checkpoints
+	NSData* trajectoryData;		//!< An already encoded trajectory checkpoint
+	AdEnergyRecord* energyRecord;	//!< The energies recorded for the frame
+	NSDictionary* topologyData;
+}
+/**
+Copies the state of \e systems as given by their capture masks into the receiver.
+The copies are encoded by trajectoryData(). If the TrajectoryFrameEncoding default is
+\e XML the mementos of the systems are kept instead and are archived by trajectoryData().
+*/
+- (void) captureStateOfSystems: (NSArray*) systems;
+/**
+Sets the already encoded trajectory checkpoint.
+*/
+- (void) setTrajectoryData: (NSData*) data;
+/**
+Returns the trajectory checkpoint for the receivers data encoding it if necessary.
+*/
+- (NSData*) trajectoryData;
+/**
+Transfers the topology checkpoint to the receiver.
+The dictionary should not be modified afterwards.
+*/
+- (void) setTopologyData: (NSDictionary*) topologies;
+/**
+Adds the checkpoints the receiver contains to \e storage and the recorded energies to \e stateData.
+If \e stateData is nil the energies are not added.
+Returns the row the writers add to their frames matrix - one NSNumber (0 or 1) each for the trajectory,
+energies and topology indicating if they were checkpointed.
+*/
+- (NSArray*) writeToStorage: (id) storage stateData: (AdDataSet*) stateData;
+/**
+Releases the data held by the receiver and resets the checkpoint flags.
+The matrices and the buffers of the energy record are kept for reuse.
+*/
+- (void) clear;
+@end
+
+/**
+\ingroup coreClasses
+AdCheckpointWriterQueue writes checkpoints on a background thread so the thread running 
+a simulation is not blocked by encoding and writing them.
+
+The queue has a fixed number of AdCheckpointSlot objects used in rotation.
+The simulation thread gets a slot using currentSlot() which only blocks if every slot is
+waiting to be written - this back-pressure is the only way the queue slows a simulation.
+Once filled the slot is passed to the writer thread with submitCurrentSlot().
+The writer thread sends the target the write selector (which takes the slot as argument) for each
+submitted slot in order. When requested using synchronize() it then sends the target the synchronize selector.
+
+Exceptions raised on the writer thread are caught and reraised on the next call to 
+submitCurrentSlot() or waitUntilEmpty().
+
+Objects which use a queue must call waitUntilEmpty() before reading anything modified
+by the write selector and stop() before being deallocated.
+
+A queue created with no slots is synchronous. It has one slot and no writer thread - submitCurrentSlot()
+writes the slot on the calling thread, synchronize() synchronizes immediately and
+exceptions are raised directly. Slots of a synchronous queue encode the trajectory as it is captured
+so the state of the systems is not copied.
+This lets the writers fill and write their frames in the same way whether checkpointing is asynchronous or not.
+Whether queues are asynchronous is determined by the \e AsynchronousCheckpointing default (YES by default).
+The number of slots is given by \e CheckpointQueueLength (2 by default).
+*/
+@interface AdCheckpointWriterQueue: NSObject
+{
+	@private
+	BOOL isRunning;
+	BOOL isSynchronous;
+	BOOL synchronizationRequested;
+	int numberOfSlots;
+	int firstSlot;			//!< The next slot to be written
+	int usedSlots;			//!< Slots being filled, waiting or being written
+	int submittedSlots;		//!< Slots waiting or being written
+	unsigned int numberSubmitted;	//!< The total number of slots submitted
+	unsigned int numberWritten;	//!< The total number of slots written
+	unsigned int synchronizationPoint;	//!< Synchronize after this number of slots are written
+	BOOL hasCurrentSlot;
+	NSMutableArray* slots;
+	NSException* writerException;
+	id target;
+	SEL writeSelector;
+	SEL synchronizeSelector;
+	pthread_mutex_t mutex;
+	pthread_cond_t slotCondition;		//!< Signalled when a slot is written
+	pthread_cond_t workCondition;		//!< Signalled when there is something to do
+}
+/**
+Returns YES if the \e AsynchronousCheckpointing default is YES.
+*/
++ (BOOL) asynchronousCheckpointing;
+/**
+As initWithTarget:writeSelector:synchronizeSelector:numberOfSlots: with the number of slots
+given by the \e CheckpointQueueLength default, or no slots if asynchronousCheckpointing() is NO.
+*/
+- (id) initWithTarget: (id) object 
+	writeSelector: (SEL) writeSel
+	synchronizeSelector: (SEL) synchronizeSel;
+/**
+Designated initialiser. Starts the writer thread unless \e number is 0 in which
+case the queue is synchronous.
+\e object is not retained.
+*/
+- (id) initWithTarget: (id) object 
+	writeSelector: (SEL) writeSel
+	synchronizeSelector: (SEL) synchronizeSel
+	numberOfSlots: (int) number;
+/**
+Returns the slot currently being filled. If there is none the next free slot is cleared
+and returned, waiting for the writer thread to finish with it if necessary.
+*/
+- (AdCheckpointSlot*) currentSlot;
+/**
+Passes the slot currently being filled to the writer thread. Does nothing
+if there is no current slot.
+*/
+- (void) submitCurrentSlot;
+/**
+Requests the target be synchronized once all submitted slots are written.
+*/
+- (void) synchronize;
+/**
+Waits until all submitted slots have been written and any requested synchronization has been performed.
+Any slot being filled is not affected.
+*/
+- (void) waitUntilEmpty;
+/**
+Waits until the queue is empty and stops the writer thread. Any slot being filled is discarded.
+*/
+- (void) stop;
+/**
+Discards the slot currently being filled.
+*/
+- (void) discardCurrentSlot;
+@end
+
+#endif
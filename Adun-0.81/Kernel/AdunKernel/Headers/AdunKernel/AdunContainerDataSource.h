@@ -88,7 +88,7 @@ the molecule contents as appropriate - see the AdContainerDataSourceInsertionExt
 	NSMutableDictionary* interactionGroups;
 	NSMutableDictionary* interactionParameters;
 	NSMutableDictionary* categories;
-	NSMutableArray* nonbondedPairs;
+	AdNonbondedPairArray* nonbondedPairs;
 	NSMutableArray *removedMolecules;	//!< Amount of molecules removed for each system insertion
 	NSMutableArray *containedSystems;	//!< The systems that have been inserted.
 }
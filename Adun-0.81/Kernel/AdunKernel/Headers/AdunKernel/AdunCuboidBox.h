@@ -23,6 +23,7 @@
 #define _ADUN_CUBOID_BOX_
 
 #include "Base/AdVector.h"
+#include "Base/AdPeriodicBox.h"
 #include "AdunKernel/AdFrameworkFunctions.h"
 #include "AdunKernel/AdGridDelegate.h"
 #include "AdunKernel/AdunDefinitions.h"
@@ -32,6 +33,10 @@
  \ingroup Inter
  AdCuboidBox objects define a rectangular volume. (a cuboid).
  They conform to the AdGridDelegate protocol and are for use with AdGrid.
+ 
+ An AdCuboidBox can also define periodic boundaries for the systems contained in it (see setPeriodic:).
+ In this case AdSystem objects whose data source uses the box wrap their coordinates into it and
+ the nonbonded list handlers and kernels use the minimum image convention.
  */
 
 @interface AdCuboidBox: NSObject <AdGridDelegate, NSCoding>
@@ -44,6 +49,7 @@
 	Vector3D cuboidCentre;		//!< centre of the box as Vector3D
 	NSArray* centre;		//!< centre of box as NSArray
 	NSArray* cuboidExtremes;
+	BOOL periodic;			//!< YES if the box defines periodic boundaries
 }
 /**
  As initWithCavityCentre:xDimension:yDimension:zDimension: with all dimensions set to 20
@@ -95,6 +101,18 @@
 Returns the cavity centre as an NSArray
 */
 - (NSArray*) centre;
+/**
+ Sets if the box defines periodic boundary conditions. Defaults to NO.
+ */
+- (void) setPeriodic: (BOOL) value;
+/**
+ Returns YES if the box defines periodic boundary conditions, NO otherwise.
+ */
+- (BOOL) isPeriodic;
+/**
+ Fills \e box with the origin and lengths of the receiver.
+ */
+- (void) getPeriodicBox: (AdPeriodicBox*) box;
 @end
 
 #endif
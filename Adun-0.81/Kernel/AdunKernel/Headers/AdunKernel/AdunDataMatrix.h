@@ -30,6 +30,32 @@
 #include "AdunKernel/AdunDefinitions.h"
 #include "AdunKernel/AdunMemoryManager.h"
 
+/**
+\ingroup frameworkTypes
+The types of storage used for the columns of an AdDataMatrix.
+*/
+typedef enum
+{
+	AdUntypedColumn = 0,	/**< The data type of the column has not been set */
+	AdDoubleColumn = 1,	/**< A C array of doubles */
+	AdIntColumn = 2,	/**< A C array of ints */
+	AdStringColumn = 3	/**< A C array of indexes into a table of the distinct strings in the column */
+}
+AdDataColumnType;
+
+/**
+\ingroup frameworkTypes
+The storage for one column of an AdDataMatrix. 
+*/
+typedef struct
+{
+	AdDataColumnType type;
+	void* values;			//!< double* for double columns, int* otherwise
+	NSMutableArray* strings;	//!< The distinct strings of a string column
+	NSMutableDictionary* stringIndexes;	//!< Maps each string to its index in \e strings
+}
+AdDataColumn;
+
 /**
 \ingroup Inter
 Contains a matrix of values. AdDataMatrix is primarily a convenient way to
@@ -56,14 +82,21 @@ classes - Subclasses of these data types are also stored.
 
 For AdDataMatrix objects the column data types are set on intialisation.
 
+\section storage Storage
+
+The matrix is stored by column. The values of double and int columns are kept in contiguous C arrays
+while each string column keeps a table of the distinct strings it contains along with the index 
+of the string in each row. Elements are converted to objects of the class for the column data type when
+accessed using the methods which return objects e.g. elementAtRow:column:(). 
+The values of numeric columns can be accessed without any conversion using doubleValuesOfColumn:() 
+and intValuesOfColumn:().
+
 \note AdDataMatrix indexes rows and columns starting with 0 i.e. the first element
 is (0,0).
 
-\note AdDataMatrix is not performanced optimised and should not be
-used where heavy access is required to the matrix elements i.e. for computations
-use the AdunBase library C structures or the gsl_matrix type.
+\note Accessing elements as objects is still relatively expensive. For computations
+use cRepresentation(), the column value arrays, the AdunBase library C structures or the gsl_matrix type.
 
-\todo Internal - Examine changing internal matrix representation to optimise performance.
 \todo Extra Methods - writeToFile: and initWithContentsOfFile:
 \todo Add support for NSBoolNumber
 */
@@ -73,10 +106,13 @@ use the AdunBase library C structures or the gsl_matrix type.
 	@protected
 	unsigned int numberOfRows;
 	unsigned int numberOfColumns;
+	unsigned int rowCapacity;	//!< The number of rows the column storage has space for
+	unsigned int columnCapacity;	//!< The number of columns \e columns has space for
 	NSMutableArray* columnHeaders;
 	NSMutableArray* columnDataTypes;
+	NSMutableDictionary* headerIndexes;	//!< Maps each header to the index of the first column with it
 	NSString* name;
-	NSMutableArray* matrix;	//!<an array of arrays
+	AdDataColumn* columns;	//!< The storage for each column
 }
 /**Returns an autoreleased AdDataMatrix instance initialised
 with the values of \e aMatrix
@@ -226,6 +262,16 @@ returned structure as is responsible for deallocating it
 */
 - (AdMatrix*) cRepresentation;
 /**
+Returns a pointer to the values of column \e columnIndex which must hold doubles.
+The values are not copied. The pointer is only valid until the receiver is next modified.
+Raises an NSInvalidArgumentException if the column does not exist or does not hold doubles.
+*/
+- (const double*) doubleValuesOfColumn: (unsigned int) columnIndex;
+/**
+As doubleValuesOfColumn:() for columns which hold ints.
+*/
+- (const int*) intValuesOfColumn: (unsigned int) columnIndex;
+/**
 Compares the c representation of the receiver with that of \e aMatrix
 using AdCompareDoubleMatrices() with a tolerance of 1E-12.
 */
@@ -488,6 +534,18 @@ the data type of the corresponding column.
 */
 - (void) extendMatrixWithRow: (NSArray*) row;
 /**
+Extends the matrix with each array in \e rows as extendMatrixWithRow:() does.
+Space for all the rows is reserved before they are added.
+*/
+- (void) extendMatrixWithRows: (NSArray*) rows;
+/**
+Adds a row whose elements are given by the C array \e values which must contain
+an entry for each column. The values are stored directly in the columns without creating
+objects. Values for int columns are truncated and values for string columns are converted
+to strings. If the column data types have not been set they are all set to double.
+*/
+- (void) extendMatrixWithDoubleValues: (const double*) values;
+/**
 Adds \e column to the end of the matrix. All elements in
 the column must be of the same class which determines the dataType of
 the column. 
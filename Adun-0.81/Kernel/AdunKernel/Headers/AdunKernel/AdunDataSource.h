@@ -28,6 +28,7 @@
 #include <Foundation/Foundation.h>
 #include "AdunKernel/AdDataSources.h"
 #include "AdunKernel/AdIndexSetConversions.h"
+#include "AdunKernel/AdunNonbondedPairArray.h"
 #include "AdunKernel/AdunDefinitions.h"
 #include "AdunKernel/AdunMemoryManager.h"
 #include "AdunKernel/AdunDataSet.h"
@@ -82,7 +83,7 @@ AdModelObject supported NSCopying
 	NSMutableDictionary* interactionGroups;
 	NSMutableDictionary* interactionParameters;
 	NSMutableDictionary* categories;
-	NSMutableArray* nonbondedPairs;
+	AdNonbondedPairArray* nonbondedPairs;
 }
 /**
 As initWithElementProperties:configuration:interactions:groupProperties() passsing nil for \e interactions
@@ -283,7 +284,9 @@ Temporary method name.
 */
 - (void) setGroupProperties: (AdDataMatrix*) dataMatrix;
 /**
-Temporary method
+Temporary method.
+\e array is converted to an AdNonbondedPairArray (if it is not one already)
+which is returned by indexSetArrayForCategory:() when passed "Nonbonded".
 */
 - (void) setNonbondedPairs: (NSMutableArray*) array;
 
@@ -210,6 +210,7 @@ typedef enum
 	AdKernelFloatingPointError,	/**< Detected an IEEE floating point exception */
 	AdKernelSimulationSpaceError,	/**< Most likely due to an exploding simulation */
 	AdKernelEnergyCalculationError, /**< Something went wrong calculating an energy or force */
+	AdKernelConstraintError,	/**< Holonomic constraints could not be satisfied */
 }
 AdKernelErrorCodes;
 
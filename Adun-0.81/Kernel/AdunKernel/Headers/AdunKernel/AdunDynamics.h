@@ -59,6 +59,7 @@ How do we know what the temperature conversion factor is?
 	int seed;
 	int numberOfElements;
 	int degreesOfFreedom;
+	int numberOfConstraints;	//!< The number of holonomic constraints acting on the elements
 	double totalMass;
 	double temperature;
 	double kineticEnergy;
@@ -178,6 +179,16 @@ Returns the current degrees of freedom.
 */
 - (unsigned int) degreesOfFreedom;
 /**
+Sets the number of holonomic constraints acting on the elements e.g. fixed bond lengths.
+Each constraint removes one degree of freedom. The temperature is updated accordingly.
+Raises an NSInvalidArgumentException if \e number would reduce the degrees of freedom below one.
+*/
+- (void) setNumberOfConstraints: (unsigned int) number;
+/**
+Returns the number of holonomic constraints acting on the elements.
+*/
+- (unsigned int) numberOfConstraints;
+/**
 Returns the total mass of the system.
 */
 - (double) totalMass;
@@ -0,0 +1,117 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#ifndef _ADUNENERGYRECORDER_
+#define _ADUNENERGYRECORDER_
+#include <Foundation/Foundation.h>
+#include "AdunKernel/AdunDefinitions.h"
+#include "AdunKernel/AdunDataSet.h"
+#include "AdunKernel/AdunDataMatrix.h"
+#include "AdunKernel/AdunForceFieldCollection.h"
+
+/**
+\ingroup coreClasses
+AdEnergyRecord holds the energies of a set of systems recorded by an AdEnergyRecorder for one frame.
+The values are stored as plain doubles and the buffers are reused each time the record is cleared
+so recording does not allocate memory after the first frame.
+
+The instance variables are public so the writers can read them directly.
+*/
+@interface AdEnergyRecord: NSObject
+{
+	@public
+	int numberOfSystems;		//!< The number of systems recorded
+	int capacity;			//!< The number of systems the arrays below have space for
+	id iterationValue;		//!< The value of the iteration column as an object
+	NSMutableArray* systemNames;
+	NSMutableArray* columnHeaders;	//!< For each system the headers of the recorded values
+	double** values;		//!< For each system the values in the order of its headers
+	int* valuesCapacity;		//!< The number of doubles allocated for each entry in values
+}
+/**
+Removes the recorded energies. The buffers are kept for reuse.
+*/
+- (void) clear;
+/**
+Appends the recorded energies of each system to the AdMutableDataMatrix in \e dataSet
+with the same name as the system. Columns are added to a matrix for terms it does not
+contain with the value for the previous rows set to 0.
+Columns of the matrix which were not recorded are set to 0.
+Systems with no matrix in \e dataSet are ignored.
+*/
+- (void) addEnergiesToDataSet: (AdDataSet*) dataSet;
+@end
+
+/**
+\ingroup coreClasses
+AdEnergyRecorder records the energies of a set of systems as plain doubles in an AdEnergyRecord.
+
+For each system the recorder reads the iteration value, the potential energy, the kinetic energy
+and temperature (if the system has them), the total energy and then the energy of each term returned by
+AdMolecularMechanicsForceField::allTerms() for the systems force field.
+These are the columns of the energy matrices of AdSimulationDataWriter and AdMutableTrajectory.
+
+The source of each value is registered once - core term energies are read through the pointers
+returned by AdMolecularMechanicsForceField::pointerToEnergyOfCoreTerm:() and custom terms are
+sent AdForceFieldTerm::energy directly.
+The sources of a system are registered again if AdMolecularMechanicsForceField::termsVersion() changes,
+which happens when custom terms are added or removed or a custom term changes whether it can evaluate its energy.
+Hence recording takes no locks and creates no objects so energies can be recorded every step.
+
+Records are passed to the writer thread of an AdCheckpointWriterQueue in an AdCheckpointSlot
+which adds them to the energy matrices.
+*/
+@interface AdEnergyRecorder: NSObject
+{
+	@private
+	int numberOfSystems;
+	NSString* iterationHeader;
+	NSMutableArray* systems;
+	NSMutableArray* forceFields;
+	NSMutableArray* columnHeaders;
+	BOOL* isDynamic;		//!< YES if the system has kinetic energy and temperature
+	unsigned int* termsVersions;	//!< The terms version of each force field when the sources were registered
+	int* numberOfSources;
+	void** sources;			//!< The term energy sources of each system
+}
+/**
+Designated initialiser.
+\param systemArray The systems whose energies will be recorded.
+Only the first force field of each system is used. Systems with no force field
+in \e aForceFieldCollection, or whose force field is not an AdMolecularMechanicsForceField, are ignored.
+\param aString The header of the iteration column.
+*/
+- (id) initWithSystems: (NSArray*) systemArray
+	forceFields: (AdForceFieldCollection*) aForceFieldCollection
+	iterationHeader: (NSString*) aString;
+/**
+Returns the headers of the values that will be recorded for \e system or nil if the
+energies of \e system are not recorded.
+*/
+- (NSArray*) columnHeadersForSystem: (id) system;
+/**
+Clears \e record and then records the current energies of each system in it.
+\e value is the value of the iteration column.
+*/
+- (void) recordEnergiesForIteration: (NSNumber*) value inRecord: (AdEnergyRecord*) record;
+@end
+
+#endif
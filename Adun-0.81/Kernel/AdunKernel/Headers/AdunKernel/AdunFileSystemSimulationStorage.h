@@ -48,6 +48,17 @@ Class for managing reading/writing of simulation data on the file system.
 
 Modes - see AdSimulationStorageMode
 
+Trajectory checkpoints are appended to trajectory.ad and the size and offset of each one is recorded
+in trajectoryInformation.ad. The format of the checkpoints is chosen by the writer - see AdCreateTrajectoryCheckpoint().
+Binary checkpoints are written at offsets which are a multiple of eight bytes.
+
+In AdSimulationStorageReadMode trajectory.ad is memory mapped and the offsets are kept in a C array,
+so trajectoryCheckpoint:() returns the bytes of the checkpoint directly from the mapping.
+When checkpoints are read in order the following ones are prefetched using madvise().
+prefetchTrajectoryCheckpointsInRange:stride:() can be used to prefetch other access patterns.
+If the archive cannot be mapped checkpoints are read from the file and the last \e CacheLimit
+(a user default) are cached.
+
 \todo Expand documentation
 \todo Implement AdSimulationStorageUpdateMode
 With the implementation of on demand read access to the
@@ -77,6 +88,12 @@ longer present.
 	id trajectoryInfo;		
 	NSMutableArray* trajectoryCache;
 	NSMutableArray* cacheFrames;
+	id trajectoryMapping;			//!< Read only mapping of the trajectory archive. Checkpoints retain it.
+	unsigned char* trajectoryMap;		//!< The bytes of trajectoryMapping
+	unsigned long long trajectoryMapLength;
+	unsigned long long* frameIndex;		//!< The offset and size of each trajectory checkpoint
+	int lastLoadedFrame;
+	int prefetchLimit;			//!< The next sequential prefetch is issued when this frame is loaded
 }
 /**
 Class method for checking if a valid store exists at location
@@ -134,12 +151,21 @@ Returns the amount of data in the store in bytes.
 - (unsigned long long) sizeOfStore;
 /**
 Returns the \e number'th trajectory checkpoint 
+If the trajectory archive is mapped the returned object refers to the mapping
+and keeps it, and so itself, valid until it is released.
 Raises an NSRangeException if no such checkpoint exists.
 Raises an NSInternalInconsistencyException if 
 if the data store is in AdSimulationStorageWriteMode mode.
 */
 - (NSData*) trajectoryCheckpoint: (int) number;
 /**
+Advises the system that the trajectory checkpoints in \e aRange, taking every \e stride'th one,
+will be read soon so they can be read from disk in advance.
+Does nothing if the trajectory archive is not mapped.
+Raises an NSRangeException if \e aRange exceeds the number of checkpoints.
+*/
+- (void) prefetchTrajectoryCheckpointsInRange: (NSRange) aRange stride: (unsigned int) stride;
+/**
 Returns the \e number'th topology checkpoint 
 Returns nil if no such checkpoint exists.
 Raises an NSRangeException if no such checkpoint exists.
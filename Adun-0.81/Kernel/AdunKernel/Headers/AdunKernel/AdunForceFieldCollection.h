@@ -39,6 +39,13 @@ typedef enum
 }
 AdForceFieldActivity;
 
+/**
+Sent when force fields are added to or removed from an AdForceFieldCollection
+or when a force field is activated or deactivated.
+The notification object is the collection. There is no user info dictionary.
+*/
+#define AdForceFieldCollectionDidChangeNotification @"AdForceFieldCollectionDidChangeNotification"
+
 /** 
 \ingroup Inter
 AdForceFieldCollection objects represent the combined force field due to
@@ -28,6 +28,7 @@
 #include "AdunKernel/AdunSystem.h"
 #include "AdunKernel/AdunTimer.h"
 #include "AdunKernel/AdunListHandler.h"
+#include "AdunKernel/AdunNonbondedPairArray.h"
 
 /**
 \ingroup Inter
@@ -93,7 +94,7 @@ The notification object is the AdInteractionSystem. There is no user info dictio
 	AdMatrix *coordinates;
 	NSArray* systems;
 	NSMutableArray* availableInteractions;
-	NSMutableArray* nonbondedPairs;
+	AdNonbondedPairArray* nonbondedPairs;
 	NSMutableDictionary* interactionGroups;
 	NSMutableDictionary* interactionParameters;
 	NSMutableDictionary* categories;
@@ -157,6 +158,11 @@ Returns the interacting systems
 */
 - (NSArray*) systems;
 /**
+Returns the periodic box of the first system in systems() that is periodic (see AdSystem::periodicBox)
+or nil if neither system is periodic.
+*/
+- (id) periodicBox;
+/**
 Returns the range of indexes in the combined attributes
 returned by the receiver which refer to the elements of \e aSystem.
 If \e aSystem is not part of the AdInteractionSystem object the 
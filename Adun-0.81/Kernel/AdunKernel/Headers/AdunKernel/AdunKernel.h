@@ -44,14 +44,17 @@
 #include "AdunKernel/AdunSimpleListHandler.h"
 #include "AdunKernel/AdunLinkedList.h"
 #include "AdunKernel/AdunListHandler.h"
+#include "AdunKernel/AdunNonbondedPairArray.h"
 #include "AdunKernel/AdunInteractionSystem.h"
 #include "AdunKernel/AdunSystem.h"
+#include "AdunKernel/AdunSystemMemento.h"
 #include "AdunKernel/AdunSystemCollection.h"
 #include "AdunKernel/AdForceFieldTerm.h"
 #include "AdunKernel/AdunSCAAS.h"
 #include "AdunKernel/AdunNonbondedTerm.h"
 #include "AdunKernel/AdunPureNonbondedTerm.h"
 #include "AdunKernel/AdunGRFNonbondedTerm.h"
+#include "AdunKernel/AdunPMENonbondedTerm.h"
 #include "AdunKernel/AdunSmoothedGBTerm.h"
 #include "AdunKernel/AdunShiftedNonbondedTerm.h"
 #include "AdunKernel/AdunForceField.h"
@@ -61,9 +64,11 @@
 #include "AdunKernel/AdunForceFieldCollection.h"
 #include "AdunKernel/AdunConfigurationGenerator.h"
 #include "AdunKernel/AdunSimulator.h"
+#include "AdunKernel/AdunMultipleTimeStepSimulator.h"
 #include "AdunKernel/AdunMinimiser.h"
 #include "AdunKernel/AdunLangevinThermostat.h"
 #include "AdunKernel/AdunBerendsenThermostat.h"
+#include "AdunKernel/AdunBondConstraints.h"
 #include "AdunKernel/AdunMemoryManager.h"
 
 /**
@@ -158,6 +163,7 @@ they contain.
 		- AdPureNonbondedTerm
 		- AdShiftedNonbondedTerm
 		- AdGRFNonbondedTerm
+		- AdPMENonbondedTerm
 
 <em> Description forthcoming </em>
 
@@ -174,10 +180,12 @@ they contain.
 
 - AdConfigurationGenerator
 	- AdSimulator
+		- AdMultipleTimeStepSimulator
 	- AdMinimiser
 - AdSimulatorComponent
 	- AdBerendsenThermostat
 	- AdLangevinThermostat
+	- AdBondConstraints
 
 <em> Description forthcoming </em>
 
@@ -194,6 +202,7 @@ they contain.
 \subsection list Dynamic Lists 
 
 - AdLinkedList
+- AdNonbondedPairArray
 - AdListHandler
 	- AdSimpleListHandler
 	- AdCellListHandler
@@ -23,13 +23,13 @@
 #define ADUN_LISTHANDLER_
 
 #include "Base/AdVector.h"
-#include "Base/AdLinkedList.h"
+#include "Base/AdPairList.h"
 #include "AdunKernel/AdunDefinitions.h"
-#include "AdunKernel/AdunLinkedList.h"
 
 /**
 \ingroup Inter
-AdListHandler is an abstract class that represents an object that creates and maintains a dynamic linked list of element pairs.
+AdListHandler is an abstract class that represents an object that creates and maintains a dynamic list of element pairs.
+The list is stored as an ::AdPairList.
 The elements are distributed throughout a volume of space and the pairs allowed in the list are restricted by a cutoff condition.
 Since the positions of the elements can change the pairs meeting the condition can
 also change. Calling the update() method of an AdListHandler subclass causes it to recalculate the list. 
@@ -130,15 +130,15 @@ Returns the array of allowed pairs
 */
 - (NSArray*) allowedPairs;
 /**
-Returns a pointer to the start of the linked list. This pointer may become
+Returns a pointer to the pair list. This pointer may become
 invalidated e.g. due to setSystem:() or setAllowedPairs:() being called. 
 Hence the object using this list should also be the AdListHandler objects
 delegate so it can recieve handlerDidInvalidateList: messages. If the list
 has not been created this method will return a NULL pointer.
 */
-- (NSValue*) pairList;
+- (AdPairList*) pairList;
 /**
-Returns the number of objects in the linked list. Does not include the start and end elements.
+Returns the number of pairs in the list.
 */
 - (int) numberOfListElements;
 /**
@@ -77,6 +77,7 @@ back to the current subclasses).
 {
 	int no_of_atoms;
 	int updateInterval;
+	unsigned int termsVersion;	//!< Incremented when the custom terms change
 	BOOL harmonicBond;
 	BOOL harmonicAngle;
 	BOOL fourierTorsion;
@@ -100,6 +101,7 @@ back to the current subclasses).
 	AdListHandler* nonbondedHandler;
 	NSMutableDictionary* customTerms;
 	NSMutableArray* customTermNames;
+	NSMutableArray* energyTermNames;	//!< The custom terms that could evaluate energy when termsVersion was last checked
 	NSMutableArray* availableTerms;	//!< The core terms that the current system provides information for
 	NSArray* coreTerms;		//!< The core terms of the force field
 	NSMutableDictionary* state;	//!< The current state of the force-field
@@ -216,6 +218,23 @@ The order corresponds to the order of terms returned by allTerms().
 when there is only one custom term that can calculate energy - (AdForceFieldTerm::canEvaluateEnergy() returns YES).
 */
 - (NSArray*) allEnergies;
+/**
+Returns a number which changes whenever the terms returned by allTerms() may have changed.
+Objects which cache information about the terms can use it to detect when to update it.
+This includes a custom term changing the value it returns for AdForceFieldTerm::canEvaluateEnergy(),
+which is checked each time this method is called.
+*/
+- (unsigned int) termsVersion;
+/**
+Returns a pointer to the variable holding the last calculated energy of the core term \e termName
+or NULL if \e termName is not a core term. The pointer is valid for the lifetime of the receiver.
+This allows the energy to be read repeatedly without creating objects.
+*/
+- (const double*) pointerToEnergyOfCoreTerm: (NSString*) termName;
+/**
+Returns the custom term called \e termName or nil if there is none.
+*/
+- (id) customTermWithName: (NSString*) termName;
 @end
 
 /**
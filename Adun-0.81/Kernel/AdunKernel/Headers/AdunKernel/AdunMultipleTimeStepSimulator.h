@@ -0,0 +1,128 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#ifndef _ADMULTIPLETIMESTEPSIMULATOR_
+#define _ADMULTIPLETIMESTEPSIMULATOR_
+
+#include "AdunKernel/AdunSimulator.h"
+#include "AdunKernel/AdunMolecularMechanicsForceField.h"
+
+/**
+\ingroup Inter
+
+AdMultipleTimeStepSimulator integrates the equations of motion using the reversible
+multiple time step algorithm (r-RESPA). The terms of the force fields are divided into levels
+which are evaluated at different frequencies. Terms which change rapidly but are cheap to evaluate,
+e.g. bonds and angles, are placed in the innermost level while slowly varying expensive terms,
+e.g. the nonbonded and generalized born terms, are placed in outer levels.
+
+The innermost level is integrated using velocity verlet with the time step returned by timeStep().
+Each outer level \e l has a number of steps \f$n_l\f$ - the number of steps of level \e l-1
+performed for each step of level \e l. The time step of level \e l is therefore
+\f$t_l = n_l t_{l-1}\f$. At the start of a level \e l step the velocities are updated by
+\f$\frac{\vec a_l t_l}{2}\f$, where \f$\vec a_l\f$ is the acceleration due to the terms of the level.
+Then \f$n_l\f$ steps of level \e l-1 are performed, the forces of the level are recalculated
+and the velocities updated again by \f$\frac{\vec a_l t_l}{2}\f$.
+
+<b> Levels </b>
+
+The outer levels are defined by an array of dictionaries, one for each level, starting with the level
+directly above the innermost one. Each dictionary has two keys
+- \e Terms - An array containing the names of the terms in the level.
+- \e Steps - The number of steps of the previous level per step of this level.
+
+The names are those returned by AdForceField::availableTerms e.g. \e Nonbonded
+or the name a custom term was added with. Terms not named in any level are evaluated in the innermost
+level, except custom terms (terms not returned by AdMolecularMechanicsForceField::coreTerms)
+which are evaluated in the outermost level since they are usually the most expensive.
+By default there is one outer level containing the \e Nonbonded term with two steps.
+
+The levels are evaluated by temporarily deactivating the terms of the other levels on each force field.
+Terms deactivated before production begins are not evaluated.
+
+<b> Steps and Components </b>
+
+numberOfSteps() and currentStep() refer to steps of the innermost level. Components are informed of
+each step of the innermost level as described by the AdSimulatorComponent protocol. The first velocity
+update notified includes the contributions of any outer levels starting at that step, and the second
+velocity update the contributions of any outer levels finishing at it.
+Hence thermostats and AdBondConstraints act on the fully updated velocities.
+
+\note The energies of the force fields are only complete at the end of each step of the outermost level.
+At other steps they only include the terms evaluated at that step. Hence energies should be
+checkpointed at a multiple of the outermost time step.
+*/
+
+@interface AdMultipleTimeStepSimulator: AdSimulator
+{
+	@private
+	int numberOfLevels;
+	int numberOfSystems;		//!< The number of systems the level accelerations were allocated for
+	int* levelSteps;		//!< The period of each level in innermost steps
+	double* levelHalfTimeSteps;	//!< Half the time step of each level
+	NSArray* levels;
+	NSMutableArray* levelForceFields;	//!< The force fields whose terms are divided into levels
+	NSMutableArray* isolatedTerms;	//!< For each force field the terms to deactivate to evaluate one level
+	NSMutableArray* outerTerms;	//!< For each force field the terms to deactivate to evaluate up to a level
+	AdMatrix*** levelAccelerations;	//!< The accelerations of each system due to each level
+}
+/**
+As the designated initialiser using the default levels.
+*/
+- (id) initWithSystems: (AdSystemCollection*)  aSystemCollection
+	forceFields: (AdForceFieldCollection*) aForceFieldCollection
+	components: (NSArray*) anArray
+	numberOfSteps: (unsigned int) intOne
+	timeStep: (double) aDouble
+	checkFPErrorInterval: (unsigned int) intTwo;
+/**
+Designated initialiser.
+The parameters are the same as for AdSimulator::initWithSystems:forceFields:components:numberOfSteps:timeStep:checkFPErrorInterval:
+with the following exceptions.
+\param intOne The number of innermost steps that will be performed when production() is called.
+\param aDouble The time step of the innermost level.
+\param levelArray An array describing the outer levels. See the class documentation for more.
+If nil the default levels are used.
+*/
+- (id) initWithSystems: (AdSystemCollection*)  aSystemCollection
+	forceFields: (AdForceFieldCollection*) aForceFieldCollection
+	components: (NSArray*) anArray
+	numberOfSteps: (unsigned int) intOne
+	timeStep: (double) aDouble
+	checkFPErrorInterval: (unsigned int) intTwo
+	levels: (NSArray*) levelArray;
+/**
+Returns the array describing the outer levels.
+*/
+- (NSArray*) levels;
+/**
+Sets the outer levels. Raises an NSInvalidArgumentException if an entry does not contain
+a \e Terms array or its \e Steps value is less than 1. If \e levelArray is nil the default levels are used.
+Changes take effect the next time production begins.
+*/
+- (void) setLevels: (NSArray*) levelArray;
+/**
+Returns the time step of the outermost level.
+*/
+- (double) outerTimeStep;
+@end
+
+#endif
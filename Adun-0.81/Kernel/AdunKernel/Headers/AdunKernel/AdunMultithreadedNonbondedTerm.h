@@ -26,23 +26,85 @@
 /**
 \ingroup Inter
 Enables multithreading of a nonbonded term object.
-\todo Test implementation
+The nonbonded pairs are divided between a number of copies of the term. One copy
+is evaluated in the calling thread and the rest by the workers of the shared thread team
+(see ThreadTeam), which is also used by the other threaded objects of the kernel.
+
+Each thread is assigned a contiguous block of elements chosen so that the number of
+pairs in each threads list is approximately equal. Each time the lists are updated the
+number of pairs in each list is checked and, if the ratio of the largest to the mean
+exceeds loadImbalanceTolerance(), the pairs are redivided using the current per-element 
+pair counts.
+
+Each copy accumulates its forces in its own matrix. The matrices of the worker
+copies are aligned on cache line boundaries. After each force evaluation the matrices
+are summed in parallel with each thread reducing a block of rows.
+
+When the contents of the system change the thread force matrices are recreated and
+the pairs are redivided before the next evaluation.
+
+If the term rebuilds its list when the element displacements exceed half its skin
+(see AdPureNonbondedTerm::setUpdatesListOnDisplacement:) the displacements are checked before each evaluation
+and all the lists are updated together. Otherwise they are updated every AdNonbondedTerm::updateInterval() steps of the term.
+
+When created from a template the dictionary keys are 
+- \e term The AdNonbondedTerm to thread
+- \e numberOfThreads (optional) The total number of threads to use, including the calling thread.
+If not present or less than 1 AdDefaultNumberOfThreads() threads are used.
 */
 @interface AdMultithreadedNonbondedTerm: AdNonbondedTerm
 {
-	int numberOfProcessors;
+	int numberOfProcessors;	//The number of threads used including the main thread
 	id mainTerm;
 	id threadedTerms;
 	id allTerms;
 	id dividedPairs;
+	id allPairs;
+	int* partitionBoundaries;	//The first element assigned to each thread (plus the total)
+	double* threadTimes;		//The time each thread took for the last evaluation
+	AdMatrix** threadForces;	//The force matrix of each thread. Those of the workers are cache aligned
+	double loadImbalanceTolerance;
+	BOOL updateOnDisplacement;	//YES if the lists are updated when the main term requires it
+	BOOL contentsChanged;		//YES if the system contents changed since the pairs were divided
+	int* reductionBoundaries;	//The first row summed by each thread (plus the total)
 	AdMatrix* forces;
-	id threadManager;
 }
 /**
 Returns a new AdMultithreadedNonbondedTerm instance that
 can be used to do threaded calculation with \e nonbondedTerm
 */
 - (id) initWithTerm: (AdNonbondedTerm*) nonbondedTerm;
+/**
+Designated initialiser. Returns a new AdMultithreadedNonbondedTerm instance that
+divides the calculation of \e nonbondedTerm between \e number threads (including the calling thread).
+If \e number is less than 1 AdDefaultNumberOfThreads() threads are used.
+If \e number is 1 \e nonbondedTerm is returned.
+*/
+- (id) initWithTerm: (AdNonbondedTerm*) nonbondedTerm numberOfThreads: (int) number;
+/**
+Returns the number of threads the receiver uses including the calling thread.
+*/
+- (int) numberOfThreads;
+/**
+Returns an array containing the number of pairs in the list of each thread.
+The first entry is the thread the receiver was called from.
+*/
+- (NSArray*) pairCounts;
+/**
+Returns an array containing the time in seconds each thread took for the last
+energy or force evaluation. The first entry is the thread the receiver was called from.
+*/
+- (NSArray*) threadTimings;
+/**
+Sets the maximum allowed ratio of the largest number of pairs assigned to a thread
+to the mean number. If this is exceeded when the lists are updated the
+pairs are redivided. Must be at least 1. Defaults to 1.05.
+*/
+- (void) setLoadImbalanceTolerance: (double) value;
+/**
+Returns the load imbalance tolerance.
+*/
+- (double) loadImbalanceTolerance;
 @end
 
 #endif
@@ -0,0 +1,153 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#ifndef _ADNONBONDEDPAIRARRAY_H_
+#define _ADNONBONDEDPAIRARRAY_H_
+
+#include <Foundation/Foundation.h>
+#include "AdunKernel/AdunDefinitions.h"
+#include "AdunKernel/AdIndexSetConversions.h"
+
+/**
+\ingroup Inter
+AdNonbondedPairArray is an immutable NSArray of NSIndexSets which describes the allowed nonbonded pairs
+of a set of elements (see the requirements section of the AdListHandler class documentation).
+It stores the pairs as exclusions instead of storing every allowed pair.
+
+The allowed partners of element \e i are all the elements from a lower bound (usually \e i + 1) up to
+the last element, less the excluded elements of \e i.
+For molecules the excluded elements are those which take part in a bonded interaction with \e i,
+so the memory required grows linearly with the number of elements instead of quadratically.
+As with arrays of NSIndexSets the last element usually has no entry.
+
+The index set for an element is created when it is requested via objectAtIndex:().
+Objects which use the pairs of many elements, e.g. AdCellListHandler, should use the methods
+in the CompactAccess category to retrieve the bounds and exclusions of each element directly.
+
+AdNonbondedPairArray instances are archived as normal arrays.
+*/
+@interface AdNonbondedPairArray: NSArray
+{
+	@private
+	int numberOfElements;
+	int numberOfSets;
+	int* lowerBounds;	//The first possible partner of each element
+	int* exclusionOffsets;	//The index in exclusions of the first exclusion of each element
+	int* exclusions;	//The sorted exclusions of each element
+}
+/**
+Returns a new array for \e number elements where the partners of each element
+are all higher elements except those in the pairs contained in \e pairs.
+There are \e number - 1 index sets.
+\param number The number of elements.
+\param pairs An array of 2*count ints. Each consecutive two ints identifies an excluded pair.
+The pairs can be in any order and can contain duplicates.
+\param count The number of pairs in \e pairs.
+*/
+- (id) initWithNumberOfElements: (int) number
+	exclusions: (int*) pairs
+	count: (int) count;
+/**
+Designated initialiser.
+The partners of element \e i, where \e i is less than \e sets, are all elements
+from \e bounds[i] to \e number - 1 except \e excluded[offsets[i]] to
+\e excluded[offsets[i+1] - 1].
+The arrays are copied.
+\param number The number of elements.
+\param sets The number of index sets. Cannot be greater than \e number.
+\param bounds The lower bound of each element. If this is NULL the lower bound of element \e i is \e i + 1.
+\param offsets An array of \e sets + 1 ints giving the first exclusion of each element.
+If NULL no elements are excluded.
+\param excluded The excluded elements of each element in increasing order. Elements outside
+the range defined by the lower bound and \e number are ignored.
+*/
+- (id) initWithNumberOfElements: (int) number
+	numberOfSets: (int) sets
+	lowerBounds: (int*) bounds
+	exclusionOffsets: (int*) offsets
+	exclusions: (int*) excluded;
+/**
+Returns a new array containing the same pairs as \e anArray which must be an array
+of NSIndexSets. If \e anArray is an AdNonbondedPairArray the receiver is a copy of it.
+\param anArray An NSArray of NSIndexSets.
+\param number The number of elements. If this is less than one more than the
+highest index in \e anArray it is increased accordingly.
+*/
+- (id) initWithIndexSetArray: (NSArray*) anArray numberOfElements: (int) number;
+/**
+Returns a new array from the ranges of a set of index sets.
+The ranges of each set are consecutive in \e ranges and \e counts
+gives the number of ranges in each set.
+\param number The number of elements. If this is less than one more than the
+highest index in \e ranges it is increased accordingly.
+*/
+- (id) initWithRanges: (NSRange*) ranges
+	rangesPerSet: (int*) counts
+	numberOfSets: (int) sets
+	numberOfElements: (int) number;
+@end
+
+/**
+Category containing methods for accessing the contents of an
+AdNonbondedPairArray without creating NSIndexSets.
+\ingroup Inter
+*/
+@interface AdNonbondedPairArray (CompactAccess)
+/**
+Returns the number of elements.
+*/
+- (int) numberOfElements;
+/**
+Returns the total number of allowed pairs.
+*/
+- (unsigned long long) numberOfPairs;
+/**
+Returns the total number of excluded pairs. This does not include pairs
+excluded by the lower bounds.
+*/
+- (unsigned int) numberOfExclusions;
+/**
+Returns the lowest possible partner of element \e index. If \e index
+is greater than or equal to the number of sets this is numberOfElements().
+*/
+- (int) lowerBoundForElement: (int) index;
+/**
+Returns a pointer to the sorted excluded partners of element \e index and places
+their number in \e count.
+Under no circumstances should the returned array be modified.
+*/
+- (int*) exclusionsForElement: (int) index count: (int*) count;
+/**
+Returns an array with the same number of sets as the receiver where the sets of the elements
+outside \e range are empty.
+*/
+- (AdNonbondedPairArray*) pairArrayForElementsInRange: (NSRange) range;
+/**
+Returns the array resulting from removing the element \e index.
+The element is removed from every index set and the indexes higher than it
+are decreased by one. The set of element \e index, or the last set
+if \e index is equal to the number of sets, is also removed.
+Raises an NSRangeException if \e index is greater than the number of sets.
+*/
+- (AdNonbondedPairArray*) pairArrayByRemovingElement: (unsigned int) index;
+@end
+
+#endif
@@ -0,0 +1,224 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#ifndef _ADPMENONBONDED_TERM	
+#define _ADPMENONBONDED_TERM
+#include "Base/AdForceFieldFunctions.h"
+#include "Base/AdPairList.h"
+#include "Base/AdPeriodicBox.h"
+#include "Base/AdParticleMeshEwald.h"
+#include "AdunKernel/AdunDataMatrix.h"
+#include "AdunKernel/AdunNonbondedTerm.h"
+#include "AdunKernel/AdunDefinitions.h"
+#include "AdunKernel/AdunMemoryManager.h"
+#include "AdunKernel/AdunListHandler.h"
+#include "AdunKernel/AdunSystem.h"
+#include "AdunKernel/AdunCellListHandler.h"
+#include "AdunKernel/AdunCuboidBox.h"
+
+/**
+\ingroup Inter
+Calculates the potential and the forces acting on a periodic system due to 
+coulomb electrostatic interactions, using the smooth particle mesh Ewald method, along
+with a lennard jones interaction.
+
+The coulomb interaction is split into a short range part, calculated
+over the pairs inside the cutoff, and a long range part calculated on a grid in reciprocal space.
+The short range part uses the list of pairs provided by an AdListHandler instance as
+AdPureNonbondedTerm does. See the AdPureNonbondedTerm class documentation for more.
+The long range part is calculated by spreading the charges onto a grid using B-splines, 
+which is then transformed using a three dimensional FFT. 
+The interactions of pairs that are not in the nonbonded pairs (e.g. bonded pairs) are removed
+from the reciprocal space result along with the self interaction of each charge.
+
+The accuracy of the reciprocal part depends on the grid spacing and the B-spline order while
+the accuracy of the short range part is set by the Ewald tolerance - the value of the screening function
+at the cutoff. The defaults (1.0 \f$ \AA \f$, 4 and 1E-5) give relative force errors of about 1E-3.
+
+The system must be periodic i.e. AdSystem::periodicBox or AdInteractionSystem::periodicBox must 
+not return nil. If it is an NSInvalidArgumentException is raised when the system is set.
+Since the reciprocal part is calculated for the whole system AdPMENonbondedTerm instances cannot
+be used with AdMultithreadedNonbondedTerm.
+
+\todo Affected by Task - Units.
+*/
+@interface AdPMENonbondedTerm: AdNonbondedTerm <AdListHandlerDelegate, NSCopying>
+{
+	@private
+	BOOL usingExternalForceMatrix;
+	unsigned int updateInterval;
+	int splineOrder;	//!< The order of the B-splines used for charge spreading
+	double buffer;
+	double cutoff;
+	double permittivity;
+	double electrostaticConstant;
+	double vdwPotential;	
+	double estPotential; 
+	double reciprocalPotential;	//!< The reciprocal space part of estPotential
+	double gridSpacing;	//!< The maximum distance between grid points
+	double ewaldTolerance;	//!< The value of the screening function at the cutoff
+	double ewaldCoefficient;
+	double* partialCharges;
+	AdMatrix* forces;
+	AdMatrix* parameters;
+	AdPairList* pairList;
+	AdPairList* exclusionList;	//!< The pairs whose reciprocal space interaction is removed
+	AdPMEGrid* pmeGrid;
+	AdPeriodicBox periodicBox;
+	NSString* lennardJonesType;
+	AdDataMatrix* elementProperties;
+	NSArray* pairs;
+	id listHandler;
+	id memoryManager;
+	id system;
+	NSString* messageId;
+	Class listHandlerClass;
+}
+/**
+As initWithSystem:() passing nil for \e system.
+*/
+- (id) init;
+/**
+As initWithSystem:cutoff:updateInterval:permittivity:gridSpacing:splineOrder:nonbondedPairs:externalForceMatrix:()
+with the following default values -
+
+- cutoff 9.0
+- updateInterval 20
+- permittivity 1.0
+- gridSpacing 1.0
+- splineOrder 4
+- nonbondedPairs nil
+- externalForceMatrix NULL
+*/
+- (id) initWithSystem: (id) system;
+/**
+As the designated initialiser passing AdCellListHandler for the list handler class
+*/
+- (id) initWithSystem: (id) aSystem 
+	cutoff: (double) aDouble
+	updateInterval: (unsigned int) anInt
+	permittivity: (double) epsilon
+	gridSpacing: (double) spacing
+	splineOrder: (int) order
+	nonbondedPairs: (NSArray*) nonbondedPairs
+	externalForceMatrix: (AdMatrix*) matrix;
+/**
+Designated initialiser.
+\param system The system on which the calculation is to be perfomed. Must be periodic.
+\param aDouble The cutoff to be used for the short range part.
+\param anInt The period at which the list should be updated.
+\param epsilon The relative permittivity.
+\param spacing The maximum distance between grid points along each axis. 
+The number of points along each axis is the smallest product of 2, 3 and 5 which satisfies this.
+\param order The order of the B-splines used to spread the charges onto the grid. Must be at least 3.
+\param nonbondedPairs The nonbonded pairs the calculation is to be performed on. If this is
+nil the object will use AdDataSource::elementPairsNotInInteractionsOfCategory: passing "Bonded" as
+the category to obtain the set.
+\param matrix An allocated AdMatrix instance where the calculated forces will be written. It must contain one row for
+each element in the system. If the dimensions of the matrix are incorrect an NSInvalidArgumentException is raised.
+If \e matrix is NULL the object will create and use its own force matrix.
+\param aClass The AdListHandler subclass to be used for handling the nonbonded list. If \e aClass is not
+an AdListHandler subclass an NSInvalidArgumentException is raised. If \e aClass is nil it defaults to
+AdCellListHandler.
+*/
+- (id) initWithSystem: (id) aSystem 
+	cutoff: (double) aDouble
+	updateInterval: (unsigned int) anInt
+	permittivity: (double) epsilon
+	gridSpacing: (double) spacing
+	splineOrder: (int) order
+	nonbondedPairs: (NSArray*) nonbondedPairs
+	externalForceMatrix: (AdMatrix*) matrix
+	listHandlerClass: (Class) aClass;
+/**
+Forces an update of the AdListHandler object the receiver
+uses. If \e reset is YES the receiver resets the counter 
+managed by the applications AdMainLoopTimer instance which
+determines the period between automatic list updates.
+*/
+- (void) updateList: (BOOL) reset;
+/**
+Returns the relative permittivity used.
+*/
+- (double) permittivity;
+/**
+Sets the relative permittivity to \e value.
+*/
+- (void) setPermittivity: (double) value;
+/**
+Returns the maximum distance between grid points.
+*/
+- (double) gridSpacing;
+/**
+Sets the maximum distance between grid points to \e value.
+\e value must be greater than 0 otherwise an NSInvalidArgumentException is raised.
+*/
+- (void) setGridSpacing: (double) value;
+/**
+Returns the order of the B-splines used to spread the charges.
+*/
+- (int) splineOrder;
+/**
+Sets the order of the B-splines used to spread the charges.
+\e value must be at least 3 otherwise an NSInvalidArgumentException is raised.
+*/
+- (void) setSplineOrder: (int) value;
+/**
+Returns the value of the screening function at the cutoff.
+*/
+- (double) ewaldTolerance;
+/**
+Sets the value of the screening function at the cutoff. 
+This determines the Ewald coefficient. Defaults to 1E-5.
+*/
+- (void) setEwaldTolerance: (double) value;
+/**
+Returns the Ewald coefficient being used.
+*/
+- (double) ewaldCoefficient;
+/**
+Returns the reciprocal space contribution to the electrostatic energy
+as calculated by the last call to evaluateEnergy() or evaluateForces().
+*/
+- (double) reciprocalSpaceEnergy;
+/**
+Returns an array containing the number of grid points along each axis.
+*/
+- (NSArray*) gridSize;
+/**
+\todo Not implemented
+*/
+- (void) evaluateLennardJonesForces;
+/**
+\todo Not implemented
+*/
+- (void) evaluateElectrostaticForces;
+/**
+ Returns a pointer to the list of nonbonded interaction pairs the receiver uses.
+ Under no circumstances should pairs be added or removed from this list.
+ It primarily provides a convienient way to avoid having to create multiple non-bonded lists.
+ i.e. if another object needs to iterate over the list of nonbonded pairs it can do so via
+ this method.
+ */
+- (AdPairList*) pairList;
+@end
+
+#endif
@@ -24,7 +24,8 @@
 #ifndef _ADPURENONBONDED_TERM
 #define _ADPURENONBONDED_TERM
 #include "Base/AdForceFieldFunctions.h"
-#include "Base/AdLinkedList.h"
+#include "Base/AdPairList.h"
+#include "Base/AdPeriodicBox.h"
 #include "AdunKernel/AdunDataMatrix.h"
 #include "AdunKernel/AdunNonbondedTerm.h"
 #include "AdunKernel/AdunDefinitions.h"
@@ -32,6 +33,7 @@
 #include "AdunKernel/AdunListHandler.h"
 #include "AdunKernel/AdunSystem.h"
 #include "AdunKernel/AdunCellListHandler.h"
+#include "AdunKernel/AdunCuboidBox.h"
 
 /**
 \ingroup Inter
@@ -47,6 +49,14 @@ If the list provided by the AdListHandler instance is invalidated due to an AdSy
 In this event the array of nonbonded pairs will be acquired from the system and used to rebuild the list
 i.e. overriding a nonbonded pair array specified previously.
 
+The list contains all pairs within the cutoff plus a skin (default 1.5). By default the list is
+only rebuilt when an element has moved more than half the skin since the last build. Since no pair can
+then have closed by more than the skin, no interacting pair is missed, while the list is
+not rebuilt when the system is barely moving. Each evaluation checks the displacements, which costs much less
+than the evaluation itself. Use setUpdatesListOnDisplacement:() to return to rebuilding
+every updateInterval() steps. listStatistics() reports how often the list is rebuilt, which can
+be used to balance the skin (list size) against the rebuild rate for a given system.
+
 \todo Extra Documentation - Add mathematical definition of term.
 \todo Extra Methods - Full init chain.
 \todo Refactor - Change permittivity to relative permittivity to help clarity.
@@ -55,16 +65,24 @@ i.e. overriding a nonbonded pair array specified previously.
 {
 	@private
 	BOOL usingExternalForceMatrix;
+	BOOL autoUpdateList;
+	BOOL updateOnDisplacement;	//YES if the list is rebuilt when an element moves more than buffer/2
+	BOOL periodic;
 	unsigned int updateInterval;
+	unsigned int numberOfChecks;	//Displacement checks since the statistics were reset
+	unsigned int numberOfBuilds;	//List builds since the statistics were reset
 	double cutoff;
 	double permittivity;
 	double vdwPotential;	
 	double estPotential; 
-	double buffer;
+	double buffer;			//The skin
+	double maximumDisplacement;	//The largest displacement found by the last check
 	double* partialCharges;
 	AdMatrix* forces;
 	AdMatrix* parameters;
-	ListElement* interactionList;
+	AdPairList* pairList;
+	AdMatrix* referenceCoordinates;	//The coordinates the list was built from
+	AdPeriodicBox periodicBox;
 	NSString* lennardJonesType;
 	AdDataMatrix* elementProperties;
 	NSArray* pairs;
@@ -146,19 +164,55 @@ determines the period between automatic list updates.
 */
 - (void) updateList: (BOOL) reset;
 /**
-Sets whether the receiver will automatically update its nonbonded list
-every updateInterval() steps. 
+Sets whether the receiver will automatically update its nonbonded list, either
+every updateInterval() steps or when the displacement since the last update exceeds half the skin.
 By default this is yes for every AdNonbondedTerm object instance on its creation
 */
 - (void) setAutoUpdateList: (BOOL) value;
 /**
-Returns a pointer to the beginning of the list of nonbonded interaction pairs the receiver uses.
-Under no circumstances should elements be added or removed to this list.
+If \e value is YES (the default) the list is rebuilt only when an element has moved more
+than half the skin since the last build. If NO it is rebuilt every updateInterval() steps.
+*/
+- (void) setUpdatesListOnDisplacement: (BOOL) value;
+/**
+Returns YES if the list is rebuilt based on the element displacements.
+*/
+- (BOOL) updatesListOnDisplacement;
+/**
+Returns the distance beyond the cutoff up to which pairs are included in the list.
+*/
+- (double) skin;
+/**
+Sets the skin to \e value. The list is rebuilt on the next evaluation.
+Raises an NSInvalidArgumentException if \e value is negative.
+*/
+- (void) setSkin: (double) value;
+/**
+Returns YES if an element has moved more than half the skin since the list was last built.
+*/
+- (BOOL) listNeedsUpdate;
+/**
+Returns a dictionary describing how often the list has been rebuilt since the receiver
+was created or resetListStatistics() was last called. It contains the following keys -
+- Checks - The number of displacement checks.
+- Builds - The number of times the list was built.
+- ChecksPerBuild - The mean number of checks between builds.
+- MaximumDisplacement - The largest displacement found by the last check.
+- Skin - The current skin.
+*/
+- (NSDictionary*) listStatistics;
+/**
+Resets the list statistics.
+*/
+- (void) resetListStatistics;
+/**
+Returns a pointer to the list of nonbonded interaction pairs the receiver uses.
+Under no circumstances should pairs be added or removed from this list.
 It primarily provides a convienient way to avoid having to create multiple non-bonded lists.
 i.e. if another object needs to iterate over the list of nonbonded pairs it can do so via
 this method.
 */
-- (ListElement*) interactionList;
+- (AdPairList*) pairList;
 @end
 
 #endif
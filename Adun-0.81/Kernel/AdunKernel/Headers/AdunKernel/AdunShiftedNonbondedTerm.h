@@ -24,7 +24,7 @@
 #ifndef _ADSHIFTEDNONBONDED_TERM_
 #define _ADSHIFTEDNONBONDED_TERM_
 #include "Base/AdForceFieldFunctions.h"
-#include "Base/AdLinkedList.h"
+#include "Base/AdPairList.h"
 #include "AdunKernel/AdunDataMatrix.h"
 #include "AdunKernel/AdunNonbondedTerm.h"
 #include "AdunKernel/AdunDefinitions.h"
@@ -61,7 +61,7 @@ documentation for more.
 	double* partialCharges;
 	AdMatrix* forces;
 	AdMatrix* parameters;
-	ListElement* interactionList;
+	AdPairList* pairList;
 	NSString* lennardJonesType;
 	AdDataMatrix* elementProperties;
 	NSArray* pairs;
@@ -143,13 +143,13 @@ determines the period between automatic list updates.
 */
 - (void) evaluateElectrostaticForces;
 /**
- Returns a pointer to the beginning of the list of nonbonded interaction pairs the receiver uses.
- Under no circumstances should elements be added or removed to this list.
+ Returns a pointer to the list of nonbonded interaction pairs the receiver uses.
+ Under no circumstances should pairs be added or removed from this list.
  It primarily provides a convienient way to avoid having to create multiple non-bonded lists.
  i.e. if another object needs to iterate over the list of nonbonded pairs it can do so via
  this method.
  */
-- (ListElement*) interactionList;
+- (AdPairList*) pairList;
 @end
 
 #endif
@@ -36,21 +36,14 @@ AdSimpleListHandler encapsulates the simplest algorithm for
 creating the nonbonded list - a brute force search. 
 Its is impratical for any moderately sized system (for both speed and memory reasons)
 but is useful for checking the function of more complicated handlers.
-AdSimpleListHandler instances maintain lists for the elements inside and outside the
-cutoff and hence require a large amount of memory to handle big systems.
-
-\todo Internal - The memory requirements can be reduced by using NSIndexSets to store the
-interactions outside the cutoff.
+On each update every allowed pair is checked and the list is rebuilt.
 */
 
 @interface AdSimpleListHandler: AdListHandler
 {
 	@private
 	BOOL listCreated;
-	ListElement* in_p;
-	ListElement* out_p;
-	ListElement* endin_p;
-	ListElement* endout_p;
+	AdPairList* pairList;
 	double cutoff;
 	int numberOfInteractions;
 	AdMatrix *coordinates;
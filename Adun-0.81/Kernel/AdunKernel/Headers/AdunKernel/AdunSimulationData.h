@@ -32,6 +32,7 @@
 #include <AdunKernel/AdunSystemCollection.h>
 #include <AdunKernel/AdunForceFieldCollection.h>
 #include <AdunKernel/AdunInteractionSystem.h>
+#include <AdunKernel/AdunCheckpointWriterQueue.h>
 
 /**
 \ingroup coreClasses
@@ -280,6 +281,15 @@ A call to closeFrame() finishes the write.
 
 Note that to save on IO energy data is not actually written to the store unless synchToStore() is called.
 
+\section Background Writing
+
+If the \e AsynchronousCheckpointing default is YES (the default) the data collected for each frame is
+passed to an AdCheckpointWriterQueue on closeFrame() and encoded and written on a background thread.
+In this case addTrajectoryCheckpoint() only copies the coordinates and velocities of the systems
+and scheduleSynchToStore() returns immediately, the synchronization being performed once the preceeding frames are written.
+The methods which return information on the written frames and rollBackToFrame:() wait for all pending frames
+to be written. Exceptions raised while writing are reraised by the next call to closeFrame().
+
 \section Iteration Header
 
 Usually the state of the systems stored in a frame is associated with a particular step of
@@ -307,8 +317,7 @@ state of other parts of the simulator ...
 	BOOL topologyCheckpoint;
 	BOOL energyCheckpoint;
 	int lastFrame;
-	NSMutableData* trajectoryData;		//!< The current trajectory checkpoint data
-	NSMutableDictionary* energyData;	//!< The current energy checkpoint data
+	AdEnergyRecorder* energyRecorder;	//!< Records the energy checkpoint data
 	NSString* iterationHeader;
 	NSNumber* iterationValue;
 	NSMutableDictionary* topologyData; //!< The current topology checkpoint data
@@ -316,6 +325,7 @@ state of other parts of the simulator ...
 	AdSystemCollection* systemCollection;
 	AdDataSet* stateData;
 	AdMutableDataMatrix* frames;
+	AdCheckpointWriterQueue* writerQueue;
 	id dataStorage;
 }
 /**
@@ -426,11 +436,17 @@ the number of frames.
 - (void) rollBackToFrame: (unsigned int) value;
 /**
 Writes all data held in memory to the store.
+If checkpoints are written in the background this waits for all closed frames to be written first.
 */
 - (void) synchToStore;
 /**
+As synchToStore() except if checkpoints are written in the background the write is performed
+by the writer thread and the method returns immediately.
+*/
+- (void) scheduleSynchToStore;
+/**
 Returns the data storage instance used by the object to access the 
-simulation data.
+simulation data. Waits for any frames being written in the background.
 */
 - (id) dataStorage;
 @end
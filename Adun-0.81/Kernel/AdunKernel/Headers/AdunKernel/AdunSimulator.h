@@ -23,8 +23,39 @@
 #define _ADSIMULATOR_
 
 #include <stdio.h>
+#include "Base/AdIntegrationFunctions.h"
 #include "AdunKernel/AdunConfigurationGenerator.h"
 
+/**
+\ingroup frameworkTypes
+The stages of the integration at which components are notified.
+Components can specify the stages they act at by implementing simulatorHooks.
+*/
+typedef enum
+{
+	AdSimulatorFirstVelocityUpdateHook = 1,		/**< simulatorWillPerformFirstVelocityUpdateForSystem: */
+	AdSimulatorWillPerformPositionUpdateHook = 2,	/**< simulatorWillPerformPositionUpdateForSystem: */
+	AdSimulatorDidPerformPositionUpdateHook = 4,	/**< simulatorDidPerformPositionUpdateForSystem: */
+	AdSimulatorWillPerformSecondVelocityUpdateHook = 8,	/**< simulatorWillPerformSecondVelocityUpdateForSystem: */
+	AdSimulatorDidPerformSecondVelocityUpdateHook = 16,	/**< simulatorDidPerformSecondVelocityUpdateForSystem: */
+	AdSimulatorAllHooks = 31
+}
+AdSimulatorHook;
+
+/**
+\ingroup frameworkTypes
+The precomputed information needed to integrate one system.
+*/
+typedef struct
+{
+	id system;
+	int numberOfSources;
+	id* forceFields;		//!< The active force fields whose accelerations act on the system
+	int* offsets;			//!< The row of the system in the accelerations of each force field
+	double** accelerations;		//!< Holds the acceleration arrays used at each step
+}
+AdSystemIntegrationPlan;
+
 /**
 \ingroup Inter
 
@@ -71,6 +102,17 @@ us to define a uniform interface for component objects which allow customisation
 Any number of components can be added and they are called in the order they were added. 
 After each stage of the verlet algorithm a message is sent to the components allowing them to perform custom actions. 
 See the AdSimulatorComponent protocol for the component interface.
+For example AdBondConstraints uses the position and second velocity updates to apply SHAKE/RATTLE
+and SETTLE bond constraints, which allows larger time steps.
+
+<b> Integration Plan </b>
+
+The force fields acting on each system, including those of the interaction systems it is part of,
+and the components acting at each stage are determined when production begins. This information
+is rebuilt when the simulator receives an AdSystemContentsDidChangeNotification, AdSystemStatusDidChangeNotification
+or AdForceFieldCollectionDidChangeNotification, or when its systems, force fields or components are changed.
+The accelerations of all the force fields acting on a system are summed in the same pass as the
+velocity update and, if no component acts before the position update, the positions are updated in that pass as well.
 
 \note The contents of the AdSystemCollection object should not be modified e.g. from another thread
 during a call to AdSimulator::production().
@@ -80,7 +122,7 @@ changed during a production loop, the simulator components would not be informed
 
 @interface AdSimulator: AdConfigurationGenerator 
 {
-	@private
+	@protected
 	BOOL endSimulation;
 	int numberOfSteps;		//!< The number of steps to be taken
 	int currentStep;		//!< The current step
@@ -96,6 +138,12 @@ changed during a production loop, the simulator components would not be informed
 	AdSystemCollection* systemCollection;
 	AdForceFieldCollection* forceFieldCollection;
 	AdMainLoopTimer* timer;			//!< Scheduler that is incremented every simulation loop
+	BOOL planIsValid;			//!< NO if the integration plan must be rebuilt
+	int numberOfPlannedSystems;
+	AdSystemIntegrationPlan* systemPlans;	//!< The integration plan of each system
+	int hookCounts[5];			//!< The number of components acting at each stage
+	id* hookComponents[5];			//!< The components acting at each stage
+	IMP* hookMethods[5];			//!< The implementation of the stage method of each component
 }
 /**
 As initWithForceFields:() passing nil for \e aForceFieldCollection
@@ -187,6 +235,21 @@ in the returned array is the same as the order they were added.
 - (NSArray*) allComponents;
 @end
 
+/**
+Methods for AdSimulator subclasses which use the integration plan.
+*/
+@interface AdSimulator (AdIntegrationPlan)
+/**
+Rebuilds the integration plan. Called automatically by AdSimulator when
+production begins and, on the next step, after the plan becomes invalid.
+*/
+- (void) buildIntegrationPlan;
+/**
+Sends the message corresponding to \e hook to each component acting at that stage.
+*/
+- (void) notifyComponentsOfHook: (AdSimulatorHook) hook forSystem: (AdSystem*) aSystem;
+@end
+
 /**
 Protocol for objects that wish to act as a AdSimulator components. 
 The methods are called in a strict order. Firstly the following methods
@@ -203,7 +266,9 @@ systems before calling the following methods for each.
 - simulatorDidPerformSecondVelocityUpdateForSystem:()
 
 \note
-Components do not have to perform actions at all steps. 
+Components do not have to perform actions at all steps. Components can implement
+simulatorHooks, returning a combination of AdSimulatorHook values, in which case they are only sent the
+corresponding messages. This allows the simulator to skip stages where no component acts.
 
 \note
 To avoid circular references objects conforming to AdSimulatorComponent
@@ -247,4 +312,16 @@ being sent to the AdSimulator object.
 */
 - (void) simulatorDidFinishProduction: (AdSimulator*) aSimulator;
 @end
+
+/**
+Informal protocol for AdSimulatorComponent objects which only act at some stages.
+\ingroup Protocols
+*/
+@interface NSObject (AdSimulatorComponentHooks)
+/**
+Returns a bitwise OR of the AdSimulatorHook values for the stages the receiver acts at.
+The value is read when the integration plan is built.
+*/
+- (unsigned int) simulatorHooks;
+@end
 #endif
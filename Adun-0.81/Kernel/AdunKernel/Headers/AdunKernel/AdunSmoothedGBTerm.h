@@ -24,10 +24,10 @@
 
 #include "Base/AdMatrix.h"
 #include "Base/AdVector.h"
-#include "Base/AdLinkedList.h"
 #include "Base/AdGeneralizedBornFunctions.h"
 #include "Base/AdVolumeFunctions.h"
 #include "Base/AdQuadratureFunctions.h"
+#include "Base/AdThreadTeam.h"
 #include "AdunKernel/AdunMoleculeCavity.h"
 #include "AdunKernel/AdunGrid.h"
 #include "AdunKernel/AdForceFieldTerm.h"
@@ -41,15 +41,46 @@
 #include "AdunKernel/AdunCellListHandler.h"
 #include "AdunKernel/AdunCuboidBox.h"
 
+/**
+The scratch buffers used by each part of an AdSmoothedGBTerm atom loop. When evaluating the
+Born radius derivatives each part adds the forces due to the atoms it processes
+to its own force matrix which are summed once all the atoms have been processed.
+*/
+typedef struct
+{
+	Vector3D* vectorArray;			//!< Holds the position derivatives at an integration point
+	AdMatrix* crossGradients;		//!< The derivatives of an atoms Born radius w.r.t each atom it interacts with
+	AdMatrix* forces;			//!< The forces calculated by the part
+	IntArrayStruct calculatedGradients;	//!< The atoms with a gradient at an integration point
+	IntArrayStruct interactions;		//!< The atoms with a non-zero cross gradient
+	bool* interactingAtoms;			//!< Flags the atoms in interactions
+	IntArrayStruct gridPoints;		//!< The grid points an atom is a neighbour of
+	int gridPointsCapacity;			//!< The number of indexes gridPoints has space for
+	AdVolumeBlock* volumeBlock;		//!< The points of a radial shell whose volume function is calculated together
+	int* blockPoints;			//!< The angular index of each point in volumeBlock
+	double* shellVolumes;			//!< The volume function at each point of a radial shell
+}
+AdGBSWThreadBuffers;
+
 /**
 Class which calculates the solvation energy and derivatives - polar and non-polar - of a system.
 Used the GB with smoothing function method developed by Im, Lee and Brooks (J.Comp.Chem 24, 1694)
 It requires knowledge of the nonbonded term object calculating the colomb energy
 for optimal performance through use of the same nonbonded list.
 
+The Born radii, the SASA and the Born radius derivatives of the atoms are independent of each other
+so the loops over the atoms are divided into numberOfThreads() parts and run on the shared thread team
+(see ThreadTeam). The atoms are divided into blocks which are assigned to the parts in turn.
+
+The atoms near each point of the lookup grid are stored consecutively in a single array. Each point
+is followed by a few free entries so the table can be updated in place. The table is built with
+a neighbour cutoff extended by a buffer. Atoms are only moved in the table once they are more than the
+buffer from their position when they were added, and only the grid points near these atoms are changed.
+The table is rebuilt, using the thread team, if many atoms have moved or a grid point runs out of space.
+
 \todo Possible factor out the integration point and solute grid parts to other classes.
-\note At the moment the nonbonded term provided is expected to return a linked list of ListElement
-structures containing the nonbonded pairs.
+\note At the moment the nonbonded term provided is expected to return the nonbonded pairs
+as an ::AdPairList, the flat compressed sparse row table built by AdListHandler, from its pairList method.
 \ingroup Inter
 \todo Size of Cavity used to define lookup table seems to be affecting result slightly even 
 though it should not be.
@@ -63,7 +94,7 @@ though it should not be.
 	double integrationStartPoint;	//!< Arbitrary start point for the integration
 	double solventPermittivity;
 	double tensionCoefficient;
-	double cutBuffer;		//!< Value used so the lookup table doesn't have update every step
+	double cutBuffer;		//!< The distance atoms can move before they are moved in the lookup table
 	double meshSize;		//!< The size of the mesh of the grid used with the lookup table.
 	double cutoff;
 	id nonbondedTerm;		//!< The nonbonded term calculating the coulomb interactions
@@ -85,13 +116,20 @@ though it should not be.
 	double* atomSasas;		//!< Array containing the sasa of each atom.
 	AdMatrix* selfEnergy;		//!< Matrix self-energy, and CFA terms for each atom.
 	AdMatrix* selfGradients;	//!< Matrix containing the derivative of each atoms Born radius w.r.t. its position.
-	AdMatrix* crossGradients;	//!< Holds the derivatives of an atoms born radius w.r.t each atom it interacts with
-	Vector3D* vectorArray;		//!< Holder array
+	
+	//Threads
+	int numberOfThreads;			//!< The number of parts the atom loops are divided into
+	AdGBSWThreadBuffers* threadBuffers;	//!< The buffers of each part. The first uses the forces matrix.
 	
 	//SoluteGrid
-	int** neighbourTable;		//!< Each int array contains the indexes of atoms near a specific grid point
+	int* neighbourTable;		//!< The indexes of the atoms near each grid point stored consecutively
+	int* neighbourOffsets;		//!< The position in neighbourTable of the first neighbour of each grid point
+	int tableCapacity;		//!< The number of indexes neighbourTable has space for
+	volatile int tableBuildFailed;	//!< Set if an atom is not covered by the grid while the table is built
 	IntArrayStruct numberNeighbours;	//!< Holds the number of neighbours for each grid point
+	AdMatrix* tablePositions;	//!< The position of each atom when it was added to the table
 	AdMatrix* gridCutMatrix;	//!< Holds the cutoff point and its square for each atom
+	int gridTicks[3];		//!< The number of grid points on each axis
 	AdGrid* soluteGrid;		//!< A cartesian grid in a volume defined by the solute vdw radius + delta R.
 	AdCuboidBox* cavity;		//!< The cavity object defining the volume where the grid exists.
 	uint_fast8_t *overlapBuffer;	//!< Used to check if the grid needs to be rebuilt
@@ -102,9 +140,7 @@ though it should not be.
 	//Integration Points
 	int numberRadialPoints;
 	int numberAngularPoints;
-	AdMatrix* radialInfo;	//The radial distances of each integration ''shell'' and the integration weight
-	AdMatrix* angularInfo;	//The angles of the points in each shell and their integration weights
-	Vector3D** integrationPoints;	//!< A matrix of vectors giving the position of each integration point.
+	AdQuadratureGrid* quadratureGrid;	//!< The radial and angular points and weights. Shared by all terms using the same points.
 	
 	//Precomputed Constants
 	float integrationFactorOne;	//!< 1/integrationStartPoint
@@ -158,6 +194,16 @@ The energy columns are in Sim units.
 Returns the last calculate non-polar energy
 */
 - (double) nonPolarEnergy;
+/**
+Returns the number of parts the Born radii, SASA and derivative loops are divided into.
+Defaults to AdDefaultNumberOfThreads().
+*/
+- (int) numberOfThreads;
+/**
+Sets the number of parts the Born radii, SASA and derivative loops are divided into to \e number.
+Each part has its own AdGBSWThreadBuffers. If \e number is less than 1 the loops are not divided.
+*/
+- (void) setNumberOfThreads: (int) number;
 @end
  
 @interface AdSmoothedGBTerm (AdForceFieldTermMethods) <AdForceFieldTerm>
@@ -171,6 +217,9 @@ Returns the last calculate non-polar energy
  Methods for setting up the integrations points and weights
  */
 @interface AdSmoothedGBTerm (IntegrationMethods)
++ (void) _initQuadratureGrids;
+- (AdQuadratureGrid*) _readQuadratureGrid: (NSString*) name;
+- (AdQuadratureGrid*) _generateQuadratureGrid;
 - (void) _initIntegrationVariables;
 - (void) _cleanUpIntegrationVariables;
 @end
@@ -180,9 +229,26 @@ Returns the last calculate non-polar energy
  */
 @interface AdSmoothedGBTerm (LookupTableMethods)
 /**
- Recalculate the lookup table
+ Recalculate the lookup table using the thread team.
+ Returns NO if an atom is not covered by the grid.
  */
 - (BOOL) _createLookupTable;
+/**
+ Moves the atoms that are further than cutBuffer from their table position.
+ Returns NO if the table must be recreated instead.
+ */
+- (BOOL) _updateLookupTableIncrementally;
+/**
+ Places the indexes of the grid points an atom at \e position is a neighbour of in the gridPoints
+ array of \e buffers. Returns the number of points or -1 if \e position is not covered by the grid.
+ */
+- (int) _findGridPointsNearPosition: (double*) position 
+	ofAtom: (int) atomIndex 
+	buffers: (AdGBSWThreadBuffers*) buffers;
+- (void) _countGridNeighboursOfAtom: (int) atomIndex buffers: (AdGBSWThreadBuffers*) buffers;
+- (void) _addGridNeighboursOfAtom: (int) atomIndex buffers: (AdGBSWThreadBuffers*) buffers;
+- (void) _finishGridPoint: (int) gridIndex buffers: (AdGBSWThreadBuffers*) buffers;
+- (void) _setOverlapOfGridPoint: (int) gridIndex;
 - (void) _createGrid;
 - (void) _initLookupTableVariables;
 - (void) updateLookupTable;
@@ -197,7 +263,7 @@ Returns the last calculate non-polar energy
 @interface AdSmoothedGBTerm (BornRadiusMethods)
 - (void) _initBornRadiiVariables;
 - (void) _cleanUpBornRadiiVariables;
-- (void) _calculateBornRadiusAndCFATermsForAtom: (int) atomIndex;
+- (void) _calculateBornRadiusAndCFATermsForAtom: (int) atomIndex buffers: (AdGBSWThreadBuffers*) buffers;
 - (void) _calculateBornRadiiAndCFATerms;
 @end
 
@@ -206,9 +272,28 @@ Returns the last calculate non-polar energy
  derivative
  */		
 @interface AdSmoothedGBTerm (BornNonPolarMethods)
-- (double) _calculateSASAForAtom: (int) atomIndex;
+- (void) _calculateSASAForAtom: (int) atomIndex buffers: (AdGBSWThreadBuffers*) buffers;
 - (void) _calculateSASA;
 @end 
+
+/**
+ Methods for running a per atom method on the shared thread team.
+ */
+@interface AdSmoothedGBTerm (AtomLoopMethods)
+- (void) _initThreadBuffers;
+- (void) _cleanUpThreadBuffers;
+/**
+ Sends \e selector to the receiver for every element, dividing the elements into up to numberOfThreads() parts.
+ The method identified by \e selector must take an element index and a pointer to the AdGBSWThreadBuffers
+ of its part as arguments, and must only write data belonging to that element or
+ to the buffers. Returns the number of parts - the buffers of these parts were passed to the method.
+ */
+- (int) _runLoop: (SEL) selector numberOfElements: (int) number;
+/**
+ As _runLoop:numberOfElements: with one element for each atom.
+ */
+- (int) _runAtomLoop: (SEL) selector;
+@end
  
 /**		 
  Category containing methods for calculating the derivative of an atoms Born radius
@@ -227,8 +312,11 @@ Returns the last calculate non-polar energy
  This is because the gradient is only used in force calculations where, if this charge is zero,
  there is no force.
  Therefore, for optimisation, their is no point in calculating the gradient, in these cases.
+ 
+ The cross derivatives are added to \e buffers and their contribution to the forces to the
+ force matrix in \e buffers.
  */
-- (void) _calculateDerivativesWithRespectToAtom:(int) mainAtom;
+- (void) _calculateDerivativesWithRespectToAtom:(int) mainAtom buffers: (AdGBSWThreadBuffers*) buffers;
 @end
  
 //Contains optimised atomic radii from Nina et al.
@@ -111,6 +111,10 @@ else
 
 \endcode	
 
+The mementos are AdSystemMemento instances which hold raw copies of the matrices.
+Hence capturing a memento and returning to it each cost a copy of the recorded matrices.
+returnToState:() also accepts the AdDataSet mementos created by earlier versions.
+
 An AdSystem memento can only be used as long as the
 systems data source contains the same number of elements
 as when the memento was captured e.g. There are 
@@ -294,6 +298,20 @@ Moves the element identified by \e index to the origin
 */
 - (void) centreOnElement: (unsigned int) elementIndex;
 /**
+Returns the AdCuboidBox defining the periodic boundaries of the system.
+This is the cavity of the data source if the data source has one and it is
+a periodic AdCuboidBox. Otherwise returns nil.
+*/
+- (id) periodicBox;
+/**
+Translates the elements of the system back into the periodic box returned by periodicBox().
+If the data source defines the number of atoms per molecule (e.g. AdContainerDataSource) each molecule
+is translated as a whole based on the position of its first element. Otherwise the system is translated as a whole.
+Does nothing if the system is not periodic.
+Objects calling this method should bracket it with the AdMatrixModification methods for the coordinates matrix.
+*/
+- (void) wrapCoordinatesIntoPeriodicBox;
+/**
 Returns the name of the system. This is the same as the name of the
 systems data source. If no data source has been set then this method
 returns nil.
@@ -319,6 +337,16 @@ If no data source has been set then this is -1.
 */
 - (unsigned int) degreesOfFreedom;
 /**
+Sets the number of holonomic constraints, e.g. fixed bond lengths, acting on the elements
+of the system. Each constraint removes one degree of freedom. 
+This is usually set by a simulator component which applies the constraints e.g. AdBondConstraints.
+*/
+- (void) setNumberOfConstraints: (unsigned int) number;
+/**
+Returns the number of holonomic constraints acting on the elements of the system.
+*/
+- (unsigned int) numberOfConstraints;
+/**
 Returns the configuration of the elements of the system
 as an AdMatrix structure.  If no data source has been set 
 this method returns NULL. The returned matrix is owned
@@ -0,0 +1,141 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+#ifndef _ADUNSYSTEMMEMENTO_
+#define _ADUNSYSTEMMEMENTO_
+#include <Foundation/Foundation.h>
+#include <Base/AdMatrix.h>
+#include <Base/AdTrajectoryFrame.h>
+#include "AdunKernel/AdunDefinitions.h"
+#include "AdunKernel/AdunMemoryManager.h"
+#include "AdunKernel/AdunDataMatrix.h"
+#include "AdunKernel/AdunDataSet.h"
+
+/**
+\ingroup Inter
+AdSystemMemento is the memento returned by AdSystem::captureState.
+It holds raw copies of the coordinates and/or velocities of a system, as given by the
+systems capture mask, so creating one costs a copy of each matrix and returning a system
+to it costs the same.
+
+\section cow Copy on write
+
+The matrices are held in buffers which count the mementos sharing them. Copies of a memento share the buffers of the
+original and a buffer is only duplicated when a memento sharing it is modified through
+mutableCoordinates() or mutableVelocities(). The count is updated atomically so mementos can be passed between objects
+and threads without copying the data. However a memento must not be modified while it is being copied.
+The matrices returned by coordinates() and velocities() must not be modified.
+
+\section compatibility Compatibility
+
+Earlier versions used AdDataSet objects called \e AdSystemMemento as mementos.
+To remain compatible with code written for these AdSystemMemento responds to name(),
+valueForMetadataKey: (for the key \e MementoMask) and dataMatrixWithName: (for \e Coordinates and \e Velocities)
+in the same way. When archived an AdSystemMemento is replaced by the equivalent AdDataSet
+so archives can be read by earlier versions.
+Use dataSet() to explicitly obtain the AdDataSet.
+
+Mementos can be written as a binary trajectory frame using AdEncodeTrajectoryFrameFromMementos() and
+are returned by AdSystemMementoFromTrajectoryCheckpoint() for binary frames.
+*/
+@interface AdSystemMemento: NSObject <NSCopying>
+{
+	@private
+	int captureMask;
+	NSString* systemName;
+	id coordinatesBuffer;
+	id velocitiesBuffer;
+}
+/**
+Creates a memento containing a copy of the state of \e system as given by its capture mask.
+*/
++ (id) mementoWithSystem: (id) system;
+/**
+As initWithSystemName:captureMask:coordinates:velocities: with the values of \e system.
+*/
+- (id) initWithSystem: (id) system;
+/**
+Designated initialiser.
+\param aString The name of the system the memento is for.
+\param mask A bitwise OR of #AdSystemMementoValue values indicating what the memento contains.
+\param coordinates The coordinates to copy. Must be non-NULL if \e mask includes AdSystemCoordinatesMemento.
+If NULL the coordinates are allocated and set to 0.
+\param velocities As for \e coordinates but for the velocities.
+\param numberOfElements The number of rows allocated for matrices which are not copied.
+*/
+- (id) initWithSystemName: (NSString*) aString
+	captureMask: (int) mask
+	coordinates: (AdMatrix*) coordinates
+	velocities: (AdMatrix*) velocities
+	numberOfElements: (int) numberOfElements;
+/**
+Returns the name of the system the receiver was created from.
+*/
+- (NSString*) systemName;
+/**
+Returns the capture mask indicating what the receiver contains.
+*/
+- (int) captureMask;
+/**
+Returns the number of elements in the system the receiver was created from.
+*/
+- (int) numberOfElements;
+/**
+Returns the captured coordinates or NULL if the receiver doesn't contain them.
+The returned matrix must not be modified.
+*/
+- (AdMatrix*) coordinates;
+/**
+Returns the captured velocities or NULL if the receiver doesn't contain them.
+The returned matrix must not be modified.
+*/
+- (AdMatrix*) velocities;
+/**
+As coordinates() except the matrix can be modified. If the coordinates are shared with another memento
+they are copied first.
+*/
+- (AdMatrix*) mutableCoordinates;
+/**
+As velocities() except the matrix can be modified. If the velocities are shared with another memento
+they are copied first.
+*/
+- (AdMatrix*) mutableVelocities;
+/**
+Returns \e AdSystemMemento.
+*/
+- (NSString*) name;
+/**
+Returns the capture mask as an NSNumber if \e key is \e MementoMask. Otherwise returns nil.
+*/
+- (id) valueForMetadataKey: (NSString*) key;
+/**
+Returns a new AdDataMatrix containing the coordinates if \e aString is \e Coordinates
+or the velocities if it is \e Velocities. Returns nil otherwise or if the receiver
+does not contain the matrix.
+*/
+- (AdDataMatrix*) dataMatrixWithName: (NSString*) aString;
+/**
+Returns an AdDataSet equivalent to the receiver as created by earlier versions of AdSystem::captureState.
+*/
+- (AdDataSet*) dataSet;
+@end
+
+#endif
@@ -33,6 +33,7 @@
 #include <AdunKernel/AdunForceFieldCollection.h>
 #include <AdunKernel/AdunInteractionSystem.h>
 #include <AdunKernel/AdunFileSystemSimulationStorage.h>
+#include <AdunKernel/AdunCheckpointWriterQueue.h>
 
 /**
  \ingroup coreClasses
@@ -86,6 +87,10 @@
 	id systemCollection;
 	id dataStorage;
 	id frames;
+	int viewCapacity;		//!< The number of rows coordinateView can point to
+	int* viewElements;
+	AdMatrix coordinateView;	//!< The matrix returned by the coordinate view methods
+	AdMatrix* viewBuffer;		//!< Holds decoded coordinates when they can't be viewed in place
 }
 + (id) trajectoryFromLocation: (NSString*) location;
 + (id) trajectoryFromLocation: (NSString*) location error: (NSError**) error;
@@ -143,6 +148,33 @@ Retreives the coordinates for \e system in trajectory checkpoint \e number and p
 */
 - (void) coordinatesForSystem: (id) system inTrajectoryCheckpoint: (unsigned int) number usingBuffer: (AdMatrix*) buffer;
 /**
+As coordinateViewForSystem:elements:inTrajectoryCheckpoint: returning all the elements of \e system.
+*/
+- (AdMatrix*) coordinateViewForSystem: (id) system inTrajectoryCheckpoint: (unsigned int) number;
+/**
+Returns a matrix whose rows are the coordinates of the elements of \e system in \e indexes
+in trajectory checkpoint \e number. Row \e i of the matrix is the element with the \e i'th lowest index.
+If \e indexes is nil all the elements are returned.
+
+If the checkpoint was stored using the float64 encoding and the trajectory is memory mapped the rows point
+directly into the mapping, so no data is copied or decoded. Otherwise the coordinates are decoded into
+a buffer owned by the receiver.
+This is much faster than coordinatesForSystem:inTrajectoryCheckpoint:() for iterating over a trajectory.
+
+The returned matrix belongs to the receiver. It must not be modified or freed and is only valid until the next coordinate
+view is requested. Returns NULL if the coordinates of \e system were not recorded in the checkpoint.
+Raises an NSInvalidArgumentException if the checkpoint does not exist and an NSRangeException if
+an index in \e indexes exceeds the number of elements in \e system.
+*/
+- (AdMatrix*) coordinateViewForSystem: (id) system elements: (NSIndexSet*) indexes inTrajectoryCheckpoint: (unsigned int) number;
+/**
+Prefetches the trajectory checkpoints in \e aRange taking every \e stride'th one.
+Use before reading a strided range of checkpoints with the coordinate view methods.
+Checkpoints read in order are prefetched automatically.
+See AdFileSystemSimulationStorage::prefetchTrajectoryCheckpointsInRange:stride:
+*/
+- (void) prefetchTrajectoryCheckpointsInRange: (NSRange) aRange stride: (unsigned int) stride;
+/**
 Compares the checkpoints of the system \e ourSystem in the receiver to those of \e aSystem
 in \e aTrajectory. The range of frames to be compared are specified using \e range.
 
@@ -214,8 +246,7 @@ Force the receiver to re-read the trajectory data
 	BOOL topologyCheckpoint;
 	BOOL energyCheckpoint;
 	int lastFrame;
-	NSMutableData* trajectoryData;		//!< The current trajectory checkpoint data
-	NSMutableDictionary* energyData;	//!< The current energy checkpoint data
+	AdEnergyRecorder* energyRecorder;	//!< Records the energy checkpoint data
 	NSString* iterationHeader;
 	NSNumber* iterationValue;
 	NSMutableDictionary* topologyData; //!< The current topology checkpoint data
@@ -224,6 +255,7 @@ Force the receiver to re-read the trajectory data
 	AdDataSet* stateData;
 	AdMutableDataMatrix* frames;
 	AdTrajectory* trajectoryReader;
+	AdCheckpointWriterQueue* writerQueue;
 	id dataStorage;
 }
 + (id) trajectoryFromLocation: (NSString*) location;
@@ -316,11 +348,18 @@ Forthcoming
 - (void) rollBackToFrame: (unsigned int) value;
 /**
  Writes all data held in memory to the store.
+ If checkpoints are written in the background this waits for all closed frames to be written first
+ (see AdSimulationDataWriter).
  */
 - (void) synchToStore;
+/**
+ As synchToStore() except if checkpoints are written in the background the write is performed
+ by the writer thread and the method returns immediately.
+ */
+- (void) scheduleSynchToStore;
 /**
  Returns the data storage instance used by the object to access the 
- simulation data.
+ simulation data. Waits for any frames being written in the background.
  */
 - (id) dataStorage;
 @end
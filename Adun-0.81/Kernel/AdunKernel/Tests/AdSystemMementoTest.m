@@ -0,0 +1,258 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+/*
+ * Checks the copy on write behaviour of AdSystemMemento.
+ * Copies must share the matrices of the original until one of them is modified,
+ * modifying one must never change another, and a memento which no longer
+ * shares its matrices must modify them in place.
+ * The last test copies and modifies a memento on several threads at once.
+ */
+
+#include <stdio.h>
+#include <Foundation/Foundation.h>
+#include "AdunKernel/AdunSystemMemento.h"
+
+#define NUMBER_OF_ELEMENTS 40
+#define NUMBER_OF_THREADS 8
+#define NUMBER_OF_COPIES 200
+
+#define CHECK(condition, message) \
+	if(!(condition)) \
+	{ \
+		fprintf(stderr, "FAILED: %s\n", message); \
+		failures++; \
+	}
+
+static int failures = 0;
+
+static AdSystemMemento* CreateMemento(void)
+{
+	int i, j;
+	AdMatrix* coordinates, *velocities;
+	AdSystemMemento* memento;
+
+	coordinates = [[AdMemoryManager appMemoryManager]
+			allocateMatrixWithRows: NUMBER_OF_ELEMENTS
+			withColumns: 3];
+	velocities = [[AdMemoryManager appMemoryManager]
+			allocateMatrixWithRows: NUMBER_OF_ELEMENTS
+			withColumns: 3];
+	for(i=0; i<NUMBER_OF_ELEMENTS; i++)
+		for(j=0; j<3; j++)
+		{
+			coordinates->matrix[i][j] = i + 0.1*j;
+			velocities->matrix[i][j] = -i - 0.1*j;
+		}
+
+	memento = [[AdSystemMemento alloc]
+			initWithSystemName: @"Test"
+			captureMask: AdSystemCoordinatesMemento | AdSystemVelocitiesMemento
+			coordinates: coordinates
+			velocities: velocities
+			numberOfElements: NUMBER_OF_ELEMENTS];
+
+	[[AdMemoryManager appMemoryManager] freeMatrix: coordinates];
+	[[AdMemoryManager appMemoryManager] freeMatrix: velocities];
+
+	return [memento autorelease];
+}
+
+//Returns YES if the coordinates of memento have the values set by CreateMemento()
+static BOOL HasOriginalCoordinates(AdSystemMemento* memento)
+{
+	int i, j;
+	AdMatrix* coordinates = [memento coordinates];
+
+	for(i=0; i<NUMBER_OF_ELEMENTS; i++)
+		for(j=0; j<3; j++)
+			if(coordinates->matrix[i][j] != i + 0.1*j)
+				return NO;
+
+	return YES;
+}
+
+static void TestCopyOnWrite(void)
+{
+	AdMatrix* original, *modified;
+	AdSystemMemento* memento, *copy, *secondCopy;
+
+	memento = CreateMemento();
+	copy = [[memento copy] autorelease];
+	CHECK([copy coordinates] == [memento coordinates], "Copy does not share the coordinates");
+	CHECK([copy velocities] == [memento velocities], "Copy does not share the velocities");
+
+	//Extra retains of the memento must not cause a copy
+	[[memento retain] autorelease];
+	[[copy retain] autorelease];
+
+	//Modifying the copy duplicates the matrix being modified only
+	original = [memento coordinates];
+	modified = [copy mutableCoordinates];
+	CHECK(modified != original, "Modifying a shared matrix did not copy it");
+	CHECK([copy velocities] == [memento velocities], "Modifying the coordinates copied the velocities");
+	modified->matrix[3][1] = 1000;
+	CHECK(HasOriginalCoordinates(memento), "Modifying a copy changed the original");
+	CHECK(!HasOriginalCoordinates(copy), "Modification of the copy was lost");
+
+	//Neither memento now shares the coordinates so they are modified in place
+	CHECK([copy mutableCoordinates] == modified, "Unshared matrix of the copy was copied");
+	CHECK([memento mutableCoordinates] == original, "Unshared matrix of the original was copied");
+
+	//Once the other sharer is released the matrix is not copied
+	secondCopy = [memento copy];
+	original = [secondCopy velocities];
+	CHECK(original == [memento velocities], "Second copy does not share the velocities");
+	[secondCopy release];
+	CHECK([memento mutableVelocities] == original, "Matrix was copied after its other sharer was released");
+}
+
+/**
+Each thread repeatedly copies a shared memento, modifies the copy and checks that
+neither the copy or the shared memento was changed by any other thread.
+*/
+@interface MementoWriter: NSObject
+{
+	AdSystemMemento* memento;
+	NSConditionLock* lock;
+	int* threadsRunning;
+	int errors;
+}
+- (id) initWithMemento: (AdSystemMemento*) aMemento
+	lock: (NSConditionLock*) aLock
+	threadsRunning: (int*) counter;
+- (int) errors;
+@end
+
+@implementation MementoWriter
+
+- (id) initWithMemento: (AdSystemMemento*) aMemento
+	lock: (NSConditionLock*) aLock
+	threadsRunning: (int*) counter
+{
+	if((self = [super init]))
+	{
+		memento = [aMemento retain];
+		lock = [aLock retain];
+		threadsRunning = counter;
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[memento release];
+	[lock release];
+	[super dealloc];
+}
+
+- (void) run: (id) value
+{
+	int i;
+	double marker;
+	AdMatrix* coordinates;
+	AdSystemMemento* copy;
+	NSAutoreleasePool* pool = [NSAutoreleasePool new];
+
+	for(i=0; i<NUMBER_OF_COPIES; i++)
+	{
+		copy = [memento copy];
+		coordinates = [copy mutableCoordinates];
+		marker = (double)(long)self + i;
+		coordinates->matrix[0][0] = marker;
+		if([copy coordinates]->matrix[0][0] != marker)
+			errors++;
+
+		[copy release];
+	}
+
+	if(!HasOriginalCoordinates(memento))
+		errors++;
+
+	[lock lock];
+	(*threadsRunning)--;
+	[lock unlockWithCondition: (*threadsRunning == 0) ? 1 : 0];
+	[pool release];
+}
+
+- (int) errors
+{
+	return errors;
+}
+
+@end
+
+static void TestThreadedCopies(void)
+{
+	int i, errors, threadsRunning;
+	AdMatrix* original;
+	AdSystemMemento* memento;
+	NSConditionLock* lock;
+	NSMutableArray* writers;
+	MementoWriter* writer;
+
+	memento = CreateMemento();
+	original = [memento coordinates];
+	lock = [[[NSConditionLock alloc] initWithCondition: 0] autorelease];
+	writers = [NSMutableArray array];
+	threadsRunning = NUMBER_OF_THREADS;
+	for(i=0; i<NUMBER_OF_THREADS; i++)
+	{
+		writer = [[MementoWriter alloc] initWithMemento: memento
+				lock: lock
+				threadsRunning: &threadsRunning];
+		[writers addObject: writer];
+		[writer release];
+	}
+
+	for(i=0; i<NUMBER_OF_THREADS; i++)
+		[NSThread detachNewThreadSelector: @selector(run:)
+			toTarget: [writers objectAtIndex: i]
+			withObject: nil];
+
+	[lock lockWhenCondition: 1];
+	[lock unlock];
+
+	for(errors = 0, i=0; i<NUMBER_OF_THREADS; i++)
+		errors += [[writers objectAtIndex: i] errors];
+
+	CHECK(errors == 0, "Concurrent copies modified each other or the shared memento");
+	CHECK(HasOriginalCoordinates(memento), "Concurrent copies modified the shared memento");
+	CHECK([memento mutableCoordinates] == original,
+		"Matrix was copied after all concurrent copies were released");
+}
+
+int main(void)
+{
+	NSAutoreleasePool* pool = [NSAutoreleasePool new];
+
+	TestCopyOnWrite();
+	TestThreadedCopies();
+
+	if(failures == 0)
+		printf("AdSystemMementoTest: passed\n");
+
+	[pool release];
+
+	return failures == 0 ? 0 : 1;
+}
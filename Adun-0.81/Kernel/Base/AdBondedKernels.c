@@ -0,0 +1,536 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#include "Base/AdBondedKernels.h"
+
+//The number of interactions processed together by the kernels.
+#define AD_BONDED_BLOCK 64
+//Lower bound of the sine of a torsion angle used when dividing by it.
+#define AD_MIN_TORSION_SINE 1E-15
+
+typedef struct
+{
+	int lowestAtom;
+	int row;
+}
+AdBondedSortKey;
+
+static int AdCompareBondedSortKeys(const void* one, const void* two)
+{
+	const AdBondedSortKey* keyOne = one;
+	const AdBondedSortKey* keyTwo = two;
+
+	if(keyOne->lowestAtom != keyTwo->lowestAtom)
+		return (keyOne->lowestAtom < keyTwo->lowestAtom) ? -1 : 1;
+
+	//Keep the matrix order for interactions with the same lowest atom
+	return (keyOne->row < keyTwo->row) ? -1 : (keyOne->row > keyTwo->row);
+}
+
+static AdBondedTable* AdAllocateBondedTable(int numberInteractions, int numberAtoms, int numberParameters)
+{
+	int i;
+	AdBondedTable* table;
+
+	table = malloc(sizeof(AdBondedTable));
+	table->numberInteractions = numberInteractions;
+	table->numberAtoms = numberAtoms;
+	table->numberParameters = numberParameters;
+	for(i=0; i<4; i++)
+	{
+		table->atoms[i] = (i < numberAtoms) ? malloc((numberInteractions + 1)*sizeof(int)) : NULL;
+		table->parameters[i] = (i < numberParameters) ? malloc((numberInteractions + 1)*sizeof(double)) : NULL;
+	}
+	table->rows = malloc((numberInteractions + 1)*sizeof(int));
+
+	return table;
+}
+
+AdBondedTable* AdCreateBondedTable(AdMatrix* interactions, int numberAtoms, int numberParameters)
+{
+	int i, j, atom;
+	double* row;
+	AdBondedSortKey* keys;
+	AdBondedTable* table;
+
+	keys = malloc((interactions->no_rows + 1)*sizeof(AdBondedSortKey));
+	for(i=0; i<interactions->no_rows; i++)
+	{
+		row = interactions->matrix[i];
+		keys[i].row = i;
+		keys[i].lowestAtom = (int)row[0];
+		for(j=1; j<numberAtoms; j++)
+		{
+			atom = (int)row[j];
+			if(atom < keys[i].lowestAtom)
+				keys[i].lowestAtom = atom;
+		}
+	}
+
+	qsort(keys, interactions->no_rows, sizeof(AdBondedSortKey), AdCompareBondedSortKeys);
+
+	table = AdAllocateBondedTable(interactions->no_rows, numberAtoms, numberParameters);
+	for(i=0; i<interactions->no_rows; i++)
+	{
+		row = interactions->matrix[keys[i].row];
+		table->rows[i] = keys[i].row;
+		for(j=0; j<numberAtoms; j++)
+			table->atoms[j][i] = (int)row[j];
+
+		for(j=0; j<numberParameters; j++)
+			table->parameters[j][i] = row[numberAtoms + j];
+	}
+
+	free(keys);
+
+	return table;
+}
+
+AdBondedTable* AdCreateFourierTorsionTable(AdMatrix* torsions)
+{
+	int i;
+	double period, phase;
+	AdBondedTable* table;
+
+	for(i=0; i<torsions->no_rows; i++)
+	{
+		period = torsions->matrix[i][5];
+		if(period < 1 || period > AD_MAX_TORSION_PERIOD || period != floor(period))
+			return NULL;
+	}
+
+	//The constant, periodicity and phase are copied into the first three parameters
+	//and the phase is then replaced by its cosine and sine.
+	table = AdCreateBondedTable(torsions, 4, 3);
+	table->numberParameters = 4;
+	table->parameters[3] = malloc((table->numberInteractions + 1)*sizeof(double));
+	for(i=0; i<table->numberInteractions; i++)
+	{
+		phase = table->parameters[2][i];
+
+		//The common phases are set exactly so the sine term vanishes for them
+		//as it does in AdFourierTorsionForce().
+		if(phase == 0)
+		{
+			table->parameters[2][i] = 1;
+			table->parameters[3][i] = 0;
+		}
+		else if(phase == M_PI)
+		{
+			table->parameters[2][i] = -1;
+			table->parameters[3][i] = 0;
+		}
+		else
+		{
+			table->parameters[2][i] = cos(phase);
+			table->parameters[3][i] = sin(phase);
+		}
+	}
+
+	return table;
+}
+
+void AdFreeBondedTable(AdBondedTable* table)
+{
+	int i;
+
+	if(table == NULL)
+		return;
+
+	for(i=0; i<4; i++)
+	{
+		free(table->atoms[i]);
+		free(table->parameters[i]);
+	}
+
+	free(table->rows);
+	free(table);
+}
+
+/*
+ * Block helpers
+ */
+
+/*
+ * Adds the forces calculated for a block to the force matrix.
+ * force[3*k + j][i] is component j of the force on atom k of interaction start + i.
+ */
+static void AdScatterBlockForces(AdBondedTable* table, int start, int count,
+		double force[12][AD_BONDED_BLOCK], double** forces)
+{
+	int i, k;
+	int* atoms;
+	double* row;
+
+	for(k=0; k<table->numberAtoms; k++)
+	{
+		atoms = table->atoms[k] + start;
+		for(i=0; i<count; i++)
+		{
+			row = forces[atoms[i]];
+			row[0] += force[3*k][i];
+			row[1] += force[3*k + 1][i];
+			row[2] += force[3*k + 2][i];
+		}
+	}
+}
+
+/*
+ * Places the separation vector from atom \e from to atom \e to
+ * of each interaction in the block in \e vector.
+ */
+static void AdGatherBlockSeparations(AdBondedTable* table, int start, int count,
+		int from, int to, double** coordinates, double vector[3][AD_BONDED_BLOCK])
+{
+	int i;
+	int* fromAtoms, *toAtoms;
+	double *fromPosition, *toPosition;
+
+	fromAtoms = table->atoms[from] + start;
+	toAtoms = table->atoms[to] + start;
+	for(i=0; i<count; i++)
+	{
+		fromPosition = coordinates[fromAtoms[i]];
+		toPosition = coordinates[toAtoms[i]];
+		vector[0][i] = toPosition[0] - fromPosition[0];
+		vector[1][i] = toPosition[1] - fromPosition[1];
+		vector[2][i] = toPosition[2] - fromPosition[2];
+	}
+}
+
+/*
+ * Calculates the normals n1 = ba x bc and n2 = bc x cd of each torsion in the block
+ * and the cosine of the angle between them. ratio holds |n2|/|n1| and inverseRatio |n1|/|n2|.
+ * The cosine is limited to [-1, 1].
+ */
+static void AdTorsionBlockGeometry(int count, double ba[3][AD_BONDED_BLOCK],
+		double bc[3][AD_BONDED_BLOCK], double cd[3][AD_BONDED_BLOCK],
+		double nOne[3][AD_BONDED_BLOCK], double nTwo[3][AD_BONDED_BLOCK],
+		double* cosine, double* denominator, double* ratio, double* inverseRatio)
+{
+	int i;
+	double lengthOne, lengthTwo;
+
+	for(i=0; i<count; i++)
+	{
+		nOne[0][i] = ba[1][i]*bc[2][i] - ba[2][i]*bc[1][i];
+		nOne[1][i] = ba[2][i]*bc[0][i] - ba[0][i]*bc[2][i];
+		nOne[2][i] = ba[0][i]*bc[1][i] - ba[1][i]*bc[0][i];
+		nTwo[0][i] = bc[1][i]*cd[2][i] - bc[2][i]*cd[1][i];
+		nTwo[1][i] = bc[2][i]*cd[0][i] - bc[0][i]*cd[2][i];
+		nTwo[2][i] = bc[0][i]*cd[1][i] - bc[1][i]*cd[0][i];
+
+		lengthOne = sqrt(nOne[0][i]*nOne[0][i] + nOne[1][i]*nOne[1][i] + nOne[2][i]*nOne[2][i]);
+		lengthTwo = sqrt(nTwo[0][i]*nTwo[0][i] + nTwo[1][i]*nTwo[1][i] + nTwo[2][i]*nTwo[2][i]);
+		denominator[i] = lengthOne*lengthTwo;
+		ratio[i] = lengthTwo/lengthOne;
+		inverseRatio[i] = lengthOne/lengthTwo;
+		cosine[i] = (nOne[0][i]*nTwo[0][i] + nOne[1][i]*nTwo[1][i] + nOne[2][i]*nTwo[2][i])/denominator[i];
+		cosine[i] = fmin(fmax(cosine[i], -1.0), 1.0);
+	}
+}
+
+/*
+ * The forces on the atoms of each torsion in the block given the coefficients
+ * A and B of the derivatives of n1.n2 and |n1||n2| (see AdFourierTorsionForce()).
+ */
+static void AdTorsionBlockForces(int count, double ba[3][AD_BONDED_BLOCK],
+		double bc[3][AD_BONDED_BLOCK], double cd[3][AD_BONDED_BLOCK],
+		double nOne[3][AD_BONDED_BLOCK], double nTwo[3][AD_BONDED_BLOCK],
+		double* ratio, double* inverseRatio, double* A, double* B,
+		double force[12][AD_BONDED_BLOCK])
+{
+	int i;
+	double a0, a1, a2, b0, b1, b2, c0, c1, c2;
+	double n0, n1, n2, m0, m1, m2, r21, r12;
+	double ab0, ab1, ab2, bc0, bc1, bc2;
+
+	for(i=0; i<count; i++)
+	{
+		a0 = ba[0][i]; a1 = ba[1][i]; a2 = ba[2][i];
+		b0 = bc[0][i]; b1 = bc[1][i]; b2 = bc[2][i];
+		c0 = cd[0][i]; c1 = cd[1][i]; c2 = cd[2][i];
+		n0 = nOne[0][i]; n1 = nOne[1][i]; n2 = nOne[2][i];
+		m0 = nTwo[0][i]; m1 = nTwo[1][i]; m2 = nTwo[2][i];
+		r21 = ratio[i];
+		r12 = inverseRatio[i];
+		ab0 = a0 + b0; ab1 = a1 + b1; ab2 = a2 + b2;
+		bc0 = b0 + c0; bc1 = b1 + c1; bc2 = b2 + c2;
+
+		//atom 1
+		force[0][i] = A[i]*(b2*m1 - b1*m2) - B[i]*r21*(n1*b2 - n2*b1);
+		force[1][i] = A[i]*(b0*m2 - b2*m0) - B[i]*r21*(n2*b0 - n0*b2);
+		force[2][i] = A[i]*(b1*m0 - b0*m1) - B[i]*r21*(n0*b1 - n1*b0);
+
+		//atom 2
+		force[3][i] = A[i]*(ab1*m2 - ab2*m1 + c2*n1 - c1*n2)
+			- B[i]*(r21*(ab1*n2 - ab2*n1) + r12*(c2*m1 - c1*m2));
+		force[4][i] = A[i]*(ab2*m0 - ab0*m2 + c0*n2 - c2*n0)
+			- B[i]*(r21*(ab2*n0 - ab0*n2) + r12*(c0*m2 - c2*m0));
+		force[5][i] = A[i]*(ab0*m1 - ab1*m0 + c1*n0 - c0*n1)
+			- B[i]*(r21*(ab0*n1 - ab1*n0) + r12*(c1*m0 - c0*m1));
+
+		//atom 3
+		force[6][i] = A[i]*(bc1*n2 - bc2*n1 + a2*m1 - a1*m2)
+			- B[i]*(r12*(bc1*m2 - bc2*m1) + r21*(a2*n1 - a1*n2));
+		force[7][i] = A[i]*(bc2*n0 - bc0*n2 + a0*m2 - a2*m0)
+			- B[i]*(r12*(bc2*m0 - bc0*m2) + r21*(a0*n2 - a2*n0));
+		force[8][i] = A[i]*(bc0*n1 - bc1*n0 + a1*m0 - a0*m1)
+			- B[i]*(r12*(bc0*m1 - bc1*m0) + r21*(a1*n0 - a0*n1));
+
+		//atom 4
+		force[9][i] = A[i]*(b2*n1 - b1*n2) - B[i]*r12*(m1*b2 - m2*b1);
+		force[10][i] = A[i]*(b0*n2 - b2*n0) - B[i]*r12*(m2*b0 - m0*b2);
+		force[11][i] = A[i]*(b1*n0 - b0*n1) - B[i]*r12*(m0*b1 - m1*b0);
+	}
+}
+
+static double AdSumBlockEnergies(int count, double* energies)
+{
+	int i;
+	double energy = 0;
+
+	for(i=0; i<count; i++)
+		energy += energies[i];
+
+	return energy;
+}
+
+/*
+ * Kernels
+ */
+
+double AdEnzymixBondKernel(AdBondedTable* table, int start, int end, double** coordinates, double** forces)
+{
+	int i, blockStart, count;
+	double length, difference, coefficient, energy;
+	double* constant, *separation;
+	double ab[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double energies[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double force[12][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+
+	energy = 0;
+	for(blockStart = start; blockStart < end; blockStart += AD_BONDED_BLOCK)
+	{
+		count = (end - blockStart < AD_BONDED_BLOCK) ? end - blockStart : AD_BONDED_BLOCK;
+		constant = table->parameters[0] + blockStart;
+		separation = table->parameters[1] + blockStart;
+		AdGatherBlockSeparations(table, blockStart, count, 0, 1, coordinates, ab);
+
+		//U = k(r - r0)^2 and the force on atom two is -2k(r - r0)*ab/r
+		for(i=0; i<count; i++)
+		{
+			length = sqrt(ab[0][i]*ab[0][i] + ab[1][i]*ab[1][i] + ab[2][i]*ab[2][i]);
+			difference = length - separation[i];
+			energies[i] = constant[i]*difference*difference;
+			coefficient = -2*constant[i]*difference/length;
+			force[3][i] = coefficient*ab[0][i];
+			force[4][i] = coefficient*ab[1][i];
+			force[5][i] = coefficient*ab[2][i];
+			force[0][i] = -force[3][i];
+			force[1][i] = -force[4][i];
+			force[2][i] = -force[5][i];
+		}
+
+		energy += AdSumBlockEnergies(count, energies);
+		AdScatterBlockForces(table, blockStart, count, force, forces);
+	}
+
+	return energy;
+}
+
+double AdEnzymixAngleKernel(AdBondedTable* table, int start, int end, double** coordinates, double** forces)
+{
+	int i, j, blockStart, count;
+	double lengthOne, lengthThree, denominator, cosine, difference;
+	double coefficient, energy;
+	double* constant, *angle;
+	double ba[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double bc[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double energies[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double force[12][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+
+	energy = 0;
+	for(blockStart = start; blockStart < end; blockStart += AD_BONDED_BLOCK)
+	{
+		count = (end - blockStart < AD_BONDED_BLOCK) ? end - blockStart : AD_BONDED_BLOCK;
+		constant = table->parameters[0] + blockStart;
+		angle = table->parameters[1] + blockStart;
+		AdGatherBlockSeparations(table, blockStart, count, 1, 0, coordinates, ba);
+		AdGatherBlockSeparations(table, blockStart, count, 1, 2, coordinates, bc);
+
+		for(i=0; i<count; i++)
+		{
+			lengthOne = sqrt(ba[0][i]*ba[0][i] + ba[1][i]*ba[1][i] + ba[2][i]*ba[2][i]);
+			lengthThree = sqrt(bc[0][i]*bc[0][i] + bc[1][i]*bc[1][i] + bc[2][i]*bc[2][i]);
+			denominator = lengthOne*lengthThree;
+			cosine = (ba[0][i]*bc[0][i] + ba[1][i]*bc[1][i] + ba[2][i]*bc[2][i])/denominator;
+#ifdef SAFE_ANGLE
+			cosine = fmin(fmax(cosine, -1.0), 1.0);
+#endif
+			difference = acos(cosine) - angle[i];
+			energies[i] = constant[i]*difference*difference;
+
+			//2k(theta - theta0)*dtheta/du/|ba||bc| where u is the cosine
+			coefficient = 2*constant[i]*difference/(sqrt(1 - cosine*cosine)*denominator);
+			for(j=0; j<3; j++)
+			{
+				force[j][i] = coefficient*(bc[j][i] - (lengthThree/lengthOne)*cosine*ba[j][i]);
+				force[6 + j][i] = coefficient*(ba[j][i] - (lengthOne/lengthThree)*cosine*bc[j][i]);
+				force[3 + j][i] = -(force[j][i] + force[6 + j][i]);
+			}
+		}
+
+		energy += AdSumBlockEnergies(count, energies);
+		AdScatterBlockForces(table, blockStart, count, force, forces);
+	}
+
+	return energy;
+}
+
+double AdFourierTorsionKernel(AdBondedTable* table, int start, int end, double** coordinates, double** forces)
+{
+	int i, k, blockStart, count;
+	double energy, cosine, sine, next;
+	double chebyshevT, previousT, chebyshevU, previousU, cosineN, sineRatio;
+	double* constant, *period, *cosinePhase, *sinePhase;
+	double ba[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double bc[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double cd[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double nOne[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double nTwo[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double cosines[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double denominator[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double ratio[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double inverseRatio[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double A[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double B[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double energies[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double force[12][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+
+	energy = 0;
+	for(blockStart = start; blockStart < end; blockStart += AD_BONDED_BLOCK)
+	{
+		count = (end - blockStart < AD_BONDED_BLOCK) ? end - blockStart : AD_BONDED_BLOCK;
+		constant = table->parameters[0] + blockStart;
+		period = table->parameters[1] + blockStart;
+		cosinePhase = table->parameters[2] + blockStart;
+		sinePhase = table->parameters[3] + blockStart;
+		AdGatherBlockSeparations(table, blockStart, count, 0, 1, coordinates, ba);
+		AdGatherBlockSeparations(table, blockStart, count, 1, 2, coordinates, bc);
+		AdGatherBlockSeparations(table, blockStart, count, 2, 3, coordinates, cd);
+		AdTorsionBlockGeometry(count, ba, bc, cd, nOne, nTwo,
+			cosines, denominator, ratio, inverseRatio);
+
+		for(i=0; i<count; i++)
+		{
+			cosine = cosines[i];
+			sine = fmax(sqrt(1 - cosine*cosine), AD_MIN_TORSION_SINE);
+
+			//cos(n*theta) = T_n(cos(theta)) and sin(n*theta) = U_(n-1)(cos(theta))*sin(theta)
+			previousT = 1;
+			chebyshevT = cosine;
+			previousU = 0;
+			chebyshevU = 1;
+			cosineN = chebyshevT;
+			sineRatio = chebyshevU;
+			for(k=2; k<=AD_MAX_TORSION_PERIOD; k++)
+			{
+				next = 2*cosine*chebyshevT - previousT;
+				previousT = chebyshevT;
+				chebyshevT = next;
+				next = 2*cosine*chebyshevU - previousU;
+				previousU = chebyshevU;
+				chebyshevU = next;
+				cosineN = (period[i] == k) ? chebyshevT : cosineN;
+				sineRatio = (period[i] == k) ? chebyshevU : sineRatio;
+			}
+
+			//U = k(1 + cos(n*theta - phase))
+			energies[i] = constant[i]*(1 + cosineN*cosinePhase[i] + sineRatio*sine*sinePhase[i]);
+
+			//-nk*sin(n*theta - phase)/sin(theta) divided by |n1||n2|
+			A[i] = -period[i]*constant[i]*(sineRatio*cosinePhase[i] - cosineN*sinePhase[i]/sine);
+			A[i] /= denominator[i];
+			B[i] = A[i]*cosine;
+		}
+
+		AdTorsionBlockForces(count, ba, bc, cd, nOne, nTwo, ratio, inverseRatio, A, B, force);
+		energy += AdSumBlockEnergies(count, energies);
+		AdScatterBlockForces(table, blockStart, count, force, forces);
+	}
+
+	return energy;
+}
+
+double AdHarmonicImproperTorsionKernel(AdBondedTable* table, int start, int end, double** coordinates, double** forces)
+{
+	int i, blockStart, count;
+	double energy, cosine, sine, difference;
+	double* constant, *angle;
+	double ba[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double bc[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double cd[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double nOne[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double nTwo[3][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double cosines[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double denominator[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double ratio[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double inverseRatio[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double A[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double B[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double energies[AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+	double force[12][AD_BONDED_BLOCK] __attribute__ ((aligned (32)));
+
+	energy = 0;
+	for(blockStart = start; blockStart < end; blockStart += AD_BONDED_BLOCK)
+	{
+		count = (end - blockStart < AD_BONDED_BLOCK) ? end - blockStart : AD_BONDED_BLOCK;
+		constant = table->parameters[0] + blockStart;
+		angle = table->parameters[1] + blockStart;
+		AdGatherBlockSeparations(table, blockStart, count, 0, 1, coordinates, ba);
+		AdGatherBlockSeparations(table, blockStart, count, 1, 2, coordinates, bc);
+		AdGatherBlockSeparations(table, blockStart, count, 2, 3, coordinates, cd);
+		AdTorsionBlockGeometry(count, ba, bc, cd, nOne, nTwo,
+			cosines, denominator, ratio, inverseRatio);
+
+		for(i=0; i<count; i++)
+		{
+			cosine = cosines[i];
+			sine = fmax(sqrt(1 - cosine*cosine), AD_MIN_TORSION_SINE);
+			difference = acos(cosine) - angle[i];
+
+			//U = k(theta - theta0)^2
+			energies[i] = constant[i]*difference*difference;
+
+			//2k(theta - theta0)/sin(theta) divided by |n1||n2|
+			A[i] = 2*constant[i]*difference/(sine*denominator[i]);
+			B[i] = A[i]*cosine;
+		}
+
+		AdTorsionBlockForces(count, ba, bc, cd, nOne, nTwo, ratio, inverseRatio, A, B, force);
+		energy += AdSumBlockEnergies(count, energies);
+		AdScatterBlockForces(table, blockStart, count, force, forces);
+	}
+
+	return energy;
+}
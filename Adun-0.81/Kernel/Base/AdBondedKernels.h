@@ -0,0 +1,114 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#ifndef BONDED_KERNELS
+#define BONDED_KERNELS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Base/AdMatrix.h"
+
+//! The highest torsion periodicity supported by AdFourierTorsionKernel()
+#define AD_MAX_TORSION_PERIOD 6
+
+//! \brief Flat table of bonded interactions of one type.
+/**
+AdBondedTable stores the interactions held in the rows of a force field interaction matrix
+(the atom indexes followed by the parameters, all as doubles) as separate arrays.
+The k'th atom of interaction i is atoms[k][i] and its k'th parameter is parameters[k][i].
+rows[i] is the row of the interaction in the matrix the table was created from.
+
+The interactions are sorted by the index of their lowest numbered atom so
+consecutive interactions, and the interactions in a range of the table, involve nearby atoms.
+\ingroup Types
+**/
+
+typedef struct
+{
+	int numberInteractions;
+	int numberAtoms;		//!< The number of atoms in each interaction (2, 3 or 4)
+	int numberParameters;		//!< The number of parameters of each interaction (at most 4)
+	int* atoms[4];
+	double* parameters[4];
+	int* rows;
+}
+AdBondedTable;
+
+/**
+Functions which calculate the energy and forces of a range of interactions in an AdBondedTable.
+Each kernel processes the interactions in blocks. The coordinates of a block are gathered into local arrays,
+the forces are calculated by loops without branches so the compiler can vectorise them,
+and finally the forces are added to the force matrix.
+\defgroup BondedKernels Bonded Kernels
+\ingroup Functions
+@{
+*/
+
+/**
+Creates a table from the interactions in \e interactions. Each row contains \e numberAtoms atom indexes
+followed by \e numberParameters parameters. Free using AdFreeBondedTable().
+*/
+AdBondedTable* AdCreateBondedTable(AdMatrix* interactions, int numberAtoms, int numberParameters);
+
+/**
+Creates a table for use with AdFourierTorsionKernel() from a fourier torsion matrix whose rows contain four atom indexes,
+the constant, the periodicity and the phase. The parameters of the table are the constant,
+the periodicity, and the cosine and sine of the phase.
+Returns NULL if a periodicity is not an integer between 1 and #AD_MAX_TORSION_PERIOD.
+*/
+AdBondedTable* AdCreateFourierTorsionTable(AdMatrix* torsions);
+
+/**
+Frees a table created by AdCreateBondedTable() or AdCreateFourierTorsionTable().
+*/
+void AdFreeBondedTable(AdBondedTable* table);
+
+/**
+As AdEnzymixBondForce() for the interactions \e start to \e end - 1 of \e table.
+Returns their energy. The parameters are the constant and the equilibrium separation.
+*/
+double AdEnzymixBondKernel(AdBondedTable* table, int start, int end, double** coordinates, double** forces);
+
+/**
+As AdEnzymixAngleForce() for the interactions \e start to \e end - 1 of \e table.
+Returns their energy. The parameters are the constant and the equilibrium angle.
+*/
+double AdEnzymixAngleKernel(AdBondedTable* table, int start, int end, double** coordinates, double** forces);
+
+/**
+As AdFourierTorsionForce() for the interactions \e start to \e end - 1 of a table
+created by AdCreateFourierTorsionTable(). Returns their energy.
+The cosine and sine of the multiple angles are obtained from the cosine of the torsion angle
+using the Chebyshev recurrences so no trigonometric functions are called.
+*/
+double AdFourierTorsionKernel(AdBondedTable* table, int start, int end, double** coordinates, double** forces);
+
+/**
+As AdHarmonicImproperTorsionForce() for the interactions \e start to \e end - 1 of \e table.
+Returns their energy. The parameters are the constant and the equilibrium angle.
+*/
+double AdHarmonicImproperTorsionKernel(AdBondedTable* table, int start, int end, double** coordinates, double** forces);
+
+/** \@}**/
+
+#endif
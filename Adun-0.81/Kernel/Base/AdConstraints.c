@@ -0,0 +1,415 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#include "Base/AdConstraints.h"
+
+AdConstraintSet* AdAllocateConstraintSet(int numberOfConstraints, int numberOfWaters)
+{
+	AdConstraintSet* constraintSet;
+
+	constraintSet = (AdConstraintSet*)malloc(sizeof(AdConstraintSet));
+	constraintSet->numberOfConstraints = numberOfConstraints;
+	constraintSet->elements = (int*)malloc((2*numberOfConstraints + 1)*sizeof(int));
+	constraintSet->lengths = (double*)malloc((numberOfConstraints + 1)*sizeof(double));
+	constraintSet->lengthsSquared = (double*)malloc((numberOfConstraints + 1)*sizeof(double));
+	constraintSet->numberOfWaters = numberOfWaters;
+	constraintSet->waters = (int*)malloc((3*numberOfWaters + 1)*sizeof(int));
+	constraintSet->oxygenMass = constraintSet->hydrogenMass = 0;
+	constraintSet->oxygenHydrogenDistance = constraintSet->hydrogenHydrogenDistance = 0;
+	constraintSet->ra = constraintSet->rb = constraintSet->rc = 0;
+
+	return constraintSet;
+}
+
+void AdFreeConstraintSet(AdConstraintSet* constraintSet)
+{
+	if(constraintSet == NULL)
+		return;
+
+	free(constraintSet->elements);
+	free(constraintSet->lengths);
+	free(constraintSet->lengthsSquared);
+	free(constraintSet->waters);
+	free(constraintSet);
+}
+
+void AdSetSettleParameters(AdConstraintSet* constraintSet,
+		double oxygenMass,
+		double hydrogenMass,
+		double oxygenHydrogenDistance,
+		double hydrogenHydrogenDistance)
+{
+	double totalMass, height;
+
+	constraintSet->oxygenMass = oxygenMass;
+	constraintSet->hydrogenMass = hydrogenMass;
+	constraintSet->oxygenHydrogenDistance = oxygenHydrogenDistance;
+	constraintSet->hydrogenHydrogenDistance = hydrogenHydrogenDistance;
+
+	//The distance from the oxygen to the line between the hydrogens
+	//is split by the centre of mass into ra and rb.
+	totalMass = oxygenMass + 2*hydrogenMass;
+	constraintSet->rc = hydrogenHydrogenDistance/2;
+	height = sqrt(oxygenHydrogenDistance*oxygenHydrogenDistance - constraintSet->rc*constraintSet->rc);
+	constraintSet->ra = 2*hydrogenMass*height/totalMass;
+	constraintSet->rb = height - constraintSet->ra;
+}
+
+int AdShakePositions(AdConstraintSet* constraintSet,
+		double** reference,
+		double** positions,
+		double** velocities,
+		double* reciprocalMasses,
+		double reciprocalTimeStep,
+		double tolerance,
+		int maxIterations)
+{
+	int i, j, k, iteration, converged;
+	int* elements;
+	double difference, projection, factor, lengthSquared;
+	double separation[3], referenceSeparation[3];
+
+	elements = constraintSet->elements;
+	for(iteration = 0; iteration < maxIterations; iteration++)
+	{
+		converged = 1;
+		for(k=0; k<constraintSet->numberOfConstraints; k++)
+		{
+			i = elements[2*k];
+			j = elements[2*k + 1];
+			lengthSquared = constraintSet->lengthsSquared[k];
+			separation[0] = positions[i][0] - positions[j][0];
+			separation[1] = positions[i][1] - positions[j][1];
+			separation[2] = positions[i][2] - positions[j][2];
+			difference = lengthSquared - (separation[0]*separation[0]
+					+ separation[1]*separation[1] + separation[2]*separation[2]);
+
+			//The relative deviation of the length is approximately difference/(2*lengthSquared)
+			if(fabs(difference) <= 2*tolerance*lengthSquared)
+				continue;
+
+			converged = 0;
+			referenceSeparation[0] = reference[i][0] - reference[j][0];
+			referenceSeparation[1] = reference[i][1] - reference[j][1];
+			referenceSeparation[2] = reference[i][2] - reference[j][2];
+			projection = referenceSeparation[0]*separation[0]
+					+ referenceSeparation[1]*separation[1]
+					+ referenceSeparation[2]*separation[2];
+
+			//The bond has rotated by close to 90 degrees in one step
+			if(projection < 1E-6*lengthSquared)
+				return -1;
+
+			factor = difference/(2*projection*(reciprocalMasses[i] + reciprocalMasses[j]));
+			positions[i][0] += factor*reciprocalMasses[i]*referenceSeparation[0];
+			positions[i][1] += factor*reciprocalMasses[i]*referenceSeparation[1];
+			positions[i][2] += factor*reciprocalMasses[i]*referenceSeparation[2];
+			positions[j][0] -= factor*reciprocalMasses[j]*referenceSeparation[0];
+			positions[j][1] -= factor*reciprocalMasses[j]*referenceSeparation[1];
+			positions[j][2] -= factor*reciprocalMasses[j]*referenceSeparation[2];
+
+			if(velocities != NULL)
+			{
+				factor *= reciprocalTimeStep;
+				velocities[i][0] += factor*reciprocalMasses[i]*referenceSeparation[0];
+				velocities[i][1] += factor*reciprocalMasses[i]*referenceSeparation[1];
+				velocities[i][2] += factor*reciprocalMasses[i]*referenceSeparation[2];
+				velocities[j][0] -= factor*reciprocalMasses[j]*referenceSeparation[0];
+				velocities[j][1] -= factor*reciprocalMasses[j]*referenceSeparation[1];
+				velocities[j][2] -= factor*reciprocalMasses[j]*referenceSeparation[2];
+			}
+		}
+
+		if(converged)
+			return iteration;
+	}
+
+	return -1;
+}
+
+int AdRattleVelocities(AdConstraintSet* constraintSet,
+		double** positions,
+		double** velocities,
+		double* reciprocalMasses,
+		double tolerance,
+		int maxIterations)
+{
+	int i, j, k, iteration, converged;
+	int* elements;
+	double projection, factor, lengthSquared;
+	double separation[3];
+
+	elements = constraintSet->elements;
+	for(iteration = 0; iteration < maxIterations; iteration++)
+	{
+		converged = 1;
+		for(k=0; k<constraintSet->numberOfConstraints; k++)
+		{
+			i = elements[2*k];
+			j = elements[2*k + 1];
+			lengthSquared = constraintSet->lengthsSquared[k];
+			separation[0] = positions[i][0] - positions[j][0];
+			separation[1] = positions[i][1] - positions[j][1];
+			separation[2] = positions[i][2] - positions[j][2];
+			projection = separation[0]*(velocities[i][0] - velocities[j][0])
+					+ separation[1]*(velocities[i][1] - velocities[j][1])
+					+ separation[2]*(velocities[i][2] - velocities[j][2]);
+
+			if(fabs(projection) <= tolerance*lengthSquared)
+				continue;
+
+			converged = 0;
+			factor = -projection/(lengthSquared*(reciprocalMasses[i] + reciprocalMasses[j]));
+			velocities[i][0] += factor*reciprocalMasses[i]*separation[0];
+			velocities[i][1] += factor*reciprocalMasses[i]*separation[1];
+			velocities[i][2] += factor*reciprocalMasses[i]*separation[2];
+			velocities[j][0] -= factor*reciprocalMasses[j]*separation[0];
+			velocities[j][1] -= factor*reciprocalMasses[j]*separation[1];
+			velocities[j][2] -= factor*reciprocalMasses[j]*separation[2];
+		}
+
+		if(converged)
+			return iteration;
+	}
+
+	return -1;
+}
+
+/*
+ * SETTLE - S. Miyamoto and P. A. Kollman, J. Comp. Chem. 13, 952 (1992).
+ * The unconstrained positions are expressed in a frame centred on the water centre of mass
+ * where the z axis is normal to the plane of the water before the update.
+ * The constrained positions are then found analytically by three rotations of the
+ * ideal water geometry in this frame.
+ */
+void AdSettlePositions(AdConstraintSet* constraintSet,
+		double** reference,
+		double** positions,
+		double** velocities,
+		double reciprocalTimeStep)
+{
+	int i, j, oxygen, hydrogenOne, hydrogenTwo;
+	double wo, wh, ra, rb, rc, length;
+	double sinphi, cosphi, sinpsi, cospsi, sintheta, costheta;
+	double alpha, beta, gamma, alphaBeta;
+	double ya2d, xb2d, yb2d, yc2d;
+	double xb0d, yb0d, xc0d, yc0d;
+	double za1d, xb1d, yb1d, zb1d, xc1d, yc1d, zc1d;
+	double xa3d, ya3d, za3d, xb3d, yb3d, zb3d, xc3d, yc3d, zc3d;
+	double b0[3], c0[3], a1[3], b1[3], c1[3], centre[3];
+	double xaxis[3], yaxis[3], zaxis[3];
+	double newPosition[3];
+
+	wo = constraintSet->oxygenMass/(constraintSet->oxygenMass + 2*constraintSet->hydrogenMass);
+	wh = constraintSet->hydrogenMass/(constraintSet->oxygenMass + 2*constraintSet->hydrogenMass);
+	ra = constraintSet->ra;
+	rb = constraintSet->rb;
+	rc = constraintSet->rc;
+
+	for(i=0; i<constraintSet->numberOfWaters; i++)
+	{
+		oxygen = constraintSet->waters[3*i];
+		hydrogenOne = constraintSet->waters[3*i + 1];
+		hydrogenTwo = constraintSet->waters[3*i + 2];
+
+		for(j=0; j<3; j++)
+		{
+			b0[j] = reference[hydrogenOne][j] - reference[oxygen][j];
+			c0[j] = reference[hydrogenTwo][j] - reference[oxygen][j];
+			centre[j] = wo*positions[oxygen][j]
+				+ wh*(positions[hydrogenOne][j] + positions[hydrogenTwo][j]);
+			a1[j] = positions[oxygen][j] - centre[j];
+			b1[j] = positions[hydrogenOne][j] - centre[j];
+			c1[j] = positions[hydrogenTwo][j] - centre[j];
+		}
+
+		//The frame axes
+		zaxis[0] = b0[1]*c0[2] - b0[2]*c0[1];
+		zaxis[1] = b0[2]*c0[0] - b0[0]*c0[2];
+		zaxis[2] = b0[0]*c0[1] - b0[1]*c0[0];
+		xaxis[0] = a1[1]*zaxis[2] - a1[2]*zaxis[1];
+		xaxis[1] = a1[2]*zaxis[0] - a1[0]*zaxis[2];
+		xaxis[2] = a1[0]*zaxis[1] - a1[1]*zaxis[0];
+		yaxis[0] = zaxis[1]*xaxis[2] - zaxis[2]*xaxis[1];
+		yaxis[1] = zaxis[2]*xaxis[0] - zaxis[0]*xaxis[2];
+		yaxis[2] = zaxis[0]*xaxis[1] - zaxis[1]*xaxis[0];
+
+		length = 1/sqrt(xaxis[0]*xaxis[0] + xaxis[1]*xaxis[1] + xaxis[2]*xaxis[2]);
+		xaxis[0] *= length; xaxis[1] *= length; xaxis[2] *= length;
+		length = 1/sqrt(yaxis[0]*yaxis[0] + yaxis[1]*yaxis[1] + yaxis[2]*yaxis[2]);
+		yaxis[0] *= length; yaxis[1] *= length; yaxis[2] *= length;
+		length = 1/sqrt(zaxis[0]*zaxis[0] + zaxis[1]*zaxis[1] + zaxis[2]*zaxis[2]);
+		zaxis[0] *= length; zaxis[1] *= length; zaxis[2] *= length;
+
+		//Project onto the frame
+		xb0d = xaxis[0]*b0[0] + xaxis[1]*b0[1] + xaxis[2]*b0[2];
+		yb0d = yaxis[0]*b0[0] + yaxis[1]*b0[1] + yaxis[2]*b0[2];
+		xc0d = xaxis[0]*c0[0] + xaxis[1]*c0[1] + xaxis[2]*c0[2];
+		yc0d = yaxis[0]*c0[0] + yaxis[1]*c0[1] + yaxis[2]*c0[2];
+		za1d = zaxis[0]*a1[0] + zaxis[1]*a1[1] + zaxis[2]*a1[2];
+		xb1d = xaxis[0]*b1[0] + xaxis[1]*b1[1] + xaxis[2]*b1[2];
+		yb1d = yaxis[0]*b1[0] + yaxis[1]*b1[1] + yaxis[2]*b1[2];
+		zb1d = zaxis[0]*b1[0] + zaxis[1]*b1[1] + zaxis[2]*b1[2];
+		xc1d = xaxis[0]*c1[0] + xaxis[1]*c1[1] + xaxis[2]*c1[2];
+		yc1d = yaxis[0]*c1[0] + yaxis[1]*c1[1] + yaxis[2]*c1[2];
+		zc1d = zaxis[0]*c1[0] + zaxis[1]*c1[1] + zaxis[2]*c1[2];
+
+		//The first two rotations
+		sinphi = za1d/ra;
+		cosphi = sqrt(1 - sinphi*sinphi);
+		sinpsi = (zb1d - zc1d)/(2*rc*cosphi);
+		cospsi = sqrt(1 - sinpsi*sinpsi);
+
+		ya2d = ra*cosphi;
+		xb2d = -rc*cospsi;
+		yb2d = -rb*cosphi - rc*sinpsi*sinphi;
+		yc2d = -rb*cosphi + rc*sinpsi*sinphi;
+
+		//The rotation about z
+		alpha = xb2d*(xb0d - xc0d) + yb0d*yb2d + yc0d*yc2d;
+		beta = xb2d*(yc0d - yb0d) + xb0d*yb2d + xc0d*yc2d;
+		gamma = xb0d*yb1d - xb1d*yb0d + xc0d*yc1d - xc1d*yc0d;
+		alphaBeta = alpha*alpha + beta*beta;
+		sintheta = (alpha*gamma - beta*sqrt(alphaBeta - gamma*gamma))/alphaBeta;
+		costheta = sqrt(1 - sintheta*sintheta);
+
+		xa3d = -ya2d*sintheta;
+		ya3d = ya2d*costheta;
+		za3d = za1d;
+		xb3d = xb2d*costheta - yb2d*sintheta;
+		yb3d = xb2d*sintheta + yb2d*costheta;
+		zb3d = zb1d;
+		xc3d = -xb2d*costheta - yc2d*sintheta;
+		yc3d = -xb2d*sintheta + yc2d*costheta;
+		zc3d = zc1d;
+
+		//Back to the original frame
+		for(j=0; j<3; j++)
+		{
+			newPosition[0] = centre[j] + xa3d*xaxis[j] + ya3d*yaxis[j] + za3d*zaxis[j];
+			newPosition[1] = centre[j] + xb3d*xaxis[j] + yb3d*yaxis[j] + zb3d*zaxis[j];
+			newPosition[2] = centre[j] + xc3d*xaxis[j] + yc3d*yaxis[j] + zc3d*zaxis[j];
+
+			if(velocities != NULL)
+			{
+				velocities[oxygen][j] += (newPosition[0] - positions[oxygen][j])*reciprocalTimeStep;
+				velocities[hydrogenOne][j] += (newPosition[1] - positions[hydrogenOne][j])*reciprocalTimeStep;
+				velocities[hydrogenTwo][j] += (newPosition[2] - positions[hydrogenTwo][j])*reciprocalTimeStep;
+			}
+
+			positions[oxygen][j] = newPosition[0];
+			positions[hydrogenOne][j] = newPosition[1];
+			positions[hydrogenTwo][j] = newPosition[2];
+		}
+	}
+}
+
+/*
+ * For each water an impulse along each of its three bonds is found such that
+ * the relative velocity along every bond is zero afterwards.
+ * This is a 3x3 linear system which is solved using Cramer's rule.
+ */
+void AdSettleVelocities(AdConstraintSet* constraintSet,
+		double** positions,
+		double** velocities)
+{
+	int i, j, k, l;
+	int atoms[3], first[3], second[3];
+	double determinant, length, sign;
+	double reciprocalMasses[3], impulses[3], relativeVelocity[3];
+	double directions[3][3], system[3][3], replaced[3][3];
+
+	reciprocalMasses[0] = 1/constraintSet->oxygenMass;
+	reciprocalMasses[1] = reciprocalMasses[2] = 1/constraintSet->hydrogenMass;
+
+	//The bonds O-H1, O-H2 and H1-H2 given as indexes into atoms
+	first[0] = 0; second[0] = 1;
+	first[1] = 0; second[1] = 2;
+	first[2] = 1; second[2] = 2;
+
+	for(i=0; i<constraintSet->numberOfWaters; i++)
+	{
+		for(j=0; j<3; j++)
+			atoms[j] = constraintSet->waters[3*i + j];
+
+		for(k=0; k<3; k++)
+		{
+			for(length = 0, j=0; j<3; j++)
+			{
+				directions[k][j] = positions[atoms[second[k]]][j] - positions[atoms[first[k]]][j];
+				length += directions[k][j]*directions[k][j];
+			}
+
+			length = 1/sqrt(length);
+			for(relativeVelocity[k] = 0, j=0; j<3; j++)
+			{
+				directions[k][j] *= length;
+				relativeVelocity[k] += directions[k][j]*
+					(velocities[atoms[second[k]]][j] - velocities[atoms[first[k]]][j]);
+			}
+		}
+
+		//An impulse g along bond k changes the velocity of its first atom by g*w*e_k
+		//and of its second by -g*w*e_k.
+		for(l=0; l<3; l++)
+			for(k=0; k<3; k++)
+			{
+				sign = 0;
+				if(second[l] == first[k])
+					sign += reciprocalMasses[second[l]];
+				else if(second[l] == second[k])
+					sign -= reciprocalMasses[second[l]];
+
+				if(first[l] == first[k])
+					sign -= reciprocalMasses[first[l]];
+				else if(first[l] == second[k])
+					sign += reciprocalMasses[first[l]];
+
+				system[l][k] = sign*(directions[l][0]*directions[k][0]
+						+ directions[l][1]*directions[k][1]
+						+ directions[l][2]*directions[k][2]);
+			}
+
+		determinant = system[0][0]*(system[1][1]*system[2][2] - system[1][2]*system[2][1])
+			- system[0][1]*(system[1][0]*system[2][2] - system[1][2]*system[2][0])
+			+ system[0][2]*(system[1][0]*system[2][1] - system[1][1]*system[2][0]);
+
+		for(k=0; k<3; k++)
+		{
+			for(l=0; l<3; l++)
+				for(j=0; j<3; j++)
+					replaced[l][j] = (j == k) ? -relativeVelocity[l] : system[l][j];
+
+			impulses[k] = (replaced[0][0]*(replaced[1][1]*replaced[2][2] - replaced[1][2]*replaced[2][1])
+				- replaced[0][1]*(replaced[1][0]*replaced[2][2] - replaced[1][2]*replaced[2][0])
+				+ replaced[0][2]*(replaced[1][0]*replaced[2][1] - replaced[1][1]*replaced[2][0]))
+				/determinant;
+		}
+
+		for(k=0; k<3; k++)
+			for(j=0; j<3; j++)
+			{
+				velocities[atoms[first[k]]][j] += impulses[k]*reciprocalMasses[first[k]]*directions[k][j];
+				velocities[atoms[second[k]]][j] -= impulses[k]*reciprocalMasses[second[k]]*directions[k][j];
+			}
+	}
+}
@@ -0,0 +1,135 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#ifndef BOND_CONSTRAINTS
+#define BOND_CONSTRAINTS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+//! \brief A set of bond length constraints.
+/**
+Constraint \e i fixes the distance between elements \e elements[2i] and \e elements[2i+1]
+to \e lengths[i].
+Rigid waters are handled separately using SETTLE. The oxygen and two hydrogens of water \e i
+are \e waters[3i], \e waters[3i+1] and \e waters[3i+2]. All waters share the same geometry
+which is described by the settle parameters.
+\ingroup Types
+**/
+
+typedef struct
+{
+	int numberOfConstraints;	//!< The number of bond constraints
+	int* elements;			//!< The two elements in each bond constraint
+	double* lengths;		//!< The length of each bond constraint
+	double* lengthsSquared;		//!< The squared length of each bond constraint
+	int numberOfWaters;		//!< The number of rigid waters
+	int* waters;			//!< The oxygen and hydrogens of each water
+	double oxygenMass;		//!< The settle parameters
+	double hydrogenMass;
+	double oxygenHydrogenDistance;
+	double hydrogenHydrogenDistance;
+	double ra;			//!< The distance from the oxygen to the water centre of mass
+	double rb;			//!< The distance from the hydrogen line to the centre of mass
+	double rc;			//!< Half the hydrogen-hydrogen distance
+}
+AdConstraintSet;
+
+/**
+\defgroup constraints Bond Constraints
+\ingroup Functions
+@{
+**/
+
+/**
+Allocates an AdConstraintSet for \e numberOfConstraints bond constraints and \e numberOfWaters rigid waters.
+The elements, lengths and waters must be filled in by the caller. If there are waters
+AdSetSettleParameters() must be called before the set is used.
+*/
+AdConstraintSet* AdAllocateConstraintSet(int numberOfConstraints, int numberOfWaters);
+
+/**
+Frees \e constraintSet.
+*/
+void AdFreeConstraintSet(AdConstraintSet* constraintSet);
+
+/**
+Sets the masses and geometry used by SETTLE.
+*/
+void AdSetSettleParameters(AdConstraintSet* constraintSet,
+		double oxygenMass,
+		double hydrogenMass,
+		double oxygenHydrogenDistance,
+		double hydrogenHydrogenDistance);
+
+/**
+Applies the bond constraints of \e constraintSet to \e positions using SHAKE.
+\e reference contains the positions before the unconstrained update, where the constraints were satisfied.
+If \e velocities is not NULL the change in the position of each element times \e reciprocalTimeStep
+is added to its velocity.
+The iteration stops when the relative deviation of each bond from its length is less than \e tolerance.
+\return The number of iterations performed or -1 if the constraints did not converge in \e maxIterations.
+*/
+int AdShakePositions(AdConstraintSet* constraintSet,
+		double** reference,
+		double** positions,
+		double** velocities,
+		double* reciprocalMasses,
+		double reciprocalTimeStep,
+		double tolerance,
+		int maxIterations);
+
+/**
+Removes the components of \e velocities along the bond constraints of \e constraintSet
+using RATTLE. \e positions must satisfy the constraints.
+The iteration stops when the relative velocity along each bond is less than \e tolerance times its length.
+\return The number of iterations performed or -1 if the constraints did not converge in \e maxIterations.
+*/
+int AdRattleVelocities(AdConstraintSet* constraintSet,
+		double** positions,
+		double** velocities,
+		double* reciprocalMasses,
+		double tolerance,
+		int maxIterations);
+
+/**
+Applies the rigid water constraints of \e constraintSet to \e positions using the analytic SETTLE algorithm.
+\e reference and \e velocities are as for AdShakePositions().
+*/
+void AdSettlePositions(AdConstraintSet* constraintSet,
+		double** reference,
+		double** positions,
+		double** velocities,
+		double reciprocalTimeStep);
+
+/**
+Removes the components of \e velocities along the three bonds of each rigid water
+by solving for the constraint impulses directly.
+*/
+void AdSettleVelocities(AdConstraintSet* constraintSet,
+		double** positions,
+		double** velocities);
+
+/** \@}**/
+
+#endif
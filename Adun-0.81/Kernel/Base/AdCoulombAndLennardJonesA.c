@@ -618,3 +618,798 @@ void AdCoulombAndLennardJonesAForce(ListElement* interaction,
 
 }
 */
+
+/*
+ * Pair list kernels.
+ * These iterate over every pair in an AdPairList in a single call.
+ */
+
+void AdCoulombAndLennardJonesAPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double lennardJonesA, lennardJonesB, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, NULL,
+		AdCoulombElectrostatics, 'A', EPSILON_RP, cutoff, 0, 0, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of atom one is kept in a local while we loop over its partners
+		position = coordinates[i];
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			lennardJonesA = list->paramOne[j];
+			lennardJonesB = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(1/r)^6 without pow
+			vdw_hold = length_rec*length_rec;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			lennardJonesA *= vdw_hold*vdw_hold;
+			lennardJonesB *= vdw_hold;
+			vdwPotential += lennardJonesA - lennardJonesB;
+			estPotential += est_hold;
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedEnergyLog("Normal", "A", i, atom_two, lennardJonesA, lennardJonesB, 
+				chargeProduct, length, est_hold, vdwPotential,
+				__NonbondedEnergyDebug__); 
+#endif
+		}
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdCoulombAndLennardJonesAPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double force_mag;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double lennardJonesA, lennardJonesB, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	double accumulated[3];
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, forces,
+		AdCoulombElectrostatics, 'A', EPSILON_RP, cutoff, 0, 0, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of (and force on) atom one is kept
+		//in locals while we loop over its partners
+		position = coordinates[i];
+		accumulated[0] = accumulated[1] = accumulated[2] = 0;
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			lennardJonesA = list->paramOne[j];
+			lennardJonesB = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(1/r)^6 without pow
+			vdw_hold = length_rec*length_rec;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			lennardJonesA *= vdw_hold*vdw_hold;
+			lennardJonesB *= vdw_hold;
+			vdwPotential += lennardJonesA - lennardJonesB;
+			estPotential += est_hold;
+
+			force_mag = est_hold*length_rec;
+
+			//add the vdw force to the est force
+			force_mag += 6*length_rec*(2*lennardJonesA - lennardJonesB);
+			force_mag *= length_rec;
+
+			//calculate the force on atom one along the vector (r1 - r2)
+			//the force on atom two is the opposite of this force
+			*(seperation_s.vector + 0) *= force_mag;
+			*(seperation_s.vector + 1) *= force_mag;
+			*(seperation_s.vector + 2) *= force_mag;
+
+			accumulated[0] += *(seperation_s.vector + 0);
+			accumulated[1] += *(seperation_s.vector + 1);
+			accumulated[2] += *(seperation_s.vector + 2);
+
+			forces[atom_two][0] -= *(seperation_s.vector + 0);
+			forces[atom_two][1] -= *(seperation_s.vector + 1);
+			forces[atom_two][2] -= *(seperation_s.vector + 2);
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedForceLog("Normal", "A", i, atom_two, lennardJonesA, lennardJonesB, 
+				chargeProduct, length, est_hold, vdwPotential, force_mag,
+				__NonbondedForceDebug__); 
+#endif
+		}
+
+		forces[i][0] += accumulated[0];
+		forces[i][1] += accumulated[1];
+		forces[i][2] += accumulated[2];
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdShiftedCoulombAndLennardJonesAPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cut, 
+		double r_cutoff2, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double shift_fac;
+	double lennardJonesA, lennardJonesB, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, NULL,
+		AdShiftedCoulombElectrostatics, 'A', EPSILON_RP, cut, r_cutoff2, 0, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cut*cut;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of atom one is kept in a local while we loop over its partners
+		position = coordinates[i];
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			lennardJonesA = list->paramOne[j];
+			lennardJonesB = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(1/r)^6 without pow
+			vdw_hold = length_rec*length_rec;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			//est shift factor
+			shift_fac = (cut - length)*(cut - length)*r_cutoff2;
+
+			lennardJonesA *= vdw_hold*vdw_hold;
+			lennardJonesB *= vdw_hold;
+			vdwPotential += lennardJonesA - lennardJonesB;
+			estPotential += est_hold*shift_fac;
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedEnergyLog("Shifted", "A", i, atom_two, lennardJonesA, lennardJonesB, 
+				chargeProduct, length, est_hold, vdwPotential,
+				__ShiftedNonbondedEnergyDebug__); 
+#endif
+		}
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdShiftedCoulombAndLennardJonesAPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cut, 
+		double r_cutoff2, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double force_mag;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double shift_fac;
+	double lennardJonesA, lennardJonesB, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	double accumulated[3];
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, forces,
+		AdShiftedCoulombElectrostatics, 'A', EPSILON_RP, cut, r_cutoff2, 0, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cut*cut;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of (and force on) atom one is kept
+		//in locals while we loop over its partners
+		position = coordinates[i];
+		accumulated[0] = accumulated[1] = accumulated[2] = 0;
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			lennardJonesA = list->paramOne[j];
+			lennardJonesB = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(1/r)^6 without pow
+			vdw_hold = length_rec*length_rec;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			//est shift factor
+			shift_fac = (cut - length)*(cut - length)*r_cutoff2;
+
+			lennardJonesA *= vdw_hold*vdw_hold;
+			lennardJonesB *= vdw_hold;
+			vdwPotential += lennardJonesA - lennardJonesB;
+			estPotential += est_hold*shift_fac;
+
+			//the shifted est force is EST_HOLD*(length_rec - r_cutoff2*length)
+			force_mag = est_hold*(length_rec - r_cutoff2*length);
+
+			//add the vdw force to the est force
+			force_mag += 6*length_rec*(2*lennardJonesA - lennardJonesB);
+			force_mag *= length_rec;
+
+			//calculate the force on atom one along the vector (r1 - r2)
+			//the force on atom two is the opposite of this force
+			*(seperation_s.vector + 0) *= force_mag;
+			*(seperation_s.vector + 1) *= force_mag;
+			*(seperation_s.vector + 2) *= force_mag;
+
+			accumulated[0] += *(seperation_s.vector + 0);
+			accumulated[1] += *(seperation_s.vector + 1);
+			accumulated[2] += *(seperation_s.vector + 2);
+
+			forces[atom_two][0] -= *(seperation_s.vector + 0);
+			forces[atom_two][1] -= *(seperation_s.vector + 1);
+			forces[atom_two][2] -= *(seperation_s.vector + 2);
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedForceLog("Shifted", "A", i, atom_two, lennardJonesA, lennardJonesB, 
+				chargeProduct, length, est_hold, vdwPotential, force_mag,
+				__ShiftedNonbondedForceDebug__); 
+#endif
+		}
+
+		forces[i][0] += accumulated[0];
+		forces[i][1] += accumulated[1];
+		forces[i][2] += accumulated[2];
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdGRFCoulombAndLennardJonesAPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double b0, 
+		double b1, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double lennardJonesA, lennardJonesB, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, NULL,
+		AdGRFCoulombElectrostatics, 'A', EPSILON_RP, cutoff, b0, b1, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of atom one is kept in a local while we loop over its partners
+		position = coordinates[i];
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			lennardJonesA = list->paramOne[j];
+			lennardJonesB = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(1/r)^6 without pow
+			vdw_hold = length_rec*length_rec;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*(length_rec + b0);
+
+			lennardJonesA *= vdw_hold*vdw_hold;
+			lennardJonesB *= vdw_hold;
+			vdwPotential += lennardJonesA - lennardJonesB;
+			estPotential += est_hold;
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedEnergyLog("GRF", "A", i, atom_two, lennardJonesA, lennardJonesB, 
+				chargeProduct, length, est_hold, vdwPotential,
+				__GRFNonbondedEnergyDebug__); 
+#endif
+		}
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdGRFCoulombAndLennardJonesAPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double b0, 
+		double b1, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double force_mag;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double lennardJonesA, lennardJonesB, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	double accumulated[3];
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, forces,
+		AdGRFCoulombElectrostatics, 'A', EPSILON_RP, cutoff, b0, b1, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of (and force on) atom one is kept
+		//in locals while we loop over its partners
+		position = coordinates[i];
+		accumulated[0] = accumulated[1] = accumulated[2] = 0;
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			lennardJonesA = list->paramOne[j];
+			lennardJonesB = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(1/r)^6 without pow
+			vdw_hold = length_rec*length_rec;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			lennardJonesA *= vdw_hold*vdw_hold;
+			lennardJonesB *= vdw_hold;
+			vdwPotential += lennardJonesA - lennardJonesB;
+			estPotential += est_hold + EPSILON_RP*chargeProduct*b0;
+
+			force_mag = est_hold*length_rec + EPSILON_RP*chargeProduct*b1*length;
+
+			//add the vdw force to the est force
+			force_mag += 6*length_rec*(2*lennardJonesA - lennardJonesB);
+			force_mag *= length_rec;
+
+			//calculate the force on atom one along the vector (r1 - r2)
+			//the force on atom two is the opposite of this force
+			*(seperation_s.vector + 0) *= force_mag;
+			*(seperation_s.vector + 1) *= force_mag;
+			*(seperation_s.vector + 2) *= force_mag;
+
+			accumulated[0] += *(seperation_s.vector + 0);
+			accumulated[1] += *(seperation_s.vector + 1);
+			accumulated[2] += *(seperation_s.vector + 2);
+
+			forces[atom_two][0] -= *(seperation_s.vector + 0);
+			forces[atom_two][1] -= *(seperation_s.vector + 1);
+			forces[atom_two][2] -= *(seperation_s.vector + 2);
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedForceLog("GRF", "A", i, atom_two, lennardJonesA, lennardJonesB, 
+				chargeProduct, length, est_hold, vdwPotential, force_mag,
+				__GRFNonbondedForceDebug__); 
+#endif
+		}
+
+		forces[i][0] += accumulated[0];
+		forces[i][1] += accumulated[1];
+		forces[i][2] += accumulated[2];
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdEwaldCoulombAndLennardJonesAPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double ewaldCoefficient, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double erfc_hold;
+	double lennardJonesA, lennardJonesB, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of atom one is kept in a local while we loop over its partners
+		position = coordinates[i];
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			lennardJonesA = list->paramOne[j];
+			lennardJonesB = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(1/r)^6 without pow
+			vdw_hold = length_rec*length_rec;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			lennardJonesA *= vdw_hold*vdw_hold;
+			lennardJonesB *= vdw_hold;
+			vdwPotential += lennardJonesA - lennardJonesB;
+
+			//Only the screened short range part of the coulomb interaction is
+			//calculated here. The remainder is calculated in reciprocal space.
+			erfc_hold = erfc(ewaldCoefficient*length);
+			estPotential += est_hold*erfc_hold;
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedEnergyLog("Ewald", "A", i, atom_two, lennardJonesA, lennardJonesB, 
+				chargeProduct, length, est_hold, vdwPotential,
+				__NonbondedEnergyDebug__); 
+#endif
+		}
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdEwaldCoulombAndLennardJonesAPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double ewaldCoefficient, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double force_mag;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double erfc_hold;
+	double lennardJonesA, lennardJonesB, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	double accumulated[3];
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of (and force on) atom one is kept
+		//in locals while we loop over its partners
+		position = coordinates[i];
+		accumulated[0] = accumulated[1] = accumulated[2] = 0;
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			lennardJonesA = list->paramOne[j];
+			lennardJonesB = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(1/r)^6 without pow
+			vdw_hold = length_rec*length_rec;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			lennardJonesA *= vdw_hold*vdw_hold;
+			lennardJonesB *= vdw_hold;
+			vdwPotential += lennardJonesA - lennardJonesB;
+
+			//Only the screened short range part of the coulomb interaction is
+			//calculated here. The remainder is calculated in reciprocal space.
+			erfc_hold = erfc(ewaldCoefficient*length);
+			estPotential += est_hold*erfc_hold;
+
+			force_mag = est_hold*length_rec*(erfc_hold + 
+					M_2_SQRTPI*ewaldCoefficient*length*exp(-ewaldCoefficient*ewaldCoefficient*length_sq));
+
+			//add the vdw force to the est force
+			force_mag += 6*length_rec*(2*lennardJonesA - lennardJonesB);
+			force_mag *= length_rec;
+
+			//calculate the force on atom one along the vector (r1 - r2)
+			//the force on atom two is the opposite of this force
+			*(seperation_s.vector + 0) *= force_mag;
+			*(seperation_s.vector + 1) *= force_mag;
+			*(seperation_s.vector + 2) *= force_mag;
+
+			accumulated[0] += *(seperation_s.vector + 0);
+			accumulated[1] += *(seperation_s.vector + 1);
+			accumulated[2] += *(seperation_s.vector + 2);
+
+			forces[atom_two][0] -= *(seperation_s.vector + 0);
+			forces[atom_two][1] -= *(seperation_s.vector + 1);
+			forces[atom_two][2] -= *(seperation_s.vector + 2);
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedForceLog("Ewald", "A", i, atom_two, lennardJonesA, lennardJonesB, 
+				chargeProduct, length, est_hold, vdwPotential, force_mag,
+				__NonbondedForceDebug__); 
+#endif
+		}
+
+		forces[i][0] += accumulated[0];
+		forces[i][1] += accumulated[1];
+		forces[i][2] += accumulated[2];
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
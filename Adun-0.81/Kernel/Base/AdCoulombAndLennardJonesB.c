@@ -389,3 +389,798 @@ void AdGRFCoulombAndLennardJonesBEnergy(ListElement* interaction,
 #endif
 }
 
+
+/*
+ * Pair list kernels.
+ * These iterate over every pair in an AdPairList in a single call.
+ */
+
+void AdCoulombAndLennardJonesBPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double wellDepth, eqSeparation, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, NULL,
+		AdCoulombElectrostatics, 'B', EPSILON_RP, cutoff, 0, 0, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of atom one is kept in a local while we loop over its partners
+		position = coordinates[i];
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			wellDepth = list->paramOne[j];
+			eqSeparation = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(r*/r)^6 without pow
+			vdw_hold = eqSeparation*length_rec;
+			vdw_hold *= vdw_hold;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			vdwPotential += wellDepth*vdw_hold*(vdw_hold - 2);
+			estPotential += est_hold;
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedEnergyLog("Normal", "B", i, atom_two, wellDepth, eqSeparation, 
+				chargeProduct, length, est_hold, vdwPotential,
+				__NonbondedEnergyDebug__); 
+#endif
+		}
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdCoulombAndLennardJonesBPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double force_mag;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double wellDepth, eqSeparation, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	double accumulated[3];
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, forces,
+		AdCoulombElectrostatics, 'B', EPSILON_RP, cutoff, 0, 0, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of (and force on) atom one is kept
+		//in locals while we loop over its partners
+		position = coordinates[i];
+		accumulated[0] = accumulated[1] = accumulated[2] = 0;
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			wellDepth = list->paramOne[j];
+			eqSeparation = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(r*/r)^6 without pow
+			vdw_hold = eqSeparation*length_rec;
+			vdw_hold *= vdw_hold;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			//Note wellDepth here is the actual wellDepth*vdw_hold
+			wellDepth *= vdw_hold;
+			vdwPotential += wellDepth*(vdw_hold - 2);
+			estPotential += est_hold;
+
+			force_mag = est_hold*length_rec;
+
+			//add the vdw force to the est force
+			force_mag += 12*length_rec*wellDepth*(vdw_hold - 1);
+			force_mag *= length_rec;
+
+			//calculate the force on atom one along the vector (r1 - r2)
+			//the force on atom two is the opposite of this force
+			*(seperation_s.vector + 0) *= force_mag;
+			*(seperation_s.vector + 1) *= force_mag;
+			*(seperation_s.vector + 2) *= force_mag;
+
+			accumulated[0] += *(seperation_s.vector + 0);
+			accumulated[1] += *(seperation_s.vector + 1);
+			accumulated[2] += *(seperation_s.vector + 2);
+
+			forces[atom_two][0] -= *(seperation_s.vector + 0);
+			forces[atom_two][1] -= *(seperation_s.vector + 1);
+			forces[atom_two][2] -= *(seperation_s.vector + 2);
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedForceLog("Normal", "B", i, atom_two, wellDepth, eqSeparation, 
+				chargeProduct, length, est_hold, vdwPotential, force_mag,
+				__NonbondedForceDebug__); 
+#endif
+		}
+
+		forces[i][0] += accumulated[0];
+		forces[i][1] += accumulated[1];
+		forces[i][2] += accumulated[2];
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdShiftedCoulombAndLennardJonesBPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cut, 
+		double r_cutoff2, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double shift_fac;
+	double wellDepth, eqSeparation, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, NULL,
+		AdShiftedCoulombElectrostatics, 'B', EPSILON_RP, cut, r_cutoff2, 0, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cut*cut;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of atom one is kept in a local while we loop over its partners
+		position = coordinates[i];
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			wellDepth = list->paramOne[j];
+			eqSeparation = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(r*/r)^6 without pow
+			vdw_hold = eqSeparation*length_rec;
+			vdw_hold *= vdw_hold;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			//est shift factor
+			shift_fac = (cut - length)*(cut - length)*r_cutoff2;
+
+			vdwPotential += wellDepth*vdw_hold*(vdw_hold - 2);
+			estPotential += est_hold*shift_fac;
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedEnergyLog("Shifted", "B", i, atom_two, wellDepth, eqSeparation, 
+				chargeProduct, length, est_hold, vdwPotential,
+				__ShiftedNonbondedEnergyDebug__); 
+#endif
+		}
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdShiftedCoulombAndLennardJonesBPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cut, 
+		double r_cutoff2, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double force_mag;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double shift_fac;
+	double wellDepth, eqSeparation, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	double accumulated[3];
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, forces,
+		AdShiftedCoulombElectrostatics, 'B', EPSILON_RP, cut, r_cutoff2, 0, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cut*cut;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of (and force on) atom one is kept
+		//in locals while we loop over its partners
+		position = coordinates[i];
+		accumulated[0] = accumulated[1] = accumulated[2] = 0;
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			wellDepth = list->paramOne[j];
+			eqSeparation = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(r*/r)^6 without pow
+			vdw_hold = eqSeparation*length_rec;
+			vdw_hold *= vdw_hold;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			//est shift factor
+			shift_fac = (cut - length)*(cut - length)*r_cutoff2;
+
+			//Note wellDepth here is the actual wellDepth*vdw_hold
+			wellDepth *= vdw_hold;
+			vdwPotential += wellDepth*(vdw_hold - 2);
+			estPotential += est_hold*shift_fac;
+
+			//the shifted est force is EST_HOLD*(length_rec - r_cutoff2*length)
+			force_mag = est_hold*(length_rec - r_cutoff2*length);
+
+			//add the vdw force to the est force
+			force_mag += 12*length_rec*wellDepth*(vdw_hold - 1);
+			force_mag *= length_rec;
+
+			//calculate the force on atom one along the vector (r1 - r2)
+			//the force on atom two is the opposite of this force
+			*(seperation_s.vector + 0) *= force_mag;
+			*(seperation_s.vector + 1) *= force_mag;
+			*(seperation_s.vector + 2) *= force_mag;
+
+			accumulated[0] += *(seperation_s.vector + 0);
+			accumulated[1] += *(seperation_s.vector + 1);
+			accumulated[2] += *(seperation_s.vector + 2);
+
+			forces[atom_two][0] -= *(seperation_s.vector + 0);
+			forces[atom_two][1] -= *(seperation_s.vector + 1);
+			forces[atom_two][2] -= *(seperation_s.vector + 2);
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedForceLog("Shifted", "B", i, atom_two, wellDepth, eqSeparation, 
+				chargeProduct, length, est_hold, vdwPotential, force_mag,
+				__ShiftedNonbondedForceDebug__); 
+#endif
+		}
+
+		forces[i][0] += accumulated[0];
+		forces[i][1] += accumulated[1];
+		forces[i][2] += accumulated[2];
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdGRFCoulombAndLennardJonesBPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double b0, 
+		double b1, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double wellDepth, eqSeparation, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, NULL,
+		AdGRFCoulombElectrostatics, 'B', EPSILON_RP, cutoff, b0, b1, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of atom one is kept in a local while we loop over its partners
+		position = coordinates[i];
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			wellDepth = list->paramOne[j];
+			eqSeparation = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(r*/r)^6 without pow
+			vdw_hold = eqSeparation*length_rec;
+			vdw_hold *= vdw_hold;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*(length_rec + b0);
+
+			vdwPotential += wellDepth*vdw_hold*(vdw_hold - 2);
+			estPotential += est_hold;
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedEnergyLog("GRF", "B", i, atom_two, wellDepth, eqSeparation, 
+				chargeProduct, length, est_hold, vdwPotential,
+				__GRFNonbondedEnergyDebug__); 
+#endif
+		}
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdGRFCoulombAndLennardJonesBPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double b0, 
+		double b1, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double force_mag;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double wellDepth, eqSeparation, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	double accumulated[3];
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	//Use the batched vector kernels if the cpu supports them
+	if(AdVectorCoulombAndLennardJonesPairList(list, coordinates, forces,
+		AdGRFCoulombElectrostatics, 'B', EPSILON_RP, cutoff, b0, b1, vdw_pot, est_pot))
+		return;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of (and force on) atom one is kept
+		//in locals while we loop over its partners
+		position = coordinates[i];
+		accumulated[0] = accumulated[1] = accumulated[2] = 0;
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			wellDepth = list->paramOne[j];
+			eqSeparation = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(r*/r)^6 without pow
+			vdw_hold = eqSeparation*length_rec;
+			vdw_hold *= vdw_hold;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			//Note wellDepth here is the actual wellDepth*vdw_hold
+			wellDepth *= vdw_hold;
+			vdwPotential += wellDepth*(vdw_hold - 2);
+			estPotential += est_hold + EPSILON_RP*chargeProduct*b0;
+
+			force_mag = est_hold*length_rec + EPSILON_RP*chargeProduct*b1*length;
+
+			//add the vdw force to the est force
+			force_mag += 12*length_rec*wellDepth*(vdw_hold - 1);
+			force_mag *= length_rec;
+
+			//calculate the force on atom one along the vector (r1 - r2)
+			//the force on atom two is the opposite of this force
+			*(seperation_s.vector + 0) *= force_mag;
+			*(seperation_s.vector + 1) *= force_mag;
+			*(seperation_s.vector + 2) *= force_mag;
+
+			accumulated[0] += *(seperation_s.vector + 0);
+			accumulated[1] += *(seperation_s.vector + 1);
+			accumulated[2] += *(seperation_s.vector + 2);
+
+			forces[atom_two][0] -= *(seperation_s.vector + 0);
+			forces[atom_two][1] -= *(seperation_s.vector + 1);
+			forces[atom_two][2] -= *(seperation_s.vector + 2);
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedForceLog("GRF", "B", i, atom_two, wellDepth, eqSeparation, 
+				chargeProduct, length, est_hold, vdwPotential, force_mag,
+				__GRFNonbondedForceDebug__); 
+#endif
+		}
+
+		forces[i][0] += accumulated[0];
+		forces[i][1] += accumulated[1];
+		forces[i][2] += accumulated[2];
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdEwaldCoulombAndLennardJonesBPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double ewaldCoefficient, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double erfc_hold;
+	double wellDepth, eqSeparation, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of atom one is kept in a local while we loop over its partners
+		position = coordinates[i];
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			wellDepth = list->paramOne[j];
+			eqSeparation = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(r*/r)^6 without pow
+			vdw_hold = eqSeparation*length_rec;
+			vdw_hold *= vdw_hold;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			vdwPotential += wellDepth*vdw_hold*(vdw_hold - 2);
+
+			//Only the screened short range part of the coulomb interaction is
+			//calculated here. The remainder is calculated in reciprocal space.
+			erfc_hold = erfc(ewaldCoefficient*length);
+			estPotential += est_hold*erfc_hold;
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedEnergyLog("Ewald", "B", i, atom_two, wellDepth, eqSeparation, 
+				chargeProduct, length, est_hold, vdwPotential,
+				__NonbondedEnergyDebug__); 
+#endif
+		}
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
+
+void AdEwaldCoulombAndLennardJonesBPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double ewaldCoefficient, 
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, atom_two;
+	int* neighbours;
+	double force_mag;
+	double length, length_sq, length_rec, vdw_hold, est_hold, cutoff_sq;
+	double erfc_hold;
+	double wellDepth, eqSeparation, chargeProduct;
+	double vdwPotential, estPotential;
+	double *position, *partner;
+	double accumulated[3];
+	Vector3D seperation_s;
+	AdPeriodicBox* box;
+
+	neighbours = list->neighbours;
+	cutoff_sq = cutoff*cutoff;
+	vdwPotential = estPotential = 0;
+
+	box = list->periodicBox;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		//The position of (and force on) atom one is kept
+		//in locals while we loop over its partners
+		position = coordinates[i];
+		accumulated[0] = accumulated[1] = accumulated[2] = 0;
+		for(; j<end; j++)
+		{
+			atom_two = neighbours[j];
+			partner = coordinates[atom_two];
+
+			//calculate seperation vector (r1 - r2)
+			*(seperation_s.vector + 0) = position[0] - partner[0];
+			*(seperation_s.vector + 1) = position[1] - partner[1];
+			*(seperation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(seperation_s.vector, box);
+
+			//Reject using the squared length to avoid the sqrt for pairs beyond the cutoff
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			if(length_sq > cutoff_sq)
+				continue;
+
+			length = sqrt(length_sq);
+			length_rec = 1/length;
+			wellDepth = list->paramOne[j];
+			eqSeparation = list->paramTwo[j];
+			chargeProduct = list->chargeProducts[j];
+
+			//(r*/r)^6 without pow
+			vdw_hold = eqSeparation*length_rec;
+			vdw_hold *= vdw_hold;
+			vdw_hold = vdw_hold*vdw_hold*vdw_hold;
+			est_hold = EPSILON_RP*chargeProduct*length_rec;
+
+			//Note wellDepth here is the actual wellDepth*vdw_hold
+			wellDepth *= vdw_hold;
+			vdwPotential += wellDepth*(vdw_hold - 2);
+
+			//Only the screened short range part of the coulomb interaction is
+			//calculated here. The remainder is calculated in reciprocal space.
+			erfc_hold = erfc(ewaldCoefficient*length);
+			estPotential += est_hold*erfc_hold;
+
+			force_mag = est_hold*length_rec*(erfc_hold + 
+					M_2_SQRTPI*ewaldCoefficient*length*exp(-ewaldCoefficient*ewaldCoefficient*length_sq));
+
+			//add the vdw force to the est force
+			force_mag += 12*length_rec*wellDepth*(vdw_hold - 1);
+			force_mag *= length_rec;
+
+			//calculate the force on atom one along the vector (r1 - r2)
+			//the force on atom two is the opposite of this force
+			*(seperation_s.vector + 0) *= force_mag;
+			*(seperation_s.vector + 1) *= force_mag;
+			*(seperation_s.vector + 2) *= force_mag;
+
+			accumulated[0] += *(seperation_s.vector + 0);
+			accumulated[1] += *(seperation_s.vector + 1);
+			accumulated[2] += *(seperation_s.vector + 2);
+
+			forces[atom_two][0] -= *(seperation_s.vector + 0);
+			forces[atom_two][1] -= *(seperation_s.vector + 1);
+			forces[atom_two][2] -= *(seperation_s.vector + 2);
+
+#ifdef BASE_NONBONDED_DEBUG
+			AdNonbondedForceLog("Ewald", "B", i, atom_two, wellDepth, eqSeparation, 
+				chargeProduct, length, est_hold, vdwPotential, force_mag,
+				__NonbondedForceDebug__); 
+#endif
+		}
+
+		forces[i][0] += accumulated[0];
+		forces[i][1] += accumulated[1];
+		forces[i][2] += accumulated[2];
+	}
+
+	*vdw_pot += vdwPotential;
+	*est_pot += estPotential;
+}
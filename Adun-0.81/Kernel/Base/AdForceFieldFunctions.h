@@ -31,6 +31,8 @@
 #include <fenv.h>
 #include "Base/AdVector.h"
 #include "Base/AdLinkedList.h"
+#include "Base/AdPairList.h"
+#include "Base/AdNonbondedKernels.h"
 
 /**
 Debugging
@@ -287,6 +289,135 @@ void AdGRFCoulombAndLennardJonesBForce(ListElement* interaction,
 		double b1,
 		double* vdw_pot, 
 		double* est_pot); 
+/** Pair list versions of the lennard jones A functions above.
+Each call iterates over every pair in \e list (see ::AdPairList).
+Pairs are rejected by comparing the squared separation to the squared cutoff.
+The separation is not written back to the list. */
+void AdCoulombAndLennardJonesAPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdCoulombAndLennardJonesAPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdShiftedCoulombAndLennardJonesAPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cut, 
+		double r_cutoff2, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdShiftedCoulombAndLennardJonesAPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cut, 
+		double r_cutoff2, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdGRFCoulombAndLennardJonesAPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double b0, 
+		double b1, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdGRFCoulombAndLennardJonesAPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double b0, 
+		double b1, 
+		double* vdw_pot, 
+		double* est_pot);
+/** Pair list versions of the lennard jones B functions above.
+Each call iterates over every pair in \e list (see ::AdPairList). */
+void AdCoulombAndLennardJonesBPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdCoulombAndLennardJonesBPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdShiftedCoulombAndLennardJonesBPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cut, 
+		double r_cutoff2, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdShiftedCoulombAndLennardJonesBPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cut, 
+		double r_cutoff2, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdGRFCoulombAndLennardJonesBPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double b0, 
+		double b1, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdGRFCoulombAndLennardJonesBPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double b0, 
+		double b1, 
+		double* vdw_pot, 
+		double* est_pot);
+/** Real space part of the Ewald sum for use with particle mesh Ewald (see AdParticleMeshEwald.h).
+The same as the pair list lennard jones A and B functions above except the coulomb
+interaction of each pair is screened by \f$ erfc(\beta r) \f$ where \f$ \beta \f$ is \e ewaldCoefficient. */
+void AdEwaldCoulombAndLennardJonesAPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double ewaldCoefficient, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdEwaldCoulombAndLennardJonesAPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double ewaldCoefficient, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdEwaldCoulombAndLennardJonesBPairListEnergy(AdPairList* list, 
+		double** coordinates, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double ewaldCoefficient, 
+		double* vdw_pot, 
+		double* est_pot);
+void AdEwaldCoulombAndLennardJonesBPairListForce(AdPairList* list, 
+		double** coordinates, 
+		double** forces, 
+		double EPSILON_RP, 
+		double cutoff, 
+		double ewaldCoefficient, 
+		double* vdw_pot, 
+		double* est_pot);
 //test		
 void AdCoulombAndLennardJonesAForceTest(ListElement* interaction, 
 		Vector3D* seperation_s, 
@@ -301,7 +301,7 @@ int AdFourierTorsionForce(double *interaction, double** coordinates, double** fo
 	 *
 	 * n = 3, gamma=0
 	 *
-	 * -12*K*cos(theta)*cos(theta) - 3*K
+	 * -12*K*cos(theta)*cos(theta) + 3*K
 	 *
 	 * gamma = 180 simply changes the sign.
 	 * 
@@ -329,17 +329,17 @@ int AdFourierTorsionForce(double *interaction, double** coordinates, double** fo
 		}
 		else if(period == 3)
 		{
-			A = -12*tor_cnst*cosine_ang*cosine_ang - 3*tor_cnst;
+			A = -12*tor_cnst*cosine_ang*cosine_ang + 3*tor_cnst;
 		}
 		else
-			A = -1*tor_cnst*sin(period*angle)/sin(angle);
+			A = -1*period*tor_cnst*sin(period*angle)/sin(angle);
 
 		if(phase==M_PI)
 			A *= -1;
 	}	
 	else
 	{
-		A = -1*tor_cnst*(sin(period*angle)*cos(phase) - 
+		A = -1*period*tor_cnst*(sin(period*angle)*cos(phase) - 
 			cos(period*angle)*sin(phase))/sin(angle);
 	}
 
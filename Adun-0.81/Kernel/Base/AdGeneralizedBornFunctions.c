@@ -204,6 +204,134 @@ void AdGBESeparationDerivative(ListElement* interaction,
 	forces[atomTwo][2] += *(separation_s.vector + 2);
 }
 
+void AdGeneralizedBornPairListEnergy(AdPairList* list,
+				    double** coordinates,
+				    double* radii,
+				    double cutoff,
+				    double* est_pot)
+{
+	int atomOne, atomTwo, j, end;
+	double exponent, squaredSeparation, cutoff_sq;
+	double radiusOne, radiusTwo, numerator, energy;
+	double *position, *partner;
+	Vector3D separation_s;
+	AdPeriodicBox* box;
+
+	energy = 0;
+	cutoff_sq = cutoff*cutoff;
+	box = list->periodicBox;
+	for(atomOne=0; atomOne<list->numberOfElements; atomOne++)
+	{
+		j = list->offsets[atomOne];
+		end = list->offsets[atomOne+1];
+		position = coordinates[atomOne];
+		radiusOne = radii[atomOne];
+		for(; j<end; j++)
+		{
+			atomTwo = list->neighbours[j];
+			partner = coordinates[atomTwo];
+
+			//calculate seperation vector (r1 - r2)
+			*(separation_s.vector + 0) = position[0] - partner[0];
+			*(separation_s.vector + 1) = position[1] - partner[1];
+			*(separation_s.vector + 2) = position[2] - partner[2];
+			if(box != NULL)
+				AdMinimumImage(separation_s.vector, box);
+			
+			Ad3DVectorLengthSquared(&separation_s);
+			squaredSeparation = separation_s.length;
+			if(squaredSeparation >= cutoff_sq)
+				continue;
+	
+			radiusTwo = radii[atomTwo];
+			numerator = -electrostaticConstant*list->chargeProducts[j];
+			exponent = exp(-squaredSeparation/(4*radiusOne*radiusTwo));
+			energy += numerator/sqrt(squaredSeparation + radiusOne*radiusTwo*exponent);
+		}
+	}
+
+	*est_pot += energy;
+}
+
+void AdGBEPairListSeparationDerivative(AdPairList* list,
+				    double** coordinates,
+				    double** forces,
+				    double* radii,
+				    double cutoff,
+				    double* est_pot)
+{				    	
+	int atomOne, atomTwo, j, end;
+	double exponent, squaredSeparation, cutoff_sq;
+	double radiusOne, radiusTwo, energy;
+	double numerator, denominator, forceMagnitude, preFactor;
+	double *position, *partner;
+	double accumulated[3];
+	Vector3D separation_s;
+	AdPeriodicBox* box;
+
+	energy = 0;
+	cutoff_sq = cutoff*cutoff;
+	box = list->periodicBox;
+	for(atomOne=0; atomOne<list->numberOfElements; atomOne++)
+	{
+		j = list->offsets[atomOne];
+		end = list->offsets[atomOne+1];
+		if(j == end)
+			continue;
+
+		position = coordinates[atomOne];
+		radiusOne = radii[atomOne];
+		accumulated[0] = accumulated[1] = accumulated[2] = 0;
+		for(; j<end; j++)
+		{
+			atomTwo = list->neighbours[j];
+			partner = coordinates[atomTwo];
+
+			//calculate seperation vector (r2 - r1)
+			//This is the vector from atom one to atom two
+			*(separation_s.vector + 0) = partner[0] - position[0];
+			*(separation_s.vector + 1) = partner[1] - position[1];
+			*(separation_s.vector + 2) = partner[2] - position[2];
+			if(box != NULL)
+				AdMinimumImage(separation_s.vector, box);
+
+			Ad3DVectorLengthSquared(&separation_s);
+			squaredSeparation = separation_s.length;
+			if(squaredSeparation >= cutoff_sq)
+				continue;
+
+			//See AdGBESeparationDerivative() for the derivation
+			radiusTwo = radii[atomTwo];
+			exponent = squaredSeparation/(4*radiusOne*radiusTwo);
+			preFactor =  0.5*electrostaticConstant*list->chargeProducts[j];
+			exponent = exp(-exponent);
+			denominator = sqrt(squaredSeparation + radiusOne*radiusTwo*exponent);
+			numerator = preFactor*(4 - exponent);
+			energy += -2*preFactor/denominator;
+			denominator = denominator*denominator*denominator;
+			forceMagnitude = -1*numerator/denominator;
+
+			*(separation_s.vector + 0) *= forceMagnitude;
+			*(separation_s.vector + 1) *= forceMagnitude;
+			*(separation_s.vector + 2) *= forceMagnitude;
+
+			accumulated[0] -= *(separation_s.vector + 0);
+			accumulated[1] -= *(separation_s.vector + 1);
+			accumulated[2] -= *(separation_s.vector + 2);
+
+			forces[atomTwo][0] += *(separation_s.vector + 0);
+			forces[atomTwo][1] += *(separation_s.vector + 1);
+			forces[atomTwo][2] += *(separation_s.vector + 2);
+		}
+
+		forces[atomOne][0] += accumulated[0];
+		forces[atomOne][1] += accumulated[1];
+		forces[atomOne][2] += accumulated[2];
+	}
+
+	*est_pot += energy;
+}
+
 /*
 Calculates derivative of the Born energy with respect to the born radii, R_a & R_b of the atoms.
 On return the 2-element array \e results contains the derivatives.
@@ -29,6 +29,7 @@
 #include <Base/AdVector.h>
 #include <Base/AdMatrix.h>
 #include <Base/AdLinkedList.h>
+#include <Base/AdPairList.h>
 
 /**
  These are the primitive functions used to calculate the GB radius using the GBSW method.
@@ -114,6 +115,27 @@ void AdGBESeparationDerivative(ListElement* interaction,
 				     double* radii, 
 				     double* est_pot);
 				     
+/**
+As AdGeneralizedBornEnergy() but calculates the contribution of every pair in \e list
+separated by less than \e cutoff.
+*/
+void AdGeneralizedBornPairListEnergy(AdPairList* list,
+				    double** coordinates,
+				    double* radii,
+				    double cutoff,
+				    double* est_pot);
+
+/**
+As AdGBESeparationDerivative() but for every pair in \e list
+separated by less than \e cutoff.
+*/
+void AdGBEPairListSeparationDerivative(AdPairList* list,
+				     double** coordinates,
+				     double** forces,
+				     double* radii,
+				     double cutoff,
+				     double* est_pot);
+
 /**
  Calculated the magnitude of the derivative of the GB energy with respect to the separation of the atoms.
  On return \e forceMagnitude contains the result.
@@ -240,6 +240,11 @@ void AdHarmonicImproperTorsionForce(double* interaction, double **coordinates, d
 
 	*itor_pot += coffA*(angle - equilibriumAngle)*0.5;
 
+	//dtheta/du where u is the cosine of the angle is -1/sin(theta).
+	//The sign is accounted for below.
+
+	coffA /= fmax(sin(angle), 1E-15);
+
 	/*
 	 *Calculate the partial derivatives for the torsion angle = n1.n2/|n1||n2|	
 	 *There are 12 pd's for n1.n2 and 12 for |n1||n2|. 
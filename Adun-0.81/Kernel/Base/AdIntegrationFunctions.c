@@ -0,0 +1,127 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#include "Base/AdIntegrationFunctions.h"
+
+/*
+ * The common cases, one and two acceleration sources, are handled separately
+ * so the inner loop does not have to iterate over the sources.
+ */
+
+void AdUpdateVelocities(double* velocities,
+		double** accelerations,
+		int numberOfSources,
+		int numberOfElements,
+		double factor)
+{
+	int i, j, length;
+	double sum;
+	double *sourceOne, *sourceTwo;
+
+	length = 3*numberOfElements;
+	if(numberOfSources == 1)
+	{
+		sourceOne = accelerations[0];
+		for(i=0; i<length; i++)
+			velocities[i] += factor*sourceOne[i];
+	}
+	else if(numberOfSources == 2)
+	{
+		sourceOne = accelerations[0];
+		sourceTwo = accelerations[1];
+		for(i=0; i<length; i++)
+			velocities[i] += factor*(sourceOne[i] + sourceTwo[i]);
+	}
+	else if(numberOfSources > 2)
+	{
+		for(i=0; i<length; i++)
+		{
+			sum = 0;
+			for(j=0; j<numberOfSources; j++)
+				sum += accelerations[j][i];
+
+			velocities[i] += factor*sum;
+		}
+	}
+}
+
+void AdUpdateVelocitiesAndPositions(double* velocities,
+		double* positions,
+		double** accelerations,
+		int numberOfSources,
+		int numberOfElements,
+		double factor,
+		double timeStep)
+{
+	int i, j, length;
+	double sum;
+	double *sourceOne, *sourceTwo;
+
+	length = 3*numberOfElements;
+	if(numberOfSources == 0)
+	{
+		AdUpdatePositions(positions, velocities, numberOfElements, timeStep);
+	}
+	else if(numberOfSources == 1)
+	{
+		sourceOne = accelerations[0];
+		for(i=0; i<length; i++)
+		{
+			velocities[i] += factor*sourceOne[i];
+			positions[i] += velocities[i]*timeStep;
+		}
+	}
+	else if(numberOfSources == 2)
+	{
+		sourceOne = accelerations[0];
+		sourceTwo = accelerations[1];
+		for(i=0; i<length; i++)
+		{
+			velocities[i] += factor*(sourceOne[i] + sourceTwo[i]);
+			positions[i] += velocities[i]*timeStep;
+		}
+	}
+	else
+	{
+		for(i=0; i<length; i++)
+		{
+			sum = 0;
+			for(j=0; j<numberOfSources; j++)
+				sum += accelerations[j][i];
+
+			velocities[i] += factor*sum;
+			positions[i] += velocities[i]*timeStep;
+		}
+	}
+}
+
+void AdUpdatePositions(double* positions,
+		double* velocities,
+		int numberOfElements,
+		double timeStep)
+{
+	int i, length;
+
+	length = 3*numberOfElements;
+	for(i=0; i<length; i++)
+		positions[i] += velocities[i]*timeStep;
+}
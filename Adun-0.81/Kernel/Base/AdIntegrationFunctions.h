@@ -0,0 +1,71 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#ifndef INTEGRATION_FUNCTIONS
+#define INTEGRATION_FUNCTIONS
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+Kernels for the velocity verlet update steps. The kernels operate on the contiguous
+element arrays of AdMatrix structures i.e. matrix->matrix[0], which have three entries per element.
+Each acceleration source is a pointer to the first entry of the elements being updated. For an
+interaction system this is the entry of the row given by the offset of the system.
+\defgroup IntegrationFunctions Integration
+\ingroup Functions
+@{
+*/
+
+/**
+Adds \e factor times the sum of the \e numberOfSources arrays in \e accelerations to \e velocities.
+*/
+void AdUpdateVelocities(double* velocities,
+		double** accelerations,
+		int numberOfSources,
+		int numberOfElements,
+		double factor);
+
+/**
+Adds \e factor times the sum of the \e numberOfSources arrays in \e accelerations to \e velocities
+and then adds the new velocities times \e timeStep to \e positions. This performs the first
+two velocity verlet steps in one pass over the arrays.
+*/
+void AdUpdateVelocitiesAndPositions(double* velocities,
+		double* positions,
+		double** accelerations,
+		int numberOfSources,
+		int numberOfElements,
+		double factor,
+		double timeStep);
+
+/**
+Adds \e velocities times \e timeStep to \e positions.
+*/
+void AdUpdatePositions(double* positions,
+		double* velocities,
+		int numberOfElements,
+		double timeStep);
+
+/** \@}**/
+
+#endif
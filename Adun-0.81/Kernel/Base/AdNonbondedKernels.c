@@ -0,0 +1,601 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#include "Base/AdNonbondedKernels.h"
+
+#ifdef BASE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+//The kernel set in use. Less than 0 until the cpu has been checked.
+static int selectedKernels = -1;
+
+static AdNonbondedKernelSet AdSupportedNonbondedKernels(void)
+{
+#ifdef BASE_X86_SIMD
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx512f"))
+		return AdAVX512NonbondedKernels;
+
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		return AdAVX2NonbondedKernels;
+#endif
+	return AdScalarNonbondedKernels;
+}
+
+AdNonbondedKernelSet AdNonbondedKernels(void)
+{
+	if(selectedKernels < 0)
+		selectedKernels = AdSupportedNonbondedKernels();
+
+	return selectedKernels;
+}
+
+AdNonbondedKernelSet AdSetNonbondedKernels(AdNonbondedKernelSet kernelSet)
+{
+	AdNonbondedKernelSet supported;
+
+	supported = AdSupportedNonbondedKernels();
+	selectedKernels = (kernelSet > supported) ? supported : kernelSet;
+
+	return selectedKernels;
+}
+
+const char* AdNonbondedKernelsName(AdNonbondedKernelSet kernelSet)
+{
+	switch(kernelSet)
+	{
+		case AdAVX2NonbondedKernels:
+			return "AVX2";
+		case AdAVX512NonbondedKernels:
+			return "AVX-512";
+		default:
+			return "Scalar";
+	}
+}
+
+#ifdef BASE_X86_SIMD
+
+/*
+ * Sets rows to the coordinates of the \e count partners in \e neighbours.
+ * The remaining rows, up to \e width, are set to \e position. 
+ * They are masked out by the kernels.
+ */
+static inline void AdPartnerRows(double** coordinates, 
+		int* neighbours, 
+		int count, 
+		int width, 
+		double* position,
+		double** rows)
+{
+	int k;
+
+	for(k=0; k<count; k++)
+		rows[k] = coordinates[neighbours[k]];
+
+	for(; k<width; k++)
+		rows[k] = position;
+}
+
+/*
+ * Copies the last \e count parameters of an element into zero padded arrays.
+ */
+static inline void AdGatherTail(AdPairList* list, 
+		int start, 
+		int count, 
+		int width, 
+		double* paramOne, 
+		double* paramTwo, 
+		double* chargeProducts)
+{
+	int k;
+
+	for(k=0; k<count; k++)
+	{
+		paramOne[k] = list->paramOne[start + k];
+		paramTwo[k] = list->paramTwo[start + k];
+		chargeProducts[k] = list->chargeProducts[start + k];
+	}
+
+	for(; k<width; k++)
+		paramOne[k] = paramTwo[k] = chargeProducts[k] = 0;
+}
+
+/*
+ * Subtracts the batch forces from the partners.
+ */
+static inline void AdScatterForces(double** forces, 
+		int* neighbours, 
+		int count, 
+		double* fx, 
+		double* fy, 
+		double* fz)
+{
+	int k;
+	double* partner;
+
+	for(k=0; k<count; k++)
+	{
+		partner = forces[neighbours[k]];
+		partner[0] -= fx[k];
+		partner[1] -= fy[k];
+		partner[2] -= fz[k];
+	}
+}
+
+/*
+ * AVX2 - four pairs per batch
+ */
+
+__attribute__((target("avx2,fma")))
+static void AdAVX2CoulombAndLennardJonesPairList(AdPairList* list, 
+		double** coordinates, 
+		double** forces,
+		AdElectrostaticsType electrostatics,
+		char lennardJonesType,
+		double EPSILON_RP, 
+		double cutoff, 
+		double parameterOne, 
+		double parameterTwo,
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, count;
+	int* neighbours;
+	double *position, *paramOne, *paramTwo, *chargeProducts;
+	double* rows[4];
+	double x[4] __attribute__ ((aligned (32)));
+	double y[4] __attribute__ ((aligned (32)));
+	double z[4] __attribute__ ((aligned (32)));
+	double tailOne[4] __attribute__ ((aligned (32)));
+	double tailTwo[4] __attribute__ ((aligned (32)));
+	double tailCharges[4] __attribute__ ((aligned (32)));
+	double sums[4] __attribute__ ((aligned (32)));
+	__m256d px, py, pz, dx, dy, dz, fx, fy, fz, ax, ay, az;
+	__m256d length_sq, length, length_rec, length_rec_sq, vdw_hold;
+	__m256d lennardJonesA, lennardJonesB, chargeProduct, est_hold, est_force, force_mag;
+	__m256d mask, vdwPotential, estPotential;
+	__m256d zero, one, two, six, twelve, half, lanes, cutoff_v, cutoff_sq, epsilon, p1, p2;
+	__m256d boxLengths[3], boxReciprocals[3];
+	AdPeriodicBox* box;
+
+	neighbours = list->neighbours;
+	box = list->periodicBox;
+
+	zero = _mm256_setzero_pd();
+	one = _mm256_set1_pd(1.0);
+	two = _mm256_set1_pd(2.0);
+	six = _mm256_set1_pd(6.0);
+	twelve = _mm256_set1_pd(12.0);
+	half = _mm256_set1_pd(0.5);
+	lanes = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+	cutoff_v = _mm256_set1_pd(cutoff);
+	cutoff_sq = _mm256_set1_pd(cutoff*cutoff);
+	epsilon = _mm256_set1_pd(EPSILON_RP);
+	p1 = _mm256_set1_pd(parameterOne);
+	p2 = _mm256_set1_pd(parameterTwo);
+	if(box != NULL)
+		for(i=0; i<3; i++)
+		{
+			boxLengths[i] = _mm256_set1_pd(box->lengths[i]);
+			boxReciprocals[i] = _mm256_set1_pd(box->reciprocalLengths[i]);
+		}
+
+	vdwPotential = estPotential = zero;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		position = coordinates[i];
+		px = _mm256_set1_pd(position[0]);
+		py = _mm256_set1_pd(position[1]);
+		pz = _mm256_set1_pd(position[2]);
+		ax = ay = az = zero;
+		for(; j<end; j+=4)
+		{
+			count = (end - j < 4) ? end - j : 4;
+			AdPartnerRows(coordinates, neighbours + j, count, 4, position, rows);
+
+			//calculate seperation vectors (r1 - r2)
+			dx = _mm256_sub_pd(px, 
+				_mm256_set_pd(rows[3][0], rows[2][0], rows[1][0], rows[0][0]));
+			dy = _mm256_sub_pd(py, 
+				_mm256_set_pd(rows[3][1], rows[2][1], rows[1][1], rows[0][1]));
+			dz = _mm256_sub_pd(pz, 
+				_mm256_set_pd(rows[3][2], rows[2][2], rows[1][2], rows[0][2]));
+			if(box != NULL)
+			{
+				dx = _mm256_fnmadd_pd(boxLengths[0], 
+					_mm256_floor_pd(_mm256_fmadd_pd(dx, boxReciprocals[0], half)), dx);
+				dy = _mm256_fnmadd_pd(boxLengths[1], 
+					_mm256_floor_pd(_mm256_fmadd_pd(dy, boxReciprocals[1], half)), dy);
+				dz = _mm256_fnmadd_pd(boxLengths[2], 
+					_mm256_floor_pd(_mm256_fmadd_pd(dz, boxReciprocals[2], half)), dz);
+			}
+
+			//Mask out padding lanes and pairs beyond the cutoff
+			length_sq = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+			mask = _mm256_and_pd(_mm256_cmp_pd(lanes, _mm256_set1_pd(count), _CMP_LT_OQ),
+					_mm256_cmp_pd(length_sq, cutoff_sq, _CMP_LE_OQ));
+			if(_mm256_movemask_pd(mask) == 0)
+				continue;
+
+			//Masked lanes get a length of 1 so they stay finite
+			length_sq = _mm256_blendv_pd(one, length_sq, mask);
+			//1/r from a full precision square root and division. AVX2 has no double
+			//precision reciprocal square root estimate.
+			length_rec = _mm256_div_pd(one, _mm256_sqrt_pd(length_sq));
+			length_rec_sq = _mm256_mul_pd(length_rec, length_rec);
+
+			if(count == 4)
+			{
+				paramOne = list->paramOne + j;
+				paramTwo = list->paramTwo + j;
+				chargeProducts = list->chargeProducts + j;
+			}
+			else
+			{
+				AdGatherTail(list, j, count, 4, tailOne, tailTwo, tailCharges);
+				paramOne = tailOne;
+				paramTwo = tailTwo;
+				chargeProducts = tailCharges;
+			}
+
+			lennardJonesA = _mm256_loadu_pd(paramOne);
+			lennardJonesB = _mm256_loadu_pd(paramTwo);
+			chargeProduct = _mm256_loadu_pd(chargeProducts);
+
+			if(lennardJonesType == 'A')
+			{
+				//(1/r)^6
+				vdw_hold = _mm256_mul_pd(_mm256_mul_pd(length_rec_sq, length_rec_sq), length_rec_sq);
+				lennardJonesA = _mm256_mul_pd(lennardJonesA, _mm256_mul_pd(vdw_hold, vdw_hold));
+				lennardJonesB = _mm256_mul_pd(lennardJonesB, vdw_hold);
+			}
+			else
+			{
+				//(r*/r)^6. paramOne is the well depth.
+				vdw_hold = _mm256_mul_pd(lennardJonesB, length_rec);
+				vdw_hold = _mm256_mul_pd(vdw_hold, vdw_hold);
+				vdw_hold = _mm256_mul_pd(_mm256_mul_pd(vdw_hold, vdw_hold), vdw_hold);
+				lennardJonesB = _mm256_mul_pd(two, _mm256_mul_pd(lennardJonesA, vdw_hold));
+				lennardJonesA = _mm256_mul_pd(lennardJonesA, _mm256_mul_pd(vdw_hold, vdw_hold));
+			}
+
+			chargeProduct = _mm256_mul_pd(epsilon, chargeProduct);
+			est_hold = _mm256_mul_pd(chargeProduct, length_rec);
+			switch(electrostatics)
+			{
+				case AdShiftedCoulombElectrostatics:
+					length = _mm256_mul_pd(length_sq, length_rec);
+					est_force = _mm256_mul_pd(est_hold, 
+						_mm256_fnmadd_pd(p1, length, length_rec));
+					vdw_hold = _mm256_sub_pd(cutoff_v, length);
+					est_hold = _mm256_mul_pd(est_hold, 
+						_mm256_mul_pd(_mm256_mul_pd(vdw_hold, vdw_hold), p1));
+					break;
+				case AdGRFCoulombElectrostatics:
+					length = _mm256_mul_pd(length_sq, length_rec);
+					est_force = _mm256_fmadd_pd(est_hold, length_rec, 
+						_mm256_mul_pd(_mm256_mul_pd(chargeProduct, p2), length));
+					est_hold = _mm256_fmadd_pd(chargeProduct, p1, est_hold);
+					break;
+				default:
+					est_force = _mm256_mul_pd(est_hold, length_rec);
+					break;
+			}
+
+			estPotential = _mm256_add_pd(estPotential, _mm256_and_pd(est_hold, mask));
+			vdwPotential = _mm256_add_pd(vdwPotential, 
+					_mm256_and_pd(_mm256_sub_pd(lennardJonesA, lennardJonesB), mask));
+			if(forces == NULL)
+				continue;
+
+			//est_force/r + (12A - 6B)/r^2
+			force_mag = _mm256_fmsub_pd(twelve, lennardJonesA, _mm256_mul_pd(six, lennardJonesB));
+			force_mag = _mm256_mul_pd(force_mag, length_rec_sq);
+			force_mag = _mm256_and_pd(_mm256_fmadd_pd(est_force, length_rec, force_mag), mask);
+
+			fx = _mm256_mul_pd(dx, force_mag);
+			fy = _mm256_mul_pd(dy, force_mag);
+			fz = _mm256_mul_pd(dz, force_mag);
+			ax = _mm256_add_pd(ax, fx);
+			ay = _mm256_add_pd(ay, fy);
+			az = _mm256_add_pd(az, fz);
+
+			_mm256_store_pd(x, fx);
+			_mm256_store_pd(y, fy);
+			_mm256_store_pd(z, fz);
+			AdScatterForces(forces, neighbours + j, count, x, y, z);
+		}
+
+		if(forces != NULL)
+		{
+			_mm256_store_pd(sums, ax);
+			forces[i][0] += sums[0] + sums[1] + sums[2] + sums[3];
+			_mm256_store_pd(sums, ay);
+			forces[i][1] += sums[0] + sums[1] + sums[2] + sums[3];
+			_mm256_store_pd(sums, az);
+			forces[i][2] += sums[0] + sums[1] + sums[2] + sums[3];
+		}	
+	}
+
+	_mm256_store_pd(sums, vdwPotential);
+	*vdw_pot += sums[0] + sums[1] + sums[2] + sums[3];
+	_mm256_store_pd(sums, estPotential);
+	*est_pot += sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+/*
+ * AVX-512 - eight pairs per batch
+ */
+
+/*
+ * One newton iteration for 1/sqrt(x) starting from the estimate y.
+ * Each iteration doubles the number of correct bits.
+ */
+__attribute__((target("avx512f")))
+static inline __m512d AdAVX512NewtonRsqrt(__m512d x, __m512d y, __m512d half, __m512d threeHalves)
+{
+	__m512d hx;
+
+	hx = _mm512_mul_pd(half, x);
+	return _mm512_mul_pd(y, _mm512_fnmadd_pd(_mm512_mul_pd(hx, y), y, threeHalves));
+}
+
+__attribute__((target("avx512f")))
+static void AdAVX512CoulombAndLennardJonesPairList(AdPairList* list, 
+		double** coordinates, 
+		double** forces,
+		AdElectrostaticsType electrostatics,
+		char lennardJonesType,
+		double EPSILON_RP, 
+		double cutoff, 
+		double parameterOne, 
+		double parameterTwo,
+		double* vdw_pot, 
+		double* est_pot)
+{
+	int i, j, end, count;
+	int* neighbours;
+	double *position, *paramOne, *paramTwo, *chargeProducts;
+	double* rows[8];
+	double x[8] __attribute__ ((aligned (64)));
+	double y[8] __attribute__ ((aligned (64)));
+	double z[8] __attribute__ ((aligned (64)));
+	double tailOne[8] __attribute__ ((aligned (64)));
+	double tailTwo[8] __attribute__ ((aligned (64)));
+	double tailCharges[8] __attribute__ ((aligned (64)));
+	__m512d px, py, pz, dx, dy, dz, fx, fy, fz, ax, ay, az;
+	__m512d length_sq, length, length_rec, length_rec_sq, vdw_hold;
+	__m512d lennardJonesA, lennardJonesB, chargeProduct, est_hold, est_force, force_mag;
+	__m512d vdwPotential, estPotential;
+	__m512d zero, one, two, six, twelve, half, threeHalves, cutoff_v, cutoff_sq, epsilon, p1, p2;
+	__m512d boxLengths[3], boxReciprocals[3];
+	__mmask8 mask;
+	AdPeriodicBox* box;
+
+	neighbours = list->neighbours;
+	box = list->periodicBox;
+
+	zero = _mm512_setzero_pd();
+	one = _mm512_set1_pd(1.0);
+	two = _mm512_set1_pd(2.0);
+	six = _mm512_set1_pd(6.0);
+	twelve = _mm512_set1_pd(12.0);
+	half = _mm512_set1_pd(0.5);
+	threeHalves = _mm512_set1_pd(1.5);
+	cutoff_v = _mm512_set1_pd(cutoff);
+	cutoff_sq = _mm512_set1_pd(cutoff*cutoff);
+	epsilon = _mm512_set1_pd(EPSILON_RP);
+	p1 = _mm512_set1_pd(parameterOne);
+	p2 = _mm512_set1_pd(parameterTwo);
+	if(box != NULL)
+		for(i=0; i<3; i++)
+		{
+			boxLengths[i] = _mm512_set1_pd(box->lengths[i]);
+			boxReciprocals[i] = _mm512_set1_pd(box->reciprocalLengths[i]);
+		}
+
+	vdwPotential = estPotential = zero;
+	for(i=0; i<list->numberOfElements; i++)
+	{
+		j = list->offsets[i];
+		end = list->offsets[i+1];
+		if(j == end)
+			continue;
+
+		position = coordinates[i];
+		px = _mm512_set1_pd(position[0]);
+		py = _mm512_set1_pd(position[1]);
+		pz = _mm512_set1_pd(position[2]);
+		ax = ay = az = zero;
+		for(; j<end; j+=8)
+		{
+			count = (end - j < 8) ? end - j : 8;
+			AdPartnerRows(coordinates, neighbours + j, count, 8, position, rows);
+
+			//calculate seperation vectors (r1 - r2)
+			dx = _mm512_sub_pd(px, _mm512_set_pd(rows[7][0], rows[6][0], rows[5][0], 
+				rows[4][0], rows[3][0], rows[2][0], rows[1][0], rows[0][0]));
+			dy = _mm512_sub_pd(py, _mm512_set_pd(rows[7][1], rows[6][1], rows[5][1], 
+				rows[4][1], rows[3][1], rows[2][1], rows[1][1], rows[0][1]));
+			dz = _mm512_sub_pd(pz, _mm512_set_pd(rows[7][2], rows[6][2], rows[5][2], 
+				rows[4][2], rows[3][2], rows[2][2], rows[1][2], rows[0][2]));
+			if(box != NULL)
+			{
+				dx = _mm512_fnmadd_pd(boxLengths[0], _mm512_roundscale_pd(
+					_mm512_fmadd_pd(dx, boxReciprocals[0], half), 
+					_MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), dx);
+				dy = _mm512_fnmadd_pd(boxLengths[1], _mm512_roundscale_pd(
+					_mm512_fmadd_pd(dy, boxReciprocals[1], half), 
+					_MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), dy);
+				dz = _mm512_fnmadd_pd(boxLengths[2], _mm512_roundscale_pd(
+					_mm512_fmadd_pd(dz, boxReciprocals[2], half), 
+					_MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC), dz);
+			}
+
+			//Mask out padding lanes and pairs beyond the cutoff
+			length_sq = _mm512_fmadd_pd(dz, dz, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx)));
+			mask = _mm512_mask_cmp_pd_mask((__mmask8)((1 << count) - 1), 
+					length_sq, cutoff_sq, _CMP_LE_OQ);
+			if(mask == 0)
+				continue;
+
+			//Masked lanes get a length of 1 so they stay finite
+			length_sq = _mm512_mask_blend_pd(mask, one, length_sq);
+			//1/r from a 14 bit estimate refined with two newton iterations
+			length_rec = _mm512_rsqrt14_pd(length_sq);
+			length_rec = AdAVX512NewtonRsqrt(length_sq, length_rec, half, threeHalves);
+			length_rec = AdAVX512NewtonRsqrt(length_sq, length_rec, half, threeHalves);
+			length_rec_sq = _mm512_mul_pd(length_rec, length_rec);
+
+			if(count == 8)
+			{
+				paramOne = list->paramOne + j;
+				paramTwo = list->paramTwo + j;
+				chargeProducts = list->chargeProducts + j;
+			}
+			else
+			{
+				AdGatherTail(list, j, count, 8, tailOne, tailTwo, tailCharges);
+				paramOne = tailOne;
+				paramTwo = tailTwo;
+				chargeProducts = tailCharges;
+			}
+
+			lennardJonesA = _mm512_loadu_pd(paramOne);
+			lennardJonesB = _mm512_loadu_pd(paramTwo);
+			chargeProduct = _mm512_loadu_pd(chargeProducts);
+
+			if(lennardJonesType == 'A')
+			{
+				//(1/r)^6
+				vdw_hold = _mm512_mul_pd(_mm512_mul_pd(length_rec_sq, length_rec_sq), length_rec_sq);
+				lennardJonesA = _mm512_mul_pd(lennardJonesA, _mm512_mul_pd(vdw_hold, vdw_hold));
+				lennardJonesB = _mm512_mul_pd(lennardJonesB, vdw_hold);
+			}
+			else
+			{
+				//(r*/r)^6. paramOne is the well depth.
+				vdw_hold = _mm512_mul_pd(lennardJonesB, length_rec);
+				vdw_hold = _mm512_mul_pd(vdw_hold, vdw_hold);
+				vdw_hold = _mm512_mul_pd(_mm512_mul_pd(vdw_hold, vdw_hold), vdw_hold);
+				lennardJonesB = _mm512_mul_pd(two, _mm512_mul_pd(lennardJonesA, vdw_hold));
+				lennardJonesA = _mm512_mul_pd(lennardJonesA, _mm512_mul_pd(vdw_hold, vdw_hold));
+			}
+
+			chargeProduct = _mm512_mul_pd(epsilon, chargeProduct);
+			est_hold = _mm512_mul_pd(chargeProduct, length_rec);
+			switch(electrostatics)
+			{
+				case AdShiftedCoulombElectrostatics:
+					length = _mm512_mul_pd(length_sq, length_rec);
+					est_force = _mm512_mul_pd(est_hold, 
+						_mm512_fnmadd_pd(p1, length, length_rec));
+					vdw_hold = _mm512_sub_pd(cutoff_v, length);
+					est_hold = _mm512_mul_pd(est_hold, 
+						_mm512_mul_pd(_mm512_mul_pd(vdw_hold, vdw_hold), p1));
+					break;
+				case AdGRFCoulombElectrostatics:
+					length = _mm512_mul_pd(length_sq, length_rec);
+					est_force = _mm512_fmadd_pd(est_hold, length_rec, 
+						_mm512_mul_pd(_mm512_mul_pd(chargeProduct, p2), length));
+					est_hold = _mm512_fmadd_pd(chargeProduct, p1, est_hold);
+					break;
+				default:
+					est_force = _mm512_mul_pd(est_hold, length_rec);
+					break;
+			}
+
+			estPotential = _mm512_mask_add_pd(estPotential, mask, estPotential, est_hold);
+			vdwPotential = _mm512_mask_add_pd(vdwPotential, mask, vdwPotential,
+					_mm512_sub_pd(lennardJonesA, lennardJonesB));
+			if(forces == NULL)
+				continue;
+
+			//est_force/r + (12A - 6B)/r^2
+			force_mag = _mm512_fmsub_pd(twelve, lennardJonesA, _mm512_mul_pd(six, lennardJonesB));
+			force_mag = _mm512_mul_pd(force_mag, length_rec_sq);
+			force_mag = _mm512_maskz_fmadd_pd(mask, est_force, length_rec, force_mag);
+
+			fx = _mm512_mul_pd(dx, force_mag);
+			fy = _mm512_mul_pd(dy, force_mag);
+			fz = _mm512_mul_pd(dz, force_mag);
+			ax = _mm512_add_pd(ax, fx);
+			ay = _mm512_add_pd(ay, fy);
+			az = _mm512_add_pd(az, fz);
+
+			_mm512_store_pd(x, fx);
+			_mm512_store_pd(y, fy);
+			_mm512_store_pd(z, fz);
+			AdScatterForces(forces, neighbours + j, count, x, y, z);
+		}
+
+		if(forces != NULL)
+		{
+			forces[i][0] += _mm512_reduce_add_pd(ax);
+			forces[i][1] += _mm512_reduce_add_pd(ay);
+			forces[i][2] += _mm512_reduce_add_pd(az);
+		}	
+	}
+
+	*vdw_pot += _mm512_reduce_add_pd(vdwPotential);
+	*est_pot += _mm512_reduce_add_pd(estPotential);
+}
+
+#endif
+
+bool AdVectorCoulombAndLennardJonesPairList(AdPairList* list, 
+		double** coordinates, 
+		double** forces,
+		AdElectrostaticsType electrostatics,
+		char lennardJonesType,
+		double EPSILON_RP, 
+		double cutoff, 
+		double parameterOne, 
+		double parameterTwo,
+		double* vdw_pot, 
+		double* est_pot)
+{
+#ifdef BASE_X86_SIMD
+	switch(AdNonbondedKernels())
+	{
+		case AdAVX512NonbondedKernels:
+			AdAVX512CoulombAndLennardJonesPairList(list, coordinates, forces,
+				electrostatics, lennardJonesType, EPSILON_RP, cutoff, 
+				parameterOne, parameterTwo, vdw_pot, est_pot);
+			return true;
+		case AdAVX2NonbondedKernels:
+			AdAVX2CoulombAndLennardJonesPairList(list, coordinates, forces,
+				electrostatics, lennardJonesType, EPSILON_RP, cutoff, 
+				parameterOne, parameterTwo, vdw_pot, est_pot);
+			return true;
+		default:
+			break;
+	}
+#endif
+	return false;
+}
@@ -0,0 +1,135 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#ifndef NONBONDED_KERNELS
+#define NONBONDED_KERNELS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include "Base/AdPairList.h"
+#include "Base/AdPeriodicBox.h"
+
+/*
+ * The vector kernels are only built for x86 with a compiler that supports
+ * per function target attributes. Define BASE_NO_SIMD to disable them.
+ * They are also disabled when the nonbonded debug logging is on since
+ * they do not log each pair.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+	&& !defined(BASE_NO_SIMD) && !defined(BASE_NONBONDED_DEBUG) && !defined(BASE_DEBUG)
+#define BASE_X86_SIMD
+#endif
+
+//! \brief The instruction sets the batched nonbonded kernels can use.
+/**
+\ingroup Types
+**/
+typedef enum
+{
+	AdScalarNonbondedKernels = 0,	//!< Pairs are processed one at a time.
+	AdAVX2NonbondedKernels = 1,	//!< Pairs are processed four at a time using AVX2 and FMA.
+	AdAVX512NonbondedKernels = 2	//!< Pairs are processed eight at a time using AVX-512.
+}
+AdNonbondedKernelSet;
+
+//! \brief The electrostatic interaction calculated by the batched nonbonded kernels.
+/**
+\ingroup Types
+**/
+typedef enum
+{
+	AdCoulombElectrostatics,	//!< Plain coulomb interaction
+	AdShiftedCoulombElectrostatics,	//!< Coulomb interaction shifted to zero at the cutoff
+	AdGRFCoulombElectrostatics	//!< Coulomb interaction with a generalized reaction field
+}
+AdElectrostaticsType;
+
+/**
+\defgroup nonbondedKernels Batched Nonbonded Kernels
+\ingroup Functions
+
+The coulomb and lennard jones pair list functions in \ref ForceFieldFunctions pass their lists to 
+AdVectorCoulombAndLennardJonesPairList() which processes the partners of each element in batches
+of four (AVX2) or eight (AVX-512) pairs. The coordinates of each batch of partners are gathered 
+directly into vector registers and pairs outside the cutoff are masked using the squared separation.
+The AVX2 kernels perform one vector square root and division per batch while the AVX-512 kernels
+refine the hardware reciprocal square root estimate with two newton iterations. 
+The results agree with the scalar functions to within rounding.
+
+The instruction set is chosen the first time the kernels are used by checking the features of the cpu.
+It can be changed using AdSetNonbondedKernels(). 
+If no vector instruction set is available the scalar pair list functions are used.
+@{
+**/
+
+/**
+Returns the instruction set currently used by the nonbonded pair list functions.
+*/
+AdNonbondedKernelSet AdNonbondedKernels(void);
+
+/**
+Sets the instruction set used by the nonbonded pair list functions to \e kernelSet.
+If the cpu does not support \e kernelSet the best supported set below it is used.
+Returns the set that will be used.
+*/
+AdNonbondedKernelSet AdSetNonbondedKernels(AdNonbondedKernelSet kernelSet);
+
+/**
+Returns the name of \e kernelSet.
+*/
+const char* AdNonbondedKernelsName(AdNonbondedKernelSet kernelSet);
+
+/**
+Calculates the coulomb and lennard jones interactions of the pairs in \e list
+using the current vector kernel set.
+\param list The pairs. The paramOne and paramTwo arrays of the list must contain the 
+precomputed lennard jones parameters for \e lennardJonesType.
+\param coordinates The coordinates of the elements
+\param forces If not NULL the forces on each element are added to this matrix.
+\param electrostatics The type of electrostatic interaction to calculate.
+\param lennardJonesType 'A' or 'B'.
+\param EPSILON_RP The electrostatic constant.
+\param cutoff The cutoff.
+\param parameterOne For AdShiftedCoulombElectrostatics the reciprocal of the cutoff squared.
+For AdGRFCoulombElectrostatics the reaction field constant b0. Otherwise ignored.
+\param parameterTwo For AdGRFCoulombElectrostatics the reaction field constant b1. Otherwise ignored.
+\param vdw_pot The lennard jones energy is added to the value pointed to by this variable.
+\param est_pot The electrostatic energy is added to the value pointed to by this variable.
+\return false if no vector kernel set is being used. In this case nothing is calculated.
+*/
+bool AdVectorCoulombAndLennardJonesPairList(AdPairList* list, 
+		double** coordinates, 
+		double** forces,
+		AdElectrostaticsType electrostatics,
+		char lennardJonesType,
+		double EPSILON_RP, 
+		double cutoff, 
+		double parameterOne, 
+		double parameterTwo,
+		double* vdw_pot, 
+		double* est_pot);
+
+/** \@}**/
+
+#endif
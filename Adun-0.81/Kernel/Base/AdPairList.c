@@ -0,0 +1,123 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#include <Base/AdPairList.h>
+
+AdPairList* AdAllocatePairList(int numberOfElements, int capacity)
+{
+	AdPairList* list;
+
+	if(capacity < 1)
+		capacity = 1;
+
+	list = malloc(sizeof(AdPairList));
+	list->numberOfElements = numberOfElements;
+	list->numberOfPairs = 0;
+	list->builtElements = 0;
+	list->capacity = capacity;
+	list->offsets = calloc(numberOfElements + 1, sizeof(int));
+	list->neighbours = malloc(capacity*sizeof(int));
+	list->paramOne = malloc(capacity*sizeof(double));
+	list->paramTwo = malloc(capacity*sizeof(double));
+	list->chargeProducts = malloc(capacity*sizeof(double));
+	list->periodicBox = NULL;
+
+	return list;
+}
+
+void AdFreePairList(AdPairList* list)
+{
+	if(list == NULL)
+		return;
+
+	free(list->offsets);
+	free(list->neighbours);
+	free(list->paramOne);
+	free(list->paramTwo);
+	free(list->chargeProducts);
+	free(list->periodicBox);
+	free(list);
+}
+
+void AdPairListReserve(AdPairList* list, int capacity)
+{
+	if(capacity <= list->capacity)
+		return;
+
+	list->neighbours = realloc(list->neighbours, capacity*sizeof(int));
+	list->paramOne = realloc(list->paramOne, capacity*sizeof(double));
+	list->paramTwo = realloc(list->paramTwo, capacity*sizeof(double));
+	list->chargeProducts = realloc(list->chargeProducts, capacity*sizeof(double));
+	list->capacity = capacity;
+}
+
+void AdPairListClear(AdPairList* list)
+{
+	list->numberOfPairs = 0;
+	list->builtElements = 0;
+	memset(list->offsets, 0, (list->numberOfElements + 1)*sizeof(int));
+}
+
+void AdPairListAppendElement(AdPairList* list, int element, int* partners, int count)
+{
+	int required;
+
+	//Elements skipped since the last append have no partners
+	while(list->builtElements <= element)
+	{
+		list->offsets[list->builtElements] = list->numberOfPairs;
+		list->builtElements++;
+	}
+
+	required = list->numberOfPairs + count;
+	if(required > list->capacity)
+		AdPairListReserve(list,
+			(required > 2*list->capacity) ? required : 2*list->capacity);
+
+	memcpy(list->neighbours + list->numberOfPairs, partners, count*sizeof(int));
+	list->numberOfPairs += count;
+	list->offsets[element + 1] = list->numberOfPairs;
+}
+
+void AdPairListFinalise(AdPairList* list)
+{
+	while(list->builtElements <= list->numberOfElements)
+	{
+		list->offsets[list->builtElements] = list->numberOfPairs;
+		list->builtElements++;
+	}
+}
+
+void AdPairListSetPeriodicBox(AdPairList* list, AdPeriodicBox* box)
+{
+	if(box == NULL)
+	{
+		free(list->periodicBox);
+		list->periodicBox = NULL;
+		return;
+	}
+
+	if(list->periodicBox == NULL)
+		list->periodicBox = malloc(sizeof(AdPeriodicBox));
+
+	*list->periodicBox = *box;
+}
@@ -0,0 +1,111 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#ifndef PAIR_LIST
+#define PAIR_LIST
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Base/AdPeriodicBox.h"
+
+//! \brief Contiguous (compressed sparse row) list of interacting pairs.
+/**
+AdPairList stores a nonbonded pair list as a set of flat arrays instead of
+a linked list of ::ListElement structures.
+The partners of element \e i are neighbours[offsets[i]] to neighbours[offsets[i+1] - 1].
+Only partners with a higher index than \e i are stored.
+
+The arrays paramOne, paramTwo and chargeProducts run parallel to neighbours and hold
+the precomputed lennard jones parameters and the product of the partial charges for each pair.
+For lennard jones type A paramOne and paramTwo are the products of the A and B parameters.
+For type B they are the combined well depth and equilibrium separation.
+
+Since the list is traversed linearly the kernels can keep the coordinates
+and accumulated force of element \e i in registers while looping over its partners.
+
+If periodicBox is not NULL the kernels apply the minimum image convention
+to the separation of each pair.
+\ingroup Types
+**/
+
+typedef struct
+{
+	int numberOfElements;	//!< The number of elements the list was created for.
+	int numberOfPairs;	//!< The number of pairs currently in the list.
+	int capacity;		//!< The number of pairs that can be stored without reallocating.
+	int builtElements;	//!< Used during construction. The number of elements whose offsets are set.
+	int* offsets;		//!< Array of numberOfElements + 1 offsets into the pair arrays.
+	int* neighbours;	//!< The second element of each pair.
+	double* paramOne;	//!< First lennard jones parameter of each pair.
+	double* paramTwo;	//!< Second lennard jones parameter of each pair.
+	double* chargeProducts;	//!< Product of the partial charges of each pair.
+	AdPeriodicBox* periodicBox;	//!< The periodic box of the system or NULL if it is not periodic.
+}
+AdPairList;
+
+/**
+\defgroup pairList Pair List
+\ingroup Functions
+@{
+**/
+
+/**
+Allocates a new empty pair list for \e numberOfElements elements with space
+for \e capacity pairs. Free using AdFreePairList().
+*/
+AdPairList* AdAllocatePairList(int numberOfElements, int capacity);
+/**
+Frees a list created using AdAllocatePairList().
+*/
+void AdFreePairList(AdPairList* list);
+/**
+Ensures \e list can hold at least \e capacity pairs.
+The current contents are preserved.
+*/
+void AdPairListReserve(AdPairList* list, int capacity);
+/**
+Removes all pairs from \e list. The allocated memory is retained so
+the list can be refilled without reallocating.
+*/
+void AdPairListClear(AdPairList* list);
+/**
+Appends the pairs (\e element, \e partners[i]) to \e list.
+Elements must be appended in increasing order and each element at most once.
+Elements that are skipped have no partners.
+Call AdPairListFinalise() once all elements have been added.
+*/
+void AdPairListAppendElement(AdPairList* list, int element, int* partners, int count);
+/**
+Completes the construction of \e list by setting the offsets of
+all elements that were not appended.
+*/
+void AdPairListFinalise(AdPairList* list);
+/**
+Sets the periodic box used when computing the separation of the pairs in \e list.
+\e box is copied. Pass NULL to remove periodic boundaries.
+*/
+void AdPairListSetPeriodicBox(AdPairList* list, AdPeriodicBox* box);
+
+/** \@}**/
+
+#endif
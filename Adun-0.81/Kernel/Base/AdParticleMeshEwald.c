@@ -0,0 +1,482 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#include "Base/AdParticleMeshEwald.h"
+
+/*
+ * Fills array with the cardinal B-spline of order \e order evaluated at 
+ * w + order - 1 - i (i = 0 ... order - 1) where w is the fractional part of a 
+ * scaled coordinate. If darray is not NULL it is filled with the derivatives.
+ * The recursion follows Essmann et al.
+ */
+static void AdFillBSplines(double w, int order, double* array, double* darray)
+{
+	int j, k;
+	double div;
+
+	array[order-1] = 0;
+	array[1] = w;
+	array[0] = 1 - w;
+	for(k=3; k<order; k++)
+	{
+		div = 1.0/(k - 1);
+		array[k-1] = div*w*array[k-2];
+		for(j=1; j<=k-2; j++)
+			array[k-j-1] = div*((w + j)*array[k-j-2] + (k - j - w)*array[k-j-1]);
+		
+		array[0] = div*(1 - w)*array[0];
+	}
+
+	//The derivatives are differences of the order - 1 splines
+	if(darray != NULL)
+	{
+		darray[0] = -array[0];
+		for(j=1; j<order; j++)
+			darray[j] = array[j-1] - array[j];
+	}
+
+	div = 1.0/(order - 1);
+	array[order-1] = div*w*array[order-2];
+	for(j=1; j<=order-2; j++)
+		array[order-j-1] = div*((w + j)*array[order-j-2] + (order - j - w)*array[order-j-1]);
+	
+	array[0] = div*(1 - w)*array[0];
+}
+
+/*
+ * Calculates the squared modulus of the discrete fourier transform
+ * of the B-spline values at the integers i.e. 1/|b(m)|^2
+ */
+static void AdBSplineModuli(double* moduli, int gridSize, int order)
+{
+	int i, j;
+	double arg, sumReal, sumImaginary;
+	double* array;
+
+	array = malloc(order*sizeof(double));
+	AdFillBSplines(0, order, array, NULL);
+	for(i=0; i<gridSize; i++)
+	{
+		sumReal = sumImaginary = 0;
+		for(j=0; j<order; j++)
+		{
+			arg = 2*M_PI*i*j/gridSize;
+			sumReal += array[j]*cos(arg);
+			sumImaginary += array[j]*sin(arg);
+		}
+
+		moduli[i] = sumReal*sumReal + sumImaginary*sumImaginary;
+	}
+
+	//For odd orders the modulus at the nyquist frequency is zero.
+	//Replace it by the average of its neighbours.
+	for(i=0; i<gridSize; i++)
+		if(moduli[i] < 1E-7)
+			moduli[i] = 0.5*(moduli[(i - 1 + gridSize) % gridSize] + moduli[(i + 1) % gridSize]);
+
+	free(array);
+}
+
+/*
+ * Precomputes exp(-pi^2 m^2/beta^2)/(pi V m^2) B(m) for each point of the reciprocal grid.
+ */
+static void AdPMEInfluenceFunction(AdPMEGrid* pme)
+{
+	int i, j, k, index, axis;
+	double mx, my, mz, mSquared, volume, factor;
+	double* moduli[3];
+
+	for(axis=0; axis<3; axis++)
+	{
+		moduli[axis] = malloc(pme->gridSize[axis]*sizeof(double));
+		AdBSplineModuli(moduli[axis], pme->gridSize[axis], pme->splineOrder);
+	}
+
+	volume = pme->box.lengths[0]*pme->box.lengths[1]*pme->box.lengths[2];
+	factor = M_PI*M_PI/(pme->ewaldCoefficient*pme->ewaldCoefficient);
+	for(index=0, i=0; i<pme->gridSize[0]; i++)
+	{
+		mx = (i <= pme->gridSize[0]/2) ? i : i - pme->gridSize[0];
+		mx *= pme->box.reciprocalLengths[0];
+		for(j=0; j<pme->gridSize[1]; j++)
+		{
+			my = (j <= pme->gridSize[1]/2) ? j : j - pme->gridSize[1];
+			my *= pme->box.reciprocalLengths[1];
+			for(k=0; k<pme->gridSize[2]; k++, index++)
+			{
+				mz = (k <= pme->gridSize[2]/2) ? k : k - pme->gridSize[2];
+				mz *= pme->box.reciprocalLengths[2];
+				mSquared = mx*mx + my*my + mz*mz;
+				if(index == 0)
+				{
+					pme->influence[index] = 0;
+					continue;
+				}
+
+				pme->influence[index] = exp(-factor*mSquared)/(M_PI*volume*mSquared);
+				pme->influence[index] /= moduli[0][i]*moduli[1][j]*moduli[2][k];
+			}
+		}
+	}
+
+	for(axis=0; axis<3; axis++)
+		free(moduli[axis]);
+}
+
+/*
+ * Three dimensional transform of the grid built from one dimensional
+ * transforms along each axis.
+ */
+static void AdPMETransform(AdPMEGrid* pme, gsl_fft_direction sign)
+{
+	int i, j;
+	int nx, ny, nz;
+
+	nx = pme->gridSize[0];
+	ny = pme->gridSize[1];
+	nz = pme->gridSize[2];
+
+	for(i=0; i<nx; i++)
+		for(j=0; j<ny; j++)
+			gsl_fft_complex_transform(pme->grid + 2*(i*ny + j)*nz, 1, nz, 
+				pme->wavetables[2], pme->workspaces[2], sign);
+
+	for(i=0; i<nx; i++)
+		for(j=0; j<nz; j++)
+			gsl_fft_complex_transform(pme->grid + 2*(i*ny*nz + j), nz, ny, 
+				pme->wavetables[1], pme->workspaces[1], sign);
+
+	for(i=0; i<ny; i++)
+		for(j=0; j<nz; j++)
+			gsl_fft_complex_transform(pme->grid + 2*(i*nz + j), ny*nz, nx, 
+				pme->wavetables[0], pme->workspaces[0], sign);
+}
+
+double AdEwaldCoefficient(double cutoff, double tolerance)
+{
+	int i;
+	double low, high, middle;
+
+	low = 0;
+	high = 1;
+	while(erfc(high*cutoff) > tolerance)
+		high *= 2;
+
+	for(i=0; i<100; i++)
+	{
+		middle = 0.5*(low + high);
+		if(erfc(middle*cutoff) > tolerance)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	return 0.5*(low + high);
+}
+
+int AdPMEGridSize(int minimum)
+{
+	int size, remainder;
+
+	for(size = (minimum < 1) ? 1 : minimum; ; size++)
+	{
+		remainder = size;
+		while(remainder % 2 == 0)
+			remainder /= 2;
+		while(remainder % 3 == 0)
+			remainder /= 3;
+		while(remainder % 5 == 0)
+			remainder /= 5;
+
+		if(remainder == 1)
+			return size;
+	}
+}
+
+AdPMEGrid* AdAllocatePMEGrid(int numberOfElements, 
+		AdPeriodicBox* box, 
+		int* gridSize, 
+		int splineOrder, 
+		double ewaldCoefficient)
+{
+	int i;
+	AdPMEGrid* pme;
+
+	pme = malloc(sizeof(AdPMEGrid));
+	pme->numberOfElements = numberOfElements;
+	pme->splineOrder = splineOrder;
+	pme->ewaldCoefficient = ewaldCoefficient;
+	pme->box = *box;
+	pme->numberOfPoints = 1;
+	for(i=0; i<3; i++)
+	{
+		pme->gridSize[i] = gridSize[i];
+		pme->numberOfPoints *= gridSize[i];
+		pme->splines[i] = malloc(numberOfElements*splineOrder*sizeof(double));
+		pme->splineDerivatives[i] = malloc(numberOfElements*splineOrder*sizeof(double));
+		pme->gridIndexes[i] = malloc(numberOfElements*sizeof(int));
+		pme->wavetables[i] = gsl_fft_complex_wavetable_alloc(gridSize[i]);
+		pme->workspaces[i] = gsl_fft_complex_workspace_alloc(gridSize[i]);
+	}
+
+	pme->grid = malloc(2*pme->numberOfPoints*sizeof(double));
+	pme->influence = malloc(pme->numberOfPoints*sizeof(double));
+	AdPMEInfluenceFunction(pme);
+
+	return pme;
+}
+
+void AdFreePMEGrid(AdPMEGrid* pme)
+{
+	int i;
+
+	if(pme == NULL)
+		return;
+
+	for(i=0; i<3; i++)
+	{
+		free(pme->splines[i]);
+		free(pme->splineDerivatives[i]);
+		free(pme->gridIndexes[i]);
+		gsl_fft_complex_wavetable_free(pme->wavetables[i]);
+		gsl_fft_complex_workspace_free(pme->workspaces[i]);
+	}
+
+	free(pme->grid);
+	free(pme->influence);
+	free(pme);
+}
+
+double AdPMEReciprocalSpace(AdPMEGrid* pme, 
+		double** coordinates, 
+		double* charges, 
+		double** forces, 
+		double EPSILON_RP)
+{
+	int i, j, k, l, axis, order, start;
+	int x, y, z, nx, ny, nz, index;
+	double scaled, charge, energy, holder;
+	double fx, fy, fz, potential;
+	double *thetaX, *thetaY, *thetaZ;
+	double *dthetaX, *dthetaY, *dthetaZ;
+	double* grid;
+
+	order = pme->splineOrder;
+	nx = pme->gridSize[0];
+	ny = pme->gridSize[1];
+	nz = pme->gridSize[2];
+	grid = pme->grid;
+	memset(grid, 0, 2*pme->numberOfPoints*sizeof(double));
+
+	/*
+	 * Calculate the spline coefficients of each element and
+	 * spread its charge onto the order^3 surrounding grid points.
+	 */
+	for(i=0; i<pme->numberOfElements; i++)
+	{
+		for(axis=0; axis<3; axis++)
+		{
+			//Scaled fractional coordinate in [0, gridSize)
+			scaled = (coordinates[i][axis] - pme->box.origin[axis])*pme->box.reciprocalLengths[axis];
+			scaled = (scaled - floor(scaled))*pme->gridSize[axis];
+			start = (int)scaled;
+			if(start >= pme->gridSize[axis])
+				start -= pme->gridSize[axis];
+
+			AdFillBSplines(scaled - floor(scaled), order, 
+				pme->splines[axis] + i*order, 
+				pme->splineDerivatives[axis] + i*order);
+			pme->gridIndexes[axis][i] = start - order + 1;
+		}
+
+		charge = charges[i];
+		if(charge == 0)
+			continue;
+
+		thetaX = pme->splines[0] + i*order;
+		thetaY = pme->splines[1] + i*order;
+		thetaZ = pme->splines[2] + i*order;
+		for(j=0; j<order; j++)
+		{
+			x = pme->gridIndexes[0][i] + j;
+			if(x < 0)
+				x += nx;
+
+			for(k=0; k<order; k++)
+			{
+				y = pme->gridIndexes[1][i] + k;
+				if(y < 0)
+					y += ny;
+
+				holder = charge*thetaX[j]*thetaY[k];
+				for(l=0; l<order; l++)
+				{
+					z = pme->gridIndexes[2][i] + l;
+					if(z < 0)
+						z += nz;
+
+					grid[2*((x*ny + y)*nz + z)] += holder*thetaZ[l];
+				}
+			}
+		}
+	}
+
+	/*
+	 * Transform, calculate the energy and convolute with the influence function.
+	 */
+	AdPMETransform(pme, gsl_fft_forward);
+	energy = 0;
+	for(index=0; index<pme->numberOfPoints; index++)
+	{
+		holder = pme->influence[index];
+		energy += holder*(grid[2*index]*grid[2*index] + grid[2*index+1]*grid[2*index+1]);
+		grid[2*index] *= holder;
+		grid[2*index+1] *= holder;
+	}
+	energy *= 0.5*EPSILON_RP;
+
+	if(forces == NULL)
+		return energy;
+
+	/*
+	 * The back transform gives the potential at each grid point.
+	 * The force on each element is minus its charge times the gradient of the
+	 * interpolated potential.
+	 */
+	AdPMETransform(pme, gsl_fft_backward);
+	for(i=0; i<pme->numberOfElements; i++)
+	{
+		charge = charges[i];
+		if(charge == 0)
+			continue;
+
+		thetaX = pme->splines[0] + i*order;
+		thetaY = pme->splines[1] + i*order;
+		thetaZ = pme->splines[2] + i*order;
+		dthetaX = pme->splineDerivatives[0] + i*order;
+		dthetaY = pme->splineDerivatives[1] + i*order;
+		dthetaZ = pme->splineDerivatives[2] + i*order;
+		fx = fy = fz = 0;
+		for(j=0; j<order; j++)
+		{
+			x = pme->gridIndexes[0][i] + j;
+			if(x < 0)
+				x += nx;
+
+			for(k=0; k<order; k++)
+			{
+				y = pme->gridIndexes[1][i] + k;
+				if(y < 0)
+					y += ny;
+
+				for(l=0; l<order; l++)
+				{
+					z = pme->gridIndexes[2][i] + l;
+					if(z < 0)
+						z += nz;
+
+					potential = grid[2*((x*ny + y)*nz + z)];
+					fx += dthetaX[j]*thetaY[k]*thetaZ[l]*potential;
+					fy += thetaX[j]*dthetaY[k]*thetaZ[l]*potential;
+					fz += thetaX[j]*thetaY[k]*dthetaZ[l]*potential;
+				}
+			}
+		}
+
+		holder = EPSILON_RP*charge;
+		forces[i][0] -= holder*fx*nx*pme->box.reciprocalLengths[0];
+		forces[i][1] -= holder*fy*ny*pme->box.reciprocalLengths[1];
+		forces[i][2] -= holder*fz*nz*pme->box.reciprocalLengths[2];
+	}
+
+	return energy;
+}
+
+double AdEwaldSelfEnergy(double* charges, 
+		int numberOfElements,
+		AdPeriodicBox* box,
+		double ewaldCoefficient, 
+		double EPSILON_RP)
+{
+	int i;
+	double squaredSum, sum, volume, energy;
+
+	squaredSum = sum = 0;
+	for(i=0; i<numberOfElements; i++)
+	{
+		sum += charges[i];
+		squaredSum += charges[i]*charges[i];
+	}
+
+	energy = -EPSILON_RP*ewaldCoefficient*squaredSum/sqrt(M_PI);
+
+	//Interaction of a net charge with the neutralising background
+	volume = box->lengths[0]*box->lengths[1]*box->lengths[2];
+	energy -= EPSILON_RP*M_PI*sum*sum/(2*volume*ewaldCoefficient*ewaldCoefficient);
+
+	return energy;
+}
+
+double AdEwaldExclusionCorrection(AdPairList* exclusions, 
+		double** coordinates, 
+		double** forces, 
+		double ewaldCoefficient, 
+		double EPSILON_RP)
+{
+	int i, j, k, atomTwo;
+	double length, length_sq, erf_hold, est_hold, force_mag, energy;
+	Vector3D seperation_s;
+
+	energy = 0;
+	for(i=0; i<exclusions->numberOfElements; i++)
+		for(j=exclusions->offsets[i]; j<exclusions->offsets[i+1]; j++)
+		{
+			atomTwo = exclusions->neighbours[j];
+			for(k=0; k<3; k++)
+				*(seperation_s.vector + k) = coordinates[i][k] - coordinates[atomTwo][k];
+			
+			if(exclusions->periodicBox != NULL)
+				AdMinimumImage(seperation_s.vector, exclusions->periodicBox);
+
+			length_sq = *(seperation_s.vector + 0) * *(seperation_s.vector + 0)
+				+ *(seperation_s.vector + 1) * *(seperation_s.vector + 1)
+				+ *(seperation_s.vector + 2) * *(seperation_s.vector + 2);
+			length = sqrt(length_sq);
+
+			erf_hold = erf(ewaldCoefficient*length);
+			est_hold = EPSILON_RP*exclusions->chargeProducts[j]/length;
+			energy -= est_hold*erf_hold;
+
+			if(forces == NULL)
+				continue;
+
+			force_mag = est_hold*(M_2_SQRTPI*ewaldCoefficient*length*exp(-ewaldCoefficient*ewaldCoefficient*length_sq) 
+					- erf_hold)/length_sq;
+			for(k=0; k<3; k++)
+			{
+				forces[i][k] += force_mag* *(seperation_s.vector + k);
+				forces[atomTwo][k] -= force_mag* *(seperation_s.vector + k);
+			}
+		}
+
+	return energy;
+}
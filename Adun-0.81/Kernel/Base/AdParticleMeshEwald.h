@@ -0,0 +1,141 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#ifndef PARTICLE_MESH_EWALD
+#define PARTICLE_MESH_EWALD
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <gsl/gsl_fft_complex.h>
+#include "Base/AdVector.h"
+#include "Base/AdMatrix.h"
+#include "Base/AdPairList.h"
+#include "Base/AdPeriodicBox.h"
+
+//! \brief Workspace for the reciprocal part of a smooth particle mesh Ewald calculation.
+/**
+Holds the charge grid, the precomputed influence function and the B-spline
+coefficients of each element. The grid is stored as an array of complex numbers
+(real and imaginary parts interleaved) with the z index varying fastest.
+The three dimensional transform is performed as a series of one dimensional GSL transforms
+along each axis.
+
+Create with AdAllocatePMEGrid() and free with AdFreePMEGrid().
+\ingroup Types
+**/
+
+typedef struct
+{
+	int numberOfElements;	//!< The number of elements the grid was created for
+	int splineOrder;	//!< The order of the B-splines used to spread the charges
+	int gridSize[3];	//!< The number of grid points along each axis
+	int numberOfPoints;	//!< The total number of grid points
+	double ewaldCoefficient;	//!< The Ewald splitting coefficient
+	AdPeriodicBox box;	//!< The periodic box the grid covers
+	double* grid;		//!< The complex charge grid 
+	double* influence;	//!< The influence function multiplied by the B-spline moduli at each grid point
+	double* splines[3];	//!< The spline coefficients of each element along each axis (numberOfElements*splineOrder)
+	double* splineDerivatives[3];	//!< The derivatives of the spline coefficients
+	int* gridIndexes[3];	//!< The first grid point each element is spread onto along each axis
+	gsl_fft_complex_wavetable* wavetables[3];
+	gsl_fft_complex_workspace* workspaces[3];
+}
+AdPMEGrid;
+
+/**
+\defgroup pme Particle Mesh Ewald
+\ingroup Functions
+Functions for calculating the electrostatic energy and forces of a periodic system using the smooth 
+particle mesh Ewald method (Essmann et al. J. Chem. Phys. 103, 8577 (1995)).
+The real space part is calculated by the Ewald pair list functions in AdForceFieldFunctions.h.
+@{
+**/
+
+/**
+Returns the Ewald coefficient for which the screening function erfc at \e cutoff
+is equal to \e tolerance.
+*/
+double AdEwaldCoefficient(double cutoff, double tolerance);
+/**
+Returns the smallest number of grid points greater than or equal to \e minimum
+whose only prime factors are 2, 3 and 5. 
+*/
+int AdPMEGridSize(int minimum);
+/**
+Allocates the workspace for a PME calculation on \e numberOfElements elements
+in \e box.
+\param gridSize Array of three ints giving the number of grid points along each axis. 
+Each must be at least \e splineOrder.
+\param splineOrder The order of the B-splines used for charge spreading. Must be at least 3.
+\param ewaldCoefficient The Ewald splitting coefficient.
+*/
+AdPMEGrid* AdAllocatePMEGrid(int numberOfElements, 
+		AdPeriodicBox* box, 
+		int* gridSize, 
+		int splineOrder, 
+		double ewaldCoefficient);
+/**
+Frees a grid allocated with AdAllocatePMEGrid().
+*/
+void AdFreePMEGrid(AdPMEGrid* pme);
+/**
+Calculates the reciprocal space part of the Ewald sum.
+\param pme The grid workspace.
+\param coordinates The element coordinates.
+\param charges The partial charge of each element.
+\param forces If not NULL the reciprocal space forces are added to this matrix.
+\param EPSILON_RP The electrostatic constant divided by the relative permittivity.
+\return The reciprocal space energy.
+*/
+double AdPMEReciprocalSpace(AdPMEGrid* pme, 
+		double** coordinates, 
+		double* charges, 
+		double** forces, 
+		double EPSILON_RP);
+/**
+Returns the self energy and the net charge correction of the Ewald sum.
+Both are independent of the coordinates so contribute no force.
+*/
+double AdEwaldSelfEnergy(double* charges, 
+		int numberOfElements,
+		AdPeriodicBox* box,
+		double ewaldCoefficient, 
+		double EPSILON_RP);
+/**
+Removes the reciprocal space interaction of the pairs in \e exclusions
+(pairs that are not part of the nonbonded interaction e.g. bonded pairs).
+The interaction of each pair is \f$ erf(\beta r)/r \f$.
+The charge products are read from the chargeProducts array of \e exclusions.
+\param forces If not NULL the correction to the forces are added to this matrix.
+\return The energy correction.
+*/
+double AdEwaldExclusionCorrection(AdPairList* exclusions, 
+		double** coordinates, 
+		double** forces, 
+		double ewaldCoefficient, 
+		double EPSILON_RP);
+
+/** \@}**/
+
+#endif
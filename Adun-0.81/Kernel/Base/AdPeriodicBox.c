@@ -0,0 +1,67 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#include "Base/AdPeriodicBox.h"
+
+void AdInitialisePeriodicBox(AdPeriodicBox* box, double* centre, double* lengths)
+{
+	int i;
+
+	for(i=0; i<3; i++)
+	{
+		box->lengths[i] = lengths[i];
+		box->reciprocalLengths[i] = 1/lengths[i];
+		box->origin[i] = centre[i] - lengths[i]/2;
+	}
+}
+
+void AdMinimumImage(double* separation, AdPeriodicBox* box)
+{
+	separation[0] -= box->lengths[0]*floor(separation[0]*box->reciprocalLengths[0] + 0.5);
+	separation[1] -= box->lengths[1]*floor(separation[1]*box->reciprocalLengths[1] + 0.5);
+	separation[2] -= box->lengths[2]*floor(separation[2]*box->reciprocalLengths[2] + 0.5);
+}
+
+void AdWrapCoordinates(AdMatrix* coordinates, int groupSize, AdPeriodicBox* box)
+{
+	int i, j, k, end;
+	double shift[3];
+	double** matrix;
+
+	if(groupSize < 1)
+		groupSize = 1;
+
+	matrix = coordinates->matrix;
+	for(i=0; i<coordinates->no_rows; i += groupSize)
+	{
+		for(j=0; j<3; j++)
+			shift[j] = -box->lengths[j]*floor((matrix[i][j] - box->origin[j])*box->reciprocalLengths[j]);
+
+		if(shift[0] == 0 && shift[1] == 0 && shift[2] == 0)
+			continue;
+
+		end = (i + groupSize < coordinates->no_rows) ? i + groupSize : coordinates->no_rows;
+		for(k=i; k<end; k++)
+			for(j=0; j<3; j++)
+				matrix[k][j] += shift[j];
+	}
+}
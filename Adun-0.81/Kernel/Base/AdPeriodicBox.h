@@ -0,0 +1,87 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#ifndef PERIODIC_BOX
+#define PERIODIC_BOX
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Base/AdMatrix.h"
+
+//! \brief Describes a periodic rectangular box.
+/**
+The box extends from \e origin to \e origin + \e lengths along each axis.
+Used to apply the minimum image convention to separation vectors
+and to wrap coordinates back into the box.
+\ingroup Types
+**/
+
+typedef struct
+{
+	double origin[3];		//!< The (-,-,-) corner of the box.
+	double lengths[3];		//!< The length of the box along each axis.
+	double reciprocalLengths[3];	//!< The reciprocal of each length.
+}
+AdPeriodicBox;
+
+/**
+\defgroup periodicBox Periodic Boundaries
+\ingroup Functions
+@{
+**/
+
+/**
+Initialises \e box so it has dimensions \e lengths and is centered on \e centre.
+*/
+void AdInitialisePeriodicBox(AdPeriodicBox* box, double* centre, double* lengths);
+
+/**
+Translates the coordinates of groups of \e groupSize consecutive rows of \e coordinates
+so the first row of each group lies in \e box. Groups are kept whole so
+molecules are not split across the boundaries. If \e groupSize is less than 1 each row is wrapped
+individually.
+*/
+void AdWrapCoordinates(AdMatrix* coordinates, int groupSize, AdPeriodicBox* box);
+
+#ifdef __GNUC__
+
+/**
+Replaces \e separation, the separation vector between two points, 
+with the separation to the nearest periodic image.
+*/
+extern inline void AdMinimumImage(double* separation, AdPeriodicBox* box)
+{
+	separation[0] -= box->lengths[0]*floor(separation[0]*box->reciprocalLengths[0] + 0.5);
+	separation[1] -= box->lengths[1]*floor(separation[1]*box->reciprocalLengths[1] + 0.5);
+	separation[2] -= box->lengths[2]*floor(separation[2]*box->reciprocalLengths[2] + 0.5);
+}
+
+#else
+
+void AdMinimumImage(double* separation, AdPeriodicBox* box);
+
+#endif
+
+/** \@}**/
+
+#endif
@@ -12,6 +12,7 @@
 #include <gsl/gsl_sf_legendre.h>
 #include <gsl/gsl_sort.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
 Function for generating 14 point Lebedev grid
@@ -423,3 +424,197 @@ int AdGenerateTypeFiveOctehedralPoints(double a, double v, AdMatrix* buffer, int
 	return 24;
 }
 
+
+/*
+ * Quadrature grids
+ */
+
+//Identifies a grid file. The version must be changed if the layout changes.
+static const char quadratureGridTag[8] = {'A', 'D', 'Q', 'U', 'A', 'D', '0', '1'};
+
+AdQuadratureGrid* AdAllocateQuadratureGrid(int numberRadialPoints, int numberAngularPoints)
+{
+	int numberPoints;
+	AdQuadratureGrid* grid;
+
+	grid = malloc(sizeof(AdQuadratureGrid));
+	grid->numberRadialPoints = numberRadialPoints;
+	grid->numberAngularPoints = numberAngularPoints;
+	
+	//All arrays are placed in one block so the grid is contiguous in memory.
+	numberPoints = numberRadialPoints*numberAngularPoints;
+	grid->storage = malloc((2*numberRadialPoints + 4*numberAngularPoints + 3*numberPoints)*sizeof(double));
+	grid->radialDistances = grid->storage;
+	grid->radialWeights = grid->radialDistances + numberRadialPoints;
+	grid->angularX = grid->radialWeights + numberRadialPoints;
+	grid->angularY = grid->angularX + numberAngularPoints;
+	grid->angularZ = grid->angularY + numberAngularPoints;
+	grid->angularWeights = grid->angularZ + numberAngularPoints;
+	grid->pointsX = grid->angularWeights + numberAngularPoints;
+	grid->pointsY = grid->pointsX + numberPoints;
+	grid->pointsZ = grid->pointsY + numberPoints;
+
+	return grid;
+}
+
+void AdFreeQuadratureGrid(AdQuadratureGrid* grid)
+{
+	if(grid == NULL)
+		return;
+
+	free(grid->storage);
+	free(grid);
+}
+
+int AdGenerateLebedevQuadratureGrid(AdQuadratureGrid* grid)
+{
+	int i;
+	AdMatrix* buffer;
+
+	buffer = AdAllocateDoubleMatrix(grid->numberAngularPoints, 4);
+	if(AdGenerateLebedevGrid(buffer) != 0)
+	{
+		AdFreeDoubleMatrix(buffer);
+		return 1;
+	}
+
+	for(i=0; i<grid->numberAngularPoints; i++)
+	{
+		grid->angularX[i] = buffer->matrix[i][0];
+		grid->angularY[i] = buffer->matrix[i][1];
+		grid->angularZ[i] = buffer->matrix[i][2];
+		grid->angularWeights[i] = buffer->matrix[i][3];
+	}
+
+	AdFreeDoubleMatrix(buffer);
+
+	return 0;
+}
+
+void AdSetQuadratureGridPoints(AdQuadratureGrid* grid)
+{
+	int i, j, index;
+	double radialDistance;
+
+	for(index=0, i=0; i<grid->numberRadialPoints; i++)
+	{
+		radialDistance = grid->radialDistances[i];
+		for(j=0; j<grid->numberAngularPoints; j++, index++)
+		{
+			grid->pointsX[index] = radialDistance*grid->angularX[j];
+			grid->pointsY[index] = radialDistance*grid->angularY[j];
+			grid->pointsZ[index] = radialDistance*grid->angularZ[j];
+		}
+	}
+}
+
+AdQuadratureGrid* AdCreateSmoothedGBQuadratureGrid(int numberRadialPoints, int numberAngularPoints, double startPoint)
+{
+	int i;
+	AdQuadratureGrid* grid;
+
+	if(numberRadialPoints <= 5)
+		return NULL;
+
+	grid = AdAllocateQuadratureGrid(numberRadialPoints, numberAngularPoints);
+	if(AdGenerateLebedevQuadratureGrid(grid) != 0)
+	{
+		AdFreeQuadratureGrid(grid);
+		return NULL;
+	}
+
+	//Scale the weights so they add up to 4PI.
+	//This is the integral over the sphere of sin(theta)dtheta dphi which is the 
+	//angular part of the CFA integral. FIXME: Check validity of this
+	for(i=0; i < numberAngularPoints; i++)
+		grid->angularWeights[i] *= 4*M_PI;
+
+	//5 points up to 1 angstrom
+	AdGenerateGaussLegendrePoints(startPoint, 1, 5, 
+		grid->radialDistances, grid->radialWeights);
+
+	//The rest to 20 angstroms
+	AdGenerateGaussLegendrePoints(1, 20, numberRadialPoints - 5, 
+		grid->radialDistances + 5, grid->radialWeights + 5);
+
+	AdSetQuadratureGridPoints(grid);
+
+	return grid;
+}
+
+double AdQuadratureGridDifference(AdQuadratureGrid* grid, AdQuadratureGrid* otherGrid)
+{
+	int i, numberValues;
+	double difference = 0;
+
+	if(grid->numberRadialPoints != otherGrid->numberRadialPoints 
+		|| grid->numberAngularPoints != otherGrid->numberAngularPoints)
+		return HUGE_VAL;
+
+	//The radial and angular arrays are at the start of storage in both grids
+	numberValues = 2*grid->numberRadialPoints + 4*grid->numberAngularPoints;
+	for(i=0; i<numberValues; i++)
+		difference = fmax(difference, fabs(grid->storage[i] - otherGrid->storage[i]));
+
+	return difference;
+}
+
+/*
+ * The file contains the tag, the number of radial and angular points as ints, 
+ * the value 1.0 which is used to check the byte order, and then the radial and angular arrays.
+ * The integration points are not stored since they are quickly recalculated.
+ */
+int AdWriteQuadratureGrid(AdQuadratureGrid* grid, FILE* file)
+{
+	int size[2];
+	double check = 1.0;
+	size_t numberValues;
+
+	size[0] = grid->numberRadialPoints;
+	size[1] = grid->numberAngularPoints;
+	numberValues = 2*size[0] + 4*size[1];
+
+	if(fwrite(quadratureGridTag, sizeof(char), 8, file) != 8)
+		return 1;
+
+	if(fwrite(size, sizeof(int), 2, file) != 2)
+		return 1;
+
+	if(fwrite(&check, sizeof(double), 1, file) != 1)
+		return 1;
+
+	if(fwrite(grid->storage, sizeof(double), numberValues, file) != numberValues)
+		return 1;
+
+	return 0;
+}
+
+AdQuadratureGrid* AdReadQuadratureGrid(FILE* file)
+{
+	int size[2];
+	char tag[8];
+	double check;
+	size_t numberValues;
+	AdQuadratureGrid* grid;
+
+	if(fread(tag, sizeof(char), 8, file) != 8 || memcmp(tag, quadratureGridTag, 8) != 0)
+		return NULL;
+
+	if(fread(size, sizeof(int), 2, file) != 2 || size[0] <= 0 || size[1] <= 0)
+		return NULL;
+
+	if(fread(&check, sizeof(double), 1, file) != 1 || check != 1.0)
+		return NULL;
+
+	grid = AdAllocateQuadratureGrid(size[0], size[1]);
+	numberValues = 2*size[0] + 4*size[1];
+	if(fread(grid->storage, sizeof(double), numberValues, file) != numberValues)
+	{
+		AdFreeQuadratureGrid(grid);
+		return NULL;
+	}
+
+	AdSetQuadratureGridPoints(grid);
+
+	return grid;
+}
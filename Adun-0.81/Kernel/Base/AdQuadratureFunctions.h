@@ -71,6 +71,82 @@ Otherwise return 0.
 */
 int AdGenerateLebedevGrid(AdMatrix* buffer);
 
+/**
+A spherical quadrature grid stored as contiguous arrays.
+The angular points are unit vectors and each radial shell contains every angular point scaled
+by the shells radial distance. The coordinates of the points of shell \e i start at index
+i*numberAngularPoints of pointsX, pointsY and pointsZ.
+Create using AdAllocateQuadratureGrid() or AdReadQuadratureGrid().
+*/
+typedef struct
+{
+	int numberRadialPoints;
+	int numberAngularPoints;
+	double* radialDistances;	//!< The distance of each radial shell from the centre
+	double* radialWeights;		//!< The weight of each radial shell
+	double* angularX;		//!< The x component of each angular point
+	double* angularY;		//!< The y component of each angular point
+	double* angularZ;		//!< The z component of each angular point
+	double* angularWeights;		//!< The weight of each angular point
+	double* pointsX;		//!< The x component of each integration point
+	double* pointsY;		//!< The y component of each integration point
+	double* pointsZ;		//!< The z component of each integration point
+	double* storage;		//!< The block of memory holding all the above arrays
+}
+AdQuadratureGrid;
+
+/**
+Creates a grid with \e numberRadialPoints shells of \e numberAngularPoints points.
+The values of the arrays are undefined. Free using AdFreeQuadratureGrid().
+*/
+AdQuadratureGrid* AdAllocateQuadratureGrid(int numberRadialPoints, int numberAngularPoints);
+
+/**
+Frees a grid created by AdAllocateQuadratureGrid() or AdReadQuadratureGrid().
+*/
+void AdFreeQuadratureGrid(AdQuadratureGrid* grid);
+
+/**
+Places the points and weights of the lebedev grid with \e grid->numberAngularPoints points
+in the angular arrays of \e grid. The weights sum to 1.
+Returns 1 if the grid size is not supported (see AdGenerateLebedevGrid()), 0 otherwise.
+*/
+int AdGenerateLebedevQuadratureGrid(AdQuadratureGrid* grid);
+
+/**
+Calculates the integration points of \e grid from its radial distances and angular points.
+*/
+void AdSetQuadratureGridPoints(AdQuadratureGrid* grid);
+
+/**
+Creates the grid used by AdSmoothedGBTerm. 
+The angular points are the lebedev grid with \e numberAngularPoints points with weights summing to 4PI.
+The first five radial shells are gauss-legendre points between \e startPoint and 1 and 
+the remaining shells are gauss-legendre points between 1 and 20.
+Returns NULL if \e numberAngularPoints is not supported or \e numberRadialPoints is less than 6.
+*/
+AdQuadratureGrid* AdCreateSmoothedGBQuadratureGrid(int numberRadialPoints, int numberAngularPoints, double startPoint);
+
+/**
+Returns the largest absolute difference between the radial and angular values of 
+\e grid and \e otherGrid, or HUGE_VAL if they have different numbers of points.
+*/
+double AdQuadratureGridDifference(AdQuadratureGrid* grid, AdQuadratureGrid* otherGrid);
+
+/**
+Writes \e grid to \e file in a compact binary format which can be read by AdReadQuadratureGrid().
+The values are written in the byte order of the machine.
+Returns 0 on success and 1 if the grid could not be written.
+*/
+int AdWriteQuadratureGrid(AdQuadratureGrid* grid, FILE* file);
+
+/**
+Reads a grid written by AdWriteQuadratureGrid() from \e file.
+Returns NULL if the file does not contain a grid or if it was written on a machine 
+with a different byte order.
+*/
+AdQuadratureGrid* AdReadQuadratureGrid(FILE* file);
+
 /** \@}**/
 
 #endif
@@ -0,0 +1,223 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#include <unistd.h>
+#include "Base/AdThreadTeam.h"
+
+struct AdThreadTeamWorker
+{
+	int index;				//The part of each task performed by the worker
+	unsigned int generation;		//The generation of the last task seen
+	pthread_t thread;
+	AdThreadTeam* team;
+};
+
+static int defaultNumberOfThreads = 0;
+static AdThreadTeam* sharedTeam = NULL;
+static pthread_once_t sharedTeamOnce = PTHREAD_ONCE_INIT;
+
+int AdDefaultNumberOfThreads(void)
+{
+	long number;
+
+	if(defaultNumberOfThreads > 0)
+		return defaultNumberOfThreads;
+
+	number = sysconf(_SC_NPROCESSORS_ONLN);
+	return (number > 0) ? (int)number : 1;
+}
+
+void AdSetDefaultNumberOfThreads(int number)
+{
+	defaultNumberOfThreads = number;
+}
+
+/*
+ * Waits for tasks until the team exits.
+ * Workers whose index is not less than the number of parts of a task skip it.
+ */
+static void* AdThreadTeamWorkerMain(void* argument)
+{
+	struct AdThreadTeamWorker* worker = argument;
+	AdThreadTeam* team = worker->team;
+	AdThreadTeamFunction function;
+	void* taskArgument;
+
+	pthread_mutex_lock(&team->mutex);
+	while(1)
+	{
+		while(team->generation == worker->generation && !team->exit)
+			pthread_cond_wait(&team->taskCondition, &team->mutex);
+
+		if(team->exit)
+			break;
+
+		worker->generation = team->generation;
+		if(worker->index >= team->taskParts)
+			continue;
+
+		function = team->function;
+		taskArgument = team->argument;
+		pthread_mutex_unlock(&team->mutex);
+		function(taskArgument, worker->index);
+		pthread_mutex_lock(&team->mutex);
+
+		team->activeWorkers--;
+		if(team->activeWorkers == 0)
+			pthread_cond_signal(&team->finishedCondition);
+	}
+	pthread_mutex_unlock(&team->mutex);
+
+	return NULL;
+}
+
+/*
+ * Creates workers until the team has \e number. Only called by the thread
+ * holding runMutex so no task is being posted.
+ */
+static void AdThreadTeamAddWorkers(AdThreadTeam* team, int number)
+{
+	struct AdThreadTeamWorker* worker;
+
+	if(number > team->capacity)
+	{
+		team->capacity = number;
+		team->workers = realloc(team->workers, team->capacity*sizeof(struct AdThreadTeamWorker*));
+	}
+
+	while(team->canGrow && team->numberOfWorkers < number)
+	{
+		worker = malloc(sizeof(struct AdThreadTeamWorker));
+		worker->index = team->numberOfWorkers + 1;
+		worker->generation = team->generation;
+		worker->team = team;
+		if(pthread_create(&worker->thread, NULL, AdThreadTeamWorkerMain, worker) != 0)
+		{
+			fprintf(stderr, "AdThreadTeam - Unable to create worker %d\n", worker->index);
+			free(worker);
+			team->canGrow = false;
+			break;
+		}
+
+		team->workers[team->numberOfWorkers] = worker;
+		team->numberOfWorkers++;
+	}
+}
+
+AdThreadTeam* AdCreateThreadTeam(void)
+{
+	AdThreadTeam* team;
+
+	team = malloc(sizeof(AdThreadTeam));
+	team->numberOfWorkers = 0;
+	team->capacity = 0;
+	team->canGrow = true;
+	team->exit = false;
+	team->generation = 0;
+	team->taskParts = 0;
+	team->activeWorkers = 0;
+	team->function = NULL;
+	team->argument = NULL;
+	team->workers = NULL;
+	pthread_mutex_init(&team->runMutex, NULL);
+	pthread_mutex_init(&team->mutex, NULL);
+	pthread_cond_init(&team->taskCondition, NULL);
+	pthread_cond_init(&team->finishedCondition, NULL);
+
+	return team;
+}
+
+void AdFreeThreadTeam(AdThreadTeam* team)
+{
+	int i;
+
+	if(team == NULL)
+		return;
+
+	pthread_mutex_lock(&team->mutex);
+	team->exit = true;
+	pthread_cond_broadcast(&team->taskCondition);
+	pthread_mutex_unlock(&team->mutex);
+
+	for(i=0; i<team->numberOfWorkers; i++)
+	{
+		pthread_join(team->workers[i]->thread, NULL);
+		free(team->workers[i]);
+	}
+
+	free(team->workers);
+	pthread_cond_destroy(&team->taskCondition);
+	pthread_cond_destroy(&team->finishedCondition);
+	pthread_mutex_destroy(&team->mutex);
+	pthread_mutex_destroy(&team->runMutex);
+	free(team);
+}
+
+static void AdCreateSharedThreadTeam(void)
+{
+	sharedTeam = AdCreateThreadTeam();
+}
+
+AdThreadTeam* AdSharedThreadTeam(void)
+{
+	pthread_once(&sharedTeamOnce, AdCreateSharedThreadTeam);
+	return sharedTeam;
+}
+
+int AdRunThreadTeam(AdThreadTeam* team, AdThreadTeamFunction function, void* argument, int numberOfParts)
+{
+	int i, threads;
+
+	if(numberOfParts <= 1 || pthread_mutex_trylock(&team->runMutex) != 0)
+	{
+		for(i=0; i<numberOfParts; i++)
+			function(argument, i);
+
+		return 1;
+	}
+
+	AdThreadTeamAddWorkers(team, numberOfParts - 1);
+	threads = (numberOfParts < team->numberOfWorkers + 1) ? numberOfParts : team->numberOfWorkers + 1;
+
+	pthread_mutex_lock(&team->mutex);
+	team->function = function;
+	team->argument = argument;
+	team->taskParts = threads;
+	team->activeWorkers = threads - 1;
+	team->generation++;
+	pthread_cond_broadcast(&team->taskCondition);
+	pthread_mutex_unlock(&team->mutex);
+
+	//Parts without a worker are performed here after the first
+	function(argument, 0);
+	for(i=threads; i<numberOfParts; i++)
+		function(argument, i);
+
+	pthread_mutex_lock(&team->mutex);
+	while(team->activeWorkers > 0)
+		pthread_cond_wait(&team->finishedCondition, &team->mutex);
+	pthread_mutex_unlock(&team->mutex);
+
+	pthread_mutex_unlock(&team->runMutex);
+
+	return threads;
+}
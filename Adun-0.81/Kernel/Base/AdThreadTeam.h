@@ -0,0 +1,116 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#ifndef THREAD_TEAM
+#define THREAD_TEAM
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/**
+The function run by the members of an AdThreadTeam.
+\e index identifies the part of the work to perform and is between 0 and
+the number of parts passed to AdRunThreadTeam() minus one.
+*/
+typedef void (*AdThreadTeamFunction)(void* argument, int index);
+
+struct AdThreadTeamWorker;
+
+//! \brief A persistent team of worker threads.
+/**
+The workers block on a condition variable between tasks so idle workers do not use processor time.
+Use the functions in ThreadTeam to create and run a team.
+\ingroup Types
+*/
+typedef struct
+{
+	int numberOfWorkers;
+	int capacity;
+	bool canGrow;				//!< Cleared if a worker could not be created
+	bool exit;
+	unsigned int generation;		//!< Incremented each time a task is posted
+	int taskParts;				//!< The number of parts of the current task run by workers and the caller
+	int activeWorkers;			//!< The number of workers still performing the current task
+	AdThreadTeamFunction function;
+	void* argument;
+	struct AdThreadTeamWorker** workers;
+	pthread_mutex_t runMutex;		//!< Held by the thread running a task
+	pthread_mutex_t mutex;
+	pthread_cond_t taskCondition;
+	pthread_cond_t finishedCondition;
+}
+AdThreadTeam;
+
+/**
+Functions for dividing work between a persistent team of threads.
+Code which divides its work into parts, each with its own buffers, uses AdRunThreadTeam() on the
+team returned by AdSharedThreadTeam() instead of creating threads itself.
+Because each part is always performed by one thread and has its own buffers,
+results combined in part order are the same however many threads perform the parts.
+\defgroup ThreadTeam Thread Team
+\ingroup Functions
+@{
+*/
+
+/**
+Returns the number of parts objects divide their work into by default.
+This is the value set by AdSetDefaultNumberOfThreads() or, if that is less than 1,
+the number of online processors.
+*/
+int AdDefaultNumberOfThreads(void);
+
+/**
+Sets the value returned by AdDefaultNumberOfThreads(). Only affects objects created afterwards.
+*/
+void AdSetDefaultNumberOfThreads(int number);
+
+/**
+Creates a team without workers. Workers are added by AdRunThreadTeam() as they are needed.
+Free using AdFreeThreadTeam().
+*/
+AdThreadTeam* AdCreateThreadTeam(void);
+
+/**
+Stops the workers of \e team and frees it. \e team must not be running a task.
+*/
+void AdFreeThreadTeam(AdThreadTeam* team);
+
+/**
+Returns the team shared by all the objects of a process. It is created on first use.
+*/
+AdThreadTeam* AdSharedThreadTeam(void);
+
+/**
+Calls \e function with \e argument for each index from 0 to \e numberOfParts - 1 and returns when all the calls have finished.
+The calling thread performs part 0 and the workers, which are created the first time they are needed,
+perform one part each. If a worker can't be created its part is performed by the calling thread.
+If \e team is already running a task, e.g. when this is called by a part of another task,
+the calling thread performs every part itself.
+\return The number of threads that performed the parts.
+*/
+int AdRunThreadTeam(AdThreadTeam* team, AdThreadTeamFunction function, void* argument, int numberOfParts);
+
+/** \@}**/
+
+#endif
@@ -0,0 +1,679 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#include "Base/AdTrajectoryFrame.h"
+
+//Size of the block header - encoding, rows, payload size, reserved
+#define BLOCK_HEADER_SIZE (4*sizeof(uint32_t))
+//The value written to the byte order word of each frame
+#define FRAME_BYTE_ORDER 0x01020304
+//Rounds size up to a multiple of eight bytes
+#define PADDED_SIZE(size) (((size) + 7) & ~((size_t)7))
+//Size of the compressed payload header - precision, minima, bits
+#define COMPRESSED_HEADER_SIZE (sizeof(double) + 3*sizeof(int32_t) + 3*sizeof(uint32_t))
+//The largest magnitude of a rounded value - leaves room for the range of a column
+#define MAXIMUM_ROUNDED_VALUE 1073741823.0
+
+static uint32_t AdReadUInt32(const unsigned char* buffer)
+{
+	uint32_t value;
+
+	memcpy(&value, buffer, sizeof(uint32_t));
+	return value;
+}
+
+static void AdWriteUInt32(unsigned char* buffer, uint32_t value)
+{
+	memcpy(buffer, &value, sizeof(uint32_t));
+}
+
+/**
+Returns the number of bits needed to store values from 0 to \e range.
+*/
+static uint32_t AdBitsForRange(uint32_t range)
+{
+	uint32_t bits = 0;
+
+	while(bits < 32 && (range >> bits) != 0)
+		bits++;
+
+	return bits;
+}
+
+int AdIsBinaryTrajectoryFrame(const unsigned char* bytes, size_t length)
+{
+	if(length < 4)
+		return 0;
+
+	return memcmp(bytes, AD_TRAJECTORY_FRAME_MAGIC, 4) == 0;
+}
+
+size_t AdTrajectoryFrameBlockMaximumSize(int numberOfRows)
+{
+	//The float64 encoding is always the largest
+	return BLOCK_HEADER_SIZE + PADDED_SIZE(COMPRESSED_HEADER_SIZE + 3*numberOfRows*sizeof(double));
+}
+
+/**
+Bit packs the rounded values of \e matrix. Returns 0 if a value
+can't be represented at \e precision.
+*/
+static size_t AdCompressBlock(AdMatrix* matrix, double precision, unsigned char* buffer)
+{
+	int i, j;
+	int32_t minimum[3], maximum[3], value;
+	uint32_t bits[3], offset;
+	unsigned int filled;
+	uint64_t accumulator;
+	double scaled;
+	unsigned char* payload;
+
+	for(j=0; j<3; j++)
+	{
+		minimum[j] = INT32_MAX;
+		maximum[j] = INT32_MIN;
+	}
+
+	for(i=0; i<matrix->no_rows; i++)
+		for(j=0; j<3; j++)
+		{
+			scaled = matrix->matrix[i][j]*precision;
+			if(!(fabs(scaled) < MAXIMUM_ROUNDED_VALUE))
+				return 0;
+
+			value = (int32_t)lround(scaled);
+			if(value < minimum[j])
+				minimum[j] = value;
+			if(value > maximum[j])
+				maximum[j] = value;
+		}
+
+	for(j=0; j<3; j++)
+	{
+		if(matrix->no_rows == 0)
+			minimum[j] = maximum[j] = 0;
+
+		bits[j] = AdBitsForRange((uint32_t)(maximum[j] - minimum[j]));
+	}
+
+	memcpy(buffer, &precision, sizeof(double));
+	memcpy(buffer + sizeof(double), minimum, 3*sizeof(int32_t));
+	memcpy(buffer + sizeof(double) + 3*sizeof(int32_t), bits, 3*sizeof(uint32_t));
+	payload = buffer + COMPRESSED_HEADER_SIZE;
+
+	//Values are added to the low end of the accumulator and
+	//written out a byte at a time from the high end.
+	accumulator = 0;
+	filled = 0;
+	for(i=0; i<matrix->no_rows; i++)
+		for(j=0; j<3; j++)
+		{
+			value = (int32_t)lround(matrix->matrix[i][j]*precision);
+			offset = (uint32_t)(value - minimum[j]);
+			accumulator = (accumulator << bits[j]) | offset;
+			filled += bits[j];
+			while(filled >= 8)
+			{
+				filled -= 8;
+				*payload++ = (unsigned char)(accumulator >> filled);
+			}
+		}
+
+	if(filled > 0)
+		*payload++ = (unsigned char)(accumulator << (8 - filled));
+
+	return payload - buffer;
+}
+
+size_t AdEncodeTrajectoryFrameBlock(AdMatrix* matrix, AdFrameEncoding encoding, double precision, unsigned char* buffer)
+{
+	int i, j;
+	size_t payloadSize = 0;
+	float* floatPayload;
+	double* doublePayload;
+	unsigned char* payload;
+
+	payload = buffer + BLOCK_HEADER_SIZE;
+	if(encoding == AdFrameCompressedEncoding)
+	{
+		payloadSize = AdCompressBlock(matrix, precision, payload);
+		if(payloadSize == 0)
+			encoding = AdFrameFloat32Encoding;
+	}
+
+	if(encoding == AdFrameFloat32Encoding)
+	{
+		payloadSize = 3*matrix->no_rows*sizeof(float);
+		floatPayload = (float*)malloc(payloadSize + sizeof(float));
+		for(i=0; i<matrix->no_rows; i++)
+			for(j=0; j<3; j++)
+				floatPayload[3*i + j] = (float)matrix->matrix[i][j];
+
+		memcpy(payload, floatPayload, payloadSize);
+		free(floatPayload);
+	}
+	else if(encoding == AdFrameFloat64Encoding)
+	{
+		payloadSize = 3*matrix->no_rows*sizeof(double);
+		if(matrix->no_columns == 3)
+			memcpy(payload, matrix->matrix[0], payloadSize);
+		else
+		{
+			doublePayload = (double*)payload;
+			for(i=0; i<matrix->no_rows; i++)
+				for(j=0; j<3; j++)
+					memcpy(doublePayload + 3*i + j, &matrix->matrix[i][j], sizeof(double));
+		}
+	}
+
+	AdWriteUInt32(buffer, (uint32_t)encoding);
+	AdWriteUInt32(buffer + sizeof(uint32_t), (uint32_t)matrix->no_rows);
+	AdWriteUInt32(buffer + 2*sizeof(uint32_t), (uint32_t)payloadSize);
+	AdWriteUInt32(buffer + 3*sizeof(uint32_t), 0);
+	memset(payload + payloadSize, 0, PADDED_SIZE(payloadSize) - payloadSize);
+
+	return BLOCK_HEADER_SIZE + PADDED_SIZE(payloadSize);
+}
+
+size_t AdTrajectoryFrameBlockInfo(const unsigned char* buffer, size_t length, int* numberOfRows)
+{
+	size_t payloadSize;
+
+	if(length < BLOCK_HEADER_SIZE)
+		return 0;
+
+	if(AdReadUInt32(buffer) > AdFrameCompressedEncoding)
+		return 0;
+
+	payloadSize = PADDED_SIZE((size_t)AdReadUInt32(buffer + 2*sizeof(uint32_t)));
+	if(payloadSize > length - BLOCK_HEADER_SIZE)
+		return 0;
+
+	*numberOfRows = (int)AdReadUInt32(buffer + sizeof(uint32_t));
+	return BLOCK_HEADER_SIZE + payloadSize;
+}
+
+/**
+Unpacks a compressed payload of \e payloadSize bytes into \e matrix.
+*/
+static int AdDecompressBlock(const unsigned char* buffer, size_t payloadSize, AdMatrix* matrix)
+{
+	int i, j;
+	int32_t minimum[3];
+	uint32_t bits[3];
+	unsigned int filled;
+	uint64_t accumulator, mask;
+	double precision;
+	const unsigned char *payload, *end;
+
+	if(payloadSize < COMPRESSED_HEADER_SIZE)
+		return 0;
+
+	memcpy(&precision, buffer, sizeof(double));
+	memcpy(minimum, buffer + sizeof(double), 3*sizeof(int32_t));
+	memcpy(bits, buffer + sizeof(double) + 3*sizeof(int32_t), 3*sizeof(uint32_t));
+	if(precision <= 0 || bits[0] > 32 || bits[1] > 32 || bits[2] > 32)
+		return 0;
+
+	if((((uint64_t)(bits[0] + bits[1] + bits[2]))*matrix->no_rows + 7)/8 > payloadSize - COMPRESSED_HEADER_SIZE)
+		return 0;
+
+	payload = buffer + COMPRESSED_HEADER_SIZE;
+	end = buffer + payloadSize;
+	accumulator = 0;
+	filled = 0;
+	for(i=0; i<matrix->no_rows; i++)
+		for(j=0; j<3; j++)
+		{
+			while(filled < bits[j] && payload < end)
+			{
+				accumulator = (accumulator << 8) | *payload++;
+				filled += 8;
+			}
+
+			filled -= bits[j];
+			mask = (bits[j] == 0) ? 0 : (((uint64_t)1 << bits[j]) - 1);
+			matrix->matrix[i][j] = ((double)((int64_t)((accumulator >> filled) & mask) + minimum[j]))/precision;
+		}
+
+	return 1;
+}
+
+size_t AdDecodeTrajectoryFrameBlock(const unsigned char* buffer, size_t length, AdMatrix* matrix)
+{
+	int i, j, numberOfRows;
+	size_t blockSize, payloadSize;
+	uint32_t encoding;
+	float value;
+	double doubleValue;
+	const unsigned char* payload;
+
+	blockSize = AdTrajectoryFrameBlockInfo(buffer, length, &numberOfRows);
+	if(blockSize == 0 || numberOfRows != matrix->no_rows || matrix->no_columns < 3)
+		return 0;
+
+	encoding = AdReadUInt32(buffer);
+	payloadSize = AdReadUInt32(buffer + 2*sizeof(uint32_t));
+	payload = buffer + BLOCK_HEADER_SIZE;
+	if(encoding == AdFrameFloat64Encoding)
+	{
+		if(payloadSize != 3*numberOfRows*sizeof(double))
+			return 0;
+
+		if(matrix->no_columns == 3)
+			memcpy(matrix->matrix[0], payload, payloadSize);
+		else
+			for(i=0; i<numberOfRows; i++)
+				for(j=0; j<3; j++)
+				{
+					memcpy(&doubleValue, payload + (3*i + j)*sizeof(double), sizeof(double));
+					matrix->matrix[i][j] = doubleValue;
+				}
+	}
+	else if(encoding == AdFrameFloat32Encoding)
+	{
+		if(payloadSize != 3*numberOfRows*sizeof(float))
+			return 0;
+
+		for(i=0; i<numberOfRows; i++)
+			for(j=0; j<3; j++)
+			{
+				memcpy(&value, payload + (3*i + j)*sizeof(float), sizeof(float));
+				matrix->matrix[i][j] = value;
+			}
+	}
+	else if(!AdDecompressBlock(payload, payloadSize, matrix))
+		return 0;
+
+	return blockSize;
+}
+
+size_t AdWriteTrajectoryFrameHeader(unsigned char* buffer, int numberOfSystems)
+{
+	memcpy(buffer, AD_TRAJECTORY_FRAME_MAGIC, 4);
+	AdWriteUInt32(buffer + sizeof(uint32_t), AD_TRAJECTORY_FRAME_VERSION);
+	AdWriteUInt32(buffer + 2*sizeof(uint32_t), (uint32_t)numberOfSystems);
+	AdWriteUInt32(buffer + 3*sizeof(uint32_t), FRAME_BYTE_ORDER);
+
+	return AD_TRAJECTORY_FRAME_HEADER_SIZE;
+}
+
+size_t AdTrajectoryFrameSystemHeaderSize(size_t nameLength)
+{
+	return 2*sizeof(uint32_t) + PADDED_SIZE(nameLength);
+}
+
+size_t AdWriteTrajectoryFrameSystemHeader(unsigned char* buffer, const char* name, size_t nameLength, unsigned int mask)
+{
+	size_t size;
+
+	size = AdTrajectoryFrameSystemHeaderSize(nameLength);
+	AdWriteUInt32(buffer, (uint32_t)nameLength);
+	AdWriteUInt32(buffer + sizeof(uint32_t), (uint32_t)mask);
+	memcpy(buffer + 2*sizeof(uint32_t), name, nameLength);
+	memset(buffer + 2*sizeof(uint32_t) + nameLength, 0, size - 2*sizeof(uint32_t) - nameLength);
+
+	return size;
+}
+
+int AdFindTrajectoryFrameSystem(const unsigned char* frame, size_t length, 
+	const char* name, size_t nameLength, 
+	unsigned int* mask, size_t* offset)
+{
+	unsigned int i, j, numberOfSystems, entryMask, numberOfBlocks;
+	int numberOfRows;
+	size_t position, entryNameLength, blockSize;
+
+	if(length < AD_TRAJECTORY_FRAME_HEADER_SIZE || !AdIsBinaryTrajectoryFrame(frame, length))
+		return -1;
+
+	if(AdReadUInt32(frame + sizeof(uint32_t)) != AD_TRAJECTORY_FRAME_VERSION)
+		return -1;
+
+	if(AdReadUInt32(frame + 3*sizeof(uint32_t)) != FRAME_BYTE_ORDER)
+		return -1;
+
+	numberOfSystems = AdReadUInt32(frame + 2*sizeof(uint32_t));
+	position = AD_TRAJECTORY_FRAME_HEADER_SIZE;
+	for(i=0; i<numberOfSystems; i++)
+	{
+		if(length - position < 2*sizeof(uint32_t))
+			return -1;
+
+		entryNameLength = AdReadUInt32(frame + position);
+		entryMask = AdReadUInt32(frame + position + sizeof(uint32_t));
+		if(length - position < AdTrajectoryFrameSystemHeaderSize(entryNameLength))
+			return -1;
+
+		if(entryNameLength == nameLength && 
+			memcmp(frame + position + 2*sizeof(uint32_t), name, nameLength) == 0)
+		{
+			*mask = entryMask;
+			*offset = position + AdTrajectoryFrameSystemHeaderSize(entryNameLength);
+			return 1;
+		}	
+
+		//Skip the blocks of this system - one for each bit of the mask
+		position += AdTrajectoryFrameSystemHeaderSize(entryNameLength);
+		for(numberOfBlocks = 0, j=0; j<32; j++)
+			if(entryMask & (1u << j))
+				numberOfBlocks++;
+
+		for(j=0; j<numberOfBlocks; j++)
+		{
+			blockSize = AdTrajectoryFrameBlockInfo(frame + position, length - position, &numberOfRows);
+			if(blockSize == 0)
+				return -1;
+
+			position += blockSize;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Conversion of frames written by earlier versions or on other machines
+ */
+
+//Size of the block header of a version 1 frame - encoding, rows, payload size
+#define VERSION1_BLOCK_HEADER_SIZE (3*sizeof(uint32_t))
+//The byte order word of a frame written on a machine with the opposite byte order
+#define SWAPPED_FRAME_BYTE_ORDER 0x04030201
+
+static uint32_t AdSwapUInt32(uint32_t value)
+{
+	return ((value & 0xff) << 24) | ((value & 0xff00) << 8) 
+		| ((value >> 8) & 0xff00) | (value >> 24);
+}
+
+/**
+Reads a uint32 from \e buffer reversing its byte order if \e swap is 1.
+*/
+static uint32_t AdReadFrameUInt32(const unsigned char* buffer, int swap)
+{
+	uint32_t value;
+
+	value = AdReadUInt32(buffer);
+	return swap ? AdSwapUInt32(value) : value;
+}
+
+/**
+Copies \e number values of \e size bytes from \e source to \e destination
+reversing the byte order of each.
+*/
+static void AdCopySwappedValues(unsigned char* destination, const unsigned char* source, size_t size, size_t number)
+{
+	size_t i, j;
+
+	for(i=0; i<number; i++)
+		for(j=0; j<size; j++)
+			destination[i*size + j] = source[i*size + size - j - 1];
+}
+
+/**
+Copies the payload of a block with \e encoding to \e buffer reversing the byte order of
+its values. The bit packed values of a compressed block are written a byte at a time
+so only its header is swapped. Returns 0 if the payload is not valid.
+*/
+static int AdCopySwappedPayload(const unsigned char* payload, size_t payloadSize, 
+	uint32_t encoding, unsigned char* buffer)
+{
+	if(encoding == AdFrameFloat64Encoding)
+	{
+		if(payloadSize % sizeof(double) != 0)
+			return 0;
+
+		if(buffer != NULL)
+			AdCopySwappedValues(buffer, payload, sizeof(double), payloadSize/sizeof(double));
+	}
+	else if(encoding == AdFrameFloat32Encoding)
+	{
+		if(payloadSize % sizeof(float) != 0)
+			return 0;
+
+		if(buffer != NULL)
+			AdCopySwappedValues(buffer, payload, sizeof(float), payloadSize/sizeof(float));
+	}
+	else
+	{
+		if(payloadSize < COMPRESSED_HEADER_SIZE)
+			return 0;
+
+		if(buffer != NULL)
+		{
+			AdCopySwappedValues(buffer, payload, sizeof(double), 1);
+			AdCopySwappedValues(buffer + sizeof(double), payload + sizeof(double), 
+				sizeof(uint32_t), 6);
+			memcpy(buffer + COMPRESSED_HEADER_SIZE, payload + COMPRESSED_HEADER_SIZE, 
+				payloadSize - COMPRESSED_HEADER_SIZE);
+		}
+	}
+
+	return 1;
+}
+
+/**
+Copies the block at \e position in \e frame to \e buffer in the current layout. 
+The block is padded if \e padded is 1 and its byte order is reversed if \e swap is 1.
+If \e buffer is NULL nothing is written.
+Returns the size of the block in \e frame placing the size of the converted block in \e size,
+or 0 if the block is not valid.
+*/
+static size_t AdConvertFrameBlock(const unsigned char* frame, size_t length, size_t position, 
+	int padded, int swap, unsigned char* buffer, size_t* size)
+{
+	uint32_t encoding;
+	size_t headerSize, payloadSize, blockSize;
+	const unsigned char* payload;
+
+	headerSize = padded ? BLOCK_HEADER_SIZE : VERSION1_BLOCK_HEADER_SIZE;
+	if(length - position < headerSize)
+		return 0;
+
+	encoding = AdReadFrameUInt32(frame + position, swap);
+	if(encoding > AdFrameCompressedEncoding)
+		return 0;
+
+	payloadSize = AdReadFrameUInt32(frame + position + 2*sizeof(uint32_t), swap);
+	blockSize = headerSize + (padded ? PADDED_SIZE(payloadSize) : payloadSize);
+	if(blockSize < headerSize || blockSize > length - position)
+		return 0;
+
+	payload = frame + position + headerSize;
+	if(swap && !AdCopySwappedPayload(payload, payloadSize, encoding, 
+		(buffer == NULL) ? NULL : buffer + BLOCK_HEADER_SIZE))
+		return 0;
+
+	if(buffer != NULL)
+	{
+		AdWriteUInt32(buffer, encoding);
+		AdWriteUInt32(buffer + sizeof(uint32_t), 
+			AdReadFrameUInt32(frame + position + sizeof(uint32_t), swap));
+		AdWriteUInt32(buffer + 2*sizeof(uint32_t), (uint32_t)payloadSize);
+		AdWriteUInt32(buffer + 3*sizeof(uint32_t), 0);
+		if(!swap)
+			memcpy(buffer + BLOCK_HEADER_SIZE, payload, payloadSize);
+
+		memset(buffer + BLOCK_HEADER_SIZE + payloadSize, 0, PADDED_SIZE(payloadSize) - payloadSize);
+	}
+
+	*size = BLOCK_HEADER_SIZE + PADDED_SIZE(payloadSize);
+	return blockSize;
+}
+
+/**
+Converts the systems of \e frame to the current layout in the byte order of this machine.
+Version 1 frames were first written without padding, with the memento mask of each system
+after its name. Later version 1 frames and version 2 frames have the current layout. 
+\e padded selects which is read and \e swap if the byte order is reversed.
+Returns the size of the converted frame or 0 if \e frame does not have the layout or has trailing bytes.
+*/
+static size_t AdConvertFrameSystems(const unsigned char* frame, size_t length, 
+	int padded, int swap, unsigned char* buffer)
+{
+	unsigned int i, j, numberOfSystems, mask, numberOfBlocks;
+	size_t position, size, nameLength, nameSize, blockSize, convertedSize;
+	const unsigned char* name;
+
+	numberOfSystems = AdReadFrameUInt32(frame + 2*sizeof(uint32_t), swap);
+	position = AD_TRAJECTORY_FRAME_HEADER_SIZE;
+	size = AD_TRAJECTORY_FRAME_HEADER_SIZE;
+	if(buffer != NULL)
+		AdWriteTrajectoryFrameHeader(buffer, numberOfSystems);
+
+	for(i=0; i<numberOfSystems; i++)
+	{
+		if(length - position < 2*sizeof(uint32_t))
+			return 0;
+
+		nameLength = AdReadFrameUInt32(frame + position, swap);
+		nameSize = padded ? PADDED_SIZE(nameLength) : nameLength;
+		if(nameSize > length - position - 2*sizeof(uint32_t))
+			return 0;
+
+		if(padded)
+		{
+			mask = AdReadFrameUInt32(frame + position + sizeof(uint32_t), swap);
+			name = frame + position + 2*sizeof(uint32_t);
+		}
+		else
+		{
+			name = frame + position + sizeof(uint32_t);
+			mask = AdReadFrameUInt32(frame + position + sizeof(uint32_t) + nameLength, swap);
+		}
+
+		if(buffer != NULL)
+			AdWriteTrajectoryFrameSystemHeader(buffer + size, (const char*)name, nameLength, mask);
+
+		position += 2*sizeof(uint32_t) + nameSize;
+		size += AdTrajectoryFrameSystemHeaderSize(nameLength);
+		for(numberOfBlocks = 0, j=0; j<32; j++)
+			if(mask & (1u << j))
+				numberOfBlocks++;
+
+		for(j=0; j<numberOfBlocks; j++)
+		{
+			blockSize = AdConvertFrameBlock(frame, length, position, padded, swap,
+					(buffer == NULL) ? NULL : buffer + size, &convertedSize);
+			if(blockSize == 0)
+				return 0;
+
+			position += blockSize;
+			size += convertedSize;
+		}
+	}
+
+	return (position == length) ? size : 0;
+}
+
+int AdTrajectoryFrameNeedsConversion(const unsigned char* frame, size_t length)
+{
+	if(length < AD_TRAJECTORY_FRAME_HEADER_SIZE || !AdIsBinaryTrajectoryFrame(frame, length))
+		return 0;
+
+	return AdReadUInt32(frame + sizeof(uint32_t)) != AD_TRAJECTORY_FRAME_VERSION
+		|| AdReadUInt32(frame + 3*sizeof(uint32_t)) != FRAME_BYTE_ORDER;
+}
+
+size_t AdConvertTrajectoryFrame(const unsigned char* frame, size_t length, unsigned char* buffer)
+{
+	int swap;
+	uint32_t version;
+	size_t size;
+
+	if(length < AD_TRAJECTORY_FRAME_HEADER_SIZE || !AdIsBinaryTrajectoryFrame(frame, length))
+		return 0;
+
+	if(AdReadUInt32(frame + 3*sizeof(uint32_t)) == FRAME_BYTE_ORDER)
+		swap = 0;
+	else if(AdReadUInt32(frame + 3*sizeof(uint32_t)) == SWAPPED_FRAME_BYTE_ORDER)
+		swap = 1;
+	else
+		return 0;
+
+	version = AdReadFrameUInt32(frame + sizeof(uint32_t), swap);
+	if(version == 1)
+	{
+		size = AdConvertFrameSystems(frame, length, 0, swap, NULL);
+		if(size != 0)
+		{
+			if(buffer != NULL)
+				AdConvertFrameSystems(frame, length, 0, swap, buffer);
+
+			return size;
+		}
+	}
+	else if(version != AD_TRAJECTORY_FRAME_VERSION)
+		return 0;
+
+	size = AdConvertFrameSystems(frame, length, 1, swap, NULL);
+	if(size != 0 && buffer != NULL)
+		AdConvertFrameSystems(frame, length, 1, swap, buffer);
+
+	return size;
+}
+
+int AdTrajectoryFrameBlockView(const unsigned char* buffer, size_t length, 
+	const int* elements, int numberOfElements,
+	AdMatrix* view)
+{
+	int i, numberOfRows;
+	double* payload;
+
+	if(AdTrajectoryFrameBlockInfo(buffer, length, &numberOfRows) == 0)
+		return 0;
+
+	if(AdReadUInt32(buffer) != AdFrameFloat64Encoding)
+		return 0;
+
+	if(AdReadUInt32(buffer + 2*sizeof(uint32_t)) != 3*numberOfRows*sizeof(double))
+		return 0;
+
+	if(((size_t)(buffer + BLOCK_HEADER_SIZE)) % sizeof(double) != 0)
+		return 0;
+
+	payload = (double*)(buffer + BLOCK_HEADER_SIZE);
+	if(elements == NULL)
+	{
+		if(numberOfElements != numberOfRows)
+			return 0;
+
+		for(i=0; i<numberOfRows; i++)
+			view->matrix[i] = payload + 3*i;
+	}
+	else
+	{
+		for(i=0; i<numberOfElements; i++)
+		{
+			if(elements[i] < 0 || elements[i] >= numberOfRows)
+				return 0;
+
+			view->matrix[i] = payload + 3*elements[i];
+		}
+	}
+
+	view->no_rows = numberOfElements;
+	view->no_columns = 3;
+
+	return 1;
+}
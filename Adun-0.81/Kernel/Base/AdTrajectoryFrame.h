@@ -0,0 +1,180 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#ifndef TRAJECTORY_FRAME
+#define TRAJECTORY_FRAME
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "Base/AdMatrix.h"
+
+/**
+The four bytes every binary trajectory frame begins with.
+Frames written by earlier versions are XML property lists and begin with "<?".
+*/
+#define AD_TRAJECTORY_FRAME_MAGIC "AdTF"
+/**
+The version of the frame layout. Version 1 frames did not pad their sections
+to eight bytes. They can be read after converting them with AdConvertTrajectoryFrame().
+*/
+#define AD_TRAJECTORY_FRAME_VERSION 2
+//! The size of the header of a binary trajectory frame
+#define AD_TRAJECTORY_FRAME_HEADER_SIZE 16
+
+//! \brief The encodings available for the matrices of a binary trajectory frame.
+/**
+\ingroup Types
+*/
+typedef enum
+{
+	AdFrameFloat64Encoding = 0,	/**< Each value is stored as a double */
+	AdFrameFloat32Encoding = 1,	/**< Each value is stored as a float */
+	AdFrameCompressedEncoding = 2	/**< Lossy - Values are rounded to a fixed precision and bit packed.
+					  Only used for coordinates. Velocities of compressed frames are stored as float32 */
+}
+AdFrameEncoding;
+
+/**
+\defgroup trajectoryFrame Binary Trajectory Frames
+\ingroup Functions
+
+A binary trajectory frame has a fixed size header followed by an entry for each system.
+
+- Header: The magic bytes "AdTF", the format version, the number of systems and a byte order marker (all uint32).
+- System entry: The length of the system name and the memento mask of the system (uint32), which has one bit set for each block, followed by
+the name (UTF8, not terminated) padded to a multiple of eight bytes. Then a block for the coordinates and/or
+velocities depending on the mask.
+- Block: The encoding, the number of rows, the payload size in bytes and a reserved word (all uint32) followed by
+the payload padded to a multiple of eight bytes.
+
+The payload of a float64 or float32 block is the three values of each row in order.
+A compressed block is similar to the xtc format. Each value is multiplied by the precision
+and rounded to an integer. The minimum of each column is subtracted and the result is
+stored using the number of bits needed for the range of the column.
+The payload begins with the precision (double), the three column minima (int32) and the three bit widths (uint32).
+
+All values are in the byte order of the machine that wrote the frame. Frames written on a machine
+with the opposite byte order are swapped by AdConvertTrajectoryFrame() before they are read.
+Since every part of a frame is a multiple of eight bytes long the payload of a float64 block is
+correctly aligned for direct access if the frame is. AdTrajectoryFrameBlockView() uses this
+to access the coordinates of a memory mapped frame without copying them.
+@{
+*/
+
+/**
+Returns 1 if \e bytes contains a binary trajectory frame i.e. it begins with the magic bytes, 0 otherwise.
+*/
+int AdIsBinaryTrajectoryFrame(const unsigned char* bytes, size_t length);
+
+/**
+Returns the maximum number of bytes needed to encode a block of \e numberOfRows rows.
+*/
+size_t AdTrajectoryFrameBlockMaximumSize(int numberOfRows);
+
+/**
+Encodes the first three columns of \e matrix into \e buffer using \e encoding.
+\e precision is only used by AdFrameCompressedEncoding. If the values of \e matrix are too large
+to be represented at \e precision the block is stored as float32 instead.
+\e buffer must have space for AdTrajectoryFrameBlockMaximumSize() bytes.
+\return The number of bytes written.
+*/
+size_t AdEncodeTrajectoryFrameBlock(AdMatrix* matrix, AdFrameEncoding encoding, double precision, unsigned char* buffer);
+
+/**
+Reads the header of the block at the start of \e buffer placing the number of rows
+in \e numberOfRows.
+\return The total size of the block in bytes or 0 if \e buffer does not contain a valid block.
+*/
+size_t AdTrajectoryFrameBlockInfo(const unsigned char* buffer, size_t length, int* numberOfRows);
+
+/**
+Decodes the block at the start of \e buffer into the first three columns of \e matrix
+which must have the number of rows of the block.
+\return The total size of the block in bytes or 0 if \e buffer does not contain a valid block
+or \e matrix has the wrong number of rows.
+*/
+size_t AdDecodeTrajectoryFrameBlock(const unsigned char* buffer, size_t length, AdMatrix* matrix);
+
+/**
+Writes the header of a frame containing \e numberOfSystems systems to \e buffer.
+\return The number of bytes written.
+*/
+size_t AdWriteTrajectoryFrameHeader(unsigned char* buffer, int numberOfSystems);
+
+/**
+Returns the number of bytes needed for the entry header of a system whose name is \e nameLength bytes long.
+*/
+size_t AdTrajectoryFrameSystemHeaderSize(size_t nameLength);
+
+/**
+Writes the entry header of a system with name \e name and memento mask \e mask to \e buffer.
+The blocks of the system should be written directly after it.
+\return The number of bytes written.
+*/
+size_t AdWriteTrajectoryFrameSystemHeader(unsigned char* buffer, const char* name, size_t nameLength, unsigned int mask);
+
+/**
+Searches the frame \e frame for the system called \e name. 
+If found its memento mask is placed in \e mask and the offset of its first block in \e offset.
+\return 1 if the system was found, 0 if it is not in the frame and -1 if \e frame is not a valid
+binary frame, was written by another version or on a machine with a different byte order.
+Frames for which AdTrajectoryFrameNeedsConversion() returns 1 must be converted first.
+*/
+int AdFindTrajectoryFrameSystem(const unsigned char* frame, size_t length, 
+	const char* name, size_t nameLength, 
+	unsigned int* mask, size_t* offset);
+
+/**
+Returns 1 if \e frame is a binary frame written by an earlier version or on a machine with the
+opposite byte order, which must be converted with AdConvertTrajectoryFrame() before it can be read.
+Returns 0 otherwise.
+*/
+int AdTrajectoryFrameNeedsConversion(const unsigned char* frame, size_t length);
+
+/**
+Converts the version 1 or foreign byte order frame \e frame to the current layout
+and the byte order of this machine placing the result in \e buffer.
+If \e buffer is NULL only the size of the converted frame is calculated.
+\return The size of the converted frame or 0 if \e frame can't be converted.
+*/
+size_t AdConvertTrajectoryFrame(const unsigned char* frame, size_t length, unsigned char* buffer);
+
+/**
+Sets the rows of \e view to point directly into the payload of the block at the start of \e buffer.
+If \e elements is NULL row \e i of \e view is row \e i of the block and \e numberOfElements must be
+the number of rows in the block. Otherwise row \e i of \e view is row \e elements[i] of the block.
+The matrix array of \e view must have space for \e numberOfElements pointers.
+Views can only be created for float64 blocks whose payload is aligned for access as doubles.
+\return 1 if the view was created. 0 if the block is not a valid float64 block, its payload size does not match
+its number of rows, it is misaligned or an element is out of range.
+In this case the block has to be decoded with AdDecodeTrajectoryFrameBlock().
+*/
+int AdTrajectoryFrameBlockView(const unsigned char* buffer, size_t length, 
+	const int* elements, int numberOfElements,
+	AdMatrix* view);
+
+/** \@}**/
+
+#endif
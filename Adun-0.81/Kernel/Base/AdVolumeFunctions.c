@@ -21,22 +21,201 @@
  */
 
 #include "AdVolumeFunctions.h"
+#include "Base/AdNonbondedKernels.h"
+
+#ifdef BASE_X86_SIMD
+#include <immintrin.h>
+#endif
 
 static double smoothingLength;
 static double smoothingConstantA;
 static double smoothingConstantB;
+//True if the neighbours are processed using the AVX2 kernel
+static bool useVectorKernel = false;
 
 /*
  Precalculates some global variables which can greatly speed up the calculation.
  This avoids a large number of power and reciprocal calcs.
+ The kernel is also chosen here so the choice doesn't change while the functions are in use.
  */
 void AdInitialiseGBSmoothingVariables(double value)
 {
 	smoothingLength = value;
 	smoothingConstantA = 3/(4*smoothingLength);
 	smoothingConstantB = 1/(4*pow(smoothingLength, 3));	
+#ifdef BASE_X86_SIMD
+	useVectorKernel = (AdNonbondedKernels() != AdScalarNonbondedKernels);
+#endif
 }	
 
+#ifdef BASE_X86_SIMD
+
+/*
+ * AVX2 - The volume exclusion function at \e point due to four neighbours per batch.
+ * Lanes whose separation is less than the lower boundary overlap the point and 
+ * end the calculation. Lanes within the upper boundary are partial and their polynomial 
+ * values are multiplied in neighbour order, so the result is the same as the scalar loop.
+ * If \e contributingAtoms is not NULL the indexes of the partial atoms are placed in it.
+ */
+__attribute__((target("avx2,fma")))
+static double AdAVX2VolumeExclusion(double* point, 
+		double** matrix, 
+		int* neighbourIndexes, 
+		int numberNeighbours, 
+		double* radii, 
+		IntArrayStruct* contributingAtoms)
+{
+	int i, k, count, lanes, partialLanes;
+	int* indexes;
+	double retVal;
+	double* rows[4];
+	double radius[4] __attribute__ ((aligned (32)));
+	double atomicValues[4] __attribute__ ((aligned (32)));
+	__m256d px, py, pz, dx, dy, dz, length_sq, length, difference, radius_v;
+	__m256d lower, upper, valid, overlap, partial, atomicValue;
+	__m256d half, smoothing, constantA, constantB, laneNumbers;
+
+	half = _mm256_set1_pd(0.5);
+	smoothing = _mm256_set1_pd(smoothingLength);
+	constantA = _mm256_set1_pd(smoothingConstantA);
+	constantB = _mm256_set1_pd(smoothingConstantB);
+	laneNumbers = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+	px = _mm256_set1_pd(point[0]);
+	py = _mm256_set1_pd(point[1]);
+	pz = _mm256_set1_pd(point[2]);
+
+	for(count = 0, retVal = 1, i=0; i<numberNeighbours; i+=4)
+	{
+		indexes = neighbourIndexes + i;
+		lanes = (numberNeighbours - i < 4) ? numberNeighbours - i : 4;
+		for(k=0; k<lanes; k++)
+		{
+			rows[k] = matrix[indexes[k]];
+			radius[k] = radii[indexes[k]];
+		}
+
+		//Padding lanes are masked below
+		for(; k<4; k++)
+		{
+			rows[k] = point;
+			radius[k] = 0;
+		}
+
+		dx = _mm256_sub_pd(px, 
+			_mm256_set_pd(rows[3][0], rows[2][0], rows[1][0], rows[0][0]));
+		dy = _mm256_sub_pd(py, 
+			_mm256_set_pd(rows[3][1], rows[2][1], rows[1][1], rows[0][1]));
+		dz = _mm256_sub_pd(pz, 
+			_mm256_set_pd(rows[3][2], rows[2][2], rows[1][2], rows[0][2]));
+		length_sq = _mm256_fmadd_pd(dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+		
+		radius_v = _mm256_load_pd(radius);
+		lower = _mm256_sub_pd(radius_v, smoothing);
+		upper = _mm256_add_pd(radius_v, smoothing);
+		valid = _mm256_cmp_pd(laneNumbers, _mm256_set1_pd(lanes), _CMP_LT_OQ);
+		
+		//If any atom completely overlaps the point the function is 0.
+		overlap = _mm256_and_pd(valid, 
+				_mm256_cmp_pd(length_sq, _mm256_mul_pd(lower, lower), _CMP_LT_OQ));
+		if(_mm256_movemask_pd(overlap) != 0)
+		{
+			retVal = 0;
+			count = 0;
+			break;
+		}
+		
+		partial = _mm256_and_pd(valid, 
+				_mm256_cmp_pd(length_sq, _mm256_mul_pd(upper, upper), _CMP_LE_OQ));
+		partialLanes = _mm256_movemask_pd(partial);
+		if(partialLanes == 0)
+			continue;
+			
+		//0.5 + difference*(A - B*difference^2)
+		length = _mm256_sqrt_pd(length_sq);
+		difference = _mm256_sub_pd(length, radius_v);
+		atomicValue = _mm256_fnmadd_pd(_mm256_mul_pd(constantB, difference), difference, constantA);
+		atomicValue = _mm256_fmadd_pd(difference, atomicValue, half);
+		_mm256_store_pd(atomicValues, atomicValue);
+		
+		for(k=0; k<lanes; k++)
+			if(partialLanes & (1 << k))
+			{
+				retVal *= atomicValues[k];
+				if(contributingAtoms != NULL)
+				{
+					contributingAtoms->array[count] = indexes[k];
+					count++;
+				}
+			}
+	}
+	
+	if(contributingAtoms != NULL)
+		contributingAtoms->length = count;
+
+	return retVal;
+}
+
+#endif
+
+AdVolumeBlock* AdAllocateVolumeBlock(int capacity)
+{
+	AdVolumeBlock* block;
+
+	block = malloc(sizeof(AdVolumeBlock));
+	block->capacity = capacity;
+	block->numberPoints = 0;
+	block->points = malloc(capacity*sizeof(Vector3D));
+	block->neighbourIndexes = malloc(capacity*sizeof(int*));
+	block->numberNeighbours = malloc(capacity*sizeof(int));
+	block->values = malloc(capacity*sizeof(double));
+
+	return block;
+}
+
+void AdFreeVolumeBlock(AdVolumeBlock* block)
+{
+	if(block == NULL)
+		return;
+
+	free(block->points);
+	free(block->neighbourIndexes);
+	free(block->numberNeighbours);
+	free(block->values);
+	free(block);
+}
+
+void AdVolumeExclusionFunctionBlock(AdVolumeBlock* block, AdMatrix* coordinates, double* radii)
+{
+	int i;
+
+#ifdef BASE_X86_SIMD
+	if(useVectorKernel)
+	{
+		for(i=0; i<block->numberPoints; i++)
+		{
+			if(block->numberNeighbours[i] == 0)
+				block->values[i] = 1.0;
+			else
+				block->values[i] = AdAVX2VolumeExclusion(block->points[i].vector, 
+							coordinates->matrix, 
+							block->neighbourIndexes[i], 
+							block->numberNeighbours[i], 
+							radii, 
+							NULL);
+		}
+
+		return;
+	}
+#endif
+
+	for(i=0; i<block->numberPoints; i++)
+		block->values[i] = AdVolumeExclusionFunction(block->points + i, 
+					coordinates, 
+					block->neighbourIndexes[i], 
+					block->numberNeighbours[i], 
+					radii);
+}
+
 /*
  Calculates the contribution to the atomic exclusion function for a point a distance
  \e separation from an atom which has PB radius \e radius.
@@ -243,6 +422,12 @@ void AdInitialiseGBSmoothingVariables(double value)
 	//Dereference the coordinates matrix;
 	matrix = coordinates->matrix;
 	
+#ifdef BASE_X86_SIMD
+	if(useVectorKernel && neighbourIndexes != NULL)
+		return AdAVX2VolumeExclusion(r->vector, matrix, 
+				neighbourIndexes, numberNeighbours, radii, NULL);
+#endif
+	
 	//If a neighbour array is passed used it.
 	if(neighbourIndexes != NULL)
 	{
@@ -324,6 +509,12 @@ If the function is 0 the length of this array is 0.
 	matrix = coordinates->matrix;
 	pointPosition = r->vector;
 	
+#ifdef BASE_X86_SIMD
+	if(useVectorKernel)
+		return AdAVX2VolumeExclusion(pointPosition, matrix, 
+				neighbourIndexes, numberNeighbours, radii, contributingAtoms);
+#endif
+	
 	//If a neighbour array is passed used it.
 	for(count = 0, retVal = 1, i=0; i<numberNeighbours; i++)
 	{
@@ -168,11 +168,47 @@ double AdVolumeExclusionFunction(Vector3D* r, AdMatrix* coordinates, int* neighb
 /**
 As the standard VEF but on return, if the function is not 0 or 1,\e contributingAtoms contains
 the indexes of the atoms who parially overlap the point.
-This version does not check for NULL \e neighbourIndexes
+This version does not check for NULL \e neighbourIndexes.
+Like AdVolumeExclusionFunctionBlock() it processes the neighbours in batches when possible.
 */
 double AdVolumeExclusionFunction2(Vector3D* r, AdMatrix* coordinates, 
 					 int* neighbourIndexes, int numberNeighbours, double* radii, 
 					 IntArrayStruct* contributingAtoms);
+/**
+ A block of points at which the volume exclusion function is calculated by AdVolumeExclusionFunctionBlock().
+ Usually the points are the integration points of one radial shell around an atom.
+ */
+typedef struct
+{
+	int capacity;			//!< The number of points the block has space for
+	int numberPoints;		//!< The number of points in the block
+	Vector3D* points;		//!< The position of each point
+	int** neighbourIndexes;		//!< The indexes of the atoms near each point
+	int* numberNeighbours;		//!< The number of atoms near each point
+	double* values;			//!< The volume exclusion function at each point
+}
+AdVolumeBlock;
+
+/**
+ Creates a block with space for \e capacity points. Free using AdFreeVolumeBlock().
+ */
+AdVolumeBlock* AdAllocateVolumeBlock(int capacity);
+
+/**
+ Frees a block created using AdAllocateVolumeBlock().
+ */
+void AdFreeVolumeBlock(AdVolumeBlock* block);
+
+/**
+ Calculates the volume exclusion function at each point in \e block placing the results in its values array.
+ The neighbours of each point are processed in batches of four using AVX2 if the cpu supports it
+ and the instruction set selected by AdNonbondedKernels() when AdInitialiseGBSmoothingVariables() was 
+ last called is not AdScalarNonbondedKernels. Each point stops as soon as a batch contains an atom which
+ completely overlaps it.
+ The result is the same as calling AdVolumeExclusionFunction() for each point.
+ */
+void AdVolumeExclusionFunctionBlock(AdVolumeBlock* block, AdMatrix* coordinates, double* radii);
+
 /**
  This is simply 1 - volume exclusion function at the point, \f$ \mathbf{r} \f$
  */
@@ -0,0 +1,162 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+/*
+ * Checks the forces of the scalar bonded functions against central
+ * finite differences of their energies.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Base/AdForceFieldFunctions.h"
+
+#define STEP 1E-6
+#define TOLERANCE 1E-6
+
+static int failures = 0;
+
+typedef void (*AdScalarEnergy)(double*, double**, double*);
+typedef void (*AdScalarForce)(double*, double**, double**, double*);
+
+//A torsion whose angle is away from 0 and 180 so the energy is smooth.
+static double torsionCoordinates[4][3] = {
+	{1.12, 0.31, -0.22},
+	{0.05, -0.41, 0.13},
+	{-0.38, 0.47, 1.21},
+	{0.44, 1.52, 1.09}};
+
+static void FourierTorsionForce(double* interaction, double** coordinates, double** forces, double* energy)
+{
+	AdFourierTorsionForce(interaction, coordinates, forces, energy);
+}
+
+/**
+Compares the forces of \e force to the negative gradient of \e energy for the
+interaction \e interaction involving atoms 0 to 3.
+Returns the largest difference relative to the largest force component.
+*/
+static double ForceError(double* interaction, AdScalarEnergy energy, AdScalarForce force, double* forceEnergy)
+{
+	int i, j;
+	double plus, minus, gradient, error, maximumError, maximumForce;
+	double *coordinates[4], *forces[4];
+	double coordinateBuffer[4][3], forceBuffer[4][3];
+
+	memcpy(coordinateBuffer, torsionCoordinates, sizeof(coordinateBuffer));
+	memset(forceBuffer, 0, sizeof(forceBuffer));
+	for(i=0; i<4; i++)
+	{
+		coordinates[i] = coordinateBuffer[i];
+		forces[i] = forceBuffer[i];
+	}
+
+	*forceEnergy = 0;
+	force(interaction, coordinates, forces, forceEnergy);
+
+	maximumError = maximumForce = 0;
+	for(i=0; i<4; i++)
+		for(j=0; j<3; j++)
+		{
+			plus = minus = 0;
+			coordinates[i][j] += STEP;
+			energy(interaction, coordinates, &plus);
+			coordinates[i][j] -= 2*STEP;
+			energy(interaction, coordinates, &minus);
+			coordinates[i][j] += STEP;
+
+			gradient = (plus - minus)/(2*STEP);
+			error = fabs(forces[i][j] + gradient);
+			maximumError = fmax(error, maximumError);
+			maximumForce = fmax(fabs(forces[i][j]), maximumForce);
+		}
+
+	return maximumError/fmax(maximumForce, 1.0);
+}
+
+static void TestFourierTorsion(void)
+{
+	int i, j;
+	double error, energy, forceEnergy;
+	double periods[] = {1, 2, 3, 4, 6};
+	double phases[] = {0, M_PI, 0.7};
+	double interaction[7] = {0, 1, 2, 3, 1.7, 0, 0};
+	double* coordinates[4];
+
+	for(i=0; i<4; i++)
+		coordinates[i] = torsionCoordinates[i];
+
+	for(i=0; i<5; i++)
+		for(j=0; j<3; j++)
+		{
+			interaction[5] = periods[i];
+			interaction[6] = phases[j];
+			error = ForceError(interaction, AdFourierTorsionEnergy, FourierTorsionForce, &forceEnergy);
+			if(error > TOLERANCE)
+			{
+				fprintf(stderr, "FAILED: Fourier torsion force, period %g phase %g - relative error %g\n",
+					periods[i], phases[j], error);
+				failures++;
+			}
+
+			energy = 0;
+			AdFourierTorsionEnergy(interaction, coordinates, &energy);
+			if(fabs(energy - forceEnergy) > 1E-12)
+			{
+				fprintf(stderr, "FAILED: Fourier torsion energy, period %g phase %g - %g != %g\n",
+					periods[i], phases[j], forceEnergy, energy);
+				failures++;
+			}
+		}
+}
+
+static void TestImproperTorsion(void)
+{
+	int i;
+	double error, forceEnergy;
+	double equilibrium[] = {0, 0.35, 2.1};
+	double interaction[6] = {0, 1, 2, 3, 2.3, 0};
+
+	for(i=0; i<3; i++)
+	{
+		interaction[5] = equilibrium[i];
+		error = ForceError(interaction, AdHarmonicImproperTorsionEnergy,
+				AdHarmonicImproperTorsionForce, &forceEnergy);
+		if(error > TOLERANCE)
+		{
+			fprintf(stderr, "FAILED: Improper torsion force, equilibrium %g - relative error %g\n",
+				equilibrium[i], error);
+			failures++;
+		}
+	}
+}
+
+int main(void)
+{
+	TestFourierTorsion();
+	TestImproperTorsion();
+
+	if(failures == 0)
+		printf("AdBondedForceTest: passed\n");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+/*
+ * Compares the bonded kernels with the scalar functions they replace
+ * and checks the kernel forces against finite differences of the kernel energies.
+ * The number of interactions is not a multiple of the kernel block size
+ * so partial blocks and sub ranges are covered.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Base/AdForceFieldFunctions.h"
+#include "Base/AdBondedKernels.h"
+
+#define NUMBER_OF_ATOMS 60
+#define NUMBER_OF_INTERACTIONS 203
+#define STEP 1E-6
+
+static int failures = 0;
+
+typedef double (*AdKernel)(AdBondedTable*, int, int, double**, double**);
+typedef void (*AdScalarForce)(double*, double**, double**, double*);
+
+static double Random(double minimum, double maximum)
+{
+	return minimum + (maximum - minimum)*((double)rand()/RAND_MAX);
+}
+
+static void FourierTorsionForce(double* interaction, double** coordinates, double** forces, double* energy)
+{
+	AdFourierTorsionForce(interaction, coordinates, forces, energy);
+}
+
+static void ClearMatrix(AdMatrix* matrix)
+{
+	int i;
+
+	for(i=0; i<matrix->no_rows; i++)
+		memset(matrix->matrix[i], 0, matrix->no_columns*sizeof(double));
+}
+
+/**
+Creates \e number interactions of \e numberAtoms distinct atoms followed by the
+parameters returned by \e parameters.
+*/
+static AdMatrix* CreateInteractions(int numberAtoms, int numberParameters,
+	void (*parameters)(double*))
+{
+	int i, j, k, duplicate;
+	AdMatrix* interactions;
+
+	interactions = AdAllocateDoubleMatrix(NUMBER_OF_INTERACTIONS, numberAtoms + numberParameters);
+	for(i=0; i<NUMBER_OF_INTERACTIONS; i++)
+	{
+		for(j=0; j<numberAtoms; j++)
+			do
+			{
+				interactions->matrix[i][j] = rand() % NUMBER_OF_ATOMS;
+				for(duplicate = 0, k=0; k<j; k++)
+					if(interactions->matrix[i][k] == interactions->matrix[i][j])
+						duplicate = 1;
+			}
+			while(duplicate);
+
+		parameters(interactions->matrix[i] + numberAtoms);
+	}
+
+	return interactions;
+}
+
+static void BondParameters(double* parameters)
+{
+	parameters[0] = Random(100, 400);
+	parameters[1] = Random(1.0, 1.6);
+}
+
+static void AngleParameters(double* parameters)
+{
+	parameters[0] = Random(20, 80);
+	parameters[1] = Random(1.7, 2.1);
+}
+
+static void TorsionParameters(double* parameters)
+{
+	double phases[] = {0, M_PI, 0.4};
+
+	parameters[0] = Random(0.1, 3.0);
+	parameters[1] = 1 + rand() % AD_MAX_TORSION_PERIOD;
+	parameters[2] = phases[rand() % 3];
+}
+
+static void ImproperParameters(double* parameters)
+{
+	parameters[0] = Random(5, 40);
+	parameters[1] = Random(0, 0.5);
+}
+
+static double MaximumDifference(AdMatrix* a, AdMatrix* b, double* maximum)
+{
+	int i, j;
+	double difference = 0;
+
+	*maximum = 0;
+	for(i=0; i<a->no_rows; i++)
+		for(j=0; j<3; j++)
+		{
+			difference = fmax(difference, fabs(a->matrix[i][j] - b->matrix[i][j]));
+			*maximum = fmax(*maximum, fabs(a->matrix[i][j]));
+		}
+
+	return difference;
+}
+
+/**
+Evaluates \e table with \e kernel in three ranges and \e interactions with \e scalar and
+compares the energies and forces. Then compares the kernel forces of a few coordinates with
+central differences of the kernel energy.
+*/
+static void TestKernel(const char* name, AdMatrix* interactions, AdBondedTable* table,
+	AdKernel kernel, AdScalarForce scalar, AdMatrix* coordinates, double tolerance)
+{
+	int i, j, atom;
+	double kernelEnergy, scalarEnergy, plus, minus, gradient, difference, maximum;
+	AdMatrix *kernelForces, *scalarForces, *scratch;
+
+	kernelForces = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+	scalarForces = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+	scratch = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+	ClearMatrix(kernelForces);
+	ClearMatrix(scalarForces);
+
+	kernelEnergy = kernel(table, 0, 70, coordinates->matrix, kernelForces->matrix);
+	kernelEnergy += kernel(table, 70, 71, coordinates->matrix, kernelForces->matrix);
+	kernelEnergy += kernel(table, 71, NUMBER_OF_INTERACTIONS, coordinates->matrix, kernelForces->matrix);
+
+	scalarEnergy = 0;
+	for(i=0; i<interactions->no_rows; i++)
+		scalar(interactions->matrix[i], coordinates->matrix, scalarForces->matrix, &scalarEnergy);
+
+	if(fabs(kernelEnergy - scalarEnergy) > tolerance*fmax(fabs(scalarEnergy), 1.0))
+	{
+		fprintf(stderr, "FAILED: %s kernel energy %.12g scalar %.12g\n", name, kernelEnergy, scalarEnergy);
+		failures++;
+	}
+
+	difference = MaximumDifference(kernelForces, scalarForces, &maximum);
+	if(difference > tolerance*fmax(maximum, 1.0))
+	{
+		fprintf(stderr, "FAILED: %s kernel forces differ from scalar by %g (largest force %g)\n",
+			name, difference, maximum);
+		failures++;
+	}
+
+	for(atom=0; atom<NUMBER_OF_ATOMS; atom += 7)
+		for(j=0; j<3; j++)
+		{
+			coordinates->matrix[atom][j] += STEP;
+			plus = kernel(table, 0, NUMBER_OF_INTERACTIONS, coordinates->matrix, scratch->matrix);
+			coordinates->matrix[atom][j] -= 2*STEP;
+			minus = kernel(table, 0, NUMBER_OF_INTERACTIONS, coordinates->matrix, scratch->matrix);
+			coordinates->matrix[atom][j] += STEP;
+
+			gradient = (plus - minus)/(2*STEP);
+			if(fabs(kernelForces->matrix[atom][j] + gradient) > 1E-5*fmax(maximum, 1.0))
+			{
+				fprintf(stderr, "FAILED: %s kernel force on atom %d (%d) %g - finite difference %g\n",
+					name, atom, j, kernelForces->matrix[atom][j], -gradient);
+				failures++;
+			}
+		}
+
+	AdFreeDoubleMatrix(kernelForces);
+	AdFreeDoubleMatrix(scalarForces);
+	AdFreeDoubleMatrix(scratch);
+}
+
+int main(void)
+{
+	int i, j;
+	AdMatrix *coordinates, *bonds, *angles, *torsions, *impropers;
+	AdBondedTable *bondTable, *angleTable, *torsionTable, *improperTable;
+
+	srand(1234);
+	coordinates = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+	for(i=0; i<NUMBER_OF_ATOMS; i++)
+		for(j=0; j<3; j++)
+			coordinates->matrix[i][j] = Random(0, 8);
+
+	bonds = CreateInteractions(2, 2, BondParameters);
+	angles = CreateInteractions(3, 2, AngleParameters);
+	torsions = CreateInteractions(4, 3, TorsionParameters);
+	impropers = CreateInteractions(4, 2, ImproperParameters);
+
+	bondTable = AdCreateBondedTable(bonds, 2, 2);
+	angleTable = AdCreateBondedTable(angles, 3, 2);
+	torsionTable = AdCreateFourierTorsionTable(torsions);
+	improperTable = AdCreateBondedTable(impropers, 4, 2);
+	if(torsionTable == NULL)
+	{
+		fprintf(stderr, "FAILED: Could not create the torsion table\n");
+		return 1;
+	}
+
+	TestKernel("Bond", bonds, bondTable, AdEnzymixBondKernel, AdEnzymixBondForce, coordinates, 1E-10);
+	TestKernel("Angle", angles, angleTable, AdEnzymixAngleKernel, AdEnzymixAngleForce, coordinates, 1E-10);
+	TestKernel("Torsion", torsions, torsionTable, AdFourierTorsionKernel, FourierTorsionForce, coordinates, 1E-9);
+	TestKernel("Improper", impropers, improperTable, AdHarmonicImproperTorsionKernel,
+		AdHarmonicImproperTorsionForce, coordinates, 1E-8);
+
+	//Periods the kernel doesn't support are rejected
+	torsions->matrix[5][5] = 2.5;
+	if(AdCreateFourierTorsionTable(torsions) != NULL)
+	{
+		fprintf(stderr, "FAILED: Torsion table accepted a non integer period\n");
+		failures++;
+	}
+
+	AdFreeBondedTable(bondTable);
+	AdFreeBondedTable(angleTable);
+	AdFreeBondedTable(torsionTable);
+	AdFreeBondedTable(improperTable);
+	AdFreeDoubleMatrix(bonds);
+	AdFreeDoubleMatrix(angles);
+	AdFreeDoubleMatrix(torsions);
+	AdFreeDoubleMatrix(impropers);
+	AdFreeDoubleMatrix(coordinates);
+
+	if(failures == 0)
+		printf("AdBondedKernelTest: passed\n");
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,320 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+/*
+ * Compares the AVX2 and AVX-512 nonbonded kernels with the scalar pair list functions
+ * for each electrostatic and lennard jones type, with and without a periodic box.
+ * The list contains pairs beyond the cutoff and the elements have numbers of partners
+ * which are not multiples of the batch sizes so the masking and partial batches are covered.
+ * Kernel sets the cpu does not support are skipped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Base/AdForceFieldFunctions.h"
+#include "Base/AdNonbondedKernels.h"
+
+#define LATTICE_SIZE 7
+#define NUMBER_OF_ATOMS (LATTICE_SIZE*LATTICE_SIZE*LATTICE_SIZE)
+#define SPACING 3.0
+#define CUTOFF 9.0
+#define LIST_CUTOFF 10.4
+#define EPSILON_RP 332.0637
+#define GRF_B0 0.4
+#define GRF_B1 -0.75
+#define TOLERANCE 1E-10
+
+static int failures = 0;
+
+static double Random(double minimum, double maximum)
+{
+	return minimum + (maximum - minimum)*((double)rand()/RAND_MAX);
+}
+
+static void ClearMatrix(AdMatrix* matrix)
+{
+	int i;
+
+	for(i=0; i<matrix->no_rows; i++)
+		memset(matrix->matrix[i], 0, matrix->no_columns*sizeof(double));
+}
+
+/**
+Creates a list of all pairs separated by less than LIST_CUTOFF.
+If \e box is not NULL the separation to the nearest image is used.
+*/
+static AdPairList* CreatePairList(AdMatrix* coordinates, AdPeriodicBox* box)
+{
+	int i, j, k, count;
+	int partners[NUMBER_OF_ATOMS];
+	double separation[3];
+	AdPairList* list;
+
+	list = AdAllocatePairList(NUMBER_OF_ATOMS, 1024);
+	for(i=0; i<NUMBER_OF_ATOMS; i++)
+	{
+		for(count = 0, j=i+1; j<NUMBER_OF_ATOMS; j++)
+		{
+			for(k=0; k<3; k++)
+				separation[k] = coordinates->matrix[i][k] - coordinates->matrix[j][k];
+
+			if(box != NULL)
+				AdMinimumImage(separation, box);
+
+			if(separation[0]*separation[0] + separation[1]*separation[1] 
+				+ separation[2]*separation[2] < LIST_CUTOFF*LIST_CUTOFF)
+				partners[count++] = j;
+		}
+
+		AdPairListAppendElement(list, i, partners, count);
+	}
+	AdPairListFinalise(list);
+	AdPairListSetPeriodicBox(list, box);
+
+	return list;
+}
+
+/**
+Sets the parameters of each pair in \e list for lennard jones type \e type.
+*/
+static void SetParameters(AdPairList* list, char type)
+{
+	int i;
+
+	srand(99);
+	for(i=0; i<list->numberOfPairs; i++)
+	{
+		if(type == 'A')
+		{
+			list->paramOne[i] = Random(2E5, 8E5);
+			list->paramTwo[i] = Random(200, 800);
+		}
+		else
+		{
+			list->paramOne[i] = Random(0.05, 0.3);
+			list->paramTwo[i] = Random(3.0, 4.0);
+		}
+		list->chargeProducts[i] = Random(-0.8, 0.8);
+	}
+}
+
+/**
+Calls the pair list function for \e electrostatics and \e type.
+The force function is used if \e forces is not NULL.
+*/
+static void Evaluate(AdElectrostaticsType electrostatics, char type, AdPairList* list, 
+	AdMatrix* coordinates, AdMatrix* forces, double* vdw, double* est)
+{
+	double** f = (forces == NULL) ? NULL : forces->matrix;
+	double** c = coordinates->matrix;
+
+	*vdw = *est = 0;
+	switch(electrostatics)
+	{
+		case AdCoulombElectrostatics:
+			if(type == 'A')
+			{
+				if(f == NULL)
+					AdCoulombAndLennardJonesAPairListEnergy(list, c, EPSILON_RP, CUTOFF, vdw, est);
+				else
+					AdCoulombAndLennardJonesAPairListForce(list, c, f, EPSILON_RP, CUTOFF, vdw, est);
+			}
+			else
+			{
+				if(f == NULL)
+					AdCoulombAndLennardJonesBPairListEnergy(list, c, EPSILON_RP, CUTOFF, vdw, est);
+				else
+					AdCoulombAndLennardJonesBPairListForce(list, c, f, EPSILON_RP, CUTOFF, vdw, est);
+			}
+			break;
+		case AdShiftedCoulombElectrostatics:
+			if(type == 'A')
+			{
+				if(f == NULL)
+					AdShiftedCoulombAndLennardJonesAPairListEnergy(list, c, EPSILON_RP, 
+						CUTOFF, 1/(CUTOFF*CUTOFF), vdw, est);
+				else
+					AdShiftedCoulombAndLennardJonesAPairListForce(list, c, f, EPSILON_RP, 
+						CUTOFF, 1/(CUTOFF*CUTOFF), vdw, est);
+			}
+			else
+			{
+				if(f == NULL)
+					AdShiftedCoulombAndLennardJonesBPairListEnergy(list, c, EPSILON_RP, 
+						CUTOFF, 1/(CUTOFF*CUTOFF), vdw, est);
+				else
+					AdShiftedCoulombAndLennardJonesBPairListForce(list, c, f, EPSILON_RP, 
+						CUTOFF, 1/(CUTOFF*CUTOFF), vdw, est);
+			}
+			break;
+		case AdGRFCoulombElectrostatics:
+			if(type == 'A')
+			{
+				if(f == NULL)
+					AdGRFCoulombAndLennardJonesAPairListEnergy(list, c, EPSILON_RP, 
+						CUTOFF, GRF_B0, GRF_B1, vdw, est);
+				else
+					AdGRFCoulombAndLennardJonesAPairListForce(list, c, f, EPSILON_RP, 
+						CUTOFF, GRF_B0, GRF_B1, vdw, est);
+			}
+			else
+			{
+				if(f == NULL)
+					AdGRFCoulombAndLennardJonesBPairListEnergy(list, c, EPSILON_RP, 
+						CUTOFF, GRF_B0, GRF_B1, vdw, est);
+				else
+					AdGRFCoulombAndLennardJonesBPairListForce(list, c, f, EPSILON_RP, 
+						CUTOFF, GRF_B0, GRF_B1, vdw, est);
+			}
+			break;
+	}
+}
+
+static int Differs(double value, double reference)
+{
+	return fabs(value - reference) > TOLERANCE*fmax(fabs(reference), 1.0);
+}
+
+/**
+Compares the energies and forces calculated with \e kernelSet to the scalar functions
+for every electrostatic and lennard jones type.
+*/
+static void TestKernelSet(AdNonbondedKernelSet kernelSet, AdPairList* list, AdMatrix* coordinates, 
+	const char* boxName)
+{
+	int i, j, k;
+	char types[] = {'A', 'B'};
+	const char* electrostaticsNames[] = {"Coulomb", "Shifted", "GRF"};
+	double vdw, est, vectorVdw, vectorEst, forceVdw, forceEst, difference, maximum;
+	AdMatrix *scalarForces, *vectorForces;
+
+	scalarForces = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+	vectorForces = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+
+	for(k=0; k<2; k++)
+	{
+		SetParameters(list, types[k]);
+		for(i=AdCoulombElectrostatics; i<=AdGRFCoulombElectrostatics; i++)
+		{
+			AdSetNonbondedKernels(AdScalarNonbondedKernels);
+			Evaluate(i, types[k], list, coordinates, NULL, &vdw, &est);
+			ClearMatrix(scalarForces);
+			Evaluate(i, types[k], list, coordinates, scalarForces, &forceVdw, &forceEst);
+
+			AdSetNonbondedKernels(kernelSet);
+			Evaluate(i, types[k], list, coordinates, NULL, &vectorVdw, &vectorEst);
+			if(Differs(vectorVdw, vdw) || Differs(vectorEst, est))
+			{
+				fprintf(stderr, "FAILED: %s %s %c (%s) energy - vdw %.12g est %.12g, scalar %.12g %.12g\n",
+					AdNonbondedKernelsName(kernelSet), electrostaticsNames[i], types[k], boxName,
+					vectorVdw, vectorEst, vdw, est);
+				failures++;
+			}
+
+			ClearMatrix(vectorForces);
+			Evaluate(i, types[k], list, coordinates, vectorForces, &vectorVdw, &vectorEst);
+			if(Differs(vectorVdw, forceVdw) || Differs(vectorEst, forceEst))
+			{
+				fprintf(stderr, "FAILED: %s %s %c (%s) force energy - vdw %.12g est %.12g, scalar %.12g %.12g\n",
+					AdNonbondedKernelsName(kernelSet), electrostaticsNames[i], types[k], boxName,
+					vectorVdw, vectorEst, forceVdw, forceEst);
+				failures++;
+			}
+
+			for(difference = maximum = 0, j=0; j<NUMBER_OF_ATOMS; j++)
+			{
+				difference = fmax(difference, fabs(vectorForces->matrix[j][0] - scalarForces->matrix[j][0]));
+				difference = fmax(difference, fabs(vectorForces->matrix[j][1] - scalarForces->matrix[j][1]));
+				difference = fmax(difference, fabs(vectorForces->matrix[j][2] - scalarForces->matrix[j][2]));
+				maximum = fmax(maximum, fabs(scalarForces->matrix[j][0]));
+				maximum = fmax(maximum, fabs(scalarForces->matrix[j][1]));
+				maximum = fmax(maximum, fabs(scalarForces->matrix[j][2]));
+			}
+
+			if(difference > TOLERANCE*fmax(maximum, 1.0))
+			{
+				fprintf(stderr, "FAILED: %s %s %c (%s) forces differ from scalar by %g (largest force %g)\n",
+					AdNonbondedKernelsName(kernelSet), electrostaticsNames[i], types[k], boxName,
+					difference, maximum);
+				failures++;
+			}
+		}
+	}
+
+	AdFreeDoubleMatrix(scalarForces);
+	AdFreeDoubleMatrix(vectorForces);
+}
+
+int main(void)
+{
+	int i, j, k, index;
+	double centre[3], lengths[3];
+	AdNonbondedKernelSet kernelSets[] = {AdAVX2NonbondedKernels, AdAVX512NonbondedKernels};
+	AdMatrix* coordinates;
+	AdPairList* list, *periodicList;
+	AdPeriodicBox box;
+
+	//A jittered lattice so no two atoms are very close
+	srand(4321);
+	coordinates = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+	for(index=0, i=0; i<LATTICE_SIZE; i++)
+		for(j=0; j<LATTICE_SIZE; j++)
+			for(k=0; k<LATTICE_SIZE; k++, index++)
+			{
+				coordinates->matrix[index][0] = SPACING*i + Random(-0.4, 0.4);
+				coordinates->matrix[index][1] = SPACING*j + Random(-0.4, 0.4);
+				coordinates->matrix[index][2] = SPACING*k + Random(-0.4, 0.4);
+			}
+
+	for(i=0; i<3; i++)
+	{
+		lengths[i] = SPACING*LATTICE_SIZE;
+		centre[i] = 0.5*SPACING*(LATTICE_SIZE - 1);
+	}
+	AdInitialisePeriodicBox(&box, centre, lengths);
+
+	list = CreatePairList(coordinates, NULL);
+	periodicList = CreatePairList(coordinates, &box);
+
+	for(i=0; i<2; i++)
+	{
+		if(AdSetNonbondedKernels(kernelSets[i]) != kernelSets[i])
+		{
+			printf("AdNonbondedKernelTest: %s is not supported - skipped\n", 
+				AdNonbondedKernelsName(kernelSets[i]));
+			continue;
+		}
+
+		TestKernelSet(kernelSets[i], list, coordinates, "no box");
+		TestKernelSet(kernelSets[i], periodicList, coordinates, "periodic");
+	}
+
+	AdFreePairList(list);
+	AdFreePairList(periodicList);
+	AdFreeDoubleMatrix(coordinates);
+
+	if(failures == 0)
+		printf("AdNonbondedKernelTest: passed\n");
+
+	return failures == 0 ? 0 : 1;
+}
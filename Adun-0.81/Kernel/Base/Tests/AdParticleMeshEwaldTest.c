@@ -0,0 +1,264 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+/*
+ * Compares the particle mesh Ewald reciprocal space energy and forces with a 
+ * direct sum over the reciprocal lattice vectors (a plain Ewald sum) for a small neutral system.
+ * Then checks the total electrostatic energy - real space, reciprocal space and self energy -
+ * does not depend on the Ewald coefficient.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Base/AdForceFieldFunctions.h"
+#include "Base/AdParticleMeshEwald.h"
+
+#define NUMBER_OF_ATOMS 40
+#define BOX_LENGTH 20.0
+#define CUTOFF 9.0
+#define GRID_SIZE 40
+#define SPLINE_ORDER 6
+#define MAXIMUM_WAVE_NUMBER 14
+#define EPSILON_RP 332.0637
+
+static int failures = 0;
+
+static double Random(double minimum, double maximum)
+{
+	return minimum + (maximum - minimum)*((double)rand()/RAND_MAX);
+}
+
+static void ClearMatrix(AdMatrix* matrix)
+{
+	int i;
+
+	for(i=0; i<matrix->no_rows; i++)
+		memset(matrix->matrix[i], 0, matrix->no_columns*sizeof(double));
+}
+
+/**
+Calculates the reciprocal space energy of the Ewald sum directly by summing over
+the reciprocal lattice vectors with components up to MAXIMUM_WAVE_NUMBER/BOX_LENGTH.
+The forces are added to \e forces.
+*/
+static double EwaldReciprocalSpace(AdMatrix* coordinates, double* charges, AdMatrix* forces, 
+	double ewaldCoefficient)
+{
+	int i, kx, ky, kz;
+	double m[3], mSquared, factor, volume, energy, structureReal, structureImaginary;
+	double phase, holder;
+	double phases[NUMBER_OF_ATOMS];
+
+	volume = BOX_LENGTH*BOX_LENGTH*BOX_LENGTH;
+	energy = 0;
+	for(kx = -MAXIMUM_WAVE_NUMBER; kx <= MAXIMUM_WAVE_NUMBER; kx++)
+		for(ky = -MAXIMUM_WAVE_NUMBER; ky <= MAXIMUM_WAVE_NUMBER; ky++)
+			for(kz = -MAXIMUM_WAVE_NUMBER; kz <= MAXIMUM_WAVE_NUMBER; kz++)
+			{
+				if(kx == 0 && ky == 0 && kz == 0)
+					continue;
+
+				m[0] = kx/BOX_LENGTH;
+				m[1] = ky/BOX_LENGTH;
+				m[2] = kz/BOX_LENGTH;
+				mSquared = m[0]*m[0] + m[1]*m[1] + m[2]*m[2];
+				factor = EPSILON_RP*exp(-M_PI*M_PI*mSquared/(ewaldCoefficient*ewaldCoefficient))
+						/(2*M_PI*volume*mSquared);
+
+				structureReal = structureImaginary = 0;
+				for(i=0; i<NUMBER_OF_ATOMS; i++)
+				{
+					phases[i] = 2*M_PI*(m[0]*coordinates->matrix[i][0] 
+							+ m[1]*coordinates->matrix[i][1]
+							+ m[2]*coordinates->matrix[i][2]);
+					structureReal += charges[i]*cos(phases[i]);
+					structureImaginary += charges[i]*sin(phases[i]);
+				}
+
+				energy += factor*(structureReal*structureReal + structureImaginary*structureImaginary);
+
+				//The derivative of |S(m)|^2 with respect to the position of atom i 
+				//is -4PI m q_i Im(exp(i phase_i) S*(m)) 
+				for(i=0; i<NUMBER_OF_ATOMS; i++)
+				{
+					phase = phases[i];
+					holder = 4*M_PI*factor*charges[i]
+						*(sin(phase)*structureReal - cos(phase)*structureImaginary);
+					forces->matrix[i][0] += holder*m[0];
+					forces->matrix[i][1] += holder*m[1];
+					forces->matrix[i][2] += holder*m[2];
+				}
+			}
+
+	return energy;
+}
+
+static AdPMEGrid* CreateGrid(AdPeriodicBox* box, double ewaldCoefficient)
+{
+	int gridSize[3];
+
+	gridSize[0] = gridSize[1] = gridSize[2] = AdPMEGridSize(GRID_SIZE);
+	return AdAllocatePMEGrid(NUMBER_OF_ATOMS, box, gridSize, SPLINE_ORDER, ewaldCoefficient);
+}
+
+static void TestReciprocalSpace(AdMatrix* coordinates, double* charges, AdPeriodicBox* box)
+{
+	int i, j;
+	double ewaldCoefficient, pmeEnergy, ewaldEnergy, difference, maximum;
+	AdMatrix *pmeForces, *ewaldForces;
+	AdPMEGrid* pme;
+
+	pmeForces = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+	ewaldForces = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+	ClearMatrix(pmeForces);
+	ClearMatrix(ewaldForces);
+
+	ewaldCoefficient = AdEwaldCoefficient(CUTOFF, 1E-5);
+	pme = CreateGrid(box, ewaldCoefficient);
+	pmeEnergy = AdPMEReciprocalSpace(pme, coordinates->matrix, charges, pmeForces->matrix, EPSILON_RP);
+	ewaldEnergy = EwaldReciprocalSpace(coordinates, charges, ewaldForces, ewaldCoefficient);
+
+	if(fabs(pmeEnergy - ewaldEnergy) > 1E-5*fabs(ewaldEnergy))
+	{
+		fprintf(stderr, "FAILED: PME reciprocal energy %.10g Ewald %.10g\n", pmeEnergy, ewaldEnergy);
+		failures++;
+	}
+
+	for(difference = maximum = 0, i=0; i<NUMBER_OF_ATOMS; i++)
+		for(j=0; j<3; j++)
+		{
+			difference = fmax(difference, fabs(pmeForces->matrix[i][j] - ewaldForces->matrix[i][j]));
+			maximum = fmax(maximum, fabs(ewaldForces->matrix[i][j]));
+		}
+
+	if(difference > 1E-4*maximum)
+	{
+		fprintf(stderr, "FAILED: PME reciprocal forces differ from Ewald by %g (largest force %g)\n",
+			difference, maximum);
+		failures++;
+	}
+
+	AdFreePMEGrid(pme);
+	AdFreeDoubleMatrix(pmeForces);
+	AdFreeDoubleMatrix(ewaldForces);
+}
+
+/**
+Returns the total electrostatic energy calculated using the Ewald coefficient
+for which erfc at the cutoff is \e tolerance.
+*/
+static double TotalEnergy(AdMatrix* coordinates, double* charges, AdPeriodicBox* box, 
+	AdPairList* list, double tolerance)
+{
+	double ewaldCoefficient, vdw, est, energy;
+	AdPMEGrid* pme;
+
+	ewaldCoefficient = AdEwaldCoefficient(CUTOFF, tolerance);
+	vdw = est = 0;
+	AdEwaldCoulombAndLennardJonesAPairListEnergy(list, coordinates->matrix, EPSILON_RP, 
+		CUTOFF, ewaldCoefficient, &vdw, &est);
+
+	pme = CreateGrid(box, ewaldCoefficient);
+	energy = est + AdPMEReciprocalSpace(pme, coordinates->matrix, charges, NULL, EPSILON_RP);
+	energy += AdEwaldSelfEnergy(charges, NUMBER_OF_ATOMS, box, ewaldCoefficient, EPSILON_RP);
+	AdFreePMEGrid(pme);
+
+	return energy;
+}
+
+static void TestSplitting(AdMatrix* coordinates, double* charges, AdPeriodicBox* box)
+{
+	int i, j, count;
+	int partners[NUMBER_OF_ATOMS];
+	double low, high;
+	AdPairList* list;
+
+	//All pairs - the lennard jones parameters are zero so only the electrostatic energy is calculated
+	list = AdAllocatePairList(NUMBER_OF_ATOMS, NUMBER_OF_ATOMS*NUMBER_OF_ATOMS/2);
+	for(i=0; i<NUMBER_OF_ATOMS; i++)
+	{
+		for(count = 0, j=i+1; j<NUMBER_OF_ATOMS; j++)
+			partners[count++] = j;
+
+		AdPairListAppendElement(list, i, partners, count);
+	}
+	AdPairListFinalise(list);
+	AdPairListSetPeriodicBox(list, box);
+	for(i=0; i<NUMBER_OF_ATOMS; i++)
+		for(j=list->offsets[i]; j<list->offsets[i+1]; j++)
+		{
+			list->paramOne[j] = list->paramTwo[j] = 0;
+			list->chargeProducts[j] = charges[i]*charges[list->neighbours[j]];
+		}
+
+	low = TotalEnergy(coordinates, charges, box, list, 1E-5);
+	high = TotalEnergy(coordinates, charges, box, list, 1E-7);
+	if(fabs(low - high) > 2E-5*fabs(high))
+	{
+		fprintf(stderr, "FAILED: Total energy depends on the Ewald coefficient - %.10g %.10g\n", low, high);
+		failures++;
+	}
+
+	AdFreePairList(list);
+}
+
+int main(void)
+{
+	int i, j;
+	double sum, centre[3], lengths[3];
+	double charges[NUMBER_OF_ATOMS];
+	AdMatrix* coordinates;
+	AdPeriodicBox box;
+
+	srand(2468);
+	coordinates = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+	for(sum = 0, i=0; i<NUMBER_OF_ATOMS; i++)
+	{
+		for(j=0; j<3; j++)
+			coordinates->matrix[i][j] = Random(0, BOX_LENGTH);
+
+		charges[i] = Random(-1, 1);
+		sum += charges[i];
+	}
+
+	//Neutralise the system
+	for(i=0; i<NUMBER_OF_ATOMS; i++)
+		charges[i] -= sum/NUMBER_OF_ATOMS;
+
+	for(i=0; i<3; i++)
+	{
+		centre[i] = 0.5*BOX_LENGTH;
+		lengths[i] = BOX_LENGTH;
+	}
+	AdInitialisePeriodicBox(&box, centre, lengths);
+
+	TestReciprocalSpace(coordinates, charges, &box);
+	TestSplitting(coordinates, charges, &box);
+
+	AdFreeDoubleMatrix(coordinates);
+
+	if(failures == 0)
+		printf("AdParticleMeshEwaldTest: passed\n");
+
+	return failures == 0 ? 0 : 1;
+}
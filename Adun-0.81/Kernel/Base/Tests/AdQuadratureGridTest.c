@@ -0,0 +1,192 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+/*
+ * Checks the AdSmoothedGBTerm integration grid.
+ * A generated grid must survive being written and read unchanged and the 
+ * cache shipped in AdunKernel/Resources/GBSWData must match the generated grid.
+ * Grids for start points which are equal to two decimal places must differ.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Base/AdQuadratureFunctions.h"
+
+#define RADIAL_POINTS 24
+#define ANGULAR_POINTS 38
+#define CACHE_FILE "../../AdunKernel/Resources/GBSWData/Quadrature-24-38-0.50.bin"
+
+static int failures = 0;
+
+static void TestGeneratedGrid(AdQuadratureGrid* grid)
+{
+	int i, j, index;
+	double sum, error;
+
+	for(sum = 0, i=0; i<ANGULAR_POINTS; i++)
+		sum += grid->angularWeights[i];
+
+	if(fabs(sum - 4*M_PI) > 1E-12)
+	{
+		fprintf(stderr, "FAILED: Angular weights sum to %.15g not 4PI\n", sum);
+		failures++;
+	}
+
+	//The radial weights integrate 1 over the range start point to 20
+	for(sum = 0, i=0; i<RADIAL_POINTS; i++)
+		sum += grid->radialWeights[i];
+
+	if(fabs(sum - 19.5) > 1E-8)
+	{
+		fprintf(stderr, "FAILED: Radial weights sum to %.15g not 19.5\n", sum);
+		failures++;
+	}
+
+	for(i=1; i<RADIAL_POINTS; i++)
+		if(grid->radialDistances[i] <= grid->radialDistances[i-1])
+		{
+			fprintf(stderr, "FAILED: Radial distances are not increasing at shell %d\n", i);
+			failures++;
+		}
+
+	for(error = 0, index = 0, i=0; i<RADIAL_POINTS; i++)
+		for(j=0; j<ANGULAR_POINTS; j++, index++)
+		{
+			error = fmax(error, fabs(grid->pointsX[index] - grid->radialDistances[i]*grid->angularX[j]));
+			error = fmax(error, fabs(grid->pointsY[index] - grid->radialDistances[i]*grid->angularY[j]));
+			error = fmax(error, fabs(grid->pointsZ[index] - grid->radialDistances[i]*grid->angularZ[j]));
+		}
+
+	if(error != 0)
+	{
+		fprintf(stderr, "FAILED: Integration points differ from the scaled angular points by %g\n", error);
+		failures++;
+	}
+}
+
+static void TestWriteAndRead(AdQuadratureGrid* grid)
+{
+	int numberPoints;
+	FILE* file;
+	AdQuadratureGrid* readGrid;
+
+	file = tmpfile();
+	if(file == NULL || AdWriteQuadratureGrid(grid, file) != 0)
+	{
+		fprintf(stderr, "FAILED: Could not write the grid\n");
+		failures++;
+		return;
+	}
+
+	rewind(file);
+	readGrid = AdReadQuadratureGrid(file);
+	fclose(file);
+	if(readGrid == NULL)
+	{
+		fprintf(stderr, "FAILED: Could not read the written grid\n");
+		failures++;
+		return;
+	}
+
+	numberPoints = RADIAL_POINTS*ANGULAR_POINTS;
+	if(AdQuadratureGridDifference(grid, readGrid) != 0 
+		|| memcmp(grid->pointsX, readGrid->pointsX, 3*numberPoints*sizeof(double)) != 0)
+	{
+		fprintf(stderr, "FAILED: Written and read grid differs from the generated grid\n");
+		failures++;
+	}
+
+	AdFreeQuadratureGrid(readGrid);
+}
+
+static void TestCache(AdQuadratureGrid* grid)
+{
+	double difference;
+	FILE* file;
+	AdQuadratureGrid* cachedGrid;
+
+	file = fopen(CACHE_FILE, "rb");
+	if(file == NULL)
+	{
+		fprintf(stderr, "FAILED: Could not open %s\n", CACHE_FILE);
+		failures++;
+		return;
+	}
+
+	cachedGrid = AdReadQuadratureGrid(file);
+	fclose(file);
+	if(cachedGrid == NULL)
+	{
+		fprintf(stderr, "FAILED: %s does not contain a grid\n", CACHE_FILE);
+		failures++;
+		return;
+	}
+
+	//The roots of the legendre polynomials are found numerically so the cache
+	//may differ from a grid generated on another machine in the last few digits
+	difference = AdQuadratureGridDifference(grid, cachedGrid);
+	if(difference > 1E-8)
+	{
+		fprintf(stderr, "FAILED: Cached grid differs from the generated grid by %g\n", difference);
+		failures++;
+	}
+
+	AdFreeQuadratureGrid(cachedGrid);
+}
+
+int main(void)
+{
+	AdQuadratureGrid* grid, *nearbyGrid;
+
+	grid = AdCreateSmoothedGBQuadratureGrid(RADIAL_POINTS, ANGULAR_POINTS, 0.5);
+	if(grid == NULL)
+	{
+		fprintf(stderr, "FAILED: Could not create the grid\n");
+		return 1;
+	}
+
+	TestGeneratedGrid(grid);
+	TestWriteAndRead(grid);
+	TestCache(grid);
+
+	nearbyGrid = AdCreateSmoothedGBQuadratureGrid(RADIAL_POINTS, ANGULAR_POINTS, 0.504);
+	if(AdQuadratureGridDifference(grid, nearbyGrid) < 1E-3)
+	{
+		fprintf(stderr, "FAILED: Grids for start points 0.5 and 0.504 are the same\n");
+		failures++;
+	}
+
+	if(AdCreateSmoothedGBQuadratureGrid(RADIAL_POINTS, 20, 0.5) != NULL)
+	{
+		fprintf(stderr, "FAILED: Created a grid with an unsupported number of angular points\n");
+		failures++;
+	}
+
+	AdFreeQuadratureGrid(grid);
+	AdFreeQuadratureGrid(nearbyGrid);
+
+	if(failures == 0)
+		printf("AdQuadratureGridTest: passed\n");
+
+	return failures == 0 ? 0 : 1;
+}
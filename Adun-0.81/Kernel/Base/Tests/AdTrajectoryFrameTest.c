@@ -0,0 +1,386 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+/*
+ * Writes binary trajectory frames and reads them back.
+ * Covers the current layout, version 1 frames with and without padding,
+ * frames with the opposite byte order and rejection of malformed frames.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "Base/AdTrajectoryFrame.h"
+
+#define NUMBER_OF_ROWS 7
+#define PRECISION 1000.0
+
+static int failures = 0;
+
+#define CHECK(condition, message) \
+	do { if(!(condition)) { fprintf(stderr, "FAILED: %s (line %d)\n", message, __LINE__); failures++; } } while(0)
+
+static void FillMatrix(AdMatrix* matrix, double offset)
+{
+	int i, j;
+
+	for(i=0; i<matrix->no_rows; i++)
+		for(j=0; j<3; j++)
+			matrix->matrix[i][j] = offset + 1.37*i - 0.71*j + 0.001*(i*j);
+}
+
+static double MaximumDifference(AdMatrix* a, AdMatrix* b)
+{
+	int i, j;
+	double difference, maximum = 0;
+
+	for(i=0; i<a->no_rows; i++)
+		for(j=0; j<3; j++)
+		{
+			difference = fabs(a->matrix[i][j] - b->matrix[i][j]);
+			if(difference > maximum)
+				maximum = difference;
+		}
+
+	return maximum;
+}
+
+static void WriteUInt32(unsigned char* buffer, uint32_t value)
+{
+	memcpy(buffer, &value, sizeof(uint32_t));
+}
+
+/**
+Writes a frame with two systems. "Protein" has float64 coordinates and
+compressed velocities, "Solvent" has float32 coordinates only.
+*/
+static size_t WriteFrame(AdMatrix* coordinates, AdMatrix* velocities, AdMatrix* solvent, unsigned char* frame)
+{
+	size_t size;
+
+	size = AdWriteTrajectoryFrameHeader(frame, 2);
+	size += AdWriteTrajectoryFrameSystemHeader(frame + size, "Protein", 7, 3);
+	size += AdEncodeTrajectoryFrameBlock(coordinates, AdFrameFloat64Encoding, PRECISION, frame + size);
+	size += AdEncodeTrajectoryFrameBlock(velocities, AdFrameCompressedEncoding, PRECISION, frame + size);
+	size += AdWriteTrajectoryFrameSystemHeader(frame + size, "Solvent", 7, 1);
+	size += AdEncodeTrajectoryFrameBlock(solvent, AdFrameFloat32Encoding, PRECISION, frame + size);
+
+	return size;
+}
+
+/**
+Rewrites the current frame \e frame in the version 1 layout. If \e padded is 0 the
+names and payloads are not padded and the mask follows the name.
+*/
+static size_t WriteVersion1Frame(const unsigned char* frame, size_t length, int padded, unsigned char* buffer)
+{
+	unsigned int i, j, numberOfSystems, mask, numberOfBlocks;
+	uint32_t nameLength, payloadSize;
+	size_t position, size, blockSize;
+	int numberOfRows;
+
+	memcpy(buffer, frame, AD_TRAJECTORY_FRAME_HEADER_SIZE);
+	WriteUInt32(buffer + sizeof(uint32_t), 1);
+	memcpy(&numberOfSystems, frame + 2*sizeof(uint32_t), sizeof(uint32_t));
+	position = size = AD_TRAJECTORY_FRAME_HEADER_SIZE;
+	for(i=0; i<numberOfSystems; i++)
+	{
+		memcpy(&nameLength, frame + position, sizeof(uint32_t));
+		memcpy(&mask, frame + position + sizeof(uint32_t), sizeof(uint32_t));
+		if(padded)
+		{
+			memcpy(buffer + size, frame + position, AdTrajectoryFrameSystemHeaderSize(nameLength));
+			size += AdTrajectoryFrameSystemHeaderSize(nameLength);
+		}
+		else
+		{
+			WriteUInt32(buffer + size, nameLength);
+			memcpy(buffer + size + sizeof(uint32_t), frame + position + 2*sizeof(uint32_t), nameLength);
+			WriteUInt32(buffer + size + sizeof(uint32_t) + nameLength, mask);
+			size += 2*sizeof(uint32_t) + nameLength;
+		}
+
+		position += AdTrajectoryFrameSystemHeaderSize(nameLength);
+		for(numberOfBlocks = 0, j=0; j<32; j++)
+			if(mask & (1u << j))
+				numberOfBlocks++;
+
+		for(j=0; j<numberOfBlocks; j++)
+		{
+			blockSize = AdTrajectoryFrameBlockInfo(frame + position, length - position, &numberOfRows);
+			if(padded)
+			{
+				memcpy(buffer + size, frame + position, blockSize);
+				size += blockSize;
+			}
+			else
+			{
+				memcpy(&payloadSize, frame + position + 2*sizeof(uint32_t), sizeof(uint32_t));
+				memcpy(buffer + size, frame + position, 3*sizeof(uint32_t));
+				memcpy(buffer + size + 3*sizeof(uint32_t), frame + position + 4*sizeof(uint32_t), payloadSize);
+				size += 3*sizeof(uint32_t) + payloadSize;
+			}
+
+			position += blockSize;
+		}
+	}
+
+	return size;
+}
+
+static void SwapValues(unsigned char* buffer, size_t size, size_t number)
+{
+	size_t i, j;
+	unsigned char byte;
+
+	for(i=0; i<number; i++)
+		for(j=0; j<size/2; j++)
+		{
+			byte = buffer[i*size + j];
+			buffer[i*size + j] = buffer[i*size + size - j - 1];
+			buffer[i*size + size - j - 1] = byte;
+		}
+}
+
+/**
+Reverses the byte order of the current frame \e frame in place as if it was
+written on a machine with the opposite byte order.
+*/
+static void SwapFrame(unsigned char* frame, size_t length)
+{
+	unsigned int i, j, numberOfSystems, mask;
+	uint32_t nameLength, encoding, payloadSize;
+	size_t position;
+
+	memcpy(&numberOfSystems, frame + 2*sizeof(uint32_t), sizeof(uint32_t));
+	SwapValues(frame + sizeof(uint32_t), sizeof(uint32_t), 3);
+	position = AD_TRAJECTORY_FRAME_HEADER_SIZE;
+	for(i=0; i<numberOfSystems; i++)
+	{
+		memcpy(&nameLength, frame + position, sizeof(uint32_t));
+		memcpy(&mask, frame + position + sizeof(uint32_t), sizeof(uint32_t));
+		SwapValues(frame + position, sizeof(uint32_t), 2);
+		position += AdTrajectoryFrameSystemHeaderSize(nameLength);
+		for(j=0; j<32; j++)
+		{
+			if(!(mask & (1u << j)))
+				continue;
+
+			memcpy(&encoding, frame + position, sizeof(uint32_t));
+			memcpy(&payloadSize, frame + position + 2*sizeof(uint32_t), sizeof(uint32_t));
+			SwapValues(frame + position, sizeof(uint32_t), 4);
+			if(encoding == AdFrameFloat64Encoding)
+				SwapValues(frame + position + 16, sizeof(double), payloadSize/sizeof(double));
+			else if(encoding == AdFrameFloat32Encoding)
+				SwapValues(frame + position + 16, sizeof(float), payloadSize/sizeof(float));
+			else
+			{
+				SwapValues(frame + position + 16, sizeof(double), 1);
+				SwapValues(frame + position + 16 + sizeof(double), sizeof(uint32_t), 6);
+			}
+
+			position += 16 + ((payloadSize + 7) & ~7u);
+		}
+	}
+}
+
+/**
+Reads the systems of the current frame \e frame and compares them to the matrices written.
+*/
+static void ReadFrame(const unsigned char* frame, size_t length,
+	AdMatrix* coordinates, AdMatrix* velocities, AdMatrix* solvent, const char* label)
+{
+	int elements[2] = {5, 1};
+	unsigned int mask;
+	size_t offset, blockSize;
+	double* rows[NUMBER_OF_ROWS];
+	AdMatrix view, *decoded, *decodedSolvent;
+
+	decoded = AdAllocateDoubleMatrix(NUMBER_OF_ROWS, 3);
+	decodedSolvent = AdAllocateDoubleMatrix(solvent->no_rows, 3);
+	view.matrix = rows;
+
+	CHECK(AdFindTrajectoryFrameSystem(frame, length, "Protein", 7, &mask, &offset) == 1, label);
+	CHECK(mask == 3, label);
+	CHECK(offset % 8 == 0, label);
+
+	//Float64 coordinates are exact and can be viewed in place
+	blockSize = AdDecodeTrajectoryFrameBlock(frame + offset, length - offset, decoded);
+	CHECK(blockSize != 0, label);
+	CHECK(MaximumDifference(decoded, coordinates) == 0.0, label);
+	CHECK(AdTrajectoryFrameBlockView(frame + offset, length - offset, NULL, NUMBER_OF_ROWS, &view), label);
+	CHECK(MaximumDifference(&view, coordinates) == 0.0, label);
+	CHECK(AdTrajectoryFrameBlockView(frame + offset, length - offset, elements, 2, &view), label);
+	CHECK(view.no_rows == 2 && view.matrix[0][2] == coordinates->matrix[5][2]
+		&& view.matrix[1][0] == coordinates->matrix[1][0], label);
+
+	//Compressed velocities are within half the precision
+	offset += blockSize;
+	CHECK(AdTrajectoryFrameBlockView(frame + offset, length - offset, NULL, NUMBER_OF_ROWS, &view) == 0, label);
+	CHECK(AdDecodeTrajectoryFrameBlock(frame + offset, length - offset, decoded) != 0, label);
+	CHECK(MaximumDifference(decoded, velocities) <= 0.5/PRECISION + 1E-12, label);
+
+	CHECK(AdFindTrajectoryFrameSystem(frame, length, "Solvent", 7, &mask, &offset) == 1, label);
+	CHECK(mask == 1, label);
+	CHECK(AdDecodeTrajectoryFrameBlock(frame + offset, length - offset, decodedSolvent) != 0, label);
+	CHECK(MaximumDifference(decodedSolvent, solvent) < 1E-5, label);
+
+	CHECK(AdFindTrajectoryFrameSystem(frame, length, "Ligand", 6, &mask, &offset) == 0, label);
+
+	AdFreeDoubleMatrix(decoded);
+	AdFreeDoubleMatrix(decodedSolvent);
+}
+
+static void TestVersion1(const unsigned char* frame, size_t length,
+	AdMatrix* coordinates, AdMatrix* velocities, AdMatrix* solvent, int padded)
+{
+	unsigned int mask;
+	size_t offset, version1Length, convertedLength;
+	unsigned char *version1, *converted;
+	const char* label;
+
+	label = padded ? "Padded version 1 frame" : "Unpadded version 1 frame";
+	version1 = malloc(length + 8);
+	converted = malloc(2*length);
+	version1Length = WriteVersion1Frame(frame, length, padded, version1);
+	CHECK(padded ? version1Length == length : version1Length < length, label);
+
+	CHECK(AdTrajectoryFrameNeedsConversion(version1, version1Length) == 1, label);
+	CHECK(AdFindTrajectoryFrameSystem(version1, version1Length, "Protein", 7, &mask, &offset) == -1, label);
+
+	convertedLength = AdConvertTrajectoryFrame(version1, version1Length, NULL);
+	CHECK(convertedLength == length, label);
+	CHECK(AdConvertTrajectoryFrame(version1, version1Length, converted) == length, label);
+	CHECK(memcmp(converted, frame, length) == 0, label);
+	CHECK(AdTrajectoryFrameNeedsConversion(converted, convertedLength) == 0, label);
+	ReadFrame(converted, convertedLength, coordinates, velocities, solvent, label);
+
+	//A truncated frame can't be converted
+	CHECK(AdConvertTrajectoryFrame(version1, version1Length - 3, NULL) == 0, label);
+
+	free(version1);
+	free(converted);
+}
+
+static void TestSwapped(const unsigned char* frame, size_t length,
+	AdMatrix* coordinates, AdMatrix* velocities, AdMatrix* solvent)
+{
+	unsigned int mask;
+	size_t offset;
+	unsigned char *swapped, *converted;
+	const char* label = "Swapped frame";
+
+	swapped = malloc(length);
+	converted = malloc(length);
+	memcpy(swapped, frame, length);
+	SwapFrame(swapped, length);
+
+	CHECK(AdTrajectoryFrameNeedsConversion(swapped, length) == 1, label);
+	CHECK(AdFindTrajectoryFrameSystem(swapped, length, "Protein", 7, &mask, &offset) == -1, label);
+	CHECK(AdConvertTrajectoryFrame(swapped, length, NULL) == length, label);
+	CHECK(AdConvertTrajectoryFrame(swapped, length, converted) == length, label);
+	CHECK(memcmp(converted, frame, length) == 0, label);
+	ReadFrame(converted, length, coordinates, velocities, solvent, label);
+
+	//A frame with an unknown byte order marker can't be converted
+	swapped[AD_TRAJECTORY_FRAME_HEADER_SIZE - 1] = 0x7f;
+	CHECK(AdConvertTrajectoryFrame(swapped, length, NULL) == 0, label);
+
+	free(swapped);
+	free(converted);
+}
+
+/**
+A float64 block whose payload size doesn't match its rows can't be viewed.
+*/
+static void TestBlockViewPayloadSize(const unsigned char* frame, size_t length)
+{
+	unsigned int mask;
+	uint32_t payloadSize;
+	size_t offset;
+	double* rows[NUMBER_OF_ROWS];
+	unsigned char* corrupt;
+	AdMatrix view, *decoded;
+	const char* label = "Block payload size";
+
+	corrupt = malloc(length);
+	memcpy(corrupt, frame, length);
+	view.matrix = rows;
+	decoded = AdAllocateDoubleMatrix(NUMBER_OF_ROWS, 3);
+	CHECK(AdFindTrajectoryFrameSystem(corrupt, length, "Protein", 7, &mask, &offset) == 1, label);
+
+	//Shorten the payload by one double - the padded size of the block is unchanged
+	memcpy(&payloadSize, corrupt + offset + 2*sizeof(uint32_t), sizeof(uint32_t));
+	payloadSize -= sizeof(double);
+	memcpy(corrupt + offset + 2*sizeof(uint32_t), &payloadSize, sizeof(uint32_t));
+	CHECK(AdTrajectoryFrameBlockView(corrupt + offset, length - offset, NULL, NUMBER_OF_ROWS, &view) == 0, label);
+	CHECK(AdDecodeTrajectoryFrameBlock(corrupt + offset, length - offset, decoded) == 0, label);
+
+	free(corrupt);
+	AdFreeDoubleMatrix(decoded);
+}
+
+int main(void)
+{
+	size_t length, maximumLength;
+	unsigned char* frame;
+	AdMatrix *coordinates, *velocities, *solvent;
+
+	coordinates = AdAllocateDoubleMatrix(NUMBER_OF_ROWS, 3);
+	velocities = AdAllocateDoubleMatrix(NUMBER_OF_ROWS, 3);
+	solvent = AdAllocateDoubleMatrix(3, 3);
+	FillMatrix(coordinates, 12.5);
+	FillMatrix(velocities, -0.3);
+	FillMatrix(solvent, 100.25);
+
+	maximumLength = AD_TRAJECTORY_FRAME_HEADER_SIZE
+			+ 2*AdTrajectoryFrameSystemHeaderSize(7)
+			+ 2*AdTrajectoryFrameBlockMaximumSize(NUMBER_OF_ROWS)
+			+ AdTrajectoryFrameBlockMaximumSize(3);
+	frame = malloc(maximumLength);
+	length = WriteFrame(coordinates, velocities, solvent, frame);
+	CHECK(length <= maximumLength, "Frame size");
+	CHECK(length % 8 == 0, "Frame size");
+	CHECK(AdIsBinaryTrajectoryFrame(frame, length), "Magic");
+	CHECK(AdTrajectoryFrameNeedsConversion(frame, length) == 0, "Current version");
+
+	ReadFrame(frame, length, coordinates, velocities, solvent, "Current frame");
+	TestVersion1(frame, length, coordinates, velocities, solvent, 0);
+	TestVersion1(frame, length, coordinates, velocities, solvent, 1);
+	TestSwapped(frame, length, coordinates, velocities, solvent);
+	TestBlockViewPayloadSize(frame, length);
+
+	//XML frames are not binary frames
+	CHECK(!AdIsBinaryTrajectoryFrame((const unsigned char*)"<?xml", 5), "XML frame");
+	CHECK(AdConvertTrajectoryFrame((const unsigned char*)"<?xml", 5, NULL) == 0, "XML frame");
+
+	free(frame);
+	AdFreeDoubleMatrix(coordinates);
+	AdFreeDoubleMatrix(velocities);
+	AdFreeDoubleMatrix(solvent);
+
+	if(failures == 0)
+		printf("AdTrajectoryFrameTest: passed\n");
+
+	return failures == 0 ? 0 : 1;
+}
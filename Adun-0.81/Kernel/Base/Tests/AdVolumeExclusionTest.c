@@ -0,0 +1,217 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+/*
+ * Compares the AVX2 volume exclusion kernel with the scalar volume exclusion functions.
+ * The volume exclusion function of random points around a cluster of atoms is calculated 
+ * with the scalar kernel and then with AdVolumeExclusionFunction(), AdVolumeExclusionFunction2()
+ * and AdVolumeExclusionFunctionBlock() using AVX2. The values and the contributing atoms must be the same.
+ * The points include ones which are overlapped, partially overlapped and not overlapped, and ones
+ * whose number of neighbours is not a multiple of four.
+ * The AVX2 comparison is skipped if the cpu does not support it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Base/AdVolumeFunctions.h"
+#include "Base/AdNonbondedKernels.h"
+
+#define NUMBER_OF_ATOMS 60
+#define NUMBER_OF_POINTS 3000
+#define CLUSTER_SIZE 12.0
+#define SMOOTHING_LENGTH 0.3
+#define NEIGHBOUR_CUTOFF 3.0
+
+static int failures = 0;
+
+static double Random(double minimum, double maximum)
+{
+	return minimum + (maximum - minimum)*((double)rand()/RAND_MAX);
+}
+
+/**
+Sets the neighbours of each point in \e block to the atoms within NEIGHBOUR_CUTOFF
+of the atoms surface.
+*/
+static void SetNeighbours(AdVolumeBlock* block, AdMatrix* coordinates, double* radii)
+{
+	int i, j, k, count;
+	double length, separation;
+
+	for(i=0; i<block->numberPoints; i++)
+	{
+		block->neighbourIndexes[i] = malloc(NUMBER_OF_ATOMS*sizeof(int));
+		for(count = 0, j=0; j<NUMBER_OF_ATOMS; j++)
+		{
+			for(length = 0, k=0; k<3; k++)
+			{
+				separation = block->points[i].vector[k] - coordinates->matrix[j][k];
+				length += separation*separation;
+			}
+
+			if(sqrt(length) < radii[j] + NEIGHBOUR_CUTOFF)
+				block->neighbourIndexes[i][count++] = j;
+		}
+		block->numberNeighbours[i] = count;
+	}
+}
+
+/**
+Calculates the volume exclusion function of each point with AdVolumeExclusionFunction() and
+AdVolumeExclusionFunction2() and compares them to \e values and \e contributing.
+Then compares the values calculated by AdVolumeExclusionFunctionBlock().
+*/
+static void Compare(const char* name, AdVolumeBlock* block, AdMatrix* coordinates, double* radii,
+	double* values, IntArrayStruct* contributing)
+{
+	int i, functionErrors, contributingErrors, blockErrors;
+	double value;
+	IntArrayStruct atoms;
+
+	atoms.array = malloc(NUMBER_OF_ATOMS*sizeof(int));
+	functionErrors = contributingErrors = 0;
+	for(i=0; i<block->numberPoints; i++)
+	{
+		value = AdVolumeExclusionFunction(block->points + i, coordinates, 
+				block->neighbourIndexes[i], block->numberNeighbours[i], radii);
+		if(fabs(value - values[i]) > 1E-14)
+			functionErrors++;
+
+		atoms.length = 0;
+		value = AdVolumeExclusionFunction2(block->points + i, coordinates, 
+				block->neighbourIndexes[i], block->numberNeighbours[i], radii, &atoms);
+		if(fabs(value - values[i]) > 1E-14)
+			functionErrors++;
+
+		//The contributing atoms are only set if the point has neighbours
+		if(block->numberNeighbours[i] > 0 
+			&& (atoms.length != contributing[i].length 
+			|| memcmp(atoms.array, contributing[i].array, atoms.length*sizeof(int)) != 0))
+			contributingErrors++;
+	}
+
+	AdVolumeExclusionFunctionBlock(block, coordinates, radii);
+	for(blockErrors = 0, i=0; i<block->numberPoints; i++)
+		if(fabs(block->values[i] - values[i]) > 1E-14)
+			blockErrors++;
+
+	if(functionErrors > 0)
+	{
+		fprintf(stderr, "FAILED: %s volume exclusion function differs from scalar at %d points\n",
+			name, functionErrors);
+		failures++;
+	}
+
+	if(contributingErrors > 0)
+	{
+		fprintf(stderr, "FAILED: %s contributing atoms differ from scalar at %d points\n",
+			name, contributingErrors);
+		failures++;
+	}
+
+	if(blockErrors > 0)
+	{
+		fprintf(stderr, "FAILED: %s block values differ from scalar at %d points\n",
+			name, blockErrors);
+		failures++;
+	}
+
+	free(atoms.array);
+}
+
+int main(void)
+{
+	int i, j, overlapped, partial, solvent;
+	double radii[NUMBER_OF_ATOMS];
+	double values[NUMBER_OF_POINTS];
+	IntArrayStruct contributing[NUMBER_OF_POINTS];
+	AdMatrix* coordinates;
+	AdVolumeBlock* block;
+
+	srand(1357);
+	coordinates = AdAllocateDoubleMatrix(NUMBER_OF_ATOMS, 3);
+	for(i=0; i<NUMBER_OF_ATOMS; i++)
+	{
+		for(j=0; j<3; j++)
+			coordinates->matrix[i][j] = Random(0, CLUSTER_SIZE);
+
+		radii[i] = Random(1.2, 2.2);
+	}
+
+	//The points extend beyond the cluster so some have no neighbours
+	block = AdAllocateVolumeBlock(NUMBER_OF_POINTS);
+	block->numberPoints = NUMBER_OF_POINTS;
+	for(i=0; i<NUMBER_OF_POINTS; i++)
+		for(j=0; j<3; j++)
+			block->points[i].vector[j] = Random(-4, CLUSTER_SIZE + 4);
+
+	SetNeighbours(block, coordinates, radii);
+
+	//The scalar values
+	AdSetNonbondedKernels(AdScalarNonbondedKernels);
+	AdInitialiseGBSmoothingVariables(SMOOTHING_LENGTH);
+	overlapped = partial = solvent = 0;
+	for(i=0; i<NUMBER_OF_POINTS; i++)
+	{
+		contributing[i].array = malloc(NUMBER_OF_ATOMS*sizeof(int));
+		contributing[i].length = 0;
+		values[i] = AdVolumeExclusionFunction2(block->points + i, coordinates, 
+				block->neighbourIndexes[i], block->numberNeighbours[i], radii, contributing + i);
+		if(values[i] == 0)
+			overlapped++;
+		else if(values[i] == 1)
+			solvent++;
+		else
+			partial++;
+	}
+
+	if(overlapped == 0 || partial == 0 || solvent == 0)
+	{
+		fprintf(stderr, "FAILED: Points do not cover every case - %d overlapped, %d partial, %d not overlapped\n", 
+			overlapped, partial, solvent);
+		failures++;
+	}
+
+	Compare("Scalar", block, coordinates, radii, values, contributing);
+
+	if(AdSetNonbondedKernels(AdAVX2NonbondedKernels) == AdAVX2NonbondedKernels)
+	{
+		AdInitialiseGBSmoothingVariables(SMOOTHING_LENGTH);
+		Compare("AVX2", block, coordinates, radii, values, contributing);
+	}
+	else
+		printf("AdVolumeExclusionTest: AVX2 is not supported - skipped\n");
+
+	for(i=0; i<NUMBER_OF_POINTS; i++)
+	{
+		free(block->neighbourIndexes[i]);
+		free(contributing[i].array);
+	}
+	AdFreeVolumeBlock(block);
+	AdFreeDoubleMatrix(coordinates);
+
+	if(failures == 0)
+		printf("AdVolumeExclusionTest: passed\n");
+
+	return failures == 0 ? 0 : 1;
+}
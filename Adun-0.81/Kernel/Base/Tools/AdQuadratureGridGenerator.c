@@ -0,0 +1,86 @@
+/*
+   Project: Adun
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+/*
+ * Writes the AdSmoothedGBTerm integration grid for a number of radial points, 
+ * number of angular points and integration start point to a file.
+ * The file is read by AdReadQuadratureGrid(). 
+ * AdSmoothedGBTerm looks for the file in its GBSWData resource directory under the name 
+ * Quadrature-<radial>-<angular>-<start>.bin with the start point given to two decimal places.
+ *
+ * Usage: AdQuadratureGridGenerator radialPoints angularPoints startPoint file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Base/AdQuadratureFunctions.h"
+
+int main(int argc, char** argv)
+{
+	int numberRadialPoints, numberAngularPoints, error;
+	double startPoint;
+	FILE* file;
+	AdQuadratureGrid* grid;
+
+	if(argc != 5)
+	{
+		fprintf(stderr, "Usage: %s radialPoints angularPoints startPoint file\n", argv[0]);
+		return 1;
+	}
+
+	numberRadialPoints = atoi(argv[1]);
+	numberAngularPoints = atoi(argv[2]);
+	startPoint = strtod(argv[3], NULL);
+
+	grid = AdCreateSmoothedGBQuadratureGrid(numberRadialPoints, numberAngularPoints, startPoint);
+	if(grid == NULL)
+	{
+		fprintf(stderr, "Unsupported grid - %d radial points, %d angular points\n", 
+			numberRadialPoints, numberAngularPoints);
+		return 1;
+	}
+
+	file = fopen(argv[4], "wb");
+	if(file == NULL)
+	{
+		fprintf(stderr, "Unable to open %s\n", argv[4]);
+		AdFreeQuadratureGrid(grid);
+		return 1;
+	}
+
+	error = AdWriteQuadratureGrid(grid, file);
+	if(fclose(file) != 0)
+		error = 1;
+
+	AdFreeQuadratureGrid(grid);
+
+	if(error != 0)
+	{
+		fprintf(stderr, "Unable to write the grid to %s\n", argv[4]);
+		return 1;
+	}
+
+	printf("Wrote %d x %d grid starting at %lf to %s\n", 
+		numberRadialPoints, numberAngularPoints, startPoint, argv[4]);
+
+	return 0;
+}
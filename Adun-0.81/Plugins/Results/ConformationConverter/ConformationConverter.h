@@ -34,9 +34,17 @@
 #include <ULFramework/ULFrameworkFunctions.h>
 #include <MolTalk/MolTalk.h>
 
-@interface ConformationConverter : NSObject <ULAnalysisPlugin>
+/**
+Writes the conformations of the selected systems of a simulation to a file for each system in pdb or xyz format.
+Conforms to ULFrameAnalysis so the conformations of different frames are created concurrently.
+The conformations are kept in memory until all frames have been converted and are then written in frame order.
+*/
+@interface ConformationConverter : NSObject <ULAnalysisPlugin, ULFrameAnalysis>
 {
 	NSMutableDictionary* currentOptions;
+	NSMutableArray* systems;		//The selected systems which have dynamics
+	NSString* format;
+	NSMutableString* returnString;
 	id simulation;
 }
 
@@ -26,27 +26,85 @@ a  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 #include <AdunKernel/AdunFileSystemSimulationStorage.h>
 #include <math.h>
 
+/**
+An MTStream which collects what is written to it in memory
+so the conformation of a frame can be created on any thread.
+*/
+@interface ConformationDataStream: MTStream
+{
+	NSMutableData* data;
+}
+- (NSData*) data;
+@end
+
+@implementation ConformationDataStream
+
+- (id) init
+{
+	if((self = [super init]))
+		data = [NSMutableData new];
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[data release];
+	[super dealloc];
+}
+
+- (BOOL) ok
+{
+	return YES;
+}
+
+- (void) close
+{
+}
+
+- (void) writeData: (NSData*) someData
+{
+	[data appendData: someData];
+}
+
+- (void) writeString: (NSString*) string
+{
+	[data appendData: [string data]];
+}
+
+- (void) writeCString: (const char*) string
+{
+	[data appendBytes: string length: strlen(string)];
+}
+
+- (NSData*) data
+{
+	return data;
+}
+
+@end
+
 @implementation ConformationConverter
 
-- (void) _outputPDBForSystem: (id) system 
-	withMemento: (id) memento
-	toFileStream: (MTFileStream*) fileStream
+- (NSData*) _pdbForSystem: (id) system withMemento: (id) memento
 {
 	id structure;
+	ConformationDataStream* stream;
 
 	structure = ULConvertDataSourceToPDBStructure2(
 			[system dataSource],
 			[memento dataMatrixWithName: @"Coordinates"]);
-	[structure writePDBToStream: fileStream];
+	stream = [[ConformationDataStream new] autorelease];
+	[structure writePDBToStream: stream];
+
+	return [stream data];
 }
 
-- (void) _outputXYZForSystem: (id) system 
-	withMemento: (id) memento
-	toFileStream: (FILE*) outFile
+- (NSData*) _xyzForSystem: (id) system withMemento: (id) memento
 {
 	int i, numberOfRows;
 	NSArray* atoms;
-	NSArray* row;
+	NSMutableString* string;
 	AdMatrix* coordinates;
 	id atom;
 
@@ -55,20 +113,23 @@ a  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 	numberOfRows = coordinates->no_rows;
 	atoms = [system elementTypes];
 
-	GSPrintf(outFile, @"%d\n", numberOfRows);
-	GSPrintf(outFile, @"Energy:\n");
+	string = [NSMutableString string];
+	[string appendFormat: @"%d\n", numberOfRows];
+	[string appendString: @"Energy:\n"];
 	for(i=0; i<numberOfRows; i++)
 	{
 		atom = [atoms objectAtIndex: i];
-		GSPrintf(outFile, @"%-12@%-12.3lf%-12.3lf%-12.3lf\n", 
+		[string appendFormat: @"%-12@%-12.3lf%-12.3lf%-12.3lf\n", 
 				atom, 
 				coordinates->matrix[i][0],
 				coordinates->matrix[i][1],
-				coordinates->matrix[i][2]);
+				coordinates->matrix[i][2]];
 	} 
 
 	[[AdMemoryManager appMemoryManager] 
 		freeMatrix: coordinates];
+
+	return [string dataUsingEncoding: NSASCIIStringEncoding allowLossyConversion: YES];
 }
 
 - (id) init
@@ -76,6 +137,15 @@ a  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 	return self;
 }
 
+- (void) dealloc
+{
+	[currentOptions release];
+	[systems release];
+	[format release];
+	[returnString release];
+	[super dealloc];
+}
+
 //Default implementation
 - (BOOL) checkInputs: (NSArray*) inputs error: (NSError**) error
 {
@@ -130,40 +200,54 @@ a  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 	return  options;
 }	
 
-- (NSDictionary*) processInputs: (NSArray*) inputs userOptions: (NSDictionary*) options; 
+/*
+ * Frame analysis
+ */
+
+- (NSIndexSet*) prepareFrameAnalysisOfInputs: (NSArray*) inputs userOptions: (NSDictionary*) options
 {
-	int i, step;
-	int startFrame, endFrame, totalFrames, output;
-	FILE* outFile;
-	id systemNames, systemName, format, memento;
-	id system;
-	NSString* filename;
+	int i, step, startFrame, endFrame;
+	id systemNames, systemName, system;
 	NSEnumerator* systemNamesEnum;
-	NSMutableString* returnString;
-	NSMutableDictionary* notificationDict;
-	NSAutoreleasePool* pool;
-	MTFileStream* fileStream;
+	NSMutableIndexSet* frames;
 
-	currentOptions = [[options mutableCopy] autorelease];
+	[currentOptions release];
+	[systems release];
+	[format release];
+	[returnString release];
+	currentOptions = [options mutableCopy];
 	simulation = [inputs objectAtIndex: 0];
+	systems = [NSMutableArray new];
 
 	//Set up the return string
-	returnString = [NSMutableString stringWithCapacity: 1];
+	returnString = [NSMutableString new];
 	[returnString appendFormat:
 		 @"Output conformations for simulation at %@\n\n", 
 		 [[simulation dataStorage] storagePath]];
 	
-	//Selected Systems
+	//Selected Systems - Only those with dynamics are converted
 	systemNames = [[currentOptions valueForMenuItem: @"Systems"] 
 			selectedItems];
-	systemNamesEnum = [systemNames objectEnumerator];
 	NSDebugLLog(@"ConformationConverter", 
 		@"Selected systemNames %@. Simulation %@", 
 		systemNames, simulation);
+	systemNamesEnum = [systemNames objectEnumerator];
+	while((systemName = [systemNamesEnum nextObject]))
+	{
+		system = [[simulation systemCollection] 
+				systemWithName: systemName];
+		if([simulation numberOfFramesForSystem: system] != 0)
+			[systems addObject: system];
+		else
+		{
+			NSWarnLog(@"\tNo dynamics for %@\n", systemName);
+			[returnString appendFormat: @"No dynamics for %@\n", systemName];
+		}
+	}
 
 	//Format
-	format = [[[currentOptions valueForMenuItem: @"Format"] 
-			selectedItems] objectAtIndex: 0];
+	format = [[[[currentOptions valueForMenuItem: @"Format"] 
+			selectedItems] objectAtIndex: 0] retain];
 	NSDebugLLog(@"ConformationConverter", 
 		@"Format %@", format);
 
@@ -173,93 +257,165 @@ a  Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
 					intValue];
 	step = [[currentOptions valueForKeyPath: @"Frames.Stepsize"] 
 			intValue];
+	if(step <= 0)
+		step = 1;
+
+	if(endFrame > (int)[simulation numberTrajectoryCheckpoints])
+		endFrame = [simulation numberTrajectoryCheckpoints];
+
+	NSDebugLLog(@"ConformationConverter", 
+		@"Start Frame %d. End Frame %d", startFrame, endFrame);
+
+	if([systems count] == 0)
+		return nil;
+
+	frames = [NSMutableIndexSet indexSet];
+	for(i=startFrame; i<endFrame; i += step)
+		[frames addIndex: i];
+
+	return frames;
+}
+
+/**
+Returns a dictionary containing the conformation of each selected system in \e mementos
+in the chosen format keyed by system name.
+*/
+- (id) analyseTrajectoryCheckpoint: (unsigned int) number mementos: (NSDictionary*) mementos
+{
+	NSEnumerator* systemEnum;
+	NSMutableDictionary* conformations;
+	id system, memento;
+
+	conformations = [NSMutableDictionary dictionary];
+	systemEnum = [systems objectEnumerator];
+	while((system = [systemEnum nextObject]))
+	{
+		memento = [mementos objectForKey: [system systemName]];
+		if(memento == nil)
+			continue;
+
+		if([format isEqual: @"pdb"])
+			[conformations setObject: [self _pdbForSystem: system withMemento: memento]
+				forKey: [system systemName]];
+		else
+			[conformations setObject: [self _xyzForSystem: system withMemento: memento]
+				forKey: [system systemName]];
+	}
+
+	return conformations;
+}
+
+/**
+Writes the conformations of each system to a file in the simulation
+data directory in checkpoint order.
+*/
+- (NSDictionary*) resultsFromFrameAnalyses: (NSArray*) frameResults checkpoints: (NSIndexSet*) checkpoints
+{
+	NSString* filename;
+	NSEnumerator* systemEnum, *resultsEnum;
+	NSFileHandle* fileHandle;
+	NSData* conformation;
+	id system, result;
+
+	systemEnum = [systems objectEnumerator];
+	while((system = [systemEnum nextObject]))
+	{
+		filename = [NSString stringWithFormat: 
+				@"%@.%@", [system systemName], format];
+		filename = [[[simulation dataStorage] storagePath] 
+				stringByAppendingPathComponent: filename];
+		[returnString appendFormat:
+			 @"\tSubsystem %@ - File %@\n", [system systemName], filename];
+
+		[[NSFileManager defaultManager] createFileAtPath: filename
+			contents: nil
+			attributes: nil];
+		fileHandle = [NSFileHandle fileHandleForWritingAtPath: filename];
+		if(fileHandle == nil)
+			[NSException raise: NSInternalInconsistencyException
+				format: @"Unable to open %@ for writing", filename];
+
+		resultsEnum = [frameResults objectEnumerator];
+		while((result = [resultsEnum nextObject]))
+		{
+			if(result == [NSNull null])
+				continue;
+
+			conformation = [result objectForKey: [system systemName]];
+			if(conformation != nil)
+				[fileHandle writeData: conformation];
+		}
+
+		[fileHandle closeFile];
+	}
+
+	[returnString appendString: @"\nComplete\n"];
 	
-	totalFrames = [systemNames count]*(endFrame - startFrame);
-	totalFrames = lround((double)totalFrames/(double)step);		
+	return [NSDictionary dictionaryWithObject: [[returnString copy] autorelease]
+		 forKey: @"ULAnalysisPluginString"];
+}
+
+/**
+Converts the frames one at a time on the calling thread. 
+Gives the same output as the frame analysis.
+*/
+- (NSDictionary*) processInputs: (NSArray*) inputs userOptions: (NSDictionary*) options; 
+{
+	unsigned int frame, output;
+	id system, memento, result;
+	NSIndexSet* frames;
+	NSEnumerator* systemEnum;
+	NSMutableArray* frameResults;
+	NSMutableDictionary* mementos, *notificationDict;
+	NSAutoreleasePool* pool;
+
+	frames = [self prepareFrameAnalysisOfInputs: inputs userOptions: options];
+	if(frames == nil)
+		frames = [NSIndexSet indexSet];
 
 	notificationDict = [NSMutableDictionary dictionary];	
-	[notificationDict setObject: [NSNumber numberWithInt: totalFrames]
+	[notificationDict setObject: [NSNumber numberWithInt: [frames count]]
 		forKey: @"ULAnalysisPluginTotalSteps"];
-	NSDebugLLog(@"ConformationConverter", 
-		@"Start Frame %d. End Frame %d", startFrame, endFrame);
 
 	output = 0;
-	while(systemName = [systemNamesEnum nextObject])
+	frameResults = [NSMutableArray array];
+	frame = [frames firstIndex];
+	while(frame != NSNotFound)
 	{
+		pool = [NSAutoreleasePool new];
 		NSDebugLLog(@"ConformationConverter", 
-			@"System %@", systemName);
-		NSDebugLLog(@"ConformationConverter", 
-			@"Beginning");
-		system = [[simulation systemCollection] 
-				systemWithName: systemName];
-		if([simulation numberOfFramesForSystem: system] != 0)
+			@"Retrieving frame %d", frame);
+		mementos = [NSMutableDictionary dictionary];
+		systemEnum = [systems objectEnumerator];
+		while((system = [systemEnum nextObject]))
 		{
-			filename = [NSString stringWithFormat: 
-					@"%@.%@", systemName, format];
-			filename = [[[simulation dataStorage] storagePath] 
-					stringByAppendingPathComponent: filename];
-			[returnString appendFormat:
-				 @"\tSubsystem %@ - File %@\n", systemName, filename];
-
-			if([format isEqual: @"pdb"])
-				fileStream = [MTFileStream streamToFile: 
-						filename];
-			else
-				outFile = fopen([filename cString], "w");
-
-			pool = [NSAutoreleasePool new];
-			for(i=startFrame; i< endFrame; i = i+step)
-			{
-				NSDebugLLog(@"ConformationConverter", 
-					@"Retrieving frame %d", i);
-				memento = [simulation mementoForFrame: i 
-						ofSystem: system];
-				NSDebugLLog(@"ConformationConverter", 
-					@"Outputting frame %d", i);
-				if([format isEqual: @"pdb"])
-					[self _outputPDBForSystem: system 
-						withMemento: memento
-						toFileStream: fileStream];
-				else
-					[self _outputXYZForSystem: system 
-						withMemento: memento
-						toFileStream: outFile];
-
-				NSDebugLLog(@"ConformationConverter", @"Complete");
-				output++;
-				if(output%10 == 0)
-				{
-					[notificationDict setObject: 
-						[NSNumber numberWithInt: output]
-						forKey: @"ULAnalysisPluginCompletedSteps"];
-					[[NSNotificationCenter defaultCenter] 
-						postNotificationName:
-						@"ULAnalysisPluginDidCompleteStepNotification"
-						object: nil
-						userInfo: notificationDict];
-					[pool release];	
-					pool = [NSAutoreleasePool new];
-				}
-			}
-			[pool release];
-
-			if([format isEqual:@"pdb"])
-				[fileStream close];
-			else
-				fclose(outFile);
+			memento = [simulation mementoForFrame: frame 
+					ofSystem: system];
+			if(memento != nil)
+				[mementos setObject: memento forKey: [system systemName]];
 		}
-		else
+
+		result = [self analyseTrajectoryCheckpoint: frame mementos: mementos];
+		[frameResults addObject: (result == nil) ? [NSNull null] : result];
+		[pool release];
+
+		output++;
+		if(output%10 == 0)
 		{
-			NSWarnLog(@"\tNo dynamics for %@\n", systemName);
-			[returnString appendFormat: @"No dynamics for %@\n", systemName];
+			[notificationDict setObject: 
+				[NSNumber numberWithInt: output]
+				forKey: @"ULAnalysisPluginCompletedSteps"];
+			[[NSNotificationCenter defaultCenter] 
+				postNotificationName:
+				@"ULAnalysisPluginDidCompleteStepNotification"
+				object: nil
+				userInfo: notificationDict];
 		}
 
- 	}
+		frame = [frames indexGreaterThanIndex: frame];
+	}
 
-	[returnString appendString: @"\nComplete\n"];
-	
-	return [NSDictionary dictionaryWithObject: returnString
-		 forKey: @"ULAnalysisPluginString"];
+	return [self resultsFromFrameAnalyses: frameResults checkpoints: frames];
 }
 
 @end
@@ -31,12 +31,20 @@
 #include <ULFramework/ULAnalysisPlugin.h>
 #include <ULFramework/ULMenuExtensions.h>
 
-@interface EnergyConverter : NSObject <ULAnalysisPlugin>
+/**
+Converts the energies recorded during a simulation to data sets.
+The energies are not part of the trajectory checkpoints so as a ULFrameAnalysis
+it requests no checkpoints and does all its work when the results are merged.
+This lets it run in the same pass over a simulation as the other frame analysis plugins.
+*/
+@interface EnergyConverter : NSObject <ULAnalysisPlugin, ULFrameAnalysis>
 {
 	NSDictionary* infoDict;
 	NSDictionary* conversionFactors;
 	NSMutableString* resultsString;
 	NSMutableDictionary* pluginOptions;
+	NSArray* frameInputs;
+	NSDictionary* frameOptions;
 }
 
 @end
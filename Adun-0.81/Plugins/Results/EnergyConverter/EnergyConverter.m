@@ -293,6 +293,8 @@ Protocols
 
 - (void) dealloc
 {
+	[frameInputs release];
+	[frameOptions release];
 	[resultsString release];
 	[conversionFactors release];
 	[super dealloc];
@@ -478,4 +480,36 @@ Protocols
 	return resultsDict;
 }
 
+/*
+ * Frame analysis
+ */
+
+- (NSIndexSet*) prepareFrameAnalysisOfInputs: (NSArray*) inputs userOptions: (NSDictionary*) options
+{
+	[frameInputs release];
+	[frameOptions release];
+	frameInputs = [inputs retain];
+	frameOptions = [options retain];
+
+	return [NSIndexSet indexSet];
+}
+
+- (id) analyseTrajectoryCheckpoint: (unsigned int) number mementos: (NSDictionary*) mementos
+{
+	return nil;
+}
+
+- (NSDictionary*) resultsFromFrameAnalyses: (NSArray*) frameResults checkpoints: (NSIndexSet*) checkpoints
+{
+	NSDictionary* results;
+
+	results = [self processInputs: frameInputs userOptions: frameOptions];
+	[frameInputs release];
+	[frameOptions release];
+	frameInputs = nil;
+	frameOptions = nil;
+
+	return results;
+}
+
 @end
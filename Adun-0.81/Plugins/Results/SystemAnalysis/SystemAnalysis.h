@@ -31,8 +31,18 @@
 #include <AdunKernel/AdunKernel.h>
 #include <Base/AdMatrix.h>
 
-@interface SystemAnalysis : NSObject <ULAnalysisPlugin>
+/**
+Calculates the energy contribution of each atom of a system along with its properties,
+interactions and solvation data. 
+The input is either a data source or a simulation. For a simulation the contributions of the
+chosen system are averaged over the chosen frames - as a ULFrameAnalysis the frames are
+evaluated concurrently.
+*/
+@interface SystemAnalysis : NSObject <ULAnalysisPlugin, ULFrameAnalysis>
 {
+	id simulation;
+	NSString* systemName;
+	NSDictionary* frameOptions;
 	AdMutableDataSource* dataSource;
 	NSDictionary* infoDict;
 	NSMutableDictionary* forceFields;
@@ -66,9 +66,42 @@
 	return residues;
 }
 
-//Default implementation
+/**
+Returns the data source that \e input refers to - either \e input itself or
+the data source of the system selected in \e opt of the simulation \e input.
+If \e opt is nil the first system of the simulation is used.
+*/
+- (id) _dataSourceOfInput: (id) input options: (NSDictionary*) opt
+{
+	NSString* systemName;
+	NSArray* systems;
+
+	if(![input isKindOfClass: [AdSimulationData class]])
+		return input;
+
+	systems = [[input systemCollection] fullSystems];
+	if(opt == nil)
+		return [[systems objectAtIndex: 0] dataSource];
+
+	systemName = [[opt valueForKeyPath: @"System.Selection"] 
+			objectAtIndex: 0];
+	return [[[input systemCollection] systemWithName: systemName]
+		dataSource];
+}
+
 - (BOOL) checkInputs: (NSArray*) inputs error: (NSError**) error
 {
+	if([inputs count] != 1)
+	{
+		if(error != NULL)
+			*error = AdCreateError(@"SystemAnalysis.ErrorDomain", 
+					1, 
+					@"SystemAnalysis requires one input",
+					@"Provide either a data source or a simulation",
+					nil);
+		return NO;
+	}
+
 	return YES;
 }
 
@@ -79,10 +112,13 @@
 	NSMutableDictionary* interactionsMenu = [NSMutableDictionary newLeafMenu];
 	NSMutableDictionary* limitsMenu = [NSMutableDictionary newNodeMenu: NO];
 	NSMutableDictionary* unitsMenu = [NSMutableDictionary newLeafMenu];
+	NSMutableDictionary* systemMenu, *framesMenu;
 	NSMutableArray* interactions;
+	NSEnumerator* systemEnum;
 	NSArray *residues;
+	id simulation, simulationSystem;
 	
-	dataSource = [input objectAtIndex: 0];
+	dataSource = [self _dataSourceOfInput: [input objectAtIndex: 0] options: nil];
 	residues = [self _numberedResidues];
 	[residueMenu addMenuItem: @"All"];
 	[residueMenu addMenuItems: residues]; 	
@@ -117,6 +153,29 @@
 	[mainMenu addMenuItem: @"Residues" withValue: residueMenu];
 	[mainMenu addMenuItem: @"Interactions" withValue: interactionsMenu];
 	[mainMenu addMenuItem: @"Limits" withValue: limitsMenu];
+
+	//For simulations the contributions are averaged over the chosen frames
+	simulation = [input objectAtIndex: 0];
+	if([simulation isKindOfClass: [AdSimulationData class]])
+	{
+		systemMenu = [NSMutableDictionary newLeafMenu];
+		systemEnum = [[[simulation systemCollection] fullSystems] objectEnumerator];
+		while((simulationSystem = [systemEnum nextObject]))
+			[systemMenu addMenuItem: [simulationSystem systemName]];
+		[systemMenu setDefaultSelection: 
+			[[systemMenu menuItems] objectAtIndex: 0]];
+		[mainMenu addMenuItem: @"System" withValue: systemMenu];
+
+		framesMenu = [NSMutableDictionary newNodeMenu: NO];
+		[framesMenu addMenuItem: @"Start"
+			withValue: [NSNumber numberWithInt: 0]];
+		[framesMenu addMenuItem: @"Length"
+			withValue: [NSNumber numberWithInt: 
+				[simulation numberTrajectoryCheckpoints]]];
+		[framesMenu addMenuItem: @"Stepsize"
+			withValue: [NSNumber numberWithInt: 1]];
+		[mainMenu addMenuItem: @"Frames" withValue: framesMenu];
+	}
 	
 	return  mainMenu;
 }
@@ -147,6 +206,7 @@
 
 - (void) dealloc
 {
+	[frameOptions release];
 	[conversionFactors release];
 	[infoDict release];
 	[forceFields release];
@@ -272,46 +332,134 @@ Set up some variables for the atom contributions calculation
 	totalSteps = [selectedResidues count];
 }
 
-- (void) _atomContributions: (NSDictionary*) opt
+/**
+Evaluates the energy of each atom in the selected residues using \e aForceField.
+Returns a dictionary whose "Energies" key is an NSData containing a row of doubles for each atom -
+its total energy followed by its energy for each selected interaction in simulation units.
+The rows of atoms in unselected residues are zero.
+The "MissingTerms" key is an array of the selected interactions \e aForceField does not have.
+*/
+- (NSDictionary*) _atomEnergiesUsingForceField: (AdForceField*) aForceField 
+		options: (NSDictionary*) opt
+		postProgress: (BOOL) value
 {
-	int index, residueNo, atomsInResidue, offset;
+	int i, index, residueNo, atomsInResidue, offset, numberOfColumns;
 	int count;
-	double totalEnergy;
-	NSArray* energies;
-	NSMutableArray* array = [NSMutableArray array];
+	double* row;
+	NSArray* interactions, *energies;
+	NSMutableArray* missingTerms = [NSMutableArray array];
+	NSMutableData* data;
 	NSMutableIndexSet* indexSet = [NSMutableIndexSet indexSet];
 	NSEnumerator* residueEnum;
 	NSString *residue;
+	id energy;
+
+	interactions = [opt valueForKeyPath: @"Interactions.Selection"];
+	numberOfColumns = [interactions count] + 1;
+	data = [NSMutableData dataWithLength: 
+			[elementProperties numberOfRows]*numberOfColumns*sizeof(double)];
 
 	residueNo = atomsInResidue = offset = count = 0;
-	[self _setUp: opt];
 	residueEnum = [allResidues objectEnumerator];
-	while(residue = [residueEnum nextObject])
+	while((residue = [residueEnum nextObject]))
 	{
 		atomsInResidue = [[groupProperties elementAtRow: residueNo
 					ofColumnWithHeader: @"Atoms"]
 					intValue];
 		if([selectedResidues containsObject: residue])
 		{
-			[self updateProgressToStep: count 
-					ofTotalSteps:  totalSteps
-					withMessage: residue];
+			if(value)
+				[self updateProgressToStep: count 
+						ofTotalSteps:  totalSteps
+						withMessage: residue];
 
 			for(index=offset; index < offset + atomsInResidue; index++)
 			{
 				//Calculate atoms energies
 				[indexSet addIndex: index];
-				[forceField evaluateEnergiesUsingInteractionsInvolvingElements: indexSet];
-				totalEnergy = [forceField totalEnergy];
-				totalEnergy *= [[conversionFactors objectForKey: energyUnit] 
-							doubleValue];
+				[aForceField evaluateEnergiesUsingInteractionsInvolvingElements: indexSet];
+				energies = [aForceField arrayOfEnergiesForTerms: interactions 
+						notFoundMarker: [NSNull null]];
+
+				row = (double*)[data mutableBytes] + index*numberOfColumns;
+				row[0] = [aForceField totalEnergy];
+				for(i=0; i<(int)[energies count]; i++)
+				{
+					energy = [energies objectAtIndex: i];
+					if(energy == [NSNull null])
+					{
+						if(![missingTerms containsObject: [interactions objectAtIndex: i]])
+							[missingTerms addObject: [interactions objectAtIndex: i]];
+					}
+					else
+						row[i+1] = [energy doubleValue];
+				}
+
+				[indexSet removeAllIndexes];
+			}
+			count++;
+		}	
+
+		offset += atomsInResidue;
+		residueNo++;
+	}
+
+	if(value)
+		[self updateProgressToStep: totalSteps
+				ofTotalSteps:  totalSteps
+				withMessage: @"Complete"];
+
+	return [NSDictionary dictionaryWithObjectsAndKeys:
+			data, @"Energies",
+			missingTerms, @"MissingTerms", nil];
+}
+
+/**
+Creates the AtomContributions matrix from the atom energies returned by 
+_atomEnergiesUsingForceField:options:postProgress:.
+Only atoms whose total energy exceeds the energy threshold are added.
+*/
+- (void) _atomContributionsFromEnergies: (NSData*) data 
+		missingTerms: (NSArray*) missingTerms
+		options: (NSDictionary*) opt
+{
+	int i, index, residueNo, atomsInResidue, offset, numberOfColumns;
+	double totalEnergy, conversionFactor;
+	const double* row;
+	NSArray* interactions;
+	NSMutableArray* array = [NSMutableArray array];
+	NSMutableArray* energies = [NSMutableArray array];
+	NSEnumerator* residueEnum;
+	NSString *residue;
 
+	interactions = [opt valueForKeyPath: @"Interactions.Selection"];
+	numberOfColumns = [interactions count] + 1;
+	conversionFactor = [[conversionFactors objectForKey: energyUnit] 
+				doubleValue];
+
+	residueNo = atomsInResidue = offset = 0;
+	residueEnum = [allResidues objectEnumerator];
+	while((residue = [residueEnum nextObject]))
+	{
+		atomsInResidue = [[groupProperties elementAtRow: residueNo
+					ofColumnWithHeader: @"Atoms"]
+					intValue];
+		if([selectedResidues containsObject: residue])
+		{
+			for(index=offset; index < offset + atomsInResidue; index++)
+			{
+				row = (const double*)[data bytes] + index*numberOfColumns;
+				totalEnergy = row[0]*conversionFactor;
 				if(fabs(totalEnergy) > energyThreshold)
 				{
-					energies = [forceField arrayOfEnergiesForTerms: 
-								[opt valueForKeyPath: @"Interactions.Selection"] 
-							notFoundMarker: @"None"];
-					energies = [self _convertEnergies: energies to: energyUnit];
+					for(i=1; i<numberOfColumns; i++)
+					{
+						if([missingTerms containsObject: [interactions objectAtIndex: i-1]])
+							[energies addObject: @"None"];
+						else
+							[energies addObject: [NSNumber numberWithDouble: row[i]]];
+					}	
+					[energies setArray: [self _convertEnergies: energies to: energyUnit]];
 
 					//Create the row entry for the atom
 					[array addObject: [NSNumber numberWithInt: index]];
@@ -340,18 +488,51 @@ Set up some variables for the atom contributions calculation
 
 				//Update for next iteration
 				[array removeAllObjects];
-				[indexSet removeAllIndexes];
+				[energies removeAllObjects];
 			}
-			count++;
 		}	
 
 		offset += atomsInResidue;
 		residueNo++;
 	}
+}
+
+/**
+Returns a force field of type \e type for \e aSystem with only the
+interactions selected in \e opt active.
+*/
+- (AdForceField*) _forceFieldForSystem: (AdSystem*) aSystem 
+		type: (NSString*) type
+		options: (NSDictionary*) opt
+{
+	NSMutableArray* inactiveTerms = [NSMutableArray array];
+	AdForceField* aForceField;
+
+	if(type == nil)
+		[NSException raise: NSInternalInconsistencyException
+			format: @"System created with unknown force field"];
+	
+	aForceField = [[[forceFields objectForKey: type] alloc]
+			initWithSystem: aSystem];
 	
-	[self updateProgressToStep: totalSteps
-			ofTotalSteps:  totalSteps
-			withMessage: @"Complete"];
+	//Deactivate the interactions that werent selected.
+	[inactiveTerms addObjectsFromArray: [dataSource availableInteractions]];
+	[inactiveTerms 	removeObjectsInArray: 
+		[opt valueForKeyPath: @"Interactions.Selection"]];
+	[aForceField deactivateTermsWithNames: inactiveTerms];
+
+	return [aForceField autorelease];
+}
+
+- (AdSystem*) _createSystem
+{
+	return [[[AdSystem alloc]
+			initWithDataSource: dataSource
+			name: nil
+			initialTemperature: 300
+			seed: 10
+			centre: nil
+			removeTranslationalDOF: YES] autorelease];
 }
 
 - (void) _addAtomNames: (AdMutableDataMatrix*) matrix
@@ -480,51 +661,33 @@ Set up some variables for the atom contributions calculation
 	[nonbondedTerm release];
 }
 
-- (NSDictionary*) processInputs: (NSArray*) anArray userOptions: (NSDictionary*) opt 
+/**
+Creates the results of the analysis from \e energies. 
+The system ivar must be set - its current state is used for the solvation data.
+*/
+- (NSDictionary*) _resultsFromAtomEnergies: (NSData*) energies
+		missingTerms: (NSArray*) missingTerms
+		options: (NSDictionary*) opt
 {
 	int i;
 	NSString* type;
 	NSMutableDictionary* resultsDict = [NSMutableDictionary dictionary];
-	NSMutableArray* inactiveTerms = [NSMutableArray array];
 	NSMutableArray* array;
 	AdDataSet* dataSet;
 	AdDataMatrix* properties;
 	AdMutableDataMatrix* matrix;
 
-	returnString = [NSMutableString new];
-	dataSource = [anArray objectAtIndex: 0];
+	type = [[dataSource allData] objectForKey: @"ForceField"];
 	dataSet = [[AdDataSet alloc] 
 			initWithName: [dataSource name]
 			inputReferences: nil
 			dataGeneratorName: @"SystemAnalysis"
 			dataGeneratorVersion: [infoDict objectForKey: @"PluginVersion"]];
+	[dataSet autorelease];
 
-	energyUnit = [[opt valueForKeyPath: @"Units.Selection"]
-			objectAtIndex: 0];
-	//Create a system
-	system = [[AdSystem alloc]
-			initWithDataSource: dataSource
-			name: nil
-			initialTemperature: 300
-			seed: 10
-			centre: nil
-			removeTranslationalDOF: YES];
-	type = [[dataSource allData] objectForKey: @"ForceField"];
-
-	if(type == nil)
-		[NSException raise: NSInternalInconsistencyException
-			format: @"System created with unknown force field"];
-	
-	forceField = [[[forceFields objectForKey: type] alloc]
-			initWithSystem: system];
-	
-	//Deactivate the interactions that werent selected.
-	[inactiveTerms addObjectsFromArray: [dataSource availableInteractions]];
-	[inactiveTerms 	removeObjectsInArray: 
-		[opt valueForKeyPath: @"Interactions.Selection"]];
-	[forceField deactivateTermsWithNames: inactiveTerms];
-		
-	[self _atomContributions: opt];	
+	[self _atomContributionsFromEnergies: energies
+		missingTerms: missingTerms
+		options: opt];
 
 	[dataSet addDataMatrix: atomContributions];
 	[dataSet setValue: energyUnit forMetadataKey: @"EnergyUnit"];
@@ -557,18 +720,213 @@ Set up some variables for the atom contributions calculation
 	[self _addInteractionData:dataSet];
 	[self _addSolvationData:dataSet];
 
-	[forceField release];
-	[system release];
-
-	[returnString autorelease];		
 	[returnString appendFormat:
 		@"Complete - %d atoms analysed\n", 
 		[atomContributions numberOfRows]];
 
-	[resultsDict setObject: returnString
+	[resultsDict setObject: [[returnString copy] autorelease]
 		forKey: @"ULAnalysisPluginString"];
+	[returnString release];
+	returnString = nil;
+
 	return resultsDict;	
 }
 
-@end
+/*
+ * Frame analysis
+ */
+
+/**
+For a simulation the atom contributions of the chosen system are
+averaged over the chosen trajectory checkpoints.
+Each checkpoint is evaluated with its own system and force field 
+so the checkpoints can be analysed concurrently.
+*/
+- (NSIndexSet*) prepareFrameAnalysisOfInputs: (NSArray*) inputs userOptions: (NSDictionary*) opt
+{
+	int i, start, end, step;
+	NSMutableIndexSet* checkpoints;
+
+	simulation = [inputs objectAtIndex: 0];
+	if(![simulation isKindOfClass: [AdSimulationData class]])
+		[NSException raise: NSInvalidArgumentException
+			format: @"Frame analysis requires a simulation - use processInputs:userOptions: for %@", 
+			NSStringFromClass([simulation class])];
+
+	[frameOptions release];
+	frameOptions = [opt retain];
+	[returnString release];
+	returnString = [NSMutableString new];
+	dataSource = [self _dataSourceOfInput: simulation options: opt];
+	systemName = [[opt valueForKeyPath: @"System.Selection"] objectAtIndex: 0];
+	energyUnit = [[opt valueForKeyPath: @"Units.Selection"]
+			objectAtIndex: 0];
+	[self _setUp: opt];
+
+	start = [[opt valueForKeyPath: @"Frames.Start"] intValue];
+	end = start + [[opt valueForKeyPath: @"Frames.Length"] intValue];
+	step = [[opt valueForKeyPath: @"Frames.Stepsize"] intValue];
+	if(step <= 0)
+		step = 1;
+
+	if(end > (int)[simulation numberTrajectoryCheckpoints])
+		end = [simulation numberTrajectoryCheckpoints];
+
+	checkpoints = [NSMutableIndexSet indexSet];
+	for(i=start; i<end; i+=step)
+		[checkpoints addIndex: i];
+
+	return checkpoints;	
+}
+
+- (id) analyseTrajectoryCheckpoint: (unsigned int) number mementos: (NSDictionary*) mementos
+{
+	id memento;
+	AdSystem* frameSystem;
+	AdForceField* frameForceField;
+
+	memento = [mementos objectForKey: systemName];
+	if(memento == nil)
+		return nil;
+
+	frameSystem = [self _createSystem];
+	[frameSystem returnToState: memento];
+	frameForceField = [self _forceFieldForSystem: frameSystem
+				type: [[dataSource allData] objectForKey: @"ForceField"]
+				options: frameOptions];
+
+	return [self _atomEnergiesUsingForceField: frameForceField
+			options: frameOptions
+			postProgress: NO];
+}
 
+/**
+Averages the atom energies of each checkpoint. The solvation data is calculated
+for the first analysed checkpoint.
+*/
+- (NSDictionary*) resultsFromFrameAnalyses: (NSArray*) frameResults checkpoints: (NSIndexSet*) checkpoints
+{
+	unsigned int i, j, length, numberOfFrames, checkpoint, firstCheckpoint;
+	double* average;
+	const double* energies;
+	NSMutableData* averageData = nil;
+	NSArray* missingTerms = [NSArray array];
+	NSDictionary* results;
+	id result;
+
+	numberOfFrames = 0;
+	firstCheckpoint = NSNotFound;
+	checkpoint = [checkpoints firstIndex];
+	for(i=0; i<[frameResults count]; i++, checkpoint = [checkpoints indexGreaterThanIndex: checkpoint])
+	{
+		result = [frameResults objectAtIndex: i];
+		if(result == [NSNull null])
+			continue;
+
+		if(firstCheckpoint == NSNotFound)
+			firstCheckpoint = checkpoint;
+
+		energies = [[result objectForKey: @"Energies"] bytes];
+		length = [[result objectForKey: @"Energies"] length]/sizeof(double);
+		if(averageData == nil)
+		{
+			averageData = [NSMutableData dataWithLength: length*sizeof(double)];
+			missingTerms = [result objectForKey: @"MissingTerms"];
+		}
+
+		average = [averageData mutableBytes];
+		for(j=0; j<length; j++)
+			average[j] += energies[j];
+
+		numberOfFrames++;
+	}
+
+	if(numberOfFrames == 0)
+		[NSException raise: NSInvalidArgumentException
+			format: @"None of the selected frames contain %@", systemName];
+
+	average = [averageData mutableBytes];
+	length = [averageData length]/sizeof(double);
+	for(j=0; j<length; j++)
+		average[j] /= numberOfFrames;
+
+	[returnString appendFormat: @"Averaged over %d frames of %@\n", numberOfFrames, systemName];
+
+	system = [[self _createSystem] retain];
+	[system returnToState: 
+		[simulation mementoForSystem: [[simulation systemCollection] systemWithName: systemName]
+			inTrajectoryCheckpoint: firstCheckpoint]];
+
+	results = [self _resultsFromAtomEnergies: averageData
+			missingTerms: missingTerms
+			options: frameOptions];
+
+	[system release];
+	[frameOptions release];
+	frameOptions = nil;
+
+	return results;
+}
+
+- (NSDictionary*) processInputs: (NSArray*) anArray userOptions: (NSDictionary*) opt 
+{
+	unsigned int checkpoint;
+	id memento;
+	NSIndexSet* checkpoints;
+	NSDictionary* energies, *results;
+	NSMutableArray* frameResults;
+	NSAutoreleasePool* pool;
+
+	//For simulations analyse the checkpoints one at a time on this thread
+	if([[anArray objectAtIndex: 0] isKindOfClass: [AdSimulationData class]])
+	{
+		checkpoints = [self prepareFrameAnalysisOfInputs: anArray userOptions: opt];
+		frameResults = [NSMutableArray array];
+		checkpoint = [checkpoints firstIndex];
+		while(checkpoint != NSNotFound)
+		{
+			pool = [NSAutoreleasePool new];
+			[self updateProgressToStep: [frameResults count]
+				ofTotalSteps: [checkpoints count]
+				withMessage: [NSString stringWithFormat: @"Frame %d", checkpoint]];
+			memento = [simulation mementoForSystem: 
+					[[simulation systemCollection] systemWithName: systemName]
+					inTrajectoryCheckpoint: checkpoint];
+			energies = nil;
+			if(memento != nil)
+				energies = [self analyseTrajectoryCheckpoint: checkpoint
+						mementos: [NSDictionary dictionaryWithObject: memento
+								forKey: systemName]];
+			[frameResults addObject: (energies == nil) ? (id)[NSNull null] : (id)energies];
+			[pool release];
+			checkpoint = [checkpoints indexGreaterThanIndex: checkpoint];
+		}
+
+		return [self resultsFromFrameAnalyses: frameResults checkpoints: checkpoints];
+	}
+
+	returnString = [NSMutableString new];
+	dataSource = [anArray objectAtIndex: 0];
+	energyUnit = [[opt valueForKeyPath: @"Units.Selection"]
+			objectAtIndex: 0];
+	//Create a system
+	system = [[self _createSystem] retain];
+	forceField = [[self _forceFieldForSystem: system
+			type: [[dataSource allData] objectForKey: @"ForceField"]
+			options: opt] retain];
+	[self _setUp: opt];
+	energies = [self _atomEnergiesUsingForceField: forceField 
+			options: opt
+			postProgress: YES];
+
+	results = [self _resultsFromAtomEnergies: [energies objectForKey: @"Energies"]
+			missingTerms: [energies objectForKey: @"MissingTerms"]
+			options: opt];
+
+	[forceField release];
+	[system release];
+
+	return results;
+}
+
+@end
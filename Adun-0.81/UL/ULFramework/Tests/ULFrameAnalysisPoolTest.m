@@ -0,0 +1,269 @@
+/*
+   Project: UL
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+/*
+ * Checks that the results of frame analysis plugins run through a ULFrameAnalysisPool
+ * with several workers are the same as analysing the checkpoints one at a time.
+ * The plugins request different checkpoints, one returns nil for some checkpoints
+ * and the checkpoints take different times to analyse so they complete out of order.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <Foundation/Foundation.h>
+#include "ULFramework/ULFrameAnalysisPool.h"
+
+#define NUMBER_OF_CHECKPOINTS 97
+#define NUMBER_OF_VALUES 50
+
+static int failures = 0;
+
+/**
+A frame analysis plugin whose mementos are NSData objects containing doubles.
+Returns the sum of the values in the memento of "Test" scaled by a factor.
+If skipping is set returns nil for checkpoints divisible by 5.
+*/
+@interface TestFrameAnalysis: NSObject <ULAnalysisPlugin, ULFrameAnalysis>
+{
+	double factor;
+	BOOL skipping;
+	NSIndexSet* checkpoints;
+}
+- (id) initWithFactor: (double) value skipping: (BOOL) flag checkpoints: (NSIndexSet*) indexes;
+@end
+
+@implementation TestFrameAnalysis
+
+- (id) initWithFactor: (double) value skipping: (BOOL) flag checkpoints: (NSIndexSet*) indexes
+{
+	if((self = [super init]))
+	{
+		factor = value;
+		skipping = flag;
+		checkpoints = [indexes retain];
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	[checkpoints release];
+	[super dealloc];
+}
+
+- (BOOL) checkInputs: (NSArray*) inputs error: (NSError**) error
+{
+	return YES;
+}
+
+- (NSDictionary*) pluginOptions: (NSArray*) inputs
+{
+	return [NSDictionary dictionary];
+}
+
+- (NSDictionary*) processInputs: (NSArray*) inputs userOptions: (NSDictionary*) options
+{
+	return nil;
+}
+
+- (NSIndexSet*) prepareFrameAnalysisOfInputs: (NSArray*) inputs userOptions: (NSDictionary*) options
+{
+	return checkpoints;
+}
+
+- (id) analyseTrajectoryCheckpoint: (unsigned int) number mementos: (NSDictionary*) mementos
+{
+	int i;
+	double sum;
+	const double* values;
+	NSData* memento;
+
+	if(skipping && number%5 == 0)
+		return nil;
+
+	//Vary the time taken so the checkpoints complete out of order
+	usleep(100*((number*7)%11));
+
+	memento = [mementos objectForKey: @"Test"];
+	values = [memento bytes];
+	sum = 0;
+	for(i=0; i<(int)([memento length]/sizeof(double)); i++)
+		sum += values[i];
+
+	return [NSArray arrayWithObjects:
+			[NSNumber numberWithUnsignedInt: number],
+			[NSNumber numberWithDouble: factor*sum],
+			nil];
+}
+
+- (NSDictionary*) resultsFromFrameAnalyses: (NSArray*) frameResults checkpoints: (NSIndexSet*) indexes
+{
+	return [NSDictionary dictionaryWithObject: frameResults
+		forKey: @"Results"];
+}
+
+@end
+
+static NSDictionary* Mementos(unsigned int checkpoint)
+{
+	int i;
+	double values[NUMBER_OF_VALUES];
+
+	for(i=0; i<NUMBER_OF_VALUES; i++)
+		values[i] = checkpoint*0.5 + i*0.25;
+
+	return [NSDictionary dictionaryWithObject:
+			[NSData dataWithBytes: values length: sizeof(values)]
+		forKey: @"Test"];
+}
+
+/**
+Analyses the checkpoints of \e plugin one at a time on the calling thread.
+*/
+static NSArray* SerialResults(TestFrameAnalysis* plugin)
+{
+	unsigned int checkpoint;
+	NSIndexSet* checkpoints;
+	NSMutableArray* results;
+	id result;
+
+	checkpoints = [plugin prepareFrameAnalysisOfInputs: nil userOptions: nil];
+	results = [NSMutableArray array];
+	checkpoint = [checkpoints firstIndex];
+	while(checkpoint != NSNotFound)
+	{
+		result = [plugin analyseTrajectoryCheckpoint: checkpoint
+				mementos: Mementos(checkpoint)];
+		[results addObject: (result == nil) ? (id)[NSNull null] : result];
+		checkpoint = [checkpoints indexGreaterThanIndex: checkpoint];
+	}
+
+	return [[plugin resultsFromFrameAnalyses: results checkpoints: checkpoints]
+		objectForKey: @"Results"];
+}
+
+/**
+Analyses the checkpoints requested by \e plugins using a pool with \e threads workers.
+Each checkpoint is added once whichever plugins requested it.
+*/
+static NSArray* PooledResults(NSArray* plugins, int threads)
+{
+	int i;
+	unsigned int checkpoint;
+	NSMutableArray* checkpointSets, *results;
+	NSMutableIndexSet* allCheckpoints;
+	NSIndexSet* checkpoints;
+	ULFrameAnalysisPool* pool;
+	id plugin;
+
+	checkpointSets = [NSMutableArray array];
+	allCheckpoints = [NSMutableIndexSet indexSet];
+	for(i=0; i<(int)[plugins count]; i++)
+	{
+		checkpoints = [[plugins objectAtIndex: i]
+				prepareFrameAnalysisOfInputs: nil userOptions: nil];
+		[checkpointSets addObject: checkpoints];
+		[allCheckpoints addIndexes: checkpoints];
+	}
+
+	pool = [[ULFrameAnalysisPool alloc]
+			initWithPlugins: plugins
+			checkpoints: checkpointSets
+			numberOfCheckpoints: NUMBER_OF_CHECKPOINTS
+			numberOfThreads: threads];
+
+	checkpoint = [allCheckpoints firstIndex];
+	while(checkpoint != NSNotFound)
+	{
+		[pool addCheckpoint: checkpoint mementos: Mementos(checkpoint)];
+		checkpoint = [allCheckpoints indexGreaterThanIndex: checkpoint];
+	}
+	[pool finish];
+
+	results = [NSMutableArray array];
+	for(i=0; i<(int)[plugins count]; i++)
+	{
+		plugin = [plugins objectAtIndex: i];
+		[results addObject:
+			[[plugin resultsFromFrameAnalyses: [pool resultsOfPlugin: i]
+				checkpoints: [checkpointSets objectAtIndex: i]]
+				objectForKey: @"Results"]];
+	}
+
+	[pool release];
+
+	return results;
+}
+
+static void TestPool(int threads)
+{
+	int i;
+	NSMutableIndexSet* everyThird;
+	NSArray* plugins, *pooled;
+	NSArray* serial;
+
+	everyThird = [NSMutableIndexSet indexSet];
+	for(i=1; i<NUMBER_OF_CHECKPOINTS; i+=3)
+		[everyThird addIndex: i];
+
+	plugins = [NSArray arrayWithObjects:
+			[[[TestFrameAnalysis alloc] initWithFactor: 1.0
+				skipping: NO
+				checkpoints: [NSIndexSet indexSetWithIndexesInRange:
+					NSMakeRange(0, NUMBER_OF_CHECKPOINTS)]] autorelease],
+			[[[TestFrameAnalysis alloc] initWithFactor: -2.0
+				skipping: YES
+				checkpoints: everyThird] autorelease],
+			[[[TestFrameAnalysis alloc] initWithFactor: 3.0
+				skipping: NO
+				checkpoints: [NSIndexSet indexSet]] autorelease],
+			nil];
+
+	pooled = PooledResults(plugins, threads);
+	for(i=0; i<(int)[plugins count]; i++)
+	{
+		serial = SerialResults([plugins objectAtIndex: i]);
+		if(![[pooled objectAtIndex: i] isEqual: serial])
+		{
+			fprintf(stderr, "FAILED: Plugin %d with %d threads - pooled results differ from serial results\n",
+				i, threads);
+			failures++;
+		}
+	}
+}
+
+int main(void)
+{
+	NSAutoreleasePool* pool = [NSAutoreleasePool new];
+
+	TestPool(1);
+	TestPool(4);
+	TestPool(16);
+
+	if(failures == 0)
+		printf("ULFrameAnalysisPoolTest: passed\n");
+
+	[pool release];
+
+	return failures == 0 ? 0 : 1;
+}
@@ -28,6 +28,7 @@
 #include <Foundation/Foundation.h>
 #include <AdunKernel/AdunDataSet.h>
 #include <AdunKernel/AdunSimulationData.h>
+#include <AdunKernel/AdunTrajectory.h>
 #include "ULFramework/ULAnalysisPlugin.h"
 #include "ULFramework/ULDatabaseInterface.h"
 
@@ -137,10 +138,27 @@ an NSError object explaining the reason for the failure.
 The receiever retains references to the output and the input objects that
 created it until the next call to this method unless clearOutput() is called
 first.
+If the plugin conforms to ULFrameAnalysis and there is a simulation among the inputs it is applied
+using applyFramePlugins:withOptions:error:().
 \todo Change so returns void - use currentOutputObject to get results.
 */
 - (id) applyPlugin: (NSString*) name withOptions: (NSMutableDictionary*) options error: (NSError**) error;
 /**
+Applies the plugins in \e names, which must conform to ULFrameAnalysis, to the trajectory
+of the simulation among the current input objects in a single pass.
+Each trajectory checkpoint requested by any of the plugins is read once and analysed by all
+the plugins that requested it using a pool of worker threads (see ULFrameAnalysisPool).
+The results of each plugin are then merged by the plugin.
+\param optionsArray The options for each plugin in the same order as \e names.
+\return An array containing the output of each plugin in the same order as \e names.
+The combined output becomes the current output of the receiver so outputDataSets() etc.
+return the results of all the plugins.
+An NSInvalidArgumentException is raised if there is no AdSimulationData or AdTrajectory among the inputs or
+if one of the plugins does not conform to ULFrameAnalysis. If the inputs cannot be processed by one
+of the plugins this method returns nil and \e error points to an NSError object explaining the reason for the failure.
+*/
+- (NSArray*) applyFramePlugins: (NSArray*) names withOptions: (NSArray*) optionsArray error: (NSError**) error;
+/**
 Returns the options for plugin \e name. Note a plugin may have no options.
 If \e name is not in the array returned by pluginsForCurrentInputs an
 NSInvalidArgumentException is raised.
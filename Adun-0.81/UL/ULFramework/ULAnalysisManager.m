@@ -23,6 +23,7 @@
 */
 
 #include "ULFramework/ULAnalysisManager.h"
+#include "ULFramework/ULFrameAnalysisPool.h"
 
 @implementation ULAnalysisManager
 
@@ -239,18 +240,88 @@
 	[super dealloc];
 }
 
+/**
+Adds \e options to the metadata of each data set in \e dataSets along with
+references to the input objects.
+*/
+- (void) _addOptions: (NSDictionary*) options andInputReferencesToDataSets: (NSArray*) dataSets
+{
+	NSEnumerator *inputObjectsEnum, *dataSetsEnum;
+	id dataSet, inputObject;
+
+	//Add the plugin options to each returned datasets metadata	
+	dataSetsEnum = [dataSets objectEnumerator];
+	while((dataSet = [dataSetsEnum nextObject]))
+		[dataSet setValue: options 
+			forMetadataKey: @"dataGeneratorOptions"
+			inDomain: AdSystemMetadataDomain];
+			 
+	//set input references 
+	//note: output references cant be added until the object is saved 
+	//to a database.
+	inputObjectsEnum = [inputObjects objectEnumerator];
+	while((inputObject = [inputObjectsEnum nextObject]))
+	{
+		//FIXME: Unable to add input references for moltalk structures.
+		if([inputObject isKindOfClass: [AdModelObject class]])
+		{
+			//loop over every data set returned
+			dataSetsEnum = [dataSets objectEnumerator];
+			while((dataSet = [dataSetsEnum nextObject]))
+			{
+				[dataSet addInputReferenceToObject: inputObject];
+				NSDebugMLLog(@"ULAnalysisManager", @"Data set input references %@", 
+					[dataSet inputReferences]);
+			}	
+		}
+	}	
+}
+
+/**
+Returns the AdSimulationData or AdTrajectory among the input objects
+whose trajectory frame analysis plugins are applied to, or nil if there is none.
+*/
+- (id) _frameAnalysisSimulation
+{
+	NSEnumerator* inputObjectsEnum;
+	id inputObject;
+
+	inputObjectsEnum = [inputObjects objectEnumerator];
+	while((inputObject = [inputObjectsEnum nextObject]))
+		if([inputObject isKindOfClass: [AdSimulationData class]] ||
+			[inputObject isKindOfClass: [AdTrajectory class]])
+			return inputObject;
+
+	return nil;
+}
+
 /**
 All input objects used are retained until the next called to this method
 unless clearOutputs are called
 */
 - (id) applyPlugin: (NSString*) name withOptions: (NSMutableDictionary*) options error: (NSError**) error
 {
-	NSEnumerator *inputObjectsEnum, *dataSetsEnum;
-	id dataSet, inputObject;
-	NSArray* dataSets;
+	NSArray* dataSets, *pluginResults;
 	NSError* internalError;
 	
 	[self setCurrentPlugin: name];
+
+	//Plugins which analyse a trajectory one checkpoint at a time
+	//read it in a single pass with the checkpoints analysed concurrently.
+	if([currentPlugin conformsToProtocol: @protocol(ULFrameAnalysis)] &&
+		[self _frameAnalysisSimulation] != nil)
+	{
+		pluginResults = [self applyFramePlugins: [NSArray arrayWithObject: name]
+					withOptions: [NSArray arrayWithObject: options]
+					error: error];
+		if(pluginResults == nil)
+			return [NSDictionary dictionary];
+
+		[results release];
+		results = [[pluginResults objectAtIndex: 0] retain];
+		return results;
+	}
+
 	[results release];
 	[outputObjectsReferences removeAllObjects];
 	
@@ -269,33 +340,8 @@ unless clearOutputs are called
 				userOptions: options];
 		[results retain];		
 		dataSets = [results objectForKey: @"ULAnalysisPluginDataSets"];
-
-		//Add the plugin options to each returned datasets metadata	
-		dataSetsEnum = [dataSets objectEnumerator];
-		while((dataSet = [dataSetsEnum nextObject]))
-			[dataSet setValue: options 
-				forMetadataKey: @"dataGeneratorOptions"
-				inDomain: AdSystemMetadataDomain];
-				 
-		//set input references 
-		//note: output references cant be added until the object is saved 
-		//to a database.
-		inputObjectsEnum = [inputObjects objectEnumerator];
-		while((inputObject = [inputObjectsEnum nextObject]))
-		{
-			//FIXME: Unable to add input references for moltalk structures.
-			if([inputObject isKindOfClass: [AdModelObject class]])
-			{
-				//loop over every data set returned
-				dataSetsEnum = [dataSets objectEnumerator];
-				while((dataSet = [dataSetsEnum nextObject]))
-				{
-					[dataSet addInputReferenceToObject: inputObject];
-					NSDebugMLLog(@"ULAnalysisManager", @"Data set input references %@", 
-						[dataSet inputReferences]);
-				}	
-			}
-		}	
+		[self _addOptions: options 
+			andInputReferencesToDataSets: dataSets];
 
 		//Keep track of the objects that generated these data sets.
 		[outputObjectsReferences  addObjectsFromArray: inputObjects];
@@ -316,6 +362,193 @@ unless clearOutputs are called
 	return results;
 }
 
+/**
+Reads each checkpoint in \e checkpoints from \e simulation once and adds the
+mementos of its systems to \e pool.
+*/
+- (void) _streamCheckpoints: (NSIndexSet*) checkpoints
+	ofSimulation: (id) simulation
+	toPool: (ULFrameAnalysisPool*) pool
+{
+	unsigned int checkpoint, completed;
+	NSArray* systems;
+	NSEnumerator* systemEnum;
+	NSMutableDictionary* mementos, *notificationDict;
+	NSAutoreleasePool* autoreleasePool;
+	id system, memento;
+
+	systems = [[simulation systemCollection] fullSystems];
+	notificationDict = [NSMutableDictionary dictionary];
+	[notificationDict setObject: [NSNumber numberWithInt: [checkpoints count]]
+		forKey: @"ULAnalysisPluginTotalSteps"];
+
+	completed = 0;
+	checkpoint = [checkpoints firstIndex];
+	while(checkpoint != NSNotFound)
+	{
+		autoreleasePool = [NSAutoreleasePool new];
+		mementos = [NSMutableDictionary dictionary];
+		systemEnum = [systems objectEnumerator];
+		while((system = [systemEnum nextObject]))
+		{
+			memento = [simulation mementoForSystem: system 
+					inTrajectoryCheckpoint: checkpoint];
+			if(memento != nil)
+				[mementos setObject: memento 
+					forKey: [system systemName]];
+		}
+
+		[pool addCheckpoint: checkpoint mementos: mementos];
+		[autoreleasePool release];
+
+		completed++;
+		if(completed%10 == 0)
+		{
+			[notificationDict setObject: [NSNumber numberWithInt: completed]
+				forKey: @"ULAnalysisPluginCompletedSteps"];
+			[[NSNotificationCenter defaultCenter] 
+				postNotificationName: @"ULAnalysisPluginDidCompleteStepNotification"
+				object: nil
+				userInfo: notificationDict];
+		}
+
+		checkpoint = [checkpoints indexGreaterThanIndex: checkpoint];
+	}
+}
+
+- (NSArray*) applyFramePlugins: (NSArray*) names withOptions: (NSArray*) optionsArray error: (NSError**) error
+{
+	int i;
+	unsigned int numberOfCheckpoints;
+	NSMutableArray* plugins, *checkpointSets, *pluginResults;
+	NSMutableArray* dataSets, *files;
+	NSMutableString* outputString;
+	NSMutableIndexSet* allCheckpoints, *checkpoints;
+	NSDictionary* pluginOutput;
+	NSError* internalError = nil;
+	ULFrameAnalysisPool* pool;
+	id simulation, plugin, options;
+
+	if([names count] != [optionsArray count])
+		[NSException raise: NSInvalidArgumentException
+			format: @"Options must be provided for each plugin"];
+
+	simulation = [self _frameAnalysisSimulation];
+	if(simulation == nil)
+		[NSException raise: NSInvalidArgumentException
+			format: @"Frame analysis requires a simulation among the inputs"];
+
+	[self clearOutput];
+	numberOfCheckpoints = [simulation numberTrajectoryCheckpoints];
+	allCheckpoints = [NSMutableIndexSet indexSet];
+	plugins = [NSMutableArray array];
+	checkpointSets = [NSMutableArray array];
+	for(i=0; i<(int)[names count]; i++)
+	{
+		plugin = [[[self loadPlugin: [names objectAtIndex: i]] new] autorelease];
+		if(![plugin conformsToProtocol: @protocol(ULAnalysisPlugin)] ||
+			![plugin conformsToProtocol: @protocol(ULFrameAnalysis)])
+		{
+			[NSException raise: NSInvalidArgumentException 
+				format: @"Plugin %@ does not conform to the ULAnalysisPlugin and ULFrameAnalysis protocols", 
+				[names objectAtIndex: i]];
+		}
+
+		if(![plugin checkInputs: inputObjects error: &internalError])
+		{
+			if(error != NULL && internalError != nil)
+				*error = internalError;
+			
+			return nil;
+		}
+
+		//Ignore any requested checkpoints which do not exist
+		checkpoints = [[[plugin prepareFrameAnalysisOfInputs: inputObjects
+					userOptions: [optionsArray objectAtIndex: i]] 
+					mutableCopy] autorelease];
+		if(checkpoints == nil)
+			checkpoints = [NSMutableIndexSet indexSet];
+		else if([checkpoints count] != 0 && [checkpoints lastIndex] >= numberOfCheckpoints)
+			[checkpoints removeIndexesInRange: 
+				NSMakeRange(numberOfCheckpoints, [checkpoints lastIndex] - numberOfCheckpoints + 1)];
+
+		[allCheckpoints addIndexes: checkpoints];
+		[plugins addObject: plugin];
+		[checkpointSets addObject: checkpoints];
+	}
+
+	NSDebugLLog(@"ULAnalysisManager", @"Analysing %d checkpoints with %@",
+		[allCheckpoints count], names);
+
+	//Map - The trajectory is read once on this thread and each checkpoint
+	//is analysed by the worker threads.
+	pool = [[ULFrameAnalysisPool alloc] 
+			initWithPlugins: plugins
+			checkpoints: checkpointSets
+			numberOfCheckpoints: numberOfCheckpoints];
+	[pool autorelease];
+	NS_DURING
+	{
+		[self _streamCheckpoints: allCheckpoints
+			ofSimulation: simulation
+			toPool: pool];
+		[pool finish];
+	}
+	NS_HANDLER
+	{
+		[pool stop];
+		NSWarnLog(@"Frame analysis failed due to an exception");
+		NSWarnLog(@"%@ %@ %@", [localException name], 
+			[localException reason], 
+			[localException userInfo]);
+		[localException raise];
+	}
+	NS_ENDHANDLER
+
+	//Reduce - Each plugin merges its results on this thread.
+	//The combined output becomes the current output of the receiver.
+	pluginResults = [NSMutableArray array];
+	dataSets = [NSMutableArray array];
+	files = [NSMutableArray array];
+	outputString = [NSMutableString string];
+	for(i=0; i<(int)[plugins count]; i++)
+	{
+		plugin = [plugins objectAtIndex: i];
+		options = [optionsArray objectAtIndex: i];
+		pluginOutput = [plugin resultsFromFrameAnalyses: [pool resultsOfPlugin: i]
+					checkpoints: [checkpointSets objectAtIndex: i]];
+		if(pluginOutput == nil)
+			pluginOutput = [NSDictionary dictionary];
+
+		[self _addOptions: options 
+			andInputReferencesToDataSets: 
+			[pluginOutput objectForKey: @"ULAnalysisPluginDataSets"]];
+		[pluginResults addObject: pluginOutput];
+
+		if([pluginOutput objectForKey: @"ULAnalysisPluginDataSets"] != nil)
+			[dataSets addObjectsFromArray: 
+				[pluginOutput objectForKey: @"ULAnalysisPluginDataSets"]];
+		if([pluginOutput objectForKey: @"ULAnalysisPluginFiles"] != nil)
+			[files addObjectsFromArray: 
+				[pluginOutput objectForKey: @"ULAnalysisPluginFiles"]];
+		if([pluginOutput objectForKey: @"ULAnalysisPluginString"] != nil)
+			[outputString appendFormat: @"%@\n%@\n", 
+				[names objectAtIndex: i],
+				[pluginOutput objectForKey: @"ULAnalysisPluginString"]];
+	}
+
+	results = [[NSDictionary alloc] initWithObjectsAndKeys:
+			dataSets, @"ULAnalysisPluginDataSets",
+			files, @"ULAnalysisPluginFiles",
+			outputString, @"ULAnalysisPluginString",
+			nil];
+	[outputObjectsReferences addObjectsFromArray: inputObjects];
+
+	NSDebugLLog(@"ULAnalysisManager", @"Completed frame analysis. Returning %@", pluginResults);
+
+	return pluginResults;
+}
+
 - (void) clearOutput
 {
 	[results release];
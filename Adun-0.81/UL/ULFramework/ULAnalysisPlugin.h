@@ -87,7 +87,49 @@ ULAnalysisPluginFileDescription - A description of the file.
 For each dictionary the analyser will display a save panel with the given description allowing
 the user to choose where to save the file. 
 */
-- (NSDictionary*) processInputs: (NSArray*) inputs userOptions: (NSDictionary*) options; 
+- (NSDictionary*) processInputs: (NSArray*) inputs userOptions: (NSDictionary*) options;
+@end
+
+/**
+\ingroup protocols
+ULFrameAnalysis can be adopted by analysis plugins which process the trajectory of a simulation
+one checkpoint at a time. Plugins adopting it can be applied using
+ULAnalysisManager::applyFramePlugins:withOptions:error: which reads each trajectory checkpoint
+from the simulation once, passes it to every plugin that requested it and analyses the checkpoints
+concurrently using a pool of worker threads.
+
+The analysis is split in three steps.
+- prepareFrameAnalysisOfInputs:userOptions:() is called on the calling thread before any checkpoint is read.
+- analyseTrajectoryCheckpoint:mementos:() (the map step) is called once for each requested checkpoint.
+Calls for different checkpoints may occur at the same time on different threads and in any order so
+the implementation must not modify state shared between checkpoints.
+- resultsFromFrameAnalyses:checkpoints:() (the reduce step) is called on the calling thread with the
+results of each checkpoint in checkpoint order.
+
+A plugin adopting this protocol must also adopt ULAnalysisPlugin. checkInputs:error: is called before
+the analysis begins.
+*/
+@protocol ULFrameAnalysis
+/**
+Prepares the receiver to analyse the trajectory of the simulation in \e inputs
+and returns the indexes of the trajectory checkpoints to analyse.
+Returns nil if there is nothing to analyse.
+*/
+- (NSIndexSet*) prepareFrameAnalysisOfInputs: (NSArray*) inputs userOptions: (NSDictionary*) options;
+/**
+Analyses trajectory checkpoint \e number. \e mementos contains the memento of each
+system in the checkpoint keyed by system name. The mementos are shared with other
+plugins and must not be modified.
+The returned object is passed to resultsFromFrameAnalyses:checkpoints:().
+*/
+- (id) analyseTrajectoryCheckpoint: (unsigned int) number mementos: (NSDictionary*) mementos;
+/**
+Merges the results of analyseTrajectoryCheckpoint:mementos:() for each checkpoint in
+\e checkpoints into the plugin output. \e frameResults contains the results in
+the same order as \e checkpoints with NSNull in place of nil.
+The return value is the same as for ULAnalysisPlugin::processInputs:userOptions:().
+*/
+- (NSDictionary*) resultsFromFrameAnalyses: (NSArray*) frameResults checkpoints: (NSIndexSet*) checkpoints;
 @end
 
 #endif // _ULANALYSISPLUGIN_H_
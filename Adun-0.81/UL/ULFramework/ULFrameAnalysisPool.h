@@ -0,0 +1,113 @@
+/*
+   Project: UL
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#ifndef _ULFRAMEANALYSISPOOL_H_
+#define _ULFRAMEANALYSISPOOL_H_
+
+#include <pthread.h>
+#include <Foundation/Foundation.h>
+#include "ULFramework/ULAnalysisPlugin.h"
+
+/**
+\ingroup classes
+ULFrameAnalysisPool passes trajectory checkpoints to a set of ULFrameAnalysis plugins
+using a pool of worker threads. It is used by ULAnalysisManager::applyFramePlugins:withOptions:error:.
+
+The checkpoints are read by the calling thread and added using addCheckpoint:mementos:().
+This blocks while the queue of checkpoints waiting to be analysed is full so the number of
+checkpoints held in memory is bounded.
+Each worker sends ULFrameAnalysis::analyseTrajectoryCheckpoint:mementos:() to every plugin that
+requested the checkpoint and stores the result. Once all checkpoints have been added finish()
+waits for the workers to complete after which the results are available through
+resultsOfPlugin:().
+
+Exceptions raised on the worker threads are caught and reraised on the next call to
+addCheckpoint:mementos:() or finish(). Either finish() or stop() must be called before
+the pool is released.
+The number of workers is given by the \e AnalysisThreads default. If this is 0 (the default)
+one worker is used for each available processor.
+*/
+@interface ULFrameAnalysisPool: NSObject
+{
+	@private
+	BOOL isRunning;
+	int numberOfThreads;
+	int runningThreads;
+	int numberOfPlugins;
+	int queueCapacity;
+	int queueLength;
+	int firstJob;
+	unsigned int numberOfCheckpoints;
+	unsigned int* queuedCheckpoints;
+	id* queuedMementos;
+	id** results;			//!< For each plugin the result for each checkpoint
+	NSArray* plugins;
+	NSArray* checkpointSets;	//!< For each plugin the checkpoints it requested
+	NSException* workerException;
+	pthread_mutex_t mutex;
+	pthread_cond_t jobCondition;	//!< Signalled when a checkpoint is added or the pool finishes
+	pthread_cond_t spaceCondition;	//!< Signalled when a checkpoint is taken or a worker exits
+}
+/**
+Returns the number of workers given by the \e AnalysisThreads default.
+*/
++ (int) defaultNumberOfThreads;
+/**
+As initWithPlugins:checkpoints:numberOfCheckpoints:numberOfThreads: using defaultNumberOfThreads().
+*/
+- (id) initWithPlugins: (NSArray*) pluginArray
+	checkpoints: (NSArray*) indexSets
+	numberOfCheckpoints: (unsigned int) number;
+/**
+Designated initialiser. Starts the worker threads.
+\param pluginArray An array of objects conforming to ULFrameAnalysis.
+\param indexSets An array containing an NSIndexSet for each plugin giving the checkpoints
+it will analyse.
+\param number The number of checkpoints in the trajectory. All indexes in \e indexSets must be less than this.
+\param threads The number of worker threads.
+*/
+- (id) initWithPlugins: (NSArray*) pluginArray
+	checkpoints: (NSArray*) indexSets
+	numberOfCheckpoints: (unsigned int) number
+	numberOfThreads: (int) threads;
+/**
+Queues checkpoint \e number for analysis by the plugins that requested it.
+\e mementos is retained until the checkpoint is analysed.
+*/
+- (void) addCheckpoint: (unsigned int) number mementos: (NSDictionary*) mementos;
+/**
+Waits until all queued checkpoints have been analysed and stops the worker threads.
+*/
+- (void) finish;
+/**
+Stops the worker threads discarding any checkpoints that have not been analysed.
+*/
+- (void) stop;
+/**
+Returns the results of the plugin at \e index in the order of its checkpoints.
+Results which were nil are replaced by NSNull.
+Must be called after finish().
+*/
+- (NSArray*) resultsOfPlugin: (int) index;
+@end
+
+#endif // _ULFRAMEANALYSISPOOL_H_
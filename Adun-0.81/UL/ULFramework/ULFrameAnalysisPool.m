@@ -0,0 +1,322 @@
+/*
+   Project: UL
+
+   Copyright (C) 2005 Michael Johnston & Jordi Villa-Freixa
+
+   Author: Michael Johnston
+
+   This application is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This application is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 USA.
+*/
+
+#include <unistd.h>
+#include "ULFramework/ULFrameAnalysisPool.h"
+
+@interface ULFrameAnalysisPool (PrivateWorkers)
+- (void) _raiseWorkerException;
+- (void) _analyseCheckpoint: (unsigned int) number mementos: (NSDictionary*) mementos;
+- (void) _runWorker: (id) object;
+- (void) _stopDiscardingCheckpoints: (BOOL) value;
+@end
+
+@implementation ULFrameAnalysisPool (PrivateWorkers)
+
+/**
+Raises the first exception caught on a worker thread if there is one.
+Must be called with the mutex locked - it is unlocked before raising.
+*/
+- (void) _raiseWorkerException
+{
+	NSException* exception;
+
+	if(workerException == nil)
+		return;
+
+	exception = [workerException autorelease];
+	workerException = nil;
+	pthread_mutex_unlock(&mutex);
+	[exception raise];
+}
+
+/**
+Sends the checkpoint to each plugin that requested it. Each result is
+stored in its own element of results so no lock is required.
+*/
+- (void) _analyseCheckpoint: (unsigned int) number mementos: (NSDictionary*) mementos
+{
+	int i;
+	NSAutoreleasePool* pool;
+	id result;
+
+	for(i=0; i<numberOfPlugins; i++)
+	{
+		if(![[checkpointSets objectAtIndex: i] containsIndex: number])
+			continue;
+
+		pool = [NSAutoreleasePool new];
+		NS_DURING
+		{
+			result = [[plugins objectAtIndex: i]
+					analyseTrajectoryCheckpoint: number
+					mementos: mementos];
+			results[i][number] = [result retain];
+		}
+		NS_HANDLER
+		{
+			NSWarnLog(@"Caught exception analysing checkpoint %d - %@",
+				number, localException);
+			pthread_mutex_lock(&mutex);
+			if(workerException == nil)
+				workerException = [localException retain];
+			pthread_mutex_unlock(&mutex);
+		}
+		NS_ENDHANDLER
+		[pool release];
+	}
+}
+
+- (void) _runWorker: (id) object
+{
+	unsigned int number;
+	NSAutoreleasePool* pool;
+	id mementos;
+
+	pool = [NSAutoreleasePool new];
+	pthread_mutex_lock(&mutex);
+	while(YES)
+	{
+		if(queueLength == 0)
+		{
+			if(!isRunning)
+				break;
+
+			pthread_cond_wait(&jobCondition, &mutex);
+			continue;
+		}
+
+		number = queuedCheckpoints[firstJob];
+		mementos = queuedMementos[firstJob];
+		queuedMementos[firstJob] = nil;
+		firstJob = (firstJob + 1) % queueCapacity;
+		queueLength--;
+		pthread_cond_broadcast(&spaceCondition);
+
+		//Analyse without holding the lock so the other workers
+		//and the reading thread can continue.
+		pthread_mutex_unlock(&mutex);
+		[self _analyseCheckpoint: number mementos: mementos];
+		[mementos release];
+		pthread_mutex_lock(&mutex);
+	}
+
+	runningThreads--;
+	pthread_cond_broadcast(&spaceCondition);
+	pthread_mutex_unlock(&mutex);
+	[pool release];
+}
+
+- (void) _stopDiscardingCheckpoints: (BOOL) value
+{
+	pthread_mutex_lock(&mutex);
+	if(value)
+	{
+		while(queueLength > 0)
+		{
+			[queuedMementos[firstJob] release];
+			queuedMementos[firstJob] = nil;
+			firstJob = (firstJob + 1) % queueCapacity;
+			queueLength--;
+		}
+	}
+
+	isRunning = NO;
+	pthread_cond_broadcast(&jobCondition);
+	while(runningThreads > 0)
+		pthread_cond_wait(&spaceCondition, &mutex);
+
+	pthread_mutex_unlock(&mutex);
+}
+
+@end
+
+@implementation ULFrameAnalysisPool
+
++ (void) initialize
+{
+	[[NSUserDefaults standardUserDefaults] registerDefaults:
+		[NSDictionary dictionaryWithObject: [NSNumber numberWithInt: 0]
+			forKey: @"AnalysisThreads"]];
+}
+
++ (int) defaultNumberOfThreads
+{
+	int number;
+
+	number = [[NSUserDefaults standardUserDefaults]
+			integerForKey: @"AnalysisThreads"];
+	if(number <= 0)
+		number = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	if(number < 1)
+		number = 1;
+
+	return number;
+}
+
+- (id) initWithPlugins: (NSArray*) pluginArray
+	checkpoints: (NSArray*) indexSets
+	numberOfCheckpoints: (unsigned int) number
+{
+	return [self initWithPlugins: pluginArray
+		checkpoints: indexSets
+		numberOfCheckpoints: number
+		numberOfThreads: [ULFrameAnalysisPool defaultNumberOfThreads]];
+}
+
+- (id) initWithPlugins: (NSArray*) pluginArray
+	checkpoints: (NSArray*) indexSets
+	numberOfCheckpoints: (unsigned int) number
+	numberOfThreads: (int) threads
+{
+	int i;
+
+	if((self = [super init]))
+	{
+		if(threads < 1)
+			[NSException raise: NSInvalidArgumentException
+				format: @"The number of threads must be greater than 0 (%d)", threads];
+
+		if([pluginArray count] != [indexSets count])
+			[NSException raise: NSInvalidArgumentException
+				format: @"A set of checkpoints is required for each plugin"];
+
+		plugins = [pluginArray copy];
+		checkpointSets = [indexSets copy];
+		numberOfPlugins = [plugins count];
+		numberOfCheckpoints = number;
+		numberOfThreads = threads;
+		workerException = nil;
+
+		results = (id**)malloc((numberOfPlugins + 1)*sizeof(id*));
+		for(i=0; i<numberOfPlugins; i++)
+			results[i] = (id*)calloc(numberOfCheckpoints + 1, sizeof(id));
+
+		//Two checkpoints per worker keeps them busy while the next is read
+		queueCapacity = 2*numberOfThreads;
+		queueLength = firstJob = 0;
+		queuedCheckpoints = (unsigned int*)malloc(queueCapacity*sizeof(unsigned int));
+		queuedMementos = (id*)calloc(queueCapacity, sizeof(id));
+
+		pthread_mutex_init(&mutex, NULL);
+		pthread_cond_init(&jobCondition, NULL);
+		pthread_cond_init(&spaceCondition, NULL);
+		isRunning = YES;
+		runningThreads = numberOfThreads;
+		for(i=0; i<numberOfThreads; i++)
+			[NSThread detachNewThreadSelector: @selector(_runWorker:)
+				toTarget: self
+				withObject: nil];
+
+		NSDebugLLog(@"ULFrameAnalysisPool",
+			@"Started %d workers for %d plugins", numberOfThreads, numberOfPlugins);
+	}
+
+	return self;
+}
+
+- (void) dealloc
+{
+	int i;
+	unsigned int j;
+
+	[self stop];
+	for(i=0; i<numberOfPlugins; i++)
+	{
+		for(j=0; j<numberOfCheckpoints; j++)
+			[results[i][j] release];
+
+		free(results[i]);
+	}
+
+	free(results);
+	free(queuedCheckpoints);
+	free(queuedMementos);
+	pthread_cond_destroy(&jobCondition);
+	pthread_cond_destroy(&spaceCondition);
+	pthread_mutex_destroy(&mutex);
+	[workerException release];
+	[plugins release];
+	[checkpointSets release];
+	[super dealloc];
+}
+
+- (void) addCheckpoint: (unsigned int) number mementos: (NSDictionary*) mementos
+{
+	if(number >= numberOfCheckpoints)
+		[NSException raise: NSRangeException
+			format: @"Checkpoint %d is out of range (%d)", number, numberOfCheckpoints];
+
+	pthread_mutex_lock(&mutex);
+	if(!isRunning)
+	{
+		pthread_mutex_unlock(&mutex);
+		[NSException raise: NSInternalInconsistencyException
+			format: @"Cannot add checkpoints to a pool which has been stopped"];
+	}
+
+	while(queueLength == queueCapacity && workerException == nil)
+		pthread_cond_wait(&spaceCondition, &mutex);
+
+	[self _raiseWorkerException];
+	queuedCheckpoints[(firstJob + queueLength) % queueCapacity] = number;
+	queuedMementos[(firstJob + queueLength) % queueCapacity] = [mementos retain];
+	queueLength++;
+	pthread_cond_signal(&jobCondition);
+	pthread_mutex_unlock(&mutex);
+}
+
+- (void) finish
+{
+	[self _stopDiscardingCheckpoints: NO];
+	pthread_mutex_lock(&mutex);
+	[self _raiseWorkerException];
+	pthread_mutex_unlock(&mutex);
+}
+
+- (void) stop
+{
+	[self _stopDiscardingCheckpoints: YES];
+}
+
+- (NSArray*) resultsOfPlugin: (int) index
+{
+	unsigned int number;
+	NSMutableArray* array;
+	NSIndexSet* checkpoints;
+	id result;
+
+	checkpoints = [checkpointSets objectAtIndex: index];
+	array = [NSMutableArray arrayWithCapacity: [checkpoints count]];
+	number = [checkpoints firstIndex];
+	while(number != NSNotFound)
+	{
+		result = results[index][number];
+		[array addObject: (result != nil) ? result : [NSNull null]];
+		number = [checkpoints indexGreaterThanIndex: number];
+	}
+
+	return array;
+}
+
+@end
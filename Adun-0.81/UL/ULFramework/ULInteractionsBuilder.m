@@ -24,6 +24,7 @@
 
 #include <math.h>
 #include <AdunKernel/AdunDefinitions.h>
+#include <AdunKernel/AdunNonbondedPairArray.h>
 #include "ULFramework/ULInteractionsBuilder.h"
 #include "ULFramework/ULFrameworkFunctions.h"
 
@@ -1095,41 +1096,36 @@ If we dont find parameters for the itor then it is removed
 	return interaction;
 }
 
+/*
+ * The nonbonded pairs are all pairs of atoms except those which take part in the same
+ * bonded interaction. Only the excluded pairs are found and they are stored 
+ * in an AdNonbondedPairArray.
+ */
 - (id) _buildNonBondedForAtoms: (NSMutableArray*) atomNames 
 		bondedInteractions: (NSMutableDictionary*) bondedInteractions
 		atomsPerResidue: (NSMutableArray*) atomsPerResidue
 {
-	int i, j, elementsPerInteraction;
+	int i, j, k, elementsPerInteraction, atomIndex, partnerIndex;
 	int noAtoms, noResidues, index, residueStart, residueEnd;
-	NSMutableArray* nonbonded; 
-	NSMutableIndexSet* indexes, *topIndexes, *interactionIndexes;
+	int numberOfExclusions, maxExclusions;
+	int* interactionAtoms, *exclusions;
+	AdNonbondedPairArray* nonbonded; 
+	NSIndexSet *topIndexes;
 	NSEnumerator *interactionEnum;
-	NSRange indexRange;
 	id topology, matrix, interaction;
 
 	noAtoms = [atomNames count];
 	noResidues = [atomsPerResidue count];
-	nonbonded = [NSMutableArray arrayWithCapacity: 1];
-	
-	for(i=0; i<noAtoms-1; i++)
-	{
-		indexRange.location = i+1;
-		indexRange.length = noAtoms - indexRange.location;
-		indexes = [NSMutableIndexSet indexSetWithIndexesInRange: indexRange];
-		[nonbonded addObject: indexes];
-	}
-
-	residueEnd = 0;
-	interactionIndexes = [NSMutableIndexSet indexSet];
-
-	index = 0;
-	for(i=0; i<[nonbonded count]; i++)
-		index += [[nonbonded objectAtIndex:i] count];
 
 	NSDebugLLog(@"ULInteractionsBuilder", 
-		@"There are %d nonbonded interactions before removal", 
-		index);
+		@"There are %lld nonbonded interactions before removal", 
+		((long long)noAtoms*(noAtoms - 1))/2);
 
+	residueEnd = 0;
+	numberOfExclusions = 0;
+	maxExclusions = 16*noAtoms;
+	exclusions = malloc(2*maxExclusions*sizeof(int));
+	interactionAtoms = NULL;
 	for(i=0; i<noResidues; i++)
 	{	
 
@@ -1153,34 +1149,58 @@ If we dont find parameters for the itor then it is removed
 						objectAtIndex: i];
 			elementsPerInteraction = [[topology valueForKey:@"ElementsPerInteraction"] intValue];
 			matrix = [topology valueForKey:@"Matrix"];
+			interactionAtoms = realloc(interactionAtoms, elementsPerInteraction*sizeof(int));
 					
 			//for each of the interactions in this residue go through
 			//all the atoms in the residue. If they are invovled in the interaction
-			//remove them from the nonbonded index set
+			//exclude their pairs with the higher atoms in the interaction.
 			
 			index = [topIndexes firstIndex];
 			while(index != NSNotFound)
 			{
 				interaction = [matrix row: index];
 				for(j=0; j<elementsPerInteraction; j++)
-					[interactionIndexes addIndex: [[interaction objectAtIndex: j] intValue]];
+					interactionAtoms[j] = [[interaction objectAtIndex: j] intValue];
+
+				for(j=0; j<elementsPerInteraction; j++)
+				{
+					atomIndex = interactionAtoms[j];
+					if(atomIndex < residueStart || atomIndex >= residueEnd)
+						continue;
+
+					for(k=0; k<elementsPerInteraction; k++)
+					{
+						partnerIndex = interactionAtoms[k];
+						if(partnerIndex <= atomIndex)
+							continue;
+
+						if(numberOfExclusions == maxExclusions)
+						{
+							maxExclusions *= 2;
+							exclusions = realloc(exclusions, 2*maxExclusions*sizeof(int));
+						}
 
-				for(j=residueStart; j<residueEnd; j++)
-					if([interactionIndexes containsIndex: j])
-						[[nonbonded objectAtIndex: j] removeIndexes: interactionIndexes];
+						exclusions[2*numberOfExclusions] = atomIndex;
+						exclusions[2*numberOfExclusions + 1] = partnerIndex;
+						numberOfExclusions++;
+					}
+				}	
 				
 				index = [topIndexes indexGreaterThanIndex: index];
-				[interactionIndexes removeAllIndexes];
 			}
 		}
 	}
 
-	index = 0;
-	for(i=0; i<[nonbonded count]; i++)
-		index += [[nonbonded objectAtIndex:i] count];
+	nonbonded = [[AdNonbondedPairArray alloc]
+			initWithNumberOfElements: noAtoms
+			exclusions: exclusions
+			count: numberOfExclusions];
+	[nonbonded autorelease];		
+	free(exclusions);
+	free(interactionAtoms);
 
-	GSPrintf(buildOutput, @"There are %d nonbonded interactions\n", index);
-	[buildString appendFormat: @"\t\tThere are %d nonbonded interactions\n", index];
+	GSPrintf(buildOutput, @"There are %llu nonbonded interactions\n", [nonbonded numberOfPairs]);
+	[buildString appendFormat: @"\t\tThere are %llu nonbonded interactions\n", [nonbonded numberOfPairs]];
 
 	return nonbonded;
 }